@@ -210,6 +210,7 @@ static int gic_suspend(void)
 }
 
 extern int msm_show_resume_irq_mask;
+extern void msm_show_resume_irq_record(unsigned int irq);
 
 static void gic_show_resume_irq(struct gic_chip_data *gic)
 {
@@ -218,9 +219,6 @@ static void gic_show_resume_irq(struct gic_chip_data *gic)
 	unsigned long pending[32];
 	void __iomem *base = gic_data_dist_base(gic);
 
-	if (!msm_show_resume_irq_mask)
-		return;
-
 	raw_spin_lock(&irq_controller_lock);
 	for (i = 0; i * 32 < gic->max_irq; i++) {
 		enabled = readl_relaxed(base + GIC_DIST_ENABLE_CLEAR + i * 4);
@@ -232,8 +230,10 @@ static void gic_show_resume_irq(struct gic_chip_data *gic)
 	for (i = find_first_bit(pending, gic->max_irq);
 	     i < gic->max_irq;
 	     i = find_next_bit(pending, gic->max_irq, i+1)) {
-		pr_warning("%s: %d triggered", __func__,
-					i + gic->irq_offset);
+		msm_show_resume_irq_record(i + gic->irq_offset);
+		if (msm_show_resume_irq_mask)
+			pr_warning("%s: %d triggered", __func__,
+						i + gic->irq_offset);
 	}
 }
 
@@ -55,6 +55,16 @@
 
 #define	RESRX_VALUE_EN	0x80000000
 
+/*
+ * Generic LLC events (LLC-loads, LLC-store-misses, ...) are counted by the
+ * L2 PMU. Their rsRCCG codes depend on the Krait L2 revision, so they are
+ * given at boot or at runtime as perf_event.krait_l2_cache_map, indexed by
+ * op * PERF_COUNT_HW_CACHE_RESULT_MAX + result. 0 leaves an event unmapped.
+ */
+static unsigned int krait_l2_cache_map[PERF_COUNT_HW_CACHE_OP_MAX *
+				       PERF_COUNT_HW_CACHE_RESULT_MAX];
+module_param_array(krait_l2_cache_map, uint, NULL, 0644);
+
 static struct platform_device *l2_pmu_device;
 
 struct hw_krait_l2_pmu {
@@ -566,16 +576,46 @@ static void pmu_perf_event_destroy(struct perf_event *event)
 	}
 }
 
+static int krait_l2_map_cache_event(u64 config)
+{
+	unsigned int cache_type, cache_op, cache_result, code;
+
+	cache_type = (config >>  0) & 0xff;
+	cache_op = (config >>  8) & 0xff;
+	cache_result = (config >> 16) & 0xff;
+
+	/* Let the cpu PMU have the other caches */
+	if (cache_type != PERF_COUNT_HW_CACHE_LL)
+		return -ENOENT;
+	if (cache_op >= PERF_COUNT_HW_CACHE_OP_MAX ||
+	    cache_result >= PERF_COUNT_HW_CACHE_RESULT_MAX)
+		return -EINVAL;
+
+	code = krait_l2_cache_map[cache_op * PERF_COUNT_HW_CACHE_RESULT_MAX +
+				  cache_result];
+	if (!code)
+		return -ENOENT;
+
+	return code;
+}
+
 static int krait_l2_event_init(struct perf_event *event)
 {
 	int err = 0;
 	struct hw_perf_event *hwc = &event->hw;
 	int status = 0;
+	int mapping = -ENOENT;
 
 	switch (event->attr.type) {
 	case PERF_TYPE_SHARED:
 		break;
 
+	case PERF_TYPE_HW_CACHE:
+		mapping = krait_l2_map_cache_event(event->attr.config);
+		if (mapping < 0)
+			return mapping;
+		break;
+
 	default:
 		return -ENOENT;
 	}
@@ -599,7 +639,9 @@ static int krait_l2_event_init(struct perf_event *event)
 	hwc->event_base = 0;
 
 	/* Check if we came via perf default syms */
-	if (event->attr.config == PERF_COUNT_HW_L2_CYCLES)
+	if (event->attr.type == PERF_TYPE_HW_CACHE)
+		hwc->config_base = mapping;
+	else if (event->attr.config == PERF_COUNT_HW_L2_CYCLES)
 		hwc->config_base = L2CYCLE_CTR_RAW_CODE;
 	else
 		hwc->config_base = event->attr.config;
@@ -22,6 +22,10 @@
 #include <linux/cpufreq.h>
 #include <linux/cpu.h>
 #include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/mach-types.h>
 #include <asm/cpu.h>
@@ -36,6 +40,7 @@
 #include <mach/rpm-regulator.h>
 
 #include "acpuclock.h"
+#include "avs.h"
 
 /*
  * Source IDs.
@@ -133,6 +138,7 @@ struct scalable {
 	struct l2_level *l2_vote;
 	struct vreg vreg[NUM_VREG];
 	bool first_set_call;
+	bool avs_enabled;
 };
 
 static struct scalable scalable_8960[] = {
@@ -388,6 +394,7 @@ static struct msm_bus_scale_pdata bus_client_pdata = {
 };
 
 static uint32_t bus_perf_client;
+static unsigned int cur_bw_level;
 
 /* TODO: Update vdd_dig and vdd_mem when voltage data is available. */
 #define L2(x) (&l2_freq_tbl_8960_kraitv1[(x)])
@@ -736,12 +743,17 @@ static void set_sec_clk_src(struct scalable *sc, uint32_t sec_src_sel)
 	set_l2_indirect_reg(sc->l2cpmr_iaddr, regval);
 }
 
-/* Enable an already-configured HFPLL. */
-static void hfpll_enable(struct scalable *sc)
+/*
+ * Enable an already-configured HFPLL. The supply votes can be skipped when
+ * the PLL is only being relocked at a new rate and they are already in
+ * place, which saves two RPM round trips on each side of the relock.
+ */
+static void hfpll_enable(struct scalable *sc, bool skip_regulators)
 {
 	int rc;
 
-	if (cpu_is_msm8960() || cpu_is_msm8930() || cpu_is_msm8627()) {
+	if (!skip_regulators && (cpu_is_msm8960() || cpu_is_msm8930() ||
+				 cpu_is_msm8627())) {
 		rc = rpm_vreg_set_voltage(sc->vreg[VREG_HFPLL_A].rpm_vreg_id,
 				sc->vreg[VREG_HFPLL_A].rpm_vreg_voter, 2100000,
 				sc->vreg[VREG_HFPLL_A].max_vdd, 0);
@@ -778,7 +790,7 @@ static void hfpll_enable(struct scalable *sc)
 }
 
 /* Disable a HFPLL for power-savings or while its being reprogrammed. */
-static void hfpll_disable(struct scalable *sc)
+static void hfpll_disable(struct scalable *sc, bool skip_regulators)
 {
 	int rc;
 
@@ -788,7 +800,8 @@ static void hfpll_disable(struct scalable *sc)
 	 */
 	writel_relaxed(0, sc->hfpll_base + HFPLL_MODE);
 
-	if (cpu_is_msm8960() || cpu_is_msm8930() || cpu_is_msm8627()) {
+	if (!skip_regulators && (cpu_is_msm8960() || cpu_is_msm8930() ||
+				 cpu_is_msm8627())) {
 		rc = rpm_vreg_set_voltage(sc->vreg[VREG_HFPLL_B].rpm_vreg_id,
 				sc->vreg[VREG_HFPLL_B].rpm_vreg_voter, 0,
 				0, 0);
@@ -841,9 +854,14 @@ static void set_bus_bw(unsigned int bw)
 	}
 
 	/* Update bandwidth if request has changed. This may sleep. */
+	if (bw == cur_bw_level)
+		return;
+
 	ret = msm_bus_scale_client_update_request(bus_perf_client, bw);
 	if (ret)
 		pr_err("bandwidth request failed (%d)\n", ret);
+	else
+		cur_bw_level = bw;
 }
 
 /* Set the CPU or L2 clock speed. */
@@ -863,10 +881,10 @@ static void set_speed(struct scalable *sc, struct core_speed *tgt_s,
 		set_sec_clk_src(sc, SEC_SRC_SEL_AUX);
 		set_pri_clk_src(sc, PRI_SRC_SEL_SEC_SRC);
 
-		/* Program CPU HFPLL. */
-		hfpll_disable(sc);
+		/* Program CPU HFPLL, its supplies stay on throughout. */
+		hfpll_disable(sc, 1);
 		hfpll_set_rate(sc, tgt_s);
-		hfpll_enable(sc);
+		hfpll_enable(sc, 1);
 
 		/* Move CPU to HFPLL source. */
 		set_pri_clk_src(sc, tgt_s->pri_src_sel);
@@ -882,10 +900,10 @@ static void set_speed(struct scalable *sc, struct core_speed *tgt_s,
 			set_sec_clk_src(sc, tgt_s->sec_src_sel);
 			set_pri_clk_src(sc, tgt_s->pri_src_sel);
 		}
-		hfpll_disable(sc);
+		hfpll_disable(sc, 0);
 	} else if (strt_s->src != HFPLL && tgt_s->src == HFPLL) {
 		hfpll_set_rate(sc, tgt_s);
-		hfpll_enable(sc);
+		hfpll_enable(sc, 0);
 		/*
 		 * If responding to CPU_UP_PREPARE, we can't change CP15
 		 * registers for the CPU that's coming up since we're not
@@ -1043,6 +1061,58 @@ static unsigned int calculate_vdd_core(struct acpu_level *tgt)
 	return tgt->vdd_core + (enable_boost ? boost_uv : 0);
 }
 
+/*
+ * Delay synthesizer setting for the Krait hardware AVS loop. When non-zero
+ * each core arms its own AVS block after a cpufreq switch to an HFPLL rate,
+ * letting good silicon trim below the table voltage, which stays the
+ * ceiling. The setting depends on silicon characterization, so AVS is off
+ * by default. AVS is always disarmed before the core voltage is changed.
+ */
+static unsigned int avs_dscr;
+module_param(avs_dscr, uint, S_IRUGO | S_IWUSR);
+
+static void avs_off(int cpu)
+{
+	if (!scalable[cpu].avs_enabled)
+		return;
+	AVS_DISABLE(cpu);
+	scalable[cpu].avs_enabled = false;
+}
+
+static void avs_on(int cpu, struct acpu_level *tgt)
+{
+	unsigned int dscr = ACCESS_ONCE(avs_dscr);
+
+	if (!dscr || tgt->speed.src != HFPLL || get_cpu() != cpu) {
+		put_cpu();
+		return;
+	}
+	avs_reset_delays(dscr);
+	scalable[cpu].avs_enabled = true;
+	put_cpu();
+}
+
+/*
+ * Histogram of cpufreq transition times per CPU. Bucket 0 counts switches
+ * under 32us, each following bucket doubles the limit and the last one
+ * takes everything slower. Protected by driver_lock.
+ */
+#define NUM_LAT_BUCKETS		8
+#define LAT_BUCKET_MIN_SHIFT	5
+
+static unsigned int trans_lat[NR_CPUS][NUM_LAT_BUCKETS];
+
+static void account_trans_lat(int cpu, ktime_t start)
+{
+	s64 us = ktime_to_us(ktime_sub(ktime_get(), start));
+	int bucket = 0;
+
+	if (us >= (1 << LAT_BUCKET_MIN_SHIFT))
+		bucket = min(ilog2(us) - LAT_BUCKET_MIN_SHIFT + 1,
+			     NUM_LAT_BUCKETS - 1);
+	trans_lat[cpu][bucket]++;
+}
+
 /* Set the CPU's clock rate and adjust the L2 rate, if appropriate. */
 static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 				 enum setrate_reason reason)
@@ -1052,6 +1122,7 @@ static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 	struct acpu_level *tgt;
 	unsigned int vdd_mem, vdd_dig, vdd_core;
 	unsigned long flags;
+	ktime_t start = ktime_get();
 	int rc = 0;
 
 	if (cpu > num_possible_cpus()) {
@@ -1085,6 +1156,10 @@ static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 	vdd_dig  = calculate_vdd_dig(tgt);
 	vdd_core = calculate_vdd_core(tgt);
 
+	/* Disable AVS before the voltage and rate change. */
+	if (reason == SETRATE_CPUFREQ)
+		avs_off(cpu);
+
 	/* Increase VDD levels if needed. */
 	if (reason == SETRATE_CPUFREQ || reason == SETRATE_HOTPLUG) {
 		rc = increase_vdd(cpu, vdd_core, vdd_mem, vdd_dig, reason);
@@ -1120,6 +1195,10 @@ static int acpuclk_8960_set_rate(int cpu, unsigned long rate,
 	decrease_vdd(cpu, vdd_core, vdd_mem, vdd_dig, reason);
 
 	scalable[cpu].first_set_call = false;
+	if (reason == SETRATE_CPUFREQ) {
+		avs_on(cpu, tgt);
+		account_trans_lat(cpu, start);
+	}
 	pr_debug("ACPU%d speed change complete\n", cpu);
 
 out:
@@ -1134,7 +1213,7 @@ static void __init hfpll_init(struct scalable *sc, struct core_speed *tgt_s)
 	pr_debug("Initializing HFPLL%d\n", sc - scalable);
 
 	/* Disable the PLL for re-programming. */
-	hfpll_disable(sc);
+	hfpll_disable(sc, 0);
 
 	/* Configure PLL parameters for integer mode. */
 	writel_relaxed(0x7845C665, sc->hfpll_base + HFPLL_CONFIG_CTL);
@@ -1146,7 +1225,7 @@ static void __init hfpll_init(struct scalable *sc, struct core_speed *tgt_s)
 
 	/* Set an initial rate and enable the PLL. */
 	hfpll_set_rate(sc, tgt_s);
-	hfpll_enable(sc);
+	hfpll_enable(sc, 0);
 }
 
 /* Voltage regulator initialization. */
@@ -1234,6 +1313,8 @@ static void __init bus_init(unsigned int init_bw)
 	ret = msm_bus_scale_client_update_request(bus_perf_client, init_bw);
 	if (ret)
 		pr_err("initial bandwidth request failed (%d)\n", ret);
+	else
+		cur_bw_level = init_bw;
 }
 
 #ifdef CONFIG_CPU_FREQ_MSM
@@ -1295,6 +1376,8 @@ static int __cpuinit acpuclock_cpu_callback(struct notifier_block *nfb,
 		break;
 	case CPU_DEAD:
 	case CPU_DEAD_FROZEN:
+		/* The AVS block loses its state with the core. */
+		scalable[cpu].avs_enabled = false;
 		prev_khz[cpu] = acpuclk_8960_get_rate(cpu);
 		/* Fall through. */
 	case CPU_UP_CANCELED:
@@ -1450,6 +1533,52 @@ static int __init acpuclk_8960_init(struct acpuclk_soc_data *soc_data)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int trans_lat_show(struct seq_file *m, void *unused)
+{
+	int cpu, i;
+
+	seq_printf(m, "cpu");
+	for (i = 0; i < NUM_LAT_BUCKETS - 1; i++)
+		seq_printf(m, " <%uus", 1 << (LAT_BUCKET_MIN_SHIFT + i));
+	seq_printf(m, " more\n");
+
+	mutex_lock(&driver_lock);
+	for_each_possible_cpu(cpu) {
+		seq_printf(m, "%d", cpu);
+		for (i = 0; i < NUM_LAT_BUCKETS; i++)
+			seq_printf(m, " %u", trans_lat[cpu][i]);
+		seq_printf(m, "\n");
+	}
+	mutex_unlock(&driver_lock);
+
+	return 0;
+}
+
+static int trans_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, trans_lat_show, inode->i_private);
+}
+
+static const struct file_operations trans_lat_fops = {
+	.open = trans_lat_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init acpuclk_8960_debugfs_init(void)
+{
+	if (!scalable)
+		return 0;
+
+	debugfs_create_file("acpuclk_transition_latency", S_IRUGO, NULL,
+			    NULL, &trans_lat_fops);
+	return 0;
+}
+late_initcall(acpuclk_8960_debugfs_init);
+#endif
+
 struct acpuclk_soc_data acpuclk_8960_soc_data __initdata = {
 	.init = acpuclk_8960_init,
 };
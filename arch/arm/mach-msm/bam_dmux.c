@@ -27,6 +27,7 @@
 #include <linux/clk.h>
 #include <linux/wakelock.h>
 #include <linux/kfifo.h>
+#include <linux/hrtimer.h>
 
 #include <mach/sps.h>
 #include <mach/bam_dmux.h>
@@ -54,6 +55,23 @@
 #define LOW_WATERMARK		2
 #define HIGH_WATERMARK		4
 
+/*
+ * Uplink aggregation.  Small data packets are packed back to back into a
+ * single BAM transfer, each one still preceded by its own bam_mux_hdr and
+ * padded to a 4 byte boundary so that the A2 can walk the frames.  An
+ * aggregate is sent when the next packet does not fit, when a packet too
+ * large to aggregate or a command is written, or when the aggregation
+ * timeout expires.  A size of 0 disables aggregation.
+ */
+static int ul_aggr_size;
+module_param(ul_aggr_size, int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int ul_aggr_max_pkt = 256;
+module_param(ul_aggr_max_pkt, int, S_IRUGO | S_IWUSR | S_IWGRP);
+static int ul_aggr_timeout_us = 500;
+module_param(ul_aggr_timeout_us, int, S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define UL_AGGR_MAX_SIZE	4096
+
 static int msm_bam_dmux_debug_enable;
 module_param_named(debug_enable, msm_bam_dmux_debug_enable,
 		   int, S_IRUGO | S_IWUSR | S_IWGRP);
@@ -65,6 +83,8 @@ static uint32_t bam_dmux_write_cpy_cnt;
 static uint32_t bam_dmux_write_cpy_bytes;
 static uint32_t bam_dmux_tx_sps_failure_cnt;
 static uint32_t bam_dmux_tx_stall_cnt;
+static uint32_t bam_dmux_ul_aggr_cnt;
+static uint32_t bam_dmux_ul_aggr_pkts;
 
 #define DBG(x...) do {		                 \
 		if (msm_bam_dmux_debug_enable)  \
@@ -102,6 +122,11 @@ static uint32_t bam_dmux_tx_stall_cnt;
 	bam_dmux_tx_stall_cnt++; \
 } while (0)
 
+#define DBG_INC_UL_AGGR_CNT(x) do { \
+	bam_dmux_ul_aggr_cnt++; \
+	bam_dmux_ul_aggr_pkts += (x); \
+} while (0)
+
 #else
 #define DBG(x...) do { } while (0)
 #define DBG_INC_READ_CNT(x...) do { } while (0)
@@ -109,6 +134,7 @@ static uint32_t bam_dmux_tx_stall_cnt;
 #define DBG_INC_WRITE_CPY(x...) do { } while (0)
 #define DBG_INC_TX_SPS_FAILURE_CNT() do { } while (0)
 #define DBG_INC_TX_STALL_CNT() do { } while (0)
+#define DBG_INC_UL_AGGR_CNT(x) do { } while (0)
 #endif
 
 struct bam_ch_info {
@@ -120,6 +146,7 @@ struct bam_ch_info {
 	char name[BAM_DMUX_CH_NAME_MAX_LEN];
 	int num_tx_pkts;
 	int use_wm;
+	int rx_poll;
 };
 
 struct tx_pkt_info {
@@ -131,11 +158,21 @@ struct tx_pkt_info {
 	struct list_head list_node;
 	unsigned ts_sec;
 	unsigned long ts_nsec;
+
+	/* uplink aggregate: frames are copied into aggr_buf */
+	char is_aggr;
+	char *aggr_buf;
+	struct sk_buff_head aggr_skbs;
+	uint32_t aggr_ch_mask;
 };
 
+/* logical channel of an skb held in an uplink aggregate */
+#define BAM_DMUX_SKB_CH(skb)	(*(uint32_t *)((skb)->cb))
+
 struct rx_pkt_info {
-	struct sk_buff *skb;
+	struct page *page;
 	dma_addr_t dma_address;
+	int pooled;
 	struct work_struct work;
 	struct list_head list_node;
 };
@@ -147,6 +184,17 @@ struct rx_pkt_info {
 #define A2_PHYS_SIZE		0x2000
 #define BUFFER_SIZE		2048
 #define NUM_BUFFERS		32
+
+/*
+ * RX buffers are pages that are mapped for DMA once and kept on
+ * bam_rx_buf_free while not posted.  A completed buffer becomes the head
+ * of its skb through build_skb() while the pool keeps its own page
+ * reference, so the buffer is posted again without remapping once the
+ * client has freed the skb.  Buffers needed while all RX_POOL_SIZE pool
+ * pages are still held by clients are one-shot and unmapped on completion.
+ */
+#define RX_POOL_SIZE		(2 * NUM_BUFFERS)
+#define RX_BUF_HEADROOM		NET_SKB_PAD
 static struct sps_bam_props a2_props;
 static u32 a2_device_handle;
 static struct sps_pipe *bam_tx_pipe;
@@ -162,12 +210,18 @@ static struct bam_ch_info bam_ch[BAM_DMUX_NUM_CHANNELS];
 static int bam_mux_initialized;
 
 static int polling_mode;
+static void (*rx_poll_schedule)(void);
 
 static LIST_HEAD(bam_rx_pool);
-static DEFINE_MUTEX(bam_rx_pool_mutexlock);
+static DEFINE_SPINLOCK(bam_rx_pool_spinlock);
 static int bam_rx_pool_len;
+static LIST_HEAD(bam_rx_buf_free);
+static int bam_rx_buf_cnt;
 static LIST_HEAD(bam_tx_pool);
 static DEFINE_SPINLOCK(bam_tx_pool_spinlock);
+static struct tx_pkt_info *ul_aggr_pkt;
+static DEFINE_SPINLOCK(ul_aggr_lock);
+static struct hrtimer ul_aggr_timer;
 static DEFINE_MUTEX(bam_pdev_mutexlock);
 
 struct bam_mux_hdr {
@@ -181,10 +235,16 @@ struct bam_mux_hdr {
 
 static void notify_all(int event, unsigned long data);
 static void bam_mux_write_done(struct work_struct *work);
+static void ul_aggr_flush(void);
 static void handle_bam_mux_cmd(struct work_struct *work);
 static void rx_timer_work_func(struct work_struct *work);
+static void queue_rx_work_func(struct work_struct *work);
+static void rx_cmd_work_func(struct work_struct *work);
 
 static DECLARE_WORK(rx_timer_work, rx_timer_work_func);
+static DECLARE_WORK(queue_rx_work, queue_rx_work_func);
+static DECLARE_WORK(rx_cmd_work, rx_cmd_work_func);
+static struct sk_buff_head bam_mux_rx_cmd_q;
 
 static struct workqueue_struct *bam_mux_rx_workqueue;
 static struct workqueue_struct *bam_mux_tx_workqueue;
@@ -368,45 +428,162 @@ static inline void verify_tx_queue_is_empty(const char *func)
 	spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
 }
 
-static void queue_rx(void)
+static struct rx_pkt_info *rx_buf_get(gfp_t gfp)
+{
+	struct rx_pkt_info *info;
+	unsigned long flags;
+	int pooled;
+
+	BUILD_BUG_ON(RX_BUF_HEADROOM + BUFFER_SIZE +
+		SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) > PAGE_SIZE);
+
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+	list_for_each_entry(info, &bam_rx_buf_free, list_node) {
+		/* only the pool reference is left once the skb is freed */
+		if (page_count(info->page) == 1) {
+			list_del(&info->list_node);
+			spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+			dma_sync_single_for_device(NULL, info->dma_address,
+					BUFFER_SIZE, DMA_FROM_DEVICE);
+			return info;
+		}
+	}
+	pooled = bam_rx_buf_cnt < RX_POOL_SIZE;
+	if (pooled)
+		++bam_rx_buf_cnt;
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+
+	info = kmalloc(sizeof(struct rx_pkt_info), gfp);
+	if (!info) {
+		pr_err("%s: unable to alloc rx_pkt_info\n", __func__);
+		goto fail;
+	}
+
+	info->page = alloc_page(gfp);
+	if (!info->page) {
+		DMUX_LOG_KERR("%s: unable to alloc page\n", __func__);
+		goto fail_info;
+	}
+
+	info->dma_address = dma_map_page(NULL, info->page, RX_BUF_HEADROOM,
+					BUFFER_SIZE, DMA_FROM_DEVICE);
+	if (info->dma_address == 0 || info->dma_address == ~0) {
+		DMUX_LOG_KERR("%s: dma_map_page failure %p for %p\n",
+			__func__, (void *)info->dma_address,
+			page_address(info->page));
+		goto fail_page;
+	}
+
+	info->pooled = pooled;
+	INIT_WORK(&info->work, handle_bam_mux_cmd);
+	return info;
+
+fail_page:
+	__free_page(info->page);
+
+fail_info:
+	kfree(info);
+
+fail:
+	if (pooled) {
+		spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+		--bam_rx_buf_cnt;
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+	}
+	return NULL;
+}
+
+/* return a buffer that was never handed out, bam_rx_pool_spinlock held */
+static void __rx_buf_put(struct rx_pkt_info *info)
+{
+	if (info->pooled) {
+		list_add_tail(&info->list_node, &bam_rx_buf_free);
+		return;
+	}
+
+	dma_unmap_page(NULL, info->dma_address, BUFFER_SIZE, DMA_FROM_DEVICE);
+	__free_page(info->page);
+	kfree(info);
+}
+
+/*
+ * Turn a completed buffer into an skb.  Pooled buffers stay mapped, so
+ * only the part the A2 actually wrote is synced for the CPU.
+ */
+static struct sk_buff *rx_buf_to_skb(struct rx_pkt_info *info)
+{
+	struct bam_mux_hdr *rx_hdr;
+	struct sk_buff *skb;
+	struct page *page = info->page;
+	unsigned long flags;
+	void *data;
+	unsigned len;
+
+	data = page_address(page);
+	rx_hdr = (struct bam_mux_hdr *)(data + RX_BUF_HEADROOM);
+
+	if (info->pooled) {
+		dma_sync_single_range_for_cpu(NULL, info->dma_address, 0,
+				L1_CACHE_BYTES, DMA_FROM_DEVICE);
+		len = min_t(unsigned, BUFFER_SIZE,
+				sizeof(struct bam_mux_hdr) + rx_hdr->pkt_len);
+		if (len > L1_CACHE_BYTES)
+			dma_sync_single_range_for_cpu(NULL, info->dma_address,
+					L1_CACHE_BYTES, len - L1_CACHE_BYTES,
+					DMA_FROM_DEVICE);
+		get_page(page);
+
+		spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+		list_add_tail(&info->list_node, &bam_rx_buf_free);
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+	} else {
+		dma_unmap_page(NULL, info->dma_address, BUFFER_SIZE,
+				DMA_FROM_DEVICE);
+		kfree(info);
+	}
+
+	skb = build_skb(data, PAGE_SIZE);
+	if (!skb) {
+		DMUX_LOG_KERR("%s: unable to build skb\n", __func__);
+		put_page(page);
+		return NULL;
+	}
+	skb_reserve(skb, RX_BUF_HEADROOM);
+	skb_put(skb, BUFFER_SIZE);
+
+	return skb;
+}
+
+/*
+ * Refill the RX pipe up to NUM_BUFFERS.  The rx poll path refills with
+ * GFP_ATOMIC and leaves anything it could not allocate to queue_rx_work.
+ */
+static void __queue_rx(gfp_t gfp)
 {
-	void *ptr;
 	struct rx_pkt_info *info;
 	int ret;
 	int rx_len_cached;
+	unsigned long flags;
 
-	mutex_lock(&bam_rx_pool_mutexlock);
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 	rx_len_cached = bam_rx_pool_len;
-	mutex_unlock(&bam_rx_pool_mutexlock);
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	while (rx_len_cached < NUM_BUFFERS) {
 		if (in_global_reset)
 			goto fail;
 
-		info = kmalloc(sizeof(struct rx_pkt_info), GFP_KERNEL);
-		if (!info) {
-			pr_err("%s: unable to alloc rx_pkt_info\n", __func__);
+		info = rx_buf_get(gfp);
+		if (!info)
 			goto fail;
-		}
 
-		INIT_WORK(&info->work, handle_bam_mux_cmd);
-
-		info->skb = __dev_alloc_skb(BUFFER_SIZE, GFP_KERNEL);
-		if (info->skb == NULL) {
-			DMUX_LOG_KERR("%s: unable to alloc skb\n", __func__);
-			goto fail_info;
-		}
-		ptr = skb_put(info->skb, BUFFER_SIZE);
-
-		info->dma_address = dma_map_single(NULL, ptr, BUFFER_SIZE,
-							DMA_FROM_DEVICE);
-		if (info->dma_address == 0 || info->dma_address == ~0) {
-			DMUX_LOG_KERR("%s: dma_map_single failure %p for %p\n",
-				__func__, (void *)info->dma_address, ptr);
-			goto fail_skb;
+		spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+		if (bam_rx_pool_len >= NUM_BUFFERS) {
+			/* refilled concurrently from the rx poll path */
+			__rx_buf_put(info);
+			spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+			return;
 		}
-
-		mutex_lock(&bam_rx_pool_mutexlock);
 		list_add_tail(&info->list_node, &bam_rx_pool);
 		rx_len_cached = ++bam_rx_pool_len;
 		ret = sps_transfer_one(bam_rx_pipe, info->dma_address,
@@ -415,40 +592,49 @@ static void queue_rx(void)
 		if (ret) {
 			list_del(&info->list_node);
 			rx_len_cached = --bam_rx_pool_len;
-			mutex_unlock(&bam_rx_pool_mutexlock);
+			__rx_buf_put(info);
+			spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 			DMUX_LOG_KERR("%s: sps_transfer_one failed %d\n",
 				__func__, ret);
-
-			dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE,
-						DMA_FROM_DEVICE);
-
-			goto fail_skb;
+			goto fail;
 		}
-		mutex_unlock(&bam_rx_pool_mutexlock);
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	}
 	return;
 
-fail_skb:
-	dev_kfree_skb_any(info->skb);
-
-fail_info:
-	kfree(info);
-
 fail:
+	if (!(gfp & __GFP_WAIT) && !in_global_reset) {
+		queue_work(bam_mux_rx_workqueue, &queue_rx_work);
+		return;
+	}
 	if (rx_len_cached == 0) {
 		DMUX_LOG_KERR("%s: RX queue failure\n", __func__);
 		in_global_reset = 1;
 	}
 }
 
-static void bam_mux_process_data(struct sk_buff *rx_skb)
+static void queue_rx(void)
+{
+	__queue_rx(GFP_KERNEL);
+}
+
+static void queue_rx_work_func(struct work_struct *work)
+{
+	queue_rx();
+}
+
+static void __bam_mux_process_data(struct sk_buff *rx_skb, int from_poll)
 {
 	unsigned long flags;
 	struct bam_mux_hdr *rx_hdr;
 	unsigned long event_data;
+	uint8_t ch_id;
+	void (*notify)(void *, int, unsigned long);
+	void *priv;
 
 	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
+	ch_id = rx_hdr->ch_id;
 
 	rx_skb->data = (unsigned char *)(rx_hdr + 1);
 	rx_skb->tail = rx_skb->data + rx_hdr->pkt_len;
@@ -457,15 +643,30 @@ static void bam_mux_process_data(struct sk_buff *rx_skb)
 
 	event_data = (unsigned long)(rx_skb);
 
-	spin_lock_irqsave(&bam_ch[rx_hdr->ch_id].lock, flags);
-	if (bam_ch[rx_hdr->ch_id].notify)
-		bam_ch[rx_hdr->ch_id].notify(
-			bam_ch[rx_hdr->ch_id].priv, BAM_DMUX_RECEIVE,
+	spin_lock_irqsave(&bam_ch[ch_id].lock, flags);
+	if (from_poll && bam_ch[ch_id].rx_poll && bam_ch[ch_id].notify) {
+		notify = bam_ch[ch_id].notify;
+		priv = bam_ch[ch_id].priv;
+		spin_unlock_irqrestore(&bam_ch[ch_id].lock, flags);
+		/*
+		 * no channel lock here, the client passes the packet straight
+		 * up the stack which may transmit on this channel in turn
+		 */
+		notify(priv, BAM_DMUX_RECEIVE_POLL, event_data);
+		return;
+	}
+	if (bam_ch[ch_id].notify)
+		bam_ch[ch_id].notify(
+			bam_ch[ch_id].priv, BAM_DMUX_RECEIVE,
 							event_data);
 	else
 		dev_kfree_skb_any(rx_skb);
-	spin_unlock_irqrestore(&bam_ch[rx_hdr->ch_id].lock, flags);
+	spin_unlock_irqrestore(&bam_ch[ch_id].lock, flags);
+}
 
+static void bam_mux_process_data(struct sk_buff *rx_skb)
+{
+	__bam_mux_process_data(rx_skb, 0);
 	queue_rx();
 }
 
@@ -494,17 +695,10 @@ static inline void handle_bam_mux_cmd_open(struct bam_mux_hdr *rx_hdr)
 	queue_rx();
 }
 
-static void handle_bam_mux_cmd(struct work_struct *work)
+static void __handle_bam_mux_cmd(struct sk_buff *rx_skb)
 {
 	unsigned long flags;
 	struct bam_mux_hdr *rx_hdr;
-	struct rx_pkt_info *info;
-	struct sk_buff *rx_skb;
-
-	info = container_of(work, struct rx_pkt_info, work);
-	rx_skb = info->skb;
-	dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE, DMA_FROM_DEVICE);
-	kfree(info);
 
 	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
 
@@ -596,6 +790,30 @@ static void handle_bam_mux_cmd(struct work_struct *work)
 	}
 }
 
+static void handle_bam_mux_cmd(struct work_struct *work)
+{
+	struct rx_pkt_info *info;
+	struct sk_buff *rx_skb;
+
+	info = container_of(work, struct rx_pkt_info, work);
+	rx_skb = rx_buf_to_skb(info);
+	if (!rx_skb) {
+		queue_rx();
+		return;
+	}
+
+	__handle_bam_mux_cmd(rx_skb);
+}
+
+/* frames the rx poll path cannot handle in softirq context */
+static void rx_cmd_work_func(struct work_struct *work)
+{
+	struct sk_buff *rx_skb;
+
+	while ((rx_skb = skb_dequeue(&bam_mux_rx_cmd_q)))
+		__handle_bam_mux_cmd(rx_skb);
+}
+
 static int bam_mux_write_cmd(void *data, uint32_t len)
 {
 	int rc;
@@ -622,8 +840,11 @@ static int bam_mux_write_cmd(void *data, uint32_t len)
 	pkt->len = len;
 	pkt->dma_address = dma_address;
 	pkt->is_cmd = 1;
+	pkt->is_aggr = 0;
 	set_tx_timestamp(pkt);
 	INIT_WORK(&pkt->work, bam_mux_write_done);
+	/* commands must not overtake data still sitting in an aggregate */
+	ul_aggr_flush();
 	spin_lock_irqsave(&bam_tx_pool_spinlock, flags);
 	list_add_tail(&pkt->list_node, &bam_tx_pool);
 	rc = sps_transfer_one(bam_tx_pipe, dma_address, len,
@@ -646,6 +867,200 @@ static int bam_mux_write_cmd(void *data, uint32_t len)
 	return rc;
 }
 
+static void ul_aggr_free(struct tx_pkt_info *pkt)
+{
+	skb_queue_purge(&pkt->aggr_skbs);
+	kfree(pkt->aggr_buf);
+	kfree(pkt);
+}
+
+static void ul_aggr_write_done(struct tx_pkt_info *pkt)
+{
+	struct sk_buff *skb;
+	unsigned long flags;
+	uint32_t id;
+
+	DBG_INC_WRITE_CNT(pkt->len);
+	kfree(pkt->aggr_buf);
+
+	for (id = 0; id < BAM_DMUX_NUM_CHANNELS; ++id) {
+		if (!(pkt->aggr_ch_mask & (1 << id)))
+			continue;
+		spin_lock_irqsave(&bam_ch[id].lock, flags);
+		bam_ch[id].num_tx_pkts--;
+		spin_unlock_irqrestore(&bam_ch[id].lock, flags);
+	}
+
+	while ((skb = __skb_dequeue(&pkt->aggr_skbs))) {
+		id = BAM_DMUX_SKB_CH(skb);
+		if (bam_ch[id].notify)
+			bam_ch[id].notify(bam_ch[id].priv,
+					BAM_DMUX_WRITE_DONE,
+					(unsigned long)(skb));
+		else
+			dev_kfree_skb_any(skb);
+	}
+	kfree(pkt);
+}
+
+/*
+ * Queue the open uplink aggregate to the BAM.
+ *
+ * @note:  Must be called with ul_aggr_lock locked.
+ */
+static void __ul_aggr_flush(void)
+{
+	struct tx_pkt_info *pkt = ul_aggr_pkt;
+	unsigned long flags;
+	uint32_t id;
+	int rc;
+
+	if (!pkt)
+		return;
+	ul_aggr_pkt = NULL;
+	hrtimer_try_to_cancel(&ul_aggr_timer);
+
+	pkt->dma_address = dma_map_single(NULL, pkt->aggr_buf, pkt->len,
+						DMA_TO_DEVICE);
+	if (!pkt->dma_address) {
+		pr_err("%s: dma_map_single() failed\n", __func__);
+		ul_aggr_free(pkt);
+		return;
+	}
+
+	set_tx_timestamp(pkt);
+	spin_lock_irqsave(&bam_tx_pool_spinlock, flags);
+	list_add_tail(&pkt->list_node, &bam_tx_pool);
+	rc = sps_transfer_one(bam_tx_pipe, pkt->dma_address, pkt->len,
+				pkt, SPS_IOVEC_FLAG_INT | SPS_IOVEC_FLAG_EOT);
+	if (rc) {
+		DMUX_LOG_KERR("%s sps_transfer_one failed rc=%d\n",
+			__func__, rc);
+		list_del(&pkt->list_node);
+		DBG_INC_TX_SPS_FAILURE_CNT();
+		spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
+		dma_unmap_single(NULL, pkt->dma_address, pkt->len,
+					DMA_TO_DEVICE);
+		ul_aggr_free(pkt);
+		return;
+	}
+	spin_unlock_irqrestore(&bam_tx_pool_spinlock, flags);
+
+	DBG_INC_UL_AGGR_CNT(skb_queue_len(&pkt->aggr_skbs));
+	for (id = 0; id < BAM_DMUX_NUM_CHANNELS; ++id) {
+		if (!(pkt->aggr_ch_mask & (1 << id)))
+			continue;
+		spin_lock_irqsave(&bam_ch[id].lock, flags);
+		bam_ch[id].num_tx_pkts++;
+		spin_unlock_irqrestore(&bam_ch[id].lock, flags);
+	}
+}
+
+static void ul_aggr_flush(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ul_aggr_lock, flags);
+	__ul_aggr_flush();
+	spin_unlock_irqrestore(&ul_aggr_lock, flags);
+}
+
+void msm_bam_dmux_ul_flush(void)
+{
+	read_lock(&ul_wakeup_lock);
+	if (bam_is_connected && !in_global_reset)
+		ul_aggr_flush();
+	read_unlock(&ul_wakeup_lock);
+}
+
+static enum hrtimer_restart ul_aggr_timer_func(struct hrtimer *timer)
+{
+	msm_bam_dmux_ul_flush();
+
+	return HRTIMER_NORESTART;
+}
+
+static inline int ul_aggr_eligible(struct sk_buff *skb)
+{
+	int size = ACCESS_ONCE(ul_aggr_size);
+
+	return size > 0 && skb->len <= ul_aggr_max_pkt &&
+		ALIGN(sizeof(struct bam_mux_hdr) + skb->len, 4) <=
+			min(size, UL_AGGR_MAX_SIZE);
+}
+
+/*
+ * Copy a data packet into the open uplink aggregate.
+ *
+ * @note:  Must be called with ul_wakeup_lock locked.
+ */
+static int bam_mux_write_aggr(uint32_t id, struct sk_buff *skb)
+{
+	struct tx_pkt_info *pkt;
+	struct bam_mux_hdr *hdr;
+	unsigned long flags;
+	uint32_t frame_len;
+	int size = min(ACCESS_ONCE(ul_aggr_size), UL_AGGR_MAX_SIZE);
+
+	frame_len = ALIGN(sizeof(struct bam_mux_hdr) + skb->len, 4);
+
+	spin_lock_irqsave(&ul_aggr_lock, flags);
+	if (ul_aggr_pkt && ul_aggr_pkt->len + frame_len > size)
+		__ul_aggr_flush();
+
+	if (!ul_aggr_pkt) {
+		pkt = kmalloc(sizeof(struct tx_pkt_info), GFP_ATOMIC);
+		if (pkt == NULL) {
+			spin_unlock_irqrestore(&ul_aggr_lock, flags);
+			pr_err("%s: mem alloc for tx_pkt_info failed\n",
+				__func__);
+			return -ENOMEM;
+		}
+		pkt->aggr_buf = kmalloc(size, GFP_ATOMIC);
+		if (pkt->aggr_buf == NULL) {
+			spin_unlock_irqrestore(&ul_aggr_lock, flags);
+			pr_err("%s: mem alloc for aggregate failed\n",
+				__func__);
+			kfree(pkt);
+			return -ENOMEM;
+		}
+		pkt->skb = NULL;
+		pkt->is_cmd = 0;
+		pkt->is_aggr = 1;
+		pkt->len = 0;
+		pkt->aggr_ch_mask = 0;
+		skb_queue_head_init(&pkt->aggr_skbs);
+		INIT_WORK(&pkt->work, bam_mux_write_done);
+		ul_aggr_pkt = pkt;
+		hrtimer_start(&ul_aggr_timer,
+			ns_to_ktime(ul_aggr_timeout_us * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+	}
+	pkt = ul_aggr_pkt;
+
+	hdr = (struct bam_mux_hdr *)(pkt->aggr_buf + pkt->len);
+	hdr->magic_num = BAM_MUX_HDR_MAGIC_NO;
+	hdr->cmd = BAM_MUX_HDR_CMD_DATA;
+	hdr->reserved = 0;
+	hdr->ch_id = id;
+	hdr->pkt_len = skb->len;
+	hdr->pad_len = frame_len - (sizeof(struct bam_mux_hdr) + skb->len);
+	skb_copy_bits(skb, 0, hdr + 1, skb->len);
+	memset((char *)(hdr + 1) + skb->len, 0, hdr->pad_len);
+
+	pkt->len += frame_len;
+	pkt->aggr_ch_mask |= 1 << id;
+	BAM_DMUX_SKB_CH(skb) = id;
+	__skb_queue_tail(&pkt->aggr_skbs, skb);
+
+	/* no room left for even a minimal frame */
+	if (pkt->len + sizeof(struct bam_mux_hdr) + 4 > size)
+		__ul_aggr_flush();
+	spin_unlock_irqrestore(&ul_aggr_lock, flags);
+
+	return 0;
+}
+
 static void bam_mux_write_done(struct work_struct *work)
 {
 	struct sk_buff *skb;
@@ -689,6 +1104,10 @@ static void bam_mux_write_done(struct work_struct *work)
 		kfree(info);
 		return;
 	}
+	if (info->is_aggr) {
+		ul_aggr_write_done(info);
+		return;
+	}
 	skb = info->skb;
 	kfree(info);
 	hdr = (struct bam_mux_hdr *)skb->data;
@@ -747,6 +1166,13 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 		notify_all(BAM_DMUX_UL_CONNECTED, (unsigned long)(NULL));
 	}
 
+	if (ul_aggr_eligible(skb)) {
+		rc = bam_mux_write_aggr(id, skb);
+		ul_packet_written = 1;
+		read_unlock(&ul_wakeup_lock);
+		return rc;
+	}
+
 	/* if skb do not have any tailroom for padding,
 	   copy the skb into a new expanded skb */
 	if ((skb->len & 0x3) && (skb_tailroom(skb) < (4 - (skb->len & 0x3)))) {
@@ -795,8 +1221,11 @@ int msm_bam_dmux_write(uint32_t id, struct sk_buff *skb)
 	pkt->skb = skb;
 	pkt->dma_address = dma_address;
 	pkt->is_cmd = 0;
+	pkt->is_aggr = 0;
 	set_tx_timestamp(pkt);
 	INIT_WORK(&pkt->work, bam_mux_write_done);
+	/* keep packet order with anything still waiting in an aggregate */
+	ul_aggr_flush();
 	spin_lock_irqsave(&bam_tx_pool_spinlock, flags);
 	list_add_tail(&pkt->list_node, &bam_tx_pool);
 	rc = sps_transfer_one(bam_tx_pipe, dma_address, skb->len,
@@ -929,6 +1358,7 @@ int msm_bam_dmux_close(uint32_t id)
 	spin_lock_irqsave(&bam_ch[id].lock, flags);
 	bam_ch[id].notify = NULL;
 	bam_ch[id].priv = NULL;
+	bam_ch[id].rx_poll = 0;
 	bam_ch[id].status &= ~BAM_CH_LOCAL_OPEN;
 	spin_unlock_irqrestore(&bam_ch[id].lock, flags);
 
@@ -1002,6 +1432,43 @@ int msm_bam_dmux_is_ch_low(uint32_t id)
 	return ret;
 }
 
+/*
+ * Take the rx pool entry for a completed iovec off the pool.  Returns NULL
+ * if the pool is empty.
+ */
+static struct rx_pkt_info *bam_rx_pool_get(struct sps_iovec *iov)
+{
+	struct rx_pkt_info *info;
+	unsigned long flags;
+
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
+	if (unlikely(list_empty(&bam_rx_pool))) {
+		DMUX_LOG_KERR("%s: have iovec %p but rx pool empty\n",
+			__func__, (void *)iov->addr);
+		spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+		return NULL;
+	}
+	info = list_first_entry(&bam_rx_pool, struct rx_pkt_info, list_node);
+	if (info->dma_address != iov->addr) {
+		DMUX_LOG_KERR("%s: iovec %p != dma %p\n",
+			__func__,
+			(void *)iov->addr,
+			(void *)info->dma_address);
+		list_for_each_entry(info, &bam_rx_pool, list_node) {
+			DMUX_LOG_KERR("%s: dma %p\n", __func__,
+				(void *)info->dma_address);
+			if (iov->addr == info->dma_address)
+				break;
+		}
+	}
+	BUG_ON(info->dma_address != iov->addr);
+	list_del(&info->list_node);
+	--bam_rx_pool_len;
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
+
+	return info;
+}
+
 static void rx_switch_to_interrupt_mode(void)
 {
 	struct sps_connect cur_rx_conn;
@@ -1047,31 +1514,9 @@ static void rx_switch_to_interrupt_mode(void)
 		if (iov.addr == 0)
 			break;
 
-		mutex_lock(&bam_rx_pool_mutexlock);
-		if (unlikely(list_empty(&bam_rx_pool))) {
-			DMUX_LOG_KERR("%s: have iovec %p but rx pool empty\n",
-				__func__, (void *)iov.addr);
-			mutex_unlock(&bam_rx_pool_mutexlock);
+		info = bam_rx_pool_get(&iov);
+		if (!info)
 			continue;
-		}
-		info = list_first_entry(&bam_rx_pool, struct rx_pkt_info,
-							list_node);
-		if (info->dma_address != iov.addr) {
-			DMUX_LOG_KERR("%s: iovec %p != dma %p\n",
-				__func__,
-				(void *)iov.addr,
-				(void *)info->dma_address);
-			list_for_each_entry(info, &bam_rx_pool, list_node) {
-				DMUX_LOG_KERR("%s: dma %p\n", __func__,
-					(void *)info->dma_address);
-				if (iov.addr == info->dma_address)
-					break;
-			}
-		}
-		BUG_ON(info->dma_address != iov.addr);
-		list_del(&info->list_node);
-		--bam_rx_pool_len;
-		mutex_unlock(&bam_rx_pool_mutexlock);
 		handle_bam_mux_cmd(&info->work);
 	}
 	return;
@@ -1103,34 +1548,18 @@ static void rx_timer_work_func(struct work_struct *work)
 			if (iov.addr == 0)
 				break;
 			inactive_cycles = 0;
-			mutex_lock(&bam_rx_pool_mutexlock);
-			if (unlikely(list_empty(&bam_rx_pool))) {
-				DMUX_LOG_KERR(
-					"%s: have iovec %p but rx pool empty\n",
-					__func__, (void *)iov.addr);
-				mutex_unlock(&bam_rx_pool_mutexlock);
+			info = bam_rx_pool_get(&iov);
+			if (!info)
 				continue;
-			}
-			info = list_first_entry(&bam_rx_pool,
-					struct rx_pkt_info,	list_node);
-			if (info->dma_address != iov.addr) {
-				DMUX_LOG_KERR("%s: iovec %p != dma %p\n",
-					__func__,
-					(void *)iov.addr,
-					(void *)info->dma_address);
-				list_for_each_entry(info, &bam_rx_pool,
-						list_node) {
-					DMUX_LOG_KERR("%s: dma %p\n", __func__,
-						(void *)info->dma_address);
-					if (iov.addr == info->dma_address)
-						break;
-				}
-			}
-			BUG_ON(info->dma_address != iov.addr);
-			list_del(&info->list_node);
-			--bam_rx_pool_len;
-			mutex_unlock(&bam_rx_pool_mutexlock);
 			handle_bam_mux_cmd(&info->work);
+
+			/* traffic is back, hand the pipe to the poll client */
+			if (rx_poll_schedule) {
+				local_bh_disable();
+				rx_poll_schedule();
+				local_bh_enable();
+				return;
+			}
 		}
 
 		if (inactive_cycles == POLLING_INACTIVITY) {
@@ -1142,6 +1571,97 @@ static void rx_timer_work_func(struct work_struct *work)
 	}
 }
 
+static void bam_mux_rx_poll_one(struct rx_pkt_info *info)
+{
+	struct bam_mux_hdr *rx_hdr;
+	struct sk_buff *rx_skb;
+
+	rx_skb = rx_buf_to_skb(info);
+	if (!rx_skb)
+		return;
+
+	rx_hdr = (struct bam_mux_hdr *)rx_skb->data;
+	if (likely(rx_hdr->magic_num == BAM_MUX_HDR_MAGIC_NO &&
+		   rx_hdr->ch_id < BAM_DMUX_NUM_CHANNELS &&
+		   rx_hdr->cmd == BAM_MUX_HDR_CMD_DATA)) {
+		DBG_INC_READ_CNT(sizeof(struct bam_mux_hdr) + rx_hdr->pkt_len);
+		__bam_mux_process_data(rx_skb, 1);
+		return;
+	}
+
+	/* commands and invalid frames may sleep, defer them */
+	skb_queue_tail(&bam_mux_rx_cmd_q, rx_skb);
+	queue_work(bam_mux_rx_workqueue, &rx_cmd_work);
+}
+
+int msm_bam_dmux_rx_poll(int budget)
+{
+	struct sps_iovec iov;
+	struct rx_pkt_info *info;
+	int done = 0;
+	int ret;
+
+	while (done < budget) {
+		if (!bam_connection_is_active || in_global_reset)
+			break;
+
+		ret = sps_get_iovec(bam_rx_pipe, &iov);
+		if (ret) {
+			pr_err("%s: sps_get_iovec failed %d\n", __func__, ret);
+			break;
+		}
+		if (iov.addr == 0)
+			break;
+
+		info = bam_rx_pool_get(&iov);
+		if (!info)
+			continue;
+		bam_mux_rx_poll_one(info);
+		++done;
+	}
+
+	if (done)
+		__queue_rx(GFP_ATOMIC);
+
+	return done;
+}
+EXPORT_SYMBOL(msm_bam_dmux_rx_poll);
+
+void msm_bam_dmux_rx_poll_complete(void)
+{
+	/*
+	 * keep polling from the rx timer until the pipe has been idle long
+	 * enough to switch back to interrupt mode
+	 */
+	queue_work_on(0, bam_mux_rx_workqueue, &rx_timer_work);
+}
+EXPORT_SYMBOL(msm_bam_dmux_rx_poll_complete);
+
+int msm_bam_dmux_reg_rx_poll(uint32_t id, void (*schedule)(void))
+{
+	unsigned long flags;
+	int rc = 0;
+
+	if (id >= BAM_DMUX_NUM_CHANNELS || !schedule)
+		return -EINVAL;
+	if (!bam_mux_initialized)
+		return -ENODEV;
+
+	spin_lock_irqsave(&bam_ch[id].lock, flags);
+	if (!bam_ch_is_local_open(id)) {
+		rc = -ENODEV;
+	} else if (rx_poll_schedule && rx_poll_schedule != schedule) {
+		rc = -EBUSY;
+	} else {
+		rx_poll_schedule = schedule;
+		bam_ch[id].rx_poll = 1;
+	}
+	spin_unlock_irqrestore(&bam_ch[id].lock, flags);
+
+	return rc;
+}
+EXPORT_SYMBOL(msm_bam_dmux_reg_rx_poll);
+
 static void bam_mux_tx_notify(struct sps_event_notify *notify)
 {
 	struct tx_pkt_info *pkt;
@@ -1154,7 +1674,7 @@ static void bam_mux_tx_notify(struct sps_event_notify *notify)
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
 		pkt = notify->data.transfer.user;
-		if (!pkt->is_cmd)
+		if (!pkt->is_cmd && !pkt->is_aggr)
 			dma_unmap_single(NULL, pkt->dma_address,
 						pkt->skb->len,
 						DMA_TO_DEVICE);
@@ -1200,6 +1720,10 @@ static void bam_mux_rx_notify(struct sps_event_notify *notify)
 			}
 			grab_wakelock();
 			polling_mode = 1;
+			if (rx_poll_schedule) {
+				rx_poll_schedule();
+				break;
+			}
 			/*
 			 * run on core 0 so that netif_rx() in rmnet uses only
 			 * one queue
@@ -1254,12 +1778,18 @@ static int debug_stats(char *buf, int max)
 			"skb copy bytes:  %u\n"
 			"sps tx failures: %u\n"
 			"sps tx stalls:   %u\n"
-			"rx queue len:    %d\n",
+			"rx queue len:    %d\n"
+			"rx pool bufs:    %d\n"
+			"ul aggregates:   %u\n"
+			"ul aggr pkts:    %u\n",
 			bam_dmux_write_cpy_cnt,
 			bam_dmux_write_cpy_bytes,
 			bam_dmux_tx_sps_failure_cnt,
 			bam_dmux_tx_stall_cnt,
-			bam_rx_pool_len
+			bam_rx_pool_len,
+			bam_rx_buf_cnt,
+			bam_dmux_ul_aggr_cnt,
+			bam_dmux_ul_aggr_pkts
 			);
 
 	return i;
@@ -1518,6 +2048,13 @@ static void ul_timeout(struct work_struct *work)
 		return;
 	}
 	if (bam_is_connected) {
+		spin_lock(&ul_aggr_lock);
+		if (ul_aggr_pkt) {
+			__ul_aggr_flush();
+			ul_packet_written = 1;
+		}
+		spin_unlock(&ul_aggr_lock);
+
 		if (!ul_packet_written) {
 			spin_lock(&bam_tx_pool_spinlock);
 			if (!list_empty(&bam_tx_pool)) {
@@ -1697,18 +2234,15 @@ static void disconnect_to_bam(void)
 	__memzero(rx_desc_mem_buf.base, rx_desc_mem_buf.size);
 	__memzero(tx_desc_mem_buf.base, tx_desc_mem_buf.size);
 
-	mutex_lock(&bam_rx_pool_mutexlock);
+	spin_lock_irqsave(&bam_rx_pool_spinlock, flags);
 	while (!list_empty(&bam_rx_pool)) {
 		node = bam_rx_pool.next;
 		list_del(node);
 		info = container_of(node, struct rx_pkt_info, list_node);
-		dma_unmap_single(NULL, info->dma_address, BUFFER_SIZE,
-							DMA_FROM_DEVICE);
-		dev_kfree_skb_any(info->skb);
-		kfree(info);
+		__rx_buf_put(info);
 	}
 	bam_rx_pool_len = 0;
-	mutex_unlock(&bam_rx_pool_mutexlock);
+	spin_unlock_irqrestore(&bam_rx_pool_spinlock, flags);
 
 	if (disconnect_ack)
 		toggle_apps_ack();
@@ -1836,12 +2370,27 @@ static int restart_notifier_cb(struct notifier_block *this,
 	mutex_unlock(&bam_pdev_mutexlock);
 
 	/* Cleanup pending UL data */
+	spin_lock_irqsave(&ul_aggr_lock, flags);
+	if (ul_aggr_pkt) {
+		hrtimer_try_to_cancel(&ul_aggr_timer);
+		ul_aggr_free(ul_aggr_pkt);
+		ul_aggr_pkt = NULL;
+	}
+	spin_unlock_irqrestore(&ul_aggr_lock, flags);
+
 	spin_lock_irqsave(&bam_tx_pool_spinlock, flags);
 	while (!list_empty(&bam_tx_pool)) {
 		node = bam_tx_pool.next;
 		list_del(node);
 		info = container_of(node, struct tx_pkt_info,
 							list_node);
+		if (info->is_aggr) {
+			dma_unmap_single(NULL, info->dma_address,
+						info->len,
+						DMA_TO_DEVICE);
+			ul_aggr_free(info);
+			continue;
+		}
 		if (!info->is_cmd) {
 			dma_unmap_single(NULL, info->dma_address,
 						info->skb->len,
@@ -2170,6 +2719,8 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	if (!bam_mux_rx_workqueue)
 		return -ENOMEM;
 
+	skb_queue_head_init(&bam_mux_rx_cmd_q);
+
 	bam_mux_tx_workqueue = create_singlethread_workqueue("bam_dmux_tx");
 	if (!bam_mux_tx_workqueue) {
 		destroy_workqueue(bam_mux_rx_workqueue);
@@ -2194,6 +2745,8 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	init_completion(&bam_connection_completion);
 	init_completion(&dfab_unvote_completion);
 	INIT_DELAYED_WORK(&ul_timeout_work, ul_timeout);
+	hrtimer_init(&ul_aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ul_aggr_timer.function = ul_aggr_timer_func;
 	INIT_DELAYED_WORK(&msm9615_bam_init_work, msm9615_bam_init);
 	wake_lock_init(&bam_wakelock, WAKE_LOCK_SUSPEND, "bam_dmux_wakelock");
 
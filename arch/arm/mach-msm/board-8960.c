@@ -390,6 +390,15 @@ static struct ion_co_heap_pdata co_ion_pdata = {
 	.mem_is_fmem = 0,
 };
 
+static struct ion_co_heap_pdata audio_co_ion_pdata = {
+	.adjacent_mem_id = INVALID_HEAP_ID,
+	.align = PAGE_SIZE,
+	.mem_is_fmem = 0,
+#ifdef CONFIG_CMA
+	.movable = 1,
+#endif
+};
+
 static struct ion_co_heap_pdata fw_co_ion_pdata = {
 	.adjacent_mem_id = ION_CP_MM_HEAP_ID,
 	.align = SZ_128K,
@@ -471,7 +480,7 @@ static struct ion_platform_data ion_pdata = {
 			.name	= ION_AUDIO_HEAP_NAME,
 			.size	= MSM_ION_AUDIO_SIZE,
 			.memory_type = ION_EBI_TYPE,
-			.extra_data = (void *) &co_ion_pdata,
+			.extra_data = (void *) &audio_co_ion_pdata,
 		},
 #endif
 	}
@@ -600,6 +609,7 @@ static void __init reserve_ion_memory(void)
 		if (heap->extra_data) {
 			int fixed_position = NOT_FIXED;
 			int mem_is_fmem = 0;
+			int movable = 0;
 
 			switch (heap->type) {
 			case ION_HEAP_TYPE_CP:
@@ -620,6 +630,8 @@ static void __init reserve_ion_memory(void)
 					heap->extra_data)->fixed_position;
 				adjacent_mem_id = ((struct ion_co_heap_pdata *)
 					heap->extra_data)->adjacent_mem_id;
+				movable = ((struct ion_co_heap_pdata *)
+					heap->extra_data)->movable;
 				break;
 			default:
 				break;
@@ -636,6 +648,18 @@ static void __init reserve_ion_memory(void)
 			if (mem_is_fmem && adjacent_mem_id != INVALID_HEAP_ID)
 				fmem_pdata.align = align;
 
+			/*
+			 * Movable heaps are lent to the page allocator while
+			 * unused, they need whole pageblocks of their own.
+			 */
+			if (movable && fixed_position == NOT_FIXED) {
+				heap->size = ALIGN(heap->size,
+						   PAGE_SIZE << pageblock_order);
+				heap->base =
+					reserve_memory_for_movable(heap->size);
+				continue;
+			}
+
 			if (fixed_position != NOT_FIXED)
 				fixed_size += heap->size;
 			else
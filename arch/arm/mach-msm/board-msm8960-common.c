@@ -782,9 +782,20 @@ static struct platform_device android_pmem_adsp_device = {
 };
 #endif
 
+/* With the ION audio heap around, pmem_audio allocates from it */
+#if defined(CONFIG_ION_MSM) && defined(CONFIG_MSM_MULTIMEDIA_USE_ION) && \
+	!defined(CONFIG_KERNEL_PMEM_AUDIO_MMI)
+#define MSM_PMEM_AUDIO_ON_ION
+#endif
+
 static struct android_pmem_platform_data android_pmem_audio_pdata = {
 	.name = "pmem_audio",
+#ifdef MSM_PMEM_AUDIO_ON_ION
+	.allocator_type = PMEM_ALLOCATORTYPE_ION,
+	.ion_heap_mask = ION_HEAP(ION_AUDIO_HEAP_ID),
+#else
 	.allocator_type = PMEM_ALLOCATORTYPE_BITMAP,
+#endif
 	.cached = 0,
 	.memory_type = MEMTYPE_EBI1,
 };
@@ -908,7 +919,9 @@ static void __init reserve_pmem_memory(void)
 	reserve_memory_for(&android_pmem_adsp_pdata);
 	reserve_memory_for(&android_pmem_pdata);
 #endif
+#ifndef MSM_PMEM_AUDIO_ON_ION
 	reserve_memory_for(&android_pmem_audio_pdata);
+#endif
 	msm8960_reserve_table[MEMTYPE_EBI1].size += pmem_kernel_ebi1_size;
 #endif
 }
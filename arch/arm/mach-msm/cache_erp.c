@@ -18,6 +18,7 @@
 #include <linux/proc_fs.h>
 #include <linux/cpu.h>
 #include <linux/io.h>
+#include <linux/ratelimit.h>
 #include <mach/msm-krait-l2-accessors.h>
 #include <mach/msm_iomap.h>
 #include <asm/cputype.h>
@@ -55,6 +56,9 @@
 
 #define L2ESR_ACCESS_ERR_MASK	0xFFFC
 
+#define L2ESR_UNCORRECTABLE	(L2ESR_MPDCD | L2ESR_MPSLV | L2ESR_TSEDB | \
+				 L2ESR_DSEDB | L2ESR_MSE | L2ESR_MPLDREXNOK)
+
 #define L2ESR_CPU_MASK		0x0F
 #define L2ESR_CPU_SHIFT		16
 
@@ -93,6 +97,20 @@
 #define ERP_LOG_MAGIC_ADDR	0x748
 #define ERP_LOG_MAGIC		0x11C39893
 
+/*
+ * Correctable errors can come in bursts on some parts, and printing each
+ * of them to the console from the interrupt handler costs milliseconds.
+ * Their reports are rate limited, they are always counted. Uncorrectable
+ * errors are always reported.
+ */
+#define ERP_RATELIMIT_INTERVAL	(5 * HZ)
+#define ERP_RATELIMIT_BURST	5
+
+static DEFINE_RATELIMIT_STATE(l1_erp_ratelimit, ERP_RATELIMIT_INTERVAL,
+			      ERP_RATELIMIT_BURST);
+static DEFINE_RATELIMIT_STATE(l2_erp_ratelimit, ERP_RATELIMIT_INTERVAL,
+			      ERP_RATELIMIT_BURST);
+
 struct msm_l1_err_stats {
 	unsigned int dctpe;
 	unsigned int dcdpe;
@@ -101,6 +119,7 @@ struct msm_l1_err_stats {
 	unsigned int dcte;
 	unsigned int icte;
 	unsigned int tlbmh;
+	unsigned int suppressed;
 };
 
 struct msm_l2_err_stats {
@@ -112,6 +131,7 @@ struct msm_l2_err_stats {
 	unsigned int dsedb;
 	unsigned int mse;
 	unsigned int mplxrexnok;
+	unsigned int suppressed;
 };
 
 static DEFINE_PER_CPU(struct msm_l1_err_stats, msm_l1_erp_stats);
@@ -161,7 +181,8 @@ static int proc_read_status(char *page, char **start, off_t off, int count,
 			"\tI-cache data parity errors:\t%u\n"	\
 			"\tD-cache timing errors:\t\t%u\n"	\
 			"\tI-cache timing errors:\t\t%u\n"	\
-			"\tTLB multi-hit errors:\t\t%u\n\n",	\
+			"\tTLB multi-hit errors:\t\t%u\n"	\
+			"\tUnreported errors:\t\t%u\n\n",	\
 			cpu,
 			l1_stats->dctpe,
 			l1_stats->dcdpe,
@@ -169,7 +190,8 @@ static int proc_read_status(char *page, char **start, off_t off, int count,
 			l1_stats->icdpe,
 			l1_stats->dcte,
 			l1_stats->icte,
-			l1_stats->tlbmh);
+			l1_stats->tlbmh,
+			l1_stats->suppressed);
 		p += ret;
 		bytes_left -= ret;
 	}
@@ -182,7 +204,8 @@ static int proc_read_status(char *page, char **start, off_t off, int count,
 			"L2 data soft errors, single-bit:\t%u\n"	\
 			"L2 data soft errors, double-bit:\t%u\n"	\
 			"L2 modified soft errors:\t\t%u\n"		\
-			"L2 master port LDREX NOK errors:\t%u\n",
+			"L2 master port LDREX NOK errors:\t%u\n"	\
+			"L2 unreported errors:\t\t\t%u\n",
 			msm_l2_erp_stats.mpdcd,
 			msm_l2_erp_stats.mpslv,
 			msm_l2_erp_stats.tsesb,
@@ -190,7 +213,8 @@ static int proc_read_status(char *page, char **start, off_t off, int count,
 			msm_l2_erp_stats.dsesb,
 			msm_l2_erp_stats.dsedb,
 			msm_l2_erp_stats.mse,
-			msm_l2_erp_stats.mplxrexnok);
+			msm_l2_erp_stats.mplxrexnok,
+			msm_l2_erp_stats.suppressed);
 
 	len = (p - page) - off;
 	if (len < 0)
@@ -252,14 +276,19 @@ static irqreturn_t msm_l1_erp_irq(int irq, void *dev_id)
 	unsigned int cpu = smp_processor_id();
 	int print_regs = cesr & CESR_PRINT_MASK;
 	int log_event = cesr & CESR_LOG_EVENT_MASK;
+	int report;
 
 	void *const saw_bases[] = {
 		MSM_SAW0_BASE,
 		MSM_SAW1_BASE,
 	};
 
-//	if (print_regs) {
-	if (1) {
+	/* a TLB multi-hit isn't correctable, the rest is */
+	report = (cesr & CESR_TLBMH) || __ratelimit(&l1_erp_ratelimit);
+	if (!report)
+		l1_stats->suppressed++;
+
+	if (report) {
 		pr_alert("L1 / TLB Error detected on CPU %d!\n", cpu);
 		pr_alert("\tCESR      = 0x%08x\n", cesr);
 		pr_alert("\tCPU speed = %lu\n", acpuclk_get_rate(cpu));
@@ -271,32 +300,38 @@ static irqreturn_t msm_l1_erp_irq(int irq, void *dev_id)
 	}
 
 	if (cesr & CESR_DCTPE) {
-		pr_alert("D-cache tag parity error\n");
+		if (report)
+			pr_alert("D-cache tag parity error\n");
 		l1_stats->dctpe++;
 	}
 
 	if (cesr & CESR_DCDPE) {
-		pr_alert("D-cache data parity error\n");
+		if (report)
+			pr_alert("D-cache data parity error\n");
 		l1_stats->dcdpe++;
 	}
 
 	if (cesr & CESR_ICTPE) {
-		pr_alert("I-cache tag parity error\n");
+		if (report)
+			pr_alert("I-cache tag parity error\n");
 		l1_stats->ictpe++;
 	}
 
 	if (cesr & CESR_ICDPE) {
-		pr_alert("I-cache data parity error\n");
+		if (report)
+			pr_alert("I-cache data parity error\n");
 		l1_stats->icdpe++;
 	}
 
 	if (cesr & CESR_DCTE) {
-		pr_alert("D-cache timing error\n");
+		if (report)
+			pr_alert("D-cache timing error\n");
 		l1_stats->dcte++;
 	}
 
 	if (cesr & CESR_ICTE) {
-		pr_alert("I-cache timing error\n");
+		if (report)
+			pr_alert("I-cache timing error\n");
 		l1_stats->icte++;
 	}
 
@@ -308,7 +343,8 @@ static irqreturn_t msm_l1_erp_irq(int irq, void *dev_id)
 
 	if (cesr & (CESR_ICTPE | CESR_ICDPE | CESR_ICTE)) {
 		i_cesynr = read_cesynr();
-		pr_alert("I-side CESYNR = 0x%08x\n", i_cesynr);
+		if (report)
+			pr_alert("I-side CESYNR = 0x%08x\n", i_cesynr);
 		write_cesr(CESR_I_MASK);
 
 		/*
@@ -321,7 +357,8 @@ static irqreturn_t msm_l1_erp_irq(int irq, void *dev_id)
 
 	if (cesr & (CESR_DCTPE | CESR_DCDPE | CESR_DCTE)) {
 		d_cesynr = read_cesynr();
-		pr_alert("D-side CESYNR = 0x%08x\n", d_cesynr);
+		if (report)
+			pr_alert("D-side CESYNR = 0x%08x\n", d_cesynr);
 	}
 
 	if (log_event)
@@ -347,6 +384,7 @@ static irqreturn_t msm_l2_erp_irq(int irq, void *dev_id)
 	int port_error = 0;
 	int unrecoverable = 0;
 	int print_alert;
+	int report;
 
 	l2esr = get_l2_indirect_reg(L2ESR_IND_ADDR);
 	l2esynr0 = get_l2_indirect_reg(L2ESYNR0_IND_ADDR);
@@ -356,6 +394,12 @@ static irqreturn_t msm_l2_erp_irq(int irq, void *dev_id)
 
 	print_alert = print_access_errors() || (l2esr & L2ESR_ACCESS_ERR_MASK);
 
+	report = (l2esr & L2ESR_UNCORRECTABLE) ||
+			__ratelimit(&l2_erp_ratelimit);
+	if (!report)
+		msm_l2_erp_stats.suppressed++;
+	print_alert = print_alert && report;
+
 	if (print_alert) {
 		pr_alert("L2 Error detected!\n");
 		pr_alert("\tL2ESR    = 0x%08x\n", l2esr);
@@ -382,7 +426,8 @@ static irqreturn_t msm_l2_erp_irq(int irq, void *dev_id)
 	}
 
 	if (l2esr & L2ESR_TSESB) {
-		pr_alert("L2 tag soft error, single-bit\n");
+		if (report)
+			pr_alert("L2 tag soft error, single-bit\n");
 		soft_error++;
 		msm_l2_erp_stats.tsesb++;
 	}
@@ -395,7 +440,8 @@ static irqreturn_t msm_l2_erp_irq(int irq, void *dev_id)
 	}
 
 	if (l2esr & L2ESR_DSESB) {
-		pr_alert("L2 data soft error, single-bit\n");
+		if (report)
+			pr_alert("L2 data soft error, single-bit\n");
 		soft_error++;
 		msm_l2_erp_stats.dsesb++;
 	}
@@ -281,7 +281,8 @@ int branch_in_hwcg_mode(const struct branch *b)
 	return !!(readl_relaxed(b->hwcg_reg) & b->hwcg_mask);
 }
 
-void __branch_clk_enable_reg(const struct branch *clk, const char *name)
+/* Set the enable bit of a branch without waiting for it to start. */
+static void __branch_enable_reg(const struct branch *clk)
 {
 	u32 reg_val;
 
@@ -298,7 +299,15 @@ void __branch_clk_enable_reg(const struct branch *clk, const char *name)
 	 * the delay starts after the branch enable.
 	 */
 	mb();
+}
 
+/*
+ * Wait for a branch to start after __branch_enable_reg(). This only reads
+ * the branch's own status, so it doesn't need local_clock_reg_lock as long
+ * as the caller holds the clock's own lock.
+ */
+static void __branch_wait_enabled(const struct branch *clk, const char *name)
+{
 	/* Skip checking halt bit if the clock is in hardware gated mode */
 	if (branch_in_hwcg_mode(clk))
 		return;
@@ -319,8 +328,17 @@ void __branch_clk_enable_reg(const struct branch *clk, const char *name)
 	}
 }
 
-/* Perform any register operations required to enable the clock. */
-static void __rcg_clk_enable_reg(struct rcg_clk *clk)
+void __branch_clk_enable_reg(const struct branch *clk, const char *name)
+{
+	__branch_enable_reg(clk);
+	__branch_wait_enabled(clk, name);
+}
+
+/*
+ * Perform any register operations required to enable the clock, without
+ * waiting for the branch to start.
+ */
+static void __rcg_enable_reg(struct rcg_clk *clk)
 {
 	u32 reg_val;
 	void __iomem *const reg = clk->b.ctl_reg;
@@ -352,11 +370,18 @@ static void __rcg_clk_enable_reg(struct rcg_clk *clk)
 		reg_val |= clk->root_en_mask;
 		writel_relaxed(reg_val, reg);
 	}
-	__branch_clk_enable_reg(&clk->b, clk->c.dbg_name);
+	__branch_enable_reg(&clk->b);
 }
 
-/* Perform any register operations required to disable the branch. */
-u32 __branch_clk_disable_reg(const struct branch *clk, const char *name)
+/* Perform any register operations required to enable the clock. */
+static void __rcg_clk_enable_reg(struct rcg_clk *clk)
+{
+	__rcg_enable_reg(clk);
+	__branch_wait_enabled(&clk->b, clk->c.dbg_name);
+}
+
+/* Clear the enable bit of a branch without waiting for it to stop. */
+static u32 __branch_disable_reg(const struct branch *clk)
 {
 	u32 reg_val;
 
@@ -374,9 +399,15 @@ u32 __branch_clk_disable_reg(const struct branch *clk, const char *name)
 	 */
 	mb();
 
+	return reg_val;
+}
+
+/* Wait for a branch to stop after __branch_disable_reg(). */
+static void __branch_wait_disabled(const struct branch *clk, const char *name)
+{
 	/* Skip checking halt bit if the clock is in hardware gated mode */
 	if (branch_in_hwcg_mode(clk))
-		return reg_val;
+		return;
 
 	/* Wait for clock to disable before continuing. */
 	if (clk->halt_check == DELAY || clk->halt_check == ENABLE_VOTED
@@ -391,6 +422,15 @@ u32 __branch_clk_disable_reg(const struct branch *clk, const char *name)
 			udelay(1);
 		WARN(count == 0, "%s status stuck at 'on'", name);
 	}
+}
+
+/* Perform any register operations required to disable the branch. */
+u32 __branch_clk_disable_reg(const struct branch *clk, const char *name)
+{
+	u32 reg_val;
+
+	reg_val = __branch_disable_reg(clk);
+	__branch_wait_disabled(clk, name);
 
 	return reg_val;
 }
@@ -431,10 +471,13 @@ int rcg_clk_enable(struct clk *c)
 	struct rcg_clk *clk = to_rcg_clk(c);
 
 	spin_lock_irqsave(&local_clock_reg_lock, flags);
-	__rcg_clk_enable_reg(clk);
+	__rcg_enable_reg(clk);
 	clk->enabled = true;
 	spin_unlock_irqrestore(&local_clock_reg_lock, flags);
 
+	/* Don't hold up every other clock while this one starts */
+	__branch_wait_enabled(&clk->b, clk->c.dbg_name);
+
 	return 0;
 }
 
@@ -855,10 +898,13 @@ int branch_clk_enable(struct clk *clk)
 	struct branch_clk *branch = to_branch_clk(clk);
 
 	spin_lock_irqsave(&local_clock_reg_lock, flags);
-	__branch_clk_enable_reg(&branch->b, branch->c.dbg_name);
+	__branch_enable_reg(&branch->b);
 	branch->enabled = true;
 	spin_unlock_irqrestore(&local_clock_reg_lock, flags);
 
+	/* Don't hold up every other clock while this one starts */
+	__branch_wait_enabled(&branch->b, branch->c.dbg_name);
+
 	return 0;
 }
 
@@ -868,9 +914,11 @@ void branch_clk_disable(struct clk *clk)
 	struct branch_clk *branch = to_branch_clk(clk);
 
 	spin_lock_irqsave(&local_clock_reg_lock, flags);
-	__branch_clk_disable_reg(&branch->b, branch->c.dbg_name);
+	__branch_disable_reg(&branch->b);
 	branch->enabled = false;
 	spin_unlock_irqrestore(&local_clock_reg_lock, flags);
+
+	__branch_wait_disabled(&branch->b, branch->c.dbg_name);
 }
 
 struct clk *branch_clk_get_parent(struct clk *clk)
@@ -1048,9 +1096,11 @@ static int cdiv_clk_enable(struct clk *c)
 	struct cdiv_clk *clk = to_cdiv_clk(c);
 
 	spin_lock_irqsave(&local_clock_reg_lock, flags);
-	__branch_clk_enable_reg(&clk->b, clk->c.dbg_name);
+	__branch_enable_reg(&clk->b);
 	spin_unlock_irqrestore(&local_clock_reg_lock, flags);
 
+	__branch_wait_enabled(&clk->b, clk->c.dbg_name);
+
 	return 0;
 }
 
@@ -1060,8 +1110,10 @@ static void cdiv_clk_disable(struct clk *c)
 	struct cdiv_clk *clk = to_cdiv_clk(c);
 
 	spin_lock_irqsave(&local_clock_reg_lock, flags);
-	__branch_clk_disable_reg(&clk->b, clk->c.dbg_name);
+	__branch_disable_reg(&clk->b);
 	spin_unlock_irqrestore(&local_clock_reg_lock, flags);
+
+	__branch_wait_disabled(&clk->b, clk->c.dbg_name);
 }
 
 static int cdiv_clk_set_rate(struct clk *c, unsigned long rate)
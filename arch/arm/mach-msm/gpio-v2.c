@@ -420,21 +420,30 @@ static int msm_gpio_irq_set_type(struct irq_data *d, unsigned int flow_type)
  * It is the job of the summary handler to find all those GPIO lines
  * which have been set as summary IRQ lines and which are triggered,
  * and to call their interrupt handlers.
+ *
+ * Only the status of the lines unmasked in enabled_irqs is read. The bitmap
+ * is walked a word at a time from a snapshot: a few words cover all the
+ * gpios, most of them are zero, and the handlers masking their own line
+ * don't disturb the walk.
  */
 static irqreturn_t msm_summary_irq_handler(int irq, void *data)
 {
-	unsigned long i;
+	unsigned long i, w, enabled;
 	struct irq_desc *desc = irq_to_desc(irq);
 	struct irq_chip *chip = irq_desc_get_chip(desc);
 
 	chained_irq_enter(chip, desc);
 
-	for (i = find_first_bit(msm_gpio.enabled_irqs, NR_MSM_GPIOS);
-	     i < NR_MSM_GPIOS;
-	     i = find_next_bit(msm_gpio.enabled_irqs, NR_MSM_GPIOS, i + 1)) {
-		if (__raw_readl(GPIO_INTR_STATUS(i)) & BIT(INTR_STATUS_BIT))
-			generic_handle_irq(msm_gpio_to_irq(&msm_gpio.gpio_chip,
-							   i));
+	for (w = 0; w < BITS_TO_LONGS(NR_MSM_GPIOS); w++) {
+		enabled = msm_gpio.enabled_irqs[w];
+		while (enabled) {
+			i = w * BITS_PER_LONG + __ffs(enabled);
+			enabled &= enabled - 1;
+			if (__raw_readl(GPIO_INTR_STATUS(i)) &
+					BIT(INTR_STATUS_BIT))
+				generic_handle_irq(msm_gpio_to_irq(
+						&msm_gpio.gpio_chip, i));
+		}
 	}
 
 	chained_irq_exit(chip, desc);
@@ -530,23 +539,23 @@ static int msm_gpio_suspend(void)
 }
 
 extern int msm_show_resume_irq_mask;
+extern void msm_show_resume_irq_record(unsigned int irq);
 
 void msm_gpio_show_resume_irq(void)
 {
 	unsigned long irq_flags;
 	int i, irq, intstat;
 
-	if (!msm_show_resume_irq_mask)
-		return;
-
 	spin_lock_irqsave(&tlmm_lock, irq_flags);
 	for_each_set_bit(i, msm_gpio.wake_irqs, NR_MSM_GPIOS) {
 		intstat = __raw_readl(GPIO_INTR_STATUS(i)) &
 					BIT(INTR_STATUS_BIT);
 		if (intstat) {
 			irq = msm_gpio_to_irq(&msm_gpio.gpio_chip, i);
-			pr_warning("%s: %d triggered\n",
-				__func__, irq);
+			msm_show_resume_irq_record(irq);
+			if (msm_show_resume_irq_mask)
+				pr_warning("%s: %d triggered\n",
+					__func__, irq);
 		}
 	}
 	spin_unlock_irqrestore(&tlmm_lock, irq_flags);
@@ -11,6 +11,8 @@
 #include <linux/errno.h>
 #include <linux/smp.h>
 #include <linux/cpu.h>
+#include <linux/sched.h>
+#include <linux/sysdev.h>
 
 #include <asm/cacheflush.h>
 #include <asm/vfp.h>
@@ -180,3 +182,56 @@ static int __init init_hotplug_notifier(void)
 	return register_hotcpu_notifier(&hotplug_rtb_notifier);
 }
 early_initcall(init_hotplug_notifier);
+
+/*
+ * cpuN/isolate keeps a core online but takes it out of scheduling so it
+ * power collapses in idle. This is reversible in microseconds, against
+ * tens of milliseconds for a whole cpu_down()/cpu_up() cycle.
+ */
+static ssize_t show_isolate(struct sys_device *dev,
+			    struct sysdev_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", sched_cpu_isolated(dev->id));
+}
+
+static ssize_t store_isolate(struct sys_device *dev,
+			     struct sysdev_attribute *attr,
+			     const char *buf, size_t count)
+{
+	unsigned long val;
+	int ret;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val)
+		ret = sched_isolate_cpu(dev->id);
+	else
+		ret = sched_unisolate_cpu(dev->id);
+
+	return ret ? ret : count;
+}
+
+static SYSDEV_ATTR(isolate, 0644, show_isolate, store_isolate);
+
+static int __init init_hotplug_isolate(void)
+{
+	struct sys_device *dev;
+	unsigned int cpu;
+	int ret;
+
+	for_each_possible_cpu(cpu) {
+		/* cpu0 is too special to isolate, as it is to unplug */
+		if (!cpu)
+			continue;
+		dev = get_cpu_sysdev(cpu);
+		if (!dev)
+			continue;
+		ret = sysdev_create_file(dev, &attr_isolate);
+		if (ret)
+			pr_err("%s: cpu%u: %d\n", __func__, cpu, ret);
+	}
+	return 0;
+}
+late_initcall(init_hotplug_isolate);
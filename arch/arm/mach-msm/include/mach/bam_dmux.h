@@ -37,6 +37,7 @@ enum {
 	BAM_DMUX_WRITE_DONE, /* data is struct sk_buff */
 	BAM_DMUX_UL_CONNECTED, /* data is null */
 	BAM_DMUX_UL_DISCONNECTED, /*data is null */
+	BAM_DMUX_RECEIVE_POLL, /* data is struct sk_buff, rx poll context */
 };
 
 /*
@@ -67,6 +68,38 @@ int msm_bam_dmux_ul_power_unvote(void);
 int msm_bam_dmux_is_ch_full(uint32_t id);
 
 int msm_bam_dmux_is_ch_low(uint32_t id);
+
+/*
+ * Send the open uplink aggregate now rather than when its timer expires.
+ * Clients call this once they have no more packets queued, so the last
+ * packet of a burst does not wait out ul_aggr_timeout_us.
+ */
+void msm_bam_dmux_ul_flush(void);
+
+/*
+ * Move downlink processing into the client's NAPI context
+ *     id - an open logical channel; its packets are delivered with
+ *          BAM_DMUX_RECEIVE_POLL from msm_bam_dmux_rx_poll() without any
+ *          bam_dmux lock held, until the channel is closed
+ *     schedule - called from interrupt or process context when the RX pipe
+ *          has data; the client then calls msm_bam_dmux_rx_poll() from its
+ *          poll routine.  All channels must register the same function.
+ *
+ * The RX pipe is shared by all channels, so once registered the poll
+ * routine also drains channels that did not register, which keep getting
+ * BAM_DMUX_RECEIVE as before.
+ */
+int msm_bam_dmux_reg_rx_poll(uint32_t id, void (*schedule)(void));
+
+/*
+ * Process up to budget RX descriptors.  Must be called from softirq
+ * context.  Returns the number processed; when that is less than budget
+ * the pipe is empty and the client calls msm_bam_dmux_rx_poll_complete()
+ * once it has stopped polling.
+ */
+int msm_bam_dmux_rx_poll(int budget);
+
+void msm_bam_dmux_rx_poll_complete(void);
 #else
 int msm_bam_dmux_open(uint32_t id, void *priv,
 		       void (*notify)(void *priv, int event_type,
@@ -109,5 +142,24 @@ int msm_bam_dmux_is_ch_low(uint32_t id)
 {
 	return -ENODEV;
 }
+
+static inline void msm_bam_dmux_ul_flush(void)
+{
+}
+
+static inline int msm_bam_dmux_reg_rx_poll(uint32_t id,
+					   void (*schedule)(void))
+{
+	return -ENODEV;
+}
+
+static inline int msm_bam_dmux_rx_poll(int budget)
+{
+	return 0;
+}
+
+static inline void msm_bam_dmux_rx_poll_complete(void)
+{
+}
 #endif
 #endif /* _BAM_DMUX_H */
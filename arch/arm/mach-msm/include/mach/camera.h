@@ -494,6 +494,8 @@ struct msm_pmem_region {
 	struct file *file;
 	struct msm_pmem_info info;
 	struct ion_handle *handle;
+	/* position among the regions of the same type */
+	int idx;
 };
 
 struct axidata {
@@ -98,6 +98,7 @@ do { \
 #define SL_BUFFERABLE		(1 << 2)
 #define SL_CACHEABLE		(1 << 3)
 #define SL_TEX0			(1 << 6)
+#define SL_TEX0_LARGE		(1 << 12)
 #define SL_OFFSET(va)		(((va) & 0xFF000) >> 12)
 #define SL_NG			(1 << 11)
 
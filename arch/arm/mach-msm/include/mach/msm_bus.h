@@ -76,6 +76,8 @@ struct msm_bus_scale_pdata {
 #ifdef CONFIG_MSM_BUS_SCALING
 uint32_t msm_bus_scale_register_client(struct msm_bus_scale_pdata *pdata);
 int msm_bus_scale_client_update_request(uint32_t cl, unsigned int index);
+int msm_bus_scale_client_update_requests(const uint32_t *cl,
+	const unsigned int *index, int num);
 void msm_bus_scale_unregister_client(uint32_t cl);
 /* AXI Port configuration APIs */
 int msm_bus_axi_porthalt(int master_port);
@@ -94,6 +96,13 @@ msm_bus_scale_client_update_request(uint32_t cl, unsigned int index)
 	return 0;
 }
 
+static inline int
+msm_bus_scale_client_update_requests(const uint32_t *cl,
+	const unsigned int *index, int num)
+{
+	return 0;
+}
+
 static inline void
 msm_bus_scale_unregister_client(uint32_t cl)
 {
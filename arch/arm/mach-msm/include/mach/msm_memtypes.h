@@ -67,4 +67,5 @@ struct reserve_info {
 extern struct reserve_info *reserve_info;
 
 unsigned long __init reserve_memory_for_fmem(unsigned long, unsigned long);
+unsigned long __init reserve_memory_for_movable(unsigned long);
 #endif
@@ -13,6 +13,8 @@
 #ifndef __MSM_RTB_H__
 #define __MSM_RTB_H__
 
+#include <linux/types.h>
+
 /*
  * These numbers are used from the kernel command line and sysfs
  * to control filtering. Remove items from here with extreme caution
@@ -33,16 +35,46 @@ struct msm_rtb_platform_data {
 };
 
 #if defined(CONFIG_MSM_RTB)
+/* Event types being logged, see msm_rtb.c */
+extern uint32_t msm_rtb_active_filter;
+
 /*
- * returns 1 if data was logged, 0 otherwise
+ * Events left out of CONFIG_MSM_RTB_COMPILE_FILTER compile to nothing at
+ * call sites with a constant type, the others cost one load and test
+ * while they are filtered at runtime.
  */
-int uncached_logk_pc(enum logk_event_type log_type, void *caller,
+static inline int msm_rtb_event_enabled(enum logk_event_type log_type)
+{
+	return (CONFIG_MSM_RTB_COMPILE_FILTER & (1U << log_type)) &&
+		(msm_rtb_active_filter & (1U << log_type));
+}
+
+int msm_rtb_event_should_log(enum logk_event_type log_type);
+
+int __uncached_logk_pc(enum logk_event_type log_type, void *caller,
 				void *data);
+int __uncached_logk(enum logk_event_type log_type, void *data);
+
+/*
+ * returns 1 if data was logged, 0 otherwise
+ */
+static inline int uncached_logk_pc(enum logk_event_type log_type,
+				void *caller, void *data)
+{
+	if (!msm_rtb_event_enabled(log_type))
+		return 0;
+	return __uncached_logk_pc(log_type, caller, data);
+}
 
 /*
  * returns 1 if data was logged, 0 otherwise
  */
-int uncached_logk(enum logk_event_type log_type, void *data);
+static inline int uncached_logk(enum logk_event_type log_type, void *data)
+{
+	if (!msm_rtb_event_enabled(log_type))
+		return 0;
+	return __uncached_logk(log_type, data);
+}
 
 #define ETB_WAYPOINT  do { \
 				BRANCH_TO_NEXT_ISTR; \
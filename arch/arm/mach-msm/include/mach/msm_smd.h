@@ -75,9 +75,30 @@ int smd_write(smd_channel_t *ch, const void *data, int len);
  */
 int smd_write_user_buffer(smd_channel_t *ch, const void *data, int len);
 
+/* Same as smd_write() but does not interrupt the remote processor.  Use
+ * this to queue several writes and then call smd_flush() to signal the
+ * remote side once for all of them.
+ */
+int smd_write_defer(smd_channel_t *ch, const void *data, int len);
+
+/* Interrupts the remote processor if data was written with
+ * smd_write_defer() since the last notification.  The interrupt may be
+ * further delayed by the coalescing window configured for the edge.
+ */
+int smd_flush(smd_channel_t *ch);
+
 int smd_write_avail(smd_channel_t *ch);
 int smd_read_avail(smd_channel_t *ch);
 
+/* Returns the physical address and size of the receive fifo of a channel
+ * so that it can be mapped read-only by a client that parses packets in
+ * place.  Data is consumed by calling smd_read() with a null buffer.
+ */
+int smd_rx_fifo_phys(smd_channel_t *ch, phys_addr_t *phys, unsigned *size);
+
+/* Returns the fifo offset of the next byte smd_read() will return. */
+int smd_rx_fifo_tail(smd_channel_t *ch);
+
 /* Returns the total size of the current packet being read.
 ** Returns 0 if no packets available or a stream channel.
 */
@@ -201,6 +222,17 @@ smd_write_user_buffer(smd_channel_t *ch, const void *data, int len)
 	return -ENODEV;
 }
 
+static inline int
+smd_write_defer(smd_channel_t *ch, const void *data, int len)
+{
+	return -ENODEV;
+}
+
+static inline int smd_flush(smd_channel_t *ch)
+{
+	return -ENODEV;
+}
+
 static inline int smd_write_avail(smd_channel_t *ch)
 {
 	return -ENODEV;
@@ -211,6 +243,17 @@ static inline int smd_read_avail(smd_channel_t *ch)
 	return -ENODEV;
 }
 
+static inline int
+smd_rx_fifo_phys(smd_channel_t *ch, phys_addr_t *phys, unsigned *size)
+{
+	return -ENODEV;
+}
+
+static inline int smd_rx_fifo_tail(smd_channel_t *ch)
+{
+	return -ENODEV;
+}
+
 static inline int smd_cur_packet_size(smd_channel_t *ch)
 {
 	return -ENODEV;
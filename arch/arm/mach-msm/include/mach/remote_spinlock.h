@@ -234,37 +234,47 @@ int _remote_spin_lock_init(remote_spinlock_id_t id, _remote_spinlock_t *lock)
 static inline void _remote_spin_release_all(uint32_t pid) {}
 #endif
 
+#if defined(CONFIG_MSM_REMOTE_SPINLOCK_STATS)
+/* Takes the lock with the raw lock function, accounting for the spin */
+void _remote_spin_lock_stats(_remote_spinlock_t *lock);
+#define _remote_spin_lock(lock)		_remote_spin_lock_stats(lock)
+#endif
+
 #if defined(CONFIG_MSM_REMOTE_SPINLOCK_DEKKERS)
 /* Use Dekker's algorithm when LDREX/STREX and SWP are unavailable for
  * shared memory */
-#define _remote_spin_lock(lock)		__raw_remote_dek_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_dek_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_dek_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_dek_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_dek_spin_release(*lock,\
 		pid)
 #elif defined(CONFIG_MSM_REMOTE_SPINLOCK_SWP)
 /* Use SWP-based locks when LDREX/STREX are unavailable for shared memory. */
-#define _remote_spin_lock(lock)		__raw_remote_swp_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_swp_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_swp_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_swp_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_gen_spin_release(*lock,\
 		pid)
 #elif defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
 /* Use SFPB Hardware Mutex Registers */
-#define _remote_spin_lock(lock)		__raw_remote_sfpb_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_sfpb_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_sfpb_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_sfpb_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_gen_spin_release(*lock,\
 		pid)
 #else
 /* Use LDREX/STREX for shared memory locking, when available */
-#define _remote_spin_lock(lock)		__raw_remote_ex_spin_lock(*lock)
+#define __remote_spin_lock(lock)	__raw_remote_ex_spin_lock(*lock)
 #define _remote_spin_unlock(lock)	__raw_remote_ex_spin_unlock(*lock)
 #define _remote_spin_trylock(lock)	__raw_remote_ex_spin_trylock(*lock)
 #define _remote_spin_release(lock, pid)	__raw_remote_gen_spin_release(*lock, \
 		pid)
 #endif
 
+#if !defined(CONFIG_MSM_REMOTE_SPINLOCK_STATS)
+#define _remote_spin_lock(lock)		__remote_spin_lock(lock)
+#endif
+
 /* Remote mutex definitions. */
 
 typedef struct {
@@ -17,6 +17,7 @@
 #include <linux/types.h>
 #include <linux/list.h>
 #include <linux/semaphore.h>
+#include <linux/workqueue.h>
 
 #if defined(CONFIG_ARCH_MSM8X60)
 #include <mach/rpm-8660.h>
@@ -129,6 +130,29 @@ static inline int msm_rpm_clear_nosleep(
 	return rc;
 }
 
+/* Maximum number of distinct resources in one transaction */
+#define MSM_RPM_TXN_MAX 32
+
+/*
+ * A set of votes for one context that is sent to RPM as a single request.
+ * Fields are reserved for RPM use, set up with msm_rpm_txn_init().
+ */
+struct msm_rpm_txn {
+	int ctx;
+	int count;
+	struct msm_rpm_iv_pair req[MSM_RPM_TXN_MAX];
+	struct work_struct work;
+	void (*done)(struct msm_rpm_txn *txn, int rc);
+};
+
+void msm_rpm_txn_init(struct msm_rpm_txn *txn, int ctx);
+int msm_rpm_txn_add(struct msm_rpm_txn *txn,
+	struct msm_rpm_iv_pair *req, int count);
+int msm_rpm_txn_commit(struct msm_rpm_txn *txn);
+int msm_rpm_txn_commit_noirq(struct msm_rpm_txn *txn);
+int msm_rpm_txn_commit_async(struct msm_rpm_txn *txn,
+	void (*done)(struct msm_rpm_txn *txn, int rc));
+
 int msm_rpm_register_notification(struct msm_rpm_notification *n,
 	struct msm_rpm_iv_pair *req, int count);
 int msm_rpm_unregister_notification(struct msm_rpm_notification *n);
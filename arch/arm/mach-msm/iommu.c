@@ -712,13 +712,49 @@ static unsigned int get_phys_addr(struct scatterlist *sg)
 	return pa;
 }
 
+/* Check that len bytes starting at offset into sg are physically contiguous */
+static int sg_is_contig(struct scatterlist *sg, unsigned int offset,
+			unsigned int len)
+{
+	unsigned int pa = get_phys_addr(sg) + offset;
+	unsigned int have = sg->length - offset;
+
+	while (have < len) {
+		sg = sg_next(sg);
+		if (sg == NULL || get_phys_addr(sg) != pa + have)
+			return 0;
+		have += sg->length;
+	}
+
+	return 1;
+}
+
+/* Move the chunk position forward by len bytes of the scatterlist */
+static int sg_advance(struct scatterlist **sg, unsigned int *chunk_offset,
+		      unsigned int *chunk_pa, unsigned int len)
+{
+	*chunk_offset += len;
+
+	while (*chunk_offset >= (*sg)->length) {
+		*chunk_offset -= (*sg)->length;
+		*sg = sg_next(*sg);
+		*chunk_pa = *sg ? get_phys_addr(*sg) : 0;
+		if (*chunk_pa == 0) {
+			pr_debug("No dma address for sg %p\n", *sg);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 			       struct scatterlist *sg, unsigned int len,
 			       int prot)
 {
 	unsigned int pa;
 	unsigned int offset = 0;
-	unsigned int pgprot;
+	unsigned int pgprot, pgprot_large, pgprot_sect;
 	unsigned long *fl_table;
 	unsigned long *fl_pte;
 	unsigned long fl_offset;
@@ -727,6 +763,7 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	unsigned int chunk_offset = 0;
 	unsigned int chunk_pa;
 	int ret = 0;
+	int flush = 0;
 	struct msm_priv *priv;
 
 	mutex_lock(&msm_iommu_lock);
@@ -737,12 +774,18 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	fl_table = priv->pgtable;
 
 	pgprot = __get_pgprot(prot, SZ_4K);
+	pgprot_sect = __get_pgprot(prot, SZ_1M);
 
-	if (!pgprot) {
+	if (!pgprot || !pgprot_sect) {
 		ret = -EINVAL;
 		goto fail;
 	}
 
+	/* Large page descriptors keep TEX at a different position */
+	pgprot_large = pgprot & ~SL_TEX0;
+	if (pgprot & SL_TEX0)
+		pgprot_large |= SL_TEX0_LARGE;
+
 	fl_offset = FL_OFFSET(va);	/* Upper 12 bits */
 	fl_pte = fl_table + fl_offset;	/* int pointers, 4 bytes */
 
@@ -757,6 +800,30 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 	}
 
 	while (offset < len) {
+		/*
+		 * Use a section if a whole aligned megabyte of physically
+		 * contiguous memory is left to map at a megabyte boundary
+		 */
+		pa = chunk_pa + chunk_offset;
+		if (sl_offset == 0 && *fl_pte == 0 && len - offset >= SZ_1M &&
+		    IS_ALIGNED(pa, SZ_1M) &&
+		    sg_is_contig(sg, chunk_offset, SZ_1M)) {
+			*fl_pte = (pa & 0xFFF00000) | FL_NG | FL_TYPE_SECT |
+				  FL_SHARED | pgprot_sect;
+			clean_pte(fl_pte, fl_pte + 1, priv->redirect);
+
+			offset += SZ_1M;
+			fl_pte++;
+
+			if (offset < len) {
+				ret = sg_advance(&sg, &chunk_offset, &chunk_pa,
+						 SZ_1M);
+				if (ret)
+					goto fail;
+			}
+			continue;
+		}
+
 		/* Set up a 2nd level page table if one doesn't exist */
 		if (*fl_pte == 0) {
 			sl_table = (unsigned long *)
@@ -786,24 +853,39 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 
 		/* Build the 2nd level page table */
 		while (offset < len && sl_offset < NUM_SL_PTE) {
+			unsigned int size = SZ_4K;
+			int i;
+
 			pa = chunk_pa + chunk_offset;
-			sl_table[sl_offset] = (pa & SL_BASE_MASK_SMALL) |
-				     pgprot | SL_NG | SL_SHARED | SL_TYPE_SMALL;
-			sl_offset++;
-			offset += SZ_4K;
-
-			chunk_offset += SZ_4K;
-
-			if (chunk_offset >= sg->length && offset < len) {
-				chunk_offset = 0;
-				sg = sg_next(sg);
-				chunk_pa = get_phys_addr(sg);
-				if (chunk_pa == 0) {
-					pr_debug("No dma address for sg %p\n",
-						 sg);
-					ret = -EINVAL;
-					goto fail;
+
+			/* Large pages are 16 identical aligned entries */
+			if (IS_ALIGNED(sl_offset, 16) &&
+			    len - offset >= SZ_64K && IS_ALIGNED(pa, SZ_64K) &&
+			    sg_is_contig(sg, chunk_offset, SZ_64K)) {
+				for (i = 0; i < 16; i++) {
+					flush |= sl_table[sl_offset + i] != 0;
+					sl_table[sl_offset + i] =
+						(pa & SL_BASE_MASK_LARGE) |
+						pgprot_large | SL_NG |
+						SL_SHARED | SL_TYPE_LARGE;
 				}
+				size = SZ_64K;
+				sl_offset += 16;
+			} else {
+				flush |= sl_table[sl_offset] != 0;
+				sl_table[sl_offset] =
+					(pa & SL_BASE_MASK_SMALL) | pgprot |
+					SL_NG | SL_SHARED | SL_TYPE_SMALL;
+				sl_offset++;
+			}
+
+			offset += size;
+
+			if (offset < len) {
+				ret = sg_advance(&sg, &chunk_offset, &chunk_pa,
+						 size);
+				if (ret)
+					goto fail;
 			}
 		}
 
@@ -813,7 +895,13 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 		fl_pte++;
 		sl_offset = 0;
 	}
-	__flush_iotlb(domain);
+
+	/*
+	 * The TLB can only hold translations that were valid, so it only
+	 * needs to be invalidated if an existing entry was replaced
+	 */
+	if (flush)
+		__flush_iotlb(domain);
 fail:
 	mutex_unlock(&msm_iommu_lock);
 	return ret;
@@ -845,6 +933,17 @@ static int msm_iommu_unmap_range(struct iommu_domain *domain, unsigned int va,
 	sl_start = SL_OFFSET(va);
 
 	while (offset < len) {
+		/* Sections only come from whole, aligned megabytes */
+		if (*fl_pte & FL_TYPE_SECT) {
+			*fl_pte = 0;
+			clean_pte(fl_pte, fl_pte + 1, priv->redirect);
+
+			offset += SZ_1M;
+			sl_start = 0;
+			fl_pte++;
+			continue;
+		}
+
 		sl_table = (unsigned long *) __va(((*fl_pte) & FL_BASE_MASK));
 		sl_end = ((len - offset) / SZ_4K) + sl_start;
 
@@ -11,11 +11,15 @@
  */
 
 #include <linux/init.h>
+#include <linux/debugfs.h>
 #include <linux/iommu.h>
 #include <linux/memory_alloc.h>
 #include <linux/platform_device.h>
 #include <linux/rbtree.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
 #include <asm/sizes.h>
 #include <asm/page.h>
@@ -27,9 +31,36 @@
 /* dummy 64K for overmapping */
 char iommu_dummy[2*SZ_64K-4];
 
+/*
+ * Clients like video map and unmap buffers of the same few sizes over and
+ * over. Each partition keeps a handful of recently freed ranges aside and
+ * hands them back to the next allocation of exactly the same size, which
+ * saves the genpool search and keeps the partition from fragmenting.
+ */
+#define MSM_IOVA_CACHE_ENTRIES	8
+
+struct msm_iova_cache_entry {
+	unsigned long iova;
+	unsigned long size;
+};
+
+struct msm_iova_cache {
+	spinlock_t lock;
+	int count;
+	struct msm_iova_cache_entry entries[MSM_IOVA_CACHE_ENTRIES];
+	/* allocation statistics */
+	unsigned long allocs;
+	unsigned long hits;
+	unsigned long drains;
+	unsigned long fails;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 struct msm_iova_data {
 	struct rb_node node;
 	struct mem_pool *pools;
+	struct msm_iova_cache *caches;
 	int npools;
 	struct iommu_domain *domain;
 	int domain_num;
@@ -51,56 +82,36 @@ int msm_iommu_map_extra(struct iommu_domain *domain,
 				int cached)
 {
 	int ret = 0;
-	int i = 0;
+	int i;
 	unsigned long phy_addr = ALIGN(virt_to_phys(iommu_dummy), page_size);
-	unsigned long temp_iova = start_iova;
-	unsigned long order = get_order(page_size);
-	if (page_size == SZ_4K) {
-		struct scatterlist *sglist;
-		unsigned int nrpages = PFN_ALIGN(size) >> PAGE_SHIFT;
-		struct page *dummy_page = phys_to_page(phy_addr);
-
-		sglist = vmalloc(sizeof(*sglist) * nrpages);
-		if (!sglist) {
-			ret = -ENOMEM;
-			goto out;
-		}
+	unsigned long aligned_size = ALIGN(size, page_size);
+	unsigned long nrpages = aligned_size / page_size;
+	struct page *dummy_page = phys_to_page(phy_addr);
+	struct scatterlist *sglist;
 
-		sg_init_table(sglist, nrpages);
+	/*
+	 * Every page of the range points at the same dummy page. Hand them
+	 * all to iommu_map_range() at once, so that the page tables are only
+	 * cleaned once per second level table and the TLB flushed at most
+	 * once, instead of once per page.
+	 */
+	sglist = vmalloc(sizeof(*sglist) * nrpages);
+	if (!sglist)
+		return -ENOMEM;
 
-		for (i = 0; i < nrpages; i++)
-			sg_set_page(&sglist[i], dummy_page, PAGE_SIZE, 0);
+	sg_init_table(sglist, nrpages);
 
-		ret = iommu_map_range(domain, temp_iova, sglist, size, cached);
-		if (ret) {
-			pr_err("%s: could not map extra %lx in domain %p\n",
-				__func__, start_iova, domain);
-		}
+	for (i = 0; i < nrpages; i++)
+		sg_set_page(&sglist[i], dummy_page, page_size, 0);
 
-		vfree(sglist);
-	} else {
-		unsigned long order = get_order(page_size);
-		unsigned long aligned_size = ALIGN(size, page_size);
-		unsigned long nrpages = aligned_size >> (PAGE_SHIFT + order);
-
-		for (i = 0; i < nrpages; i++) {
-			ret = iommu_map(domain, temp_iova, phy_addr, page_size,
-						cached);
-			if (ret) {
-				pr_err("%s: could not map %lx in domain %p, error: %d\n",
-					__func__, start_iova, domain, ret);
-				ret = -EAGAIN;
-				goto out;
-			}
-			temp_iova += page_size;
-		}
-	}
-	return ret;
-out:
-	for (; i > 0; --i) {
-		temp_iova -= page_size;
-		iommu_unmap(domain, start_iova, order);
+	ret = iommu_map_range(domain, start_iova, sglist, aligned_size, cached);
+	if (ret) {
+		pr_err("%s: could not map extra %lx in domain %p, error: %d\n",
+			__func__, start_iova, domain, ret);
+		ret = -EAGAIN;
 	}
+
+	vfree(sglist);
 	return ret;
 }
 
@@ -109,50 +120,36 @@ void msm_iommu_unmap_extra(struct iommu_domain *domain,
 				unsigned long size,
 				unsigned long page_size)
 {
-	int i;
-	unsigned long order = get_order(page_size);
-	unsigned long aligned_size = ALIGN(size, page_size);
-	unsigned long nrpages =  aligned_size >> (PAGE_SHIFT + order);
-	unsigned long temp_iova = start_iova;
-
-	for (i = 0; i < nrpages; ++i) {
-		iommu_unmap(domain, temp_iova, order);
-		temp_iova += page_size;
-	}
+	iommu_unmap_range(domain, start_iova, ALIGN(size, page_size));
 }
 
-static int msm_iommu_map_iova_phys(struct iommu_domain *domain,
+int msm_iommu_map_iova_phys(struct iommu_domain *domain,
 				unsigned long iova,
 				unsigned long phys,
 				unsigned long size,
 				int cached)
 {
 	int ret;
-	struct scatterlist *sglist;
+	struct scatterlist sg;
 	int prot = IOMMU_WRITE | IOMMU_READ;
 	prot |= cached ? IOMMU_CACHE : 0;
 
-	sglist = vmalloc(sizeof(*sglist));
-	if (!sglist) {
-		ret = -ENOMEM;
-		goto err1;
-	}
-
-	sg_init_table(sglist, 1);
-	sglist->length = size;
-	sglist->offset = 0;
-	sglist->dma_address = phys;
+	/*
+	 * A single entry is enough for physically contiguous memory:
+	 * iommu_map_range() picks the largest page sizes that fit.
+	 */
+	sg_init_table(&sg, 1);
+	sg.length = size;
+	sg.offset = 0;
+	sg.dma_address = phys;
 
-	ret = iommu_map_range(domain, iova, sglist, size, prot);
+	ret = iommu_map_range(domain, iova, &sg, size, prot);
 	if (ret) {
-		pr_err("%s: could not map extra %lx in domain %p\n",
+		pr_err("%s: could not map %lx in domain %p\n",
 			__func__, iova, domain);
 	}
 
-	vfree(sglist);
-err1:
 	return ret;
-
 }
 
 int msm_iommu_map_contig_buffer(unsigned long phys,
@@ -265,6 +262,76 @@ struct iommu_domain *msm_get_iommu_domain(int domain_num)
 		return NULL;
 }
 
+/* Genpool addresses are offset because genpool can't handle 0 addresses */
+static unsigned long msm_iova_to_pool(struct mem_pool *pool,
+				      unsigned long iova)
+{
+	return pool->paddr == 0 ? iova + SZ_4K : iova;
+}
+
+static int msm_iova_cache_get(struct msm_iova_cache *cache,
+			      unsigned long size, unsigned long align,
+			      unsigned long *iova)
+{
+	int i;
+
+	spin_lock(&cache->lock);
+	/* Most recently freed first */
+	for (i = cache->count - 1; i >= 0; i--) {
+		struct msm_iova_cache_entry *e = &cache->entries[i];
+
+		if (e->size == size && IS_ALIGNED(e->iova, align)) {
+			*iova = e->iova;
+			cache->count--;
+			memmove(e, e + 1, (cache->count - i) * sizeof(*e));
+			break;
+		}
+	}
+	spin_unlock(&cache->lock);
+
+	return i >= 0;
+}
+
+static int msm_iova_cache_put(struct msm_iova_cache *cache,
+			      unsigned long iova, unsigned long size)
+{
+	int ret = 0;
+
+	spin_lock(&cache->lock);
+	if (cache->count < MSM_IOVA_CACHE_ENTRIES) {
+		cache->entries[cache->count].iova = iova;
+		cache->entries[cache->count].size = size;
+		cache->count++;
+		ret = 1;
+	}
+	spin_unlock(&cache->lock);
+
+	return ret;
+}
+
+/* Give all cached ranges back to the genpool, returns how many there were */
+static int msm_iova_cache_drain(struct mem_pool *pool,
+				struct msm_iova_cache *cache)
+{
+	struct msm_iova_cache_entry entries[MSM_IOVA_CACHE_ENTRIES];
+	int count, i;
+
+	spin_lock(&cache->lock);
+	count = cache->count;
+	memcpy(entries, cache->entries, count * sizeof(entries[0]));
+	cache->count = 0;
+	if (count)
+		cache->drains++;
+	spin_unlock(&cache->lock);
+
+	for (i = 0; i < count; i++)
+		gen_pool_free(pool->gpool,
+			      msm_iova_to_pool(pool, entries[i].iova),
+			      entries[i].size);
+
+	return count;
+}
+
 int msm_allocate_iova_address(unsigned int iommu_domain,
 					unsigned int partition_no,
 					unsigned long size,
@@ -273,7 +340,10 @@ int msm_allocate_iova_address(unsigned int iommu_domain,
 {
 	struct msm_iova_data *data;
 	struct mem_pool *pool;
+	struct msm_iova_cache *cache;
 	unsigned long va;
+	unsigned long long start, delta;
+	int hit, ret = 0;
 
 	data = find_domain(iommu_domain);
 
@@ -284,21 +354,48 @@ int msm_allocate_iova_address(unsigned int iommu_domain,
 		return -EINVAL;
 
 	pool = &data->pools[partition_no];
+	cache = &data->caches[partition_no];
 
 	if (!pool->gpool)
 		return -EINVAL;
 
-	va = gen_pool_alloc_aligned(pool->gpool, size, ilog2(align));
-	if (va) {
-		pool->free -= size;
-		/* Offset because genpool can't handle 0 addresses */
-		if (pool->paddr == 0)
-			va -= SZ_4K;
-		*iova = va;
-		return 0;
+	start = sched_clock();
+
+	hit = msm_iova_cache_get(cache, size, align, iova);
+	if (!hit) {
+		va = gen_pool_alloc_aligned(pool->gpool, size, ilog2(align));
+		/*
+		 * The cached ranges may be what the genpool is missing to
+		 * satisfy this request: give them back and try again.
+		 */
+		if (!va && msm_iova_cache_drain(pool, cache))
+			va = gen_pool_alloc_aligned(pool->gpool, size,
+						    ilog2(align));
+		if (va) {
+			/* Offset because genpool can't handle 0 addresses */
+			if (pool->paddr == 0)
+				va -= SZ_4K;
+			*iova = va;
+		} else {
+			ret = -ENOMEM;
+		}
 	}
 
-	return -ENOMEM;
+	delta = sched_clock() - start;
+
+	spin_lock(&cache->lock);
+	cache->allocs++;
+	cache->hits += hit;
+	cache->fails += !!ret;
+	cache->total_ns += delta;
+	if (delta > cache->max_ns)
+		cache->max_ns = delta;
+	spin_unlock(&cache->lock);
+
+	if (!ret)
+		pool->free -= size;
+
+	return ret;
 }
 
 void msm_free_iova_address(unsigned long iova,
@@ -329,11 +426,10 @@ void msm_free_iova_address(unsigned long iova,
 
 	pool->free += size;
 
-	/* Offset because genpool can't handle 0 addresses */
-	if (pool->paddr == 0)
-		iova += SZ_4K;
+	if (msm_iova_cache_put(&data->caches[partition_no], iova, size))
+		return;
 
-	gen_pool_free(pool->gpool, iova, size);
+	gen_pool_free(pool->gpool, msm_iova_to_pool(pool, iova), size);
 }
 
 int msm_register_domain(struct msm_iova_layout *layout)
@@ -341,6 +437,7 @@ int msm_register_domain(struct msm_iova_layout *layout)
 	int i;
 	struct msm_iova_data *data;
 	struct mem_pool *pools;
+	struct msm_iova_cache *caches;
 
 	if (!layout)
 		return -EINVAL;
@@ -350,13 +447,20 @@ int msm_register_domain(struct msm_iova_layout *layout)
 	if (!data)
 		return -ENOMEM;
 
-	pools = kmalloc(sizeof(struct mem_pool) * layout->npartitions,
+	pools = kzalloc(sizeof(struct mem_pool) * layout->npartitions,
 			GFP_KERNEL);
 
 	if (!pools)
 		goto out;
 
+	caches = kzalloc(sizeof(*caches) * layout->npartitions, GFP_KERNEL);
+
+	if (!caches)
+		goto out_pools;
+
 	for (i = 0; i < layout->npartitions; i++) {
+		spin_lock_init(&caches[i].lock);
+
 		if (layout->partitions[i].size == 0)
 			continue;
 
@@ -387,6 +491,7 @@ int msm_register_domain(struct msm_iova_layout *layout)
 	}
 
 	data->pools = pools;
+	data->caches = caches;
 	data->npools = layout->npartitions;
 	data->domain_num = atomic_inc_return(&domain_nums);
 	data->domain = iommu_domain_alloc(layout->domain_flags);
@@ -395,12 +500,82 @@ int msm_register_domain(struct msm_iova_layout *layout)
 
 	return data->domain_num;
 
+out_pools:
+	kfree(pools);
 out:
 	kfree(data);
 
 	return -EINVAL;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int msm_iova_stats_show(struct seq_file *m, void *unused)
+{
+	struct rb_node *n;
+	int i;
+
+	seq_printf(m, "domain part     allocs       hits     drains      fails"
+		      "   avg (ns)   max (ns) cached\n");
+
+	mutex_lock(&domain_mutex);
+	for (n = rb_first(&domain_root); n; n = rb_next(n)) {
+		struct msm_iova_data *data;
+
+		data = rb_entry(n, struct msm_iova_data, node);
+		for (i = 0; i < data->npools; i++) {
+			struct msm_iova_cache *cache = &data->caches[i];
+			unsigned long allocs, hits, drains, fails;
+			u64 avg, max;
+			int count;
+
+			if (!data->pools[i].gpool)
+				continue;
+
+			spin_lock(&cache->lock);
+			allocs = cache->allocs;
+			hits = cache->hits;
+			drains = cache->drains;
+			fails = cache->fails;
+			avg = cache->total_ns;
+			max = cache->max_ns;
+			count = cache->count;
+			spin_unlock(&cache->lock);
+
+			if (allocs)
+				do_div(avg, allocs);
+
+			seq_printf(m, "%6d %4d %10lu %10lu %10lu %10lu %10llu"
+				      " %10llu %6d\n", data->domain_num, i,
+				   allocs, hits, drains, fails, avg, max,
+				   count);
+		}
+	}
+	mutex_unlock(&domain_mutex);
+
+	return 0;
+}
+
+static int msm_iova_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_iova_stats_show, NULL);
+}
+
+static const struct file_operations msm_iova_stats_fops = {
+	.open		= msm_iova_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init msm_iova_stats_init(void)
+{
+	debugfs_create_file("msm_iova_stats", S_IRUGO, NULL, NULL,
+			    &msm_iova_stats_fops);
+}
+#else
+static inline void msm_iova_stats_init(void) { }
+#endif
+
 static int __init iommu_domain_probe(struct platform_device *pdev)
 {
 	struct iommu_domains_pdata *p  = pdev->dev.platform_data;
@@ -463,6 +638,8 @@ static int __init iommu_domain_probe(struct platform_device *pdev)
 		}
 	}
 
+	msm_iova_stats_init();
+
 	return 0;
 }
 
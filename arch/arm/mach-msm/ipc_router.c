@@ -27,6 +27,8 @@
 #include <linux/platform_device.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/rculist.h>
+#include <linux/srcu.h>
 
 #include <asm/uaccess.h>
 #include <asm/byteorder.h>
@@ -92,6 +94,16 @@ if (msm_ipc_router_debug_mask & R2R_RAW_HDR) \
 static LIST_HEAD(control_ports);
 static DEFINE_MUTEX(control_ports_lock);
 
+/*
+ * The local port, server and routing tables are RCU lists: lookups take
+ * no lock and the mutexes below only serialize updates.  Readers of the
+ * local port table go on to sleep on the port, so it is protected by
+ * SRCU and msm_ipc_router_close_port() waits for them before freeing the
+ * port.  Servers are freed with kfree_rcu() and routing table entries
+ * are never freed.
+ */
+static struct srcu_struct local_ports_srcu;
+
 #define LP_HASH_SIZE 32
 static struct list_head local_ports[LP_HASH_SIZE];
 static DEFINE_MUTEX(local_ports_lock);
@@ -105,12 +117,14 @@ struct msm_ipc_server {
 	struct list_head list;
 	struct msm_ipc_port_name name;
 	struct list_head server_port_list;
+	struct rcu_head rcu;
 };
 
 struct msm_ipc_server_port {
 	struct list_head list;
 	struct msm_ipc_port_addr server_addr;
 	struct msm_ipc_router_xprt_info *xprt_info;
+	struct rcu_head rcu;
 };
 
 #define RP_HASH_SIZE 32
@@ -236,21 +250,28 @@ static int add_routing_table_entry(
 		return -EINVAL;
 
 	key = (rt_entry->node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 	return 0;
 }
 
-/*Please take routing_table_lock before calling this function*/
+/*
+ * Entries are never removed, so no lock is needed.  Take routing_table_lock
+ * around a lookup that is followed by add_routing_table_entry().
+ */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	uint32_t node_id)
 {
 	uint32_t key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
-		if (rt_entry->node_id == node_id)
+	rcu_read_lock();
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
+		if (rt_entry->node_id == node_id) {
+			rcu_read_unlock();
 			return rt_entry;
+		}
 	}
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -284,6 +305,10 @@ struct rr_packet *rr_read(struct msm_ipc_router_xprt_info *xprt_info)
 	return temp_pkt;
 }
 
+/*
+ * The clone shares the fragment data with the original; only the skb
+ * heads are duplicated, so neither copy may modify the payload.
+ */
 struct rr_packet *clone_pkt(struct rr_packet *pkt)
 {
 	struct rr_packet *cloned_pkt;
@@ -372,8 +397,10 @@ static int post_control_ports(struct rr_packet *pkt)
 
 	mutex_lock(&control_ports_lock);
 	list_for_each_entry(port_ptr, &control_ports, list) {
-		mutex_lock(&port_ptr->port_rx_q_lock);
 		cloned_pkt = clone_pkt(pkt);
+		if (!cloned_pkt)
+			continue;
+		mutex_lock(&port_ptr->port_rx_q_lock);
 		wake_lock(&port_ptr->port_rx_wake_lock);
 		list_add_tail(&cloned_pkt->list, &port_ptr->port_rx_q);
 		wake_up(&port_ptr->port_rx_wait_q);
@@ -428,7 +455,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	mutex_lock(&local_ports_lock);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	mutex_unlock(&local_ports_lock);
 }
 
@@ -468,19 +495,16 @@ struct msm_ipc_port *msm_ipc_router_create_raw_port(void *endpoint,
 	return port_ptr;
 }
 
+/* Call under srcu_read_lock(&local_ports_srcu) and use the port within it */
 static struct msm_ipc_port *msm_ipc_router_lookup_local_port(uint32_t port_id)
 {
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	mutex_lock(&local_ports_lock);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
-		if (port_ptr->this_port.port_id == port_id) {
-			mutex_unlock(&local_ports_lock);
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
+		if (port_ptr->this_port.port_id == port_id)
 			return port_ptr;
-		}
 	}
-	mutex_unlock(&local_ports_lock);
 	return NULL;
 }
 
@@ -492,10 +516,8 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_lookup_remote_port(
 	struct msm_ipc_routing_table_entry *rt_entry;
 	int key = (port_id & (RP_HASH_SIZE - 1));
 
-	mutex_lock(&routing_table_lock);
 	rt_entry = lookup_routing_table(node_id);
 	if (!rt_entry) {
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Node is not up\n", __func__);
 		return NULL;
 	}
@@ -507,12 +529,10 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_lookup_remote_port(
 			if (rport_ptr->restart_state != RESTART_NORMAL)
 				rport_ptr = NULL;
 			mutex_unlock(&rt_entry->lock);
-			mutex_unlock(&routing_table_lock);
 			return rport_ptr;
 		}
 	}
 	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
 	return NULL;
 }
 
@@ -524,10 +544,8 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_create_remote_port(
 	struct msm_ipc_routing_table_entry *rt_entry;
 	int key = (port_id & (RP_HASH_SIZE - 1));
 
-	mutex_lock(&routing_table_lock);
 	rt_entry = lookup_routing_table(node_id);
 	if (!rt_entry) {
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Node is not up\n", __func__);
 		return NULL;
 	}
@@ -537,7 +555,6 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_create_remote_port(
 			    GFP_KERNEL);
 	if (!rport_ptr) {
 		mutex_unlock(&rt_entry->lock);
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Remote port alloc failed\n", __func__);
 		return NULL;
 	}
@@ -550,7 +567,6 @@ static struct msm_ipc_router_remote_port *msm_ipc_router_create_remote_port(
 	list_add_tail(&rport_ptr->list,
 		      &rt_entry->remote_port_list[key]);
 	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
 	return rport_ptr;
 }
 
@@ -564,10 +580,8 @@ static void msm_ipc_router_destroy_remote_port(
 		return;
 
 	node_id = rport_ptr->node_id;
-	mutex_lock(&routing_table_lock);
 	rt_entry = lookup_routing_table(node_id);
 	if (!rt_entry) {
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Node %d is not up\n", __func__, node_id);
 		return;
 	}
@@ -576,7 +590,6 @@ static void msm_ipc_router_destroy_remote_port(
 	list_del(&rport_ptr->list);
 	kfree(rport_ptr);
 	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
 	return;
 }
 
@@ -590,25 +603,25 @@ static struct msm_ipc_server *msm_ipc_router_lookup_server(
 	struct msm_ipc_server_port *server_port;
 	int key = (instance & (SRV_HASH_SIZE - 1));
 
-	mutex_lock(&server_list_lock);
-	list_for_each_entry(server, &server_list[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(server, &server_list[key], list) {
 		if ((server->name.service != service) ||
 		    (server->name.instance != instance))
 			continue;
 		if ((node_id == 0) && (port_id == 0)) {
-			mutex_unlock(&server_list_lock);
+			rcu_read_unlock();
 			return server;
 		}
-		list_for_each_entry(server_port, &server->server_port_list,
-				    list) {
+		list_for_each_entry_rcu(server_port,
+					&server->server_port_list, list) {
 			if ((server_port->server_addr.node_id == node_id) &&
 			    (server_port->server_addr.port_id == port_id)) {
-				mutex_unlock(&server_list_lock);
+				rcu_read_unlock();
 				return server;
 			}
 		}
 	}
-	mutex_unlock(&server_list_lock);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -623,39 +636,39 @@ static struct msm_ipc_server *msm_ipc_router_create_server(
 	struct msm_ipc_server_port *server_port;
 	int key = (instance & (SRV_HASH_SIZE - 1));
 
+	server_port = kmalloc(sizeof(struct msm_ipc_server_port), GFP_KERNEL);
+	if (!server_port) {
+		pr_err("%s: Server Port allocation failed\n", __func__);
+		return NULL;
+	}
+	server_port->server_addr.node_id = node_id;
+	server_port->server_addr.port_id = port_id;
+	server_port->xprt_info = xprt_info;
+
 	mutex_lock(&server_list_lock);
 	list_for_each_entry(server, &server_list[key], list) {
 		if ((server->name.service == service) &&
-		    (server->name.instance == instance))
-			goto create_srv_port;
+		    (server->name.instance == instance)) {
+			list_add_tail_rcu(&server_port->list,
+					  &server->server_port_list);
+			mutex_unlock(&server_list_lock);
+			return server;
+		}
 	}
 
 	server = kmalloc(sizeof(struct msm_ipc_server), GFP_KERNEL);
 	if (!server) {
 		mutex_unlock(&server_list_lock);
+		kfree(server_port);
 		pr_err("%s: Server allocation failed\n", __func__);
 		return NULL;
 	}
 	server->name.service = service;
 	server->name.instance = instance;
 	INIT_LIST_HEAD(&server->server_port_list);
-	list_add_tail(&server->list, &server_list[key]);
-
-create_srv_port:
-	server_port = kmalloc(sizeof(struct msm_ipc_server_port), GFP_KERNEL);
-	if (!server_port) {
-		if (list_empty(&server->server_port_list)) {
-			list_del(&server->list);
-			kfree(server);
-		}
-		mutex_unlock(&server_list_lock);
-		pr_err("%s: Server Port allocation failed\n", __func__);
-		return NULL;
-	}
-	server_port->server_addr.node_id = node_id;
-	server_port->server_addr.port_id = port_id;
-	server_port->xprt_info = xprt_info;
 	list_add_tail(&server_port->list, &server->server_port_list);
+	/* publish only once the server has its first port */
+	list_add_tail_rcu(&server->list, &server_list[key]);
 	mutex_unlock(&server_list_lock);
 
 	return server;
@@ -664,7 +677,7 @@ create_srv_port:
 static void msm_ipc_router_destroy_server(struct msm_ipc_server *server,
 					  uint32_t node_id, uint32_t port_id)
 {
-	struct msm_ipc_server_port *server_port;
+	struct msm_ipc_server_port *server_port, *found = NULL;
 
 	if (!server)
 		return;
@@ -672,16 +685,18 @@ static void msm_ipc_router_destroy_server(struct msm_ipc_server *server,
 	mutex_lock(&server_list_lock);
 	list_for_each_entry(server_port, &server->server_port_list, list) {
 		if ((server_port->server_addr.node_id == node_id) &&
-		    (server_port->server_addr.port_id == port_id))
+		    (server_port->server_addr.port_id == port_id)) {
+			found = server_port;
 			break;
+		}
 	}
-	if (server_port) {
-		list_del(&server_port->list);
-		kfree(server_port);
+	if (found) {
+		list_del_rcu(&found->list);
+		kfree_rcu(found, rcu);
 	}
 	if (list_empty(&server->server_port_list)) {
-		list_del(&server->list);
-		kfree(server);
+		list_del_rcu(&server->list);
+		kfree_rcu(server, rcu);
 	}
 	mutex_unlock(&server_list_lock);
 	return;
@@ -958,10 +973,8 @@ static int forward_msg(struct msm_ipc_router_xprt_info *xprt_info,
 
 	hdr = (struct rr_header *)head_pkt->data;
 	dst_node_id = hdr->dst_node_id;
-	mutex_lock(&routing_table_lock);
 	rt_entry = lookup_routing_table(dst_node_id);
 	if (!(rt_entry) || !(rt_entry->xprt_info)) {
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Routing table not initialized\n", __func__);
 		return -ENODEV;
 	}
@@ -972,7 +985,6 @@ static int forward_msg(struct msm_ipc_router_xprt_info *xprt_info,
 	if (xprt_info->remote_node_id == fwd_xprt_info->remote_node_id) {
 		mutex_unlock(&fwd_xprt_info->tx_lock);
 		mutex_unlock(&rt_entry->lock);
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Discarding Command to route back\n", __func__);
 		return -EINVAL;
 	}
@@ -980,14 +992,12 @@ static int forward_msg(struct msm_ipc_router_xprt_info *xprt_info,
 	if (xprt_info->xprt->link_id == fwd_xprt_info->xprt->link_id) {
 		mutex_unlock(&fwd_xprt_info->tx_lock);
 		mutex_unlock(&rt_entry->lock);
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: DST in the same cluster\n", __func__);
 		return 0;
 	}
 	fwd_xprt_info->xprt->write(pkt, pkt->length, 0);
 	mutex_unlock(&fwd_xprt_info->tx_lock);
 	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
 
 	return 0;
 }
@@ -1043,12 +1053,12 @@ static void msm_ipc_cleanup_remote_server_info(
 				ctl.srv.port_id = svr_port->server_addr.port_id;
 				relay_ctl_msg(xprt_info, &ctl);
 				broadcast_ctl_msg_locally(&ctl);
-				list_del(&svr_port->list);
-				kfree(svr_port);
+				list_del_rcu(&svr_port->list);
+				kfree_rcu(svr_port, rcu);
 			}
 			if (list_empty(&svr->server_port_list)) {
-				list_del(&svr->list);
-				kfree(svr);
+				list_del_rcu(&svr->list);
+				kfree_rcu(svr, rcu);
 			}
 		}
 	}
@@ -1353,6 +1363,9 @@ static void do_read_data(struct work_struct *work)
 	struct msm_ipc_port_addr *src_addr;
 	struct msm_ipc_router_remote_port *rport_ptr;
 	uint32_t resume_tx, resume_tx_node_id, resume_tx_port_id;
+	void (*notify)(unsigned event, void *data, void *addr, void *priv);
+	void *priv;
+	int idx;
 
 	struct msm_ipc_router_xprt_info *xprt_info =
 		container_of(work,
@@ -1427,8 +1440,10 @@ static void do_read_data(struct work_struct *work)
 	resume_tx_node_id = hdr->dst_node_id;
 	resume_tx_port_id = hdr->dst_port_id;
 
+	idx = srcu_read_lock(&local_ports_srcu);
 	port_ptr = msm_ipc_router_lookup_local_port(hdr->dst_port_id);
 	if (!port_ptr) {
+		srcu_read_unlock(&local_ports_srcu, idx);
 		pr_err("%s: No local port id %08x\n", __func__,
 			hdr->dst_port_id);
 		release_pkt(pkt);
@@ -1442,6 +1457,7 @@ static void do_read_data(struct work_struct *work)
 							hdr->src_node_id,
 							hdr->src_port_id);
 		if (!rport_ptr) {
+			srcu_read_unlock(&local_ports_srcu, idx);
 			pr_err("%s: Remote port %08x:%08x creation failed\n",
 				__func__, hdr->src_node_id, hdr->src_port_id);
 			goto process_done;
@@ -1454,7 +1470,12 @@ static void do_read_data(struct work_struct *work)
 		list_add_tail(&pkt->list, &port_ptr->port_rx_q);
 		wake_up(&port_ptr->port_rx_wait_q);
 		mutex_unlock(&port_ptr->port_rx_q_lock);
+		srcu_read_unlock(&local_ports_srcu, idx);
 	} else {
+		/* the callback may close the port, so call it unprotected */
+		notify = port_ptr->notify;
+		priv = port_ptr->priv;
+		srcu_read_unlock(&local_ports_srcu, idx);
 		src_addr = kmalloc(sizeof(struct msm_ipc_port_addr),
 				   GFP_KERNEL);
 		if (src_addr) {
@@ -1462,8 +1483,8 @@ static void do_read_data(struct work_struct *work)
 			src_addr->port_id = hdr->src_port_id;
 		}
 		skb_pull(head_skb, IPC_ROUTER_HDR_SIZE);
-		port_ptr->notify(MSM_IPC_ROUTER_READ_CB, pkt->pkt_fragment_q,
-				 src_addr, port_ptr->priv);
+		notify(MSM_IPC_ROUTER_READ_CB, pkt->pkt_fragment_q,
+		       src_addr, priv);
 		pkt->pkt_fragment_q = NULL;
 		src_addr = NULL;
 		release_pkt(pkt);
@@ -1590,6 +1611,7 @@ static int loopback_data(struct msm_ipc_port *src,
 	struct rr_header *hdr;
 	struct msm_ipc_port *port_ptr;
 	struct rr_packet *pkt;
+	int ret, idx;
 
 	if (!data) {
 		pr_err("%s: Invalid pkt pointer\n", __func__);
@@ -1622,9 +1644,12 @@ static int loopback_data(struct msm_ipc_port *src,
 	hdr->dst_node_id = IPC_ROUTER_NID_LOCAL;
 	hdr->dst_port_id = port_id;
 	pkt->length += IPC_ROUTER_HDR_SIZE;
+	ret = pkt->length;
 
+	idx = srcu_read_lock(&local_ports_srcu);
 	port_ptr = msm_ipc_router_lookup_local_port(port_id);
 	if (!port_ptr) {
+		srcu_read_unlock(&local_ports_srcu, idx);
 		pr_err("%s: Local port %d not present\n", __func__, port_id);
 		release_pkt(pkt);
 		return -ENODEV;
@@ -1635,8 +1660,9 @@ static int loopback_data(struct msm_ipc_port *src,
 	list_add_tail(&pkt->list, &port_ptr->port_rx_q);
 	wake_up(&port_ptr->port_rx_wait_q);
 	mutex_unlock(&port_ptr->port_rx_q_lock);
+	srcu_read_unlock(&local_ports_srcu, idx);
 
-	return pkt->length;
+	return ret;
 }
 
 static int msm_ipc_router_write_pkt(struct msm_ipc_port *src,
@@ -1702,10 +1728,8 @@ static int msm_ipc_router_write_pkt(struct msm_ipc_port *src,
 		hdr->confirm_rx = 1;
 	mutex_unlock(&rport_ptr->quota_lock);
 
-	mutex_lock(&routing_table_lock);
 	rt_entry = lookup_routing_table(hdr->dst_node_id);
 	if (!rt_entry || !rt_entry->xprt_info) {
-		mutex_unlock(&routing_table_lock);
 		pr_err("%s: Remote node %d not up\n",
 			__func__, hdr->dst_node_id);
 		return -ENODEV;
@@ -1716,7 +1740,6 @@ static int msm_ipc_router_write_pkt(struct msm_ipc_port *src,
 	ret = xprt_info->xprt->write(pkt, pkt->length, 0);
 	mutex_unlock(&xprt_info->tx_lock);
 	mutex_unlock(&rt_entry->lock);
-	mutex_unlock(&routing_table_lock);
 
 	if (ret < 0) {
 		pr_err("%s: Write on XPRT failed\n", __func__);
@@ -1771,21 +1794,26 @@ int msm_ipc_router_send_to(struct msm_ipc_port *src,
 		dst_node_id = dest->addr.port_addr.node_id;
 		dst_port_id = dest->addr.port_addr.port_id;
 	} else if (dest->addrtype == MSM_IPC_ADDR_NAME) {
+		rcu_read_lock();
 		server = msm_ipc_router_lookup_server(
 					dest->addr.port_name.service,
 					dest->addr.port_name.instance,
 					0, 0);
-		if (!server) {
+		ret = -ENODEV;
+		if (server) {
+			list_for_each_entry_rcu(server_port,
+					&server->server_port_list, list) {
+				dst_node_id = server_port->server_addr.node_id;
+				dst_port_id = server_port->server_addr.port_id;
+				ret = 0;
+				break;
+			}
+		}
+		rcu_read_unlock();
+		if (ret) {
 			pr_err("%s: Destination not reachable\n", __func__);
 			return -ENODEV;
 		}
-		mutex_lock(&server_list_lock);
-		server_port = list_first_entry(&server->server_port_list,
-					       struct msm_ipc_server_port,
-					       list);
-		dst_node_id = server_port->server_addr.node_id;
-		dst_port_id = server_port->server_addr.port_id;
-		mutex_unlock(&server_list_lock);
 	}
 	if (dst_node_id == IPC_ROUTER_NID_LOCAL) {
 		ret = loopback_data(src, dst_port_id, data);
@@ -1947,13 +1975,6 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 		broadcast_ctl_msg_locally(&msg);
 	}
 
-	mutex_lock(&port_ptr->port_rx_q_lock);
-	list_for_each_entry_safe(pkt, temp_pkt, &port_ptr->port_rx_q, list) {
-		list_del(&pkt->list);
-		release_pkt(pkt);
-	}
-	mutex_unlock(&port_ptr->port_rx_q_lock);
-
 	if (port_ptr->type == SERVER_PORT) {
 		server = msm_ipc_router_lookup_server(
 				port_ptr->port_name.service,
@@ -1965,18 +1986,28 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 				port_ptr->this_port.node_id,
 				port_ptr->this_port.port_id);
 		mutex_lock(&local_ports_lock);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		mutex_unlock(&local_ports_lock);
+		synchronize_srcu(&local_ports_srcu);
 	} else if (port_ptr->type == CLIENT_PORT) {
 		mutex_lock(&local_ports_lock);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		mutex_unlock(&local_ports_lock);
+		synchronize_srcu(&local_ports_srcu);
 	} else if (port_ptr->type == CONTROL_PORT) {
 		mutex_lock(&control_ports_lock);
 		list_del(&port_ptr->list);
 		mutex_unlock(&control_ports_lock);
 	}
 
+	/* no reader can queue to the port any more */
+	mutex_lock(&port_ptr->port_rx_q_lock);
+	list_for_each_entry_safe(pkt, temp_pkt, &port_ptr->port_rx_q, list) {
+		list_del(&pkt->list);
+		release_pkt(pkt);
+	}
+	mutex_unlock(&port_ptr->port_rx_q_lock);
+
 	wake_lock_destroy(&port_ptr->port_rx_wake_lock);
 	kfree(port_ptr);
 	return 0;
@@ -2007,8 +2038,9 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	mutex_lock(&local_ports_lock);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	mutex_unlock(&local_ports_lock);
+	synchronize_srcu(&local_ports_srcu);
 	port_ptr->type = CONTROL_PORT;
 	mutex_lock(&control_ports_lock);
 	list_add_tail(&port_ptr->list, &control_ports);
@@ -2036,17 +2068,17 @@ int msm_ipc_router_lookup_server_name(struct msm_ipc_port_name *srv_name,
 		return -EINVAL;
 	}
 
-	mutex_lock(&server_list_lock);
+	rcu_read_lock();
 	if (!lookup_mask)
 		lookup_mask = 0xFFFFFFFF;
 	for (key = 0; key < SRV_HASH_SIZE; key++) {
-		list_for_each_entry(server, &server_list[key], list) {
+		list_for_each_entry_rcu(server, &server_list[key], list) {
 			if ((server->name.service != srv_name->service) ||
 			    ((server->name.instance & lookup_mask) !=
 				srv_name->instance))
 				continue;
 
-			list_for_each_entry(server_port,
+			list_for_each_entry_rcu(server_port,
 				&server->server_port_list, list) {
 				if (i < num_entries_in_array) {
 					srv_info[i].node_id =
@@ -2062,7 +2094,7 @@ int msm_ipc_router_lookup_server_name(struct msm_ipc_port_name *srv_name,
 			}
 		}
 	}
-	mutex_unlock(&server_list_lock);
+	rcu_read_unlock();
 
 	return i;
 }
@@ -2519,10 +2551,16 @@ static int __init msm_ipc_router_init(void)
 	struct msm_ipc_routing_table_entry *rt_entry;
 
 	msm_ipc_router_debug_mask |= SMEM_LOG;
+	ret = init_srcu_struct(&local_ports_srcu);
+	if (ret)
+		return ret;
+
 	msm_ipc_router_workqueue =
 		create_singlethread_workqueue("msm_ipc_router");
-	if (!msm_ipc_router_workqueue)
+	if (!msm_ipc_router_workqueue) {
+		cleanup_srcu_struct(&local_ports_srcu);
 		return -ENOMEM;
+	}
 
 	debugfs_init();
 
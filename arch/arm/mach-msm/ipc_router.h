@@ -92,6 +92,12 @@ struct rr_header {
 
 #define IPC_ROUTER_HDR_SIZE sizeof(struct rr_header)
 #define MAX_IPC_PKT_SIZE 66000
+/*
+ * Packets are carried as a list of fragments no larger than this, so a
+ * large message never needs a high-order allocation and every fragment
+ * keeps room for the router header in front of it.
+ */
+#define IPC_ROUTER_MAX_FRAG_SZ SKB_MAX_ORDER(IPC_ROUTER_HDR_SIZE, 0)
 /* internals */
 
 #define IPC_ROUTER_MAX_REMOTE_SERVERS		100
@@ -222,6 +222,8 @@ static void smd_xprt_read_data(struct work_struct *work)
 			return;
 
 		sz = smd_read_avail(smd_remote_xprt.channel);
+		if (sz > IPC_ROUTER_MAX_FRAG_SZ)
+			sz = IPC_ROUTER_MAX_FRAG_SZ;
 		do {
 			ipc_rtr_pkt = alloc_skb(sz, GFP_KERNEL);
 			if (!ipc_rtr_pkt) {
@@ -97,6 +97,8 @@ static struct sk_buff_head *msm_ipc_router_build_msg(unsigned int num_sect,
 		data_size = msg_sect[i].iov_len;
 		offset = 0;
 		while (offset != msg_sect[i].iov_len) {
+			if (data_size > IPC_ROUTER_MAX_FRAG_SZ)
+				data_size = IPC_ROUTER_MAX_FRAG_SZ;
 			request_size = data_size;
 			if (first)
 				request_size += IPC_ROUTER_HDR_SIZE;
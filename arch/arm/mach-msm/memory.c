@@ -313,6 +313,26 @@ unsigned long __init reserve_memory_for_fmem(unsigned long fmem_size,
 	return fmem_phys;
 }
 
+/*
+ * Memory for a movable ION carveout. It is only reserved in memblock, not
+ * removed, so it keeps its struct pages and the heap can hand it to the page
+ * allocator as MIGRATE_CMA pageblocks. Taken top down, i.e. from highmem if
+ * there is any, which keeps it out of the kernel linear mapping.
+ */
+unsigned long __init reserve_memory_for_movable(unsigned long size)
+{
+	unsigned long align = PAGE_SIZE << pageblock_order;
+	phys_addr_t phys;
+
+	if (!size)
+		return 0;
+
+	phys = memblock_alloc_base(ALIGN(size, align), align,
+				   MEMBLOCK_ALLOC_ANYWHERE);
+	pr_info("movable start %lx size %lx\n", (unsigned long)phys, size);
+	return phys;
+}
+
 static void __init initialize_mempools(void)
 {
 	struct mem_pool *mpool;
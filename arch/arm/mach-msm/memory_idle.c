@@ -0,0 +1,203 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Powers down the movable DDR region while the screen is off.
+ *
+ * At early suspend the memory blocks of the movable zone are offlined, which
+ * migrates the pages living there to the rest of memory, and the region is
+ * put in deep power down through the RPM. It comes back at late resume, or
+ * earlier if the remaining memory runs low: a shrinker notices reclaim and
+ * queues the work bringing the region back online.
+ *
+ * Offlining a block gives up after offline_timeout_ms, and a request to
+ * bring the region back is checked between blocks, which bounds how long a
+ * wakeup waits for the memory.
+ */
+
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/memory.h>
+#include <linux/memory_hotplug.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/earlysuspend.h>
+#include <linux/jiffies.h>
+#include <asm/page.h>
+#include <mach/memory.h>
+
+static int enabled = 1;
+module_param(enabled, int, S_IRUGO | S_IWUSR);
+
+static unsigned int offline_timeout_ms = 1000;
+module_param(offline_timeout_ms, uint, S_IRUGO | S_IWUSR);
+
+/* Set while the region is offline and powered down */
+static int powered_down;
+module_param(powered_down, int, S_IRUGO);
+
+static struct workqueue_struct *memory_idle_wq;
+static DEFINE_MUTEX(memory_idle_mutex);
+static int want_offline;
+
+/*
+ * The pages in use in the movable zone have to fit in the free memory the
+ * other zones have above their high watermark.
+ */
+static bool memory_idle_room_to_migrate(void)
+{
+	unsigned long room = 0, used = 0;
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		unsigned long nr_free = zone_page_state(zone, NR_FREE_PAGES);
+
+		if (zone_idx(zone) == ZONE_MOVABLE)
+			used += zone->present_pages - nr_free;
+		else if (nr_free > high_wmark_pages(zone))
+			room += nr_free - high_wmark_pages(zone);
+	}
+	return room > used;
+}
+
+static int memory_idle_online(unsigned long start_pfn, unsigned long end_pfn)
+{
+	unsigned long pfn;
+	int ret = 0;
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn += PAGES_PER_SECTION) {
+		int err = memory_block_set_state(pfn, MEM_ONLINE, 0);
+
+		if (err) {
+			pr_err("%s: could not online pfn %lx: %d\n",
+				__func__, pfn, err);
+			ret = err;
+		}
+	}
+	return ret;
+}
+
+static int memory_idle_offline(unsigned long start_pfn, unsigned long end_pfn)
+{
+	unsigned long timeout = msecs_to_jiffies(offline_timeout_ms);
+	unsigned long pfn;
+	int ret;
+
+	for (pfn = start_pfn; pfn < end_pfn; pfn += PAGES_PER_SECTION) {
+		if (!ACCESS_ONCE(want_offline)) {
+			ret = -EINTR;
+			goto undo;
+		}
+		ret = memory_block_set_state(pfn, MEM_OFFLINE, timeout);
+		if (ret)
+			goto undo;
+	}
+	return 0;
+
+undo:
+	memory_idle_online(start_pfn, pfn);
+	return ret;
+}
+
+static void memory_idle_work(struct work_struct *work)
+{
+	u64 start = movable_reserved_start;
+	u64 size = movable_reserved_size;
+	unsigned long start_pfn = PFN_DOWN(start);
+	unsigned long end_pfn = start_pfn + PFN_DOWN(size);
+	int ret;
+
+	mutex_lock(&memory_idle_mutex);
+
+	if (ACCESS_ONCE(want_offline) && !powered_down) {
+		if (!memory_idle_room_to_migrate()) {
+			pr_debug("%s: not enough free memory to offline\n",
+				__func__);
+			goto out;
+		}
+		ret = memory_idle_offline(start_pfn, end_pfn);
+		if (ret) {
+			pr_debug("%s: offline failed: %d\n", __func__, ret);
+			goto out;
+		}
+		/* The hotplug code returns the bytes switched, 0 is failure */
+		if (!platform_physical_remove_pages(start, size)) {
+			memory_idle_online(start_pfn, end_pfn);
+			goto out;
+		}
+		powered_down = 1;
+		pr_info("memory %llx size %llx powered down\n", start, size);
+	} else if (!ACCESS_ONCE(want_offline) && powered_down) {
+		if (!platform_physical_active_pages(start, size))
+			pr_err("%s: could not power up memory\n", __func__);
+		/* Try anyway, the pages are lost to the system otherwise */
+		memory_idle_online(start_pfn, end_pfn);
+		powered_down = 0;
+		pr_info("memory %llx size %llx back online\n", start, size);
+	}
+
+out:
+	mutex_unlock(&memory_idle_mutex);
+}
+static DECLARE_WORK(memory_idle_work_struct, memory_idle_work);
+
+static void memory_idle_request(int offline)
+{
+	ACCESS_ONCE(want_offline) = offline;
+	queue_work(memory_idle_wq, &memory_idle_work_struct);
+}
+
+static void memory_idle_early_suspend(struct early_suspend *h)
+{
+	if (enabled)
+		memory_idle_request(1);
+}
+
+static void memory_idle_late_resume(struct early_suspend *h)
+{
+	memory_idle_request(0);
+}
+
+static struct early_suspend memory_idle_early_suspend_desc = {
+	.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN,
+	.suspend = memory_idle_early_suspend,
+	.resume = memory_idle_late_resume,
+};
+
+/* Reclaim has started, the rest of memory is short: the region is needed */
+static int memory_idle_shrink(struct shrinker *s, struct shrink_control *sc)
+{
+	if (ACCESS_ONCE(want_offline) || ACCESS_ONCE(powered_down))
+		memory_idle_request(0);
+	return 0;
+}
+
+static struct shrinker memory_idle_shrinker = {
+	.shrink = memory_idle_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init memory_idle_init(void)
+{
+	if (!movable_reserved_size)
+		return 0;
+
+	memory_idle_wq = create_freezable_workqueue("memory_idle");
+	if (!memory_idle_wq)
+		return -ENOMEM;
+
+	register_shrinker(&memory_idle_shrinker);
+	register_early_suspend(&memory_idle_early_suspend_desc);
+	return 0;
+}
+late_initcall(memory_idle_init);
@@ -22,6 +22,10 @@
 #include <linux/irq.h>
 #include <asm/hardware/gic.h>
 #include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <trace/events/irq.h>
 #include <mach/msm_iomap.h>
 #include <mach/gpio.h>
 
@@ -70,6 +74,12 @@ enum {
 
 static uint8_t msm_mpm_irqs_a2m[MSM_MPM_NR_APPS_IRQS];
 
+/*
+ * irq descriptor of the apps irq of every mpm pin, resolved once at init
+ * so that the replay on the way out of sleep is a table lookup
+ */
+static struct irq_desc *msm_mpm_pin_desc[MSM_MPM_NR_MPM_IRQS];
+
 static DEFINE_SPINLOCK(msm_mpm_lock);
 
 /*
@@ -122,6 +132,26 @@ static irqreturn_t msm_mpm_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Latch a GIC interrupt as pending in the distributor: it is taken as soon
+ * as interrupts are enabled again, without a detour through the software
+ * resend tasklet.
+ */
+static inline void msm_mpm_gic_set_pending(unsigned int irq)
+{
+	__raw_writel(BIT(irq % 32), MSM_QGIC_DIST_BASE +
+			GIC_DIST_PENDING_SET + irq / 32 * 4);
+}
+
+static int msm_mpm_gic_retrigger(struct irq_data *d)
+{
+	if (d->irq >= NR_MSM_IRQS)
+		return 0;
+
+	msm_mpm_gic_set_pending(d->irq);
+	return 1;
+}
+
 /******************************************************************************
  * MPM Access Functions
  *****************************************************************************/
@@ -323,6 +353,116 @@ static int msm_mpm_set_irq_type(struct irq_data *d, unsigned int flow_type)
 	return rc;
 }
 
+/******************************************************************************
+ * Wakeup Latency Statistics
+ *****************************************************************************/
+
+#ifdef CONFIG_MSM_MPM_WAKEUP_STATS
+struct msm_mpm_wakeup_stats {
+	unsigned long long	wake_ns;	/* 0 once the handler ran */
+	unsigned long		count;
+	unsigned long long	total_ns;
+	unsigned long long	max_ns;
+};
+
+static struct msm_mpm_wakeup_stats msm_mpm_wakeup_stats[MSM_MPM_NR_MPM_IRQS];
+static DEFINE_SPINLOCK(msm_mpm_stats_lock);
+
+static void msm_mpm_stats_wake(unsigned int mpm_irq, unsigned long long now)
+{
+	msm_mpm_wakeup_stats[mpm_irq].wake_ns = now;
+}
+
+static void msm_mpm_stats_irq_entry(void *ignore, int irq,
+	struct irqaction *action)
+{
+	struct msm_mpm_wakeup_stats *stats;
+	unsigned long long delta;
+	unsigned int mpm_irq;
+	unsigned long flags;
+
+	if (irq >= MSM_MPM_NR_APPS_IRQS)
+		return;
+	mpm_irq = msm_mpm_irqs_a2m[irq];
+	if (!mpm_irq)
+		return;
+
+	stats = &msm_mpm_wakeup_stats[mpm_irq];
+	if (!stats->wake_ns)
+		return;
+
+	spin_lock_irqsave(&msm_mpm_stats_lock, flags);
+	if (stats->wake_ns) {
+		delta = sched_clock() - stats->wake_ns;
+		stats->wake_ns = 0;
+		stats->count++;
+		stats->total_ns += delta;
+		if (delta > stats->max_ns)
+			stats->max_ns = delta;
+	}
+	spin_unlock_irqrestore(&msm_mpm_stats_lock, flags);
+}
+
+static int msm_mpm_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_mpm_wakeup_stats *stats;
+	unsigned long flags;
+	unsigned long count;
+	unsigned long long total_ns, max_ns;
+	int i;
+
+	seq_printf(m, "pin  irq      count     avg_ns     max_ns\n");
+	for (i = 0; msm_mpm_is_valid_mpm_irq(i); i++) {
+		stats = &msm_mpm_wakeup_stats[i];
+
+		spin_lock_irqsave(&msm_mpm_stats_lock, flags);
+		count = stats->count;
+		total_ns = stats->total_ns;
+		max_ns = stats->max_ns;
+		spin_unlock_irqrestore(&msm_mpm_stats_lock, flags);
+
+		if (!count)
+			continue;
+		seq_printf(m, "%3d %4u %10lu %10llu %10llu\n", i,
+			msm_mpm_get_irq_m2a(i), count,
+			div_u64(total_ns, count), max_ns);
+	}
+
+	return 0;
+}
+
+static int msm_mpm_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_mpm_stats_show, NULL);
+}
+
+static const struct file_operations msm_mpm_stats_fops = {
+	.open		= msm_mpm_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init msm_mpm_stats_init(void)
+{
+	int rc;
+
+	rc = register_trace_irq_handler_entry(msm_mpm_stats_irq_entry, NULL);
+	if (rc) {
+		pr_err("%s: failed to register probe: %d\n", __func__, rc);
+		return rc;
+	}
+
+	debugfs_create_file("msm_mpm_wakeup_stats", S_IRUGO, NULL, NULL,
+			&msm_mpm_stats_fops);
+	return 0;
+}
+late_initcall(msm_mpm_stats_init);
+#else
+static inline void msm_mpm_stats_wake(unsigned int mpm_irq,
+	unsigned long long now) {}
+#endif
+
 /******************************************************************************
  * Public functions
  *****************************************************************************/
@@ -426,10 +566,15 @@ void msm_mpm_enter_sleep(bool from_idle)
 
 void msm_mpm_exit_sleep(bool from_idle)
 {
+	unsigned long long now = 0;
 	unsigned long pending;
 	int i;
 	int k;
 
+#ifdef CONFIG_MSM_MPM_WAKEUP_STATS
+	now = sched_clock();
+#endif
+
 	for (i = 0; i < MSM_MPM_REG_WIDTH; i++) {
 		pending = msm_mpm_read(MSM_MPM_STATUS_REG_PENDING, i);
 
@@ -440,14 +585,27 @@ void msm_mpm_exit_sleep(bool from_idle)
 		k = find_first_bit(&pending, 32);
 		while (k < 32) {
 			unsigned int mpm_irq = 32 * i + k;
-			unsigned int apps_irq = msm_mpm_get_irq_m2a(mpm_irq);
-			struct irq_desc *desc = apps_irq ?
-				irq_to_desc(apps_irq) : NULL;
+			struct irq_desc *desc = msm_mpm_pin_desc[mpm_irq];
+
+			if (desc)
+				msm_mpm_stats_wake(mpm_irq, now);
 
 			if (desc && !irqd_is_level_type(&desc->irq_data)) {
-				irq_set_pending(apps_irq);
-				if (from_idle)
-					check_irq_resend(desc, apps_irq);
+				unsigned int apps_irq = desc->irq_data.irq;
+
+				/*
+				 * Out of idle, a GIC interrupt can be latched
+				 * in the distributor directly; the rest goes
+				 * through the generic resend.
+				 */
+				if (from_idle && apps_irq < NR_MSM_IRQS) {
+					msm_mpm_gic_set_pending(apps_irq);
+				} else {
+					irq_set_pending(apps_irq);
+					if (from_idle)
+						check_irq_resend(desc,
+								apps_irq);
+				}
 			}
 
 			k = find_next_bit(&pending, 32, k + 1);
@@ -464,8 +622,12 @@ static int __init msm_mpm_early_init(void)
 
 	for (mpm_irq = 0; msm_mpm_is_valid_mpm_irq(mpm_irq); mpm_irq++) {
 		apps_irq = msm_mpm_get_irq_m2a(mpm_irq);
-		if (apps_irq && msm_mpm_is_valid_apps_irq(apps_irq))
+		if (apps_irq && msm_mpm_is_valid_apps_irq(apps_irq)) {
 			msm_mpm_set_irq_a2m(apps_irq, mpm_irq);
+			if (mpm_irq < MSM_MPM_NR_MPM_IRQS)
+				msm_mpm_pin_desc[mpm_irq] =
+					irq_to_desc(apps_irq);
+		}
 	}
 
 	return 0;
@@ -479,6 +641,7 @@ void msm_mpm_irq_extn_init(void)
 	gic_arch_extn.irq_disable = msm_mpm_disable_irq;
 	gic_arch_extn.irq_set_type = msm_mpm_set_irq_type;
 	gic_arch_extn.irq_set_wake = msm_mpm_set_irq_wake;
+	gic_arch_extn.irq_retrigger = msm_mpm_gic_retrigger;
 
 	msm_gpio_irq_extn.irq_mask = msm_mpm_disable_irq;
 	msm_gpio_irq_extn.irq_unmask = msm_mpm_enable_irq;
@@ -453,6 +453,14 @@ uint32_t msm_bus_scale_register_client(struct msm_bus_scale_pdata *pdata)
 		return 0;
 	}
 
+	client->src_iid = kcalloc(pdata->usecase->num_paths, sizeof(int),
+		GFP_KERNEL);
+	if (!client->src_iid) {
+		MSM_BUS_ERR("Error allocating client\n");
+		kfree(client);
+		return 0;
+	}
+
 	mutex_lock(&msm_bus_lock);
 	client->pdata = pdata;
 	client->curr = -1;
@@ -493,6 +501,7 @@ uint32_t msm_bus_scale_register_client(struct msm_bus_scale_pdata *pdata)
 				pdata->usecase->vectors[i].dst);
 			goto err;
 		}
+		client->src_iid[i] = src;
 		srcfab = msm_bus_get_fabric_device(GET_FABID(src));
 		srcfab->visited = true;
 		pnode[i] = getpath(src, dest);
@@ -510,6 +519,7 @@ uint32_t msm_bus_scale_register_client(struct msm_bus_scale_pdata *pdata)
 	return (uint32_t)(client);
 err:
 	kfree(client->src_pnode);
+	kfree(client->src_iid);
 	kfree(client);
 	mutex_unlock(&msm_bus_lock);
 	return 0;
@@ -517,29 +527,26 @@ err:
 EXPORT_SYMBOL(msm_bus_scale_register_client);
 
 /**
- * msm_bus_scale_client_update_request() - Update the request for bandwidth
- * from a particular client
- *
- * cl: Handle to the client
- * index: Index into the vector, to which the bw and clock values need to be
+ * update_request() - Apply a new usecase of a client to the fabric nodes
+ * @client: Client whose request is being updated
+ * @index: Index into the vector, to which the bw and clock values need to be
  * updated
+ *
+ * Only the vectors whose ab or ib differ from the current usecase are
+ * walked, the others would add a zero delta along their path. Nothing is
+ * sent to the RPM here, the caller commits once it is done with all of its
+ * updates. Returns the number of paths that were updated, or an error.
+ * Must be called with msm_bus_lock held.
  */
-int msm_bus_scale_client_update_request(uint32_t cl, unsigned index)
+static int update_request(struct msm_bus_client *client, unsigned index)
 {
-	int i, ret = 0;
+	int i, ret = 0, updated = 0;
 	struct msm_bus_scale_pdata *pdata;
-	int pnode, src, curr, ctx;
+	int pnode, src, curr;
 	unsigned long req_clk, req_bw, curr_clk, curr_bw;
-	struct msm_bus_client *client = (struct msm_bus_client *)cl;
-	if (IS_ERR(client)) {
-		MSM_BUS_ERR("msm_bus_scale_client update req error %d\n",
-				(uint32_t)client);
-		return -ENXIO;
-	}
 
-	mutex_lock(&msm_bus_lock);
 	if (client->curr == index)
-		goto err;
+		return 0;
 
 	curr = client->curr;
 	pdata = client->pdata;
@@ -547,31 +554,16 @@ int msm_bus_scale_client_update_request(uint32_t cl, unsigned index)
 	if (index >= pdata->num_usecases) {
 		MSM_BUS_ERR("Client %u passed invalid index: %d\n",
 			(uint32_t)client, index);
-		ret = -ENXIO;
-		goto err;
+		return -ENXIO;
 	}
 
 	MSM_BUS_DBG("cl: %u index: %d curr: %d"
-			" num_paths: %d\n", cl, index, client->curr,
-			client->pdata->usecase->num_paths);
+			" num_paths: %d\n", (uint32_t)client, index,
+			client->curr, client->pdata->usecase->num_paths);
 
 	for (i = 0; i < pdata->usecase->num_paths; i++) {
-		src = msm_bus_board_get_iid(client->pdata->usecase[index].
-			vectors[i].src);
-		if (src == -ENXIO) {
-			MSM_BUS_ERR("Master %d not supported. Request cannot"
-				" be updated\n", client->pdata->usecase->
-				vectors[i].src);
-			goto err;
-		}
-
-		if (msm_bus_board_get_iid(client->pdata->usecase[index].
-			vectors[i].dst) == -ENXIO) {
-			MSM_BUS_ERR("Slave %d not supported. Request cannot"
-				" be updated\n", client->pdata->usecase->
-				vectors[i].dst);
-		}
-
+		/* The path was looked up once when the client registered */
+		src = client->src_iid[i];
 		pnode = client->src_pnode[i];
 		req_clk = client->pdata->usecase[index].vectors[i].ib;
 		req_bw = client->pdata->usecase[index].vectors[i].ab;
@@ -584,12 +576,15 @@ int msm_bus_scale_client_update_request(uint32_t cl, unsigned index)
 			MSM_BUS_DBG("ab: %lu ib: %lu\n", curr_bw, curr_clk);
 		}
 
+		if (req_clk == curr_clk && req_bw == curr_bw)
+			continue;
+
 		if (!pdata->active_only) {
 			ret = update_path(src, pnode, req_clk, req_bw,
 				curr_clk, curr_bw, 0, pdata->active_only);
 			if (ret) {
 				MSM_BUS_ERR("Update path failed! %d\n", ret);
-				goto err;
+				return ret;
 			}
 		}
 
@@ -597,21 +592,84 @@ int msm_bus_scale_client_update_request(uint32_t cl, unsigned index)
 				curr_bw, ACTIVE_CTX, pdata->active_only);
 		if (ret) {
 			MSM_BUS_ERR("Update Path failed! %d\n", ret);
-			goto err;
+			return ret;
 		}
+		updated++;
 	}
 
 	client->curr = index;
-	ctx = ACTIVE_CTX;
-	msm_bus_dbg_client_data(client->pdata, index, cl);
-	bus_for_each_dev(&msm_bus_type, NULL, NULL, msm_bus_commit_fn);
+	msm_bus_dbg_client_data(client->pdata, index, (uint32_t)client);
+	return updated;
+}
 
-err:
+/**
+ * msm_bus_scale_client_update_request() - Update the request for bandwidth
+ * from a particular client
+ *
+ * cl: Handle to the client
+ * index: Index into the vector, to which the bw and clock values need to be
+ * updated
+ */
+int msm_bus_scale_client_update_request(uint32_t cl, unsigned index)
+{
+	int ret;
+	struct msm_bus_client *client = (struct msm_bus_client *)cl;
+	if (IS_ERR(client)) {
+		MSM_BUS_ERR("msm_bus_scale_client update req error %d\n",
+				(uint32_t)client);
+		return -ENXIO;
+	}
+
+	mutex_lock(&msm_bus_lock);
+	ret = update_request(client, index);
+	if (ret > 0)
+		bus_for_each_dev(&msm_bus_type, NULL, NULL, msm_bus_commit_fn);
 	mutex_unlock(&msm_bus_lock);
-	return ret;
+	return ret < 0 ? ret : 0;
 }
 EXPORT_SYMBOL(msm_bus_scale_client_update_request);
 
+/**
+ * msm_bus_scale_client_update_requests() - Update the requests of several
+ * clients at once
+ * @cl: Array of client handles
+ * @index: Array of usecase indices, one for each client in @cl
+ * @num: Number of entries in @cl and @index
+ *
+ * All of the updates are aggregated at the fabric nodes first, and the
+ * fabrics are then committed to the RPM only once. Use this instead of
+ * back to back msm_bus_scale_client_update_request() calls when a driver
+ * owns several clients that always change together. If one of the updates
+ * fails, the ones before it are still committed.
+ */
+int msm_bus_scale_client_update_requests(const uint32_t *cl,
+	const unsigned int *index, int num)
+{
+	int i, ret = 0, updated = 0;
+
+	mutex_lock(&msm_bus_lock);
+	for (i = 0; i < num; i++) {
+		struct msm_bus_client *client = (struct msm_bus_client *)cl[i];
+		if (IS_ERR_OR_NULL(client)) {
+			MSM_BUS_ERR("msm_bus_scale_client update req error "
+				"%d\n", (uint32_t)client);
+			ret = -ENXIO;
+			break;
+		}
+
+		ret = update_request(client, index[i]);
+		if (ret < 0)
+			break;
+		updated += ret;
+	}
+
+	if (updated)
+		bus_for_each_dev(&msm_bus_type, NULL, NULL, msm_bus_commit_fn);
+	mutex_unlock(&msm_bus_lock);
+	return ret < 0 ? ret : 0;
+}
+EXPORT_SYMBOL(msm_bus_scale_client_update_requests);
+
 int reset_pnodes(int curr, int pnode)
 {
 	struct msm_bus_inode_info *info;
@@ -677,16 +735,14 @@ int msm_bus_board_get_iid(int id)
 
 void msm_bus_scale_client_reset_pnodes(uint32_t cl)
 {
-	int i, src, pnode, index;
+	int i, src, pnode;
 	struct msm_bus_client *client = (struct msm_bus_client *)(cl);
 	if (IS_ERR(client)) {
 		MSM_BUS_ERR("msm_bus_scale_reset_pnodes error\n");
 		return;
 	}
-	index = 0;
 	for (i = 0; i < client->pdata->usecase->num_paths; i++) {
-		src = msm_bus_board_get_iid(
-			client->pdata->usecase[index].vectors[i].src);
+		src = client->src_iid[i];
 		pnode = client->src_pnode[i];
 		MSM_BUS_DBG("(%d, %d)\n", GET_NODE(pnode), GET_INDEX(pnode));
 		reset_pnodes(src, pnode);
@@ -710,6 +766,7 @@ void msm_bus_scale_unregister_client(uint32_t cl)
 	msm_bus_dbg_client_data(client->pdata, MSM_BUS_DBG_UNREGISTER, cl);
 	mutex_unlock(&msm_bus_lock);
 	kfree(client->src_pnode);
+	kfree(client->src_iid);
 	kfree(client);
 }
 EXPORT_SYMBOL(msm_bus_scale_unregister_client);
@@ -150,6 +150,7 @@ struct msm_bus_client {
 	int id;
 	struct msm_bus_scale_pdata *pdata;
 	int *src_pnode;
+	int *src_iid;
 	int curr;
 };
 
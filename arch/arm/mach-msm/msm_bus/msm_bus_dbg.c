@@ -18,6 +18,7 @@
 #include <linux/string.h>
 #include <linux/uaccess.h>
 #include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <mach/msm_bus_board.h>
 #include <mach/msm_bus.h>
 #include "msm_bus_core.h"
@@ -56,6 +57,23 @@ struct msm_bus_fab_list {
 LIST_HEAD(fabdata_list);
 LIST_HEAD(cl_list);
 
+/**
+ * Votes of all clients summed up per master, integrated over time so the
+ * average bandwidth a master asked for can be compared with its peak vote.
+ * Protected by msm_bus_dbg_cllist_lock.
+ */
+struct msm_bus_dbg_master {
+	uint64_t ab;
+	uint64_t ib;
+	uint64_t peak_ab;
+	uint64_t peak_ib;
+	uint64_t ab_ms;
+	s64 stamp;
+};
+
+static struct msm_bus_dbg_master masters[MSM_BUS_MASTER_LAST + 1];
+static s64 masters_reset_ms;
+
 /**
  * The following structures and funtions are used for
  * the test-client which can be created at run-time.
@@ -333,6 +351,48 @@ static int msm_bus_dbg_record_client(const struct msm_bus_scale_pdata *pdata,
 	return 0;
 }
 
+static void msm_bus_dbg_master_account(struct msm_bus_dbg_master *mas,
+	s64 now)
+{
+	mas->ab_ms += mas->ab * (now - mas->stamp);
+	mas->stamp = now;
+}
+
+/**
+ * msm_bus_dbg_update_masters() - Move the votes of a client from one
+ * usecase to another in the per master totals
+ * @pdata: Platform data of the client
+ * @curr: Usecase the client is leaving, negative if it had no vote
+ * @index: Usecase the client is entering, negative if it is going away
+ */
+static void msm_bus_dbg_update_masters(const struct msm_bus_scale_pdata *pdata,
+	int curr, int index)
+{
+	s64 now = ktime_to_ms(ktime_get());
+	int j;
+
+	for (j = 0; j < pdata->usecase->num_paths; j++) {
+		struct msm_bus_dbg_master *mas;
+		int src = pdata->usecase->vectors[j].src;
+
+		if (src < MSM_BUS_MASTER_FIRST || src > MSM_BUS_MASTER_LAST)
+			continue;
+
+		mas = &masters[src];
+		msm_bus_dbg_master_account(mas, now);
+		if (curr >= 0) {
+			mas->ab -= pdata->usecase[curr].vectors[j].ab;
+			mas->ib -= pdata->usecase[curr].vectors[j].ib;
+		}
+		if (index >= 0) {
+			mas->ab += pdata->usecase[index].vectors[j].ab;
+			mas->ib += pdata->usecase[index].vectors[j].ib;
+		}
+		mas->peak_ab = max(mas->peak_ab, mas->ab);
+		mas->peak_ib = max(mas->peak_ib, mas->ib);
+	}
+}
+
 static void msm_bus_dbg_free_client(uint32_t clid)
 {
 	struct msm_bus_cldata *cldata = NULL;
@@ -340,6 +400,8 @@ static void msm_bus_dbg_free_client(uint32_t clid)
 	mutex_lock(&msm_bus_dbg_cllist_lock);
 	list_for_each_entry(cldata, &cl_list, list) {
 		if (cldata->clid == clid) {
+			msm_bus_dbg_update_masters(cldata->pdata,
+				cldata->index, -1);
 			debugfs_remove(cldata->file);
 			list_del(&cldata->list);
 			kfree(cldata);
@@ -386,6 +448,9 @@ static int msm_bus_dbg_fill_cl_buffer(const struct msm_bus_scale_pdata *pdata,
 		i = 0;
 		cldata->size = 0;
 	}
+	msm_bus_dbg_update_masters(pdata, cldata->index, index);
+	cldata->index = index;
+
 	buf = cldata->buffer;
 	ts = ktime_to_timespec(ktime_get());
 	i += scnprintf(buf + i, MAX_BUFF_SIZE - i, "\n%d.%d\n",
@@ -592,6 +657,68 @@ static int msm_bus_dbg_fill_fab_buffer(const char *fabname,
 	return 0;
 }
 
+/**
+ * The following funtions are used for viewing the votes of each master
+ * over time
+ */
+static int master_data_show(struct seq_file *m, void *unused)
+{
+	s64 now, elapsed;
+	int i;
+
+	mutex_lock(&msm_bus_dbg_cllist_lock);
+	now = ktime_to_ms(ktime_get());
+	elapsed = max_t(s64, now - masters_reset_ms, 1);
+	seq_printf(m, "window: %lld ms\n", elapsed);
+	seq_printf(m, "%-6s %12s %12s %12s %12s %12s\n", "master", "ab",
+		"ib", "avg_ab", "peak_ab", "peak_ib");
+	for (i = MSM_BUS_MASTER_FIRST; i <= MSM_BUS_MASTER_LAST; i++) {
+		struct msm_bus_dbg_master *mas = &masters[i];
+
+		msm_bus_dbg_master_account(mas, now);
+		if (!mas->peak_ab && !mas->peak_ib)
+			continue;
+		seq_printf(m, "%-6d %12llu %12llu %12llu %12llu %12llu\n", i,
+			mas->ab, mas->ib, div64_u64(mas->ab_ms, elapsed),
+			mas->peak_ab, mas->peak_ib);
+	}
+	mutex_unlock(&msm_bus_dbg_cllist_lock);
+	return 0;
+}
+
+static int master_data_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, master_data_show, inode->i_private);
+}
+
+/* Any write starts a new window from the current votes */
+static ssize_t master_data_write(struct file *file, const char __user *ubuf,
+	size_t cnt, loff_t *ppos)
+{
+	s64 now;
+	int i;
+
+	mutex_lock(&msm_bus_dbg_cllist_lock);
+	now = ktime_to_ms(ktime_get());
+	masters_reset_ms = now;
+	for (i = MSM_BUS_MASTER_FIRST; i <= MSM_BUS_MASTER_LAST; i++) {
+		masters[i].ab_ms = 0;
+		masters[i].stamp = now;
+		masters[i].peak_ab = masters[i].ab;
+		masters[i].peak_ib = masters[i].ib;
+	}
+	mutex_unlock(&msm_bus_dbg_cllist_lock);
+	return cnt;
+}
+
+static const struct file_operations master_data_fops = {
+	.open		= master_data_open,
+	.read		= seq_read,
+	.write		= master_data_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static const struct file_operations msm_bus_dbg_update_request_fops = {
 	.open = client_data_open,
 	.write = msm_bus_dbg_update_request_write,
@@ -695,6 +822,9 @@ static int __init msm_bus_debugfs_init(void)
 	if (debugfs_create_file("update-request", S_IRUGO | S_IWUSR,
 		clients, NULL, &msm_bus_dbg_update_request_fops) == NULL)
 		goto err;
+	if (debugfs_create_file("master-data", S_IRUGO | S_IWUSR, dir,
+		NULL, &master_data_fops) == NULL)
+		goto err;
 
 	mutex_lock(&msm_bus_dbg_cllist_lock);
 	list_for_each_entry(cldata, &cl_list, list) {
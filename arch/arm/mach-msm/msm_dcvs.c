@@ -46,6 +46,10 @@ struct core_attribs {
 
 	struct kobj_attribute max_time_us;
 
+	struct kobj_attribute num_decisions;
+	struct kobj_attribute num_slack_fires;
+	struct kobj_attribute time_in_freq;
+
 	struct kobj_attribute slack_time_us;
 	struct kobj_attribute scale_slack_time;
 	struct kobj_attribute scale_slack_time_pct;
@@ -67,6 +71,14 @@ struct dcvs_core {
 
 	uint32_t max_time_us; /* core param */
 
+	/* stats */
+	uint32_t num_decisions;
+	uint32_t num_slack_fires;
+	struct msm_dcvs_freq_entry *freq_tbl;
+	uint32_t num_freq;
+	uint64_t *time_in_freq_us;
+	int64_t freq_stamp;
+
 	struct msm_dcvs_algo_param algo_param;
 	struct msm_dcvs_idle *idle_driver;
 	struct msm_dcvs_freq *freq_driver;
@@ -97,6 +109,25 @@ static DEFINE_MUTEX(core_list_lock);
 static struct kobject *cores_kobj;
 static struct dcvs_core *core_handles[CORES_MAX];
 
+/* Charge the time since the last change to the current freq, core locked */
+static void msm_dcvs_account_freq(struct dcvs_core *core, int64_t now)
+{
+	int64_t delta = now - core->freq_stamp;
+	int i;
+
+	core->freq_stamp = now;
+	if (!core->time_in_freq_us)
+		return;
+
+	for (i = 0; i < core->num_freq; i++) {
+		if (core->freq_tbl[i].freq == core->actual_freq) {
+			do_div(delta, NSEC_PER_USEC);
+			core->time_in_freq_us[i] += delta;
+			break;
+		}
+	}
+}
+
 /* Change core frequency, called with core mutex locked */
 static int __msm_dcvs_change_freq(struct dcvs_core *core)
 {
@@ -164,9 +195,10 @@ repeat:
 		return -EFAULT;
 	}
 
+	time_end = ktime_to_ns(ktime_get());
+	msm_dcvs_account_freq(core, time_end);
 	prev_freq = core->actual_freq;
 	core->actual_freq = ret;
-	time_end = ktime_to_ns(ktime_get());
 	if (msm_dcvs_debug & MSM_DCVS_DEBUG_FREQ_CHANGE)
 		__info("Core %s Time end %llu Time start: %llu\n",
 			core->core_name, time_end, time_start);
@@ -282,6 +314,7 @@ static int msm_dcvs_update_freq(struct dcvs_core *core,
 		if (core->freq_pending >= MAX_PENDING - 1)
 			core->freq_pending = MAX_PENDING - 1;
 		core->new_freq[core->freq_pending++] = new_freq;
+		core->num_decisions++;
 		core->time_start = ktime_to_ns(ktime_get());
 
 		/* Schedule the frequency change */
@@ -304,6 +337,7 @@ static enum hrtimer_restart msm_dcvs_core_slack_timer(struct hrtimer *timer)
 
 	if (msm_dcvs_debug & MSM_DCVS_DEBUG_FREQ_CHANGE)
 		__info("Slack timer fired for core %s\n", core->core_name);
+	core->num_slack_fires++;
 
 	/**
 	 * Timer expired, notify TZ
@@ -385,6 +419,28 @@ DCVS_PARAM_SHOW(freq_change_enabled, (core->freq_driver != NULL))
 DCVS_PARAM_SHOW(actual_freq, (core->actual_freq))
 DCVS_PARAM_SHOW(freq_change_us, (core->freq_change_us))
 DCVS_PARAM_SHOW(max_time_us, (core->max_time_us))
+DCVS_PARAM_SHOW(num_decisions, (core->num_decisions))
+DCVS_PARAM_SHOW(num_slack_fires, (core->num_slack_fires))
+
+/* One "<freq kHz> <time us>" line per frequency, like cpufreq stats */
+static ssize_t msm_dcvs_attr_time_in_freq_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct dcvs_core *core = CORE_FROM_ATTRIBS(attr, time_in_freq);
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&core->lock);
+	if (core->freq_driver)
+		msm_dcvs_account_freq(core, ktime_to_ns(ktime_get()));
+	for (i = 0; i < core->num_freq && core->time_in_freq_us; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "%u %llu\n",
+				core->freq_tbl[i].freq,
+				core->time_in_freq_us[i]);
+	mutex_unlock(&core->lock);
+
+	return len;
+}
 
 DCVS_ALGO_PARAM(slack_time_us)
 DCVS_ALGO_PARAM(scale_slack_time)
@@ -400,7 +456,7 @@ static int msm_dcvs_setup_core_sysfs(struct dcvs_core *core)
 {
 	int ret = 0;
 	struct kobject *core_kobj = NULL;
-	const int attr_count = 15;
+	const int attr_count = 18;
 
 	BUG_ON(!cores_kobj);
 
@@ -428,7 +484,11 @@ static int msm_dcvs_setup_core_sysfs(struct dcvs_core *core)
 	DCVS_RW_ATTRIB(12, ss_util_pct);
 	DCVS_RW_ATTRIB(13, ss_iobusy_conv);
 
-	core->attrib.attrib_group.attrs[14] = NULL;
+	DCVS_RO_ATTRIB(14, num_decisions);
+	DCVS_RO_ATTRIB(15, num_slack_fires);
+	DCVS_RO_ATTRIB(16, time_in_freq);
+
+	core->attrib.attrib_group.attrs[17] = NULL;
 
 	core_kobj = kobject_create_and_add(core->core_name, cores_kobj);
 	if (!core_kobj) {
@@ -525,6 +585,19 @@ int msm_dcvs_register_core(const char *core_name, uint32_t group_id,
 	memcpy(&core->algo_param, &info->algo_param,
 			sizeof(struct msm_dcvs_algo_param));
 
+	if (core->num_freq != info->core_param.num_freq) {
+		kfree(core->time_in_freq_us);
+		core->time_in_freq_us = kzalloc(info->core_param.num_freq *
+				sizeof(uint64_t), GFP_KERNEL);
+		if (!core->time_in_freq_us) {
+			core->num_freq = 0;
+			ret = -ENOMEM;
+			goto bail;
+		}
+	}
+	core->freq_tbl = info->freq_tbl;
+	core->num_freq = info->core_param.num_freq;
+
 	ret = msm_dcvs_scm_register_core(core->handle, group_id,
 			&info->core_param, info->freq_tbl);
 	if (ret)
@@ -564,6 +637,7 @@ int msm_dcvs_freq_sink_register(struct msm_dcvs_freq *drv)
 		__info("Frequency notifier for %s being replaced\n",
 				core->core_name);
 	core->freq_driver = drv;
+	core->freq_stamp = ktime_to_ns(ktime_get());
 	core->task = kthread_create(msm_dcvs_do_freq, (void *)core,
 			"msm_dcvs/%d", core->handle);
 	if (IS_ERR(core->task)) {
@@ -615,6 +689,7 @@ int msm_dcvs_freq_sink_unregister(struct msm_dcvs_freq *drv)
 			__info("Enabling LPM for %s\n", core->core_name);
 	}
 	core->freq_pending = 0;
+	msm_dcvs_account_freq(core, ktime_to_ns(ktime_get()));
 	core->freq_driver = NULL;
 	mutex_unlock(&core->lock);
 	kthread_stop(core->task);
@@ -12,6 +12,7 @@
 
 #include <linux/kexec.h>
 #include <linux/io.h>
+#include <linux/init.h>
 
 #ifdef CONFIG_MSM_WATCHDOG
 #include <mach/msm_iomap.h>
@@ -19,6 +20,10 @@
 #define WDT0_EN        (MSM_TMR_BASE + 0x40)
 #endif
 
+#ifdef CONFIG_MSM_PIL
+#include "peripheral-loader.h"
+#endif
+
 void arch_kexec(void)
 {
 #ifdef CONFIG_MSM_WATCHDOG
@@ -28,3 +33,24 @@ void arch_kexec(void)
 #endif
 	return;
 }
+
+#ifdef CONFIG_MSM_PIL
+/*
+ * device_shutdown() leaves the peripherals running their images out of
+ * the reserved regions, still writing to shared memory. Stop them before
+ * jumping, so the new kernel starts from the same state as after the
+ * bootloader and brings them up again through PIL.
+ */
+static void msm_kexec_reinit(void)
+{
+	msm_pil_shutdown_all();
+	pr_crit("KEXEC: peripherals shut down\n");
+}
+
+static int __init msm_kexec_init(void)
+{
+	kexec_reinit = msm_kexec_reinit;
+	return 0;
+}
+arch_initcall(msm_kexec_init);
+#endif
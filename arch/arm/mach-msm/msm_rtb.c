@@ -48,6 +48,11 @@ struct msm_rtb_layout {
 } __attribute__ ((__packed__));
 
 
+/*
+ * With CONFIG_MSM_RTB_SEPARATE_CPUS the buffer is split in one segment per
+ * possible cpu, of nentries each, and each cpu only ever writes its own
+ * segment. idx is then the sequence number of the entry on its cpu.
+ */
 struct msm_rtb_state {
 	struct msm_rtb_layout *rtb;
 	unsigned long phys;
@@ -56,7 +61,6 @@ struct msm_rtb_state {
 	int enabled;
 	int initialized;
 	uint32_t filter;
-	int step_size;
 };
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
@@ -70,13 +74,55 @@ struct msm_rtb_state msm_rtb = {
 	.enabled = 1,
 };
 
-module_param_named(filter, msm_rtb.filter, uint, 0644);
-module_param_named(enable, msm_rtb.enabled, int, 0644);
+/*
+ * The filter actually applied: filter, restricted to the events compiled
+ * in, or 0 while disabled. It is all the logging fast path looks at.
+ */
+uint32_t msm_rtb_active_filter;
+EXPORT_SYMBOL(msm_rtb_active_filter);
+
+static void msm_rtb_update_filter(void)
+{
+	msm_rtb_active_filter = (msm_rtb.initialized && msm_rtb.enabled) ?
+		msm_rtb.filter & CONFIG_MSM_RTB_COMPILE_FILTER : 0;
+}
+
+static int msm_rtb_set_filter(const char *val, const struct kernel_param *kp)
+{
+	int ret;
+
+	ret = param_set_uint(val, kp);
+	if (!ret)
+		msm_rtb_update_filter();
+	return ret;
+}
+
+static int msm_rtb_set_enable(const char *val, const struct kernel_param *kp)
+{
+	int ret;
+
+	ret = param_set_int(val, kp);
+	if (!ret)
+		msm_rtb_update_filter();
+	return ret;
+}
+
+static struct kernel_param_ops msm_rtb_filter_ops = {
+	.set = msm_rtb_set_filter,
+	.get = param_get_uint,
+};
+
+static struct kernel_param_ops msm_rtb_enable_ops = {
+	.set = msm_rtb_set_enable,
+	.get = param_get_int,
+};
+
+module_param_cb(filter, &msm_rtb_filter_ops, &msm_rtb.filter, 0644);
+module_param_cb(enable, &msm_rtb_enable_ops, &msm_rtb.enabled, 0644);
 
 int msm_rtb_event_should_log(enum logk_event_type log_type)
 {
-	return msm_rtb.initialized && msm_rtb.enabled &&
-		((1 << log_type) & msm_rtb.filter);
+	return msm_rtb_event_enabled(log_type);
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
@@ -110,48 +156,48 @@ static void msm_rtb_write_data(void *data, struct msm_rtb_layout *start)
 }
 
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
-static int msm_rtb_get_idx(void)
+static struct msm_rtb_layout *msm_rtb_get_entry(int *idx)
 {
 	int cpu, i;
-	atomic_t *index;
 
 	/*
 	 * ideally we would use get_cpu but this is a close enough
-	 * approximation for our purposes.
+	 * approximation for our purposes: the index is atomic, a task
+	 * migrated in between only writes an entry of the cpu it left.
+	 * The index of each cpu has its own cache line, there is no
+	 * contention on it.
 	 */
 	cpu = raw_smp_processor_id();
 
-	index = &per_cpu(msm_rtb_idx_cpu, cpu);
-
-	i = atomic_add_return(msm_rtb.step_size, index);
-	i -= msm_rtb.step_size;
+	i = atomic_inc_return(&per_cpu(msm_rtb_idx_cpu, cpu)) - 1;
+	*idx = i;
 
-	return i;
+	return &msm_rtb.rtb[cpu * msm_rtb.nentries +
+			(i & (msm_rtb.nentries - 1))];
 }
 #else
-static int msm_rtb_get_idx(void)
+static struct msm_rtb_layout *msm_rtb_get_entry(int *idx)
 {
 	int i;
 
 	i = atomic_inc_return(&msm_rtb_idx);
 	i--;
+	*idx = i;
 
-	return i;
+	return &msm_rtb.rtb[i & (msm_rtb.nentries - 1)];
 }
 #endif
 
-int uncached_logk_pc(enum logk_event_type log_type, void *caller,
+int __uncached_logk_pc(enum logk_event_type log_type, void *caller,
 				void *data)
 {
 	int i;
 	struct msm_rtb_layout *start;
 
-	if (!msm_rtb_event_should_log(log_type))
+	if (!msm_rtb_event_enabled(log_type))
 		return 0;
 
-	i = msm_rtb_get_idx();
-
-	start = &msm_rtb.rtb[i & (msm_rtb.nentries - 1)];
+	start = msm_rtb_get_entry(&i);
 
 	msm_rtb_emit_sentinel(start);
 	msm_rtb_write_type(log_type, start);
@@ -162,13 +208,13 @@ int uncached_logk_pc(enum logk_event_type log_type, void *caller,
 
 	return 1;
 }
-EXPORT_SYMBOL(uncached_logk_pc);
+EXPORT_SYMBOL(__uncached_logk_pc);
 
-noinline int uncached_logk(enum logk_event_type log_type, void *data)
+noinline int __uncached_logk(enum logk_event_type log_type, void *data)
 {
-	return uncached_logk_pc(log_type, __builtin_return_address(0), data);
+	return __uncached_logk_pc(log_type, __builtin_return_address(0), data);
 }
-EXPORT_SYMBOL(uncached_logk);
+EXPORT_SYMBOL(__uncached_logk);
 
 int msm_rtb_probe(struct platform_device *pdev)
 {
@@ -200,6 +246,9 @@ int msm_rtb_probe(struct platform_device *pdev)
 	}
 
 	msm_rtb.nentries = msm_rtb.size / sizeof(struct msm_rtb_layout);
+#if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
+	msm_rtb.nentries /= num_possible_cpus();
+#endif
 
 	/* Round this down to a power of 2 */
 	msm_rtb.nentries = __rounddown_pow_of_two(msm_rtb.nentries);
@@ -210,16 +259,15 @@ int msm_rtb_probe(struct platform_device *pdev)
 #if defined(CONFIG_MSM_RTB_SEPARATE_CPUS)
 	for_each_possible_cpu(cpu) {
 		atomic_t *a = &per_cpu(msm_rtb_idx_cpu, cpu);
-		atomic_set(a, cpu);
+		atomic_set(a, 0);
 	}
-	msm_rtb.step_size = num_possible_cpus();
 #else
 	atomic_set(&msm_rtb_idx, 0);
-	msm_rtb.step_size = 1;
 #endif
 
 
 	msm_rtb.initialized = 1;
+	msm_rtb_update_filter();
 	return 0;
 }
 
@@ -14,9 +14,72 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 
 int msm_show_resume_irq_mask;
 
 module_param_named(
 	debug_mask, msm_show_resume_irq_mask, int, S_IRUGO | S_IWUSR | S_IWGRP
 );
+
+/*
+ * Number of resumes each interrupt was pending at, whatever debug_mask,
+ * listed in debugfs msm_resume_irqs to find what keeps waking the system.
+ */
+static unsigned int resume_irq_count[NR_IRQS];
+static DEFINE_SPINLOCK(resume_irq_lock);
+
+void msm_show_resume_irq_record(unsigned int irq)
+{
+	unsigned long flags;
+
+	if (irq >= NR_IRQS)
+		return;
+
+	spin_lock_irqsave(&resume_irq_lock, flags);
+	resume_irq_count[irq]++;
+	spin_unlock_irqrestore(&resume_irq_lock, flags);
+}
+
+static int msm_resume_irqs_show(struct seq_file *m, void *unused)
+{
+	struct irq_desc *desc;
+	unsigned int irq, count;
+
+	seq_printf(m, "irq\tcount\tname\n");
+	for (irq = 0; irq < NR_IRQS; irq++) {
+		count = ACCESS_ONCE(resume_irq_count[irq]);
+		if (!count)
+			continue;
+
+		desc = irq_to_desc(irq);
+		seq_printf(m, "%u\t%u\t%s\n", irq, count,
+			   desc && desc->action && desc->action->name ?
+			   desc->action->name : "-");
+	}
+	return 0;
+}
+
+static int msm_resume_irqs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_resume_irqs_show, NULL);
+}
+
+static const struct file_operations msm_resume_irqs_fops = {
+	.open = msm_resume_irqs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_show_resume_irq_init(void)
+{
+	debugfs_create_file("msm_resume_irqs", S_IRUGO, NULL, NULL,
+			    &msm_resume_irqs_fops);
+	return 0;
+}
+late_initcall(msm_show_resume_irq_init);
@@ -53,6 +53,8 @@
 static void __iomem *msm_tmr0_base;
 
 static unsigned long delay_time;
+static unsigned long fallback_time;
+static unsigned long pet_time;
 static unsigned long bark_time;
 static unsigned long long last_pet;
 
@@ -93,6 +95,16 @@ module_param(appsbark, int, 0);
 static int print_all_stacks = 1;
 module_param(print_all_stacks, int,  S_IRUGO | S_IWUSR);
 
+/*
+ * With /sys/module/msm_watchdog/parameters/idle_pet set, the periodic pet
+ * doesn't wake an idle cpu0 up: it is deferrable, and cpu0 pets on its way
+ * into idle when the last pet is older than half the pet time. A regular
+ * timer still pets shortly before the bark time, for when cpu0 sleeps
+ * through all of it.
+ */
+static int idle_pet;
+module_param(idle_pet, int, S_IRUGO | S_IWUSR);
+
 /* Area for context dump in secure mode */
 static unsigned long scm_regsave;	/* phys */
 
@@ -101,6 +113,7 @@ static struct msm_watchdog_pdata __percpu **percpu_pdata;
 static void pet_watchdog_work(struct work_struct *work);
 static void init_watchdog_work(struct work_struct *work);
 static DECLARE_DELAYED_WORK(dogwork_struct, pet_watchdog_work);
+static DECLARE_DEFERRED_WORK(dogwork_deferred, pet_watchdog_work);
 static DECLARE_WORK(init_dogwork_struct, init_watchdog_work);
 
 static int msm_watchdog_suspend(struct device *dev)
@@ -192,6 +205,7 @@ static int wdog_enable_set(const char *val, struct kernel_param *kp)
 					&touch_watchdog_notifier_head,
 					&touch_nmi_blk);
 			cancel_delayed_work(&dogwork_struct);
+			cancel_delayed_work(&dogwork_deferred);
 			/* may be suspended after the first write above */
 			__raw_writel(0, msm_tmr0_base + WDT0_EN);
 			printk(KERN_INFO "MSM Watchdog deactivated.\n");
@@ -232,12 +246,33 @@ void pet_watchdog(void)
 	last_pet = time_ns;
 }
 
+/* serves both dogwork_struct and, in idle_pet mode, dogwork_deferred */
 static void pet_watchdog_work(struct work_struct *work)
 {
 	pet_watchdog();
 
-	if (enable)
-		schedule_delayed_work_on(0, &dogwork_struct, delay_time);
+	if (!enable)
+		return;
+
+	if (idle_pet)
+		schedule_delayed_work_on(0, &dogwork_deferred, delay_time);
+	/* the regular work is pushed back by every pet from either work */
+	cancel_delayed_work(&dogwork_struct);
+	schedule_delayed_work_on(0, &dogwork_struct,
+				 idle_pet ? fallback_time : delay_time);
+}
+
+/* Called by cpu0 with interrupts disabled, before it goes idle */
+void msm_watchdog_idle_pet(void)
+{
+	if (!idle_pet || !enable || !msm_tmr0_base)
+		return;
+	if (smp_processor_id() != 0)
+		return;
+	if (sched_clock() - last_pet < pet_time * (1000000ULL / 2))
+		return;
+
+	pet_watchdog();
 }
 
 static int msm_watchdog_remove(struct platform_device *pdev)
@@ -872,7 +907,10 @@ static int msm_watchdog_probe(struct platform_device *pdev)
 	if (cpu_is_msm9615())
 		__raw_writel(0xF, MSM_TCSR_BASE + TCSR_WDT_CFG);
 
+	pet_time = pdata->pet_time;
 	delay_time = msecs_to_jiffies(pdata->pet_time);
+	fallback_time = msecs_to_jiffies(max(pdata->pet_time,
+				pdata->bark_time - pdata->bark_time / 8));
 	schedule_work_on(0, &init_dogwork_struct);
 	return 0;
 }
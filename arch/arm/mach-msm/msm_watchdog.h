@@ -23,8 +23,10 @@ struct msm_watchdog_pdata {
 
 #ifdef CONFIG_MSM_WATCHDOG
 void pet_watchdog(void);
+void msm_watchdog_idle_pet(void);
 #else
 static inline void pet_watchdog(void) { }
+static inline void msm_watchdog_idle_pet(void) { }
 #endif
 
 #ifdef CONFIG_MSM_WATCHDOG_CTX_PRINT
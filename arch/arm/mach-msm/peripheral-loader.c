@@ -22,8 +22,10 @@
 #include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/rwsem.h>
+#include <linux/workqueue.h>
 
 #include <mach/socinfo.h>
+#include <mach/peripheral-loader.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
@@ -36,8 +38,19 @@ struct pil_device {
 	int count;
 	struct mutex lock;
 	struct list_head list;
+	const struct firmware **fw_cache;
+	unsigned fw_cache_size;
 };
 
+/*
+ * Keep the mdt and blobs of a peripheral after it has been loaded so a
+ * subsystem restart doesn't have to go back to the filesystem. This costs
+ * as much memory as the images themselves. Clear it to drop the cached
+ * images the next time each peripheral is loaded.
+ */
+static int cache_images;
+module_param(cache_images, int, S_IRUGO | S_IWUSR);
+
 static DEFINE_MUTEX(pil_list_lock);
 static LIST_HEAD(pil_list);
 
@@ -65,6 +78,52 @@ static struct pil_device *find_peripheral(const char *str)
 	return dev;
 }
 
+/*
+ * Firmware files are kept in slots of the cache, the mdt in slot 0 and
+ * blob n in slot n + 1. Called with pil->lock held.
+ */
+static int pil_request_fw(struct pil_device *pil, unsigned slot,
+		const char *name, const struct firmware **fw)
+{
+	if (slot < pil->fw_cache_size && pil->fw_cache[slot]) {
+		*fw = pil->fw_cache[slot];
+		return 0;
+	}
+
+	return request_firmware(fw, name, pil->desc->dev);
+}
+
+static void pil_release_fw(struct pil_device *pil, unsigned slot,
+		const struct firmware *fw, int err)
+{
+	if (!fw)
+		return;
+
+	/* Don't hold on to images that failed to load */
+	if (cache_images && !err) {
+		if (slot >= pil->fw_cache_size) {
+			const struct firmware **cache;
+
+			cache = krealloc(pil->fw_cache,
+				(slot + 1) * sizeof(*cache), GFP_KERNEL);
+			if (!cache)
+				goto release;
+			memset(cache + pil->fw_cache_size, 0,
+				(slot + 1 - pil->fw_cache_size) *
+				sizeof(*cache));
+			pil->fw_cache = cache;
+			pil->fw_cache_size = slot + 1;
+		}
+		pil->fw_cache[slot] = fw;
+		return;
+	}
+
+release:
+	if (slot < pil->fw_cache_size)
+		pil->fw_cache[slot] = NULL;
+	release_firmware(fw);
+}
+
 #define IOMAP_SIZE SZ_4M
 
 static int load_segment(const struct elf32_phdr *phdr, unsigned num,
@@ -90,7 +149,7 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 			snprintf(fw_name, sizeof(fw_name), "%s.b%02d",
 					pil->desc->name, num);
 
-		ret = request_firmware(&fw, fw_name, pil->desc->dev);
+		ret = pil_request_fw(pil, num + 1, fw_name, &fw);
 		if (ret) {
 			dev_err(pil->desc->dev, "Failed to locate blob %s\n",
 					fw_name);
@@ -155,7 +214,7 @@ static int load_segment(const struct elf32_phdr *phdr, unsigned num,
 		dev_err(pil->desc->dev, "Blob %u failed verification\n", num);
 
 release_fw:
-	release_firmware(fw);
+	pil_release_fw(pil, num + 1, fw, ret);
 	return ret;
 }
 
@@ -169,7 +228,40 @@ static int segment_is_loadable(const struct elf32_phdr *p)
 /* Sychronize request_firmware() with suspend */
 static DECLARE_RWSEM(pil_pm_rwsem);
 
-static int load_image(struct pil_device *pil)
+/*
+ * A peripheral only has to wait for the one it depends on before it is
+ * taken out of reset, so its dependency is booted from a worker while
+ * its own image is being loaded.
+ */
+struct pil_boot {
+	struct work_struct work;
+	struct pil_device *pil;
+	void *ret;
+};
+
+static void pil_boot_work(struct work_struct *work)
+{
+	struct pil_boot *boot = container_of(work, struct pil_boot, work);
+
+	boot->ret = pil_get(boot->pil->desc->name);
+}
+
+static void pil_boot_start(struct pil_boot *boot, struct pil_device *pil)
+{
+	boot->pil = pil;
+	boot->ret = NULL;
+	INIT_WORK_ONSTACK(&boot->work, pil_boot_work);
+	queue_work(system_unbound_wq, &boot->work);
+}
+
+/* Wait for a dependency to come out of reset. Safe to call more than once. */
+static int pil_boot_wait(struct pil_boot *boot)
+{
+	flush_work(&boot->work);
+	return IS_ERR(boot->ret) ? PTR_ERR(boot->ret) : 0;
+}
+
+static int load_image(struct pil_device *pil, struct pil_boot *dep)
 {
 	int i, ret;
 	char fw_name[30];
@@ -186,7 +278,7 @@ static int load_image(struct pil_device *pil)
 	} else
 		snprintf(fw_name, sizeof(fw_name), "%s.mdt", pil->desc->name);
 
-	ret = request_firmware(&fw, fw_name, pil->desc->dev);
+	ret = pil_request_fw(pil, 0, fw_name, &fw);
 	if (ret) {
 		dev_err(pil->desc->dev, "Failed to locate %s\n", fw_name);
 		goto out;
@@ -236,18 +328,31 @@ static int load_image(struct pil_device *pil)
 		}
 	}
 
+release_fw:
+	pil_release_fw(pil, 0, fw, ret);
+out:
+	up_read(&pil_pm_rwsem);
+
+	/*
+	 * Don't wait for the dependency with pil_pm_rwsem held, it takes
+	 * the rwsem itself and a suspend could be waiting for it in between.
+	 */
+	if (dep) {
+		int dep_ret = pil_boot_wait(dep);
+		if (!ret)
+			ret = dep_ret;
+	}
+	if (ret)
+		return ret;
+
 	ret = pil->desc->ops->auth_and_reset(pil->desc);
 	if (ret) {
 		dev_err(pil->desc->dev, "Failed to bring out of reset\n");
-		goto release_fw;
+		return ret;
 	}
 	dev_info(pil->desc->dev, "brought out of reset\n");
 
-release_fw:
-	release_firmware(fw);
-out:
-	up_read(&pil_pm_rwsem);
-	return ret;
+	return 0;
 }
 
 /**
@@ -264,6 +369,7 @@ void *pil_get(const char *name)
 	int ret;
 	struct pil_device *pil;
 	struct pil_device *pil_d;
+	struct pil_boot dep;
 	void *retval;
 
 	/* PIL is not yet supported on 8064. */
@@ -275,27 +381,25 @@ void *pil_get(const char *name)
 		return ERR_PTR(-ENODEV);
 
 	pil_d = find_peripheral(pil->desc->depends_on);
-	if (pil_d) {
-		void *p = pil_get(pil_d->desc->name);
-		if (IS_ERR(p))
-			return p;
-	}
+	if (pil_d)
+		pil_boot_start(&dep, pil_d);
 
 	mutex_lock(&pil->lock);
-	if (pil->count) {
-		pil->count++;
-		goto unlock;
-	}
+	if (pil->count)
+		ret = pil_d ? pil_boot_wait(&dep) : 0;
+	else
+		ret = load_image(pil, pil_d ? &dep : NULL);
 
-	ret = load_image(pil);
-	if (ret) {
+	if (ret)
 		retval = ERR_PTR(ret);
-		goto unlock;
-	}
-
-	pil->count++;
-unlock:
+	else
+		pil->count++;
 	mutex_unlock(&pil->lock);
+
+	if (pil_d) {
+		pil_boot_wait(&dep);
+		destroy_work_on_stack(&dep.work);
+	}
 	return retval;
 }
 EXPORT_SYMBOL(pil_get);
@@ -354,7 +458,7 @@ int pil_force_boot(const char *name)
 
 	mutex_lock(&pil->lock);
 	if (!WARN(!pil->count, "%s: Reference count mismatch\n", __func__))
-		ret = load_image(pil);
+		ret = load_image(pil, NULL);
 	mutex_unlock(&pil->lock);
 
 	return ret;
@@ -438,13 +542,33 @@ static int msm_pil_debugfs_init(void) { return 0; }
 static int msm_pil_debugfs_add(struct pil_device *pil) { return 0; }
 #endif
 
-static int msm_pil_shutdown_at_boot(void)
+static void __msm_pil_shutdown_all(void)
 {
 	struct pil_device *pil;
 
-	mutex_lock(&pil_list_lock);
 	list_for_each_entry(pil, &pil_list, list)
 		pil->desc->ops->shutdown(pil->desc);
+}
+
+/*
+ * Put every peripheral back in reset, whatever its reference count, for
+ * the kernel kexec hands the system to. Only the other cpus are stopped by
+ * then, so don't wait on a lock their tasks may never release.
+ */
+void msm_pil_shutdown_all(void)
+{
+	if (!mutex_trylock(&pil_list_lock)) {
+		pr_warn("pil: list busy, peripherals left running\n");
+		return;
+	}
+	__msm_pil_shutdown_all();
+	mutex_unlock(&pil_list_lock);
+}
+
+static int msm_pil_shutdown_at_boot(void)
+{
+	mutex_lock(&pil_list_lock);
+	__msm_pil_shutdown_all();
 	mutex_unlock(&pil_list_lock);
 
 	return 0;
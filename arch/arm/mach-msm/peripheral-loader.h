@@ -30,5 +30,6 @@ struct pil_reset_ops {
 };
 
 extern int msm_pil_register(struct pil_desc *desc);
+extern void msm_pil_shutdown_all(void);
 
 #endif
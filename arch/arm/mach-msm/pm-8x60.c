@@ -28,6 +28,10 @@
 #include <linux/uaccess.h>
 #include <linux/wakelock.h>
 #include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+#include <linux/sched.h>
 #include <mach/msm_iomap.h>
 #include <mach/system.h>
 #include <asm/cacheflush.h>
@@ -44,6 +48,7 @@
 #include "avs.h"
 #include <mach/cpuidle.h>
 #include "idle.h"
+#include "msm_watchdog.h"
 #include "pm.h"
 #include "rpm_resources.h"
 #include "scm-boot.h"
@@ -630,6 +635,145 @@ void msm_pm_set_max_sleep_time(int64_t max_sleep_time_ns)
 EXPORT_SYMBOL(msm_pm_set_max_sleep_time);
 
 
+/******************************************************************************
+ * Power Collapse Profiling
+ *****************************************************************************/
+
+/*
+ * Per CPU histograms of how long each C visible stage of power collapse
+ * takes. The cache clean and L2 flush run in msm_pm_collapse() right
+ * before WFI and can't be told apart from the sleep itself, so they are
+ * not covered. Off by default, set pc_profile to start collecting.
+ */
+enum msm_pm_pc_stage {
+	MSM_PM_PC_STAGE_RPM_ENTER,
+	MSM_PM_PC_STAGE_CLK_DOWN,
+	MSM_PM_PC_STAGE_SPM_CONFIG,
+	MSM_PM_PC_STAGE_WARM_BOOT,
+	MSM_PM_PC_STAGE_CLK_RESTORE,
+	MSM_PM_PC_STAGE_RPM_EXIT,
+	MSM_PM_PC_STAGE_COUNT,
+};
+
+static const char * const msm_pm_pc_stage_names[] = {
+	[MSM_PM_PC_STAGE_RPM_ENTER] = "rpm-enter",
+	[MSM_PM_PC_STAGE_CLK_DOWN] = "clk-down",
+	[MSM_PM_PC_STAGE_SPM_CONFIG] = "spm-config",
+	[MSM_PM_PC_STAGE_WARM_BOOT] = "warm-boot",
+	[MSM_PM_PC_STAGE_CLK_RESTORE] = "clk-restore",
+	[MSM_PM_PC_STAGE_RPM_EXIT] = "rpm-exit",
+};
+
+/* Bucket 0 counts stages under 1us, each following one doubles the limit */
+#define MSM_PM_PC_PROF_BUCKETS 16
+
+struct msm_pm_pc_stage_stats {
+	uint32_t count;
+	uint32_t max_us;
+	uint64_t total_us;
+	uint32_t bucket[MSM_PM_PC_PROF_BUCKETS];
+};
+
+struct msm_pm_pc_prof {
+	struct msm_pm_pc_stage_stats stage[MSM_PM_PC_STAGE_COUNT];
+};
+
+static DEFINE_PER_CPU(struct msm_pm_pc_prof, msm_pm_pc_prof);
+
+static int msm_pm_pc_profile;
+module_param_named(
+	pc_profile, msm_pm_pc_profile, int, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+static inline ktime_t msm_pm_pc_stamp(void)
+{
+	return msm_pm_pc_profile ? ktime_get() : ktime_set(0, 0);
+}
+
+/* Account the time since *start to a stage and restart *start */
+static void msm_pm_pc_account(enum msm_pm_pc_stage id, ktime_t *start)
+{
+	struct msm_pm_pc_stage_stats *stats;
+	ktime_t now;
+	uint32_t us;
+	int i = 0;
+
+	if (!start->tv64)
+		return;
+
+	now = ktime_get();
+	us = (uint32_t) ktime_to_us(ktime_sub(now, *start));
+	*start = now;
+
+	if (us)
+		i = min(ilog2(us) + 1, MSM_PM_PC_PROF_BUCKETS - 1);
+
+	stats = &__get_cpu_var(msm_pm_pc_prof).stage[id];
+	stats->count++;
+	stats->total_us += us;
+	stats->max_us = max(stats->max_us, us);
+	stats->bucket[i]++;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int msm_pm_pc_prof_show(struct seq_file *m, void *unused)
+{
+	unsigned int cpu;
+	int id, i;
+
+	seq_printf(m, "cpu stage count avg_us max_us <1us");
+	for (i = 1; i < MSM_PM_PC_PROF_BUCKETS - 1; i++)
+		seq_printf(m, " <%uus", 1 << i);
+	seq_printf(m, " more\n");
+
+	for_each_possible_cpu(cpu) {
+		struct msm_pm_pc_prof *prof = &per_cpu(msm_pm_pc_prof, cpu);
+
+		for (id = 0; id < MSM_PM_PC_STAGE_COUNT; id++) {
+			struct msm_pm_pc_stage_stats *stats = &prof->stage[id];
+			uint64_t avg = stats->total_us;
+
+			if (stats->count)
+				do_div(avg, stats->count);
+			seq_printf(m, "%u %s %u %llu %u", cpu,
+				msm_pm_pc_stage_names[id], stats->count,
+				avg, stats->max_us);
+			for (i = 0; i < MSM_PM_PC_PROF_BUCKETS; i++)
+				seq_printf(m, " %u", stats->bucket[i]);
+			seq_printf(m, "\n");
+		}
+	}
+
+	return 0;
+}
+
+static int msm_pm_pc_prof_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_pm_pc_prof_show, inode->i_private);
+}
+
+/* Any write clears the histograms */
+static ssize_t msm_pm_pc_prof_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(msm_pm_pc_prof, cpu), 0,
+			sizeof(struct msm_pm_pc_prof));
+
+	return count;
+}
+
+static const struct file_operations msm_pm_pc_prof_fops = {
+	.open = msm_pm_pc_prof_open,
+	.read = seq_read,
+	.write = msm_pm_pc_prof_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
 /******************************************************************************
  *
  *****************************************************************************/
@@ -665,12 +809,15 @@ static bool msm_pm_spm_power_collapse(
 {
 	void *entry;
 	bool collapsed = 0;
+	ktime_t stamp;
 	int ret;
 
 	if (MSM_PM_DEBUG_POWER_COLLAPSE & msm_pm_debug_mask)
 		pr_info("CPU%u: %s: notify_rpm %d\n",
 			cpu, __func__, (int) notify_rpm);
 
+	stamp = msm_pm_pc_stamp();
+
 	ret = msm_spm_set_low_power_mode(
 			MSM_SPM_MODE_POWER_COLLAPSE, notify_rpm);
 	WARN_ON(ret);
@@ -686,9 +833,11 @@ static bool msm_pm_spm_power_collapse(
 #ifdef CONFIG_VFP
 	vfp_flush_context();
 #endif
+	msm_pm_pc_account(MSM_PM_PC_STAGE_SPM_CONFIG, &stamp);
 
 	collapsed = msm_pm_l2x0_power_collapse();
 
+	stamp = msm_pm_pc_stamp();
 	msm_pm_boot_config_after_pc(cpu);
 
 	if (collapsed) {
@@ -699,6 +848,7 @@ static bool msm_pm_spm_power_collapse(
 		writel(0xF0, MSM_QGIC_CPU_BASE + GIC_CPU_PRIMASK);
 		writel(1, MSM_QGIC_CPU_BASE + GIC_CPU_CTRL);
 		local_fiq_enable();
+		msm_pm_pc_account(MSM_PM_PC_STAGE_WARM_BOOT, &stamp);
 	}
 
 	if (MSM_PM_DEBUG_POWER_COLLAPSE & msm_pm_debug_mask)
@@ -729,6 +879,7 @@ static bool msm_pm_power_collapse(bool from_idle)
 	unsigned long saved_acpuclk_rate;
 	unsigned int avsdscr_setting;
 	bool collapsed;
+	ktime_t stamp;
 
 	if (MSM_PM_DEBUG_POWER_COLLAPSE & msm_pm_debug_mask)
 		pr_info("CPU%u: %s: idle %d\n",
@@ -741,10 +892,12 @@ static bool msm_pm_power_collapse(bool from_idle)
 	avsdscr_setting = avs_get_avsdscr();
 	avs_disable();
 
+	stamp = msm_pm_pc_stamp();
 	if (cpu_online(cpu))
 		saved_acpuclk_rate = acpuclk_power_collapse();
 	else
 		saved_acpuclk_rate = 0;
+	msm_pm_pc_account(MSM_PM_PC_STAGE_CLK_DOWN, &stamp);
 
 	if (MSM_PM_DEBUG_CLOCK & msm_pm_debug_mask)
 		pr_info("CPU%u: %s: change clock rate (old rate = %lu)\n",
@@ -755,9 +908,11 @@ static bool msm_pm_power_collapse(bool from_idle)
 	if (MSM_PM_DEBUG_CLOCK & msm_pm_debug_mask)
 		pr_info("CPU%u: %s: restore clock rate to %lu\n",
 			cpu, __func__, saved_acpuclk_rate);
+	stamp = msm_pm_pc_stamp();
 	if (acpuclk_set_rate(cpu, saved_acpuclk_rate, SETRATE_PC) < 0)
 		pr_err("CPU%u: %s: failed to restore clock rate(%lu)\n",
 			cpu, __func__, saved_acpuclk_rate);
+	msm_pm_pc_account(MSM_PM_PC_STAGE_CLK_RESTORE, &stamp);
 
 	avs_reset_delays(avsdscr_setting);
 	msm_pm_config_hw_after_power_up();
@@ -787,6 +942,85 @@ void arch_idle(void)
 	return;
 }
 
+/******************************************************************************
+ * Idle Prediction
+ *****************************************************************************/
+
+/*
+ * The next timer event is only an upper bound on the idle period, most
+ * wakeups come from interrupts. Keep the last few idle periods of each
+ * CPU and, if they are consistent, use their average as the expected
+ * sleep time, the same way the menu governor does. The RPM resource
+ * levels then weigh their (L2 and RPM assisted) entry and exit costs
+ * against that instead of against the timer alone.
+ */
+#define MSM_PM_IDLE_HIST_SIZE	8
+#define MSM_PM_IDLE_HIST_MAX_US	(2 * USEC_PER_SEC)
+
+struct msm_pm_idle_hist {
+	uint32_t us[MSM_PM_IDLE_HIST_SIZE];
+	int next;
+};
+
+static DEFINE_PER_CPU(struct msm_pm_idle_hist, msm_pm_idle_hist);
+
+static int msm_pm_idle_predict = 1;
+module_param_named(
+	idle_predict, msm_pm_idle_predict, int, S_IRUGO | S_IWUSR | S_IWGRP
+);
+
+static void msm_pm_idle_record(int64_t time_us)
+{
+	struct msm_pm_idle_hist *hist = &__get_cpu_var(msm_pm_idle_hist);
+
+	hist->us[hist->next] = min_t(int64_t, time_us,
+				MSM_PM_IDLE_HIST_MAX_US);
+	hist->next = (hist->next + 1) % MSM_PM_IDLE_HIST_SIZE;
+}
+
+static uint32_t msm_pm_idle_typical_us(unsigned int cpu)
+{
+	struct msm_pm_idle_hist *hist = &per_cpu(msm_pm_idle_hist, cpu);
+	uint32_t thresh = UINT_MAX;
+	uint64_t avg, variance;
+	uint32_t longest;
+	int i, count;
+
+again:
+	avg = 0;
+	longest = 0;
+	count = 0;
+	for (i = 0; i < MSM_PM_IDLE_HIST_SIZE; i++) {
+		if (hist->us[i] > thresh)
+			continue;
+		avg += hist->us[i];
+		longest = max(longest, hist->us[i]);
+		count++;
+	}
+	do_div(avg, count);
+
+	variance = 0;
+	for (i = 0; i < MSM_PM_IDLE_HIST_SIZE; i++) {
+		int64_t diff = (int64_t)hist->us[i] - (int64_t)avg;
+
+		if (hist->us[i] <= thresh)
+			variance += diff * diff;
+	}
+	do_div(variance, count);
+
+	/* Consistent if the deviation is under 20us or a sixth of avg */
+	if (variance <= 400 || avg * avg > 36 * variance)
+		return (uint32_t)avg;
+
+	/* Drop the longest period while three quarters are still left */
+	if (count * 4 > MSM_PM_IDLE_HIST_SIZE * 3) {
+		thresh = longest - 1;
+		goto again;
+	}
+
+	return UINT_MAX;
+}
+
 int msm_pm_idle_prepare(struct cpuidle_device *dev)
 {
 	uint32_t latency_us;
@@ -796,6 +1030,8 @@ int msm_pm_idle_prepare(struct cpuidle_device *dev)
 	latency_us = (uint32_t) pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
 	sleep_us = (uint32_t) ktime_to_ns(tick_nohz_get_sleep_length());
 	sleep_us = DIV_ROUND_UP(sleep_us, 1000);
+	if (msm_pm_idle_predict)
+		sleep_us = min(sleep_us, msm_pm_idle_typical_us(dev->cpu));
 
 	for (i = 0; i < dev->state_count; i++) {
 		struct cpuidle_state *state = &dev->states[i];
@@ -903,6 +1139,8 @@ int msm_pm_idle_enter(enum msm_pm_sleep_mode sleep_mode)
 		pr_info("CPU%u: %s: mode %d\n",
 			smp_processor_id(), __func__, sleep_mode);
 
+	msm_watchdog_idle_pet();
+
 	time = ktime_to_ns(ktime_get());
 
 	switch (sleep_mode) {
@@ -914,7 +1152,9 @@ int msm_pm_idle_enter(enum msm_pm_sleep_mode sleep_mode)
 		break;
 
 	case MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE:
+		sched_set_deep_idle(1);
 		msm_pm_power_collapse_standalone(true);
+		sched_set_deep_idle(0);
 #ifdef CONFIG_MSM_IDLE_STATS
 		exit_stat = MSM_PM_STAT_IDLE_STANDALONE_POWER_COLLAPSE;
 #endif
@@ -928,6 +1168,7 @@ int msm_pm_idle_enter(enum msm_pm_sleep_mode sleep_mode)
 		int notify_rpm =
 			(sleep_mode == MSM_PM_SLEEP_MODE_POWER_COLLAPSE);
 		int collapsed;
+		ktime_t stamp;
 
 		sleep_delay = (uint32_t) msm_pm_convert_and_cap_time(
 			timer_expiration, MSM_PM_SLEEP_TICK_LIMIT);
@@ -937,14 +1178,20 @@ int msm_pm_idle_enter(enum msm_pm_sleep_mode sleep_mode)
 		if (MSM_PM_DEBUG_IDLE_CLK & msm_pm_debug_mask)
 			clock_debug_print_enabled();
 
+		stamp = msm_pm_pc_stamp();
 		ret = msm_rpmrs_enter_sleep(
 			sleep_delay, msm_pm_idle_rs_limits, true, notify_rpm);
 		if (!ret) {
+			msm_pm_pc_account(MSM_PM_PC_STAGE_RPM_ENTER, &stamp);
+			sched_set_deep_idle(1);
 			collapsed = msm_pm_power_collapse(true);
+			sched_set_deep_idle(0);
 			timer_halted = true;
 
+			stamp = msm_pm_pc_stamp();
 			msm_rpmrs_exit_sleep(msm_pm_idle_rs_limits, true,
 					notify_rpm, collapsed);
+			msm_pm_pc_account(MSM_PM_PC_STAGE_RPM_EXIT, &stamp);
 		}
 
 		msm_timer_exit_idle((int) timer_halted);
@@ -965,6 +1212,7 @@ int msm_pm_idle_enter(enum msm_pm_sleep_mode sleep_mode)
 #endif
 
 	do_div(time, 1000);
+	msm_pm_idle_record(time);
 	return (int) time;
 
 cpuidle_enter_bail:
@@ -1254,6 +1502,11 @@ static int __init msm_pm_init(void)
 	}
 #endif  /* CONFIG_MSM_IDLE_STATS */
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("msm_pm_pc_profile", S_IRUGO | S_IWUSR, NULL,
+			NULL, &msm_pm_pc_prof_fops);
+#endif
+
 	msm_pm_mode_sysfs_add();
 	msm_spm_allow_x_cpu_set_vdd(false);
 
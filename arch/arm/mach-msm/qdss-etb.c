@@ -24,6 +24,11 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
 
 #include "qdss.h"
 
@@ -52,6 +57,8 @@
 #define BYTES_PER_WORD		4
 #define ETB_SIZE_WORDS		4096
 #define FRAME_SIZE_WORDS	4
+/* must be a power of 2 */
+#define ETB_STREAM_BUF_SIZE	(64 * ETB_SIZE_WORDS * BYTES_PER_WORD)
 
 #define ETB_LOCK()							\
 do {									\
@@ -74,10 +81,25 @@ struct etb_ctx {
 	struct device	*dev;
 	struct kobject	*kobj;
 	uint32_t	trigger_cntr;
+	/*
+	 * Streaming: every stream_ms the ETB is drained in stream_buf, read
+	 * through msm_etb_stream. head and tail are free running byte counts.
+	 */
+	uint32_t		stream_ms;
+	struct delayed_work	stream_work;
+	uint8_t			*stream_buf;
+	unsigned long		stream_head;
+	unsigned long		stream_tail;
+	unsigned long		stream_lost;
+	unsigned long		stream_wraps;
+	wait_queue_head_t	stream_wq;
+	atomic_t		stream_in_use;
 };
 
 static struct etb_ctx etb;
 
+static void __etb_stream_drain(void);
+
 static void __etb_enable(void)
 {
 	int i;
@@ -103,6 +125,9 @@ void etb_enable(void)
 	mutex_lock(&etb.mutex);
 	__etb_enable();
 	etb.enabled = true;
+	if (etb.stream_ms)
+		schedule_delayed_work(&etb.stream_work,
+				      msecs_to_jiffies(etb.stream_ms));
 	dev_info(etb.dev, "ETB enabled\n");
 	mutex_unlock(&etb.mutex);
 }
@@ -142,6 +167,11 @@ static void __etb_disable(void)
 void etb_disable(void)
 {
 	mutex_lock(&etb.mutex);
+	if (etb.enabled && etb.stream_ms) {
+		/* keep what was traced since the last drain */
+		__etb_stream_drain();
+		wake_up_interruptible(&etb.stream_wq);
+	}
 	__etb_disable();
 	etb.enabled = false;
 	dev_info(etb.dev, "ETB disabled\n");
@@ -205,7 +235,11 @@ static void __etb_dump(void)
 void etb_dump(void)
 {
 	mutex_lock(&etb.mutex);
-	if (etb.enabled) {
+	if (etb.enabled && etb.stream_ms) {
+		/* while streaming, everything goes to the stream buffer */
+		__etb_stream_drain();
+		wake_up_interruptible(&etb.stream_wq);
+	} else if (etb.enabled) {
 		__etb_disable();
 		__etb_dump();
 		__etb_enable();
@@ -215,6 +249,75 @@ void etb_dump(void)
 	mutex_unlock(&etb.mutex);
 }
 
+static void etb_stream_put_word(uint32_t data)
+{
+	unsigned long off = etb.stream_head & (ETB_STREAM_BUF_SIZE - 1);
+
+	etb.stream_buf[off++] = data >> 0;
+	etb.stream_buf[off++] = data >> 8;
+	etb.stream_buf[off++] = data >> 16;
+	etb.stream_buf[off++] = data >> 24;
+	etb.stream_head += BYTES_PER_WORD;
+}
+
+/*
+ * Append the trace captured since the ETB was last enabled to the stream
+ * buffer and restart the capture.  The trace formatter is stopped and
+ * flushed first, so the data read ends on a frame.  Trace generated while
+ * the ETB is stopped is lost, as is the oldest data of a full ETB or of a
+ * stream buffer that isn't read fast enough: both are counted.
+ * Called with etb.mutex held and the ETB enabled.
+ */
+static void __etb_stream_drain(void)
+{
+	int i;
+	uint32_t write_ptr;
+	uint32_t nr_words;
+
+	__etb_disable();
+
+	ETB_UNLOCK();
+
+	write_ptr = etb_readl(etb, ETB_RAM_WRITE_POINTER);
+	if (etb_readl(etb, ETB_STATUS_REG) & BIT(0)) {
+		etb.stream_wraps++;
+		nr_words = ETB_SIZE_WORDS;
+		etb_writel(etb, write_ptr, ETB_RAM_READ_POINTER);
+	} else {
+		nr_words = write_ptr;
+		etb_writel(etb, 0x0, ETB_RAM_READ_POINTER);
+	}
+
+	/* a partial formatter frame can't be decoded, leave it out */
+	nr_words -= nr_words % FRAME_SIZE_WORDS;
+
+	for (i = 0; i < nr_words; i++)
+		etb_stream_put_word(etb_readl(etb, ETB_RAM_READ_DATA_REG));
+
+	ETB_LOCK();
+
+	if (etb.stream_head - etb.stream_tail > ETB_STREAM_BUF_SIZE) {
+		etb.stream_lost += etb.stream_head - etb.stream_tail -
+					ETB_STREAM_BUF_SIZE;
+		etb.stream_tail = etb.stream_head - ETB_STREAM_BUF_SIZE;
+	}
+
+	__etb_enable();
+}
+
+static void etb_stream_work(struct work_struct *work)
+{
+	mutex_lock(&etb.mutex);
+	if (etb.enabled && etb.stream_ms) {
+		__etb_stream_drain();
+		schedule_delayed_work(&etb.stream_work,
+				      msecs_to_jiffies(etb.stream_ms));
+	}
+	mutex_unlock(&etb.mutex);
+
+	wake_up_interruptible(&etb.stream_wq);
+}
+
 static int etb_open(struct inode *inode, struct file *file)
 {
 	if (atomic_cmpxchg(&etb.in_use, 0, 1))
@@ -272,9 +375,93 @@ static struct miscdevice etb_misc = {
 	.fops =		&etb_fops,
 };
 
+static int etb_stream_open(struct inode *inode, struct file *file)
+{
+	if (atomic_cmpxchg(&etb.stream_in_use, 0, 1))
+		return -EBUSY;
+
+	dev_dbg(etb.dev, "%s: successfully opened\n", __func__);
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t etb_stream_read(struct file *file, char __user *data,
+				size_t len, loff_t *ppos)
+{
+	unsigned long off;
+	size_t avail, chunk;
+	int ret;
+
+	mutex_lock(&etb.mutex);
+	while (etb.stream_head == etb.stream_tail) {
+		mutex_unlock(&etb.mutex);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(etb.stream_wq,
+				etb.stream_head != etb.stream_tail);
+		if (ret)
+			return ret;
+		mutex_lock(&etb.mutex);
+	}
+
+	avail = etb.stream_head - etb.stream_tail;
+	if (len > avail)
+		len = avail;
+
+	off = etb.stream_tail & (ETB_STREAM_BUF_SIZE - 1);
+	chunk = min_t(size_t, len, ETB_STREAM_BUF_SIZE - off);
+	if (copy_to_user(data, etb.stream_buf + off, chunk) ||
+	    copy_to_user(data + chunk, etb.stream_buf, len - chunk)) {
+		mutex_unlock(&etb.mutex);
+		dev_dbg(etb.dev, "%s: copy_to_user failed\n", __func__);
+		return -EFAULT;
+	}
+	etb.stream_tail += len;
+	mutex_unlock(&etb.mutex);
+
+	dev_dbg(etb.dev, "%s: %d bytes copied\n", __func__, len);
+
+	return len;
+}
+
+static unsigned int etb_stream_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &etb.stream_wq, wait);
+
+	if (etb.stream_head != etb.stream_tail)
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static int etb_stream_release(struct inode *inode, struct file *file)
+{
+	atomic_set(&etb.stream_in_use, 0);
+
+	dev_dbg(etb.dev, "%s: released\n", __func__);
+
+	return 0;
+}
+
+static const struct file_operations etb_stream_fops = {
+	.owner =	THIS_MODULE,
+	.open =		etb_stream_open,
+	.read =		etb_stream_read,
+	.poll =		etb_stream_poll,
+	.release =	etb_stream_release,
+	.llseek =	no_llseek,
+};
+
+static struct miscdevice etb_stream_misc = {
+	.name =		"msm_etb_stream",
+	.minor =	MISC_DYNAMIC_MINOR,
+	.fops =		&etb_stream_fops,
+};
+
 #define ETB_ATTR(name)						\
 static struct kobj_attribute name##_attr =				\
 		__ATTR(name, S_IRUGO | S_IWUSR, name##_show, name##_store)
+#define ETB_ATTR_RO(name)						\
+static struct kobj_attribute name##_attr =				\
+		__ATTR(name, S_IRUGO, name##_show, NULL)
 
 static ssize_t trigger_cntr_store(struct kobject *kobj,
 			struct kobj_attribute *attr,
@@ -297,6 +484,72 @@ static ssize_t trigger_cntr_show(struct kobject *kobj,
 }
 ETB_ATTR(trigger_cntr);
 
+/* Drain period in ms of the streaming mode, 0 to only capture one-shot */
+static ssize_t stream_ms_store(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			const char *buf, size_t n)
+{
+	unsigned long val;
+
+	if (sscanf(buf, "%lu", &val) != 1)
+		return -EINVAL;
+
+	mutex_lock(&etb.mutex);
+	if (val && !etb.stream_buf) {
+		etb.stream_buf = vmalloc(ETB_STREAM_BUF_SIZE);
+		if (!etb.stream_buf) {
+			mutex_unlock(&etb.mutex);
+			return -ENOMEM;
+		}
+	}
+	if (val && !etb.stream_ms && etb.enabled)
+		schedule_delayed_work(&etb.stream_work,
+				      msecs_to_jiffies(val));
+	etb.stream_ms = val;
+	mutex_unlock(&etb.mutex);
+	return n;
+}
+static ssize_t stream_ms_show(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			char *buf)
+{
+	unsigned long val = etb.stream_ms;
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", val);
+}
+ETB_ATTR(stream_ms);
+
+/* Bytes dropped because the stream buffer wasn't read in time */
+static ssize_t stream_lost_show(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			char *buf)
+{
+	unsigned long val = etb.stream_lost;
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", val);
+}
+ETB_ATTR_RO(stream_lost);
+
+/* Drains that found the ETB full, having overwritten older trace */
+static ssize_t stream_wraps_show(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			char *buf)
+{
+	unsigned long val = etb.stream_wraps;
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", val);
+}
+ETB_ATTR_RO(stream_wraps);
+
+static struct attribute *etb_attrs[] = {
+	&trigger_cntr_attr.attr,
+	&stream_ms_attr.attr,
+	&stream_lost_attr.attr,
+	&stream_wraps_attr.attr,
+	NULL,
+};
+
+static struct attribute_group etb_attr_grp = {
+	.attrs = etb_attrs,
+};
+
 static int __init etb_sysfs_init(void)
 {
 	int ret;
@@ -308,10 +561,9 @@ static int __init etb_sysfs_init(void)
 		goto err_create;
 	}
 
-	ret = sysfs_create_file(etb.kobj, &trigger_cntr_attr.attr);
+	ret = sysfs_create_group(etb.kobj, &etb_attr_grp);
 	if (ret) {
-		dev_err(etb.dev, "failed to create ETB sysfs trigger_cntr"
-		" attribute\n");
+		dev_err(etb.dev, "failed to create ETB sysfs group\n");
 		goto err_file;
 	}
 
@@ -324,7 +576,7 @@ err_create:
 
 static void etb_sysfs_exit(void)
 {
-	sysfs_remove_file(etb.kobj, &trigger_cntr_attr.attr);
+	sysfs_remove_group(etb.kobj, &etb_attr_grp);
 	kobject_put(etb.kobj);
 }
 
@@ -348,11 +600,17 @@ static int __devinit etb_probe(struct platform_device *pdev)
 	etb.dev = &pdev->dev;
 
 	mutex_init(&etb.mutex);
+	INIT_DELAYED_WORK(&etb.stream_work, etb_stream_work);
+	init_waitqueue_head(&etb.stream_wq);
 
 	ret = misc_register(&etb_misc);
 	if (ret)
 		goto err_misc;
 
+	ret = misc_register(&etb_stream_misc);
+	if (ret)
+		goto err_stream_misc;
+
 	etb.buf = kzalloc(ETB_SIZE_WORDS * BYTES_PER_WORD, GFP_KERNEL);
 	if (!etb.buf) {
 		ret = -ENOMEM;
@@ -365,6 +623,8 @@ static int __devinit etb_probe(struct platform_device *pdev)
 	return 0;
 
 err_alloc:
+	misc_deregister(&etb_stream_misc);
+err_stream_misc:
 	misc_deregister(&etb_misc);
 err_misc:
 	mutex_destroy(&etb.mutex);
@@ -379,8 +639,11 @@ static int etb_remove(struct platform_device *pdev)
 {
 	if (etb.enabled)
 		etb_disable();
+	cancel_delayed_work_sync(&etb.stream_work);
 	etb_sysfs_exit();
+	vfree(etb.stream_buf);
 	kfree(etb.buf);
+	misc_deregister(&etb_stream_misc);
 	misc_deregister(&etb_misc);
 	mutex_destroy(&etb.mutex);
 	iounmap(etb.base);
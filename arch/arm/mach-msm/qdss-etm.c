@@ -27,6 +27,7 @@
 #include <linux/sysfs.h>
 #include <linux/stat.h>
 #include <asm/sections.h>
+#include <asm/mmu_context.h>
 #include <mach/socinfo.h>
 
 #include "qdss.h"
@@ -1076,6 +1077,42 @@ ETM_STORE(ctxid_mask, ETM_ALL_MASK);
 ETM_SHOW(ctxid_mask);
 ETM_ATTR(ctxid_mask);
 
+#ifdef CONFIG_PID_IN_CONTEXTIDR
+/*
+ * With the pid of the running thread in CONTEXTIDR[31:ASID_BITS], trace can
+ * be limited to one thread: this programs the selected comparator with the
+ * pid and masks out the ASID. Select the comparator in enable_event to
+ * filter on it.
+ */
+static ssize_t ctxid_pid_store(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			const char *buf, size_t n)
+{
+	unsigned long val;
+
+	if (sscanf(buf, "%lu", &val) != 1)
+		return -EINVAL;
+
+	mutex_lock(&etm.mutex);
+	etm.ctxid_val[etm.ctxid_idx] = val << ASID_BITS;
+	etm.ctxid_mask |= BM(0, ASID_BITS - 1);
+	mutex_unlock(&etm.mutex);
+	return n;
+}
+static ssize_t ctxid_pid_show(struct kobject *kobj,
+			struct kobj_attribute *attr,
+			char *buf)
+{
+	unsigned long val;
+
+	mutex_lock(&etm.mutex);
+	val = etm.ctxid_val[etm.ctxid_idx] >> ASID_BITS;
+	mutex_unlock(&etm.mutex);
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", val);
+}
+ETM_ATTR(ctxid_pid);
+#endif
+
 ETM_STORE(sync_freq, ETM_SYNC_MASK);
 ETM_SHOW(sync_freq);
 ETM_ATTR(sync_freq);
@@ -1114,6 +1151,9 @@ static struct attribute *etm_attrs[] = {
 	&ctxid_idx_attr.attr,
 	&ctxid_val_attr.attr,
 	&ctxid_mask_attr.attr,
+#ifdef CONFIG_PID_IN_CONTEXTIDR
+	&ctxid_pid_attr.attr,
+#endif
 	&sync_freq_attr.attr,
 	&timestamp_event_attr.attr,
 	NULL,
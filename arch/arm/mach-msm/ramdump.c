@@ -25,6 +25,8 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
 
 #include <asm-generic/poll.h>
 
@@ -32,6 +34,33 @@
 
 #define RAMDUMP_WAIT_MSECS	120000
 
+/*
+ * With compress set, a dump is read as a stream of LZO chunks, each one a
+ * struct ramdump_lzo_hdr followed by the compressed data. Decompressing
+ * the chunks in order gives the same bytes as an uncompressed dump. The
+ * setting is picked up when the ramdump device is opened.
+ */
+static int compress;
+module_param(compress, int, S_IRUGO | S_IWUSR);
+
+#define RAMDUMP_LZO_MAGIC	0x4f5a4c52	/* "RLZO" */
+#define RAMDUMP_LZO_CHUNK	SZ_64K
+
+struct ramdump_lzo_hdr {
+	u32 magic;
+	u32 src_len;
+	u32 dst_len;
+};
+
+struct ramdump_lzo {
+	void *src;
+	void *work;
+	u8 *dst;
+	size_t dst_len;
+	size_t dst_off;
+	loff_t src_pos;
+};
+
 struct ramdump_device {
 	char name[256];
 
@@ -45,12 +74,50 @@ struct ramdump_device {
 	wait_queue_head_t dump_wait_q;
 	int nsegments;
 	struct ramdump_segment *segments;
+
+	struct ramdump_lzo *lzo;
 };
 
+static void ramdump_lzo_free(struct ramdump_lzo *lzo)
+{
+	if (!lzo)
+		return;
+
+	vfree(lzo->src);
+	vfree(lzo->work);
+	vfree(lzo->dst);
+	kfree(lzo);
+}
+
+static struct ramdump_lzo *ramdump_lzo_alloc(void)
+{
+	struct ramdump_lzo *lzo;
+
+	lzo = kzalloc(sizeof(*lzo), GFP_KERNEL);
+	if (!lzo)
+		return NULL;
+
+	lzo->src = vmalloc(RAMDUMP_LZO_CHUNK);
+	lzo->work = vmalloc(LZO1X_1_MEM_COMPRESS);
+	lzo->dst = vmalloc(sizeof(struct ramdump_lzo_hdr) +
+			lzo1x_worst_compress(RAMDUMP_LZO_CHUNK));
+	if (!lzo->src || !lzo->work || !lzo->dst) {
+		ramdump_lzo_free(lzo);
+		return NULL;
+	}
+
+	return lzo;
+}
+
 static int ramdump_open(struct inode *inode, struct file *filep)
 {
 	struct ramdump_device *rd_dev = container_of(filep->private_data,
 				struct ramdump_device, device);
+	if (compress) {
+		rd_dev->lzo = ramdump_lzo_alloc();
+		if (!rd_dev->lzo)
+			return -ENOMEM;
+	}
 	rd_dev->consumer_present = 1;
 	rd_dev->ramdump_status = 0;
 	return 0;
@@ -63,6 +130,8 @@ static int ramdump_release(struct inode *inode, struct file *filep)
 	rd_dev->consumer_present = 0;
 	rd_dev->data_ready = 0;
 	complete(&rd_dev->ramdump_complete);
+	ramdump_lzo_free(rd_dev->lzo);
+	rd_dev->lzo = NULL;
 	return 0;
 }
 
@@ -95,66 +164,155 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
-static int ramdump_read(struct file *filep, char __user *buf, size_t count,
-			loff_t *pos)
+/* Copy up to @size bytes of the dump at @pos into @dst. Returns 0 at EOF. */
+static ssize_t ramdump_copy(struct ramdump_device *rd_dev, loff_t pos,
+		void *dst, size_t size, int user)
 {
-	struct ramdump_device *rd_dev = container_of(filep->private_data,
-				struct ramdump_device, device);
 	void *device_mem = NULL;
 	unsigned long data_left = 0;
 	unsigned long addr = 0;
 	size_t copy_size = 0;
-	int ret = 0;
-
-	if (rd_dev->data_ready == 0) {
-		pr_err("Ramdump(%s): Read when there's no dump available!",
-			rd_dev->name);
-		return -EPIPE;
-	}
 
-	addr = offset_translate(*pos, rd_dev, &data_left);
+	addr = offset_translate(pos, rd_dev, &data_left);
 
 	/* EOF check */
-	if (data_left == 0) {
-		pr_debug("Ramdump(%s): Ramdump complete. %lld bytes read.",
-			rd_dev->name, *pos);
-		rd_dev->ramdump_status = 0;
-		ret = 0;
-		goto ramdump_done;
-	}
+	if (data_left == 0)
+		return 0;
 
-	copy_size = min(count, (size_t)MAX_IOREMAP_SIZE);
+	copy_size = min(size, (size_t)MAX_IOREMAP_SIZE);
 	copy_size = min((unsigned long)copy_size, data_left);
 	device_mem = ioremap_nocache(addr, copy_size);
 
 	if (device_mem == NULL) {
 		pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %x\n",
 			rd_dev->name, addr, copy_size);
-		rd_dev->ramdump_status = -1;
-		ret = -ENOMEM;
-		goto ramdump_done;
+		return -ENOMEM;
 	}
 
-	if (copy_to_user(buf, device_mem, copy_size)) {
+	if (!user)
+		memcpy_fromio(dst, device_mem, copy_size);
+	else if (copy_to_user((void __user *)dst, device_mem, copy_size)) {
 		pr_err("Ramdump(%s): Couldn't copy all data to user.",
 			rd_dev->name);
 		iounmap(device_mem);
-		rd_dev->ramdump_status = -1;
-		ret = -EFAULT;
-		goto ramdump_done;
+		return -EFAULT;
 	}
 
 	iounmap(device_mem);
-	*pos += copy_size;
 
 	pr_debug("Ramdump(%s): Read %d bytes from address %lx.",
 			rd_dev->name, copy_size, addr);
 
 	return copy_size;
+}
+
+/* Compress the next chunk of the dump. Returns 0 at EOF. */
+static ssize_t ramdump_lzo_fill(struct ramdump_device *rd_dev)
+{
+	struct ramdump_lzo *lzo = rd_dev->lzo;
+	struct ramdump_lzo_hdr *hdr = (struct ramdump_lzo_hdr *)lzo->dst;
+	size_t src_len = 0, dst_len;
+	ssize_t ret;
+	int err;
+
+	/* A chunk may span segments, the stream is one flat dump */
+	while (src_len < RAMDUMP_LZO_CHUNK) {
+		ret = ramdump_copy(rd_dev, lzo->src_pos, lzo->src + src_len,
+				RAMDUMP_LZO_CHUNK - src_len, 0);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			break;
+		src_len += ret;
+		lzo->src_pos += ret;
+	}
+
+	if (src_len == 0)
+		return 0;
+
+	err = lzo1x_1_compress(lzo->src, src_len, lzo->dst + sizeof(*hdr),
+			&dst_len, lzo->work);
+	if (err != LZO_E_OK) {
+		pr_err("Ramdump(%s): Compression failed (%d)\n",
+			rd_dev->name, err);
+		return -EIO;
+	}
+
+	hdr->magic = RAMDUMP_LZO_MAGIC;
+	hdr->src_len = src_len;
+	hdr->dst_len = dst_len;
+	lzo->dst_len = sizeof(*hdr) + dst_len;
+	lzo->dst_off = 0;
+
+	return lzo->dst_len;
+}
+
+static ssize_t ramdump_lzo_read(struct ramdump_device *rd_dev,
+		char __user *buf, size_t count)
+{
+	struct ramdump_lzo *lzo = rd_dev->lzo;
+	size_t copy_size;
+	ssize_t ret;
+
+	if (lzo->dst_off == lzo->dst_len) {
+		ret = ramdump_lzo_fill(rd_dev);
+		if (ret <= 0)
+			return ret;
+	}
+
+	copy_size = min(count, lzo->dst_len - lzo->dst_off);
+	if (copy_to_user(buf, lzo->dst + lzo->dst_off, copy_size)) {
+		pr_err("Ramdump(%s): Couldn't copy all data to user.",
+			rd_dev->name);
+		return -EFAULT;
+	}
+	lzo->dst_off += copy_size;
+
+	return copy_size;
+}
+
+static int ramdump_read(struct file *filep, char __user *buf, size_t count,
+			loff_t *pos)
+{
+	struct ramdump_device *rd_dev = container_of(filep->private_data,
+				struct ramdump_device, device);
+	ssize_t ret = 0;
+
+	if (rd_dev->data_ready == 0) {
+		pr_err("Ramdump(%s): Read when there's no dump available!",
+			rd_dev->name);
+		return -EPIPE;
+	}
+
+	if (rd_dev->lzo)
+		ret = ramdump_lzo_read(rd_dev, buf, count);
+	else
+		ret = ramdump_copy(rd_dev, *pos, (void __force *)buf, count, 1);
+
+	if (ret < 0) {
+		rd_dev->ramdump_status = -1;
+		goto ramdump_done;
+	}
+
+	/* EOF check */
+	if (ret == 0) {
+		pr_debug("Ramdump(%s): Ramdump complete. %lld bytes read.",
+			rd_dev->name, *pos);
+		rd_dev->ramdump_status = 0;
+		goto ramdump_done;
+	}
+
+	*pos += ret;
+	return ret;
 
 ramdump_done:
 	rd_dev->data_ready = 0;
 	*pos = 0;
+	if (rd_dev->lzo) {
+		rd_dev->lzo->src_pos = 0;
+		rd_dev->lzo->dst_len = 0;
+		rd_dev->lzo->dst_off = 0;
+	}
 	complete(&rd_dev->ramdump_complete);
 	return ret;
 }
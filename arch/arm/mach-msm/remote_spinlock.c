@@ -15,6 +15,10 @@
 #include <linux/kernel.h>
 #include <linux/string.h>
 #include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
 
 #include <asm/system.h>
 
@@ -141,7 +145,133 @@ remote_spinlock_dal_init(const char *chunk_name, _remote_spinlock_t *lock)
 	return -EINVAL;
 }
 
-int _remote_spin_lock_init(remote_spinlock_id_t id, _remote_spinlock_t *lock)
+#if defined(CONFIG_MSM_REMOTE_SPINLOCK_STATS)
+#define REMOTE_SPINLOCK_STATS_COUNT 16
+
+/*
+ * Statistics of one remote spinlock, shared by all the remote_spinlock_t
+ * using that lock. They are only updated with the lock held.
+ */
+struct remote_spinlock_stats {
+	raw_remote_spinlock_t *lock;
+	char id[DAL_CHUNK_NAME_LENGTH + 3];
+	unsigned long acquired;
+	unsigned long contended;
+	unsigned long long spin_ns;
+	unsigned long long max_spin_ns;
+};
+
+static struct remote_spinlock_stats stats[REMOTE_SPINLOCK_STATS_COUNT];
+static int stats_count;
+static DEFINE_SPINLOCK(stats_lock);
+
+static void remote_spinlock_stats_add(remote_spinlock_id_t id,
+				      raw_remote_spinlock_t *lock)
+{
+	unsigned long flags;
+	int n;
+
+	spin_lock_irqsave(&stats_lock, flags);
+	for (n = 0; n < stats_count; n++)
+		if (stats[n].lock == lock)
+			goto out;
+	if (stats_count == REMOTE_SPINLOCK_STATS_COUNT) {
+		pr_warning("%s: no room for the stats of %s\n", __func__, id);
+		goto out;
+	}
+	strlcpy(stats[stats_count].id, id, sizeof(stats[stats_count].id));
+	/* publish the entry only once it is complete */
+	smp_wmb();
+	stats[stats_count].lock = lock;
+	stats_count++;
+out:
+	spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+static struct remote_spinlock_stats *
+remote_spinlock_stats_find(raw_remote_spinlock_t *lock)
+{
+	int n;
+
+	for (n = 0; n < REMOTE_SPINLOCK_STATS_COUNT; n++)
+		if (stats[n].lock == lock)
+			return &stats[n];
+	return NULL;
+}
+
+void _remote_spin_lock_stats(_remote_spinlock_t *lock)
+{
+	struct remote_spinlock_stats *s;
+	unsigned long long start, spin;
+
+#if !defined(CONFIG_MSM_REMOTE_SPINLOCK_SFPB)
+	/* The SFPB trylock doesn't take the lock, it can't be used here */
+	if (_remote_spin_trylock(lock)) {
+		s = remote_spinlock_stats_find(*lock);
+		if (s)
+			s->acquired++;
+		return;
+	}
+#endif
+
+	start = sched_clock();
+	__remote_spin_lock(lock);
+	spin = sched_clock() - start;
+
+	s = remote_spinlock_stats_find(*lock);
+	if (!s)
+		return;
+	s->acquired++;
+	s->contended++;
+	s->spin_ns += spin;
+	if (spin > s->max_spin_ns)
+		s->max_spin_ns = spin;
+}
+EXPORT_SYMBOL(_remote_spin_lock_stats);
+
+static int remote_spinlock_stats_show(struct seq_file *m, void *unused)
+{
+	struct remote_spinlock_stats *s;
+	int n;
+
+	seq_printf(m, "%-16s %12s %12s %16s %12s\n", "id", "acquired",
+		   "contended", "spin_us", "max_spin_us");
+	for (n = 0; n < stats_count; n++) {
+		s = &stats[n];
+		seq_printf(m, "%-16s %12lu %12lu %16llu %12llu\n", s->id,
+			   s->acquired, s->contended,
+			   div_u64(s->spin_ns, NSEC_PER_USEC),
+			   div_u64(s->max_spin_ns, NSEC_PER_USEC));
+	}
+	return 0;
+}
+
+static int remote_spinlock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, remote_spinlock_stats_show, NULL);
+}
+
+static const struct file_operations remote_spinlock_stats_fops = {
+	.open		= remote_spinlock_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init remote_spinlock_stats_init(void)
+{
+	debugfs_create_file("remote_spinlock_stats", S_IRUGO, NULL, NULL,
+			    &remote_spinlock_stats_fops);
+	return 0;
+}
+late_initcall(remote_spinlock_stats_init);
+#else
+static inline void remote_spinlock_stats_add(remote_spinlock_id_t id,
+					     raw_remote_spinlock_t *lock) {}
+#endif
+
+static int __remote_spin_lock_init(remote_spinlock_id_t id,
+				   _remote_spinlock_t *lock)
 {
 	BUG_ON(id == NULL);
 
@@ -159,6 +289,16 @@ int _remote_spin_lock_init(remote_spinlock_id_t id, _remote_spinlock_t *lock)
 	}
 }
 
+int _remote_spin_lock_init(remote_spinlock_id_t id, _remote_spinlock_t *lock)
+{
+	int ret;
+
+	ret = __remote_spin_lock_init(id, lock);
+	if (!ret)
+		remote_spinlock_stats_add(id, *lock);
+	return ret;
+}
+
 int _remote_mutex_init(struct remote_mutex_id *id, _remote_mutex_t *lock)
 {
 	BUG_ON(id == NULL);
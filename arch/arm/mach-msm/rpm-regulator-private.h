@@ -86,6 +86,9 @@ struct vreg {
 	const int			hpm_min_load;
 	int			       active_min_uV_vote[RPM_VREG_VOTER_COUNT];
 	int				sleep_min_uV_vote[RPM_VREG_VOTER_COUNT];
+	/* Requests sent to and duplicates kept from the RPM, per voter */
+	unsigned int			sent_cnt[RPM_VREG_VOTER_COUNT];
+	unsigned int			dup_cnt[RPM_VREG_VOTER_COUNT];
 };
 
 struct vreg_config {
@@ -21,6 +21,8 @@
 #include <linux/spinlock.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/driver.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <mach/rpm.h>
 #include <mach/rpm-regulator.h>
 #include <mach/socinfo.h>
@@ -324,6 +326,7 @@ static int vreg_send_request(struct vreg *vreg, enum rpm_vreg_voter voter,
 	if (vreg->req[0].value != prev_req[0].value ||
 	    vreg->req[1].value != prev_req[1].value) {
 		rc = msm_rpmrs_set_noirq(set, vreg->req, cnt);
+		vreg->sent_cnt[voter]++;
 		if (rc) {
 			vreg->req[0].value = prev0;
 			vreg->req[1].value = prev1;
@@ -342,8 +345,10 @@ static int vreg_send_request(struct vreg *vreg, enum rpm_vreg_voter voter,
 			prev_req[0].value = vreg->req[0].value;
 			prev_req[1].value = vreg->req[1].value;
 		}
-	} else if (msm_rpm_vreg_debug_mask & MSM_RPM_VREG_DEBUG_DUPLICATE) {
-		rpm_regulator_duplicate(vreg, set, cnt);
+	} else {
+		vreg->dup_cnt[voter]++;
+		if (msm_rpm_vreg_debug_mask & MSM_RPM_VREG_DEBUG_DUPLICATE)
+			rpm_regulator_duplicate(vreg, set, cnt);
 	}
 
 	return rc;
@@ -646,12 +651,14 @@ static int vreg_set(struct vreg *vreg, unsigned mask0, unsigned val0,
 	/* Ignore duplicate requests */
 	if (vreg->req[0].value == vreg->prev_active_req[0].value &&
 	    vreg->req[1].value == vreg->prev_active_req[1].value) {
+		vreg->dup_cnt[RPM_VREG_VOTER_REG_FRAMEWORK]++;
 		if (msm_rpm_vreg_debug_mask & MSM_RPM_VREG_DEBUG_DUPLICATE)
 			rpm_regulator_duplicate(vreg, MSM_RPM_CTX_SET_0, cnt);
 		return 0;
 	}
 
 	rc = msm_rpm_set(MSM_RPM_CTX_SET_0, vreg->req, cnt);
+	vreg->sent_cnt[RPM_VREG_VOTER_REG_FRAMEWORK]++;
 	if (rc) {
 		vreg->req[0].value = prev0;
 		vreg->req[1].value = prev1;
@@ -1419,6 +1426,56 @@ static struct platform_driver rpm_vreg_driver = {
 	},
 };
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * One line per regulator and voter that has voted: the requests that went
+ * to the RPM and the ones dropped because they matched the last request.
+ * Voter 0 is the regulator framework.
+ */
+static int rpm_vreg_stats_show(struct seq_file *m, void *unused)
+{
+	struct vreg *vreg;
+	int i, j;
+
+	if (!config)
+		return 0;
+
+	seq_printf(m, "regulator voter sent duplicate\n");
+	for (i = 0; i < config->vregs_len; i++) {
+		vreg = &config->vregs[i];
+		if (!vreg->rdesc.name)
+			continue;
+		for (j = 0; j < RPM_VREG_VOTER_COUNT; j++)
+			if (vreg->sent_cnt[j] || vreg->dup_cnt[j])
+				seq_printf(m, "%s %d %u %u\n",
+					vreg->rdesc.name, j,
+					vreg->sent_cnt[j], vreg->dup_cnt[j]);
+	}
+
+	return 0;
+}
+
+static int rpm_vreg_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rpm_vreg_stats_show, inode->i_private);
+}
+
+static const struct file_operations rpm_vreg_stats_fops = {
+	.open = rpm_vreg_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init rpm_vreg_debugfs_init(void)
+{
+	debugfs_create_file("rpm_vreg_stats", S_IRUGO, NULL, NULL,
+			    &rpm_vreg_stats_fops);
+	return 0;
+}
+late_initcall(rpm_vreg_debugfs_init);
+#endif
+
 static int __init rpm_vreg_init(void)
 {
 	return platform_driver_register(&rpm_vreg_driver);
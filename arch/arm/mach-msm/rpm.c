@@ -686,6 +686,126 @@ int msm_rpm_clear_noirq(int ctx, struct msm_rpm_iv_pair *req, int count)
 }
 EXPORT_SYMBOL(msm_rpm_clear_noirq);
 
+static void msm_rpm_txn_work(struct work_struct *work)
+{
+	struct msm_rpm_txn *txn = container_of(work, struct msm_rpm_txn, work);
+	int rc;
+
+	rc = msm_rpm_txn_commit(txn);
+	if (txn->done)
+		txn->done(txn, rc);
+}
+
+/*
+ * Start an empty transaction for the given context.
+ */
+void msm_rpm_txn_init(struct msm_rpm_txn *txn, int ctx)
+{
+	txn->ctx = ctx;
+	txn->count = 0;
+	txn->done = NULL;
+	INIT_WORK(&txn->work, msm_rpm_txn_work);
+}
+EXPORT_SYMBOL(msm_rpm_txn_init);
+
+/*
+ * Add votes to a transaction.  A vote for a resource that is already in
+ * the transaction replaces the earlier one, so several drivers can vote
+ * on shared resources and only the last value is sent.
+ *
+ * Return value:
+ *   0: success
+ *   -EINVAL: invalid id in <req> array
+ *   -ENOSPC: too many distinct resources in the transaction
+ */
+int msm_rpm_txn_add(struct msm_rpm_txn *txn,
+	struct msm_rpm_iv_pair *req, int count)
+{
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		if (req[i].id > MSM_RPM_ID_LAST)
+			return -EINVAL;
+
+		for (j = 0; j < txn->count; j++)
+			if (txn->req[j].id == req[i].id)
+				break;
+
+		if (j == txn->count) {
+			if (txn->count == MSM_RPM_TXN_MAX)
+				return -ENOSPC;
+			txn->count++;
+		}
+
+		txn->req[j] = req[i];
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_rpm_txn_add);
+
+/*
+ * Send all votes of a transaction in one request.  The transaction is
+ * emptied once RPM accepts it.
+ *
+ * Note: the function may sleep and must be called in a task context.
+ *
+ * Return value: same as msm_rpm_set()
+ */
+int msm_rpm_txn_commit(struct msm_rpm_txn *txn)
+{
+	int rc = 0;
+
+	if (txn->count)
+		rc = msm_rpm_set(txn->ctx, txn->req, txn->count);
+	if (!rc)
+		txn->count = 0;
+
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_txn_commit);
+
+/*
+ * Same as msm_rpm_txn_commit() but must be called with interrupts masked.
+ */
+int msm_rpm_txn_commit_noirq(struct msm_rpm_txn *txn)
+{
+	int rc = 0;
+
+	if (txn->count)
+		rc = msm_rpm_set_noirq(txn->ctx, txn->req, txn->count);
+	if (!rc)
+		txn->count = 0;
+
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_txn_commit_noirq);
+
+/*
+ * Send a transaction without waiting for RPM to acknowledge it.  The
+ * request is issued from a workqueue and <done> is called, in task
+ * context, with the result of msm_rpm_txn_commit() once the ack arrives.
+ *
+ * Note: the transaction must not be touched, or freed, until <done> has
+ *       been called.  The function may be called from atomic context.
+ *
+ * Return value:
+ *   0: request queued
+ *   -EBUSY: the transaction is already being sent
+ */
+int msm_rpm_txn_commit_async(struct msm_rpm_txn *txn,
+	void (*done)(struct msm_rpm_txn *txn, int rc))
+{
+	if (work_pending(&txn->work))
+		return -EBUSY;
+
+	txn->done = done;
+	queue_work(system_nrt_wq, &txn->work);
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_rpm_txn_commit_async);
+
 /*
  * Register for RPM notification.  When the specified resources
  * change their status on RPM, RPM sends out notifications and the
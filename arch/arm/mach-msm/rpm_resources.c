@@ -20,6 +20,7 @@
 #include <linux/proc_fs.h>
 #include <linux/spinlock.h>
 #include <linux/cpu.h>
+#include <linux/sched.h>
 #include <mach/rpm.h>
 #include <mach/msm_iomap.h>
 #include <asm/mach-types.h>
@@ -44,6 +45,26 @@ module_param_named(
 	debug_mask, msm_rpmrs_debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP
 );
 
+/*
+ * Out of idle, a level that flushes and collapses the L2 only wins if the
+ * sleep is predicted to outlast its time overhead by l2_pc_penalty_us: the
+ * cost of the flush and of refilling the cache after wakeup. The penalty
+ * ramps up over l2_refill_us of L2 use after the last collapse, as a
+ * cache that was just emptied holds few dirty or useful lines yet.
+ * Shorter sleeps use the levels that retain the L2, GDHS or retention.
+ */
+static int msm_rpmrs_l2_pc_penalty_us = 1000;
+module_param_named(
+	l2_pc_penalty_us, msm_rpmrs_l2_pc_penalty_us, int, S_IRUGO | S_IWUSR
+);
+
+static int msm_rpmrs_l2_refill_us = 10000;
+module_param_named(
+	l2_refill_us, msm_rpmrs_l2_refill_us, int, S_IRUGO | S_IWUSR
+);
+
+static unsigned long long msm_rpmrs_l2_lost_ns;
+
 static struct msm_rpmrs_level *msm_rpmrs_levels;
 static int msm_rpmrs_level_count;
 
@@ -867,6 +888,23 @@ void msm_rpmrs_show_resources(void)
 	spin_unlock_irqrestore(&msm_rpmrs_lock, flags);
 }
 
+static uint32_t msm_rpmrs_l2_pc_penalty(void)
+{
+	uint32_t penalty = max(msm_rpmrs_l2_pc_penalty_us, 0);
+	uint32_t refill = max(msm_rpmrs_l2_refill_us, 0);
+	unsigned long long in_use_us;
+
+	if (!penalty || !refill)
+		return penalty;
+
+	/* >> 10 is close enough to a division by 1000 here */
+	in_use_us = (sched_clock() - msm_rpmrs_l2_lost_ns) >> 10;
+	if (in_use_us >= refill)
+		return penalty;
+
+	return (uint32_t)in_use_us * penalty / refill;
+}
+
 struct msm_rpmrs_limits *msm_rpmrs_lowest_limits(
 	bool from_idle, enum msm_pm_sleep_mode sleep_mode, uint32_t latency_us,
 	uint32_t sleep_us)
@@ -875,11 +913,14 @@ struct msm_rpmrs_limits *msm_rpmrs_lowest_limits(
 	struct msm_rpmrs_level *best_level = NULL;
 	bool irqs_detectable = false;
 	bool gpio_detectable = false;
+	uint32_t l2_penalty_us = 0;
 	int i;
 
 	if (sleep_mode == MSM_PM_SLEEP_MODE_POWER_COLLAPSE) {
 		irqs_detectable = msm_mpm_irqs_detectable(from_idle);
 		gpio_detectable = msm_mpm_gpio_irqs_detectable(from_idle);
+		if (from_idle)
+			l2_penalty_us = msm_rpmrs_l2_pc_penalty();
 	}
 
 	for (i = 0; i < msm_rpmrs_level_count; i++) {
@@ -899,6 +940,11 @@ struct msm_rpmrs_limits *msm_rpmrs_lowest_limits(
 					irqs_detectable, gpio_detectable))
 			continue;
 
+		if (l2_penalty_us &&
+		    level->rs_limits.l2_cache == MSM_RPMRS_L2_CACHE_HSFS_OPEN &&
+		    sleep_us < level->time_overhead_us + l2_penalty_us)
+			continue;
+
 		if (sleep_us <= 1) {
 			power = level->energy_overhead;
 		} else if (sleep_us <= level->time_overhead_us) {
@@ -948,6 +994,9 @@ void msm_rpmrs_exit_sleep(struct msm_rpmrs_limits *limits, bool from_idle,
 	/* Disable L2 for now, we dont want L2 to do retention by default */
 	msm_rpmrs_L2_restore(limits, notify_rpm, collapsed);
 
+	if (collapsed && limits->l2_cache == MSM_RPMRS_L2_CACHE_HSFS_OPEN)
+		msm_rpmrs_l2_lost_ns = sched_clock();
+
 	if (msm_rpmrs_use_mpm(limits))
 		msm_mpm_exit_sleep(from_idle);
 }
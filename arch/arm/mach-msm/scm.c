@@ -185,7 +185,7 @@ static u32 smc(u32 cmd_addr)
 	return r0;
 }
 
-static int __scm_call(const struct scm_command *cmd)
+static int __scm_call(const struct scm_command *cmd, bool flush_all)
 {
 	int ret;
 	u32 cmd_addr = virt_to_phys(cmd);
@@ -193,9 +193,16 @@ static int __scm_call(const struct scm_command *cmd)
 	/*
 	 * Flush the entire cache here so callers don't have to remember
 	 * to flush the cache when passing physical addresses to the secure
-	 * side in the buffer.
+	 * side in the buffer. Otherwise only the command itself needs to
+	 * reach memory; flush rather than clean it, so that no dirty line
+	 * can be evicted over the response later.
 	 */
-	flush_cache_all();
+	if (flush_all) {
+		flush_cache_all();
+	} else {
+		dmac_flush_range(cmd, (void *)cmd + cmd->len);
+		outer_flush_range(cmd_addr, cmd_addr + cmd->len);
+	}
 	ret = smc(cmd_addr);
 	if (ret < 0)
 		ret = scm_remap_error(ret);
@@ -218,19 +225,9 @@ static void scm_inv_range(unsigned long start, unsigned long end)
 	isb();
 }
 
-/**
- * scm_call() - Send an SCM command
- * @svc_id: service identifier
- * @cmd_id: command identifier
- * @cmd_buf: command buffer
- * @cmd_len: length of the command buffer
- * @resp_buf: response buffer
- * @resp_len: length of the response buffer
- *
- * Sends a command to the SCM and waits for the command to finish processing.
- */
-int scm_call(u32 svc_id, u32 cmd_id, const void *cmd_buf, size_t cmd_len,
-		void *resp_buf, size_t resp_len)
+static int scm_call_common(u32 svc_id, u32 cmd_id, const void *cmd_buf,
+		size_t cmd_len, void *resp_buf, size_t resp_len,
+		bool flush_all)
 {
 	int ret;
 	struct scm_command *cmd;
@@ -246,7 +243,7 @@ int scm_call(u32 svc_id, u32 cmd_id, const void *cmd_buf, size_t cmd_len,
 		memcpy(scm_get_command_buffer(cmd), cmd_buf, cmd_len);
 
 	mutex_lock(&scm_lock);
-	ret = __scm_call(cmd);
+	ret = __scm_call(cmd, flush_all);
 	mutex_unlock(&scm_lock);
 	if (ret)
 		goto out;
@@ -267,8 +264,47 @@ out:
 	free_scm_command(cmd);
 	return ret;
 }
+
+/**
+ * scm_call() - Send an SCM command
+ * @svc_id: service identifier
+ * @cmd_id: command identifier
+ * @cmd_buf: command buffer
+ * @cmd_len: length of the command buffer
+ * @resp_buf: response buffer
+ * @resp_len: length of the response buffer
+ *
+ * Sends a command to the SCM and waits for the command to finish processing.
+ */
+int scm_call(u32 svc_id, u32 cmd_id, const void *cmd_buf, size_t cmd_len,
+		void *resp_buf, size_t resp_len)
+{
+	return scm_call_common(svc_id, cmd_id, cmd_buf, cmd_len,
+			resp_buf, resp_len, true);
+}
 EXPORT_SYMBOL(scm_call);
 
+/**
+ * scm_call_noflush() - Send an SCM command without a full cache flush
+ * @svc_id: service identifier
+ * @cmd_id: command identifier
+ * @cmd_buf: command buffer
+ * @cmd_len: length of the command buffer
+ * @resp_buf: response buffer
+ * @resp_len: length of the response buffer
+ *
+ * Same as scm_call(), but only the command and response are maintained:
+ * the caller is responsible for the caches of any memory it passes the
+ * physical address of, or for commands that only carry values.
+ */
+int scm_call_noflush(u32 svc_id, u32 cmd_id, const void *cmd_buf,
+		size_t cmd_len, void *resp_buf, size_t resp_len)
+{
+	return scm_call_common(svc_id, cmd_id, cmd_buf, cmd_len,
+			resp_buf, resp_len, false);
+}
+EXPORT_SYMBOL(scm_call_noflush);
+
 #define SCM_CLASS_REGISTER	(0x2 << 8)
 #define SCM_MASK_IRQS		BIT(5)
 #define SCM_ATOMIC(svc, cmd, n) (((((svc) << 10)|((cmd) & 0x3ff)) << 12) | \
@@ -420,7 +456,7 @@ int scm_is_call_available(u32 svc_id, u32 cmd_id)
 	u32 svc_cmd = (svc_id << 10) | cmd_id;
 	u32 ret_val = 0;
 
-	ret = scm_call(SCM_SVC_INFO, IS_CALL_AVAIL_CMD, &svc_cmd,
+	ret = scm_call_noflush(SCM_SVC_INFO, IS_CALL_AVAIL_CMD, &svc_cmd,
 			sizeof(svc_cmd), &ret_val, sizeof(ret_val));
 	if (ret)
 		return ret;
@@ -380,6 +380,14 @@ struct sdio_al_work {
  *  @ask_mbox - Flag to request reading the mailbox,
  *					  for different reasons.
  *
+ *  @mbox_read_seq - Count of mailbox reads, bumped before each
+ *  		read.
+ *
+ *  @mbox_ask_seq - mbox_read_seq at the last request to read the
+ *  		mailbox. If it moved by the time the worker runs,
+ *  		the mailbox was read after the request and the
+ *  		worker skips its own read.
+ *
  *  @wake_lock - Lock when can't sleep.
  *
  *  @lpm_chan - Channel to use for LPM (low power mode)
@@ -421,6 +429,10 @@ struct sdio_al_device {
 
 	wait_queue_head_t   wait_mbox;
 	int ask_mbox;
+	atomic_t mbox_read_seq;
+	int mbox_ask_seq;
+	unsigned long mbox_reads;
+	unsigned long mbox_coalesced;
 	int bootloader_done;
 
 	struct wake_lock wake_lock;
@@ -489,6 +501,15 @@ module_param(debug_data_on, int, 0);
 static int debug_close_on = 1;
 module_param(debug_close_on, int, 0);
 
+/*
+ * Mailbox polling period in msec, overriding the one of the channels
+ * configuration: -1 keeps the channels configuration, 0 relies on the
+ * mailbox interrupt alone. Takes effect on the next channel open or
+ * wake up.
+ */
+static int mbox_poll_msec = -1;
+module_param(mbox_poll_msec, int, S_IRUGO | S_IWUSR);
+
 /** The driver context */
 static struct sdio_al *sdio_al;
 
@@ -1065,6 +1086,9 @@ static int read_mailbox(struct sdio_al_device *sdio_al_dev, int from_isr)
 	pr_debug(MODULE_NAME ":start %s from_isr = %d for card %d.\n"
 		 , __func__, from_isr, sdio_al_dev->host->index);
 
+	atomic_inc(&sdio_al_dev->mbox_read_seq);
+	sdio_al_dev->mbox_reads++;
+
 	pr_debug(MODULE_NAME ":before sdio_memcpy_fromio.\n");
 	memset(mailbox, 0, sizeof(struct sdio_mailbox));
 	ret = sdio_memcpy_fromio(func1, mailbox,
@@ -1471,6 +1495,20 @@ static void worker(struct work_struct *work)
 			break;
 		if (sdio_al_claim_mutex_and_verify_dev(sdio_al_dev, __func__))
 			break;
+		/*
+		 * The interrupt handler or an earlier pass of this loop may
+		 * have read the mailbox since the request was made: nothing
+		 * can have been missed then, save the transaction.
+		 */
+		sdio_al_dev->ask_mbox = false;
+		smp_mb();
+		if (atomic_read(&sdio_al_dev->mbox_read_seq) !=
+		    sdio_al_dev->mbox_ask_seq) {
+			sdio_al_dev->mbox_coalesced++;
+			sdio_al_release_mutex(sdio_al_dev, __func__);
+			continue;
+		}
+		sdio_al_dev->ask_mbox = true;
 		if (sdio_al_dev->is_ok_to_sleep) {
 			ret = sdio_al_wake_up(sdio_al_dev, 1, NULL);
 			if (ret) {
@@ -2327,6 +2365,7 @@ exit_err:
  */
 static void ask_reading_mailbox(struct sdio_al_device *sdio_al_dev)
 {
+	sdio_al_dev->mbox_ask_seq = atomic_read(&sdio_al_dev->mbox_read_seq);
 	if (!sdio_al_dev->ask_mbox) {
 		pr_debug(MODULE_NAME ":ask_reading_mailbox for card %d\n",
 			 sdio_al_dev->host->index);
@@ -2719,6 +2758,9 @@ static int get_min_poll_time_msec(struct sdio_al_device *sdio_sl_dev)
 	if (poll_delay_msec == 0x0FFFFFFF)
 		poll_delay_msec = SDIO_AL_POLL_TIME_NO_STREAMING;
 
+	if (mbox_poll_msec >= 0)
+		poll_delay_msec = mbox_poll_msec;
+
 	pr_debug(MODULE_NAME ":poll delay time is %d msec\n", poll_delay_msec);
 
 	return poll_delay_msec;
@@ -4086,6 +4128,12 @@ static void sdio_al_print_info(void)
 			sdio_al_dev->host->index,
 			sdio_al_dev->is_ok_to_sleep);
 
+		sdio_al_loge(sdio_al_dev->dev_log, MODULE_NAME ": Card#%d: "
+			"mailbox reads=%lu, coalesced=%lu\n",
+			sdio_al_dev->host->index,
+			sdio_al_dev->mbox_reads,
+			sdio_al_dev->mbox_coalesced);
+
 
 		sdio_al_loge(sdio_al_dev->dev_log, MODULE_NAME ": Card#%d: "
 				   "Shadow channels SW MB:",
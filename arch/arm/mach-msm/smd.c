@@ -33,8 +33,12 @@
 #include <linux/uaccess.h>
 #include <linux/kfifo.h>
 #include <linux/wakelock.h>
+#include <linux/hrtimer.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
 #include <mach/msm_smd.h>
 #include <mach/msm_iomap.h>
+#include <mach/board.h>
 #include <mach/system.h>
 #include <mach/subsystem_notif.h>
 #include <mach/socinfo.h>
@@ -43,6 +47,9 @@
 #include "proc_comm.h"
 #include "modem_notifier.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/smd.h>
+
 #if defined(CONFIG_ARCH_QSD8X50) || defined(CONFIG_ARCH_MSM8X60) \
 	|| defined(CONFIG_ARCH_MSM8960) || defined(CONFIG_ARCH_FSM9XXX) \
 	|| defined(CONFIG_ARCH_MSM9615)	|| defined(CONFIG_ARCH_APQ8064)
@@ -106,6 +113,10 @@ struct smsm_state_cb_info {
 struct smsm_state_info {
 	struct list_head callbacks;
 	uint32_t last_value;
+	/* state in the last snapshot queued, under smem_lock */
+	uint32_t last_queued;
+	/* bits any callback of this entry is interested in */
+	uint32_t cb_mask;
 };
 
 #define SMSM_STATE_ADDR(entry)           (smsm_info.state + entry)
@@ -254,6 +265,7 @@ static LIST_HEAD(smd_ch_list_loopback);
 static irqreturn_t smsm_irq_handler(int irq, void *data);
 static void smd_fake_irq_handler(unsigned long arg);
 static void smsm_cb_snapshot(uint32_t use_wakelock);
+static void smem_cache_invalidate(void);
 
 static struct workqueue_struct *smsm_cb_wq;
 static void notify_smsm_cb_clients_worker(struct work_struct *work);
@@ -433,6 +445,30 @@ struct smd_shared_v2 {
 	struct smd_half_channel ch1;
 };
 
+#define SMD_HIST_BUCKETS 16
+
+/*
+ * Per-channel performance counters.  Histogram bucket n counts events that
+ * took less than 2^n microseconds; the last bucket is open ended.
+ */
+struct smd_ch_stats {
+	u64 tx_bytes;
+	u64 rx_bytes;
+	unsigned tx_hwm;
+	unsigned rx_hwm;
+	unsigned read_intr_blocked;
+
+	/* oldest write not yet acknowledged by a remote read, 0 if none */
+	u64 write_ts;
+	unsigned remote_read_hist[SMD_HIST_BUCKETS];
+	unsigned notify_hist[SMD_HIST_BUCKETS];
+
+	/* snapshot taken by the last smd_stats_dump() for rate calculation */
+	u64 last_ts;
+	u64 last_tx_bytes;
+	u64 last_rx_bytes;
+};
+
 struct smd_channel {
 	volatile struct smd_half_channel *send;
 	volatile struct smd_half_channel *recv;
@@ -466,6 +502,15 @@ struct smd_channel {
 	int pending_pkt_sz;
 
 	char is_pkt_ch;
+
+	/* set while smd_write_defer() is filling the fifo */
+	char defer_notify;
+	/* data was written without interrupting the remote processor */
+	char notify_pending;
+
+#if defined(CONFIG_MSM_SMD_DEBUG)
+	struct smd_ch_stats stats;
+#endif
 };
 
 struct edge_to_pid {
@@ -682,6 +727,8 @@ void smd_channel_reset(uint32_t restart_pid)
 	remote_spin_release(&remote_spinlock, restart_pid);
 	remote_spin_release_all(restart_pid);
 
+	smem_cache_invalidate();
+
 	/* reset SMSM entry */
 	if (smsm_info.state) {
 		writel_relaxed(0, SMSM_STATE_ADDR(restart_pid));
@@ -798,6 +845,83 @@ static void ch_read_done(struct smd_channel *ch, unsigned count)
 	ch->send->fTAIL = 1;
 }
 
+#if defined(CONFIG_MSM_SMD_DEBUG)
+static inline unsigned smd_hist_bucket(u64 delta_ns)
+{
+	u32 us = (u32)min_t(u64, div_u64(delta_ns, NSEC_PER_USEC), U32_MAX);
+
+	return min_t(unsigned, fls(us), SMD_HIST_BUCKETS - 1);
+}
+
+static inline u64 smd_stats_now(void)
+{
+	return sched_clock();
+}
+
+static void smd_stats_write(struct smd_channel *ch, int len)
+{
+	unsigned pending;
+
+	pending = (ch->send->head - ch->send->tail) & ch->fifo_mask;
+	ch->stats.tx_bytes += len;
+	if (pending > ch->stats.tx_hwm)
+		ch->stats.tx_hwm = pending;
+	if (!ch->stats.write_ts)
+		ch->stats.write_ts = smd_stats_now();
+
+	trace_smd_write(ch->name, ch->type, len, pending);
+}
+
+static void smd_stats_read(struct smd_channel *ch, int len)
+{
+	ch->stats.rx_bytes += len;
+	trace_smd_read(ch->name, ch->type, len, smd_stream_read_avail(ch));
+
+	if (read_intr_blocked(ch)) {
+		ch->stats.read_intr_blocked++;
+		trace_smd_read_intr_blocked(ch->name, ch->type);
+	}
+}
+
+/* the remote processor has moved our send tail */
+static void smd_stats_remote_read(struct smd_channel *ch)
+{
+	u64 now, delta;
+
+	if (!ch->stats.write_ts)
+		return;
+
+	now = smd_stats_now();
+	delta = now - ch->stats.write_ts;
+	ch->stats.remote_read_hist[smd_hist_bucket(delta)]++;
+	trace_smd_remote_read(ch->name, ch->type, delta);
+
+	/* restart the clock for whatever is still left in the fifo */
+	if (ch->send->head == ch->send->tail)
+		ch->stats.write_ts = 0;
+	else
+		ch->stats.write_ts = now;
+}
+
+/* new data arrived and the client is about to be notified */
+static void smd_stats_rx_notify(struct smd_channel *ch, u64 irq_ts)
+{
+	unsigned avail = smd_stream_read_avail(ch);
+	u64 delta = smd_stats_now() - irq_ts;
+
+	if (avail > ch->stats.rx_hwm)
+		ch->stats.rx_hwm = avail;
+	ch->stats.notify_hist[smd_hist_bucket(delta)]++;
+	trace_smd_rx_notify(ch->name, ch->type, delta);
+}
+#else
+static inline u64 smd_stats_now(void) { return 0; }
+static inline void smd_stats_write(struct smd_channel *ch, int len) {}
+static inline void smd_stats_read(struct smd_channel *ch, int len) {}
+static inline void smd_stats_remote_read(struct smd_channel *ch) {}
+static inline void smd_stats_rx_notify(struct smd_channel *ch, u64 irq_ts) {}
+#endif
+
 /* basic read interface to ch_read_{buffer,done} used
  * by smd_*_read() and update_packet_state()
  * will read-and-discard if the _data pointer is null
@@ -988,6 +1112,7 @@ static void handle_smd_irq(struct list_head *list, void (*notify)(void))
 	unsigned ch_flags;
 	unsigned tmp;
 	unsigned char state_change;
+	u64 irq_ts = smd_stats_now();
 
 	spin_lock_irqsave(&smd_lock, flags);
 	list_for_each_entry(ch, list, ch_list) {
@@ -1012,8 +1137,12 @@ static void handle_smd_irq(struct list_head *list, void (*notify)(void))
 			smd_state_change(ch, ch->last_state, tmp);
 			state_change = 1;
 		}
+		if (ch_flags & 2)
+			smd_stats_remote_read(ch);
 		if (ch_flags) {
 			ch->update_state(ch);
+			if (ch_flags & 1)
+				smd_stats_rx_notify(ch, irq_ts);
 			ch->notify(ch->priv, SMD_EVENT_DATA);
 		}
 		if (ch_flags & 0x4 && !state_change)
@@ -1141,7 +1270,86 @@ static int smd_is_packet(struct smd_alloc_elm *alloc_elm)
 		return 0;
 }
 
-static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
+/*
+ * Per-edge doorbell coalescing.  When a non-zero window (in microseconds)
+ * is configured for an edge, data written on that edge does not interrupt
+ * the remote processor right away.  The first write arms a timer and the
+ * remote processor is interrupted once, when the timer expires, for all
+ * data written in the meantime.  State changes and read notifications are
+ * never delayed.
+ */
+struct smd_coalesce_edge {
+	struct hrtimer timer;
+	atomic_t pending;
+	void (*notify)(void);
+};
+
+static struct smd_coalesce_edge smd_coalesce_edges[SMD_NUM_TYPE];
+static unsigned smd_coalesce_us[SMD_NUM_TYPE];
+module_param_array_named(coalesce_us, smd_coalesce_us, uint, NULL,
+			 S_IRUGO | S_IWUSR | S_IWGRP);
+
+static enum hrtimer_restart smd_coalesce_timer_fn(struct hrtimer *timer)
+{
+	struct smd_coalesce_edge *edge;
+
+	edge = container_of(timer, struct smd_coalesce_edge, timer);
+	atomic_set(&edge->pending, 0);
+	edge->notify();
+
+	return HRTIMER_NORESTART;
+}
+
+static void smd_coalesce_init_edge(unsigned type, void (*notify)(void))
+{
+	struct smd_coalesce_edge *edge = &smd_coalesce_edges[type];
+
+	hrtimer_init(&edge->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	edge->timer.function = smd_coalesce_timer_fn;
+	atomic_set(&edge->pending, 0);
+	edge->notify = notify;
+}
+
+static void smd_coalesce_init(void)
+{
+	smd_coalesce_init_edge(SMD_APPS_MODEM, notify_modem_smd);
+	smd_coalesce_init_edge(SMD_APPS_QDSP, notify_dsp_smd);
+	smd_coalesce_init_edge(SMD_APPS_DSPS, notify_dsps_smd);
+	smd_coalesce_init_edge(SMD_APPS_WCNSS, notify_wcnss_smd);
+}
+
+/* tell the remote processor that new data is available in the fifo */
+static void smd_notify_write(struct smd_channel *ch)
+{
+	struct smd_coalesce_edge *edge;
+	unsigned window;
+
+	if (ch->defer_notify) {
+		ch->notify_pending = 1;
+		return;
+	}
+	ch->notify_pending = 0;
+
+	if (ch->type >= SMD_NUM_TYPE || !smd_coalesce_edges[ch->type].notify) {
+		ch->notify_other_cpu();
+		return;
+	}
+
+	edge = &smd_coalesce_edges[ch->type];
+	window = ACCESS_ONCE(smd_coalesce_us[ch->type]);
+	if (!window) {
+		ch->notify_other_cpu();
+		return;
+	}
+
+	if (!atomic_xchg(&edge->pending, 1))
+		hrtimer_start(&edge->timer,
+			      ns_to_ktime((u64)window * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+}
+
+/* copy data into the fifo without notifying the remote processor */
+static int ch_stream_write(smd_channel_t *ch, const void *_data, int len,
 				int user_buf)
 {
 	void *ptr;
@@ -1150,12 +1358,6 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 	int orig_len = len;
 	int r = 0;
 
-	SMD_DBG("smd_stream_write() %d -> ch%d\n", len, ch->n);
-	if (len < 0)
-		return -EINVAL;
-	else if (len == 0)
-		return 0;
-
 	while ((xfer = ch_write_buffer(ch, &ptr)) != 0) {
 		if (!ch_is_open(ch))
 			break;
@@ -1180,11 +1382,29 @@ static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
 	}
 
 	if (orig_len - len)
-		ch->notify_other_cpu();
+		smd_stats_write(ch, orig_len - len);
 
 	return orig_len - len;
 }
 
+static int smd_stream_write(smd_channel_t *ch, const void *_data, int len,
+				int user_buf)
+{
+	int ret;
+
+	SMD_DBG("smd_stream_write() %d -> ch%d\n", len, ch->n);
+	if (len < 0)
+		return -EINVAL;
+	else if (len == 0)
+		return 0;
+
+	ret = ch_stream_write(ch, _data, len, user_buf);
+	if (ret)
+		smd_notify_write(ch);
+
+	return ret;
+}
+
 static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 				int user_buf)
 {
@@ -1204,15 +1424,19 @@ static int smd_packet_write(smd_channel_t *ch, const void *_data, int len,
 	hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
 
 
-	ret = smd_stream_write(ch, hdr, sizeof(hdr), 0);
+	/* header and payload are signalled to the remote side together */
+	ret = ch_stream_write(ch, hdr, sizeof(hdr), 0);
 	if (ret < 0 || ret != sizeof(hdr)) {
 		SMD_DBG("%s failed to write pkt header: "
 			"%d returned\n", __func__, ret);
+		if (ret > 0)
+			smd_notify_write(ch);
 		return -1;
 	}
 
 
-	ret = smd_stream_write(ch, _data, len, user_buf);
+	ret = ch_stream_write(ch, _data, len, user_buf);
+	smd_notify_write(ch);
 	if (ret < 0 || ret != len) {
 		SMD_DBG("%s failed to write pkt data: "
 			"%d returned\n", __func__, ret);
@@ -1230,9 +1454,11 @@ static int smd_stream_read(smd_channel_t *ch, void *data, int len, int user_buf)
 		return -EINVAL;
 
 	r = ch_read(ch, data, len, user_buf);
-	if (r > 0)
+	if (r > 0) {
+		smd_stats_read(ch, r);
 		if (!read_intr_blocked(ch))
 			ch->notify_other_cpu();
+	}
 
 	return r;
 }
@@ -1249,9 +1475,11 @@ static int smd_packet_read(smd_channel_t *ch, void *data, int len, int user_buf)
 		len = ch->current_packet;
 
 	r = ch_read(ch, data, len, user_buf);
-	if (r > 0)
+	if (r > 0) {
+		smd_stats_read(ch, r);
 		if (!read_intr_blocked(ch))
 			ch->notify_other_cpu();
+	}
 
 	spin_lock_irqsave(&smd_lock, flags);
 	ch->current_packet -= r;
@@ -1273,9 +1501,11 @@ static int smd_packet_read_from_cb(smd_channel_t *ch, void *data, int len,
 		len = ch->current_packet;
 
 	r = ch_read(ch, data, len, user_buf);
-	if (r > 0)
+	if (r > 0) {
+		smd_stats_read(ch, r);
 		if (!read_intr_blocked(ch))
 			ch->notify_other_cpu();
+	}
 
 	ch->current_packet -= r;
 	update_packet_state(ch);
@@ -1617,6 +1847,7 @@ int smd_close(smd_channel_t *ch)
 	SMD_INFO("smd_close(%s)\n", ch->name);
 
 	spin_lock_irqsave(&smd_lock, flags);
+	ch->notify_pending = 0;
 	list_del(&ch->ch_list);
 	if (ch->n == SMD_LOOPBACK_CID) {
 		ch->send->fDSR = 0;
@@ -1788,6 +2019,40 @@ int smd_write_user_buffer(smd_channel_t *ch, const void *data, int len)
 }
 EXPORT_SYMBOL(smd_write_user_buffer);
 
+int smd_write_defer(smd_channel_t *ch, const void *data, int len)
+{
+	int ret;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	if (ch->pending_pkt_sz)
+		return -EBUSY;
+
+	ch->defer_notify = 1;
+	ret = ch->write(ch, data, len, 0);
+	ch->defer_notify = 0;
+
+	return ret;
+}
+EXPORT_SYMBOL(smd_write_defer);
+
+int smd_flush(smd_channel_t *ch)
+{
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	if (ch->notify_pending)
+		smd_notify_write(ch);
+
+	return 0;
+}
+EXPORT_SYMBOL(smd_flush);
+
 int smd_read_avail(smd_channel_t *ch)
 {
 	if (!ch) {
@@ -1799,6 +2064,37 @@ int smd_read_avail(smd_channel_t *ch)
 }
 EXPORT_SYMBOL(smd_read_avail);
 
+int smd_rx_fifo_phys(smd_channel_t *ch, phys_addr_t *phys, unsigned *size)
+{
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	/* the loopback fifo lives in kernel memory, not in smem */
+	if (ch->n == SMD_LOOPBACK_CID)
+		return -EINVAL;
+
+	*phys = msm_shared_ram_phys +
+		((unsigned char *)ch->recv_data -
+		 (unsigned char *)MSM_SHARED_RAM_BASE);
+	*size = ch->fifo_size;
+
+	return 0;
+}
+EXPORT_SYMBOL(smd_rx_fifo_phys);
+
+int smd_rx_fifo_tail(smd_channel_t *ch)
+{
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+
+	return ch->recv->tail;
+}
+EXPORT_SYMBOL(smd_rx_fifo_tail);
+
 int smd_write_avail(smd_channel_t *ch)
 {
 	if (!ch) {
@@ -1908,8 +2204,116 @@ int smd_tiocmset(smd_channel_t *ch, unsigned int set, unsigned int clear)
 EXPORT_SYMBOL(smd_tiocmset);
 
 
+#if defined(CONFIG_MSM_SMD_DEBUG)
+static int smd_stats_print_hist(char *buf, int max, const char *label,
+				unsigned *hist)
+{
+	int n, i = 0;
+
+	i += scnprintf(buf + i, max - i, "  %-12s", label);
+	for (n = 0; n < SMD_HIST_BUCKETS; n++)
+		i += scnprintf(buf + i, max - i, " %u", hist[n]);
+	i += scnprintf(buf + i, max - i, "\n");
+
+	return i;
+}
+
+static int smd_stats_print_list(char *buf, int max, struct list_head *list,
+				u64 now)
+{
+	struct smd_channel *ch;
+	struct smd_ch_stats *st;
+	u64 elapsed_us, tx_rate, rx_rate;
+	int i = 0;
+
+	list_for_each_entry(ch, list, ch_list) {
+		st = &ch->stats;
+		tx_rate = rx_rate = 0;
+		elapsed_us = st->last_ts ?
+			div_u64(now - st->last_ts, NSEC_PER_USEC) : 0;
+		if (elapsed_us) {
+			tx_rate = div64_u64((st->tx_bytes - st->last_tx_bytes)
+					    * USEC_PER_SEC, elapsed_us);
+			rx_rate = div64_u64((st->rx_bytes - st->last_rx_bytes)
+					    * USEC_PER_SEC, elapsed_us);
+		}
+		st->last_ts = now;
+		st->last_tx_bytes = st->tx_bytes;
+		st->last_rx_bytes = st->rx_bytes;
+
+		i += scnprintf(buf + i, max - i,
+			       "ch%02d %s edge=%u tx=%llu (%llu B/s) "
+			       "rx=%llu (%llu B/s) tx_hwm=%u/%u rx_hwm=%u/%u "
+			       "rintr_blocked=%u\n",
+			       ch->n, ch->name, ch->type,
+			       st->tx_bytes, tx_rate, st->rx_bytes, rx_rate,
+			       st->tx_hwm, ch->fifo_size,
+			       st->rx_hwm, ch->fifo_size,
+			       st->read_intr_blocked);
+		i += smd_stats_print_hist(buf + i, max - i, "remote_read",
+					  st->remote_read_hist);
+		i += smd_stats_print_hist(buf + i, max - i, "notify",
+					  st->notify_hist);
+	}
+
+	return i;
+}
+
+int smd_stats_dump(char *buf, int max)
+{
+	unsigned long flags;
+	u64 now = smd_stats_now();
+	int i = 0;
+
+	i += scnprintf(buf + i, max - i,
+		       "histogram bucket n: < 2^n us, last bucket open\n");
+
+	spin_lock_irqsave(&smd_lock, flags);
+	i += smd_stats_print_list(buf + i, max - i, &smd_ch_list_modem, now);
+	i += smd_stats_print_list(buf + i, max - i, &smd_ch_list_dsp, now);
+	i += smd_stats_print_list(buf + i, max - i, &smd_ch_list_dsps, now);
+	i += smd_stats_print_list(buf + i, max - i, &smd_ch_list_wcnss, now);
+	spin_unlock_irqrestore(&smd_lock, flags);
+
+	return i;
+}
+#else
+int smd_stats_dump(char *buf, int max)
+{
+	return 0;
+}
+#endif
+
 /* -------------------------------------------------------------------------- */
 
+/*
+ * Items are never freed or moved once allocated, so their location is
+ * remembered here the first time it is looked up and later lookups skip
+ * the remote spinlock. An entry is valid when its address is set; the
+ * size is written before and read after it.
+ */
+static struct smem_cache_entry {
+	void *addr;
+	unsigned size;
+} smem_cache[SMEM_NUM_ITEMS];
+
+static void smem_cache_set(unsigned id, void *addr, unsigned size)
+{
+	smem_cache[id].size = size;
+	smp_wmb();
+	smem_cache[id].addr = addr;
+}
+
+/* Forget everything, for when a remote processor restarts */
+static void smem_cache_invalidate(void)
+{
+	unsigned id;
+
+	for (id = 0; id < SMEM_NUM_ITEMS; id++)
+		smem_cache[id].addr = NULL;
+	smp_wmb();
+}
+
 /* smem_alloc returns the pointer to smem item if it is already allocated.
  * Otherwise, it returns NULL.
  */
@@ -1957,6 +2361,7 @@ void *smem_alloc2(unsigned id, unsigned size_in)
 			shared->heap_info.free_offset += size_in;
 			shared->heap_info.heap_remaining -= size_in;
 			ret = (void *)(MSM_SHARED_RAM_BASE + toc[id].offset);
+			smem_cache_set(id, ret, size_in);
 		} else
 			pr_err("%s: not enough memory %u (required %u)\n",
 			       __func__, shared->heap_info.heap_remaining,
@@ -1979,6 +2384,13 @@ void *smem_get_entry(unsigned id, unsigned *size)
 	if (id >= SMEM_NUM_ITEMS)
 		return ret;
 
+	ret = ACCESS_ONCE(smem_cache[id].addr);
+	if (ret) {
+		smp_rmb();
+		*size = smem_cache[id].size;
+		return ret;
+	}
+
 	if (use_spinlocks)
 		remote_spin_lock_irqsave(&remote_spinlock, flags);
 	/* toc is in device memory and cannot be speculatively accessed */
@@ -1986,6 +2398,7 @@ void *smem_get_entry(unsigned id, unsigned *size)
 		*size = toc[id].size;
 		barrier();
 		ret = (void *) (MSM_SHARED_RAM_BASE + toc[id].offset);
+		smem_cache_set(id, ret, *size);
 	} else {
 		*size = 0;
 	}
@@ -2022,7 +2435,8 @@ static int smsm_cb_init(void)
 	int n;
 	int ret = 0;
 
-	smsm_states = kmalloc(sizeof(struct smsm_state_info)*SMSM_NUM_ENTRIES,
+	/* zeroed, so that snapshots taken before the loop below are skipped */
+	smsm_states = kzalloc(sizeof(struct smsm_state_info)*SMSM_NUM_ENTRIES,
 		   GFP_KERNEL);
 
 	if (!smsm_states) {
@@ -2034,6 +2448,7 @@ static int smsm_cb_init(void)
 	if (!smsm_cb_wq) {
 		pr_err("%s: smsm_cb_wq creation failed\n", __func__);
 		kfree(smsm_states);
+		smsm_states = NULL;
 		return -EFAULT;
 	}
 
@@ -2041,6 +2456,8 @@ static int smsm_cb_init(void)
 	for (n = 0; n < SMSM_NUM_ENTRIES; n++) {
 		state_info = &smsm_states[n];
 		state_info->last_value = __raw_readl(SMSM_STATE_ADDR(n));
+		state_info->last_queued = state_info->last_value;
+		state_info->cb_mask = 0;
 		INIT_LIST_HEAD(&state_info->callbacks);
 	}
 	mutex_unlock(&smsm_lock);
@@ -2154,6 +2571,24 @@ static void smsm_cb_snapshot(uint32_t use_wakelock)
 	unsigned long flags;
 	int ret;
 
+	/*
+	 * Don't wake anybody up unless a bit some callback listens to
+	 * changed since the last queued snapshot. Changes to other bits
+	 * are kept back in last_queued and delivered with the next
+	 * snapshot that does get queued.
+	 */
+	if (smsm_states) {
+		uint32_t interesting = 0;
+
+		for (n = 0; n < SMSM_NUM_ENTRIES; n++) {
+			new_state = __raw_readl(SMSM_STATE_ADDR(n));
+			interesting |= (new_state ^ smsm_states[n].last_queued)
+					& ACCESS_ONCE(smsm_states[n].cb_mask);
+		}
+		if (!interesting)
+			return;
+	}
+
 	ret = kfifo_avail(&smsm_snapshot_fifo);
 	if (ret < SMSM_SNAPSHOT_SIZE) {
 		pr_err("%s: SMSM snapshot full %d\n", __func__, ret);
@@ -2193,6 +2628,8 @@ static void smsm_cb_snapshot(uint32_t use_wakelock)
 			pr_err("%s: SMSM snapshot failure %d\n", __func__, ret);
 			goto restore_snapshot_count;
 		}
+		if (smsm_states)
+			smsm_states[n].last_queued = new_state;
 	}
 
 	/* queue wakelock usage flag */
@@ -2481,6 +2918,17 @@ void notify_smsm_cb_clients_worker(struct work_struct *work)
 }
 
 
+/* Recompute the bits the callbacks of an entry listen to, under smsm_lock */
+static void smsm_update_cb_mask(struct smsm_state_info *state_info)
+{
+	struct smsm_state_cb_info *cb_info;
+	uint32_t mask = 0;
+
+	list_for_each_entry(cb_info, &state_info->callbacks, cb_list)
+		mask |= cb_info->mask;
+	ACCESS_ONCE(state_info->cb_mask) = mask;
+}
+
 /**
  * Registers callback for SMSM state notifications when the specified
  * bits change.
@@ -2539,6 +2987,7 @@ int smsm_state_cb_register(uint32_t smsm_entry, uint32_t mask,
 		list_add_tail(&cb_info->cb_list,
 			&smsm_states[smsm_entry].callbacks);
 	}
+	smsm_update_cb_mask(&smsm_states[smsm_entry]);
 
 cleanup:
 	mutex_unlock(&smsm_lock);
@@ -2593,6 +3042,7 @@ int smsm_state_cb_deregister(uint32_t smsm_entry, uint32_t mask,
 			break;
 		}
 	}
+	smsm_update_cb_mask(&smsm_states[smsm_entry]);
 
 	mutex_unlock(&smsm_lock);
 	return ret;
@@ -2787,6 +3237,7 @@ static int __devinit msm_smd_probe(struct platform_device *pdev)
 	SMD_INFO("smd probe\n");
 
 	INIT_WORK(&probe_work, smd_channel_probe_worker);
+	smd_coalesce_init();
 
 	channel_close_wq = create_singlethread_workqueue("smd_channel_close");
 	if (IS_ERR(channel_close_wq)) {
@@ -643,7 +643,7 @@ static int debug_read_intr_mux(char *buf, int max)
 	return i;
 }
 
-#define DEBUG_BUFMAX 4096
+#define DEBUG_BUFMAX 16384
 static char debug_buffer[DEBUG_BUFMAX];
 
 static ssize_t debug_read(struct file *file, char __user *buf,
@@ -686,6 +686,7 @@ static int __init smd_debugfs_init(void)
 		return PTR_ERR(dent);
 
 	debug_create("ch", 0444, dent, debug_read_ch);
+	debug_create("ch_stats", 0444, dent, smd_stats_dump);
 	debug_create("diag", 0444, dent, debug_read_diag_msg);
 	debug_create("mem", 0444, dent, debug_read_mem);
 	debug_create("version", 0444, dent, debug_read_smd_version);
@@ -30,6 +30,7 @@
 #include <linux/completion.h>
 #include <linux/msm_smd_pkt.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
 #include <asm/ioctls.h>
 #include <linux/wakelock.h>
 
@@ -191,11 +192,88 @@ static void packet_arrival_worker(struct work_struct *work)
 	mutex_unlock(&smd_pkt_devp->ch_lock);
 }
 
+/* release the arrival wakelock once the last pending packet is read */
+static void smd_pkt_rx_done(struct smd_pkt_dev *smd_pkt_devp)
+{
+	unsigned long flags;
+
+	mutex_lock(&smd_pkt_devp->ch_lock);
+	spin_lock_irqsave(&smd_pkt_devp->pa_spinlock, flags);
+	if (smd_pkt_devp->poll_mode &&
+	    !smd_cur_packet_size(smd_pkt_devp->ch)) {
+		wake_unlock(&smd_pkt_devp->pa_wake_lock);
+		smd_pkt_devp->poll_mode = 0;
+	}
+	spin_unlock_irqrestore(&smd_pkt_devp->pa_spinlock, flags);
+	mutex_unlock(&smd_pkt_devp->ch_lock);
+}
+
+static int smd_pkt_rx_fifo_info(struct smd_pkt_dev *smd_pkt_devp,
+				struct smd_pkt_rx_fifo_info *info)
+{
+	phys_addr_t phys;
+	unsigned size;
+	int r;
+
+	r = smd_rx_fifo_phys(smd_pkt_devp->ch, &phys, &size);
+	if (r < 0)
+		return r;
+
+	info->fifo_offset = phys & ~PAGE_MASK;
+	info->fifo_size = size;
+	info->map_size = PAGE_ALIGN(info->fifo_offset + size);
+
+	return 0;
+}
+
+static int smd_pkt_rx_state(struct smd_pkt_dev *smd_pkt_devp,
+			    struct smd_pkt_rx_state *state)
+{
+	int tail;
+
+	mutex_lock(&smd_pkt_devp->rx_lock);
+	tail = smd_rx_fifo_tail(smd_pkt_devp->ch);
+	if (tail < 0) {
+		mutex_unlock(&smd_pkt_devp->rx_lock);
+		return tail;
+	}
+	state->tail = tail;
+	state->pkt_size = smd_cur_packet_size(smd_pkt_devp->ch);
+	state->avail = smd_read_avail(smd_pkt_devp->ch);
+	mutex_unlock(&smd_pkt_devp->rx_lock);
+
+	return 0;
+}
+
+static int smd_pkt_rx_consume(struct smd_pkt_dev *smd_pkt_devp,
+			      unsigned int count)
+{
+	int r;
+
+	mutex_lock(&smd_pkt_devp->rx_lock);
+	if (count > smd_read_avail(smd_pkt_devp->ch)) {
+		mutex_unlock(&smd_pkt_devp->rx_lock);
+		return -EINVAL;
+	}
+	/* a null buffer makes smd_read() discard the data */
+	r = smd_read(smd_pkt_devp->ch, NULL, count);
+	mutex_unlock(&smd_pkt_devp->rx_lock);
+	if (r < 0)
+		return r;
+
+	smd_pkt_rx_done(smd_pkt_devp);
+	check_and_wakeup_reader(smd_pkt_devp);
+
+	return 0;
+}
+
 static long smd_pkt_ioctl(struct file *file, unsigned int cmd,
 					     unsigned long arg)
 {
 	int ret;
 	struct smd_pkt_dev *smd_pkt_devp;
+	struct smd_pkt_rx_fifo_info fifo_info;
+	struct smd_pkt_rx_state rx_state;
 
 	smd_pkt_devp = file->private_data;
 	if (!smd_pkt_devp)
@@ -211,6 +289,25 @@ static long smd_pkt_ioctl(struct file *file, unsigned int cmd,
 	case SMD_PKT_IOCTL_BLOCKING_WRITE:
 		ret = get_user(smd_pkt_devp->blocking_write, (int *)arg);
 		break;
+	case SMD_PKT_IOCTL_RX_FIFO_INFO:
+		ret = smd_pkt_rx_fifo_info(smd_pkt_devp, &fifo_info);
+		if (!ret && copy_to_user((void __user *)arg, &fifo_info,
+					 sizeof(fifo_info)))
+			ret = -EFAULT;
+		break;
+	case SMD_PKT_IOCTL_RX_STATE:
+		if (smd_pkt_devp->has_reset)
+			return notify_reset(smd_pkt_devp);
+		ret = smd_pkt_rx_state(smd_pkt_devp, &rx_state);
+		if (!ret && copy_to_user((void __user *)arg, &rx_state,
+					 sizeof(rx_state)))
+			ret = -EFAULT;
+		break;
+	case SMD_PKT_IOCTL_RX_CONSUME:
+		if (smd_pkt_devp->has_reset)
+			return notify_reset(smd_pkt_devp);
+		ret = smd_pkt_rx_consume(smd_pkt_devp, arg);
+		break;
 	default:
 		ret = -1;
 	}
@@ -228,7 +325,6 @@ ssize_t smd_pkt_read(struct file *file,
 	int pkt_size;
 	struct smd_pkt_dev *smd_pkt_devp;
 	struct smd_channel *chl;
-	unsigned long flags;
 
 	D(KERN_ERR "%s: read %i bytes\n",
 	  __func__, count);
@@ -309,15 +405,7 @@ wait_for_packet:
 	D_DUMP_BUFFER("read: ", bytes_read, buf);
 	mutex_unlock(&smd_pkt_devp->rx_lock);
 
-	mutex_lock(&smd_pkt_devp->ch_lock);
-	spin_lock_irqsave(&smd_pkt_devp->pa_spinlock, flags);
-	if (smd_pkt_devp->poll_mode &&
-	    !smd_cur_packet_size(smd_pkt_devp->ch)) {
-		wake_unlock(&smd_pkt_devp->pa_wake_lock);
-		smd_pkt_devp->poll_mode = 0;
-	}
-	spin_unlock_irqrestore(&smd_pkt_devp->pa_spinlock, flags);
-	mutex_unlock(&smd_pkt_devp->ch_lock);
+	smd_pkt_rx_done(smd_pkt_devp);
 
 	D(KERN_ERR "%s: just read %i bytes\n",
 	  __func__, bytes_read);
@@ -403,6 +491,41 @@ ssize_t smd_pkt_write(struct file *file,
 	return count;
 }
 
+static int smd_pkt_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct smd_pkt_dev *smd_pkt_devp;
+	struct smd_pkt_rx_fifo_info info;
+	phys_addr_t phys;
+	unsigned size;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	int r;
+
+	smd_pkt_devp = file->private_data;
+	if (!smd_pkt_devp || !smd_pkt_devp->ch)
+		return -EINVAL;
+
+	/* the fifo is owned by the remote processor; never map it writable */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	r = smd_rx_fifo_phys(smd_pkt_devp->ch, &phys, &size);
+	if (r < 0)
+		return r;
+	r = smd_pkt_rx_fifo_info(smd_pkt_devp, &info);
+	if (r < 0)
+		return r;
+
+	if (vma->vm_pgoff || len > info.map_size)
+		return -EINVAL;
+
+	vma->vm_flags |= VM_IO | VM_RESERVED;
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start, phys >> PAGE_SHIFT, len,
+			       vma->vm_page_prot);
+}
+
 static unsigned int smd_pkt_poll(struct file *file, poll_table *wait)
 {
 	struct smd_pkt_dev *smd_pkt_devp;
@@ -737,6 +860,7 @@ static const struct file_operations smd_pkt_fops = {
 	.read = smd_pkt_read,
 	.write = smd_pkt_write,
 	.poll = smd_pkt_poll,
+	.mmap = smd_pkt_mmap,
 	.unlocked_ioctl = smd_pkt_ioctl,
 };
 
@@ -208,6 +208,9 @@ extern spinlock_t smem_lock;
 
 void smd_diag(void);
 
+/* fill buf with the per-channel performance counters of open channels */
+int smd_stats_dump(char *buf, int max);
+
 #define BARCODE_MAX_LEN 64
 #define MACHINE_MAX_LEN 32
 #define CARRIER_MAX_LEN 64
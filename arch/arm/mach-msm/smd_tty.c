@@ -44,6 +44,14 @@ static uint smd_tty_modem_wait;
 module_param_named(modem_wait, smd_tty_modem_wait,
 			uint, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/*
+ * Bytes handed to the tty flip buffers before they are pushed to the line
+ * discipline.  Ports in low latency mode push every chunk as it is read.
+ */
+static uint smd_tty_rx_batch = 4 * MAX_TTY_BUF_SIZE;
+module_param_named(rx_batch, smd_tty_rx_batch,
+			uint, S_IRUGO | S_IWUSR | S_IWGRP);
+
 struct smd_tty_info {
 	smd_channel_t *ch;
 	struct tty_struct *tty;
@@ -60,6 +68,9 @@ struct smd_tty_info {
 	wait_queue_head_t ch_opened_wait_queue;
 	spinlock_t reset_lock;
 	struct smd_config *smd;
+	int low_latency;
+	unsigned throttle_cnt;
+	unsigned buf_full_cnt;
 };
 
 /**
@@ -69,12 +80,15 @@ struct smd_tty_info {
  * @port_name       Name of the SMD port
  * @dev_name        Name of the TTY Device (if NULL, @port_name is used)
  * @edge            SMD edge
+ * @low_latency     Push received data without batching it (default for
+ *                  the low_latency sysfs attribute of the TTY device)
  */
 struct smd_config {
 	uint32_t tty_dev_index;
 	const char *port_name;
 	const char *dev_name;
 	uint32_t edge;
+	int low_latency;
 };
 
 static struct smd_config smd_configs[] = {
@@ -118,6 +132,7 @@ static void smd_tty_read(unsigned long param)
 {
 	unsigned char *ptr;
 	int avail;
+	unsigned pending = 0;
 	struct smd_tty_info *info = (struct smd_tty_info *)param;
 	struct tty_struct *tty = info->tty;
 
@@ -129,6 +144,7 @@ static void smd_tty_read(unsigned long param)
 			/* signal TTY clients using TTY_BREAK */
 			tty_insert_flip_char(tty, 0x00, TTY_BREAK);
 			tty_flip_buffer_push(tty);
+			pending = 0;
 			break;
 		}
 
@@ -142,6 +158,13 @@ static void smd_tty_read(unsigned long param)
 
 		avail = tty_prepare_flip_string(tty, &ptr, avail);
 		if (avail <= 0) {
+			/* hand over what we hold first, it may free room */
+			if (pending) {
+				tty_flip_buffer_push(tty);
+				pending = 0;
+				continue;
+			}
+			info->buf_full_cnt++;
 			if (!timer_pending(&info->buf_req_timer)) {
 				init_timer(&info->buf_req_timer);
 				info->buf_req_timer.expires = jiffies +
@@ -162,8 +185,14 @@ static void smd_tty_read(unsigned long param)
 		}
 
 		wake_lock_timeout(&info->wake_lock, HZ / 2);
-		tty_flip_buffer_push(tty);
+		pending += avail;
+		if (info->low_latency || pending >= smd_tty_rx_batch) {
+			tty_flip_buffer_push(tty);
+			pending = 0;
+		}
 	}
+	if (pending)
+		tty_flip_buffer_push(tty);
 
 	/* XXX only when writable and necessary */
 	tty_wakeup(tty);
@@ -407,6 +436,13 @@ static int smd_tty_chars_in_buffer(struct tty_struct *tty)
 	return smd_read_avail(info->ch);
 }
 
+static void smd_tty_throttle(struct tty_struct *tty)
+{
+	struct smd_tty_info *info = tty->driver_data;
+
+	info->throttle_cnt++;
+}
+
 static void smd_tty_unthrottle(struct tty_struct *tty)
 {
 	struct smd_tty_info *info = tty->driver_data;
@@ -473,6 +509,7 @@ static struct tty_operations smd_tty_ops = {
 	.write = smd_tty_write,
 	.write_room = smd_tty_write_room,
 	.chars_in_buffer = smd_tty_chars_in_buffer,
+	.throttle = smd_tty_throttle,
 	.unthrottle = smd_tty_unthrottle,
 	.tiocmget = smd_tty_tiocmget,
 	.tiocmset = smd_tty_tiocmset,
@@ -500,6 +537,62 @@ static int smd_tty_dummy_probe(struct platform_device *pdev)
 	return -ENODEV;
 }
 
+static ssize_t low_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct smd_tty_info *info = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", info->low_latency);
+}
+
+static ssize_t low_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct smd_tty_info *info = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+	info->low_latency = !!val;
+	return count;
+}
+
+static ssize_t rx_throttle_count_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct smd_tty_info *info = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", info->throttle_cnt);
+}
+
+static ssize_t rx_buf_full_count_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct smd_tty_info *info = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", info->buf_full_cnt);
+}
+
+static struct device_attribute smd_tty_attrs[] = {
+	__ATTR(low_latency, S_IRUGO | S_IWUSR, low_latency_show,
+		low_latency_store),
+	__ATTR_RO(rx_throttle_count),
+	__ATTR_RO(rx_buf_full_count),
+};
+
+static void smd_tty_create_attrs(struct device *dev, struct smd_tty_info *info)
+{
+	int i;
+
+	if (IS_ERR(dev))
+		return;
+	dev_set_drvdata(dev, info);
+	for (i = 0; i < ARRAY_SIZE(smd_tty_attrs); i++)
+		if (device_create_file(dev, &smd_tty_attrs[i]))
+			pr_err("%s: %s attribute failed\n", __func__,
+				smd_tty_attrs[i].attr.name);
+}
+
 static struct tty_driver *smd_tty_driver;
 
 static int __init smd_tty_init(void)
@@ -507,6 +600,7 @@ static int __init smd_tty_init(void)
 	int ret;
 	int n;
 	int idx;
+	struct device *tty_dev;
 
 	smd_tty_driver = alloc_tty_driver(MAX_SMD_TTYS);
 	if (smd_tty_driver == 0)
@@ -562,7 +656,9 @@ static int __init smd_tty_init(void)
 				continue;
 		}
 
-		tty_register_device(smd_tty_driver, idx, 0);
+		smd_tty[idx].low_latency = smd_configs[n].low_latency;
+		tty_dev = tty_register_device(smd_tty_driver, idx, 0);
+		smd_tty_create_attrs(tty_dev, &smd_tty[idx]);
 		init_completion(&smd_tty[idx].ch_allocated);
 
 		/* register platform device */
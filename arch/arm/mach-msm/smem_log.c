@@ -29,6 +29,9 @@
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/delay.h>
+#include <linux/percpu.h>
+#include <linux/cpu.h>
+#include <linux/smp.h>
 
 #include <mach/msm_iomap.h>
 #include <mach/smem_log.h>
@@ -94,9 +97,34 @@ static remote_spinlock_t remote_spinlock;
 static remote_spinlock_t remote_spinlock_static;
 static uint32_t smem_log_enable;
 static int smem_log_initialized;
+static int smem_log_local;
 
 module_param_named(log_enable, smem_log_enable, int,
 		   S_IRUGO | S_IWUSR | S_IWGRP);
+/*
+ * With log_local set, the events logged by the kernel are first kept in a
+ * per-cpu area, without taking the remote spinlock, and only copied to
+ * shared memory when that area fills up or when the log is read. They
+ * keep the timestamp of the time they were logged, but show up in shared
+ * memory in batches, so the other processors see them late.
+ */
+module_param_named(log_local, smem_log_local, int,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define SMEM_LOG_LOCAL_ENTRIES 64
+
+struct smem_log_pending {
+	uint8_t which_log;
+	uint8_t num_items;
+	struct smem_log_item item[2];
+};
+
+struct smem_log_local_area {
+	unsigned int count;
+	struct smem_log_pending pending[SMEM_LOG_LOCAL_ENTRIES];
+};
+
+static DEFINE_PER_CPU(struct smem_log_local_area, smem_log_local_area);
 
 
 struct smem_log_inst {
@@ -691,56 +719,131 @@ static void smem_log_event_from_user(struct smem_log_inst *inst,
 	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
 }
 
-static void _smem_log_event(
-	struct smem_log_item __iomem *events,
-	uint32_t __iomem *_idx,
-	remote_spinlock_t *lock,
-	int num,
-	uint32_t id, uint32_t data1, uint32_t data2,
-	uint32_t data3)
+/* Called with the remote spinlock of the log held */
+static void __smem_log_put(struct smem_log_inst *inst,
+			   struct smem_log_item *item, int num_items)
 {
-	struct smem_log_item item;
 	uint32_t idx;
 	uint32_t next_idx;
+
+	idx = *inst->idx;
+
+	/* FIXME: Wrap around */
+	if (idx < inst->num - (num_items - 1)) {
+		memcpy(&inst->events[idx],
+		       item, num_items * sizeof(*item));
+	}
+
+	next_idx = idx + num_items;
+	if (next_idx >= inst->num)
+		next_idx = 0;
+	*inst->idx = next_idx;
+}
+
+/* Called with interrupts disabled, for the area of the current cpu */
+static void __smem_log_flush_area(struct smem_log_local_area *area)
+{
+	struct smem_log_pending *pending;
 	unsigned long flags;
+	int log, i;
+
+	for (log = GEN; log <= STA; log++) {
+		for (i = 0; i < area->count; i++)
+			if (area->pending[i].which_log == log)
+				break;
+		if (i == area->count)
+			continue;
+
+		remote_spin_lock_irqsave(inst[log].remote_spinlock, flags);
+		for (; i < area->count; i++) {
+			pending = &area->pending[i];
+			if (pending->which_log == log)
+				__smem_log_put(&inst[log], pending->item,
+					       pending->num_items);
+		}
+		wmb();
+		remote_spin_unlock_irqrestore(inst[log].remote_spinlock,
+					      flags);
+	}
+	area->count = 0;
+}
 
-	item.timetick = read_timestamp();
-	item.identifier = id;
-	item.data1 = data1;
-	item.data2 = data2;
-	item.data3 = data3;
+static void smem_log_flush_cpu(void *unused)
+{
+	unsigned long flags;
 
-	remote_spin_lock_irqsave(lock, flags);
+	local_irq_save(flags);
+	__smem_log_flush_area(&__get_cpu_var(smem_log_local_area));
+	local_irq_restore(flags);
+}
 
-	idx = *_idx;
+/* Copy the events kept locally by all the cpus to shared memory */
+static void smem_log_flush_local(void)
+{
+	unsigned long flags;
+	int cpu;
+
+	get_online_cpus();
+	on_each_cpu(smem_log_flush_cpu, NULL, 1);
+	for_each_possible_cpu(cpu) {
+		if (cpu_online(cpu))
+			continue;
+		local_irq_save(flags);
+		__smem_log_flush_area(&per_cpu(smem_log_local_area, cpu));
+		local_irq_restore(flags);
+	}
+	put_online_cpus();
+}
 
-	if (idx < num) {
-		memcpy(&events[idx],
-		       &item, sizeof(item));
+static void smem_log_put(struct smem_log_inst *inst,
+			 struct smem_log_item *item, int num_items)
+{
+	struct smem_log_local_area *area;
+	struct smem_log_pending *pending;
+	unsigned long flags;
+
+	if (smem_log_local) {
+		local_irq_save(flags);
+		area = &__get_cpu_var(smem_log_local_area);
+		if (area->count == SMEM_LOG_LOCAL_ENTRIES)
+			__smem_log_flush_area(area);
+		pending = &area->pending[area->count++];
+		pending->which_log = inst->which_log;
+		pending->num_items = num_items;
+		memcpy(pending->item, item, num_items * sizeof(*item));
+		local_irq_restore(flags);
+		return;
 	}
 
-	next_idx = idx + 1;
-	if (next_idx >= num)
-		next_idx = 0;
-	*_idx = next_idx;
+	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
+	__smem_log_put(inst, item, num_items);
 	wmb();
+	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
+}
+
+static void _smem_log_event(
+	struct smem_log_inst *inst,
+	uint32_t id, uint32_t data1, uint32_t data2,
+	uint32_t data3)
+{
+	struct smem_log_item item;
 
-	remote_spin_unlock_irqrestore(lock, flags);
+	item.timetick = read_timestamp();
+	item.identifier = id;
+	item.data1 = data1;
+	item.data2 = data2;
+	item.data3 = data3;
+
+	smem_log_put(inst, &item, 1);
 }
 
 static void _smem_log_event6(
-	struct smem_log_item __iomem *events,
-	uint32_t __iomem *_idx,
-	remote_spinlock_t *lock,
-	int num,
+	struct smem_log_inst *inst,
 	uint32_t id, uint32_t data1, uint32_t data2,
 	uint32_t data3, uint32_t data4, uint32_t data5,
 	uint32_t data6)
 {
 	struct smem_log_item item[2];
-	uint32_t idx;
-	uint32_t next_idx;
-	unsigned long flags;
 
 	item[0].timetick = read_timestamp();
 	item[0].identifier = id;
@@ -753,33 +856,14 @@ static void _smem_log_event6(
 	item[1].data2 = data5;
 	item[1].data3 = data6;
 
-	remote_spin_lock_irqsave(lock, flags);
-
-	idx = *_idx;
-
-	/* FIXME: Wrap around */
-	if (idx < (num-1)) {
-		memcpy(&events[idx],
-			&item, sizeof(item));
-	}
-
-	next_idx = idx + 2;
-	if (next_idx >= num)
-		next_idx = 0;
-	*_idx = next_idx;
-
-	wmb();
-	remote_spin_unlock_irqrestore(lock, flags);
+	smem_log_put(inst, item, 2);
 }
 
 void smem_log_event(uint32_t id, uint32_t data1, uint32_t data2,
 		    uint32_t data3)
 {
 	if (smem_log_enable)
-		_smem_log_event(inst[GEN].events, inst[GEN].idx,
-				inst[GEN].remote_spinlock,
-				SMEM_LOG_NUM_ENTRIES, id,
-				data1, data2, data3);
+		_smem_log_event(&inst[GEN], id, data1, data2, data3);
 }
 
 void smem_log_event6(uint32_t id, uint32_t data1, uint32_t data2,
@@ -787,20 +871,15 @@ void smem_log_event6(uint32_t id, uint32_t data1, uint32_t data2,
 		     uint32_t data6)
 {
 	if (smem_log_enable)
-		_smem_log_event6(inst[GEN].events, inst[GEN].idx,
-				 inst[GEN].remote_spinlock,
-				 SMEM_LOG_NUM_ENTRIES, id,
-				 data1, data2, data3, data4, data5, data6);
+		_smem_log_event6(&inst[GEN], id, data1, data2, data3,
+				 data4, data5, data6);
 }
 
 void smem_log_event_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 		    uint32_t data3)
 {
 	if (smem_log_enable)
-		_smem_log_event(inst[STA].events, inst[STA].idx,
-				inst[STA].remote_spinlock,
-				SMEM_LOG_NUM_STATIC_ENTRIES, id,
-				data1, data2, data3);
+		_smem_log_event(&inst[STA], id, data1, data2, data3);
 }
 
 void smem_log_event6_to_static(uint32_t id, uint32_t data1, uint32_t data2,
@@ -808,10 +887,8 @@ void smem_log_event6_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 		     uint32_t data6)
 {
 	if (smem_log_enable)
-		_smem_log_event6(inst[STA].events, inst[STA].idx,
-				 inst[STA].remote_spinlock,
-				 SMEM_LOG_NUM_STATIC_ENTRIES, id,
-				 data1, data2, data3, data4, data5, data6);
+		_smem_log_event6(&inst[STA], id, data1, data2, data3,
+				 data4, data5, data6);
 }
 
 static int _smem_log_init(void)
@@ -897,6 +974,7 @@ static ssize_t smem_log_read_bin(struct file *fp, char __user *buf,
 
 	local_inst = fp->private_data;
 
+	smem_log_flush_local();
 	remote_spin_lock_irqsave(local_inst->remote_spinlock, flags);
 
 	orig_idx = *local_inst->idx;
@@ -947,6 +1025,7 @@ static ssize_t smem_log_read(struct file *fp, char __user *buf,
 
 	inst = fp->private_data;
 
+	smem_log_flush_local();
 	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
 
 	orig_idx = *inst->idx;
@@ -1189,6 +1268,7 @@ static int update_read_avail(struct smem_log_inst *inst)
 		return -1;
 	}
 
+	smem_log_flush_local();
 	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
 
 	curr_read_avail = (*inst->idx - inst->read_idx);
@@ -1228,6 +1308,7 @@ static int _debug_dump(int log, char *buf, int max, uint32_t cont)
 	if (cont && update_read_avail(&inst[log]) == 0)
 		return 0;
 
+	smem_log_flush_local();
 	remote_spin_lock_irqsave(inst[log].remote_spinlock, flags);
 
 	if (cont) {
@@ -1328,6 +1409,7 @@ static int _debug_dump_sym(int log, char *buf, int max, uint32_t cont)
 	if (cont && update_read_avail(&inst[log]) == 0)
 		return 0;
 
+	smem_log_flush_local();
 	remote_spin_lock_irqsave(inst[log].remote_spinlock, flags);
 
 	if (cont) {
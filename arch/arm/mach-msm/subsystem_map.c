@@ -269,8 +269,8 @@ struct msm_mapped_buffer *msm_subsystem_map_buffer(unsigned long phys,
 {
 	struct msm_mapped_buffer *buf, *err;
 	struct msm_buffer_node *node;
-	int i = 0, j = 0, ret;
-	unsigned long iova_start = 0, temp_phys, temp_va = 0;
+	int i = 0, ret;
+	unsigned long iova_start = 0, temp_va = 0;
 	struct iommu_domain *d = NULL;
 	int map_size = length;
 
@@ -389,23 +389,19 @@ struct msm_mapped_buffer *msm_subsystem_map_buffer(unsigned long phys,
 				continue;
 			}
 
-			temp_phys = phys;
-			temp_va = iova_start;
-			for (j = length; j > 0; j -= SZ_4K,
-					temp_phys += SZ_4K,
-					temp_va += SZ_4K) {
-				ret = iommu_map(d, temp_va, temp_phys,
-						get_order(SZ_4K),
-						(IOMMU_READ | IOMMU_WRITE));
-				if (ret) {
-					pr_err("%s: could not map iommu for"
-						" domain %p, iova %lx,"
-						" phys %lx\n", __func__, d,
-						temp_va, temp_phys);
-					err = ERR_PTR(-EINVAL);
-					goto outdomain;
-				}
+			ret = msm_iommu_map_iova_phys(d, iova_start, phys,
+						      length, 0);
+			if (ret) {
+				pr_err("%s: could not map iommu for"
+					" domain %p, iova %lx,"
+					" phys %lx\n", __func__, d,
+					iova_start, phys);
+				msm_free_iova_address(iova_start, domain_no,
+						partition_no, map_size);
+				err = ERR_PTR(-EINVAL);
+				goto outdomain;
 			}
+			temp_va = iova_start + length;
 			buf->iova[i] = iova_start;
 
 			if (flags & MSM_SUBSYSTEM_MAP_IOMMU_2X)
@@ -430,29 +426,22 @@ struct msm_mapped_buffer *msm_subsystem_map_buffer(unsigned long phys,
 
 outiova:
 	if (flags & MSM_SUBSYSTEM_MAP_IOVA)
-		iommu_unmap(d, temp_va, get_order(SZ_4K));
+		i = nsubsys;
 outdomain:
 	if (flags & MSM_SUBSYSTEM_MAP_IOVA) {
-		/* Unmap the rest of the current domain, i */
-		for (j -= SZ_4K, temp_va -= SZ_4K;
-			j > 0; temp_va -= SZ_4K, j -= SZ_4K)
-			iommu_unmap(d, temp_va, get_order(SZ_4K));
-
-		/* Unmap all the other domains */
+		/* Unmap all the domains mapped so far */
 		for (i--; i >= 0; i--) {
 			unsigned int domain_no, partition_no;
-			if (!msm_use_iommu())
+			if (!msm_use_iommu() || !buf->iova[i])
 				continue;
 			domain_no = msm_subsystem_get_domain_no(subsys_ids[i]);
 			partition_no = msm_subsystem_get_partition_no(
 								subsys_ids[i]);
 
-			temp_va = buf->iova[i];
-			for (j = length; j > 0; j -= SZ_4K,
-						temp_va += SZ_4K)
-				iommu_unmap(d, temp_va, get_order(SZ_4K));
+			iommu_unmap_range(msm_get_iommu_domain(domain_no),
+					  buf->iova[i], map_size);
 			msm_free_iova_address(buf->iova[i], domain_no,
-					partition_no, length);
+					partition_no, map_size);
 		}
 
 		kfree(buf->iova);
@@ -476,8 +465,7 @@ EXPORT_SYMBOL(msm_subsystem_map_buffer);
 int msm_subsystem_unmap_buffer(struct msm_mapped_buffer *buf)
 {
 	struct msm_buffer_node *node;
-	int i, j, ret;
-	unsigned long temp_va;
+	int i, ret;
 
 	if (IS_ERR_OR_NULL(buf))
 		goto out;
@@ -511,15 +499,10 @@ int msm_subsystem_unmap_buffer(struct msm_mapped_buffer *buf)
 				partition_no = msm_subsystem_get_partition_no(
 							node->subsystems[i]);
 
-				temp_va = buf->iova[i];
-				for (j = node->length; j > 0; j -= SZ_4K,
-					temp_va += SZ_4K) {
-					ret = iommu_unmap(subsys_domain,
-							temp_va,
-							get_order(SZ_4K));
-					WARN(ret, "iommu_unmap returned a "
-						" non-zero value.\n");
-				}
+				ret = iommu_unmap_range(subsys_domain,
+						buf->iova[i], node->length);
+				WARN(ret, "iommu_unmap_range returned a "
+					" non-zero value.\n");
 				msm_free_iova_address(buf->iova[i], domain_no,
 						partition_no, node->length);
 			}
@@ -23,6 +23,8 @@
 #include <linux/io.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <asm/current.h>
 
@@ -49,6 +51,13 @@ struct restart_thread_data {
 	int coupled;
 };
 
+struct ramdump_work {
+	struct work_struct work;
+	struct subsys_data *subsys;
+	struct subsys_data *crashed;
+	int ret;
+};
+
 struct restart_log {
 	struct timeval time;
 	struct subsys_data *subsys;
@@ -303,6 +312,59 @@ out:
 	mutex_unlock(&restart_log_mutex);
 }
 
+static void subsystem_ramdump_work(struct work_struct *work)
+{
+	struct ramdump_work *rd = container_of(work, struct ramdump_work, work);
+
+	rd->ret = rd->subsys->ramdump(enable_ramdumps, rd->crashed);
+}
+
+/*
+ * The subsystems of a restart order dump separate memory regions through
+ * separate devices, so collect their ramdumps at the same time instead of
+ * waiting for userspace to drain each one in turn.
+ */
+static void subsystem_collect_ramdumps(struct subsys_data **restart_list,
+		int count, struct subsys_data *crashed)
+{
+	struct ramdump_work *rd;
+	int i;
+
+	rd = kcalloc(count, sizeof(*rd), GFP_KERNEL);
+
+	for (i = 0; i < count; i++) {
+		if (!restart_list[i] || !restart_list[i]->ramdump)
+			continue;
+
+		if (!rd) {
+			if (restart_list[i]->ramdump(enable_ramdumps,
+							crashed) < 0)
+				pr_warn("%s[%p]: Ramdump failed.\n",
+						restart_list[i]->name, current);
+			continue;
+		}
+
+		rd[i].subsys = restart_list[i];
+		rd[i].crashed = crashed;
+		INIT_WORK(&rd[i].work, subsystem_ramdump_work);
+		queue_work(system_unbound_wq, &rd[i].work);
+	}
+
+	if (!rd)
+		return;
+
+	for (i = 0; i < count; i++) {
+		if (!rd[i].subsys)
+			continue;
+
+		flush_work(&rd[i].work);
+		if (rd[i].ret < 0)
+			pr_warn("%s[%p]: Ramdump failed.\n",
+					rd[i].subsys->name, current);
+	}
+	kfree(rd);
+}
+
 static int subsystem_restart_thread(void *data)
 {
 	struct restart_thread_data *r_work = data;
@@ -398,17 +460,8 @@ static int subsystem_restart_thread(void *data)
 	 */
 	mutex_unlock(shutdown_lock);
 
-	/* Collect ram dumps for all subsystems in order here */
-	for (i = 0; i < restart_list_count; i++) {
-		if (!restart_list[i])
-			continue;
-
-		if (restart_list[i]->ramdump)
-			if (restart_list[i]->ramdump(enable_ramdumps,
-							subsys) < 0)
-				pr_warn("%s[%p]: Ramdump failed.\n",
-						restart_list[i]->name, current);
-	}
+	/* Collect ram dumps for all subsystems here */
+	subsystem_collect_ramdumps(restart_list, restart_list_count, subsys);
 
 	_send_notification_to_order(restart_list,
 			restart_list_count,
@@ -0,0 +1,518 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Loopback throughput and round trip latency of the transports to the
+ * modem.
+ *
+ * Each run sends "count" packets of "pkt_size" bytes, keeping up to
+ * "window" of them in flight, and waits for every one of them to come
+ * back. The parameters and the results of the last run of each transport
+ * live in debugfs, under xprt_loopback/:
+ *
+ *   echo 1 > /sys/kernel/debug/xprt_loopback/smd
+ *   cat /sys/kernel/debug/xprt_loopback/smd
+ *
+ * smd uses the LOOPBACK channel that the modem echoes once the
+ * SMSM_SMD_LOOPBACK apps state is set. ipc_router bounces the packets off
+ * a second local port, which measures the router and its packet handling
+ * rather than a link.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/skbuff.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
+
+#include <mach/msm_smd.h>
+#include <mach/msm_smsm.h>
+
+#ifdef CONFIG_MSM_IPC_ROUTER
+#include "ipc_router.h"
+#endif
+
+#define LB_TIMEOUT		(5 * HZ)
+#define LB_MAX_PKT_SIZE		(64 * 1024)
+
+struct lb_hdr {
+	uint32_t seq;
+	uint32_t len;
+	int64_t tx_ns;
+};
+
+struct lb_result {
+	int status;
+	unsigned int pkt_size;
+	unsigned int window;
+	unsigned int sent;
+	unsigned int received;
+	unsigned int errors;
+	s64 elapsed_us;
+	s64 rtt_min_us;
+	s64 rtt_max_us;
+	s64 rtt_sum_us;
+};
+
+struct lb_xprt {
+	const char *name;
+	int (*open)(struct lb_xprt *x);
+	void (*close)(struct lb_xprt *x);
+	/* -EAGAIN when it would block and wait is false */
+	int (*send)(struct lb_xprt *x, const void *buf, int len, bool wait);
+	int (*recv)(struct lb_xprt *x, void *buf, int len);
+	void *priv;
+	struct lb_result res;
+};
+
+static DEFINE_MUTEX(lb_lock);
+static u32 lb_pkt_size = 1024;
+static u32 lb_count = 1000;
+static u32 lb_window = 1;
+
+/* SMD */
+
+static smd_channel_t *lb_smd_ch;
+static DECLARE_WAIT_QUEUE_HEAD(lb_smd_wait);
+static bool lb_smd_opened;
+
+static void lb_smd_notify(void *priv, unsigned event)
+{
+	switch (event) {
+	case SMD_EVENT_OPEN:
+		lb_smd_opened = true;
+		break;
+	case SMD_EVENT_CLOSE:
+		lb_smd_opened = false;
+		break;
+	}
+	wake_up(&lb_smd_wait);
+}
+
+static int lb_smd_open(struct lb_xprt *x)
+{
+	int ret;
+
+	ret = smsm_change_state(SMSM_APPS_STATE, 0, SMSM_SMD_LOOPBACK);
+	if (ret)
+		return ret;
+
+	lb_smd_opened = false;
+	ret = smd_named_open_on_edge("LOOPBACK", SMD_APPS_MODEM, &lb_smd_ch,
+				     NULL, lb_smd_notify);
+	if (ret)
+		return ret;
+
+	if (!wait_event_timeout(lb_smd_wait, lb_smd_opened, LB_TIMEOUT)) {
+		smd_close(lb_smd_ch);
+		return -ETIMEDOUT;
+	}
+	return 0;
+}
+
+static void lb_smd_close(struct lb_xprt *x)
+{
+	smd_close(lb_smd_ch);
+	lb_smd_ch = NULL;
+}
+
+static int lb_smd_send(struct lb_xprt *x, const void *buf, int len, bool wait)
+{
+	if (smd_write_avail(lb_smd_ch) < len) {
+		if (!wait)
+			return -EAGAIN;
+		if (!wait_event_timeout(lb_smd_wait,
+					smd_write_avail(lb_smd_ch) >= len ||
+					!lb_smd_opened, LB_TIMEOUT))
+			return -ETIMEDOUT;
+		if (!lb_smd_opened)
+			return -ENETRESET;
+	}
+	return smd_write(lb_smd_ch, buf, len);
+}
+
+static int lb_smd_readable(void)
+{
+	int sz = smd_cur_packet_size(lb_smd_ch);
+
+	return sz > 0 && smd_read_avail(lb_smd_ch) >= sz;
+}
+
+static int lb_smd_recv(struct lb_xprt *x, void *buf, int len)
+{
+	int sz, ret;
+
+	if (!wait_event_timeout(lb_smd_wait,
+				lb_smd_readable() || !lb_smd_opened,
+				LB_TIMEOUT))
+		return -ETIMEDOUT;
+	if (!lb_smd_opened)
+		return -ENETRESET;
+
+	sz = smd_cur_packet_size(lb_smd_ch);
+	ret = smd_read(lb_smd_ch, buf, min(sz, len));
+	if (sz > len)
+		smd_read(lb_smd_ch, NULL, sz - len);
+	return ret < 0 ? ret : sz;
+}
+
+static struct lb_xprt lb_smd = {
+	.name	= "smd",
+	.open	= lb_smd_open,
+	.close	= lb_smd_close,
+	.send	= lb_smd_send,
+	.recv	= lb_smd_recv,
+};
+
+/* IPC Router */
+
+#ifdef CONFIG_MSM_IPC_ROUTER
+struct lb_ipc {
+	struct msm_ipc_port *port;
+	struct msm_ipc_port *echo_port;
+	struct task_struct *echo_task;
+};
+
+static void lb_ipc_release(struct sk_buff_head *data)
+{
+	skb_queue_purge(data);
+	kfree(data);
+}
+
+/*
+ * The echo side sends the fragments it received straight back: the
+ * headroom the router pulled on the way in is there for the header again.
+ */
+static int lb_ipc_echo(void *arg)
+{
+	struct lb_ipc *ipc = arg;
+	struct sk_buff_head *data;
+	struct msm_ipc_addr src;
+	int ret;
+
+	while (!kthread_should_stop()) {
+		ret = msm_ipc_router_recv_from(ipc->echo_port, &data, &src,
+					       HZ / 10);
+		if (ret <= 0 || !data)
+			continue;
+		if (msm_ipc_router_send_to(ipc->echo_port, data, &src) < 0)
+			lb_ipc_release(data);
+	}
+	return 0;
+}
+
+static int lb_ipc_open(struct lb_xprt *x)
+{
+	struct lb_ipc *ipc;
+	int ret = -ENOMEM;
+
+	ipc = kzalloc(sizeof(*ipc), GFP_KERNEL);
+	if (!ipc)
+		return -ENOMEM;
+
+	ipc->port = msm_ipc_router_create_port(NULL, NULL);
+	if (!ipc->port)
+		goto out_free;
+	ipc->echo_port = msm_ipc_router_create_port(NULL, NULL);
+	if (!ipc->echo_port)
+		goto out_port;
+
+	ipc->echo_task = kthread_run(lb_ipc_echo, ipc, "xprt_lb_echo");
+	if (IS_ERR(ipc->echo_task)) {
+		ret = PTR_ERR(ipc->echo_task);
+		goto out_echo_port;
+	}
+
+	x->priv = ipc;
+	return 0;
+
+out_echo_port:
+	msm_ipc_router_close_port(ipc->echo_port);
+out_port:
+	msm_ipc_router_close_port(ipc->port);
+out_free:
+	kfree(ipc);
+	return ret;
+}
+
+static void lb_ipc_close(struct lb_xprt *x)
+{
+	struct lb_ipc *ipc = x->priv;
+
+	kthread_stop(ipc->echo_task);
+	msm_ipc_router_close_port(ipc->echo_port);
+	msm_ipc_router_close_port(ipc->port);
+	kfree(ipc);
+	x->priv = NULL;
+}
+
+static int lb_ipc_send(struct lb_xprt *x, const void *buf, int len, bool wait)
+{
+	struct lb_ipc *ipc = x->priv;
+	struct msm_ipc_addr dest;
+	struct sk_buff_head *data;
+	struct sk_buff *skb;
+	int offset = 0, sz, ret;
+
+	data = kmalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+	skb_queue_head_init(data);
+
+	while (offset < len) {
+		sz = min_t(int, len - offset, IPC_ROUTER_MAX_FRAG_SZ);
+		skb = alloc_skb(sz + (offset ? 0 : IPC_ROUTER_HDR_SIZE),
+				GFP_KERNEL);
+		if (!skb) {
+			lb_ipc_release(data);
+			return -ENOMEM;
+		}
+		if (!offset)
+			skb_reserve(skb, IPC_ROUTER_HDR_SIZE);
+		memcpy(skb_put(skb, sz), buf + offset, sz);
+		skb_queue_tail(data, skb);
+		offset += sz;
+	}
+
+	dest.addrtype = MSM_IPC_ADDR_ID;
+	dest.addr.port_addr.node_id = IPC_ROUTER_NID_LOCAL;
+	dest.addr.port_addr.port_id = ipc->echo_port->this_port.port_id;
+	ret = msm_ipc_router_send_to(ipc->port, data, &dest);
+	if (ret < 0)
+		return ret;
+	return len;
+}
+
+static int lb_ipc_recv(struct lb_xprt *x, void *buf, int len)
+{
+	struct lb_ipc *ipc = x->priv;
+	struct sk_buff_head *data;
+	struct sk_buff *skb;
+	int ret, offset = 0;
+
+	ret = msm_ipc_router_recv_from(ipc->port, &data, NULL, LB_TIMEOUT);
+	if (ret <= 0 || !data)
+		return ret ? ret : -EIO;
+
+	skb_queue_walk(data, skb) {
+		int sz = min_t(int, skb->len, len - offset);
+
+		if (sz <= 0)
+			break;
+		memcpy(buf + offset, skb->data, sz);
+		offset += sz;
+	}
+	lb_ipc_release(data);
+	return ret;
+}
+
+static struct lb_xprt lb_ipc_router = {
+	.name	= "ipc_router",
+	.open	= lb_ipc_open,
+	.close	= lb_ipc_close,
+	.send	= lb_ipc_send,
+	.recv	= lb_ipc_recv,
+};
+#endif
+
+static struct lb_xprt *lb_xprts[] = {
+	&lb_smd,
+#ifdef CONFIG_MSM_IPC_ROUTER
+	&lb_ipc_router,
+#endif
+};
+
+/*
+ * Keep up to window packets in flight. The sender only blocks on a full
+ * transport when nothing is outstanding, so that a peer waiting for room
+ * in our receive direction is always drained.
+ */
+static int lb_run(struct lb_xprt *x, unsigned int pkt_size,
+		  unsigned int count, unsigned int window)
+{
+	struct lb_result *res = &x->res;
+	struct lb_hdr *tx_hdr, *rx_hdr;
+	void *tx_buf, *rx_buf;
+	ktime_t start;
+	int ret;
+
+	memset(res, 0, sizeof(*res));
+	res->pkt_size = pkt_size;
+	res->window = window;
+	res->rtt_min_us = LLONG_MAX;
+
+	tx_buf = kmalloc(pkt_size, GFP_KERNEL);
+	rx_buf = kmalloc(pkt_size, GFP_KERNEL);
+	if (!tx_buf || !rx_buf) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	memset(tx_buf, 0x5a, pkt_size);
+	tx_hdr = tx_buf;
+	rx_hdr = rx_buf;
+	tx_hdr->len = pkt_size;
+
+	ret = x->open(x);
+	if (ret)
+		goto out_free;
+
+	start = ktime_get();
+	while (res->received < count) {
+		s64 rtt;
+
+		if (res->sent < count && res->sent - res->received < window) {
+			tx_hdr->seq = res->sent;
+			tx_hdr->tx_ns = ktime_to_ns(ktime_get());
+			ret = x->send(x, tx_buf, pkt_size,
+				      res->sent == res->received);
+			if (ret >= 0) {
+				res->sent++;
+				continue;
+			}
+			if (ret != -EAGAIN)
+				break;
+		}
+
+		ret = x->recv(x, rx_buf, pkt_size);
+		if (ret < 0)
+			break;
+		rtt = ktime_us_delta(ktime_get(), ns_to_ktime(rx_hdr->tx_ns));
+		if (ret != pkt_size || rx_hdr->len != pkt_size ||
+		    rx_hdr->seq != res->received)
+			res->errors++;
+		res->received++;
+		res->rtt_sum_us += rtt;
+		res->rtt_min_us = min(res->rtt_min_us, rtt);
+		res->rtt_max_us = max(res->rtt_max_us, rtt);
+		ret = 0;
+	}
+	res->elapsed_us = ktime_us_delta(ktime_get(), start);
+
+	x->close(x);
+
+out_free:
+	kfree(rx_buf);
+	kfree(tx_buf);
+	if (!res->received)
+		res->rtt_min_us = 0;
+	res->status = ret < 0 ? ret : 0;
+	return res->status;
+}
+
+static int lb_result_show(struct lb_xprt *x, char *buf, int max)
+{
+	struct lb_result *res = &x->res;
+	u64 kbps = 0;
+	s64 avg = 0;
+
+	if (res->elapsed_us)
+		kbps = div64_u64((u64)res->received * res->pkt_size * 2 *
+				 USEC_PER_SEC, res->elapsed_us * 1024);
+	if (res->received)
+		avg = div64_s64(res->rtt_sum_us, res->received);
+
+	return scnprintf(buf, max,
+		"status: %d\n"
+		"pkt_size: %u\n"
+		"window: %u\n"
+		"sent: %u\n"
+		"received: %u\n"
+		"errors: %u\n"
+		"elapsed: %lld us\n"
+		"throughput: %llu KB/s\n"
+		"rtt min/avg/max: %lld/%lld/%lld us\n",
+		res->status, res->pkt_size, res->window, res->sent,
+		res->received, res->errors, res->elapsed_us, kbps,
+		res->rtt_min_us, avg, res->rtt_max_us);
+}
+
+static ssize_t lb_read(struct file *file, char __user *ubuf,
+		       size_t count, loff_t *ppos)
+{
+	struct lb_xprt *x = file->private_data;
+	char buf[256];
+	int len;
+
+	mutex_lock(&lb_lock);
+	len = lb_result_show(x, buf, sizeof(buf));
+	mutex_unlock(&lb_lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static ssize_t lb_write(struct file *file, const char __user *ubuf,
+			size_t count, loff_t *ppos)
+{
+	struct lb_xprt *x = file->private_data;
+	unsigned int pkt_size;
+	int ret;
+
+	pkt_size = ALIGN(clamp_t(u32, lb_pkt_size, sizeof(struct lb_hdr),
+				 LB_MAX_PKT_SIZE), 4);
+	if (!lb_count || !lb_window)
+		return -EINVAL;
+
+	mutex_lock(&lb_lock);
+	ret = lb_run(x, pkt_size, lb_count, lb_window);
+	mutex_unlock(&lb_lock);
+
+	pr_info("%s: %s: %d\n", __func__, x->name, ret);
+	return ret ? ret : count;
+}
+
+static int lb_open(struct inode *inode, struct file *file)
+{
+	file->private_data = inode->i_private;
+	return 0;
+}
+
+static const struct file_operations lb_fops = {
+	.open = lb_open,
+	.read = lb_read,
+	.write = lb_write,
+};
+
+static struct dentry *lb_dent;
+
+static int __init xprt_loopback_test_init(void)
+{
+	int i;
+
+	lb_dent = debugfs_create_dir("xprt_loopback", NULL);
+	if (IS_ERR_OR_NULL(lb_dent))
+		return lb_dent ? PTR_ERR(lb_dent) : -ENOMEM;
+
+	debugfs_create_u32("pkt_size", 0644, lb_dent, &lb_pkt_size);
+	debugfs_create_u32("count", 0644, lb_dent, &lb_count);
+	debugfs_create_u32("window", 0644, lb_dent, &lb_window);
+	for (i = 0; i < ARRAY_SIZE(lb_xprts); i++)
+		debugfs_create_file(lb_xprts[i]->name, 0644, lb_dent,
+				    lb_xprts[i], &lb_fops);
+	return 0;
+}
+
+static void __exit xprt_loopback_test_exit(void)
+{
+	debugfs_remove_recursive(lb_dent);
+}
+
+module_init(xprt_loopback_test_init);
+module_exit(xprt_loopback_test_exit);
+
+MODULE_DESCRIPTION("MSM transport loopback test");
+MODULE_LICENSE("GPL v2");
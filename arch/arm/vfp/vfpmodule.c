@@ -62,6 +62,9 @@ static void vfp_thread_flush(struct thread_info *thread)
 
 	vfp->hard.fpexc = FPEXC_EN;
 	vfp->hard.fpscr = FPSCR_ROUND_NEAREST;
+#ifdef CONFIG_SMP
+	vfp->hard.cpu = NR_CPUS;
+#endif
 
 	/*
 	 * Disable VFP to ensure we initialize it first.  We must ensure
@@ -92,6 +95,13 @@ static void vfp_thread_copy(struct thread_info *thread)
 
 	vfp_sync_hwstate(parent);
 	thread->vfpstate = parent->vfpstate;
+#ifdef CONFIG_SMP
+	/*
+	 * Another CPU may still have a stale pointer to a dead thread
+	 * using the same vfpstate: never let the child match it.
+	 */
+	thread->vfpstate.hard.cpu = NR_CPUS;
+#endif
 }
 
 /*
@@ -144,9 +154,13 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		/*
 		 * Thread migration, just force the reloading of the
 		 * state on the new CPU in case the VFP registers
-		 * contain stale data.
+		 * contain stale data. Only the incoming thread can be
+		 * affected: the hardware context of another owner is
+		 * kept, so that it can come back to this CPU without a
+		 * reload if nobody used the VFP here meanwhile.
 		 */
-		if (thread->vfpstate.hard.cpu != cpu)
+		if (vfp_current_hw_state[cpu] == &thread->vfpstate &&
+		    thread->vfpstate.hard.cpu != cpu)
 			vfp_current_hw_state[cpu] = NULL;
 #endif
 
@@ -225,16 +225,39 @@ no_merge:
 	return 0;
 }
 
+/*
+ * Flash devices that set QUEUE_FLAG_WRITE_ALIGN want write requests to end
+ * on an io_min boundary. A long sequential write is then cut into requests
+ * that all start aligned, instead of leaving every seam in the middle of a
+ * flash page where the FTL would have to read-modify-write it.
+ */
+static unsigned int blk_write_max_sectors(struct request_queue *q,
+					  struct request *req, sector_t pos,
+					  unsigned int max_sectors)
+{
+	unsigned int align = queue_io_min(q) >> 9;
+	sector_t end = pos + max_sectors;
+
+	if (!blk_queue_write_align(q) || rq_data_dir(req) != WRITE ||
+	    req->cmd_type != REQ_TYPE_FS || align <= 1 || max_sectors <= align)
+		return max_sectors;
+
+	return max_sectors - sector_div(end, align);
+}
+
 int ll_back_merge_fn(struct request_queue *q, struct request *req,
 		     struct bio *bio)
 {
-	unsigned short max_sectors;
+	unsigned int max_sectors;
 
 	if (unlikely(req->cmd_type == REQ_TYPE_BLOCK_PC))
 		max_sectors = queue_max_hw_sectors(q);
 	else
 		max_sectors = queue_max_sectors(q);
 
+	max_sectors = blk_write_max_sectors(q, req, blk_rq_pos(req),
+					    max_sectors);
+
 	if (blk_rq_sectors(req) + bio_sectors(bio) > max_sectors) {
 		req->cmd_flags |= REQ_NOMERGE;
 		if (req == q->last_merge)
@@ -252,13 +275,16 @@ int ll_back_merge_fn(struct request_queue *q, struct request *req,
 int ll_front_merge_fn(struct request_queue *q, struct request *req,
 		      struct bio *bio)
 {
-	unsigned short max_sectors;
+	unsigned int max_sectors;
 
 	if (unlikely(req->cmd_type == REQ_TYPE_BLOCK_PC))
 		max_sectors = queue_max_hw_sectors(q);
 	else
 		max_sectors = queue_max_sectors(q);
 
+	max_sectors = blk_write_max_sectors(q, req, bio->bi_sector,
+					    max_sectors);
+
 
 	if (blk_rq_sectors(req) + bio_sectors(bio) > max_sectors) {
 		req->cmd_flags |= REQ_NOMERGE;
@@ -291,7 +317,9 @@ static int ll_merge_requests_fn(struct request_queue *q, struct request *req,
 	/*
 	 * Will it become too large?
 	 */
-	if ((blk_rq_sectors(req) + blk_rq_sectors(next)) > queue_max_sectors(q))
+	if ((blk_rq_sectors(req) + blk_rq_sectors(next)) >
+	    blk_write_max_sectors(q, req, blk_rq_pos(req),
+				  queue_max_sectors(q)))
 		return 0;
 
 	total_phys_segments = req->nr_phys_segments + next->nr_phys_segments;
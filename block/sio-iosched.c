@@ -12,6 +12,11 @@
  * Asynchronous and synchronous requests are not treated separately, but
  * we relay on deadlines to ensure fairness.
  *
+ * Reads and synchronous writes from user tasks outside the background
+ * cgroup are tagged as foreground and kept on their own fifo lists. They
+ * are dispatched ahead of everything else, but only bg_starved of them in
+ * a row, so background writeback keeps making progress.
+ *
  */
 #include <linux/blkdev.h>
 #include <linux/elevator.h>
@@ -19,8 +24,16 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/version.h>
+#include <linux/sched.h>
+#include <linux/cgroup.h>
+
+enum { ASYNC, SYNC, FG };
+
+/* Fifo list a request was queued on */
+#define RQ_SIO_CLASS(rq)	((long)(rq)->elevator_private[0])
 
-enum { ASYNC, SYNC };
+/* cpu cgroup the framework moves background processes into */
+#define SIO_BG_CGROUP	"bg_non_interactive"
 
 /* Tunables */
 static const int sync_read_expire  = HZ / 2;	/* max time before a sync read is submitted. */
@@ -29,25 +42,70 @@ static const int sync_write_expire = 2 * HZ;	/* max time before a sync write is
 static const int async_read_expire  =  4 * HZ;	/* ditto for async, these limits are SOFT! */
 static const int async_write_expire = 16 * HZ;	/* ditto for async, these limits are SOFT! */
 
+static const int fg_read_expire  = HZ / 4;	/* ditto for foreground requests. */
+static const int fg_write_expire = HZ;		/* ditto for foreground requests. */
+
 static const int writes_starved = 2;		/* max times reads can starve a write */
 static const int fifo_batch     = 8;		/* # of sequential requests treated as one
 						   by the above parameters. For throughput. */
 
+static const int fg_priority = 1;		/* dispatch foreground requests first */
+static const int bg_starved  = 4;		/* max times foreground can starve background */
+
 /* Elevator data */
 struct sio_data {
 	/* Request queues */
-	struct list_head fifo_list[2][2];
+	struct list_head fifo_list[3][2];
 
 	/* Attributes */
 	unsigned int batched;
 	unsigned int starved;
+	unsigned int fg_dispatched;
 
 	/* Settings */
-	int fifo_expire[2][2];
+	int fifo_expire[3][2];
 	int fifo_batch;
 	int writes_starved;
+	int fg_priority;
+	int bg_starved;
 };
 
+static int
+sio_current_is_fg(void)
+{
+#ifdef CONFIG_CGROUP_SCHED
+	struct cgroup *cgrp;
+	int fg;
+#endif
+
+	/* Writeback from the flusher threads is always background */
+	if (current->flags & PF_KTHREAD)
+		return 0;
+
+#ifdef CONFIG_CGROUP_SCHED
+	rcu_read_lock();
+	cgrp = task_cgroup(current, cpu_cgroup_subsys_id);
+	fg = !cgrp->dentry || strcmp(cgrp->dentry->d_name.name, SIO_BG_CGROUP);
+	rcu_read_unlock();
+
+	return fg;
+#else
+	return task_nice(current) <= 0;
+#endif
+}
+
+static int
+sio_request_class(struct sio_data *sd, struct request *rq)
+{
+	const int sync = rq_is_sync(rq);
+
+	if (sd->fg_priority && (sync || rq_data_dir(rq) == READ) &&
+	    sio_current_is_fg())
+		return FG;
+
+	return sync;
+}
+
 static void
 sio_merged_requests(struct request_queue *q, struct request *rq,
 		    struct request *next)
@@ -60,6 +118,7 @@ sio_merged_requests(struct request_queue *q, struct request *rq,
 		if (time_before(rq_fifo_time(next), rq_fifo_time(rq))) {
 			list_move(&rq->queuelist, &next->queuelist);
 			rq_set_fifo_time(rq, rq_fifo_time(next));
+			rq->elevator_private[0] = next->elevator_private[0];
 		}
 	}
 
@@ -71,15 +130,16 @@ static void
 sio_add_request(struct request_queue *q, struct request *rq)
 {
 	struct sio_data *sd = q->elevator->elevator_data;
-	const int sync = rq_is_sync(rq);
+	const int class = sio_request_class(sd, rq);
 	const int data_dir = rq_data_dir(rq);
 
 	/*
 	 * Add request to the proper fifo list and set its
 	 * expire time.
 	 */
-	rq_set_fifo_time(rq, jiffies + sd->fifo_expire[sync][data_dir]);
-	list_add_tail(&rq->queuelist, &sd->fifo_list[sync][data_dir]);
+	rq->elevator_private[0] = (void *)(long)class;
+	rq_set_fifo_time(rq, jiffies + sd->fifo_expire[class][data_dir]);
+	list_add_tail(&rq->queuelist, &sd->fifo_list[class][data_dir]);
 }
 
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,38)
@@ -90,7 +150,8 @@ sio_queue_empty(struct request_queue *q)
 
 	/* Check if fifo lists are empty */
 	return list_empty(&sd->fifo_list[SYNC][READ]) && list_empty(&sd->fifo_list[SYNC][WRITE]) &&
-	       list_empty(&sd->fifo_list[ASYNC][READ]) && list_empty(&sd->fifo_list[ASYNC][WRITE]);
+	       list_empty(&sd->fifo_list[ASYNC][READ]) && list_empty(&sd->fifo_list[ASYNC][WRITE]) &&
+	       list_empty(&sd->fifo_list[FG][READ]) && list_empty(&sd->fifo_list[FG][WRITE]);
 }
 #endif
 
@@ -137,6 +198,27 @@ sio_choose_expired_request(struct sio_data *sd)
 	if (rq)
 		return rq;
 
+	rq = sio_expired_request(sd, FG, WRITE);
+	if (rq)
+		return rq;
+	rq = sio_expired_request(sd, FG, READ);
+	if (rq)
+		return rq;
+
+	return NULL;
+}
+
+static struct request *
+sio_choose_fg_request(struct sio_data *sd)
+{
+	struct list_head *fg = sd->fifo_list[FG];
+
+	/* Foreground reads are what the user is waiting on */
+	if (!list_empty(&fg[READ]))
+		return rq_entry_fifo(fg[READ].next);
+	if (!list_empty(&fg[WRITE]))
+		return rq_entry_fifo(fg[WRITE].next);
+
 	return NULL;
 }
 
@@ -176,6 +258,11 @@ sio_dispatch_request(struct sio_data *sd, struct request *rq)
 
 	sd->batched++;
 
+	if (RQ_SIO_CLASS(rq) == FG)
+		sd->fg_dispatched++;
+	else
+		sd->fg_dispatched = 0;
+
 	if (rq_data_dir(rq))
 		sd->starved = 0;
 	else
@@ -198,12 +285,18 @@ sio_dispatch_requests(struct request_queue *q, int force)
 		rq = sio_choose_expired_request(sd);
 	}
 
+	/* Foreground requests go first, within the starvation bound */
+	if (!rq && sd->fg_dispatched < sd->bg_starved)
+		rq = sio_choose_fg_request(sd);
+
 	/* Retrieve request */
 	if (!rq) {
 		if (sd->starved > sd->writes_starved)
 			data_dir = WRITE;
 
 		rq = sio_choose_request(sd, data_dir);
+		if (!rq)
+			rq = sio_choose_fg_request(sd);
 		if (!rq)
 			return 0;
 	}
@@ -218,10 +311,10 @@ static struct request *
 sio_former_request(struct request_queue *q, struct request *rq)
 {
 	struct sio_data *sd = q->elevator->elevator_data;
-	const int sync = rq_is_sync(rq);
+	const int class = RQ_SIO_CLASS(rq);
 	const int data_dir = rq_data_dir(rq);
 
-	if (rq->queuelist.prev == &sd->fifo_list[sync][data_dir])
+	if (rq->queuelist.prev == &sd->fifo_list[class][data_dir])
 		return NULL;
 
 	/* Return former request */
@@ -232,10 +325,10 @@ static struct request *
 sio_latter_request(struct request_queue *q, struct request *rq)
 {
 	struct sio_data *sd = q->elevator->elevator_data;
-	const int sync = rq_is_sync(rq);
+	const int class = RQ_SIO_CLASS(rq);
 	const int data_dir = rq_data_dir(rq);
 
-	if (rq->queuelist.next == &sd->fifo_list[sync][data_dir])
+	if (rq->queuelist.next == &sd->fifo_list[class][data_dir])
 		return NULL;
 
 	/* Return latter request */
@@ -257,14 +350,23 @@ sio_init_queue(struct request_queue *q)
 	INIT_LIST_HEAD(&sd->fifo_list[SYNC][WRITE]);
 	INIT_LIST_HEAD(&sd->fifo_list[ASYNC][READ]);
 	INIT_LIST_HEAD(&sd->fifo_list[ASYNC][WRITE]);
+	INIT_LIST_HEAD(&sd->fifo_list[FG][READ]);
+	INIT_LIST_HEAD(&sd->fifo_list[FG][WRITE]);
 
 	/* Initialize data */
 	sd->batched = 0;
+	sd->starved = 0;
+	sd->fg_dispatched = 0;
 	sd->fifo_expire[SYNC][READ] = sync_read_expire;
 	sd->fifo_expire[SYNC][WRITE] = sync_write_expire;
 	sd->fifo_expire[ASYNC][READ] = async_read_expire;
 	sd->fifo_expire[ASYNC][WRITE] = async_write_expire;
+	sd->fifo_expire[FG][READ] = fg_read_expire;
+	sd->fifo_expire[FG][WRITE] = fg_write_expire;
 	sd->fifo_batch = fifo_batch;
+	sd->writes_starved = writes_starved;
+	sd->fg_priority = fg_priority;
+	sd->bg_starved = bg_starved;
 
 	return sd;
 }
@@ -278,6 +380,8 @@ sio_exit_queue(struct elevator_queue *e)
 	BUG_ON(!list_empty(&sd->fifo_list[SYNC][WRITE]));
 	BUG_ON(!list_empty(&sd->fifo_list[ASYNC][READ]));
 	BUG_ON(!list_empty(&sd->fifo_list[ASYNC][WRITE]));
+	BUG_ON(!list_empty(&sd->fifo_list[FG][READ]));
+	BUG_ON(!list_empty(&sd->fifo_list[FG][WRITE]));
 
 	/* Free structure */
 	kfree(sd);
@@ -317,6 +421,10 @@ SHOW_FUNCTION(sio_async_read_expire_show, sd->fifo_expire[ASYNC][READ], 1);
 SHOW_FUNCTION(sio_async_write_expire_show, sd->fifo_expire[ASYNC][WRITE], 1);
 SHOW_FUNCTION(sio_fifo_batch_show, sd->fifo_batch, 0);
 SHOW_FUNCTION(sio_writes_starved_show, sd->writes_starved, 0);
+SHOW_FUNCTION(sio_fg_read_expire_show, sd->fifo_expire[FG][READ], 1);
+SHOW_FUNCTION(sio_fg_write_expire_show, sd->fifo_expire[FG][WRITE], 1);
+SHOW_FUNCTION(sio_fg_priority_show, sd->fg_priority, 0);
+SHOW_FUNCTION(sio_bg_starved_show, sd->bg_starved, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -341,6 +449,10 @@ STORE_FUNCTION(sio_async_read_expire_store, &sd->fifo_expire[ASYNC][READ], 0, IN
 STORE_FUNCTION(sio_async_write_expire_store, &sd->fifo_expire[ASYNC][WRITE], 0, INT_MAX, 1);
 STORE_FUNCTION(sio_fifo_batch_store, &sd->fifo_batch, 0, INT_MAX, 0);
 STORE_FUNCTION(sio_writes_starved_store, &sd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(sio_fg_read_expire_store, &sd->fifo_expire[FG][READ], 0, INT_MAX, 1);
+STORE_FUNCTION(sio_fg_write_expire_store, &sd->fifo_expire[FG][WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(sio_fg_priority_store, &sd->fg_priority, 0, 1, 0);
+STORE_FUNCTION(sio_bg_starved_store, &sd->bg_starved, 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
 #define DD_ATTR(name) \
@@ -354,6 +466,10 @@ static struct elv_fs_entry sio_attrs[] = {
 	DD_ATTR(async_write_expire),
 	DD_ATTR(fifo_batch),
 	DD_ATTR(writes_starved),
+	DD_ATTR(fg_read_expire),
+	DD_ATTR(fg_write_expire),
+	DD_ATTR(fg_priority),
+	DD_ATTR(bg_starved),
 	__ATTR_NULL
 };
 
@@ -29,6 +29,9 @@
 
 static DEFINE_MUTEX(mem_sysfs_mutex);
 
+/* How long offlining from sysfs keeps retrying to migrate busy pages */
+#define MEM_OFFLINE_TIMEOUT	(120 * HZ)
+
 #define MEMORY_CLASS_NAME	"memory"
 
 static int sections_per_block;
@@ -231,7 +234,8 @@ int memory_isolate_notify(unsigned long val, void *v)
  * OK to have direct references to sparsemem variables in here.
  */
 static int
-memory_block_action(unsigned long phys_index, unsigned long action)
+memory_block_action(unsigned long phys_index, unsigned long action,
+		    unsigned long timeout)
 {
 	int i;
 	unsigned long start_pfn, start_paddr;
@@ -265,8 +269,8 @@ memory_block_action(unsigned long phys_index, unsigned long action)
 			break;
 		case MEM_OFFLINE:
 			start_paddr = page_to_pfn(first_page) << PAGE_SHIFT;
-			ret = remove_memory(start_paddr,
-					    nr_pages << PAGE_SHIFT);
+			ret = remove_memory_timeout(start_paddr,
+					    nr_pages << PAGE_SHIFT, timeout);
 			break;
 		default:
 			WARN(1, KERN_WARNING "%s(%ld, %ld) unknown action: "
@@ -278,7 +282,8 @@ memory_block_action(unsigned long phys_index, unsigned long action)
 }
 
 static int memory_block_change_state(struct memory_block *mem,
-		unsigned long to_state, unsigned long from_state_req)
+		unsigned long to_state, unsigned long from_state_req,
+		unsigned long timeout)
 {
 	int ret = 0;
 
@@ -292,7 +297,7 @@ static int memory_block_change_state(struct memory_block *mem,
 	if (to_state == MEM_OFFLINE)
 		mem->state = MEM_GOING_OFFLINE;
 
-	ret = memory_block_action(mem->start_section_nr, to_state);
+	ret = memory_block_action(mem->start_section_nr, to_state, timeout);
 
 	if (ret)
 		mem->state = from_state_req;
@@ -314,15 +319,46 @@ store_mem_state(struct sys_device *dev,
 	mem = container_of(dev, struct memory_block, sysdev);
 
 	if (!strncmp(buf, "online", min((int)count, 6)))
-		ret = memory_block_change_state(mem, MEM_ONLINE, MEM_OFFLINE);
+		ret = memory_block_change_state(mem, MEM_ONLINE, MEM_OFFLINE,
+						MEM_OFFLINE_TIMEOUT);
 	else if(!strncmp(buf, "offline", min((int)count, 7)))
-		ret = memory_block_change_state(mem, MEM_OFFLINE, MEM_ONLINE);
+		ret = memory_block_change_state(mem, MEM_OFFLINE, MEM_ONLINE,
+						MEM_OFFLINE_TIMEOUT);
 
 	if (ret)
 		return ret;
 	return count;
 }
 
+/*
+ * Does what writing to the state file of the memory block holding @pfn
+ * does, for in-kernel users. A block already in @to_state is left alone.
+ * Offlining gives up after @timeout jiffies if pages can't be migrated.
+ */
+int memory_block_set_state(unsigned long pfn, unsigned long to_state,
+			   unsigned long timeout)
+{
+	struct memory_block *mem;
+	unsigned long from_state;
+	int ret = 0;
+
+	if (!present_section_nr(pfn_to_section_nr(pfn)))
+		return -EINVAL;
+
+	mem = find_memory_block(__pfn_to_section(pfn));
+	if (!mem)
+		return -EINVAL;
+
+	from_state = to_state == MEM_ONLINE ? MEM_OFFLINE : MEM_ONLINE;
+	if (mem->state != to_state)
+		ret = memory_block_change_state(mem, to_state, from_state,
+						timeout);
+
+	kobject_put(&mem->sysdev.kobj);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(memory_block_set_state);
+
 /*
  * phys_device is a bad name for this.  What I really want
  * is a way to differentiate between memory ranges that
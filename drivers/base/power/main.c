@@ -512,12 +512,14 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
 	int error = 0;
+	ktime_t starttime;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
 	device_lock(dev);
+	starttime = ktime_get();
 
 	/*
 	 * This is a fib.  But we'll allow new children to be added below
@@ -564,6 +566,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = false;
+	suspend_time_device_resumed(dev, starttime);
 
  Unlock:
 	device_unlock(dev);
@@ -18,6 +18,7 @@
 #include <linux/mempool.h>
 #include <linux/mutex.h>
 #include <linux/workqueue.h>
+#include <linux/kfifo.h>
 #include <linux/diagchar.h>
 #include <mach/msm_smd.h>
 #include <asm/atomic.h>
@@ -34,6 +35,8 @@
 #define USB_MAX_OUT_BUF	MAX_OUT_BUF
 #define IN_BUF_SIZE		16384
 #define MAX_IN_BUF_SIZE	32768
+/* Size of the per peripheral ring used in memory device mode */
+#define DIAG_MD_RING_SIZE	65536
 #define MAX_SYNC_OBJ_NAME_SIZE	32
 #define UINT32_MAX     UINT_MAX
 /* Size of the buffer used for deframing a packet
@@ -192,6 +195,14 @@ struct diagchar_dev {
 	int in_busy_qdsp_1;
 	int in_busy_qdsp_2;
 	int in_busy_wcnss;
+	/*
+	 * Memory device mode staging rings, one per SMD peripheral.  The
+	 * peripheral's read work is the only producer and diagchar_read()
+	 * the only consumer, so neither side takes a lock.
+	 */
+	struct kfifo md_ring_modem;
+	struct kfifo md_ring_qdsp;
+	struct kfifo md_ring_wcnss;
 	int read_len_legacy;
 	unsigned char *hdlc_buf;
 	unsigned hdlc_count;
@@ -301,6 +301,13 @@ void diag_switch_logging_mode(unsigned long logging_mode)
 		driver->mask_check = 0;
 		driver->logging_mode = MEMORY_DEVICE_MODE;
 	}
+	if (temp != MEMORY_DEVICE_MODE &&
+	    driver->logging_mode == MEMORY_DEVICE_MODE) {
+		/* drop packets left over from a previous session */
+		kfifo_reset_out(&driver->md_ring_modem);
+		kfifo_reset_out(&driver->md_ring_qdsp);
+		kfifo_reset_out(&driver->md_ring_wcnss);
+	}
 	driver->logging_process_id = current->tgid;
 	mutex_unlock(&driver->diagchar_mutex);
 	if (temp == MEMORY_DEVICE_MODE && driver->logging_mode
@@ -552,6 +559,52 @@ long diagchar_ioctl(struct file *filp,
 	return success;
 }
 
+/*
+ * Copy the complete packets staged in a memory device ring to user space
+ * as length/data pairs.  Stops early if the user buffer is full; whatever
+ * is left is picked up by the next read.  Returns the number of packets
+ * copied, updating *ret as COPY_USER_SPACE_OR_EXIT does.
+ */
+static int diag_copy_md_ring(struct kfifo *ring, char __user *buf,
+			     size_t count, int *ret)
+{
+	unsigned int copied;
+	int len, num_data = 0;
+
+	if (!kfifo_initialized(ring))
+		return 0;
+
+	while (kfifo_out_peek(ring, &len, sizeof(len)) == sizeof(len)) {
+		if (kfifo_len(ring) < sizeof(len) + len)
+			break;
+		if (count < *ret + sizeof(len) + len)
+			break;
+		if (copy_to_user(buf + *ret, &len, sizeof(len)))
+			break;
+		if (kfifo_out(ring, &len, sizeof(len)) != sizeof(len))
+			break;
+		if (kfifo_to_user(ring, buf + *ret + sizeof(len), len,
+				  &copied) || copied != len) {
+			/* the ring is out of sync with the packet headers */
+			kfifo_reset_out(ring);
+			break;
+		}
+		*ret += sizeof(len) + len;
+		num_data++;
+	}
+	return num_data;
+}
+
+static int diag_md_ring_pending(void)
+{
+	return (kfifo_initialized(&driver->md_ring_modem) &&
+		!kfifo_is_empty(&driver->md_ring_modem)) ||
+	       (kfifo_initialized(&driver->md_ring_qdsp) &&
+		!kfifo_is_empty(&driver->md_ring_qdsp)) ||
+	       (kfifo_initialized(&driver->md_ring_wcnss) &&
+		!kfifo_is_empty(&driver->md_ring_wcnss));
+}
+
 static int diagchar_read(struct file *file, char __user *buf, size_t count,
 			  loff_t *ppos)
 {
@@ -617,6 +670,14 @@ drop:
 			}
 		}
 
+		/* copy data staged in the per peripheral rings first */
+		num_data += diag_copy_md_ring(&driver->md_ring_modem,
+					      buf, count, &ret);
+		num_data += diag_copy_md_ring(&driver->md_ring_qdsp,
+					      buf, count, &ret);
+		num_data += diag_copy_md_ring(&driver->md_ring_wcnss,
+					      buf, count, &ret);
+
 		/* copy modem data */
 		if (driver->in_busy_1 == 1) {
 			num_data++;
@@ -693,6 +754,8 @@ drop:
 		COPY_USER_SPACE_OR_EXIT(buf+4, num_data, 4);
 		ret -= 4;
 		driver->data_ready[index] ^= USER_SPACE_LOG_TYPE;
+		if (diag_md_ring_pending())
+			driver->data_ready[index] |= USER_SPACE_LOG_TYPE;
 		if (driver->ch)
 			queue_work(driver->diag_wq,
 					 &(driver->diag_read_smd_work));
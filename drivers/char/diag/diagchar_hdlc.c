@@ -18,6 +18,7 @@
 #include <linux/device.h>
 #include <linux/uaccess.h>
 #include <linux/crc-ccitt.h>
+#include <asm/unaligned.h>
 #include "diagchar_hdlc.h"
 
 
@@ -28,6 +29,33 @@ MODULE_LICENSE("GPL v2");
 #define CRC_16_L_STEP(xx_crc, xx_c) \
 	crc_ccitt_byte(xx_crc, xx_c)
 
+#define HDLC_ONES	0x01010101UL
+#define HDLC_HIGHS	0x80808080UL
+/* true if any byte of the word is zero */
+#define HDLC_HAS_ZERO(w)	(((w) - HDLC_ONES) & ~(w) & HDLC_HIGHS)
+
+/*
+ * Return the number of leading bytes in [src, src + len) that are neither
+ * CONTROL_CHAR nor ESC_CHAR, i.e. that pass through HDLC unchanged.
+ * Checks a word at a time so runs of ordinary data are found quickly.
+ */
+static unsigned int diag_hdlc_plain_len(const uint8_t *src, unsigned int len)
+{
+	unsigned int i = 0;
+	uint32_t w;
+
+	while (i + sizeof(w) <= len) {
+		w = get_unaligned((const uint32_t *)(src + i));
+		if (HDLC_HAS_ZERO(w ^ (ESC_CHAR * HDLC_ONES)) ||
+		    HDLC_HAS_ZERO(w ^ (CONTROL_CHAR * HDLC_ONES)))
+			break;
+		i += sizeof(w);
+	}
+	while (i < len && src[i] != ESC_CHAR && src[i] != CONTROL_CHAR)
+		i++;
+	return i;
+}
+
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc)
 {
@@ -39,6 +67,7 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	unsigned char src_byte = 0;
 	enum diag_send_state_enum_type state;
 	unsigned int used = 0;
+	unsigned int run;
 
 	if (src_desc && enc) {
 
@@ -64,6 +93,18 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 			   of 2 dest bytes for an escaped byte */
 			while (src <= src_last && dest <= dest_last) {
 
+				/* Copy a run that needs no escaping at once */
+				run = diag_hdlc_plain_len(src, min(
+					src_last - src, dest_last - dest) + 1);
+				if (run) {
+					memcpy(dest, src, run);
+					crc = crc_ccitt(crc, src, run);
+					src += run;
+					dest += run;
+					used += run;
+					continue;
+				}
+
 				src_byte = *src++;
 
 				if ((src_byte == CONTROL_CHAR) ||
@@ -167,7 +208,7 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 	unsigned int src_length = 0, dest_length = 0;
 
 	unsigned int len = 0;
-	unsigned int i;
+	unsigned int i, run;
 	uint8_t src_byte;
 
 	int pkt_bnd = 0;
@@ -186,6 +227,21 @@ int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 
 		for (i = 0; i < src_length; i++) {
 
+			/* Copy a run that holds no HDLC characters at once */
+			if (!hdlc->escaping) {
+				run = diag_hdlc_plain_len(&src_ptr[i], min(
+					src_length - i, dest_length - len));
+				if (run) {
+					memcpy(dest_ptr + len, src_ptr + i,
+					       run);
+					len += run;
+					i += run;
+					if (len >= dest_length ||
+					    i >= src_length)
+						break;
+				}
+			}
+
 			src_byte = src_ptr[i];
 
 			if (hdlc->escaping) {
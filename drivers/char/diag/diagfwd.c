@@ -235,11 +235,66 @@ void __diag_smd_send_req(void)
 	}
 }
 
+/*
+ * In memory device mode, stage a peripheral packet in that peripheral's
+ * ring so its SMD buffer can be handed back for the next read right
+ * away instead of waiting for the logging process.  Falls back to the
+ * old behaviour of holding the buffer when the ring is full.
+ */
+static void diag_md_ring_write(int proc_num, void *buf,
+			       struct diag_request *write_ptr)
+{
+	struct kfifo *ring;
+	struct work_struct *read_work;
+	int len = write_ptr->length;
+
+	if (proc_num == MODEM_DATA) {
+		ring = &driver->md_ring_modem;
+		read_work = &driver->diag_read_smd_work;
+	} else if (proc_num == QDSP_DATA) {
+		ring = &driver->md_ring_qdsp;
+		read_work = &driver->diag_read_smd_qdsp_work;
+	} else if (proc_num == WCNSS_DATA) {
+		ring = &driver->md_ring_wcnss;
+		read_work = &driver->diag_read_smd_wcnss_work;
+	} else
+		return;
+
+	if (!kfifo_initialized(ring) ||
+	    kfifo_avail(ring) < sizeof(len) + len)
+		return;
+
+	kfifo_in(ring, &len, sizeof(len));
+	kfifo_in(ring, buf, len);
+
+	if (write_ptr == driver->write_ptr_1)
+		driver->in_busy_1 = 0;
+	else if (write_ptr == driver->write_ptr_2)
+		driver->in_busy_2 = 0;
+	else if (write_ptr == driver->write_ptr_qdsp_1)
+		driver->in_busy_qdsp_1 = 0;
+	else if (write_ptr == driver->write_ptr_qdsp_2)
+		driver->in_busy_qdsp_2 = 0;
+	else if (write_ptr == driver->write_ptr_wcnss)
+		driver->in_busy_wcnss = 0;
+	queue_work(driver->diag_wq, read_work);
+}
+
+static void diag_md_ring_init(struct kfifo *ring)
+{
+	if (kfifo_initialized(ring))
+		return;
+	if (kfifo_alloc(ring, DIAG_MD_RING_SIZE, GFP_KERNEL))
+		pr_err("diag: Could not allocate memory device ring\n");
+}
+
 int diag_device_write(void *buf, int proc_num, struct diag_request *write_ptr)
 {
 	int i, err = 0;
 
 	if (driver->logging_mode == MEMORY_DEVICE_MODE) {
+		if (write_ptr)
+			diag_md_ring_write(proc_num, buf, write_ptr);
 		if (proc_num == APPS_DATA) {
 			for (i = 0; i < driver->poolsize_write_struct; i++)
 				if (driver->buf_tbl[i].length == 0) {
@@ -1989,6 +2044,9 @@ void diagfwd_init(void)
 		if (driver->apps_rsp_buf == NULL)
 			goto err;
 	}
+	diag_md_ring_init(&driver->md_ring_modem);
+	diag_md_ring_init(&driver->md_ring_qdsp);
+	diag_md_ring_init(&driver->md_ring_wcnss);
 	driver->diag_wq = create_singlethread_workqueue("diag_wq");
 #if defined(CONFIG_DIAG_OVER_USB) || defined(CONFIG_DIAG_INTERNAL)
 	INIT_WORK(&(driver->diag_proc_hdlc_work), diag_process_hdlc_fn);
@@ -2041,6 +2099,9 @@ err:
 		kfree(driver->channel_read_ptr);
 		kfree(driver->apps_rsp_buf);
 		kfree(driver->user_space_data);
+		kfifo_free(&driver->md_ring_modem);
+		kfifo_free(&driver->md_ring_qdsp);
+		kfifo_free(&driver->md_ring_wcnss);
 		if (driver->diag_wq)
 			destroy_workqueue(driver->diag_wq);
 }
@@ -2094,4 +2155,7 @@ void diagfwd_exit(void)
 	kfree(driver->apps_rsp_buf);
 	kfree(driver->user_space_data);
 	destroy_workqueue(driver->diag_wq);
+	kfifo_free(&driver->md_ring_modem);
+	kfifo_free(&driver->md_ring_qdsp);
+	kfifo_free(&driver->md_ring_wcnss);
 }
@@ -19,6 +19,7 @@
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/cpufreq_interactive.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/tick.h>
@@ -29,6 +30,7 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/input.h>
+#include <linux/rq_stats.h>
 #include <asm/cputime.h>
 
 #define CREATE_TRACE_POINTS
@@ -51,6 +53,9 @@ struct cpufreq_interactive_cpuinfo {
 	unsigned int floor_freq;
 	u64 floor_validate_time;
 	u64 hispeed_validate_time;
+	unsigned int touch_boost_freq;
+	unsigned int touch_boost_target;
+	u64 touch_boost_until;
 	int governor_enabled;
 };
 
@@ -111,6 +116,41 @@ static struct cpufreq_interactive_inputopen inputopen;
 
 static int boost_val;
 
+/*
+ * How long in us a touch interrupt holds the CPUs at touch_boost_freq,
+ * zero disables touch boost. A CPU with no touch_boost_freq set uses
+ * hispeed_freq.
+ */
+static unsigned long touch_boost_duration;
+
+/*
+ * A wakeup moving a task whose tracked load is at or above this percentage
+ * to another CPU raises that CPU to hispeed_freq right away, instead of
+ * waiting a timer period for its idle time to show the load. Zero disables.
+ */
+#define DEFAULT_MIGRATION_BOOST_LOAD DEFAULT_GO_HISPEED_LOAD
+static unsigned long migration_boost_load;
+
+/*
+ * Run queue driven hotplug, sampled every rq_sample_ms. The thresholds
+ * are in tenths of a runnable task per CPU. Above rq_up_threshold enough
+ * CPUs come up at once to get back under it and all of them go to
+ * hispeed_freq. Below rq_down_threshold, counted against one CPU less,
+ * for rq_down_delay ms one CPU goes down. Off by default so it does not
+ * fight a userspace hotplug daemon.
+ */
+#define DEFAULT_RQ_SAMPLE_MS 50
+#define DEFAULT_RQ_UP_THRESHOLD 15
+#define DEFAULT_RQ_DOWN_THRESHOLD 10
+#define DEFAULT_RQ_DOWN_DELAY 500
+static unsigned int rq_hotplug;
+static unsigned long rq_sample_ms;
+static unsigned long rq_up_threshold;
+static unsigned long rq_down_threshold;
+static unsigned long rq_down_delay;
+static unsigned long rq_down_start;
+static struct delayed_work rq_hotplug_work;
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -220,6 +260,10 @@ static void cpufreq_interactive_timer(unsigned long data)
 		new_freq = pcpu->policy->max * cpu_load / 100;
 	}
 
+	if (new_freq < pcpu->touch_boost_target &&
+	    pcpu->timer_run_time < pcpu->touch_boost_until)
+		new_freq = pcpu->touch_boost_target;
+
 	if (new_freq <= hispeed_freq)
 		pcpu->hispeed_validate_time = pcpu->timer_run_time;
 
@@ -532,6 +576,154 @@ static void cpufreq_interactive_boost(void)
 		wake_up_process(up_task);
 }
 
+void cpufreq_interactive_touch_boost(void)
+{
+	int i;
+	int anyboost = 0;
+	unsigned long flags;
+	unsigned int freq;
+	u64 now;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	if (!touch_boost_duration || !atomic_read(&active_count))
+		return;
+
+	now = ktime_to_us(ktime_get());
+	spin_lock_irqsave(&up_cpumask_lock, flags);
+
+	for_each_online_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		if (!pcpu->governor_enabled)
+			continue;
+
+		freq = pcpu->touch_boost_freq ? : hispeed_freq;
+		if (freq > pcpu->policy->max)
+			freq = pcpu->policy->max;
+
+		pcpu->touch_boost_target = freq;
+		pcpu->touch_boost_until = now + touch_boost_duration;
+
+		if (pcpu->target_freq < freq) {
+			pcpu->target_freq = freq;
+			cpumask_set_cpu(i, &up_cpumask);
+			pcpu->target_set_time_in_idle =
+				get_cpu_idle_time_us(i, &pcpu->target_set_time);
+			pcpu->hispeed_validate_time = pcpu->target_set_time;
+			anyboost = 1;
+		}
+
+		if (pcpu->floor_freq < freq) {
+			pcpu->floor_freq = freq;
+			pcpu->floor_validate_time = now;
+		}
+	}
+
+	spin_unlock_irqrestore(&up_cpumask_lock, flags);
+
+	if (anyboost) {
+		trace_cpufreq_interactive_boost("touch");
+		wake_up_process(up_task);
+	}
+}
+EXPORT_SYMBOL(cpufreq_interactive_touch_boost);
+
+static int cpufreq_interactive_migration_notify(struct notifier_block *nb,
+						unsigned long val, void *data)
+{
+	struct migration_notify_data *mnd = data;
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, mnd->dest_cpu);
+	unsigned long flags;
+	int anyboost = 0;
+
+	if (!migration_boost_load || mnd->load < migration_boost_load)
+		return NOTIFY_OK;
+
+	smp_rmb();
+	if (!pcpu->governor_enabled)
+		return NOTIFY_OK;
+
+	spin_lock_irqsave(&up_cpumask_lock, flags);
+
+	if (pcpu->target_freq < hispeed_freq) {
+		pcpu->target_freq = hispeed_freq;
+		cpumask_set_cpu(mnd->dest_cpu, &up_cpumask);
+		pcpu->target_set_time_in_idle =
+			get_cpu_idle_time_us(mnd->dest_cpu,
+					     &pcpu->target_set_time);
+		pcpu->hispeed_validate_time = pcpu->target_set_time;
+		anyboost = 1;
+	}
+
+	if (pcpu->floor_freq < hispeed_freq) {
+		pcpu->floor_freq = hispeed_freq;
+		pcpu->floor_validate_time = ktime_to_us(ktime_get());
+	}
+
+	spin_unlock_irqrestore(&up_cpumask_lock, flags);
+
+	if (anyboost) {
+		trace_cpufreq_interactive_boost("migration");
+		wake_up_process(up_task);
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_interactive_migration_nb = {
+	.notifier_call = cpufreq_interactive_migration_notify,
+};
+
+static void cpufreq_interactive_rq_hotplug(struct work_struct *work)
+{
+	unsigned int avg;
+	unsigned int online;
+	unsigned int need;
+	unsigned int cpu;
+	unsigned int last = 0;
+
+	if (!rq_hotplug || !atomic_read(&active_count))
+		return;
+
+	if (rq_stats_get_ewma(&avg))
+		goto rearm;
+
+	online = num_online_cpus();
+	need = DIV_ROUND_UP(avg, rq_up_threshold);
+
+	if (need > online) {
+		rq_down_start = 0;
+		for_each_present_cpu(cpu) {
+			if (online >= need)
+				break;
+			if (cpu_online(cpu))
+				continue;
+			if (!cpu_up(cpu))
+				online++;
+		}
+		trace_cpufreq_interactive_boost("rq");
+		cpufreq_interactive_boost();
+	} else if (online > 1 && avg < rq_down_threshold * (online - 1)) {
+		if (!rq_down_start) {
+			rq_down_start = jiffies;
+		} else if (time_after_eq(jiffies, rq_down_start +
+				msecs_to_jiffies(rq_down_delay))) {
+			for_each_online_cpu(cpu)
+				last = cpu;
+			if (last)
+				cpu_down(last);
+			rq_down_start = 0;
+		}
+	} else {
+		rq_down_start = 0;
+	}
+
+rearm:
+	/* CPU 0 never goes offline, keep the work off the CPUs it removes */
+	schedule_delayed_work_on(0, &rq_hotplug_work,
+				 msecs_to_jiffies(rq_sample_ms));
+}
+
 /*
  * Pulsed boost on input event raises CPUs to hispeed_freq and lets
  * usual algorithm of min_sample_time  decide when to allow speed
@@ -755,6 +947,163 @@ static ssize_t store_input_boost(struct kobject *kobj, struct attribute *attr,
 
 define_one_global_rw(input_boost);
 
+static ssize_t show_touch_boost_freq(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	unsigned int i;
+	ssize_t ret = 0;
+
+	for_each_possible_cpu(i)
+		ret += sprintf(buf + ret, "%u ",
+			       per_cpu(cpuinfo, i).touch_boost_freq);
+
+	buf[ret - 1] = '\n';
+	return ret;
+}
+
+/*
+ * Either a single frequency for every CPU or one frequency per possible
+ * CPU, in CPU order.
+ */
+static ssize_t store_touch_boost_freq(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buf, size_t count)
+{
+	unsigned int freqs[NR_CPUS];
+	unsigned int i;
+	int ntokens = 0;
+	int n;
+	const char *cp = buf;
+
+	while (ntokens < nr_cpu_ids &&
+	       sscanf(cp, "%u%n", &freqs[ntokens], &n) == 1) {
+		ntokens++;
+		cp += n;
+	}
+
+	if (ntokens != 1 && ntokens != num_possible_cpus())
+		return -EINVAL;
+
+	n = 0;
+	for_each_possible_cpu(i)
+		per_cpu(cpuinfo, i).touch_boost_freq =
+			freqs[ntokens == 1 ? 0 : n++];
+
+	return count;
+}
+
+define_one_global_rw(touch_boost_freq);
+
+static ssize_t show_touch_boost_duration(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", touch_boost_duration);
+}
+
+static ssize_t store_touch_boost_duration(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	touch_boost_duration = val;
+	return count;
+}
+
+define_one_global_rw(touch_boost_duration);
+
+static ssize_t show_migration_boost_load(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", migration_boost_load);
+}
+
+static ssize_t store_migration_boost_load(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (val > 100)
+		return -EINVAL;
+	migration_boost_load = val;
+	return count;
+}
+
+define_one_global_rw(migration_boost_load);
+
+static ssize_t show_rq_hotplug(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	return sprintf(buf, "%u\n", rq_hotplug);
+}
+
+static ssize_t store_rq_hotplug(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+	unsigned int avg;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val && rq_stats_get_ewma(&avg))
+		return -ENODEV;
+
+	if (val && !rq_hotplug) {
+		rq_hotplug = 1;
+		rq_down_start = 0;
+		schedule_delayed_work_on(0, &rq_hotplug_work, 0);
+	} else if (!val) {
+		rq_hotplug = 0;
+	}
+	return count;
+}
+
+static struct global_attr rq_hotplug_attr = __ATTR(rq_hotplug, 0644,
+		show_rq_hotplug, store_rq_hotplug);
+
+#define show_store_rq_tunable(name, minval)				\
+static ssize_t show_##name(struct kobject *kobj,			\
+			   struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%lu\n", name);				\
+}									\
+									\
+static ssize_t store_##name(struct kobject *kobj,			\
+			    struct attribute *attr,			\
+			    const char *buf, size_t count)		\
+{									\
+	int ret;							\
+	unsigned long val;						\
+									\
+	ret = strict_strtoul(buf, 0, &val);				\
+	if (ret < 0)							\
+		return ret;						\
+	if (val < minval)						\
+		return -EINVAL;						\
+	name = val;							\
+	return count;							\
+}									\
+									\
+static struct global_attr name##_attr = __ATTR(name, 0644,		\
+		show_##name, store_##name)
+
+show_store_rq_tunable(rq_sample_ms, 10);
+show_store_rq_tunable(rq_up_threshold, 1);
+show_store_rq_tunable(rq_down_threshold, 0);
+show_store_rq_tunable(rq_down_delay, 0);
+
 static ssize_t show_boost(struct kobject *kobj, struct attribute *attr,
 			  char *buf)
 {
@@ -810,6 +1159,14 @@ static struct attribute *interactive_attributes[] = {
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
 	&input_boost.attr,
+	&touch_boost_freq.attr,
+	&touch_boost_duration.attr,
+	&migration_boost_load.attr,
+	&rq_hotplug_attr.attr,
+	&rq_sample_ms_attr.attr,
+	&rq_up_threshold_attr.attr,
+	&rq_down_threshold_attr.attr,
+	&rq_down_delay_attr.attr,
 	&boost.attr,
 	&boostpulse.attr,
 	NULL,
@@ -873,6 +1230,12 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pr_warn("%s: failed to register input handler\n",
 				__func__);
 
+		register_task_migration_notifier(
+			&cpufreq_interactive_migration_nb);
+
+		if (rq_hotplug)
+			schedule_delayed_work_on(0, &rq_hotplug_work, 0);
+
 		break;
 
 	case CPUFREQ_GOV_STOP:
@@ -896,6 +1259,8 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		if (atomic_dec_return(&active_count) > 0)
 			return 0;
 
+		unregister_task_migration_notifier(
+			&cpufreq_interactive_migration_nb);
 		input_unregister_handler(&cpufreq_interactive_input_handler);
 		sysfs_remove_group(cpufreq_global_kobject,
 				&interactive_attr_group);
@@ -944,6 +1309,11 @@ static int __init cpufreq_interactive_init(void)
 	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
 	above_hispeed_delay_val = DEFAULT_ABOVE_HISPEED_DELAY;
 	timer_rate = DEFAULT_TIMER_RATE;
+	rq_sample_ms = DEFAULT_RQ_SAMPLE_MS;
+	rq_up_threshold = DEFAULT_RQ_UP_THRESHOLD;
+	rq_down_threshold = DEFAULT_RQ_DOWN_THRESHOLD;
+	rq_down_delay = DEFAULT_RQ_DOWN_DELAY;
+	migration_boost_load = DEFAULT_MIGRATION_BOOST_LOAD;
 
 	/* Initalize per-cpu timers */
 	for_each_possible_cpu(i) {
@@ -977,6 +1347,8 @@ static int __init cpufreq_interactive_init(void)
 
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
 	INIT_WORK(&inputopen.inputopen_work, cpufreq_interactive_input_open);
+	INIT_DELAYED_WORK_DEFERRABLE(&rq_hotplug_work,
+				     cpufreq_interactive_rq_hotplug);
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
 err_freeuptask:
@@ -993,6 +1365,8 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	rq_hotplug = 0;
+	cancel_delayed_work_sync(&rq_hotplug_work);
 	kthread_stop(up_task);
 	put_task_struct(up_task);
 	destroy_workqueue(down_wq);
@@ -20,6 +20,9 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/ktime.h>
+#include <linux/hash.h>
+#include <linux/sched.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -41,6 +44,15 @@ struct cpufreq_stats {
 	unsigned int *freq_table;
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
+#endif
+	/* from PRECHANGE to POSTCHANGE, i.e. the driver switching clocks */
+	ktime_t trans_start;
+	unsigned int lat_count;
+	u64 lat_total_ns;
+	u64 lat_max_ns;
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	/* state index -> index in uid_freqs[] */
+	u8 *uid_index;
 #endif
 };
 
@@ -77,6 +89,26 @@ static ssize_t show_total_trans(struct cpufreq_policy *policy, char *buf)
 			per_cpu(cpufreq_stats_table, stat->cpu)->total_trans);
 }
 
+/* transitions timed, total and longest switch time in us */
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	unsigned int count;
+	u64 total, max;
+
+	if (!stat)
+		return 0;
+	spin_lock(&cpufreq_stats_lock);
+	count = stat->lat_count;
+	total = stat->lat_total_ns;
+	max = stat->lat_max_ns;
+	spin_unlock(&cpufreq_stats_lock);
+	do_div(total, NSEC_PER_USEC);
+	do_div(max, NSEC_PER_USEC);
+	return sprintf(buf, "%u %llu %llu\n", count,
+			(unsigned long long)total, (unsigned long long)max);
+}
+
 static ssize_t show_time_in_state(struct cpufreq_policy *policy, char *buf)
 {
 	ssize_t len = 0;
@@ -142,10 +174,12 @@ CPUFREQ_STATDEVICE_ATTR(trans_table, 0444, show_trans_table);
 
 CPUFREQ_STATDEVICE_ATTR(total_trans, 0444, show_total_trans);
 CPUFREQ_STATDEVICE_ATTR(time_in_state, 0444, show_time_in_state);
+CPUFREQ_STATDEVICE_ATTR(trans_latency, 0444, show_trans_latency);
 
 static struct attribute *default_attrs[] = {
 	&_attr_total_trans.attr,
 	&_attr_time_in_state.attr,
+	&_attr_trans_latency.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&_attr_trans_table.attr,
 #endif
@@ -165,6 +199,171 @@ static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 	return -1;
 }
 
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+/*
+ * Time spent by each uid at each frequency, fed from the tick accounting.
+ * Frequencies of all cpus share one index space so an entry fits any cpu.
+ * Entries are never freed, like the uids they count.
+ */
+#define UID_MAX_STATES		32
+#define UID_STATE_NONE		0xff
+#define UID_HASH_BITS		7
+
+struct uid_entry {
+	uid_t uid;
+	struct hlist_node hash;
+	cputime64_t time_in_state[UID_MAX_STATES];
+};
+
+/* layout of uid_time_in_state: a header, then one record per uid */
+struct uid_stats_header {
+	u32 version;
+	u32 nr_freqs;
+	u32 freqs[UID_MAX_STATES];
+};
+
+struct uid_stats_record {
+	u32 uid;
+	u32 reserved;
+	u64 time_in_state[UID_MAX_STATES];	/* clock_t */
+};
+
+#define UID_STATS_VERSION	1
+
+static DEFINE_SPINLOCK(uid_lock);
+static struct hlist_head uid_hash[1 << UID_HASH_BITS];
+static unsigned int uid_freqs[UID_MAX_STATES];
+static unsigned int uid_nr_freqs;
+
+static struct uid_entry *uid_entry_get(uid_t uid)
+{
+	struct hlist_head *head = &uid_hash[hash_32(uid, UID_HASH_BITS)];
+	struct hlist_node *node;
+	struct uid_entry *e;
+
+	hlist_for_each_entry(e, node, head, hash)
+		if (e->uid == uid)
+			return e;
+
+	e = kzalloc(sizeof(*e), GFP_ATOMIC);
+	if (!e)
+		return NULL;
+	e->uid = uid;
+	hlist_add_head(&e->hash, head);
+	return e;
+}
+
+void cpufreq_stats_account_uid(struct task_struct *p, cputime_t cputime)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, task_cpu(p));
+	struct uid_entry *e;
+	unsigned long flags;
+	unsigned int state;
+	u8 *uid_index;
+
+	if (!stat)
+		return;
+	uid_index = ACCESS_ONCE(stat->uid_index);
+	state = stat->last_index;
+	if (!uid_index || state >= stat->state_num ||
+	    uid_index[state] == UID_STATE_NONE)
+		return;
+
+	spin_lock_irqsave(&uid_lock, flags);
+	e = uid_entry_get(task_uid(p));
+	if (e)
+		e->time_in_state[uid_index[state]] = cputime64_add(
+			e->time_in_state[uid_index[state]],
+			cputime_to_cputime64(cputime));
+	spin_unlock_irqrestore(&uid_lock, flags);
+}
+
+static u8 *uid_index_create(struct cpufreq_stats *stat)
+{
+	unsigned long flags;
+	unsigned int i, j;
+	u8 *index;
+
+	index = kmalloc(stat->state_num, GFP_KERNEL);
+	if (!index)
+		return NULL;
+
+	spin_lock_irqsave(&uid_lock, flags);
+	for (i = 0; i < stat->state_num; i++) {
+		for (j = 0; j < uid_nr_freqs; j++)
+			if (uid_freqs[j] == stat->freq_table[i])
+				break;
+		if (j == uid_nr_freqs && j < UID_MAX_STATES)
+			uid_freqs[uid_nr_freqs++] = stat->freq_table[i];
+		index[i] = j < UID_MAX_STATES ? j : UID_STATE_NONE;
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+	return index;
+}
+
+/* copy the part of [pos, pos + len) that falls in [off, off + count) */
+static size_t uid_stats_copy(char *buf, loff_t off, size_t count,
+		loff_t pos, const void *src, size_t len)
+{
+	loff_t start = max(off, pos);
+	loff_t end = min_t(loff_t, off + count, pos + len);
+
+	if (start >= end)
+		return 0;
+	memcpy(buf + (start - off), src + (start - pos), end - start);
+	return end - start;
+}
+
+static ssize_t uid_time_in_state_read(struct file *filp,
+		struct kobject *kobj, struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	struct uid_stats_header hdr;
+	struct uid_stats_record rec;
+	struct hlist_node *node;
+	struct uid_entry *e;
+	unsigned long flags;
+	size_t done = 0;
+	loff_t pos;
+	int i, j;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memset(&rec, 0, sizeof(rec));
+
+	spin_lock_irqsave(&uid_lock, flags);
+	hdr.version = UID_STATS_VERSION;
+	hdr.nr_freqs = uid_nr_freqs;
+	memcpy(hdr.freqs, uid_freqs, sizeof(hdr.freqs));
+	done += uid_stats_copy(buf, off, count, 0, &hdr, sizeof(hdr));
+	pos = sizeof(hdr);
+
+	for (i = 0; i < ARRAY_SIZE(uid_hash) && done < count; i++) {
+		hlist_for_each_entry(e, node, &uid_hash[i], hash) {
+			if (pos + sizeof(rec) > off) {
+				rec.uid = e->uid;
+				for (j = 0; j < UID_MAX_STATES; j++)
+					rec.time_in_state[j] =
+						cputime64_to_clock_t(
+						e->time_in_state[j]);
+				done += uid_stats_copy(buf, off, count, pos,
+						&rec, sizeof(rec));
+			}
+			pos += sizeof(rec);
+			if (done == count)
+				break;
+		}
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+
+	return done;
+}
+
+static struct bin_attribute uid_time_in_state_attr = {
+	.attr = {.name = "uid_time_in_state", .mode = 0444, },
+	.read = uid_time_in_state_read,
+};
+#endif
+
 /* should be called late in the CPU removal sequence so that the stats
  * memory is still available in case someone tries to use it.
  */
@@ -172,6 +371,9 @@ static void cpufreq_stats_free_table(unsigned int cpu)
 {
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, cpu);
 	if (stat) {
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+		kfree(stat->uid_index);
+#endif
 		kfree(stat->time_in_state);
 		kfree(stat);
 	}
@@ -249,6 +451,15 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 			stat->freq_table[j++] = freq;
 	}
 	stat->state_num = j;
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	{
+		u8 *uid_index = uid_index_create(stat);
+
+		/* the tick may look at it as soon as it is set */
+		smp_wmb();
+		stat->uid_index = uid_index;
+	}
+#endif
 	spin_lock(&cpufreq_stats_lock);
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
@@ -287,14 +498,30 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_freqs *freq = data;
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
-
-	if (val != CPUFREQ_POSTCHANGE)
-		return 0;
+	s64 lat;
 
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->trans_start = ktime_get();
+		return 0;
+	}
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	if (stat->trans_start.tv64) {
+		lat = ktime_to_ns(ktime_sub(ktime_get(), stat->trans_start));
+		stat->trans_start.tv64 = 0;
+		spin_lock(&cpufreq_stats_lock);
+		stat->lat_count++;
+		stat->lat_total_ns += lat;
+		if (lat > stat->lat_max_ns)
+			stat->lat_max_ns = lat;
+		spin_unlock(&cpufreq_stats_lock);
+	}
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
@@ -402,6 +629,11 @@ static int __init cpufreq_stats_init(void)
 	for_each_online_cpu(cpu) {
 		cpufreq_update_policy(cpu);
 	}
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+	if (sysfs_create_bin_file(cpufreq_global_kobject,
+			&uid_time_in_state_attr))
+		pr_err("%s: uid_time_in_state creation failed\n", __func__);
+#endif
 	return 0;
 }
 static void __exit cpufreq_stats_exit(void)
@@ -13,6 +13,7 @@
  */
 #include <linux/mman.h>
 #include <linux/android_pmem.h>
+#include <linux/ion.h>
 #include <linux/types.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
@@ -125,6 +126,9 @@ struct qcedev_control{
 	/* qce handle */
 	void *qce;
 
+	/* ion client for QCEDEV_USE_ION buffers */
+	struct ion_client *ion_client;
+
 	/* platform device */
 	struct platform_device *pdev;
 
@@ -164,7 +168,7 @@ static int qcedev_scm_cmd(int resource, int cmd, int *response)
 	cmd_buf.resource = resource;
 	cmd_buf.cmd = cmd;
 
-	return scm_call(SCM_SVC_TZ, QCEDEV_CMD_ID, &cmd_buf,
+	return scm_call_noflush(SCM_SVC_TZ, QCEDEV_CMD_ID, &cmd_buf,
 		sizeof(cmd_buf), response, sizeof(*response));
 
 #else
@@ -452,8 +456,12 @@ static int start_cipher_req(struct qcedev_control *podev)
 	qcedev_areq = podev->active_command;
 
 	qcedev_areq->cipher_req.cookie = qcedev_areq->handle;
-	creq.use_pmem = qcedev_areq->cipher_op_req.use_pmem;
-	if (qcedev_areq->cipher_op_req.use_pmem == QCEDEV_USE_PMEM)
+	/* ION buffers have been resolved to physical offsets like PMEM ones */
+	if (qcedev_areq->cipher_op_req.use_pmem != QCEDEV_NO_PMEM)
+		creq.use_pmem = QCEDEV_USE_PMEM;
+	else
+		creq.use_pmem = QCEDEV_NO_PMEM;
+	if (creq.use_pmem == QCEDEV_USE_PMEM)
 		creq.pmem = &qcedev_areq->cipher_op_req.pmem;
 	else
 		creq.pmem = NULL;
@@ -1259,7 +1267,92 @@ static int qcedev_hash_final(struct qcedev_async_req *areq,
 		return qcedev_hmac_final(areq, handle);
 }
 
+#if defined(CONFIG_ANDROID_PMEM) || defined(CONFIG_ION)
+struct qcedev_pmem_buf {
+	struct file *file;
+	struct ion_handle *ion_handle;
+};
+
+/*
+ * Look up the physical and kernel addresses of a user buffer passed by
+ * file descriptor. For QCEDEV_USE_ION the fd is an ION buffer, which has
+ * to come from a physically contiguous heap since the offsets are handed
+ * to the data mover as is.
+ */
+static int qcedev_get_pmem_buf(struct qcedev_handle *handle, int type,
+		int fd, unsigned long *paddr, unsigned long *kvaddr,
+		struct qcedev_pmem_buf *buf)
+{
+	struct ion_client *client = handle->cntl->ion_client;
+	ion_phys_addr_t ion_paddr;
+	size_t ion_len;
+	void *vaddr;
+
+	buf->file = NULL;
+	buf->ion_handle = NULL;
+
+	if (type == QCEDEV_USE_PMEM) {
+#ifdef CONFIG_ANDROID_PMEM
+		unsigned long len;
+
+		if (get_pmem_file(fd, paddr, kvaddr, &len, &buf->file)) {
+			pr_err("%s: invalid pmem fd %d\n", __func__, fd);
+			return -EINVAL;
+		}
+		return 0;
+#else
+		return -EPERM;
+#endif
+	}
+
+	if (IS_ERR_OR_NULL(client))
+		return -EPERM;
+
+	buf->ion_handle = ion_import_fd(client, fd);
+	if (IS_ERR_OR_NULL(buf->ion_handle)) {
+		pr_err("%s: invalid ion fd %d\n", __func__, fd);
+		buf->ion_handle = NULL;
+		return -EINVAL;
+	}
+
+	if (ion_phys(client, buf->ion_handle, &ion_paddr, &ion_len)) {
+		pr_err("%s: ion fd %d is not physically contiguous\n",
+			__func__, fd);
+		goto err;
+	}
+
+	vaddr = ion_map_kernel(client, buf->ion_handle, 0);
+	if (IS_ERR_OR_NULL(vaddr)) {
+		pr_err("%s: unable to map ion fd %d\n", __func__, fd);
+		goto err;
+	}
+
+	*paddr = ion_paddr;
+	*kvaddr = (unsigned long)vaddr;
+	return 0;
+err:
+	ion_free(client, buf->ion_handle);
+	buf->ion_handle = NULL;
+	return -EINVAL;
+}
+
+static void qcedev_put_pmem_buf(struct qcedev_handle *handle,
+		struct qcedev_pmem_buf *buf)
+{
+	struct ion_client *client = handle->cntl->ion_client;
+
 #ifdef CONFIG_ANDROID_PMEM
+	if (buf->file)
+		put_pmem_file(buf->file);
+#endif
+	if (buf->ion_handle) {
+		ion_unmap_kernel(client, buf->ion_handle);
+		ion_free(client, buf->ion_handle);
+	}
+	buf->file = NULL;
+	buf->ion_handle = NULL;
+}
+
 static int qcedev_pmem_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 						struct qcedev_handle *handle)
 {
@@ -1268,11 +1361,11 @@ static int qcedev_pmem_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 	struct scatterlist *sg_src = NULL;
 	struct scatterlist *sg_dst = NULL;
 	struct scatterlist *sg_ndex = NULL;
-	struct file *file_src = NULL;
-	struct file *file_dst = NULL;
+	struct qcedev_pmem_buf buf_src = { NULL, NULL };
+	struct qcedev_pmem_buf buf_dst = { NULL, NULL };
+	int type = areq->cipher_op_req.use_pmem;
 	unsigned long paddr;
 	unsigned long kvaddr;
-	unsigned long len;
 
 	sg_src = kmalloc((sizeof(struct scatterlist) *
 				areq->cipher_op_req.entries),	GFP_KERNEL);
@@ -1288,8 +1381,12 @@ static int qcedev_pmem_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 	areq->cipher_req.creq.src = sg_src;
 
 	/* address src */
-	get_pmem_file(areq->cipher_op_req.pmem.fd_src, &paddr,
-					&kvaddr, &len, &file_src);
+	err = qcedev_get_pmem_buf(handle, type, areq->cipher_op_req.pmem.fd_src,
+					&paddr, &kvaddr, &buf_src);
+	if (err) {
+		kfree(sg_src);
+		return err;
+	}
 
 	for (i = 0; i < areq->cipher_op_req.entries; i++) {
 		sg_set_buf(sg_ndex,
@@ -1310,15 +1407,19 @@ static int qcedev_pmem_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 		if (sg_dst == NULL) {
 			pr_err("%s: Can't Allocate memory: sg_dst 0x%x\n",
 			__func__, (uint32_t)sg_dst);
-			return -ENOMEM;
+			err = -ENOMEM;
+			goto out;
 		}
 		memset(sg_dst, 0, (sizeof(struct scatterlist) *
 					areq->cipher_op_req.entries));
 		areq->cipher_req.creq.dst = sg_dst;
 		sg_ndex = sg_dst;
 
-		get_pmem_file(areq->cipher_op_req.pmem.fd_dst, &paddr,
-					&kvaddr, &len, &file_dst);
+		err = qcedev_get_pmem_buf(handle, type,
+					areq->cipher_op_req.pmem.fd_dst,
+					&paddr, &kvaddr, &buf_dst);
+		if (err)
+			goto out;
 		for (i = 0; i < areq->cipher_op_req.entries; i++)
 			sg_set_buf(sg_ndex++,
 			((uint8_t *)(areq->cipher_op_req.pmem.dst[i].offset)
@@ -1342,14 +1443,12 @@ static int qcedev_pmem_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 	areq->cipher_req.creq.info = areq->cipher_op_req.iv;
 
 	err = submit_req(areq, handle);
-
+out:
 	kfree(sg_src);
 	kfree(sg_dst);
 
-	if (file_dst)
-		put_pmem_file(file_dst);
-	if (file_src)
-		put_pmem_file(file_src);
+	qcedev_put_pmem_buf(handle, &buf_dst);
+	qcedev_put_pmem_buf(handle, &buf_src);
 
 	return err;
 };
@@ -1475,7 +1574,7 @@ static int qcedev_pmem_ablk_cipher(struct qcedev_async_req *qcedev_areq,
 {
 	return -EPERM;
 }
-#endif/*CONFIG_ANDROID_PMEM*/
+#endif/*CONFIG_ANDROID_PMEM || CONFIG_ION*/
 
 static int qcedev_vbuf_ablk_cipher_max_xfer(struct qcedev_async_req *areq,
 				int *di, struct qcedev_handle *handle,
@@ -1782,6 +1881,8 @@ static int qcedev_check_cipher_params(struct qcedev_cipher_op_req *req,
 				goto error;
 		}
 	}
+	if (req->use_pmem > QCEDEV_USE_ION)
+		goto error;
 	/* if using PMEM with non-zero byteoffset, ensure it is in_place_op */
 	if (req->use_pmem) {
 		if (!req->in_place_op)
@@ -2057,6 +2158,12 @@ static int qcedev_probe(struct platform_device *pdev)
 			goto err;
 		}
 	}
+
+	/* Without ION only PMEM and virtual buffers can be used */
+	podev->ion_client = msm_ion_client_create(-1, "qcedev");
+	if (IS_ERR_OR_NULL(podev->ion_client))
+		podev->ion_client = NULL;
+
 	rc = misc_register(&podev->miscdevice);
 
 	if (rc >= 0)
@@ -2065,6 +2172,9 @@ static int qcedev_probe(struct platform_device *pdev)
 		if (podev->platform_support.bus_scale_table != NULL)
 			msm_bus_scale_unregister_client(
 						podev->bus_scale_handle);
+	if (podev->ion_client)
+		ion_client_destroy(podev->ion_client);
+	podev->ion_client = NULL;
 err:
 
 	if (handle)
@@ -2090,6 +2200,9 @@ static int qcedev_remove(struct platform_device *pdev)
 
 	if (podev->miscdevice.minor != MISC_DYNAMIC_MINOR)
 		misc_deregister(&podev->miscdevice);
+	if (podev->ion_client)
+		ion_client_destroy(podev->ion_client);
+	podev->ion_client = NULL;
 	tasklet_kill(&podev->done_tasklet);
 	return 0;
 };
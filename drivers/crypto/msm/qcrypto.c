@@ -23,6 +23,7 @@
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/debugfs.h>
+#include <linux/moduleparam.h>
 
 #include <crypto/ctr.h>
 #include <crypto/des.h>
@@ -62,6 +63,7 @@ struct crypto_stat {
 	u32 ablk_cipher_3des_dec;
 	u32 ablk_cipher_op_success;
 	u32 ablk_cipher_op_fail;
+	u32 ablk_cipher_sw_fallback;
 	u32 sha1_digest;
 	u32 sha256_digest;
 	u32 sha_op_success;
@@ -134,7 +136,7 @@ static int qcrypto_scm_cmd(int resource, int cmd, int *response)
 	cmd_buf.resource = resource;
 	cmd_buf.cmd = cmd;
 
-	return scm_call(SCM_SVC_TZ, QCRYPTO_CMD_ID, &cmd_buf,
+	return scm_call_noflush(SCM_SVC_TZ, QCRYPTO_CMD_ID, &cmd_buf,
 		sizeof(cmd_buf), response, sizeof(*response));
 
 #else
@@ -214,8 +216,19 @@ struct qcrypto_cipher_ctx {
 	unsigned int auth_key_len;
 
 	struct crypto_priv *cp;
+
+	/* software cipher for requests too small to be worth the CE */
+	struct crypto_blkcipher *fallback;
 };
 
+/*
+ * AES requests shorter than this many bytes are done in software. Setting
+ * up the CE and the data mover costs more than encrypting a few blocks on
+ * the CPU. 0 sends everything to the CE.
+ */
+static unsigned int sw_fallback_threshold = 256;
+module_param(sw_fallback_threshold, uint, S_IRUGO | S_IWUSR);
+
 struct qcrypto_cipher_req_ctx {
 	u8 *iv;
 	unsigned int ivsize;
@@ -518,6 +531,34 @@ static void _qcrypto_cra_ablkcipher_exit(struct crypto_tfm *tfm)
 		qcrypto_ce_high_bw_req(ctx->cp, false);
 };
 
+static int _qcrypto_cra_aes_ablkcipher_init(struct crypto_tfm *tfm)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_blkcipher *fallback;
+
+	/* Any synchronous implementation will do, so this isn't picked */
+	fallback = crypto_alloc_blkcipher(crypto_tfm_alg_name(tfm), 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(fallback)) {
+		pr_warn("qcrypto: no software fallback for %s\n",
+			crypto_tfm_alg_name(tfm));
+		fallback = NULL;
+	}
+	ctx->fallback = fallback;
+
+	return _qcrypto_cra_ablkcipher_init(tfm);
+};
+
+static void _qcrypto_cra_aes_ablkcipher_exit(struct crypto_tfm *tfm)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	if (ctx->fallback)
+		crypto_free_blkcipher(ctx->fallback);
+	ctx->fallback = NULL;
+	_qcrypto_cra_ablkcipher_exit(tfm);
+};
+
 static void _qcrypto_cra_aead_exit(struct crypto_tfm *tfm)
 {
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
@@ -564,6 +605,9 @@ static int _disp_stats(int id)
 	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   ABLK CIPHER operation fail   : %d\n",
 					pstat->ablk_cipher_op_fail);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER software fallback: %d\n",
+					pstat->ablk_cipher_sw_fallback);
 
 	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   AEAD SHA1-AES encryption      : %d\n",
@@ -669,6 +713,23 @@ static int _qcrypto_setkey_aes(struct crypto_ablkcipher *cipher, const u8 *key,
 	};
 	ctx->enc_key_len = len;
 	memcpy(ctx->enc_key, key, len);
+
+	if (ctx->fallback) {
+		int ret;
+
+		crypto_blkcipher_clear_flags(ctx->fallback,
+				CRYPTO_TFM_REQ_MASK);
+		crypto_blkcipher_set_flags(ctx->fallback,
+				crypto_ablkcipher_get_flags(cipher) &
+				CRYPTO_TFM_REQ_MASK);
+		ret = crypto_blkcipher_setkey(ctx->fallback, key, len);
+		if (ret) {
+			crypto_ablkcipher_set_flags(cipher,
+				crypto_blkcipher_get_flags(ctx->fallback) &
+				CRYPTO_TFM_RES_MASK);
+			return ret;
+		}
+	}
 	return 0;
 };
 
@@ -715,15 +776,22 @@ static void req_done(unsigned long data)
 	struct crypto_async_request *areq;
 	struct crypto_priv *cp = (struct crypto_priv *)data;
 	unsigned long flags;
+	int res;
 
 	spin_lock_irqsave(&cp->lock, flags);
 	areq = cp->req;
+	res = cp->res;
 	cp->req = NULL;
 	spin_unlock_irqrestore(&cp->lock, flags);
 
-	if (areq)
-		areq->complete(areq, cp->res);
+	/*
+	 * The engine is done with this request, so get the next one going
+	 * before running the completion. Completions such as dm-crypt's can
+	 * take a while and the engine would otherwise sit idle through them.
+	 */
 	_start_qcrypto_process(cp);
+	if (areq)
+		areq->complete(areq, res);
 };
 
 static void _update_sha1_ctx(struct ahash_request  *req)
@@ -907,6 +975,7 @@ static void _qce_aead_complete(void *cookie, unsigned char *icv,
 		pstat->aead_op_fail++;
 	else
 		pstat->aead_op_success++;
+	cp->res = ret;
 
 	if (cp->platform_support.ce_shared)
 		schedule_work(&cp->unlock_ce_ws);
@@ -1191,6 +1260,35 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 	return ret;
 }
 
+static bool _qcrypto_use_fallback(struct ablkcipher_request *req)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+
+	/* A zero length key means the CE's hardware key, keep those on CE */
+	return ctx->fallback && ctx->enc_key_len &&
+		req->nbytes < sw_fallback_threshold;
+}
+
+/* Done synchronously, so the request completes by returning 0 */
+static int _qcrypto_fallback_crypt(struct ablkcipher_request *req,
+		enum qce_cipher_dir_enum dir)
+{
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct blkcipher_desc desc;
+
+	_qcrypto_stat[ctx->cp->pdev->id].ablk_cipher_sw_fallback++;
+
+	desc.tfm = ctx->fallback;
+	desc.info = req->info;
+	desc.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	if (dir == QCE_ENCRYPT)
+		return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+				req->nbytes);
+	return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+			req->nbytes);
+}
+
 static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 {
 	struct qcrypto_cipher_req_ctx *rctx;
@@ -1212,6 +1310,8 @@ static int _qcrypto_enc_aes_ecb(struct ablkcipher_request *req)
 	rctx->mode = QCE_MODE_ECB;
 
 	pstat->ablk_cipher_aes_enc++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_ENCRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -1236,6 +1336,8 @@ static int _qcrypto_enc_aes_cbc(struct ablkcipher_request *req)
 	rctx->mode = QCE_MODE_CBC;
 
 	pstat->ablk_cipher_aes_enc++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_ENCRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -1260,6 +1362,8 @@ static int _qcrypto_enc_aes_ctr(struct ablkcipher_request *req)
 	rctx->mode = QCE_MODE_CTR;
 
 	pstat->ablk_cipher_aes_enc++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_ENCRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -1415,6 +1519,8 @@ static int _qcrypto_dec_aes_ecb(struct ablkcipher_request *req)
 	rctx->mode = QCE_MODE_ECB;
 
 	pstat->ablk_cipher_aes_dec++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_DECRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -1440,6 +1546,8 @@ static int _qcrypto_dec_aes_cbc(struct ablkcipher_request *req)
 	rctx->mode = QCE_MODE_CBC;
 
 	pstat->ablk_cipher_aes_dec++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_DECRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -1466,6 +1574,8 @@ static int _qcrypto_dec_aes_ctr(struct ablkcipher_request *req)
 	rctx->dir = QCE_ENCRYPT;
 
 	pstat->ablk_cipher_aes_dec++;
+	if (_qcrypto_use_fallback(req))
+		return _qcrypto_fallback_crypt(req, QCE_DECRYPT);
 	return _qcrypto_queue_req(cp, &req->base);
 };
 
@@ -2731,8 +2841,8 @@ static struct crypto_alg _qcrypto_ablk_cipher_algos[] = {
 		.cra_alignmask	= 0,
 		.cra_type	= &crypto_ablkcipher_type,
 		.cra_module	= THIS_MODULE,
-		.cra_init	= _qcrypto_cra_ablkcipher_init,
-		.cra_exit	= _qcrypto_cra_ablkcipher_exit,
+		.cra_init	= _qcrypto_cra_aes_ablkcipher_init,
+		.cra_exit	= _qcrypto_cra_aes_ablkcipher_exit,
 		.cra_u		= {
 			.ablkcipher = {
 				.min_keysize	= AES_MIN_KEY_SIZE,
@@ -2753,8 +2863,8 @@ static struct crypto_alg _qcrypto_ablk_cipher_algos[] = {
 		.cra_alignmask	= 0,
 		.cra_type	= &crypto_ablkcipher_type,
 		.cra_module	= THIS_MODULE,
-		.cra_init	= _qcrypto_cra_ablkcipher_init,
-		.cra_exit	= _qcrypto_cra_ablkcipher_exit,
+		.cra_init	= _qcrypto_cra_aes_ablkcipher_init,
+		.cra_exit	= _qcrypto_cra_aes_ablkcipher_exit,
 		.cra_u		= {
 			.ablkcipher = {
 				.ivsize		= AES_BLOCK_SIZE,
@@ -2776,8 +2886,8 @@ static struct crypto_alg _qcrypto_ablk_cipher_algos[] = {
 		.cra_alignmask	= 0,
 		.cra_type	= &crypto_ablkcipher_type,
 		.cra_module	= THIS_MODULE,
-		.cra_init	= _qcrypto_cra_ablkcipher_init,
-		.cra_exit	= _qcrypto_cra_ablkcipher_exit,
+		.cra_init	= _qcrypto_cra_aes_ablkcipher_init,
+		.cra_exit	= _qcrypto_cra_aes_ablkcipher_exit,
 		.cra_u		= {
 			.ablkcipher = {
 				.ivsize		= AES_BLOCK_SIZE,
@@ -28,11 +28,18 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include <mach/iommu_domains.h>
 #include "ion_priv.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/ion.h>
 #define DEBUG
 
 /**
@@ -53,8 +60,18 @@ struct ion_device {
 	struct rb_root user_clients;
 	struct rb_root kernel_clients;
 	struct dentry *debug_root;
+	struct list_head iommu_idle;
+	unsigned int iommu_idle_cnt;
+	spinlock_t iommu_idle_lock;
+	struct work_struct iommu_reclaim_work;
 };
 
+/*
+ * Number of idle iommu mappings kept around for reuse before the oldest
+ * ones get torn down
+ */
+#define ION_IOMMU_IDLE_MAX 64
+
 /**
  * struct ion_client - a process/hw block local address space
  * @ref:		for reference counting the client
@@ -232,6 +249,7 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 	}
 	buffer->dev = dev;
 	buffer->size = len;
+	buffer->cpu_dirty = 1;
 	mutex_init(&buffer->lock);
 	ion_buffer_add(dev, buffer);
 	return buffer;
@@ -256,7 +274,16 @@ static void ion_iommu_delayed_unmap(struct ion_buffer *buffer)
 		ref_count = atomic_read(&iommu_map->ref.refcount);
 		delayed_unmap = iommu_map->flags & ION_IOMMU_UNMAP_DELAYED;
 
-		if ((delayed_unmap && ref_count > 1) || !delayed_unmap) {
+		spin_lock(&buffer->dev->iommu_idle_lock);
+		if (!list_empty(&iommu_map->idle_node)) {
+			list_del_init(&iommu_map->idle_node);
+			buffer->dev->iommu_idle_cnt--;
+		}
+		spin_unlock(&buffer->dev->iommu_idle_lock);
+
+		/* Idle mappings (no references left) are expected here */
+		if ((delayed_unmap && ref_count > 1) ||
+		    (!delayed_unmap && ref_count)) {
 			pr_err("%s: Virtual memory address leak in domain %u, partition %u\n",
 				__func__, iommu_map->domain_info[DI_DOMAIN_NUM],
 				iommu_map->domain_info[DI_PARTITION_NUM]);
@@ -402,6 +429,7 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 	const unsigned int MAX_DBG_STR_LEN = 64;
 	char dbg_str[MAX_DBG_STR_LEN];
 	unsigned int dbg_str_idx = 0;
+	ktime_t start = ktime_get();
 
 	dbg_str[0] = '\0';
 
@@ -445,6 +473,9 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 	mutex_unlock(&dev->lock);
 
 	if (IS_ERR_OR_NULL(buffer)) {
+		trace_ion_alloc(client->name, "none", len, align, flags,
+			buffer ? PTR_ERR(buffer) : -ENOMEM,
+			ktime_to_us(ktime_sub(ktime_get(), start)));
 		pr_debug("ION is unable to allocate 0x%x bytes (alignment: "
 			 "0x%x) from heap(s) %sfor client %s with heap "
 			 "mask 0x%x\n",
@@ -452,6 +483,9 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 		return ERR_PTR(PTR_ERR(buffer));
 	}
 
+	trace_ion_alloc(client->name, buffer->heap->name, len, align, flags, 0,
+		ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	handle = ion_handle_create(client, buffer);
 
 	if (IS_ERR_OR_NULL(handle))
@@ -487,6 +521,8 @@ void ion_free(struct ion_client *client, struct ion_handle *handle)
 		WARN("%s: invalid handle passed to free.\n", __func__);
 		return;
 	}
+	trace_ion_free(client->name, handle->buffer->heap->name,
+		       handle->buffer->size);
 	ion_handle_put(handle);
 	mutex_unlock(&client->lock);
 }
@@ -586,6 +622,7 @@ void *ion_map_kernel(struct ion_client *client, struct ion_handle *handle,
 		if (IS_ERR_OR_NULL(vaddr))
 			_ion_unmap(&buffer->kmap_cnt, &handle->kmap_cnt);
 		buffer->vaddr = vaddr;
+		buffer->cpu_dirty = 1;
 	} else {
 		vaddr = buffer->vaddr;
 	}
@@ -611,6 +648,7 @@ static struct ion_iommu_map *__ion_iommu_map(struct ion_buffer *buffer,
 		return ERR_PTR(-ENOMEM);
 
 	data->buffer = buffer;
+	INIT_LIST_HEAD(&data->idle_node);
 	iommu_map_domain(data) = domain_num;
 	iommu_map_partition(data) = partition_num;
 
@@ -645,6 +683,8 @@ int ion_map_iommu(struct ion_client *client, struct ion_handle *handle,
 	struct ion_buffer *buffer;
 	struct ion_iommu_map *iommu_map;
 	int ret = 0;
+	int mapped = 0;
+	ktime_t start = ktime_get();
 
 	if (ION_IS_CACHED(flags)) {
 		pr_err("%s: Cannot map iommu as cached.\n", __func__);
@@ -698,6 +738,26 @@ int ion_map_iommu(struct ion_client *client, struct ion_handle *handle,
 	}
 
 	iommu_map = ion_iommu_lookup(buffer, domain_num, partition_num);
+
+	/* An idle mapping that doesn't fit the request gets replaced */
+	if (iommu_map && (iommu_map->flags != iommu_flags ||
+			  iommu_map->mapped_size != iova_length)) {
+		int idle;
+
+		spin_lock(&buffer->dev->iommu_idle_lock);
+		idle = !list_empty(&iommu_map->idle_node);
+		if (idle) {
+			list_del_init(&iommu_map->idle_node);
+			buffer->dev->iommu_idle_cnt--;
+		}
+		spin_unlock(&buffer->dev->iommu_idle_lock);
+
+		if (idle) {
+			ion_iommu_release(&iommu_map->ref);
+			iommu_map = NULL;
+		}
+	}
+
 	_ion_map(&buffer->iommu_map_cnt, &handle->iommu_map_cnt);
 	if (!iommu_map) {
 		iommu_map = __ion_iommu_map(buffer, domain_num, partition_num,
@@ -728,12 +788,26 @@ int ion_map_iommu(struct ion_client *client, struct ion_handle *handle,
 				   &handle->iommu_map_cnt);
 			ret = -EINVAL;
 		} else {
-			kref_get(&iommu_map->ref);
+			/* Bring an idle mapping back into use */
+			spin_lock(&buffer->dev->iommu_idle_lock);
+			if (!list_empty(&iommu_map->idle_node)) {
+				list_del_init(&iommu_map->idle_node);
+				buffer->dev->iommu_idle_cnt--;
+				kref_init(&iommu_map->ref);
+			} else {
+				kref_get(&iommu_map->ref);
+			}
+			spin_unlock(&buffer->dev->iommu_idle_lock);
+
 			*iova = iommu_map->iova_addr;
+			mapped = 1;
 		}
 	}
 	*buffer_size = buffer->size;
 out:
+	trace_ion_map_iommu(client->name, buffer->heap->name, domain_num,
+		partition_num, iova_length, mapped, ret,
+		ktime_to_us(ktime_sub(ktime_get(), start)));
 	mutex_unlock(&buffer->lock);
 	mutex_unlock(&client->lock);
 	return ret;
@@ -751,6 +825,84 @@ static void ion_iommu_release(struct kref *kref)
 	kfree(map);
 }
 
+/*
+ * Called with the buffer lock held when the last user of a mapping goes
+ * away. Keep the mapping so it can be reused if the buffer gets mapped into
+ * the same domain again, which is what video playback does with every
+ * frame. The cp heaps manage their own iommu mappings so they are released
+ * straight away.
+ */
+static void ion_iommu_idle(struct kref *kref)
+{
+	struct ion_iommu_map *map = container_of(kref, struct ion_iommu_map,
+						ref);
+	struct ion_device *dev = map->buffer->dev;
+	int reclaim;
+
+	if (map->buffer->heap->type == ION_HEAP_TYPE_CP) {
+		ion_iommu_release(kref);
+		return;
+	}
+
+	spin_lock(&dev->iommu_idle_lock);
+	list_add_tail(&map->idle_node, &dev->iommu_idle);
+	reclaim = (++dev->iommu_idle_cnt > ION_IOMMU_IDLE_MAX);
+	spin_unlock(&dev->iommu_idle_lock);
+
+	if (reclaim)
+		schedule_work(&dev->iommu_reclaim_work);
+}
+
+/*
+ * Tear down the oldest idle mappings in one go until the idle list is
+ * back under its limit. Mappings of buffers that are already being
+ * destroyed are left to ion_iommu_delayed_unmap().
+ */
+static void ion_iommu_reclaim(struct work_struct *work)
+{
+	struct ion_device *dev = container_of(work, struct ion_device,
+						iommu_reclaim_work);
+	struct ion_iommu_map *map;
+	struct ion_buffer *buffer;
+	int idle;
+
+	while (1) {
+		spin_lock(&dev->iommu_idle_lock);
+		if (dev->iommu_idle_cnt <= ION_IOMMU_IDLE_MAX) {
+			spin_unlock(&dev->iommu_idle_lock);
+			break;
+		}
+
+		map = list_first_entry(&dev->iommu_idle, struct ion_iommu_map,
+					idle_node);
+		buffer = map->buffer;
+
+		if (!atomic_inc_not_zero(&buffer->ref.refcount)) {
+			list_del_init(&map->idle_node);
+			dev->iommu_idle_cnt--;
+			spin_unlock(&dev->iommu_idle_lock);
+			continue;
+		}
+		spin_unlock(&dev->iommu_idle_lock);
+
+		mutex_lock(&buffer->lock);
+		spin_lock(&dev->iommu_idle_lock);
+		idle = !list_empty(&map->idle_node);
+		if (idle) {
+			list_del_init(&map->idle_node);
+			dev->iommu_idle_cnt--;
+		}
+		spin_unlock(&dev->iommu_idle_lock);
+
+		/* It may have been picked up again while we weren't looking */
+		if (idle)
+			ion_iommu_release(&map->ref);
+		mutex_unlock(&buffer->lock);
+
+		ion_buffer_put(buffer);
+	}
+}
+
 void ion_unmap_iommu(struct ion_client *client, struct ion_handle *handle,
 			int domain_num, int partition_num)
 {
@@ -771,7 +923,7 @@ void ion_unmap_iommu(struct ion_client *client, struct ion_handle *handle,
 	}
 
 	_ion_unmap(&buffer->iommu_map_cnt, &handle->iommu_map_cnt);
-	kref_put(&iommu_map->ref, ion_iommu_release);
+	kref_put(&iommu_map->ref, ion_iommu_idle);
 
 out:
 	mutex_unlock(&buffer->lock);
@@ -957,10 +1109,41 @@ int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 		goto out;
 	}
 
+	if (offset > buffer->size || len > buffer->size - offset) {
+		pr_err("%s: range %lx+%lx is outside of the buffer (%x)\n",
+		       __func__, offset, len, buffer->size);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (!len) {
+		ret = 0;
+		goto out;
+	}
+
+	/*
+	 * Nothing can have dirtied the caches since the last full clean if
+	 * the buffer hasn't had a writable CPU mapping since then, so the
+	 * clean part of the operation can be skipped. Invalidates are always
+	 * done, the CPU can speculatively pull in lines through any mapping
+	 * while a device owns the buffer.
+	 */
+	if (!buffer->cpu_dirty) {
+		if (cmd == ION_IOC_CLEAN_CACHES) {
+			ret = 0;
+			goto out;
+		}
+		if (cmd == ION_IOC_CLEAN_INV_CACHES)
+			cmd = ION_IOC_INV_CACHES;
+	}
 
 	ret = buffer->heap->ops->cache_op(buffer->heap, buffer, uaddr,
 						offset, len, cmd);
 
+	if (!ret && cmd != ION_IOC_INV_CACHES && offset == 0 &&
+	    len == buffer->size && !buffer->kmap_cnt && !buffer->uwmap_cnt)
+		buffer->cpu_dirty = 0;
+
 out:
 	mutex_unlock(&buffer->lock);
 	mutex_unlock(&client->lock);
@@ -1295,6 +1478,8 @@ static void ion_vma_open(struct vm_area_struct *vma)
 	ion_handle_get(handle);
 	mutex_lock(&buffer->lock);
 	buffer->umap_cnt++;
+	if (vma->vm_flags & VM_WRITE)
+		buffer->uwmap_cnt++;
 	mutex_unlock(&buffer->lock);
 	pr_debug("%s: %d client_cnt %d handle_cnt %d alloc_cnt %d\n",
 		 __func__, __LINE__,
@@ -1316,6 +1501,8 @@ static void ion_vma_close(struct vm_area_struct *vma)
 	client = handle->client;
 	mutex_lock(&buffer->lock);
 	buffer->umap_cnt--;
+	if (vma->vm_flags & VM_WRITE)
+		buffer->uwmap_cnt--;
 	mutex_unlock(&buffer->lock);
 
 	if (buffer->heap->ops->unmap_user)
@@ -1406,6 +1593,17 @@ static int ion_share_mmap(struct file *file, struct vm_area_struct *vma)
 		       __func__);
 		goto err2;
 	}
+
+	/*
+	 * Keep read only mappings read only so the cache state of the
+	 * buffer can be tracked from the writable ones
+	 */
+	if (vma->vm_flags & VM_WRITE) {
+		buffer->uwmap_cnt++;
+		buffer->cpu_dirty = 1;
+	} else {
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
 	mutex_unlock(&buffer->lock);
 
 	vma->vm_ops = &ion_vm_ops;
@@ -1804,6 +2002,51 @@ static void ion_debug_mem_map_destroy(struct rb_root *mem_map)
 	}
 }
 
+/**
+ * Print the free space left in a heap from its mem_map.
+ * @param s seq_file to log message to.
+ * @param mem_map The mem_map of the heap.
+ * @param base The start of the heap.
+ * @param size The size of the heap.
+ */
+void ion_debug_mem_map_frag(struct seq_file *s, const struct rb_root *mem_map,
+			    unsigned long base, unsigned long size)
+{
+	unsigned long last_end = base;
+	unsigned long end = base + size;
+	unsigned long free = 0, largest = 0, chunks = 0, frag = 0;
+	struct rb_node *n;
+
+	for (n = rb_first(mem_map); ; n = rb_next(n)) {
+		unsigned long gap_end = end;
+		struct mem_map_data *data = NULL;
+
+		if (n) {
+			data = rb_entry(n, struct mem_map_data, node);
+			gap_end = data->addr;
+		}
+
+		if (last_end < gap_end) {
+			free += gap_end - last_end;
+			largest = max(largest, gap_end - last_end);
+			chunks++;
+		}
+
+		if (!data)
+			break;
+		last_end = data->addr_end + 1;
+	}
+
+	/* How much of the free space can't be used by a single allocation */
+	if (free)
+		frag = 100 - (unsigned long) div_u64((u64) largest * 100, free);
+
+	seq_printf(s, "\nfree bytes: %lx\n", free);
+	seq_printf(s, "free chunks: %lu\n", chunks);
+	seq_printf(s, "largest free chunk: %lx\n", largest);
+	seq_printf(s, "fragmentation: %lu%%\n", frag);
+}
+
 /**
  * Print heap debug information.
  * @param s seq_file to log message to.
@@ -2054,6 +2297,9 @@ struct ion_device *ion_device_create(long (*custom_ioctl)
 
 	idev->custom_ioctl = custom_ioctl;
 	idev->buffers = RB_ROOT;
+	INIT_LIST_HEAD(&idev->iommu_idle);
+	spin_lock_init(&idev->iommu_idle_lock);
+	INIT_WORK(&idev->iommu_reclaim_work, ion_iommu_reclaim);
 	mutex_init(&idev->lock);
 	idev->heaps = RB_ROOT;
 	idev->user_clients = RB_ROOT;
@@ -2066,6 +2312,7 @@ struct ion_device *ion_device_create(long (*custom_ioctl)
 void ion_device_destroy(struct ion_device *dev)
 {
 	misc_deregister(&dev->dev);
+	cancel_work_sync(&dev->iommu_reclaim_work);
 	/* XXX need to free the heaps and clients ? */
 	kfree(dev);
 }
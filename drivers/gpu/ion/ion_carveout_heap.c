@@ -21,6 +21,7 @@
 #include <linux/io.h>
 #include <linux/ion.h>
 #include <linux/mm.h>
+#include <linux/highmem.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
@@ -43,8 +44,109 @@ struct ion_carveout_heap {
 	atomic_t map_count;
 	void *bus_id;
 	unsigned int has_outer_cache;
+	int movable;
 };
 
+#ifdef CONFIG_CMA
+/*
+ * A movable heap lends its free memory to the page allocator. Buffers take
+ * their pages back with alloc_contig_range(), migrating whatever movable
+ * data had been put there.
+ */
+static int ion_carveout_movable_init(struct ion_carveout_heap *carveout_heap,
+				     const char *name)
+{
+	unsigned long pfn = PFN_DOWN(carveout_heap->base);
+	unsigned long end = pfn + PFN_DOWN(carveout_heap->total_size);
+
+	if (!IS_ALIGNED(pfn | end, pageblock_nr_pages) ||
+	    !PageHighMem(pfn_to_page(pfn))) {
+		pr_err("%s: heap %s is not pageblock aligned highmem, using it as a fixed carveout\n",
+			__func__, name);
+		return -EINVAL;
+	}
+
+	for (; pfn < end; pfn += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn));
+	return 0;
+}
+
+static int ion_carveout_movable_alloc(struct ion_carveout_heap *carveout_heap,
+				      ion_phys_addr_t addr, unsigned long size)
+{
+	unsigned long pfn = PFN_DOWN(addr);
+	unsigned long nr = PFN_DOWN(size);
+	unsigned long i;
+	int ret;
+
+	ret = alloc_contig_range(pfn, pfn + nr);
+	if (ret)
+		return ret;
+
+	/* Whatever the pages held may still be in the caches */
+	for (i = 0; i < nr; i++) {
+		void *vaddr = kmap_atomic(pfn_to_page(pfn + i));
+
+		dmac_flush_range(vaddr, vaddr + PAGE_SIZE);
+		kunmap_atomic(vaddr);
+	}
+	if (carveout_heap->has_outer_cache)
+		outer_flush_range(addr, addr + size);
+	return 0;
+}
+
+static void ion_carveout_movable_free(ion_phys_addr_t addr, unsigned long size)
+{
+	free_contig_range(PFN_DOWN(addr), PFN_DOWN(size));
+}
+
+static void *ion_carveout_movable_map(struct ion_buffer *buffer,
+				      unsigned long flags)
+{
+	unsigned long nr = PFN_DOWN(buffer->size);
+	unsigned long pfn = PFN_DOWN(buffer->priv_phys);
+	struct page **pages;
+	pgprot_t prot;
+	void *vaddr;
+	unsigned long i;
+
+	pages = vmalloc(sizeof(struct page *) * nr);
+	if (!pages)
+		return NULL;
+	for (i = 0; i < nr; i++)
+		pages[i] = pfn_to_page(pfn + i);
+
+	prot = ION_IS_CACHED(flags) ? PAGE_KERNEL :
+		pgprot_writecombine(PAGE_KERNEL);
+	vaddr = vmap(pages, nr, VM_MAP, prot);
+	vfree(pages);
+	return vaddr;
+}
+#else
+static int ion_carveout_movable_init(struct ion_carveout_heap *carveout_heap,
+				     const char *name)
+{
+	pr_err("%s: heap %s needs CONFIG_CMA to be movable\n", __func__, name);
+	return -EINVAL;
+}
+
+static int ion_carveout_movable_alloc(struct ion_carveout_heap *carveout_heap,
+				      ion_phys_addr_t addr, unsigned long size)
+{
+	return 0;
+}
+
+static void ion_carveout_movable_free(ion_phys_addr_t addr, unsigned long size)
+{
+}
+
+static void *ion_carveout_movable_map(struct ion_buffer *buffer,
+				      unsigned long flags)
+{
+	return NULL;
+}
+#endif
+
 ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
 				      unsigned long size,
 				      unsigned long align)
@@ -96,13 +198,40 @@ static int ion_carveout_heap_allocate(struct ion_heap *heap,
 				      unsigned long size, unsigned long align,
 				      unsigned long flags)
 {
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
+
+	if (carveout_heap->movable)
+		size = PAGE_ALIGN(size);
+
 	buffer->priv_phys = ion_carveout_allocate(heap, size, align);
-	return buffer->priv_phys == ION_CARVEOUT_ALLOCATE_FAIL ? -ENOMEM : 0;
+	if (buffer->priv_phys == ION_CARVEOUT_ALLOCATE_FAIL)
+		return -ENOMEM;
+
+	if (carveout_heap->movable &&
+	    ion_carveout_movable_alloc(carveout_heap, buffer->priv_phys,
+				       size)) {
+		ion_carveout_free(heap, buffer->priv_phys, size);
+		buffer->priv_phys = ION_CARVEOUT_ALLOCATE_FAIL;
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 static void ion_carveout_heap_free(struct ion_buffer *buffer)
 {
 	struct ion_heap *heap = buffer->heap;
+	struct ion_carveout_heap *carveout_heap =
+		container_of(heap, struct ion_carveout_heap, heap);
+
+	if (carveout_heap->movable) {
+		ion_carveout_movable_free(buffer->priv_phys,
+					  PAGE_ALIGN(buffer->size));
+		ion_carveout_free(heap, buffer->priv_phys,
+				  PAGE_ALIGN(buffer->size));
+		buffer->priv_phys = ION_CARVEOUT_ALLOCATE_FAIL;
+		return;
+	}
 
 	ion_carveout_free(heap, buffer->priv_phys, buffer->size);
 	buffer->priv_phys = ION_CARVEOUT_ALLOCATE_FAIL;
@@ -173,7 +302,10 @@ void *ion_carveout_heap_map_kernel(struct ion_heap *heap,
 	if (ion_carveout_request_region(carveout_heap))
 		return NULL;
 
-	if (ION_IS_CACHED(flags))
+	/* Movable memory has struct pages and may not be ioremapped */
+	if (carveout_heap->movable)
+		ret_value = ion_carveout_movable_map(buffer, flags);
+	else if (ION_IS_CACHED(flags))
 		ret_value = ioremap_cached(buffer->priv_phys, buffer->size);
 	else
 		ret_value = ioremap(buffer->priv_phys, buffer->size);
@@ -189,7 +321,10 @@ void ion_carveout_heap_unmap_kernel(struct ion_heap *heap,
 	struct ion_carveout_heap *carveout_heap =
 		container_of(heap, struct ion_carveout_heap, heap);
 
-	__arch_iounmap(buffer->vaddr);
+	if (carveout_heap->movable)
+		vunmap(buffer->vaddr);
+	else
+		__arch_iounmap(buffer->vaddr);
 	buffer->vaddr = NULL;
 
 	ion_carveout_release_region(carveout_heap);
@@ -306,6 +441,8 @@ static int ion_carveout_print_debug(struct ion_heap *heap, struct seq_file *s,
 			seq_printf(s, "%16.s %14lx %14lx %14lu (%lx)\n", "FREE",
 				last_end, end-1, end-last_end, end-last_end);
 		}
+
+		ion_debug_mem_map_frag(s, mem_map, base, size);
 	}
 	return 0;
 }
@@ -469,6 +606,10 @@ struct ion_heap *ion_carveout_heap_create(struct ion_platform_heap *heap_data)
 		if (extra_data->release_region)
 			carveout_heap->release_region =
 					extra_data->release_region;
+		if (extra_data->movable)
+			carveout_heap->movable =
+				!ion_carveout_movable_init(carveout_heap,
+							  heap_data->name);
 	}
 	return &carveout_heap->heap;
 }
@@ -28,6 +28,7 @@
 #include <linux/seq_file.h>
 #include <linux/fmem.h>
 #include <linux/iommu.h>
+#include <linux/workqueue.h>
 #include <mach/msm_memtypes.h>
 #include <mach/scm.h>
 #include <mach/iommu_domains.h>
@@ -71,6 +72,11 @@
  * @iommu_map_all:	Indicates whether we should map whole heap into IOMMU.
  * @iommu_2x_map_domain: Indicates the domain to use for overmapping.
  * @has_outer_cache:    set to 1 if outer cache is used, 0 otherwise.
+ * @protect_cnt:	number of outstanding secure requests on the heap.
+ * @unprotect_pending:	set when the last secure request went away but the
+ *			heap is kept protected in case it is secured again.
+ * @unprotect_work:	delayed work that unprotects the heap once it has
+ *			stayed unused for ION_CP_UNPROTECT_DELAY.
 */
 struct ion_cp_heap {
 	struct ion_heap heap;
@@ -100,8 +106,18 @@ struct ion_cp_heap {
 	int iommu_2x_map_domain;
 	unsigned int has_outer_cache;
 	atomic_t protect_cnt;
+	int unprotect_pending;
+	struct delayed_work unprotect_work;
 };
 
+/*
+ * Secure playback tends to stop and start again right away (seeking,
+ * switching streams), so keep the heap locked down for a while after the
+ * last secure user is gone instead of paying for a round trip to TZ on
+ * every transition.
+ */
+#define ION_CP_UNPROTECT_DELAY	msecs_to_jiffies(1000)
+
 enum {
 	HEAP_NOT_PROTECTED = 0,
 	HEAP_PROTECTED = 1,
@@ -135,6 +151,14 @@ static int ion_cp_protect(struct ion_heap *heap)
 	int ret_value = 0;
 
 	if (atomic_inc_return(&cp_heap->protect_cnt) == 1) {
+		/* Still protected from the last user, nothing to do */
+		if (cp_heap->unprotect_pending) {
+			cp_heap->unprotect_pending = 0;
+			cancel_delayed_work(&cp_heap->unprotect_work);
+			pr_debug("Kept heap %s protected\n", heap->name);
+			goto out;
+		}
+
 		/* Make sure we are in C state when the heap is protected. */
 		if (cp_heap->reusable && !cp_heap->allocated_bytes) {
 			ret_value = fmem_set_state(FMEM_C_STATE);
@@ -172,29 +196,70 @@ out:
  * the correct FMEM state if this heap is a reusable heap.
  * Must be called with heap->lock locked.
  */
+static void ion_cp_do_unprotect(struct ion_cp_heap *cp_heap)
+{
+	struct ion_heap *heap = &cp_heap->heap;
+	int error_code = ion_cp_unprotect_mem(
+		cp_heap->secure_base, cp_heap->secure_size,
+		cp_heap->permission_type);
+
+	if (error_code) {
+		pr_err("Failed to un-protect memory for heap %s - "
+			"error code: %d\n", heap->name, error_code);
+	} else  {
+		cp_heap->heap_protected = HEAP_NOT_PROTECTED;
+		pr_debug("Un-protected heap %s @ 0x%x\n", heap->name,
+			(unsigned int) cp_heap->base);
+
+		if (cp_heap->reusable && !cp_heap->allocated_bytes) {
+			if (fmem_set_state(FMEM_T_STATE) != 0)
+				pr_err("%s: unable to transition heap to T-state",
+					__func__);
+		}
+	}
+}
+
+/**
+ * Unprotects the heap right away if the last secure user is gone and the
+ * unprotect was deferred. Called before anything that needs the heap to be
+ * accessible from the non-secure side.
+ * Must be called with heap->lock locked.
+ */
+static void ion_cp_unprotect_sync(struct ion_cp_heap *cp_heap)
+{
+	if (!cp_heap->unprotect_pending)
+		return;
+
+	cp_heap->unprotect_pending = 0;
+	cancel_delayed_work(&cp_heap->unprotect_work);
+	ion_cp_do_unprotect(cp_heap);
+}
+
+static void ion_cp_unprotect_worker(struct work_struct *work)
+{
+	struct ion_cp_heap *cp_heap = container_of(to_delayed_work(work),
+					struct ion_cp_heap, unprotect_work);
+
+	/* A new secure user may have claimed the heap in the meantime */
+	mutex_lock(&cp_heap->lock);
+	ion_cp_unprotect_sync(cp_heap);
+	mutex_unlock(&cp_heap->lock);
+}
+
+/**
+ * Drops a secure request on the heap. The heap is unprotected from a
+ * worker once it has not been secured again for ION_CP_UNPROTECT_DELAY.
+ * Must be called with heap->lock locked.
+ */
 static void ion_cp_unprotect(struct ion_heap *heap)
 {
 	struct ion_cp_heap *cp_heap =
 		container_of(heap, struct ion_cp_heap, heap);
 
 	if (atomic_dec_and_test(&cp_heap->protect_cnt)) {
-		int error_code = ion_cp_unprotect_mem(
-			cp_heap->secure_base, cp_heap->secure_size,
-			cp_heap->permission_type);
-		if (error_code) {
-			pr_err("Failed to un-protect memory for heap %s - "
-				"error code: %d\n", heap->name, error_code);
-		} else  {
-			cp_heap->heap_protected = HEAP_NOT_PROTECTED;
-			pr_debug("Un-protected heap %s @ 0x%x\n", heap->name,
-				(unsigned int) cp_heap->base);
-
-			if (cp_heap->reusable && !cp_heap->allocated_bytes) {
-				if (fmem_set_state(FMEM_T_STATE) != 0)
-					pr_err("%s: unable to transition heap to T-state",
-						__func__);
-			}
-		}
+		cp_heap->unprotect_pending = 1;
+		schedule_delayed_work(&cp_heap->unprotect_work,
+				      ION_CP_UNPROTECT_DELAY);
 	}
 	pr_debug("%s: protect count is %d\n", __func__,
 		atomic_read(&cp_heap->protect_cnt));
@@ -213,6 +278,9 @@ ion_phys_addr_t ion_cp_allocate(struct ion_heap *heap,
 		container_of(heap, struct ion_cp_heap, heap);
 
 	mutex_lock(&cp_heap->lock);
+	if (!secure_allocation)
+		ion_cp_unprotect_sync(cp_heap);
+
 	if (!secure_allocation && cp_heap->heap_protected == HEAP_PROTECTED) {
 		cp_heap->alloc_fail_count++;
 		mutex_unlock(&cp_heap->lock);
@@ -287,19 +355,12 @@ ion_phys_addr_t ion_cp_allocate(struct ion_heap *heap,
 static void iommu_unmap_all(unsigned long domain_num,
 			    struct ion_cp_heap *cp_heap)
 {
-	unsigned long left_to_unmap = cp_heap->total_size;
-	unsigned long order = get_order(SZ_64K);
-	unsigned long page_size = SZ_64K;
-
 	struct iommu_domain *domain = msm_get_iommu_domain(domain_num);
 	if (domain) {
 		unsigned long temp_iova = cp_heap->iommu_iova[domain_num];
 
-		while (left_to_unmap) {
-			iommu_unmap(domain, temp_iova, order);
-			temp_iova += page_size;
-			left_to_unmap -= page_size;
-		}
+		iommu_unmap_range(domain, temp_iova, cp_heap->total_size);
+		temp_iova += cp_heap->total_size;
 		if (domain_num == cp_heap->iommu_2x_map_domain)
 			msm_iommu_unmap_extra(domain, temp_iova,
 					      cp_heap->total_size, SZ_64K);
@@ -461,6 +522,7 @@ void *ion_cp_heap_map_kernel(struct ion_heap *heap,
 	void *ret_value = NULL;
 
 	mutex_lock(&cp_heap->lock);
+	ion_cp_unprotect_sync(cp_heap);
 	if ((cp_heap->heap_protected == HEAP_NOT_PROTECTED) ||
 	    ((cp_heap->heap_protected == HEAP_PROTECTED) &&
 	      !ION_IS_CACHED(flags))) {
@@ -528,6 +590,7 @@ int ion_cp_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 		container_of(heap, struct ion_cp_heap, heap);
 
 	mutex_lock(&cp_heap->lock);
+	ion_cp_unprotect_sync(cp_heap);
 	if (cp_heap->heap_protected == HEAP_NOT_PROTECTED) {
 		if (ion_cp_request_region(cp_heap)) {
 			mutex_unlock(&cp_heap->lock);
@@ -607,6 +670,7 @@ static int ion_cp_print_debug(struct ion_heap *heap, struct seq_file *s,
 	unsigned long umap_count;
 	unsigned long kmap_count;
 	unsigned long heap_protected;
+	int unprotect_pending;
 	struct ion_cp_heap *cp_heap =
 		container_of(heap, struct ion_cp_heap, heap);
 
@@ -619,6 +683,7 @@ static int ion_cp_print_debug(struct ion_heap *heap, struct seq_file *s,
 	umap_count = cp_heap->umap_count;
 	kmap_count = ion_cp_get_total_kmap_count(cp_heap);
 	heap_protected = cp_heap->heap_protected == HEAP_PROTECTED;
+	unprotect_pending = cp_heap->unprotect_pending;
 	mutex_unlock(&cp_heap->lock);
 
 	seq_printf(s, "total bytes currently allocated: %lx\n", total_alloc);
@@ -629,6 +694,8 @@ static int ion_cp_print_debug(struct ion_heap *heap, struct seq_file *s,
 	seq_printf(s, "umapping count: %lx\n", umap_count);
 	seq_printf(s, "kmapping count: %lx\n", kmap_count);
 	seq_printf(s, "heap protected: %s\n", heap_protected ? "Yes" : "No");
+	seq_printf(s, "unprotect pending: %s\n",
+		   unprotect_pending ? "Yes" : "No");
 	seq_printf(s, "reusable: %s\n", cp_heap->reusable  ? "Yes" : "No");
 
 	if (mem_map) {
@@ -668,6 +735,8 @@ static int ion_cp_print_debug(struct ion_heap *heap, struct seq_file *s,
 			seq_printf(s, "%16.s %14lx %14lx %14lu (%lx)\n", "FREE",
 				last_end, end-1, end-last_end, end-last_end);
 		}
+
+		ion_debug_mem_map_frag(s, mem_map, base, size);
 	}
 
 	return 0;
@@ -706,9 +775,6 @@ int ion_cp_unsecure_heap(struct ion_heap *heap)
 static int iommu_map_all(unsigned long domain_num, struct ion_cp_heap *cp_heap,
 			int partition, unsigned long prot)
 {
-	unsigned long left_to_map = cp_heap->total_size;
-	unsigned long order = get_order(SZ_64K);
-	unsigned long page_size = SZ_64K;
 	int ret_value = 0;
 	unsigned long virt_addr_len = cp_heap->total_size;
 	struct iommu_domain *domain = msm_get_iommu_domain(domain_num);
@@ -728,7 +794,6 @@ static int iommu_map_all(unsigned long domain_num, struct ion_cp_heap *cp_heap,
 		ret_value = -EINVAL;
 	}
 	if (!ret_value && domain) {
-		unsigned long temp_phys = cp_heap->base;
 		unsigned long temp_iova;
 
 		ret_value = msm_allocate_iova_address(domain_num, partition,
@@ -742,19 +807,18 @@ static int iommu_map_all(unsigned long domain_num, struct ion_cp_heap *cp_heap,
 		}
 		cp_heap->iommu_iova[domain_num] = temp_iova;
 
-		while (left_to_map) {
-			int ret = iommu_map(domain, temp_iova, temp_phys,
-					    order, prot);
-			if (ret) {
-				pr_err("%s: could not map %lx in domain %p, error: %d\n",
-					__func__, temp_iova, domain, ret);
-				ret_value = -EAGAIN;
-				goto free_iova;
-			}
-			temp_iova += page_size;
-			temp_phys += page_size;
-			left_to_map -= page_size;
+		/* The heap is contiguous: map it in one go, as 64K pages */
+		ret_value = msm_iommu_map_iova_phys(domain, temp_iova,
+						    cp_heap->base,
+						    cp_heap->total_size,
+						    prot & IOMMU_CACHE);
+		if (ret_value) {
+			pr_err("%s: could not map %lx in domain %p, error: %d\n",
+				__func__, temp_iova, domain, ret_value);
+			ret_value = -EAGAIN;
+			goto free_iova;
 		}
+		temp_iova += cp_heap->total_size;
 		if (domain_num == cp_heap->iommu_2x_map_domain)
 			ret_value = msm_iommu_map_extra(domain, temp_iova,
 							cp_heap->total_size,
@@ -937,6 +1001,7 @@ struct ion_heap *ion_cp_heap_create(struct ion_platform_heap *heap_data)
 		return ERR_PTR(-ENOMEM);
 
 	mutex_init(&cp_heap->lock);
+	INIT_DELAYED_WORK(&cp_heap->unprotect_work, ion_cp_unprotect_worker);
 
 	cp_heap->pool = gen_pool_create(12, -1);
 	if (!cp_heap->pool)
@@ -998,6 +1063,11 @@ void ion_cp_heap_destroy(struct ion_heap *heap)
 	struct ion_cp_heap *cp_heap =
 	     container_of(heap, struct  ion_cp_heap, heap);
 
+	mutex_lock(&cp_heap->lock);
+	ion_cp_unprotect_sync(cp_heap);
+	mutex_unlock(&cp_heap->lock);
+	cancel_delayed_work_sync(&cp_heap->unprotect_work);
+
 	gen_pool_destroy(cp_heap->pool);
 	kfree(cp_heap);
 	cp_heap = NULL;
@@ -34,6 +34,7 @@ struct ion_iommu_heap {
 struct ion_iommu_priv_data {
 	struct page **pages;
 	int nrpages;
+	int nents;
 	unsigned long size;
 	struct scatterlist *iommu_sglist;
 };
@@ -43,7 +44,7 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 				      unsigned long size, unsigned long align,
 				      unsigned long flags)
 {
-	int ret, i;
+	int ret;
 	struct ion_iommu_priv_data *data = NULL;
 
 	if (msm_use_iommu()) {
@@ -66,18 +67,17 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 			goto err1;
 		}
 
-		sg_init_table(data->iommu_sglist, data->nrpages);
-
-		for (i = 0; i < data->nrpages; i++) {
-			data->pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
-			if (!data->pages[i])
-				goto err2;
-
-			sg_set_page(&data->iommu_sglist[i], data->pages[i],
-				    PAGE_SIZE, 0);
+		/*
+		 * Use the largest blocks available so the buffer can be
+		 * mapped with fewer, larger IOMMU entries
+		 */
+		data->nents = ion_page_pool_alloc_sg(data->size, data->pages,
+						     data->iommu_sglist);
+		if (data->nents < 0) {
+			ret = data->nents;
+			goto err2;
 		}
 
-
 		buffer->priv_virt = data;
 		return 0;
 
@@ -89,13 +89,8 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 err2:
 	vfree(data->iommu_sglist);
 	data->iommu_sglist = NULL;
-
-	for (i = 0; i < data->nrpages; i++) {
-		if (data->pages[i])
-			__free_page(data->pages[i]);
-	}
-	kfree(data->pages);
 err1:
+	kfree(data->pages);
 	kfree(data);
 	return ret;
 }
@@ -103,13 +98,11 @@ err1:
 static void ion_iommu_heap_free(struct ion_buffer *buffer)
 {
 	struct ion_iommu_priv_data *data = buffer->priv_virt;
-	int i;
 
 	if (!data)
 		return;
 
-	for (i = 0; i < data->nrpages; i++)
-		__free_page(data->pages[i]);
+	ion_page_pool_free_sg(data->iommu_sglist, data->nents);
 
 	vfree(data->iommu_sglist);
 	data->iommu_sglist = NULL;
@@ -286,12 +279,15 @@ static int ion_iommu_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 
 	if (iommu_heap->has_outer_cache) {
 		unsigned long pstart;
-		unsigned int i;
+		unsigned int i, end;
 		struct ion_iommu_priv_data *data = buffer->priv_virt;
 		if (!data)
 			return -ENOMEM;
 
-		for (i = 0; i < data->nrpages; ++i) {
+		/* Only the pages in the requested range */
+		end = min_t(unsigned int, data->nrpages,
+			    PFN_UP(offset + length));
+		for (i = offset >> PAGE_SHIFT; i < end; ++i) {
 			pstart = page_to_phys(data->pages[i]);
 			outer_cache_op(pstart, pstart + PAGE_SIZE);
 		}
@@ -327,11 +323,18 @@ static struct ion_heap_ops iommu_heap_ops = {
 struct ion_heap *ion_iommu_heap_create(struct ion_platform_heap *heap_data)
 {
 	struct ion_iommu_heap *iommu_heap;
+	int ret;
 
 	iommu_heap = kzalloc(sizeof(struct ion_iommu_heap), GFP_KERNEL);
 	if (!iommu_heap)
 		return ERR_PTR(-ENOMEM);
 
+	ret = ion_page_pool_get();
+	if (ret) {
+		kfree(iommu_heap);
+		return ERR_PTR(ret);
+	}
+
 	iommu_heap->heap.ops = &iommu_heap_ops;
 	iommu_heap->heap.type = ION_HEAP_TYPE_IOMMU;
 	iommu_heap->has_outer_cache = heap_data->has_outer_cache;
@@ -344,6 +347,7 @@ void ion_iommu_heap_destroy(struct ion_heap *heap)
 	struct ion_iommu_heap *iommu_heap =
 	     container_of(heap, struct  ion_iommu_heap, heap);
 
+	ion_page_pool_put();
 	kfree(iommu_heap);
 	iommu_heap = NULL;
 }
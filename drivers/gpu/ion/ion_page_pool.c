@@ -0,0 +1,408 @@
+/*
+ * drivers/gpu/ion/ion_page_pool.c
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/err.h>
+#include <linux/gfp.h>
+#include <linux/highmem.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <asm/cacheflush.h>
+#include <asm/sizes.h>
+#include "ion_priv.h"
+
+/*
+ * The page pools hold blocks of pages that are already zeroed and out of
+ * the CPU caches so a buffer allocation only has to pick them off a list.
+ * Buffers are built from the largest blocks that fit so the IOMMU heap
+ * can map them with 1M and 64K entries. Freed blocks are put on a dirty
+ * list and scrubbed by the ion_page_pool thread before they are reused,
+ * so neither the allocation nor the free path has to zero memory.
+ */
+
+struct ion_page_pool {
+	unsigned int order;
+	unsigned int max;
+	unsigned int count;
+	unsigned int dirty_count;
+	struct list_head items;
+	struct list_head dirty;
+};
+
+/* Don't keep more than this much memory in any single pool */
+#define ION_PAGE_POOL_MAX_BYTES SZ_16M
+
+#define ION_PAGE_POOL(_order) \
+	{ .order = _order, \
+	  .max = ION_PAGE_POOL_MAX_BYTES >> (PAGE_SHIFT + _order) }
+
+/* Keep these sorted from largest to smallest order */
+static struct ion_page_pool ion_page_pools[] = {
+	ION_PAGE_POOL(8),
+	ION_PAGE_POOL(4),
+	ION_PAGE_POOL(0),
+};
+
+/* High order allocations are opportunistic and are allowed to fail fast */
+#define ION_PAGE_POOL_GFP_HIGH (GFP_KERNEL | __GFP_HIGHMEM | __GFP_COMP | \
+	__GFP_NORETRY | __GFP_NOWARN | __GFP_NO_KSWAPD)
+#define ION_PAGE_POOL_GFP_LOW (GFP_KERNEL | __GFP_HIGHMEM)
+
+static DEFINE_SPINLOCK(ion_page_pool_lock);
+static DEFINE_MUTEX(ion_page_pool_users_lock);
+static int ion_page_pool_users;
+static struct task_struct *ion_page_pool_task;
+static DECLARE_WAIT_QUEUE_HEAD(ion_page_pool_wait);
+
+static unsigned int _ion_page_pool_pages(void)
+{
+	unsigned int i, pages = 0;
+
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++) {
+		struct ion_page_pool *pool = &ion_page_pools[i];
+		pages += (pool->count + pool->dirty_count) << pool->order;
+	}
+
+	return pages;
+}
+
+/* Zero a block and push it out of the caches for uncached mappings */
+static void ion_page_pool_scrub(struct page *page, unsigned int order)
+{
+	phys_addr_t paddr = page_to_phys(page);
+	int i;
+
+	for (i = 0; i < (1 << order); i++) {
+		void *ptr = kmap_atomic(page + i);
+		memset(ptr, 0, PAGE_SIZE);
+		dmac_flush_range(ptr, ptr + PAGE_SIZE);
+		kunmap_atomic(ptr);
+	}
+
+	outer_flush_range(paddr, paddr + (PAGE_SIZE << order));
+}
+
+static struct page *ion_page_pool_get_dirty(struct ion_page_pool **pool)
+{
+	struct page *page = NULL;
+	int i;
+
+	spin_lock(&ion_page_pool_lock);
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++) {
+		if (ion_page_pools[i].dirty_count == 0)
+			continue;
+
+		*pool = &ion_page_pools[i];
+		page = list_first_entry(&(*pool)->dirty, struct page, lru);
+		list_del(&page->lru);
+		(*pool)->dirty_count--;
+		break;
+	}
+	spin_unlock(&ion_page_pool_lock);
+
+	return page;
+}
+
+static int ion_page_pool_has_dirty(void)
+{
+	int i, ret = 0;
+
+	spin_lock(&ion_page_pool_lock);
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++)
+		ret |= (ion_page_pools[i].dirty_count != 0);
+	spin_unlock(&ion_page_pool_lock);
+
+	return ret;
+}
+
+static int ion_page_pool_thread(void *data)
+{
+	struct ion_page_pool *pool;
+	struct page *page;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(ion_page_pool_wait,
+			ion_page_pool_has_dirty() || kthread_should_stop());
+
+		while ((page = ion_page_pool_get_dirty(&pool)) != NULL) {
+			ion_page_pool_scrub(page, pool->order);
+
+			spin_lock(&ion_page_pool_lock);
+			list_add_tail(&page->lru, &pool->items);
+			pool->count++;
+			spin_unlock(&ion_page_pool_lock);
+
+			cond_resched();
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * ion_page_pool_alloc() - get a block of pages for an ion buffer
+ * @size: number of bytes still needed by the buffer
+ * @order: set to the order of the returned block
+ *
+ * Returns the largest block from the pool orders that fits in @size,
+ * coming from the pool if one is ready or from the page allocator if
+ * not. Higher order blocks are compound pages. The block is always zeroed
+ * and clean in the CPU caches. Returns NULL if not even a single page
+ * could be allocated.
+ */
+struct page *ion_page_pool_alloc(unsigned long size, unsigned int *order)
+{
+	struct page *page = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++) {
+		struct ion_page_pool *pool = &ion_page_pools[i];
+		gfp_t gfp = pool->order ? ION_PAGE_POOL_GFP_HIGH :
+			ION_PAGE_POOL_GFP_LOW;
+
+		if (size < (PAGE_SIZE << pool->order))
+			continue;
+
+		spin_lock(&ion_page_pool_lock);
+		if (pool->count) {
+			page = list_first_entry(&pool->items, struct page, lru);
+			list_del(&page->lru);
+			pool->count--;
+		}
+		spin_unlock(&ion_page_pool_lock);
+
+		if (page == NULL) {
+			page = alloc_pages(gfp, pool->order);
+			if (page != NULL)
+				ion_page_pool_scrub(page, pool->order);
+		}
+
+		if (page != NULL) {
+			*order = pool->order;
+			break;
+		}
+	}
+
+	return page;
+}
+
+/**
+ * ion_page_pool_free() - give back a block from ion_page_pool_alloc()
+ * @page: first page of the block
+ * @order: order of the block
+ *
+ * The block is queued for the pool thread to scrub, or goes straight back
+ * to the page allocator if the pool for @order is full or the block is
+ * still referenced elsewhere.
+ */
+void ion_page_pool_free(struct page *page, unsigned int order)
+{
+	struct ion_page_pool *pool = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++) {
+		if (ion_page_pools[i].order == order)
+			pool = &ion_page_pools[i];
+	}
+
+	/* Don't recycle a block that someone else still holds on to */
+	if (pool != NULL && page_count(page) == 1) {
+		spin_lock(&ion_page_pool_lock);
+		if (pool->count + pool->dirty_count < pool->max) {
+			list_add_tail(&page->lru, &pool->dirty);
+			pool->dirty_count++;
+			page = NULL;
+		}
+		spin_unlock(&ion_page_pool_lock);
+	}
+
+	if (page != NULL)
+		__free_pages(page, order);
+	else
+		wake_up(&ion_page_pool_wait);
+}
+
+/**
+ * ion_page_pool_alloc_sg() - fill a buffer with blocks from the pools
+ * @size: size of the buffer in bytes, a multiple of PAGE_SIZE
+ * @pages: array of size >> PAGE_SHIFT entries to fill with every page
+ * @sglist: scatterlist of size >> PAGE_SHIFT entries
+ *
+ * Each block gets one entry in @sglist and the end is marked after the
+ * last one used. Returns the number of scatterlist entries used or
+ * -ENOMEM, in which case everything already allocated has been freed.
+ */
+int ion_page_pool_alloc_sg(unsigned long size, struct page **pages,
+			   struct scatterlist *sglist)
+{
+	unsigned long remaining = size;
+	int npages = 0, nents = 0;
+	unsigned int order;
+	struct page *page;
+	int i;
+
+	sg_init_table(sglist, size >> PAGE_SHIFT);
+
+	while (remaining) {
+		page = ion_page_pool_alloc(remaining, &order);
+		if (page == NULL) {
+			ion_page_pool_free_sg(sglist, nents);
+			return -ENOMEM;
+		}
+
+		for (i = 0; i < (1 << order); i++)
+			pages[npages++] = page + i;
+
+		sg_set_page(&sglist[nents++], page, PAGE_SIZE << order, 0);
+		remaining -= PAGE_SIZE << order;
+	}
+
+	sg_mark_end(&sglist[nents - 1]);
+	return nents;
+}
+
+/**
+ * ion_page_pool_free_sg() - free a buffer built by ion_page_pool_alloc_sg()
+ * @sglist: the scatterlist of the buffer
+ * @nents: the number of entries that were used
+ */
+void ion_page_pool_free_sg(struct scatterlist *sglist, int nents)
+{
+	int i;
+
+	for (i = 0; i < nents; i++)
+		ion_page_pool_free(sg_page(&sglist[i]),
+			get_order(sglist[i].length));
+}
+
+/* Give back at most nr_pages pages, dirty and small blocks go first */
+static void _ion_page_pool_drain(long nr_pages)
+{
+	struct page *page;
+	int i;
+
+	for (i = ARRAY_SIZE(ion_page_pools) - 1; i >= 0; i--) {
+		struct ion_page_pool *pool = &ion_page_pools[i];
+
+		while (nr_pages > 0 && pool->dirty_count) {
+			page = list_first_entry(&pool->dirty, struct page, lru);
+			list_del(&page->lru);
+			pool->dirty_count--;
+			__free_pages(page, pool->order);
+			nr_pages -= 1 << pool->order;
+		}
+	}
+
+	for (i = ARRAY_SIZE(ion_page_pools) - 1; i >= 0; i--) {
+		struct ion_page_pool *pool = &ion_page_pools[i];
+
+		while (nr_pages > 0 && pool->count) {
+			page = list_first_entry(&pool->items, struct page, lru);
+			list_del(&page->lru);
+			pool->count--;
+			__free_pages(page, pool->order);
+			nr_pages -= 1 << pool->order;
+		}
+	}
+}
+
+static int ion_page_pool_shrink(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	int pages;
+
+	spin_lock(&ion_page_pool_lock);
+	if (sc->nr_to_scan)
+		_ion_page_pool_drain(sc->nr_to_scan);
+	pages = _ion_page_pool_pages();
+	spin_unlock(&ion_page_pool_lock);
+
+	return pages;
+}
+
+static struct shrinker ion_page_pool_shrinker = {
+	.shrink = ion_page_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+/**
+ * ion_page_pool_get() - take a reference on the page pools
+ *
+ * The first user starts the pool thread and registers the shrinker.
+ */
+int ion_page_pool_get(void)
+{
+	int i, ret = 0;
+
+	mutex_lock(&ion_page_pool_users_lock);
+	if (ion_page_pool_users++)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(ion_page_pools); i++) {
+		INIT_LIST_HEAD(&ion_page_pools[i].items);
+		INIT_LIST_HEAD(&ion_page_pools[i].dirty);
+	}
+
+	ion_page_pool_task = kthread_run(ion_page_pool_thread, NULL,
+					 "ion_page_pool");
+	if (IS_ERR(ion_page_pool_task)) {
+		ret = PTR_ERR(ion_page_pool_task);
+		ion_page_pool_task = NULL;
+		ion_page_pool_users--;
+		goto out;
+	}
+
+	register_shrinker(&ion_page_pool_shrinker);
+out:
+	mutex_unlock(&ion_page_pool_users_lock);
+	return ret;
+}
+
+/**
+ * ion_page_pool_put() - drop a reference on the page pools
+ *
+ * The last user stops the thread and frees everything left in the pools.
+ */
+void ion_page_pool_put(void)
+{
+	mutex_lock(&ion_page_pool_users_lock);
+	if (--ion_page_pool_users == 0) {
+		unregister_shrinker(&ion_page_pool_shrinker);
+		kthread_stop(ion_page_pool_task);
+		ion_page_pool_task = NULL;
+
+		spin_lock(&ion_page_pool_lock);
+		_ion_page_pool_drain(LONG_MAX);
+		spin_unlock(&ion_page_pool_lock);
+	}
+	mutex_unlock(&ion_page_pool_users_lock);
+}
+
+/**
+ * ion_page_pool_size() - number of bytes held by the pools
+ */
+unsigned long ion_page_pool_size(void)
+{
+	unsigned int pages;
+
+	spin_lock(&ion_page_pool_lock);
+	pages = _ion_page_pool_pages();
+	spin_unlock(&ion_page_pool_lock);
+
+	return (unsigned long) pages << PAGE_SHIFT;
+}
@@ -54,6 +54,8 @@ enum {
  * @mapped_size - size of the iova space mapped
  *		(may not be the same as the buffer size)
  * @flags - iommu domain/partition specific flags.
+ * @idle_node - on the device list of idle mappings while nobody has the
+ *		mapping but the buffer still exists
  *
  * Represents a mapping of one ion buffer to a particular iommu domain
  * and address range. There may exist other mappings of this buffer in
@@ -71,6 +73,7 @@ struct ion_iommu_map {
 	struct kref ref;
 	int mapped_size;
 	unsigned long flags;
+	struct list_head idle_node;
 };
 
 struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
@@ -92,6 +95,10 @@ struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
  * @vaddr:		the kenrel mapping if kmap_cnt is not zero
  * @dmap_cnt:		number of times the buffer is mapped for dma
  * @sglist:		the scatterlist for the buffer is dmap_cnt is not zero
+ * @uwmap_cnt:		number of writable userspace mappings of the buffer
+ * @cpu_dirty:		the CPU may have dirty lines for the buffer in its
+ *			caches, cleared by a clean of the whole buffer while
+ *			there are no writable CPU mappings
 */
 struct ion_buffer {
 	struct kref ref;
@@ -110,6 +117,8 @@ struct ion_buffer {
 	int dmap_cnt;
 	struct scatterlist *sglist;
 	int umap_cnt;
+	int uwmap_cnt;
+	int cpu_dirty;
 	unsigned int iommu_map_cnt;
 	struct rb_root iommu_maps;
 	int marked;
@@ -314,9 +323,24 @@ int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 			void *uaddr, unsigned long offset, unsigned long len,
 			unsigned int cmd);
 
+/**
+ * page pools shared by the heaps that are built from system pages
+ */
+int ion_page_pool_get(void);
+void ion_page_pool_put(void);
+struct page *ion_page_pool_alloc(unsigned long size, unsigned int *order);
+void ion_page_pool_free(struct page *page, unsigned int order);
+int ion_page_pool_alloc_sg(unsigned long size, struct page **pages,
+			   struct scatterlist *sglist);
+void ion_page_pool_free_sg(struct scatterlist *sglist, int nents);
+unsigned long ion_page_pool_size(void);
+
 void ion_cp_heap_get_base(struct ion_heap *heap, unsigned long *base,
 			unsigned long *size);
 
 void ion_mem_map_show(struct ion_heap *heap);
 
+void ion_debug_mem_map_frag(struct seq_file *s, const struct rb_root *mem_map,
+			    unsigned long base, unsigned long size);
+
 #endif /* _ION_PRIV_H */
@@ -18,6 +18,7 @@
 #include <linux/err.h>
 #include <linux/ion.h>
 #include <linux/mm.h>
+#include <linux/pfn.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
@@ -33,67 +34,89 @@ static atomic_t system_contig_heap_allocated;
 static unsigned int system_heap_has_outer_cache;
 static unsigned int system_heap_contig_has_outer_cache;
 
+struct ion_system_buffer_info {
+	struct page **pages;
+	int nrpages;
+	int nents;
+	struct scatterlist *sglist;
+};
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
 				     unsigned long flags)
 {
-	buffer->priv_virt = vmalloc_user(size);
-	if (!buffer->priv_virt)
+	struct ion_system_buffer_info *info;
+	int ret = -ENOMEM;
+
+	info = kmalloc(sizeof(*info), GFP_KERNEL);
+	if (!info)
 		return -ENOMEM;
 
+	info->nrpages = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	info->pages = kzalloc(sizeof(struct page *) * info->nrpages,
+			GFP_KERNEL);
+	if (!info->pages)
+		goto err1;
+
+	info->sglist = vmalloc(sizeof(*info->sglist) * info->nrpages);
+	if (!info->sglist)
+		goto err2;
+
+	info->nents = ion_page_pool_alloc_sg(PAGE_ALIGN(size), info->pages,
+					     info->sglist);
+	if (info->nents < 0) {
+		ret = info->nents;
+		goto err3;
+	}
+
+	buffer->priv_virt = info;
 	atomic_add(size, &system_heap_allocated);
 	return 0;
+
+err3:
+	vfree(info->sglist);
+err2:
+	kfree(info->pages);
+err1:
+	kfree(info);
+	return ret;
 }
 
 void ion_system_heap_free(struct ion_buffer *buffer)
 {
-	vfree(buffer->priv_virt);
+	struct ion_system_buffer_info *info = buffer->priv_virt;
+
+	ion_page_pool_free_sg(info->sglist, info->nents);
+	vfree(info->sglist);
+	kfree(info->pages);
+	kfree(info);
 	atomic_sub(buffer->size, &system_heap_allocated);
 }
 
 struct scatterlist *ion_system_heap_map_dma(struct ion_heap *heap,
 					    struct ion_buffer *buffer)
 {
-	struct scatterlist *sglist;
-	struct page *page;
-	int i;
-	int npages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
-	void *vaddr = buffer->priv_virt;
+	struct ion_system_buffer_info *info = buffer->priv_virt;
 
-	sglist = vmalloc(npages * sizeof(struct scatterlist));
-	if (!sglist)
-		return ERR_PTR(-ENOMEM);
-	memset(sglist, 0, npages * sizeof(struct scatterlist));
-	sg_init_table(sglist, npages);
-	for (i = 0; i < npages; i++) {
-		page = vmalloc_to_page(vaddr);
-		if (!page)
-			goto end;
-		sg_set_page(&sglist[i], page, PAGE_SIZE, 0);
-		vaddr += PAGE_SIZE;
-	}
 	/* XXX do cache maintenance for dma? */
-	return sglist;
-end:
-	vfree(sglist);
-	return NULL;
+	return info->sglist;
 }
 
 void ion_system_heap_unmap_dma(struct ion_heap *heap,
 			       struct ion_buffer *buffer)
 {
 	/* XXX undo cache maintenance for dma? */
-	if (buffer->sglist)
-		vfree(buffer->sglist);
 }
 
 void *ion_system_heap_map_kernel(struct ion_heap *heap,
 				 struct ion_buffer *buffer,
 				 unsigned long flags)
 {
+	struct ion_system_buffer_info *info = buffer->priv_virt;
+
 	if (ION_IS_CACHED(flags))
-		return buffer->priv_virt;
+		return vmap(info->pages, info->nrpages, VM_MAP, PAGE_KERNEL);
 	else {
 		pr_err("%s: cannot map system heap uncached\n", __func__);
 		return ERR_PTR(-EINVAL);
@@ -103,6 +126,7 @@ void *ion_system_heap_map_kernel(struct ion_heap *heap,
 void ion_system_heap_unmap_kernel(struct ion_heap *heap,
 				  struct ion_buffer *buffer)
 {
+	vunmap(buffer->vaddr);
 }
 
 void ion_system_heap_unmap_iommu(struct ion_iommu_map *data)
@@ -134,13 +158,22 @@ void ion_system_heap_unmap_iommu(struct ion_iommu_map *data)
 int ion_system_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 			     struct vm_area_struct *vma, unsigned long flags)
 {
-	if (ION_IS_CACHED(flags))
-		return remap_vmalloc_range(vma, buffer->priv_virt,
-						vma->vm_pgoff);
-	else {
+	struct ion_system_buffer_info *info = buffer->priv_virt;
+	unsigned long curr_addr = vma->vm_start;
+	int i;
+
+	if (!ION_IS_CACHED(flags)) {
 		pr_err("%s: cannot map system heap uncached\n", __func__);
 		return -EINVAL;
 	}
+
+	for (i = vma->vm_pgoff; i < info->nrpages && curr_addr < vma->vm_end;
+	     i++) {
+		if (vm_insert_page(vma, curr_addr, info->pages[i]))
+			return -EINVAL;
+		curr_addr += PAGE_SIZE;
+	}
+	return 0;
 }
 
 int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
@@ -167,17 +200,12 @@ int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 	}
 
 	if (system_heap_has_outer_cache) {
+		struct ion_system_buffer_info *info = buffer->priv_virt;
 		unsigned long pstart;
-		void *vend;
-		void *vtemp;
-		unsigned long ln = 0;
-		vend = buffer->priv_virt + buffer->size;
-		vtemp = buffer->priv_virt + offset;
+		unsigned int i, end;
 
-		if ((vtemp+length) > vend) {
+		if (offset + length > buffer->size) {
 			pr_err("Trying to flush outside of mapped range.\n");
-			pr_err("End of mapped range: %p, trying to flush to "
-				"address %p\n", vend, vtemp+length);
 			WARN(1, "%s: called with heap name %s, buffer size 0x%x, "
 				"vaddr 0x%p, offset 0x%x, length: 0x%x\n",
 				__func__, heap->name, buffer->size, vaddr,
@@ -185,25 +213,10 @@ int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 			return -EINVAL;
 		}
 
-		for (; ln < length && vtemp < vend;
-		      vtemp += PAGE_SIZE, ln += PAGE_SIZE) {
-			struct page *page = vmalloc_to_page(vtemp);
-			if (!page) {
-				WARN(1, "Could not find page for virt. address %p\n",
-					vtemp);
-				return -EINVAL;
-			}
-			pstart = page_to_phys(page);
-			/*
-			 * If page -> phys is returning NULL, something
-			 * has really gone wrong...
-			 */
-			if (!pstart) {
-				WARN(1, "Could not translate %p to physical address\n",
-					vtemp);
-				return -EINVAL;
-			}
-
+		end = min_t(unsigned int, info->nrpages,
+			    PFN_UP(offset + length));
+		for (i = offset >> PAGE_SHIFT; i < end; i++) {
+			pstart = page_to_phys(info->pages[i]);
 			outer_cache_op(pstart, pstart + PAGE_SIZE);
 		}
 	}
@@ -215,6 +228,8 @@ static int ion_system_print_debug(struct ion_heap *heap, struct seq_file *s,
 {
 	seq_printf(s, "total bytes currently allocated: %lx\n",
 			(unsigned long) atomic_read(&system_heap_allocated));
+	seq_printf(s, "total bytes held in page pools: %lx\n",
+			ion_page_pool_size());
 
 	return 0;
 }
@@ -227,14 +242,11 @@ int ion_system_heap_map_iommu(struct ion_buffer *buffer,
 				unsigned long iova_length,
 				unsigned long flags)
 {
-	int ret = 0, i;
+	int ret = 0;
 	struct iommu_domain *domain;
 	unsigned long extra;
 	unsigned long extra_iova_addr;
-	struct page *page;
-	int npages = buffer->size >> PAGE_SHIFT;
-	void *vaddr = buffer->priv_virt;
-	struct scatterlist *sglist = 0;
+	struct ion_system_buffer_info *info = buffer->priv_virt;
 	int prot = IOMMU_WRITE | IOMMU_READ;
 	prot |= ION_IS_CACHED(flags) ? IOMMU_CACHE : 0;
 
@@ -261,23 +273,7 @@ int ion_system_heap_map_iommu(struct ion_buffer *buffer,
 		goto out1;
 	}
 
-
-	sglist = vmalloc(sizeof(*sglist) * npages);
-	if (!sglist) {
-		ret = -ENOMEM;
-		goto out1;
-	}
-
-	sg_init_table(sglist, npages);
-	for (i = 0; i < npages; i++) {
-		page = vmalloc_to_page(vaddr);
-		if (!page)
-			goto out1;
-		sg_set_page(&sglist[i], page, PAGE_SIZE, 0);
-		vaddr += PAGE_SIZE;
-	}
-
-	ret = iommu_map_range(domain, data->iova_addr, sglist,
+	ret = iommu_map_range(domain, data->iova_addr, info->sglist,
 			      buffer->size, prot);
 
 	if (ret) {
@@ -293,13 +289,11 @@ int ion_system_heap_map_iommu(struct ion_buffer *buffer,
 		if (ret)
 			goto out2;
 	}
-	vfree(sglist);
 	return ret;
 
 out2:
 	iommu_unmap_range(domain, data->iova_addr, buffer->size);
 out1:
-	vfree(sglist);
 	msm_free_iova_address(data->iova_addr, domain_num, partition_num,
 				data->mapped_size);
 out:
@@ -323,10 +317,18 @@ static struct ion_heap_ops vmalloc_ops = {
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *pheap)
 {
 	struct ion_heap *heap;
+	int ret;
 
 	heap = kzalloc(sizeof(struct ion_heap), GFP_KERNEL);
 	if (!heap)
 		return ERR_PTR(-ENOMEM);
+
+	ret = ion_page_pool_get();
+	if (ret) {
+		kfree(heap);
+		return ERR_PTR(ret);
+	}
+
 	heap->ops = &vmalloc_ops;
 	heap->type = ION_HEAP_TYPE_SYSTEM;
 	system_heap_has_outer_cache = pheap->has_outer_cache;
@@ -335,6 +337,7 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *pheap)
 
 void ion_system_heap_destroy(struct ion_heap *heap)
 {
+	ion_page_pool_put();
 	kfree(heap);
 }
 
@@ -357,6 +360,23 @@ void ion_system_contig_heap_free(struct ion_buffer *buffer)
 	atomic_sub(buffer->size, &system_contig_heap_allocated);
 }
 
+void *ion_system_contig_heap_map_kernel(struct ion_heap *heap,
+					struct ion_buffer *buffer,
+					unsigned long flags)
+{
+	if (ION_IS_CACHED(flags))
+		return buffer->priv_virt;
+	else {
+		pr_err("%s: cannot map system heap uncached\n", __func__);
+		return ERR_PTR(-EINVAL);
+	}
+}
+
+void ion_system_contig_heap_unmap_kernel(struct ion_heap *heap,
+					 struct ion_buffer *buffer)
+{
+}
+
 static int ion_system_contig_heap_phys(struct ion_heap *heap,
 				       struct ion_buffer *buffer,
 				       ion_phys_addr_t *addr, size_t *len)
@@ -379,6 +399,13 @@ struct scatterlist *ion_system_contig_heap_map_dma(struct ion_heap *heap,
 	return sglist;
 }
 
+void ion_system_contig_heap_unmap_dma(struct ion_heap *heap,
+				      struct ion_buffer *buffer)
+{
+	if (buffer->sglist)
+		vfree(buffer->sglist);
+}
+
 int ion_system_contig_heap_map_user(struct ion_heap *heap,
 				    struct ion_buffer *buffer,
 				    struct vm_area_struct *vma,
@@ -430,7 +457,7 @@ int ion_system_contig_heap_cache_ops(struct ion_heap *heap,
 			return -EINVAL;
 		}
 
-		outer_cache_op(pstart, pstart + PAGE_SIZE);
+		outer_cache_op(pstart, pstart + length);
 	}
 
 	return 0;
@@ -528,9 +555,9 @@ static struct ion_heap_ops kmalloc_ops = {
 	.free = ion_system_contig_heap_free,
 	.phys = ion_system_contig_heap_phys,
 	.map_dma = ion_system_contig_heap_map_dma,
-	.unmap_dma = ion_system_heap_unmap_dma,
-	.map_kernel = ion_system_heap_map_kernel,
-	.unmap_kernel = ion_system_heap_unmap_kernel,
+	.unmap_dma = ion_system_contig_heap_unmap_dma,
+	.map_kernel = ion_system_contig_heap_map_kernel,
+	.unmap_kernel = ion_system_contig_heap_unmap_kernel,
 	.map_user = ion_system_contig_heap_map_user,
 	.cache_op = ion_system_contig_heap_cache_ops,
 	.print_debug = ion_system_contig_print_debug,
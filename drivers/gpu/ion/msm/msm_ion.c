@@ -50,6 +50,15 @@ int msm_ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 }
 EXPORT_SYMBOL(msm_ion_do_cache_op);
 
+int msm_ion_do_cache_range_op(struct ion_client *client,
+			struct ion_handle *handle, void *vaddr,
+			unsigned long offset, unsigned long len,
+			unsigned int cmd)
+{
+	return ion_do_cache_op(client, handle, vaddr, offset, len, cmd);
+}
+EXPORT_SYMBOL(msm_ion_do_cache_range_op);
+
 static unsigned long msm_ion_get_base(unsigned long size, int memory_type,
 				    unsigned int align)
 {
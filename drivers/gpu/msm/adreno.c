@@ -109,6 +109,7 @@ static struct adreno_device device_3d0 = {
 	.pm4_fw = NULL,
 	.wait_timeout = 0, /* in milliseconds, 0 means disabled */
 	.ib_check_level = 0,
+	.throttle_depth = 2,
 };
 
 /* This set of registers are used for Hang detection
@@ -275,6 +276,13 @@ static void adreno_iommu_setstate(struct kgsl_device *device,
 	struct kgsl_context *context;
 	struct adreno_context *adreno_ctx = NULL;
 
+	/*
+	 * Nothing to do if the pagetable is current and the TLB is clean,
+	 * don't turn on the IOMMU clocks and queue bank switches for it
+	 */
+	if (!(flags & (KGSL_MMUFLAGS_PTUPDATE | KGSL_MMUFLAGS_TLBFLUSH)))
+		return;
+
 	if (!adreno_dev->drawctxt_active)
 		return kgsl_mmu_device_setstate(&device->mmu, flags);
 	num_iommu_units = kgsl_mmu_get_reg_map_desc(&device->mmu,
@@ -436,6 +444,9 @@ static void adreno_gpummu_setstate(struct kgsl_device *device,
 	 */
 	if (adreno_is_a20x(adreno_dev))
 		flags |= KGSL_MMUFLAGS_TLBFLUSH;
+
+	if (!(flags & (KGSL_MMUFLAGS_PTUPDATE | KGSL_MMUFLAGS_TLBFLUSH)))
+		return;
 	/*
 	 * If possible, then set the state via the command stream to avoid
 	 * a CPU idle.  Otherwise, use the default setstate which uses register
@@ -1649,6 +1660,42 @@ unlock:
 	return status;
 }
 
+/*
+ * Wait condition for timestamp waiters.  Every interrupt wakes all of
+ * them, so first check without the device mutex whether the timestamp
+ * has retired or an interrupt is already armed for it; only arming the
+ * interrupt needs the mutex.  context_id was looked up by the caller
+ * while it still held the mutex.
+ */
+static int kgsl_check_interrupt_timestamp_fast(struct kgsl_device *device,
+		struct kgsl_context *context, unsigned int context_id,
+		unsigned int timestamp)
+{
+	unsigned int ts_retired, ref_ts, enableflag;
+
+	if (context && context->id == KGSL_CONTEXT_INVALID)
+		goto slow;
+
+	kgsl_sharedmem_readl(&device->memstore, &ts_retired,
+		KGSL_MEMSTORE_OFFSET(context_id, eoptimestamp));
+	rmb();
+	if (timestamp_cmp(ts_retired, timestamp) >= 0)
+		return 1;
+
+	kgsl_sharedmem_readl(&device->memstore, &enableflag,
+		KGSL_MEMSTORE_OFFSET(context_id, ts_cmp_enable));
+	rmb();
+	if (enableflag) {
+		kgsl_sharedmem_readl(&device->memstore, &ref_ts,
+			KGSL_MEMSTORE_OFFSET(context_id, ref_wait_ts));
+		rmb();
+		if (timestamp_cmp(ref_ts, timestamp) <= 0)
+			return 0;
+	}
+slow:
+	return kgsl_check_interrupt_timestamp(device, context, timestamp);
+}
+
 /*
  wait_event_interruptible_timeout checks for the exit condition before
  placing a process in wait q. For conditional interrupts we expect the
@@ -1773,8 +1820,8 @@ static int adreno_waittimestamp(struct kgsl_device *device,
 		 */
 		status = kgsl_wait_event_interruptible_timeout(
 				device->wait_queue,
-				kgsl_check_interrupt_timestamp(device,
-					context, timestamp),
+				kgsl_check_interrupt_timestamp_fast(device,
+					context, context_id, timestamp),
 				msecs_to_jiffies(wait), io);
 
 		mutex_lock(&device->mutex);
@@ -1821,6 +1868,72 @@ done:
 	return (int)status;
 }
 
+/*
+ * How long after its last submission a high priority context is treated
+ * as active, and the longest a normal context is held back for it.
+ */
+#define ADRENO_HIPRI_WINDOW	(HZ / 10)
+#define ADRENO_THROTTLE_TIMEOUT	50	/* msecs */
+
+/**
+ * adreno_throttle_context - hold back a normal priority submission
+ * @device - KGSL device the context submits to
+ * @context - KGSL context about to submit
+ *
+ * There is a single ringbuffer and the CP runs it in order, so anything
+ * queued ahead of a high priority context (the compositor) delays it.
+ * While a high priority context is active, keep normal contexts from
+ * running more than throttle_depth submissions ahead of the GPU so that
+ * high priority work only ever waits behind a few IBs.
+ *
+ * Must be called with the device mutex held; may drop it while waiting.
+ * Returns 0 if the context can submit or -EINVAL if it was detached.
+ */
+int adreno_throttle_context(struct kgsl_device *device,
+			    struct kgsl_context *context)
+{
+	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
+	struct adreno_context *drawctxt = context->devctxt;
+	unsigned int context_id, timestamp;
+	long status;
+
+	if (drawctxt->flags & CTXT_FLAGS_HIGH_PRIORITY) {
+		adreno_dev->hipri_jiffies = jiffies;
+		return 0;
+	}
+
+	if (!adreno_dev->throttle_depth || time_after(jiffies,
+			adreno_dev->hipri_jiffies + ADRENO_HIPRI_WINDOW))
+		return 0;
+
+	/*
+	 * Per context timestamps count this context's submissions only.
+	 * Otherwise only this context's last global timestamp is known, so
+	 * wait for that one.
+	 */
+	context_id = _get_context_id(context);
+	if (context_id == KGSL_MEMSTORE_GLOBAL)
+		timestamp = adreno_dev->ringbuffer.timestamp[context->id];
+	else
+		timestamp = adreno_dev->ringbuffer.timestamp[context_id] -
+			(adreno_dev->throttle_depth - 1);
+
+	if (kgsl_check_timestamp(device, context, timestamp))
+		return 0;
+
+	kref_get(&context->refcount);
+	mutex_unlock(&device->mutex);
+	status = kgsl_wait_event_interruptible_timeout(device->wait_queue,
+			kgsl_check_interrupt_timestamp_fast(device, context,
+				context_id, timestamp),
+			msecs_to_jiffies(ADRENO_THROTTLE_TIMEOUT), 1);
+	mutex_lock(&device->mutex);
+
+	status = (context->id == KGSL_CONTEXT_INVALID) ? -EINVAL : 0;
+	kgsl_context_put(context);
+	return status;
+}
+
 static unsigned int adreno_readtimestamp(struct kgsl_device *device,
 		struct kgsl_context *context, enum kgsl_timestamp_type type)
 {
@@ -1976,6 +2089,7 @@ static const struct kgsl_functable adreno_functable = {
 	.drawctxt_create = adreno_drawctxt_create,
 	.drawctxt_destroy = adreno_drawctxt_destroy,
 	.setproperty = adreno_setproperty,
+	.snapshot_deferred = adreno_snapshot_deferred,
 };
 
 static struct platform_device_id adreno_id_table[] = {
@@ -88,6 +88,10 @@ struct adreno_device {
 	unsigned int instruction_size;
 	unsigned int ib_check_level;
 	unsigned int fast_hang_detect;
+	/* max unretired submissions per normal context while throttled */
+	unsigned int throttle_depth;
+	/* jiffies of the last high priority submission */
+	unsigned long hipri_jiffies;
 };
 
 struct adreno_gpudev {
@@ -177,9 +181,14 @@ struct kgsl_memdesc *adreno_find_ctxtmem(struct kgsl_device *device,
 
 void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 		int hang);
+void *adreno_snapshot_deferred(struct kgsl_device *device, void *snapshot,
+		int *remain);
 
 int adreno_dump_and_recover(struct kgsl_device *device);
 
+int adreno_throttle_context(struct kgsl_device *device,
+			    struct kgsl_context *context);
+
 unsigned int adreno_hang_detect(struct kgsl_device *device,
 						unsigned int *prev_reg_val);
 
@@ -115,6 +115,8 @@ void adreno_debugfs_init(struct kgsl_device *device)
 		&adreno_dev->wait_timeout);
 	debugfs_create_u32("ib_check", 0644, device->d_debugfs,
 			   &adreno_dev->ib_check_level);
+	debugfs_create_u32("throttle_depth", 0644, device->d_debugfs,
+			   &adreno_dev->throttle_depth);
 
 	/* By Default enable fast hang detection */
 	adreno_dev->fast_hang_detect = 1;
@@ -46,6 +46,8 @@
 #define CTXT_FLAGS_PER_CONTEXT_TS	0x00040000
 /* Context has caused a GPU hang and recovered properly */
 #define CTXT_FLAGS_GPU_HANG_RECOVERED	0x00008000
+/* Submissions from this context are not throttled */
+#define CTXT_FLAGS_HIGH_PRIORITY	0x00080000
 
 struct kgsl_device;
 struct adreno_device;
@@ -14,6 +14,8 @@
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/log2.h>
+#include <linux/frame_trace.h>
+#include <trace/events/frame.h>
 
 #include "kgsl.h"
 #include "kgsl_sharedmem.h"
@@ -678,6 +680,32 @@ adreno_ringbuffer_issuecmds(struct kgsl_device *device,
 static bool _parse_ibs(struct kgsl_device_private *dev_priv, uint gpuaddr,
 			   int sizedwords);
 
+/*
+ * IBs that already passed the checker during the current submission.
+ * Command streams tend to call the same state IBs over and over, there is
+ * no point in walking them again. Like the recursion level in _parse_ibs()
+ * this relies on submissions being serialized by the device mutex.
+ */
+#define IB_PARSE_CACHE_SIZE 32
+
+static struct {
+	uint gpuaddr;
+	int sizedwords;
+} ib_parse_cache[IB_PARSE_CACHE_SIZE];
+static int ib_parse_cache_count;
+
+static bool _ib_parse_cached(uint gpuaddr, int sizedwords)
+{
+	int i;
+
+	for (i = 0; i < ib_parse_cache_count; i++)
+		if (ib_parse_cache[i].gpuaddr == gpuaddr &&
+			ib_parse_cache[i].sizedwords == sizedwords)
+			return true;
+
+	return false;
+}
+
 static bool
 _handle_type3(struct kgsl_device_private *dev_priv, uint *hostaddr)
 {
@@ -766,6 +794,9 @@ static bool _parse_ibs(struct kgsl_device_private *dev_priv,
 					 buffer */
 	struct kgsl_mem_entry *entry;
 
+	if (_ib_parse_cached(gpuaddr, sizedwords))
+		return true;
+
 	spin_lock(&dev_priv->process_priv->mem_lock);
 	entry = kgsl_sharedmem_find_region(dev_priv->process_priv,
 					   gpuaddr, sizedwords * sizeof(uint));
@@ -856,6 +887,12 @@ static bool _parse_ibs(struct kgsl_device_private *dev_priv,
 	}
 
 	ret = true;
+
+	if (ib_parse_cache_count < IB_PARSE_CACHE_SIZE) {
+		ib_parse_cache[ib_parse_cache_count].gpuaddr = gpuaddr;
+		ib_parse_cache[ib_parse_cache_count].sizedwords = sizedwords;
+		ib_parse_cache_count++;
+	}
 done:
 	if (!ret)
 		KGSL_DRV_ERR(dev_priv->device,
@@ -889,6 +926,14 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 	      context == NULL || ibdesc == 0 || numibs == 0)
 		return -EINVAL;
 
+	if (adreno_throttle_context(device, context))
+		return -EINVAL;
+	/* the device may have hung while the mutex was dropped */
+	if (device->state & KGSL_STATE_HUNG)
+		return -EBUSY;
+	if (!(adreno_dev->ringbuffer.flags & KGSL_FLAGS_STARTED))
+		return -EINVAL;
+
 	drawctxt = context->devctxt;
 
 	if (drawctxt->flags & CTXT_FLAGS_GPU_HANG) {
@@ -924,6 +969,8 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 		*cmds++ = ibdesc[0].gpuaddr;
 		*cmds++ = ibdesc[0].sizedwords;
 	}
+	ib_parse_cache_count = 0;
+
 	for (i = start_index; i < numibs; i++) {
 		if (unlikely(adreno_dev->ib_check_level >= 1 &&
 		    !_parse_ibs(dev_priv, ibdesc[i].gpuaddr,
@@ -951,6 +998,7 @@ adreno_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 
 	KGSL_CMD_INFO(device, "ctxt %d g %08x numibs %d ts %d\n",
 		context->id, (unsigned int)ibdesc, numibs, *timestamp);
+	trace_frame_gpu_submit(frame_trace_gpu(), context->id, *timestamp);
 
 	kfree(link);
 
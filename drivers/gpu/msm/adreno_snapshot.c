@@ -42,6 +42,39 @@ static struct kgsl_snapshot_obj {
 /* Pointer to the next open entry in the object list */
 static int objbufptr;
 
+/*
+ * IBs found in the ringbuffer while the GPU is stopped. They are parsed and
+ * copied later by adreno_snapshot_deferred() so recovery doesn't have to
+ * wait for it.
+ */
+static struct {
+	uint32_t ptbase;
+	uint32_t gpuaddr;
+	int dwords;
+	int section;	/* 1 to dump the IB in its own snapshot section */
+} deferred_ibs[SNAPSHOT_OBJ_BUFSIZE];
+static int deferred_ibsptr;
+static int deferred_pending;
+
+/* The IB registers as they were when the GPU hung */
+static uint32_t deferred_ptbase;
+static unsigned int deferred_ib1base, deferred_ib1size;
+static unsigned int deferred_ib2base, deferred_ib2size;
+
+static void defer_ib(struct kgsl_device *device, uint32_t ptbase,
+	uint32_t gpuaddr, int dwords, int section)
+{
+	if (deferred_ibsptr == SNAPSHOT_OBJ_BUFSIZE) {
+		KGSL_DRV_ERR(device, "snapshot: too many snapshot IBs\n");
+		return;
+	}
+
+	deferred_ibs[deferred_ibsptr].ptbase = ptbase;
+	deferred_ibs[deferred_ibsptr].gpuaddr = gpuaddr;
+	deferred_ibs[deferred_ibsptr].dwords = dwords;
+	deferred_ibs[deferred_ibsptr++].section = section;
+}
+
 /* Push a new buffer object onto the list */
 static void push_object(struct kgsl_device *device, int type, uint32_t ptbase,
 	uint32_t gpuaddr, int dwords)
@@ -698,15 +731,19 @@ static int snapshot_rb(struct kgsl_device *device, void *snapshot,
 			/*
 			 * The IB from CP_IB1_BASE and the IBs for legacy
 			 * context switch go into the snapshot all
-			 * others get marked at GPU objects
+			 * others get marked at GPU objects.  Freeze the user
+			 * buffers now so they are still around when the IBs
+			 * get parsed.
 			 */
 
-			if (ibaddr == ibbase || memdesc != NULL)
-				push_object(device, SNAPSHOT_OBJ_TYPE_IB,
-					ptbase, ibaddr, ibsize);
-			else
-				ib_add_gpu_object(device, ptbase, ibaddr,
-					ibsize);
+			if (memdesc == NULL)
+				snapshot_frozen_objsize +=
+					kgsl_snapshot_get_object(device,
+						ptbase, ibaddr, ibsize << 2,
+						SNAPSHOT_GPU_OBJECT_IB);
+
+			defer_ib(device, ptbase, ibaddr, ibsize,
+				ibaddr == ibbase || memdesc != NULL);
 		}
 
 		index = index + 1;
@@ -794,12 +831,11 @@ static void *dump_object(struct kgsl_device *device, int obj, void *snapshot,
 void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 		int hang)
 {
-	int i;
-	uint32_t ptbase, ibbase, ibsize;
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
 
 	/* Reset the list of objects */
 	objbufptr = 0;
+	deferred_ibsptr = 0;
 
 	snapshot_frozen_objsize = 0;
 
@@ -813,23 +849,77 @@ void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 	memset(vbo, 0, sizeof(vbo));
 
 	/* Get the physical address of the MMU pagetable */
-	ptbase = kgsl_mmu_get_current_ptbase(&device->mmu);
+	deferred_ptbase = kgsl_mmu_get_current_ptbase(&device->mmu);
 
 	/* Dump the ringbuffer */
 	snapshot = kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_RB,
 		snapshot, remain, snapshot_rb, NULL);
 
+	/* Save the last IBs the CP was working on for the deferred parse */
+	kgsl_regread(device, REG_CP_IB1_BASE, &deferred_ib1base);
+	kgsl_regread(device, REG_CP_IB1_BUFSZ, &deferred_ib1size);
+	kgsl_regread(device, REG_CP_IB2_BASE, &deferred_ib2base);
+	kgsl_regread(device, REG_CP_IB2_BUFSZ, &deferred_ib2size);
+
 	/*
-	 * Make sure that the last IB1 that was being executed is dumped.
-	 * Since this was the last IB1 that was processed, we should have
-	 * already added it to the list during the ringbuffer parse but we
-	 * want to be double plus sure.
+	 * Only dump the istore on a hang - reading it on a running system
+	 * has a non 0 chance of hanging the GPU
 	 */
 
-	kgsl_regread(device, REG_CP_IB1_BASE, &ibbase);
-	kgsl_regread(device, REG_CP_IB1_BUFSZ, &ibsize);
+	if (hang) {
+		snapshot = kgsl_snapshot_add_section(device,
+			KGSL_SNAPSHOT_SECTION_ISTORE, snapshot, remain,
+			snapshot_istore, NULL);
+	}
+
+	/* Add GPU specific sections - registers mainly, but other stuff too */
+	if (adreno_dev->gpudev->snapshot)
+		snapshot = adreno_dev->gpudev->snapshot(adreno_dev, snapshot,
+			remain, hang);
+
+	deferred_pending = 1;
+
+	return snapshot;
+}
+
+/* adreno_snapshot_deferred - Add the IBs to an Adreno GPU snapshot
+ * @device - KGSL device to snapshot
+ * @snapshot - Pointer to the end of the snapshot taken by adreno_snapshot
+ * @remain - A pointer to how many bytes of memory are remaining in the snapshot
+ * This is called from the snapshot worker with the device mutex held after
+ * adreno_snapshot() has returned and recovery has been allowed to continue.
+ * Only GPU memory is read from here, all the register state was captured
+ * while the GPU was stopped.
+ */
+
+void *adreno_snapshot_deferred(struct kgsl_device *device, void *snapshot,
+		int *remain)
+{
+	int i;
+
+	if (!deferred_pending)
+		return snapshot;
+
+	deferred_pending = 0;
+
+	for (i = 0; i < deferred_ibsptr; i++) {
+		if (deferred_ibs[i].section)
+			push_object(device, SNAPSHOT_OBJ_TYPE_IB,
+				deferred_ibs[i].ptbase,
+				deferred_ibs[i].gpuaddr,
+				deferred_ibs[i].dwords);
+		else
+			ib_add_gpu_object(device, deferred_ibs[i].ptbase,
+				deferred_ibs[i].gpuaddr,
+				deferred_ibs[i].dwords);
+	}
 
 	/*
+	 * Make sure that the last IB1 that was being executed is dumped.
+	 * Since this was the last IB1 that was processed, we should have
+	 * already added it to the list during the ringbuffer parse but we
+	 * want to be double plus sure.
+	 *
 	 * The problem is that IB size from the register is the unprocessed size
 	 * of the buffer not the original size, so if we didn't catch this
 	 * buffer being directly used in the RB, then we might not be able to
@@ -837,16 +927,14 @@ void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 	 * figure how often this really happens.
 	 */
 
-	if (!find_object(SNAPSHOT_OBJ_TYPE_IB, ibbase, ptbase) && ibsize) {
-		push_object(device, SNAPSHOT_OBJ_TYPE_IB, ptbase,
-			ibbase, ibsize);
+	if (!find_object(SNAPSHOT_OBJ_TYPE_IB, deferred_ib1base,
+		deferred_ptbase) && deferred_ib1size) {
+		push_object(device, SNAPSHOT_OBJ_TYPE_IB, deferred_ptbase,
+			deferred_ib1base, deferred_ib1size);
 		KGSL_DRV_ERR(device, "CP_IB1_BASE not found in the ringbuffer. "
-			"Dumping %x dwords of the buffer.\n", ibsize);
+			"Dumping %x dwords of the buffer.\n", deferred_ib1size);
 	}
 
-	kgsl_regread(device, REG_CP_IB2_BASE, &ibbase);
-	kgsl_regread(device, REG_CP_IB2_BUFSZ, &ibsize);
-
 	/*
 	 * Add the last parsed IB2 to the list. The IB2 should be found as we
 	 * parse the objects below, but we try to add it to the list first, so
@@ -855,9 +943,10 @@ void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 	 * correct size.
 	 */
 
-	if (!find_object(SNAPSHOT_OBJ_TYPE_IB, ibbase, ptbase) && ibsize) {
-		push_object(device, SNAPSHOT_OBJ_TYPE_IB, ptbase,
-			ibbase, ibsize);
+	if (!find_object(SNAPSHOT_OBJ_TYPE_IB, deferred_ib2base,
+		deferred_ptbase) && deferred_ib2size) {
+		push_object(device, SNAPSHOT_OBJ_TYPE_IB, deferred_ptbase,
+			deferred_ib2base, deferred_ib2size);
 	}
 
 	/*
@@ -867,22 +956,6 @@ void *adreno_snapshot(struct kgsl_device *device, void *snapshot, int *remain,
 	for (i = 0; i < objbufptr; i++)
 		snapshot = dump_object(device, i, snapshot, remain);
 
-	/*
-	 * Only dump the istore on a hang - reading it on a running system
-	 * has a non 0 chance of hanging the GPU
-	 */
-
-	if (hang) {
-		snapshot = kgsl_snapshot_add_section(device,
-			KGSL_SNAPSHOT_SECTION_ISTORE, snapshot, remain,
-			snapshot_istore, NULL);
-	}
-
-	/* Add GPU specific sections - registers mainly, but other stuff too */
-	if (adreno_dev->gpudev->snapshot)
-		snapshot = adreno_dev->gpudev->snapshot(adreno_dev, snapshot,
-			remain, hang);
-
 	if (snapshot_frozen_objsize)
 		KGSL_DRV_ERR(device, "GPU snapshot froze %dKb of GPU buffers\n",
 			snapshot_frozen_objsize / 1024);
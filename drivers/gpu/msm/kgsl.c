@@ -33,6 +33,7 @@
 #include "kgsl_cffdump.h"
 #include "kgsl_log.h"
 #include "kgsl_sharedmem.h"
+#include "kgsl_pool.h"
 #include "kgsl_device.h"
 #include "kgsl_trace.h"
 #include "kgsl_sync.h"
@@ -67,7 +68,7 @@ int kgsl_add_event(struct kgsl_device *device, u32 id, u32 ts,
 	void *owner)
 {
 	struct kgsl_event *event;
-	struct list_head *n;
+	struct list_head *head, *n;
 	unsigned int cur_ts;
 	struct kgsl_context *context = NULL;
 
@@ -99,25 +100,23 @@ int kgsl_add_event(struct kgsl_device *device, u32 id, u32 ts,
 	event->owner = owner;
 
 	/*
-	 * Add the event in order to the list.  Order is by context id
-	 * first and then by timestamp for that context.
+	 * Each timeline has its own list sorted by timestamp.  Events are
+	 * mostly added in timestamp order, so search from the tail.
 	 */
+	head = context ? &context->events : &device->events;
 
-	for (n = device->events.next ; n != &device->events; n = n->next) {
+	if (context && list_empty(head))
+		list_add_tail(&context->events_list,
+			      &device->events_pending_list);
+
+	for (n = head->prev; n != head; n = n->prev) {
 		struct kgsl_event *e =
 			list_entry(n, struct kgsl_event, list);
 
-		if (e->context != context)
-			continue;
-
-		if (timestamp_cmp(e->timestamp, ts) > 0) {
-			list_add(&event->list, n->prev);
+		if (timestamp_cmp(e->timestamp, ts) <= 0)
 			break;
-		}
 	}
-
-	if (n == &device->events)
-		list_add_tail(&event->list, &device->events);
+	list_add(&event->list, n);
 
 	queue_work(device->work_queue, &device->ts_expired_ws);
 	return 0;
@@ -139,10 +138,7 @@ static void kgsl_cancel_events_ctxt(struct kgsl_device *device,
 	cur = kgsl_readtimestamp(device, context, KGSL_TIMESTAMP_RETIRED);
 	id = context->id;
 
-	list_for_each_entry_safe(event, event_tmp, &device->events, list) {
-		if (event->context != context)
-			continue;
-
+	list_for_each_entry_safe(event, event_tmp, &context->events, list) {
 		/*
 		 * "cancel" the events by calling their callback.
 		 * Currently, events are used for lock and memory
@@ -155,21 +151,18 @@ static void kgsl_cancel_events_ctxt(struct kgsl_device *device,
 		list_del(&event->list);
 		kfree(event);
 	}
+
+	if (!list_empty(&context->events_list))
+		list_del_init(&context->events_list);
 }
 
-/**
- * kgsl_cancel_events - Cancel all events for a process
- * @device - KGSL device for the events to cancel
- * @owner - driver instance that owns the events to cancel
- *
- */
-void kgsl_cancel_events(struct kgsl_device *device,
-	void *owner)
+static void _cancel_events_owner(struct kgsl_device *device,
+	struct list_head *head, void *owner)
 {
 	struct kgsl_event *event, *event_tmp;
 	unsigned int id, cur;
 
-	list_for_each_entry_safe(event, event_tmp, &device->events, list) {
+	list_for_each_entry_safe(event, event_tmp, head, list) {
 		if (event->owner != owner)
 			continue;
 
@@ -190,6 +183,27 @@ void kgsl_cancel_events(struct kgsl_device *device,
 		kfree(event);
 	}
 }
+
+/**
+ * kgsl_cancel_events - Cancel all events for a process
+ * @device - KGSL device for the events to cancel
+ * @owner - driver instance that owns the events to cancel
+ *
+ */
+void kgsl_cancel_events(struct kgsl_device *device,
+	void *owner)
+{
+	struct kgsl_context *context, *tmp;
+
+	_cancel_events_owner(device, &device->events, owner);
+
+	list_for_each_entry_safe(context, tmp, &device->events_pending_list,
+				 events_list) {
+		_cancel_events_owner(device, &context->events, owner);
+		if (list_empty(&context->events))
+			list_del_init(&context->events_list);
+	}
+}
 EXPORT_SYMBOL(kgsl_cancel_events);
 
 /* kgsl_get_mem_entry - get the mem_entry structure for the specified object
@@ -314,7 +328,8 @@ static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 	if (entry == NULL)
 		return;
 
-	entry->priv->stats[entry->memtype].cur -= entry->memdesc.size;
+	kgsl_process_sub_stats(entry->priv, entry->memtype,
+			       entry->memdesc.size);
 	entry->priv = NULL;
 
 	kgsl_mmu_unmap(entry->memdesc.pagetable, &entry->memdesc);
@@ -367,6 +382,8 @@ kgsl_create_context(struct kgsl_device_private *dev_priv)
 	kref_init(&context->refcount);
 	context->id = id;
 	context->dev_priv = dev_priv;
+	INIT_LIST_HEAD(&context->events);
+	INIT_LIST_HEAD(&context->events_list);
 
 	if (kgsl_sync_timeline_create(context)) {
 		idr_remove(&dev_priv->device->context_idr, id);
@@ -422,31 +439,52 @@ kgsl_context_destroy(struct kref *kref)
 	kfree(context);
 }
 
-void kgsl_timestamp_expired(struct work_struct *work)
+/*
+ * Fire the expired events at the head of a sorted event list.  The
+ * retired timestamp is read once and the walk stops at the first event
+ * that is still pending.
+ */
+static void _process_event_list(struct kgsl_device *device,
+	struct list_head *head, struct kgsl_context *context)
 {
-	struct kgsl_device *device = container_of(work, struct kgsl_device,
-		ts_expired_ws);
-	struct kgsl_event *event, *event_tmp;
+	struct kgsl_event *event;
 	uint32_t ts_processed;
 	unsigned int id;
 
-	mutex_lock(&device->mutex);
+	id = context ? context->id : KGSL_MEMSTORE_GLOBAL;
+	ts_processed = kgsl_readtimestamp(device, context,
+					  KGSL_TIMESTAMP_RETIRED);
 
-	/* Process expired events */
-	list_for_each_entry_safe(event, event_tmp, &device->events, list) {
-		ts_processed = kgsl_readtimestamp(device, event->context,
-						  KGSL_TIMESTAMP_RETIRED);
+	while (!list_empty(head)) {
+		event = list_first_entry(head, struct kgsl_event, list);
 		if (timestamp_cmp(ts_processed, event->timestamp) < 0)
-			continue;
-
-		id = event->context ? event->context->id : KGSL_MEMSTORE_GLOBAL;
+			break;
 
+		/* unlink first, the callback may queue a new event */
+		list_del(&event->list);
 		if (event->func)
 			event->func(device, event->priv, id, ts_processed);
-
-		list_del(&event->list);
 		kfree(event);
 	}
+}
+
+void kgsl_timestamp_expired(struct work_struct *work)
+{
+	struct kgsl_device *device = container_of(work, struct kgsl_device,
+		ts_expired_ws);
+	struct kgsl_context *context, *tmp;
+
+	mutex_lock(&device->mutex);
+
+	/* Process expired events */
+	_process_event_list(device, &device->events, NULL);
+
+	list_for_each_entry_safe(context, tmp, &device->events_pending_list,
+				 events_list) {
+		_process_event_list(device, &context->events, context);
+		if (list_empty(&context->events))
+			list_del_init(&context->events_list);
+	}
 
 	device->last_expired_ctxt_id = KGSL_CONTEXT_INVALID;
 
@@ -740,6 +778,11 @@ kgsl_get_process_private(struct kgsl_device_private *cur_dev_priv)
 		}
 	}
 
+	/* only keep the mm_struct, not the address space */
+	private->mm = current->mm;
+	if (private->mm)
+		atomic_inc(&private->mm->mm_count);
+
 	list_add(&private->list, &kgsl_driver.process_list);
 
 	kgsl_process_init_sysfs(private);
@@ -776,6 +819,8 @@ kgsl_put_process_private(struct kgsl_device *device,
 		kgsl_mem_entry_detach_process(entry);
 	}
 	kgsl_mmu_putpagetable(private->pagetable);
+	if (private->mm)
+		mmdrop(private->mm);
 	kfree(private);
 unlock:
 	mutex_unlock(&kgsl_driver.process_mutex);
@@ -1047,6 +1092,10 @@ static long _device_waittimestamp(struct kgsl_device_private *dev_priv,
 							KGSL_TIMESTAMP_RETIRED),
 				       timestamp, timeout);
 
+	/* Let the power policy know a client is stalled on the GPU */
+	if (timeout && !kgsl_check_timestamp(device, context, timestamp))
+		kgsl_pwrscale_wait(device);
+
 	result = device->ftbl->waittimestamp(dev_priv->device,
 					context, timestamp, timeout);
 
@@ -1473,7 +1522,8 @@ kgsl_ioctl_sharedmem_from_vmalloc(struct kgsl_device_private *dev_priv,
 
 	trace_kgsl_mem_alloc(entry);
 	/* Process specific statistics */
-	kgsl_process_add_stats(private, entry->memtype, len);
+	kgsl_process_add_stats(private, entry->memtype,
+			       entry->memdesc.size);
 
 	kgsl_check_idle(dev_priv->device);
 	return 0;
@@ -1991,7 +2041,8 @@ kgsl_ioctl_gpumem_alloc(struct kgsl_device_private *dev_priv,
 		kgsl_mem_entry_attach_process(entry, private);
 		param->gpuaddr = entry->memdesc.gpuaddr;
 
-		kgsl_process_add_stats(private, entry->memtype, param->size);
+		kgsl_process_add_stats(private, entry->memtype,
+				       entry->memdesc.size);
 		trace_kgsl_mem_alloc(entry);
 	} else
 		kfree(entry);
@@ -2671,11 +2722,15 @@ static void kgsl_core_exit(void)
 	kgsl_cffdump_destroy();
 	kgsl_core_debugfs_close();
 	kgsl_sharedmem_uninit_sysfs();
+	kgsl_pool_close();
 }
 
 static int __init kgsl_core_init(void)
 {
 	int result = 0;
+
+	kgsl_pool_init();
+
 	/* alloc major and minor device numbers */
 	result = alloc_chrdev_region(&kgsl_driver.major, 0, KGSL_DEVICE_MAX,
 				  KGSL_NAME);
@@ -17,6 +17,8 @@
 #include <linux/wakelock.h>
 #include <linux/pm_qos_params.h>
 #include <linux/earlysuspend.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
 
 #include "kgsl.h"
 #include "kgsl_mmu.h"
@@ -112,6 +114,8 @@ struct kgsl_functable {
 	int (*setproperty) (struct kgsl_device *device,
 		enum kgsl_property_type type, void *value,
 		unsigned int sizebytes);
+	void * (*snapshot_deferred)(struct kgsl_device *device,
+		void *snapshot, int *remain);
 };
 
 /* MH register values */
@@ -186,6 +190,8 @@ struct kgsl_device {
 	 * dumped
 	 */
 	struct list_head snapshot_obj_list;
+	/* Finishes the parts of a snapshot that don't need the GPU stopped */
+	struct work_struct snapshot_work;
 
 	/* Logging levels */
 	int cmd_log;
@@ -198,7 +204,10 @@ struct kgsl_device {
 	struct kobject pwrscale_kobj;
 	struct pm_qos_request_list pm_qos_req_dma;
 	struct work_struct ts_expired_ws;
+	/* events on global timestamps, sorted by timestamp */
 	struct list_head events;
+	/* contexts that have events pending on their own timestamps */
+	struct list_head events_pending_list;
 	s64 on_time;
 };
 
@@ -215,6 +224,7 @@ void kgsl_timestamp_expired(struct work_struct *work);
 			kgsl_timestamp_expired),\
 	.context_idr = IDR_INIT((_dev).context_idr),\
 	.events = LIST_HEAD_INIT((_dev).events),\
+	.events_pending_list = LIST_HEAD_INIT((_dev).events_pending_list),\
 	.wait_queue = __WAIT_QUEUE_HEAD_INITIALIZER((_dev).wait_queue),\
 	.mutex = __MUTEX_INITIALIZER((_dev).mutex),\
 	.state = KGSL_STATE_INIT,\
@@ -242,11 +252,18 @@ struct kgsl_context {
 	 * sync_pt timestamp expires.
 	 */
 	struct sync_timeline *timeline;
+
+	/* events on this context's timestamps, sorted by timestamp */
+	struct list_head events;
+	/* link in device->events_pending_list while events is not empty */
+	struct list_head events_list;
 };
 
 struct kgsl_process_private {
 	unsigned int refcnt;
 	pid_t pid;
+	/* charged with the pages kgsl allocates for the process */
+	struct mm_struct *mm;
 	spinlock_t mem_lock;
 	struct rb_root mem_rb;
 	struct kgsl_pagetable *pagetable;
@@ -277,6 +294,23 @@ static inline void kgsl_process_add_stats(struct kgsl_process_private *priv,
 	priv->stats[type].cur += size;
 	if (priv->stats[type].max < priv->stats[type].cur)
 		priv->stats[type].max = priv->stats[type].cur;
+
+	/*
+	 * Only memory kgsl allocated itself: the other types are counted
+	 * where they came from, or shared with other processes.
+	 */
+	if (type == KGSL_MEM_ENTRY_KERNEL && priv->mm)
+		add_mm_counter(priv->mm, MM_UNRECLAIMABLE, size >> PAGE_SHIFT);
+}
+
+static inline void kgsl_process_sub_stats(struct kgsl_process_private *priv,
+	unsigned int type, size_t size)
+{
+	priv->stats[type].cur -= size;
+
+	if (type == KGSL_MEM_ENTRY_KERNEL && priv->mm)
+		add_mm_counter(priv->mm, MM_UNRECLAIMABLE,
+			       -(long)(size >> PAGE_SHIFT));
 }
 
 static inline void kgsl_regread(struct kgsl_device *device,
@@ -891,6 +891,11 @@ kgsl_iommu_map(void *mmu_specific_pt,
 
 	iommu_virt_addr = memdesc->gpuaddr;
 
+	/*
+	 * iommu_map_range() uses 64K and 1M entries wherever the gpuaddr and
+	 * the physical pages line up, kgsl_mmu_map() aligns the gpuaddr of
+	 * large buffers to make that likely
+	 */
 	ret = iommu_map_range(iommu_pt->domain, iommu_virt_addr, memdesc->sg,
 				size, (IOMMU_READ | IOMMU_WRITE));
 	if (ret) {
@@ -1039,6 +1044,9 @@ static void kgsl_iommu_default_setstate(struct kgsl_mmu *mmu,
 					mmu->hwpagetable);
 	unsigned int pt_val;
 
+	if (!(flags & (KGSL_MMUFLAGS_PTUPDATE | KGSL_MMUFLAGS_TLBFLUSH)))
+		return;
+
 	if (kgsl_iommu_enable_clk(mmu, KGSL_IOMMU_CONTEXT_USER)) {
 		KGSL_DRV_ERR(mmu->device, "Failed to enable iommu clocks\n");
 		return;
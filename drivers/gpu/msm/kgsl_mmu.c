@@ -591,6 +591,27 @@ _get_pool(struct kgsl_pagetable *pagetable, unsigned int flags)
 	return pagetable->pool;
 }
 
+/*
+ * Large IOMMU mappings get their GPU address aligned to the 1M or 64K
+ * blocks that back them so the IOMMU can use section and large page
+ * entries. The global pool is small and only holds a few buffers, leave
+ * it packed.
+ */
+static inline unsigned int
+_get_align_order(struct kgsl_pagetable *pagetable, struct gen_pool *pool,
+	unsigned int size)
+{
+	if (KGSL_MMU_TYPE_IOMMU != kgsl_mmu_get_mmutype() ||
+		pool == pagetable->kgsl_pool)
+		return 0;
+
+	if (size >= SZ_1M)
+		return ilog2(SZ_1M);
+	if (size >= SZ_64K)
+		return ilog2(SZ_64K);
+	return 0;
+}
+
 int
 kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 				struct kgsl_memdesc *memdesc,
@@ -623,7 +644,13 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 	/* Allocate from kgsl pool if it exists for global mappings */
 	pool = _get_pool(pagetable, memdesc->priv);
 
-	memdesc->gpuaddr = gen_pool_alloc(pool, size);
+	memdesc->gpuaddr = gen_pool_alloc_aligned(pool, size,
+		_get_align_order(pagetable, pool, size));
+
+	/* Fall back to any address if the aligned space is fragmented */
+	if (memdesc->gpuaddr == 0)
+		memdesc->gpuaddr = gen_pool_alloc(pool, size);
+
 	if (memdesc->gpuaddr == 0) {
 		KGSL_CORE_ERR("gen_pool_alloc(%d) failed from pool: %s\n",
 			size,
@@ -0,0 +1,328 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <linux/gfp.h>
+#include <linux/highmem.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <asm/cacheflush.h>
+
+#include "kgsl_pool.h"
+
+/*
+ * The pool keeps blocks of pages that have already been zeroed and flushed
+ * out of the inner and outer caches so that they can be handed straight to
+ * a GPU allocation. Higher order blocks are kept whole so the IOMMU can use
+ * large mappings for them, they are only split into single pages when they
+ * leave the pool. Pages freed by KGSL are put on a dirty list and scrubbed
+ * by the worker before going back into the order 0 pool.
+ */
+
+struct kgsl_page_pool {
+	unsigned int order;
+	unsigned int reserve;
+	unsigned int count;
+	struct list_head list;
+};
+
+#define KGSL_POOL(_order, _reserve) \
+	{ .order = _order, .reserve = _reserve, }
+
+/* Keep these sorted from largest to smallest order */
+static struct kgsl_page_pool kgsl_pools[] = {
+	KGSL_POOL(KGSL_POOL_ORDER_1M, 2),
+	KGSL_POOL(KGSL_POOL_ORDER_64K, 8),
+	KGSL_POOL(0, 256),
+};
+
+#define KGSL_POOL_SMALL (&kgsl_pools[ARRAY_SIZE(kgsl_pools) - 1])
+
+/* Upper bound on the clean and dirty order 0 pages held by the pool */
+#define KGSL_POOL_MAX_PAGES 1024
+
+/* Don't refill the pool for this long after the shrinker was called */
+#define KGSL_POOL_BACKOFF HZ
+
+/* Opportunistic allocations that are allowed to fail quickly */
+#define KGSL_POOL_GFP (GFP_KERNEL | __GFP_HIGHMEM | __GFP_NORETRY | \
+	__GFP_NOWARN | __GFP_NO_KSWAPD)
+
+static DEFINE_SPINLOCK(kgsl_pool_lock);
+static LIST_HEAD(kgsl_pool_dirty);
+static unsigned int kgsl_pool_dirty_count;
+static unsigned long kgsl_pool_shrink_jiffies;
+
+static void kgsl_pool_worker(struct work_struct *work);
+static DECLARE_WORK(kgsl_pool_work, kgsl_pool_worker);
+
+static inline unsigned int _kgsl_pool_pages(void)
+{
+	unsigned int i, pages = kgsl_pool_dirty_count;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++)
+		pages += kgsl_pools[i].count << kgsl_pools[i].order;
+
+	return pages;
+}
+
+static struct page *_kgsl_pool_get(struct kgsl_page_pool *pool)
+{
+	struct page *page = NULL;
+
+	spin_lock(&kgsl_pool_lock);
+	if (pool->count) {
+		page = list_first_entry(&pool->list, struct page, lru);
+		list_del(&page->lru);
+		pool->count--;
+	}
+	spin_unlock(&kgsl_pool_lock);
+
+	return page;
+}
+
+static void _kgsl_pool_put(struct kgsl_page_pool *pool, struct page *page)
+{
+	spin_lock(&kgsl_pool_lock);
+	list_add_tail(&page->lru, &pool->list);
+	pool->count++;
+	spin_unlock(&kgsl_pool_lock);
+}
+
+static struct page *_kgsl_pool_get_dirty(void)
+{
+	struct page *page = NULL;
+
+	spin_lock(&kgsl_pool_lock);
+	if (kgsl_pool_dirty_count) {
+		page = list_first_entry(&kgsl_pool_dirty, struct page, lru);
+		list_del(&page->lru);
+		kgsl_pool_dirty_count--;
+	}
+	spin_unlock(&kgsl_pool_lock);
+
+	return page;
+}
+
+/* Zero a block and push it out of the caches so the GPU sees the zeroes */
+static void kgsl_pool_scrub(struct page *page, unsigned int order)
+{
+	phys_addr_t paddr = page_to_phys(page);
+	int i;
+
+	for (i = 0; i < (1 << order); i++) {
+		void *ptr = kmap_atomic(page + i);
+		memset(ptr, 0, PAGE_SIZE);
+		dmac_flush_range(ptr, ptr + PAGE_SIZE);
+		kunmap_atomic(ptr);
+	}
+
+	outer_flush_range(paddr, paddr + (PAGE_SIZE << order));
+}
+
+static void kgsl_pool_worker(struct work_struct *work)
+{
+	struct page *page;
+	int i;
+
+	while ((page = _kgsl_pool_get_dirty()) != NULL) {
+		kgsl_pool_scrub(page, 0);
+		_kgsl_pool_put(KGSL_POOL_SMALL, page);
+		cond_resched();
+	}
+
+	if (time_before(jiffies, kgsl_pool_shrink_jiffies + KGSL_POOL_BACKOFF))
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+
+		while (pool->count < pool->reserve) {
+			page = alloc_pages(KGSL_POOL_GFP, pool->order);
+			if (page == NULL)
+				break;
+
+			kgsl_pool_scrub(page, pool->order);
+			_kgsl_pool_put(pool, page);
+			cond_resched();
+		}
+	}
+}
+
+/**
+ * kgsl_pool_alloc_pages() - Get a block of pages for a GPU allocation
+ * @order: Largest order wanted, updated with the order of the block returned
+ * @zeroed: Set to 1 if the block is already zeroed and cache clean
+ *
+ * Return the first page of a physically contiguous block of 1 << @order
+ * pages. The block is split so each page can be freed on its own with
+ * kgsl_pool_free_page(). Returns NULL if not even a single page could be
+ * allocated.
+ */
+struct page *kgsl_pool_alloc_pages(unsigned int *order, int *zeroed)
+{
+	struct kgsl_page_pool *pool = NULL;
+	struct page *page = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++) {
+		gfp_t gfp = KGSL_POOL_GFP;
+
+		pool = &kgsl_pools[i];
+		if (pool->order > *order)
+			continue;
+
+		page = _kgsl_pool_get(pool);
+		if (page != NULL) {
+			*zeroed = 1;
+			break;
+		}
+
+		/* Only the last resort single page is allowed to try hard */
+		if (pool->order == 0)
+			gfp = GFP_KERNEL | __GFP_HIGHMEM;
+
+		page = alloc_pages(gfp, pool->order);
+		if (page != NULL) {
+			*zeroed = 0;
+			break;
+		}
+	}
+
+	if (page == NULL)
+		return NULL;
+
+	*order = pool->order;
+	if (pool->order)
+		split_page(page, pool->order);
+
+	if (pool->count < pool->reserve)
+		schedule_work(&kgsl_pool_work);
+
+	return page;
+}
+
+/**
+ * kgsl_pool_free_page() - Release a page that came from
+ * kgsl_pool_alloc_pages()
+ * @page: The page to free
+ *
+ * The page is kept for scrubbing if there is room in the pool and no one
+ * else holds a reference to it, otherwise it goes back to the system.
+ */
+void kgsl_pool_free_page(struct page *page)
+{
+	int queue = 0;
+
+	if (page_count(page) == 1) {
+		spin_lock(&kgsl_pool_lock);
+		if (kgsl_pool_dirty_count + KGSL_POOL_SMALL->count <
+			KGSL_POOL_MAX_PAGES) {
+			list_add_tail(&page->lru, &kgsl_pool_dirty);
+			queue = (kgsl_pool_dirty_count++ == 0);
+			page = NULL;
+		}
+		spin_unlock(&kgsl_pool_lock);
+	}
+
+	if (page != NULL)
+		__free_page(page);
+	else if (queue)
+		schedule_work(&kgsl_pool_work);
+}
+
+/**
+ * kgsl_pool_size() - Return the number of bytes held by the pool
+ */
+size_t kgsl_pool_size(void)
+{
+	unsigned int pages;
+
+	spin_lock(&kgsl_pool_lock);
+	pages = _kgsl_pool_pages();
+	spin_unlock(&kgsl_pool_lock);
+
+	return pages << PAGE_SHIFT;
+}
+
+static void _kgsl_pool_drain(long nr_pages)
+{
+	struct page *page;
+	int i;
+
+	/* Unscrubbed pages are the cheapest to give up */
+	while (nr_pages > 0 && kgsl_pool_dirty_count) {
+		page = list_first_entry(&kgsl_pool_dirty, struct page, lru);
+		list_del(&page->lru);
+		kgsl_pool_dirty_count--;
+		__free_page(page);
+		nr_pages--;
+	}
+
+	/* Then the small blocks, the large ones are harder to replace */
+	for (i = ARRAY_SIZE(kgsl_pools) - 1; i >= 0; i--) {
+		struct kgsl_page_pool *pool = &kgsl_pools[i];
+
+		while (nr_pages > 0 && pool->count) {
+			page = list_first_entry(&pool->list, struct page, lru);
+			list_del(&page->lru);
+			pool->count--;
+			__free_pages(page, pool->order);
+			nr_pages -= 1 << pool->order;
+		}
+	}
+}
+
+static int kgsl_pool_shrink(struct shrinker *shrinker,
+	struct shrink_control *sc)
+{
+	int pages;
+
+	spin_lock(&kgsl_pool_lock);
+	if (sc->nr_to_scan) {
+		kgsl_pool_shrink_jiffies = jiffies;
+		_kgsl_pool_drain(sc->nr_to_scan);
+	}
+	pages = _kgsl_pool_pages();
+	spin_unlock(&kgsl_pool_lock);
+
+	return pages;
+}
+
+static struct shrinker kgsl_pool_shrinker = {
+	.shrink = kgsl_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+void kgsl_pool_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++)
+		INIT_LIST_HEAD(&kgsl_pools[i].list);
+
+	kgsl_pool_shrink_jiffies = jiffies - KGSL_POOL_BACKOFF;
+	register_shrinker(&kgsl_pool_shrinker);
+
+	/* Fill the reserves in the background */
+	schedule_work(&kgsl_pool_work);
+}
+
+void kgsl_pool_close(void)
+{
+	unregister_shrinker(&kgsl_pool_shrinker);
+	cancel_work_sync(&kgsl_pool_work);
+
+	spin_lock(&kgsl_pool_lock);
+	_kgsl_pool_drain(LONG_MAX);
+	spin_unlock(&kgsl_pool_lock);
+}
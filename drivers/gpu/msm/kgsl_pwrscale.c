@@ -48,6 +48,7 @@ static struct kgsl_pwrscale_policy *kgsl_pwrscale_policies[] = {
 #ifdef CONFIG_MSM_DCVS
 	&kgsl_pwrscale_policy_msm,
 #endif
+	&kgsl_pwrscale_policy_ondemand,
 	NULL
 };
 
@@ -239,6 +240,16 @@ void kgsl_pwrscale_busy(struct kgsl_device *device)
 					&device->pwrscale);
 }
 
+/*
+ * kgsl_pwrscale_wait - called when a client is about to block waiting for
+ * the GPU to finish its work
+ */
+void kgsl_pwrscale_wait(struct kgsl_device *device)
+{
+	if (PWRSCALE_ACTIVE(device) && device->pwrscale.policy->wait)
+		device->pwrscale.policy->wait(device, &device->pwrscale);
+}
+
 void kgsl_pwrscale_idle(struct kgsl_device *device, unsigned int ignore_idle)
 {
 	if (PWRSCALE_ACTIVE(device) && device->pwrscale.policy->idle)
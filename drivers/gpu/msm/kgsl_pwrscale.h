@@ -27,6 +27,8 @@ struct kgsl_pwrscale_policy  {
 		unsigned int ignore_idle);
 	void (*busy)(struct kgsl_device *device,
 		struct kgsl_pwrscale *pwrscale);
+	void (*wait)(struct kgsl_device *device,
+		struct kgsl_pwrscale *pwrscale);
 	void (*sleep)(struct kgsl_device *device,
 		struct kgsl_pwrscale *pwrscale);
 	void (*wake)(struct kgsl_device *device,
@@ -56,6 +58,7 @@ struct kgsl_pwrscale_policy_attribute {
 extern struct kgsl_pwrscale_policy kgsl_pwrscale_policy_tz;
 extern struct kgsl_pwrscale_policy kgsl_pwrscale_policy_idlestats;
 extern struct kgsl_pwrscale_policy kgsl_pwrscale_policy_msm;
+extern struct kgsl_pwrscale_policy kgsl_pwrscale_policy_ondemand;
 
 int kgsl_pwrscale_init(struct kgsl_device *device);
 void kgsl_pwrscale_close(struct kgsl_device *device);
@@ -67,6 +70,7 @@ void kgsl_pwrscale_detach_policy(struct kgsl_device *device);
 void kgsl_pwrscale_idle(struct kgsl_device *device,
 				unsigned int ignore_idle);
 void kgsl_pwrscale_busy(struct kgsl_device *device);
+void kgsl_pwrscale_wait(struct kgsl_device *device);
 void kgsl_pwrscale_sleep(struct kgsl_device *device);
 void kgsl_pwrscale_wake(struct kgsl_device *device);
 
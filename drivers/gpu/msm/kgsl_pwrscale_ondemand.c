@@ -0,0 +1,242 @@
+/* Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+
+#include "kgsl.h"
+#include "kgsl_pwrscale.h"
+#include "kgsl_device.h"
+
+/*
+ * A simple in-kernel ondemand policy. Every idle sample the GPU load is
+ * compared against the up and down thresholds: above up_threshold the
+ * clock goes straight to the fastest allowed level, below down_threshold
+ * it steps down one level, and a completely idle sample drops it to the
+ * slowest level. A client that has to block waiting for a timestamp is
+ * about to miss its frame, so each such wait bumps the clock up a level
+ * and holds off scaling down until the next sample.
+ */
+
+struct ondemand_priv {
+	unsigned int up_threshold;
+	unsigned int down_threshold;
+	int boosted;
+};
+
+#define ONDEMAND_UP_THRESHOLD	80
+#define ONDEMAND_DOWN_THRESHOLD	30
+
+static ssize_t ondemand_threshold_show(unsigned int val, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", val);
+}
+
+static int ondemand_threshold_store(const char *buf, unsigned int *val)
+{
+	unsigned long tmp;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &tmp);
+	if (ret)
+		return ret;
+
+	if (tmp > 100)
+		return -EINVAL;
+
+	*val = tmp;
+	return 0;
+}
+
+static ssize_t ondemand_up_threshold_show(struct kgsl_device *device,
+				struct kgsl_pwrscale *pwrscale,
+				char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	return ondemand_threshold_show(priv->up_threshold, buf);
+}
+
+static ssize_t ondemand_up_threshold_store(struct kgsl_device *device,
+				struct kgsl_pwrscale *pwrscale,
+				const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+	int ret;
+
+	ret = ondemand_threshold_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	if (val > priv->down_threshold)
+		priv->up_threshold = val;
+	else
+		ret = -EINVAL;
+	mutex_unlock(&device->mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t ondemand_down_threshold_show(struct kgsl_device *device,
+				struct kgsl_pwrscale *pwrscale,
+				char *buf)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	return ondemand_threshold_show(priv->down_threshold, buf);
+}
+
+static ssize_t ondemand_down_threshold_store(struct kgsl_device *device,
+				struct kgsl_pwrscale *pwrscale,
+				const char *buf, size_t count)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+	unsigned int val;
+	int ret;
+
+	ret = ondemand_threshold_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	if (val < priv->up_threshold)
+		priv->down_threshold = val;
+	else
+		ret = -EINVAL;
+	mutex_unlock(&device->mutex);
+
+	return ret ? ret : count;
+}
+
+PWRSCALE_POLICY_ATTR(up_threshold, 0644, ondemand_up_threshold_show,
+	ondemand_up_threshold_store);
+PWRSCALE_POLICY_ATTR(down_threshold, 0644, ondemand_down_threshold_show,
+	ondemand_down_threshold_store);
+
+static struct attribute *ondemand_attrs[] = {
+	&policy_attr_up_threshold.attr,
+	&policy_attr_down_threshold.attr,
+	NULL
+};
+
+static struct attribute_group ondemand_attr_group = {
+	.attrs = ondemand_attrs,
+};
+
+static void ondemand_idle(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale, unsigned int ignore_idle)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct ondemand_priv *priv = pwrscale->priv;
+	struct kgsl_power_stats stats;
+	unsigned int load, level = pwr->active_pwrlevel;
+
+	if (ignore_idle)
+		return;
+
+	device->ftbl->power_stats(device, &stats);
+	if (stats.total_time <= 0)
+		return;
+
+	load = div64_u64(stats.busy_time * 100, stats.total_time);
+
+	/* Don't scale down if a client had to wait during this sample */
+	if (load >= priv->up_threshold)
+		level = pwr->thermal_pwrlevel;
+	else if (!priv->boosted && stats.busy_time == 0)
+		level = pwr->num_pwrlevels - 2;
+	else if (!priv->boosted && load < priv->down_threshold)
+		level = pwr->active_pwrlevel + 1;
+
+	priv->boosted = 0;
+	kgsl_pwrctrl_pwrlevel_change(device, level);
+}
+
+static void ondemand_wait(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	/* One step per sample, the idle sample decides the rest */
+	if (priv->boosted)
+		return;
+
+	priv->boosted = 1;
+	if (pwr->active_pwrlevel > pwr->thermal_pwrlevel)
+		kgsl_pwrctrl_pwrlevel_change(device,
+			pwr->active_pwrlevel - 1);
+}
+
+static void ondemand_busy(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	device->on_time = ktime_to_us(ktime_get());
+}
+
+static void ondemand_sleep(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	struct ondemand_priv *priv = pwrscale->priv;
+
+	priv->boosted = 0;
+}
+
+static void ondemand_wake(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	if (device->state != KGSL_STATE_NAP)
+		kgsl_pwrctrl_pwrlevel_change(device,
+					device->pwrctrl.default_pwrlevel);
+}
+
+static int ondemand_init(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	struct ondemand_priv *priv;
+
+	priv = pwrscale->priv = kzalloc(sizeof(struct ondemand_priv),
+		GFP_KERNEL);
+	if (pwrscale->priv == NULL)
+		return -ENOMEM;
+
+	priv->up_threshold = ONDEMAND_UP_THRESHOLD;
+	priv->down_threshold = ONDEMAND_DOWN_THRESHOLD;
+	kgsl_pwrscale_policy_add_files(device, pwrscale, &ondemand_attr_group);
+
+	return 0;
+}
+
+static void ondemand_close(struct kgsl_device *device,
+	struct kgsl_pwrscale *pwrscale)
+{
+	kgsl_pwrscale_policy_remove_files(device, pwrscale,
+		&ondemand_attr_group);
+	kfree(pwrscale->priv);
+	pwrscale->priv = NULL;
+}
+
+struct kgsl_pwrscale_policy kgsl_pwrscale_policy_ondemand = {
+	.name = "ondemand",
+	.init = ondemand_init,
+	.busy = ondemand_busy,
+	.idle = ondemand_idle,
+	.wait = ondemand_wait,
+	.sleep = ondemand_sleep,
+	.wake = ondemand_wake,
+	.close = ondemand_close
+};
+EXPORT_SYMBOL(kgsl_pwrscale_policy_ondemand);
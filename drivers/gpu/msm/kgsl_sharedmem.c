@@ -21,6 +21,7 @@
 #include "kgsl_sharedmem.h"
 #include "kgsl_cffdump.h"
 #include "kgsl_device.h"
+#include "kgsl_pool.h"
 
 /* An attribute for showing per-process memory statistics */
 struct kgsl_mem_entry_attribute {
@@ -242,6 +243,13 @@ static int kgsl_drv_histogram_show(struct device *dev,
 	return len;
 }
 
+static int kgsl_drv_page_pool_show(struct device *dev,
+				   struct device_attribute *attr,
+				   char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%zu\n", kgsl_pool_size());
+}
+
 DEVICE_ATTR(vmalloc, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(vmalloc_max, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(page_alloc, 0444, kgsl_drv_memstat_show, NULL);
@@ -251,6 +259,7 @@ DEVICE_ATTR(coherent_max, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(mapped, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(mapped_max, 0444, kgsl_drv_memstat_show, NULL);
 DEVICE_ATTR(histogram, 0444, kgsl_drv_histogram_show, NULL);
+DEVICE_ATTR(page_pool, 0444, kgsl_drv_page_pool_show, NULL);
 
 static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_vmalloc,
@@ -262,6 +271,7 @@ static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_mapped,
 	&dev_attr_mapped_max,
 	&dev_attr_histogram,
+	&dev_attr_page_pool,
 	NULL
 };
 
@@ -355,7 +365,7 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 	}
 	if (memdesc->sg)
 		for_each_sg(memdesc->sg, sg, sglen, i)
-			__free_page(sg_page(sg));
+			kgsl_pool_free_page(sg_page(sg));
 }
 
 static int kgsl_contiguous_vmflags(struct kgsl_memdesc *memdesc)
@@ -503,8 +513,10 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 			struct kgsl_pagetable *pagetable,
 			size_t size, unsigned int protflags)
 {
-	int i, order, ret = 0;
-	int sglen = PAGE_ALIGN(size) / PAGE_SIZE;
+	int i, j, order, ret = 0;
+	int npages = PAGE_ALIGN(size) / PAGE_SIZE;
+	int sglen = npages;
+	int dirty = 0;
 	struct page **pages = NULL;
 	pgprot_t page_prot = pgprot_writecombine(PAGE_KERNEL);
 	void *ptr;
@@ -552,21 +564,30 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 	memdesc->sglen = sglen;
 	sg_init_table(memdesc->sg, sglen);
 
-	for (i = 0; i < PAGE_ALIGN(size) / PAGE_SIZE; i++) {
+	/*
+	 * Take the largest blocks that fit from the page pool so the IOMMU can
+	 * use large mappings. Blocks from the pool are already zeroed and
+	 * clean in the caches, only the pages that had to come straight from
+	 * the system are collected in pages[] to be cleared below.
+	 */
 
-		/*
-		 * Don't use GFP_ZERO here because it is faster to memset the
-		 * range ourselves (see below)
-		 */
+	for (i = 0; i < npages; ) {
+		unsigned int blk = ilog2(npages - i);
+		struct page *page;
+		int zeroed;
 
-		pages[i] = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
-		if (pages[i] == NULL) {
+		page = kgsl_pool_alloc_pages(&blk, &zeroed);
+		if (page == NULL) {
 			ret = -ENOMEM;
 			memdesc->sglen = i;
 			goto done;
 		}
 
-		sg_set_page(&memdesc->sg[i], pages[i], PAGE_SIZE, 0);
+		for (j = 0; j < (1 << blk); j++, i++) {
+			sg_set_page(&memdesc->sg[i], page + j, PAGE_SIZE, 0);
+			if (!zeroed)
+				pages[dirty++] = page + j;
+		}
 	}
 
 	/* ADd the guard page to the end of the sglist */
@@ -609,28 +630,30 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 	 * path
 	 */
 
-	ptr = vmap(pages, i, VM_IOREMAP, page_prot);
-
-	if (ptr != NULL) {
-		memset(ptr, 0, memdesc->size);
-		dmac_flush_range(ptr, ptr + memdesc->size);
-		vunmap(ptr);
-	} else {
-		int j;
-
-		/* Very, very, very slow path */
+	if (dirty) {
+		ptr = vmap(pages, dirty, VM_IOREMAP, page_prot);
+
+		if (ptr != NULL) {
+			memset(ptr, 0, dirty << PAGE_SHIFT);
+			dmac_flush_range(ptr, ptr + (dirty << PAGE_SHIFT));
+			vunmap(ptr);
+		} else {
+			/* Very, very, very slow path */
+
+			for (j = 0; j < dirty; j++) {
+				ptr = kmap_atomic(pages[j]);
+				memset(ptr, 0, PAGE_SIZE);
+				dmac_flush_range(ptr, ptr + PAGE_SIZE);
+				kunmap_atomic(ptr);
+			}
+		}
 
-		for (j = 0; j < i; j++) {
-			ptr = kmap_atomic(pages[j]);
-			memset(ptr, 0, PAGE_SIZE);
-			dmac_flush_range(ptr, ptr + PAGE_SIZE);
-			kunmap_atomic(ptr);
+		for (j = 0; j < dirty; j++) {
+			phys_addr_t paddr = page_to_phys(pages[j]);
+			outer_flush_range(paddr, paddr + PAGE_SIZE);
 		}
 	}
 
-	outer_cache_range_op_sg(memdesc->sg, memdesc->sglen,
-				KGSL_CACHE_OP_FLUSH);
-
 	ret = kgsl_mmu_map(pagetable, memdesc, protflags);
 
 	if (ret)
@@ -15,6 +15,7 @@
 #include <linux/utsname.h>
 #include <linux/sched.h>
 #include <linux/idr.h>
+#include <linux/workqueue.h>
 
 #include "kgsl.h"
 #include "kgsl_log.h"
@@ -531,12 +532,50 @@ int kgsl_device_snapshot(struct kgsl_device *device, int hang)
 	KGSL_DRV_ERR(device, "snapshot created at va %p pa %lx size %d\n",
 			device->snapshot, __pa(device->snapshot),
 			device->snapshot_size);
-	if (hang)
+
+	/* Let recovery go ahead, the slow parts are finished from the worker */
+	if (device->ftbl->snapshot_deferred)
+		queue_work(device->work_queue, &device->snapshot_work);
+	else if (hang)
 		sysfs_notify(&device->snapshot_kobj, NULL, "timestamp");
+
 	return 0;
 }
 EXPORT_SYMBOL(kgsl_device_snapshot);
 
+/*
+ * kgsl_snapshot_worker - finish a snapshot started by kgsl_device_snapshot
+ * @work - the snapshot_work struct embedded in the device
+ * Append the sections that the device chose to defer to the end of the
+ * snapshot and let userspace know that a hang snapshot is ready.
+ */
+static void kgsl_snapshot_worker(struct work_struct *work)
+{
+	struct kgsl_device *device = container_of(work, struct kgsl_device,
+		snapshot_work);
+	int remain;
+	void *snapshot;
+	int frozen;
+
+	mutex_lock(&device->mutex);
+
+	remain = device->snapshot_maxsize - device->snapshot_size;
+	snapshot = ((void *) device->snapshot) + device->snapshot_size;
+
+	snapshot = device->ftbl->snapshot_deferred(device, snapshot, &remain);
+	device->snapshot_size = (int) (snapshot - device->snapshot);
+
+	frozen = device->snapshot_frozen;
+
+	KGSL_DRV_ERR(device, "snapshot completed size %d\n",
+		device->snapshot_size);
+
+	mutex_unlock(&device->mutex);
+
+	if (frozen)
+		sysfs_notify(&device->snapshot_kobj, NULL, "timestamp");
+}
+
 /* An attribute for showing snapshot details */
 struct kgsl_snapshot_attribute {
 	struct attribute attr;
@@ -569,6 +608,9 @@ static ssize_t snapshot_show(struct file *filep, struct kobject *kobj,
 	if (device->snapshot_timestamp == 0)
 		return 0;
 
+	/* Wait for the snapshot to be finished if it is still in progress */
+	flush_work(&device->snapshot_work);
+
 	/* Get the mutex to keep things from changing while we are dumping */
 	mutex_lock(&device->mutex);
 
@@ -716,6 +758,7 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	device->snapshot_timestamp = 0;
 
 	INIT_LIST_HEAD(&device->snapshot_obj_list);
+	INIT_WORK(&device->snapshot_work, kgsl_snapshot_worker);
 
 	ret = kobject_init_and_add(&device->snapshot_kobj, &ktype_snapshot,
 		&device->dev->kobj, "snapshot");
@@ -746,6 +789,8 @@ EXPORT_SYMBOL(kgsl_device_snapshot_init);
 
 void kgsl_device_snapshot_close(struct kgsl_device *device)
 {
+	cancel_work_sync(&device->snapshot_work);
+
 	sysfs_remove_bin_file(&device->snapshot_kobj, &snapshot_attr);
 	sysfs_remove_file(&device->snapshot_kobj, &attr_trigger.attr);
 	sysfs_remove_file(&device->snapshot_kobj, &attr_timestamp.attr);
@@ -46,7 +46,8 @@
 #define Z180_STREAM_END_CMD 0x9000
 #define Z180_STREAM_PACKET 0x7C000176
 #define Z180_STREAM_PACKET_CALL 0x7C000275
-#define Z180_PACKET_COUNT 8
+#define Z180_PACKET_COUNT 16
+#define Z180_MAX_IBS 8
 #define Z180_RB_SIZE (Z180_PACKET_SIZE*Z180_PACKET_COUNT \
 			  *sizeof(uint32_t))
 
@@ -395,8 +396,8 @@ z180_cmdstream_issueibcmds(struct kgsl_device_private *dev_priv,
 	unsigned int cnt        = 5;
 	unsigned int old_timestamp = 0;
 	unsigned int nextcnt    = Z180_STREAM_END_CMD | 5;
-	struct kgsl_mem_entry *entry = NULL;
-	unsigned int cmd;
+	struct kgsl_mem_entry *entry[Z180_MAX_IBS];
+	unsigned int cmd, i;
 	struct kgsl_device *device = dev_priv->device;
 	struct kgsl_pagetable *pagetable = dev_priv->process_priv->pagetable;
 	struct z180_device *z180_dev = Z180_DEVICE(device);
@@ -406,40 +407,45 @@ z180_cmdstream_issueibcmds(struct kgsl_device_private *dev_priv,
 		result = -EINVAL;
 		goto error;
 	}
-	if (numibs != 1) {
+	if (numibs == 0 || numibs > Z180_MAX_IBS) {
 		KGSL_DRV_ERR(device, "Invalid number of ibs: %d\n", numibs);
 		result = -EINVAL;
 		goto error;
 	}
-	cmd = ibdesc[0].gpuaddr;
-	sizedwords = ibdesc[0].sizedwords;
-	/*
-	 * Get a kernel mapping to the IB for monkey patching.
-	 * See the end of this function.
-	 */
-	entry = kgsl_sharedmem_find_region(dev_priv->process_priv, cmd,
-		sizedwords);
-	if (entry == NULL) {
-		KGSL_DRV_ERR(device, "Bad ibdesc: gpuaddr 0x%x size %d\n",
-			     cmd, sizedwords);
-		result = -EINVAL;
-		goto error;
-	}
-	/*
-	 * This will only map memory if it exists, otherwise it will reuse the
-	 * mapping. And the 2d userspace reuses IBs so we likely won't create
-	 * too many mappings.
-	 */
-	if (kgsl_gpuaddr_to_vaddr(&entry->memdesc, cmd) == NULL) {
-		KGSL_DRV_ERR(device,
-			     "Cannot make kernel mapping for gpuaddr 0x%x\n",
-			     cmd);
-		result = -EINVAL;
-		goto error;
-	}
 
-	KGSL_CMD_INFO(device, "ctxt %d ibaddr 0x%08x sizedwords %d\n",
-		context->id, cmd, sizedwords);
+	for (i = 0; i < numibs; i++) {
+		cmd = ibdesc[i].gpuaddr;
+		sizedwords = ibdesc[i].sizedwords;
+		/*
+		 * Get a kernel mapping to the IB for monkey patching.
+		 * See the end of this function.
+		 */
+		entry[i] = kgsl_sharedmem_find_region(dev_priv->process_priv,
+			cmd, sizedwords);
+		if (entry[i] == NULL) {
+			KGSL_DRV_ERR(device,
+				     "Bad ibdesc: gpuaddr 0x%x size %d\n",
+				     cmd, sizedwords);
+			result = -EINVAL;
+			goto error;
+		}
+		/*
+		 * This will only map memory if it exists, otherwise it will
+		 * reuse the mapping. And the 2d userspace reuses IBs so we
+		 * likely won't create too many mappings.
+		 */
+		if (kgsl_gpuaddr_to_vaddr(&entry[i]->memdesc, cmd) == NULL) {
+			KGSL_DRV_ERR(device,
+				     "Cannot make kernel mapping for gpuaddr "
+				     "0x%x\n", cmd);
+			result = -EINVAL;
+			goto error;
+		}
+
+		KGSL_CMD_INFO(device, "ctxt %d ibaddr 0x%08x sizedwords %d\n",
+			context->id, cmd, sizedwords);
+	}
+	cmd = ibdesc[0].gpuaddr;
 	/* context switch */
 	if ((context->id != (int)z180_dev->ringbuffer.prevctx) ||
 	    (ctrl & KGSL_CONTEXT_CTX_SWITCH)) {
@@ -477,13 +483,28 @@ z180_cmdstream_issueibcmds(struct kgsl_device_private *dev_priv,
 	/* Make sure the next ringbuffer entry has a marker */
 	addmarker(&z180_dev->ringbuffer, z180_dev->current_timestamp);
 
-	/* monkey patch the IB so that it jumps back to the ringbuffer */
-	kgsl_sharedmem_writel(&entry->memdesc,
-		      ((sizedwords + 1) * sizeof(unsigned int)),
-		      rb_gpuaddr(z180_dev, z180_dev->current_timestamp));
-	kgsl_sharedmem_writel(&entry->memdesc,
+	/*
+	 * Monkey patch the IBs so that each one jumps past the state stream
+	 * of the next, all of them from the same context, and the last one
+	 * back to the ringbuffer. The whole batch retires behind a single
+	 * marker, so it costs one timestamp and one interrupt.
+	 */
+	for (i = 0; i < numibs; i++) {
+		unsigned int next;
+
+		if (i + 1 < numibs)
+			next = ibdesc[i + 1].gpuaddr +
+				PACKETSIZE_STATESTREAM * sizeof(unsigned int);
+		else
+			next = rb_gpuaddr(z180_dev, z180_dev->current_timestamp);
+
+		sizedwords = ibdesc[i].sizedwords;
+		kgsl_sharedmem_writel(&entry[i]->memdesc,
+			      ((sizedwords + 1) * sizeof(unsigned int)), next);
+		kgsl_sharedmem_writel(&entry[i]->memdesc,
 			      ((sizedwords + 2) * sizeof(unsigned int)),
 			      nextcnt);
+	}
 
 	/* sync memory before activating the hardware for the new command*/
 	mb();
@@ -24,6 +24,8 @@
 #include <linux/input.h>
 #include <linux/interrupt.h>
 #include <linux/irq.h>
+#include <linux/kfifo.h>
+#include <linux/ktime.h>
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
@@ -120,6 +122,9 @@
 #define CT406_ALS_LOW_TO_HIGH_THRESHOLD	200	/* 200 lux */
 #define CT406_ALS_HIGH_TO_LOW_THRESHOLD	100	/* 100 lux */
 
+/* ALS samples held back while batching, must be a power of two */
+#define CT406_ALS_FIFO_SIZE		16
+
 #define CT40X_REV_ID_CT405		0x02
 #define CT40X_REV_ID_CT406a		0x03
 #define CT40X_REV_ID_CT406b		0x04
@@ -141,11 +146,17 @@ enum ct40x_hardware_type {
 	CT406_HW_TYPE,
 };
 
+struct ct406_als_sample {
+	unsigned int lux;
+	ktime_t timestamp;
+};
+
 struct ct406_data {
 	struct input_dev *dev;
 	struct i2c_client *client;
 	struct regulator *regulator;
 	struct work_struct work;
+	struct delayed_work als_flush_work;
 	struct workqueue_struct *workqueue;
 	struct ct406_platform_data *pdata;
 	struct miscdevice miscdevice;
@@ -177,6 +188,9 @@ struct ct406_data {
 	u8 prox_offset;
 	u16 pdata_max;
 	enum ct40x_hardware_type hw_type;
+	/* time of the interrupt being serviced */
+	ktime_t irq_timestamp;
+	DECLARE_KFIFO(als_fifo, struct ct406_als_sample, CT406_ALS_FIFO_SIZE);
 #ifdef CONFIG_HAS_EARLYSUSPEND
         struct early_suspend    ct406_early_suspend;
 #endif
@@ -223,6 +237,17 @@ static struct ct406_reg {
 static u32 ct406_debug = 0x00000000;
 module_param_named(debug_mask, ct406_debug, uint, 0644);
 
+/*
+ * Longest time in ms an ALS sample may be held back before it is reported,
+ * 0 reports every sample as it comes. The first sample after ALS is
+ * enabled always goes out at once, later ones are sent together when the
+ * fifo fills up or when the flush timer fires. The timer is
+ * deferrable so it never wakes an idle CPU on its own.
+ */
+static unsigned int ct406_als_batch_ms;
+module_param_named(als_batch_ms, ct406_als_batch_ms, uint, 0644);
+MODULE_PARM_DESC(als_batch_ms, "Max ALS report latency in ms, 0 = off.");
+
 static int ct406_i2c_read(struct ct406_data *ct, u8 *buf, int len)
 {
 	int err;
@@ -693,6 +718,47 @@ static int ct406_device_init(struct ct406_data *ct)
 	return 0;
 }
 
+static void ct406_input_als(struct ct406_data *ct,
+	struct ct406_als_sample *sample)
+{
+	input_event(ct->dev, EV_MSC, MSC_TIMESTAMP,
+		(u32)ktime_to_us(sample->timestamp));
+	input_event(ct->dev, EV_LED, LED_MISC, sample->lux);
+	input_sync(ct->dev);
+}
+
+static void ct406_flush_als(struct ct406_data *ct)
+{
+	struct ct406_als_sample sample;
+
+	while (kfifo_get(&ct->als_fifo, &sample))
+		ct406_input_als(ct, &sample);
+}
+
+static void ct406_queue_als(struct ct406_data *ct, unsigned int lux)
+{
+	struct ct406_als_sample sample = {
+		.lux = lux,
+		.timestamp = ct->irq_timestamp,
+	};
+
+	if (!ct406_als_batch_ms || !ct->als_first_report) {
+		ct406_flush_als(ct);
+		ct406_input_als(ct, &sample);
+		return;
+	}
+
+	if (kfifo_is_empty(&ct->als_fifo))
+		queue_delayed_work(ct->workqueue, &ct->als_flush_work,
+			msecs_to_jiffies(ct406_als_batch_ms));
+
+	kfifo_put(&ct->als_fifo, &sample);
+	if (kfifo_is_full(&ct->als_fifo)) {
+		cancel_delayed_work(&ct->als_flush_work);
+		ct406_flush_als(ct);
+	}
+}
+
 static void ct406_check_als_range(struct ct406_data *ct, unsigned int lux)
 {
 	if (ct->als_mode == CT406_ALS_MODE_LOW_LUX) {
@@ -762,6 +828,9 @@ static int ct406_disable_als(struct ct406_data *ct)
 	int error;
 	u8 reg_data[2] = {0};
 
+	cancel_delayed_work(&ct->als_flush_work);
+	ct406_flush_als(ct);
+
 	if (ct->als_enabled && ct->als_mode != CT406_ALS_MODE_SUNLIGHT) {
 		ct406_set_als_enable(ct, 0);
 
@@ -1076,8 +1145,7 @@ static void ct406_report_als(struct ct406_data *ct)
 	/* input.c filters consecutive LED_MISC values <=1. */
 	lux = (lux >= 2) ? lux : 2;
 
-	input_event(ct->dev, EV_LED, LED_MISC, lux);
-	input_sync(ct->dev);
+	ct406_queue_als(ct, lux);
 
 	if (ct->als_first_report == 0) {
 		/* write ALS interrupt persistence */
@@ -1380,6 +1448,7 @@ static irqreturn_t ct406_irq_handler(int irq, void *dev)
 {
 	struct ct406_data *ct = dev;
 
+	ct->irq_timestamp = ktime_get();
 	disable_irq_nosync(ct->client->irq);
 	queue_work(ct->workqueue, &ct->work);
 
@@ -1418,6 +1487,16 @@ static void ct406_work_func(struct work_struct *work)
 	enable_irq(ct->client->irq);
 }
 
+static void ct406_als_flush_work_func(struct work_struct *work)
+{
+	struct ct406_data *ct =
+		container_of(work, struct ct406_data, als_flush_work.work);
+
+	mutex_lock(&ct->mutex);
+	ct406_flush_als(ct);
+	mutex_unlock(&ct->mutex);
+}
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static void ct406_suspend(struct early_suspend *handler)
 {
@@ -1505,6 +1584,7 @@ static int ct406_probe(struct i2c_client *client,
 	ct->dev->name = "light-prox";
 	input_set_capability(ct->dev, EV_LED, LED_MISC);
 	input_set_capability(ct->dev, EV_MSC, MSC_RAW);
+	input_set_capability(ct->dev, EV_MSC, MSC_TIMESTAMP);
 
 	ct406_misc_data = ct;
 	ct->miscdevice.minor = MISC_DYNAMIC_MINOR;
@@ -1537,6 +1617,9 @@ static int ct406_probe(struct i2c_client *client,
 	}
 
 	INIT_WORK(&ct->work, ct406_work_func);
+	INIT_DELAYED_WORK_DEFERRABLE(&ct->als_flush_work,
+		ct406_als_flush_work_func);
+	INIT_KFIFO(ct->als_fifo);
 
 	error = request_irq(client->irq, ct406_irq_handler,
 		IRQF_TRIGGER_LOW, LD_CT406_NAME, ct);
@@ -1660,6 +1743,7 @@ static int ct406_remove(struct i2c_client *client)
 	i2c_set_clientdata(client, NULL);
 	free_irq(ct->client->irq, ct);
 
+	cancel_delayed_work_sync(&ct->als_flush_work);
 	destroy_workqueue(ct->workqueue);
 
 	misc_deregister(&ct->miscdevice);
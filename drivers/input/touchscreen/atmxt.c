@@ -34,9 +34,15 @@
 #include <linux/stat.h>
 #include <linux/string.h>
 #include <linux/firmware.h>
+#include <linux/cpufreq_interactive.h>
+#include <linux/frame_trace.h>
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
+#include <trace/events/frame.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/atmxt.h>
 
 static int atmxt_probe(struct i2c_client *client,
 		const struct i2c_device_id *id);
@@ -67,6 +73,7 @@ static int atmxt_register_inputs(struct atmxt_driver_data *dd,
 		uint8_t *rdat, int rsize);
 static int atmxt_request_irq(struct atmxt_driver_data *dd);
 static int atmxt_restart_ic(struct atmxt_driver_data *dd);
+static irqreturn_t atmxt_irq_stamp(int irq, void *handle);
 static irqreturn_t atmxt_isr(int irq, void *handle);
 static int atmxt_get_info_header(struct atmxt_driver_data *dd);
 static int atmxt_get_object_table(struct atmxt_driver_data *dd);
@@ -91,6 +98,7 @@ static int atmxt_save_data7(struct atmxt_driver_data *dd,
 		uint8_t *entry, uint8_t *reg);
 static int atmxt_save_data8(struct atmxt_driver_data *dd,
 		uint8_t *entry, uint8_t *reg);
+static int atmxt_save_data44(struct atmxt_driver_data *dd, uint8_t *entry);
 static int atmxt_save_data9(struct atmxt_driver_data *dd,
 		uint8_t *entry, uint8_t *reg);
 static void atmxt_compute_checksum(struct atmxt_driver_data *dd);
@@ -1018,7 +1026,7 @@ static int atmxt_request_irq(struct atmxt_driver_data *dd)
 		goto atmxt_request_irq_fail;
 	}
 
-	err = request_threaded_irq(dd->client->irq, NULL, atmxt_isr,
+	err = request_threaded_irq(dd->client->irq, atmxt_irq_stamp, atmxt_isr,
 			IRQF_TRIGGER_FALLING, ATMXT_I2C_NAME, dd);
 	if (err < 0) {
 		printk(KERN_ERR "%s: IRQ request failed.\n", __func__);
@@ -1272,6 +1280,15 @@ atmxt_restart_ic_fail:
 	return err;
 }
 
+static irqreturn_t atmxt_irq_stamp(int irq, void *handle)
+{
+	struct atmxt_driver_data *dd = handle;
+
+	dd->irq_time = ktime_get();
+	cpufreq_interactive_touch_boost();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t atmxt_isr(int irq, void *handle)
 {
 	struct atmxt_driver_data *dd = handle;
@@ -1793,7 +1810,8 @@ static int atmxt_i2c_write(struct atmxt_driver_data *dd,
 	int i = 0;
 	char *str = NULL;
 
-	dd->status = dd->status & ~(1 << ATMXT_SET_MESSAGE_POINTER);
+	dd->status = dd->status & ~((1 << ATMXT_SET_MESSAGE_POINTER) |
+		(1 << ATMXT_SET_COUNT_POINTER));
 
 	size_out = size + 2;
 	data_out = kzalloc(sizeof(uint8_t) * size_out, GFP_KERNEL);
@@ -1937,6 +1955,12 @@ static int atmxt_save_internal_data(struct atmxt_driver_data *dd)
 			usr_start_seen = true;
 			break;
 
+		case 44:
+			err = atmxt_save_data44(dd, &(dd->info_blk->data[i+0]));
+			if (err < 0)
+				goto atmxt_save_internal_data_fail;
+			break;
+
 		default:
 			break;
 		}
@@ -1972,6 +1996,13 @@ static int atmxt_save_internal_data(struct atmxt_driver_data *dd)
 		err = -ENODATA;
 	}
 
+	/* The count can only be read with the messages if T5 follows it */
+	if (((dd->addr->cnt[1] << 8) | dd->addr->cnt[0]) + 1 !=
+		((dd->addr->msg[1] << 8) | dd->addr->msg[0])) {
+		dd->addr->cnt[0] = 0;
+		dd->addr->cnt[1] = 0;
+	}
+
 atmxt_save_internal_data_fail:
 	return err;
 }
@@ -1987,6 +2018,16 @@ static int atmxt_save_data5(struct atmxt_driver_data *dd, uint8_t *entry)
 	return err;
 }
 
+static int atmxt_save_data44(struct atmxt_driver_data *dd, uint8_t *entry)
+{
+	int err = 0;
+
+	dd->addr->cnt[0] = entry[1];
+	dd->addr->cnt[1] = entry[2];
+
+	return err;
+}
+
 static int atmxt_save_data6(struct atmxt_driver_data *dd, uint8_t *entry)
 {
 	int err = 0;
@@ -2170,19 +2211,34 @@ static void atmxt_active_handler(struct atmxt_driver_data *dd)
 	int err = 0;
 	int i = 0;
 	uint8_t *msg_buf = NULL;
+	uint8_t *msgs = NULL;
 	int size = 0;
 	char *contents = NULL;
 	bool msg_fail = false;
 	int last_err = 0;
 	int msg_size = 0;
 	bool inv_msg_seen = false;
+	int count = 0;
+	int pending = 0;
+	int hdr = 0;
+	int xfers = 1;
+	uint8_t saved = 0;
 
 	atmxt_dbg(dd, ATMXT_DBG3, "%s: Starting active handler...\n", __func__);
 
+	/*
+	 * With T44 in front of T5 the message count is read in the same
+	 * transaction as the messages, so we know exactly how many are
+	 * pending instead of guessing from the number of active touches.
+	 */
+	if (dd->addr->cnt[0] || dd->addr->cnt[1])
+		hdr = 1;
+
 	msg_size = dd->data->max_msg_size;
-	size = (dd->rdat->active_touches + 1) * msg_size;
-	if (size == msg_size)
-		size = msg_size * 2;
+	count = dd->rdat->active_touches + 1;
+	if (count == 1)
+		count = 2;
+	size = hdr + (count * msg_size);
 
 	msg_buf = kzalloc(sizeof(uint8_t) * size, GFP_KERNEL);
 	if (msg_buf == NULL) {
@@ -2193,7 +2249,18 @@ static void atmxt_active_handler(struct atmxt_driver_data *dd)
 		goto atmxt_active_handler_fail;
 	}
 
-	if (!(dd->status & (1 << ATMXT_SET_MESSAGE_POINTER))) {
+	if (hdr && !(dd->status & (1 << ATMXT_SET_COUNT_POINTER))) {
+		err = atmxt_i2c_write(dd, dd->addr->cnt[0], dd->addr->cnt[1],
+			NULL, 0);
+		if (err < 0) {
+			printk(KERN_ERR
+				"%s: Failed to set message count pointer.\n",
+				__func__);
+			goto atmxt_active_handler_fail;
+		}
+
+		dd->status = dd->status | (1 << ATMXT_SET_COUNT_POINTER);
+	} else if (!hdr && !(dd->status & (1 << ATMXT_SET_MESSAGE_POINTER))) {
 		err = atmxt_i2c_write(dd, dd->addr->msg[0], dd->addr->msg[1],
 			NULL, 0);
 		if (err < 0) {
@@ -2212,8 +2279,47 @@ static void atmxt_active_handler(struct atmxt_driver_data *dd)
 		goto atmxt_active_handler_fail;
 	}
 
-	if (msg_buf[0] == 0xFF) {
-		contents = atmxt_msg2str(msg_buf, size);
+	if (hdr) {
+		pending = msg_buf[0];
+		if (pending > count) {
+			size = hdr + (pending * msg_size);
+			msgs = krealloc(msg_buf, size, GFP_KERNEL);
+			if (msgs == NULL) {
+				printk(KERN_ERR
+					"%s: Unable to grow message buffer.\n",
+					__func__);
+				err = -ENOMEM;
+				goto atmxt_active_handler_fail;
+			}
+			msg_buf = msgs;
+
+			/*
+			 * The next read starts at T44 again, so its count
+			 * byte lands on the last byte already read.
+			 */
+			i = hdr + (count * msg_size) - 1;
+			saved = msg_buf[i];
+			err = atmxt_i2c_read(dd, &(msg_buf[i]), size - i);
+			msg_buf[i] = saved;
+			if (err < 0) {
+				printk(KERN_ERR
+					"%s: Failed to read remaining messages.\n",
+					__func__);
+				goto atmxt_active_handler_fail;
+			}
+			xfers++;
+		}
+		count = pending;
+		size = hdr + (count * msg_size);
+	}
+
+	msgs = &(msg_buf[hdr]);
+	size -= hdr;
+	trace_atmxt_msg_read(count, xfers,
+		ktime_to_us(ktime_sub(ktime_get(), dd->irq_time)));
+
+	if (!hdr && msgs[0] == 0xFF) {
+		contents = atmxt_msg2str(msgs, size);
 		printk(KERN_ERR "%s: Received invalid data:  %s.\n",
 			__func__, contents);
 		err = -EINVAL;
@@ -2221,7 +2327,7 @@ static void atmxt_active_handler(struct atmxt_driver_data *dd)
 	}
 
 	for (i = 0; i < size; i += msg_size) {
-		if (msg_buf[i] == 0xFF) {
+		if (msgs[i] == 0xFF) {
 			atmxt_dbg(dd, ATMXT_DBG3, "%s: Reached 0xFF message.\n",
 				__func__);
 			inv_msg_seen = true;
@@ -2239,7 +2345,7 @@ static void atmxt_active_handler(struct atmxt_driver_data *dd)
 				(i / msg_size) + 1);
 		}
 
-		err = atmxt_process_message(dd, &(msg_buf[i]), msg_size);
+		err = atmxt_process_message(dd, &(msgs[i]), msg_size);
 		if (err < 0) {
 			printk(KERN_ERR
 				"%s: Processing message %d failed %s %d.\n",
@@ -2392,6 +2498,9 @@ static void atmxt_report_touches(struct atmxt_driver_data *dd)
 		input_mt_sync(dd->in_dev);
 
 	input_sync(dd->in_dev);
+	trace_atmxt_input_sync(dd->rdat->active_touches,
+		ktime_to_us(ktime_sub(ktime_get(), dd->irq_time)));
+	trace_frame_input(frame_trace_input(), dd->rdat->active_touches);
 
 	return;
 }
@@ -25,6 +25,7 @@
 #include <linux/i2c.h>
 #include <linux/input.h>
 #include <linux/mutex.h>
+#include <linux/ktime.h>
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
@@ -56,6 +57,7 @@
 #define ATMXT_RECEIVED_CALIBRATION  6
 #define ATMXT_RESTART_REQUIRED      7
 #define ATMXT_SET_MESSAGE_POINTER   8
+#define ATMXT_SET_COUNT_POINTER     9
 
 #define ATMXT_I2C_ATTEMPTS          10
 #define ATMXT_I2C_WAIT_TIME         50
@@ -120,6 +122,7 @@ struct atmxt_info_block {
 
 struct atmxt_addr {
 	uint8_t         msg[2];
+	uint8_t         cnt[2];
 	uint8_t         pwr[2];
 	uint8_t         rst[2];
 	uint8_t         nvm[2];
@@ -181,6 +184,7 @@ struct atmxt_driver_data {
 
 	uint16_t        status;
 	uint16_t        settings;
+	ktime_t         irq_time;
 } __packed;
 
 #endif /* _LINUX_ATMXT_H */
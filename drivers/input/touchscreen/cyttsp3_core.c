@@ -27,6 +27,7 @@
  *
  */
 
+#include <linux/cpufreq_interactive.h>
 #include <linux/delay.h>
 #include <linux/input.h>
 #include <linux/gpio.h>
@@ -2515,6 +2516,12 @@ static int _cyttsp_startup(struct cyttsp *ts) {
 	return retval;
 }
 
+static irqreturn_t cyttsp_hard_irq(int irq, void *handle)
+{
+	cpufreq_interactive_touch_boost();
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t cyttsp_irq(int irq, void *handle) {
 	struct cyttsp *ts = handle;
 
@@ -3069,7 +3076,7 @@ void *cyttsp_core_init(struct cyttsp_bus_ops *bus_ops, struct device *dev,
 	INIT_WORK(&ts->cyttsp_resume_startup_work, cyttsp_ts_work_func);
 	cyttsp_dbg(ts, CY_DBG_LVL_3, "%s: Initialize IRQ: %d, name: %s\n",
 			__func__, ts->irq, ts->input->name);
-	retval = request_threaded_irq(ts->irq, NULL, cyttsp_irq,
+	retval = request_threaded_irq(ts->irq, cyttsp_hard_irq, cyttsp_irq,
 			IRQF_TRIGGER_LOW | IRQF_ONESHOT,
 			ts->input->name, ts);
 	if (retval < 0) {
@@ -21,6 +21,7 @@
 
 #define DEBUG
 #include <linux/completion.h>
+#include <linux/cpufreq_interactive.h>
 #include <linux/delay.h>
 #include <linux/earlysuspend.h>
 #include <linux/firmware.h>
@@ -231,6 +232,8 @@ static irqreturn_t mms_ts_primary_handler(int irq, void *handle)
 {
 	struct mms_ts_info *ts = (struct mms_ts_info *)handle;
 
+	cpufreq_interactive_touch_boost();
+
 	if (ts->pdata->get_dbg_lvl &&
 		(ts->pdata->get_dbg_lvl() >= 1) &&
 			(ts->pdata->int_time))
@@ -61,7 +61,7 @@ static int msm_csid_cid_lut(
 	int rc = 0, i = 0;
 	uint32_t val = 0;
 
-	for (i = 0; i < csid_lut_params->num_cid && i < 4; i++) {
+	for (i = 0; i < csid_lut_params->num_cid && i < CSID_MAX_CID; i++) {
 		if (csid_lut_params->vc_cfg[i].dt < 0x12 ||
 			csid_lut_params->vc_cfg[i].dt > 0x37) {
 			CDBG("%s: unsupported data type 0x%x\n",
@@ -82,6 +82,38 @@ static int msm_csid_cid_lut(
 	return rc;
 }
 
+/*
+ * A mode switch usually keeps the lanes and the data types: nothing to
+ * reprogram, and no need to wait for the core to settle again.
+ */
+static bool msm_csid_cfg_cached(struct csid_device *csid_dev,
+	struct msm_camera_csid_params *csid_params)
+{
+	struct msm_camera_csid_lut_params *lut = &csid_params->lut_params;
+	int num_cid = min_t(int, lut->num_cid, CSID_MAX_CID);
+
+	if (!csid_dev->cfg_valid ||
+		csid_dev->cur_params.lane_cnt != csid_params->lane_cnt ||
+		csid_dev->cur_params.lane_assign != csid_params->lane_assign ||
+		csid_dev->cur_params.lut_params.num_cid != lut->num_cid)
+		return false;
+	return !memcmp(csid_dev->cur_vc_cfg, lut->vc_cfg,
+		num_cid * sizeof(*lut->vc_cfg));
+}
+
+static void msm_csid_cfg_save(struct csid_device *csid_dev,
+	struct msm_camera_csid_params *csid_params)
+{
+	struct msm_camera_csid_lut_params *lut = &csid_params->lut_params;
+	int num_cid = min_t(int, lut->num_cid, CSID_MAX_CID);
+
+	csid_dev->cur_params = *csid_params;
+	csid_dev->cur_params.lut_params.vc_cfg = csid_dev->cur_vc_cfg;
+	memcpy(csid_dev->cur_vc_cfg, lut->vc_cfg,
+		num_cid * sizeof(*lut->vc_cfg));
+	csid_dev->cfg_valid = true;
+}
+
 static int msm_csid_config(struct csid_cfg_params *cfg_params)
 {
 	int rc = 0;
@@ -92,6 +124,9 @@ static int msm_csid_config(struct csid_cfg_params *cfg_params)
 	csid_dev = v4l2_get_subdevdata(cfg_params->subdev);
 	csidbase = csid_dev->base;
 	csid_params = cfg_params->parms;
+	if (msm_csid_cfg_cached(csid_dev, csid_params))
+		return 0;
+
 	val = csid_params->lane_cnt - 1;
 	val |= csid_params->lane_assign << 2;
 	val |= 0x1 << 10;
@@ -109,6 +144,7 @@ static int msm_csid_config(struct csid_cfg_params *cfg_params)
 	msm_io_w(0x7fF10800, csidbase + CSID_IRQ_CLEAR_CMD_ADDR);
 
 	msleep(20);
+	msm_csid_cfg_save(csid_dev, csid_params);
 	return rc;
 }
 
@@ -181,6 +217,7 @@ static int msm_csid_init(struct v4l2_subdev *sd, uint32_t *csid_version)
 		goto clk_enable_failed;
 	}
 
+	csid_dev->cfg_valid = false;
 	csid_dev->hw_version =
 		msm_io_r(csid_dev->base + CSID_HW_VERSION_ADDR);
 	*csid_version = csid_dev->hw_version;
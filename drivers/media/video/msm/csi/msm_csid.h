@@ -16,6 +16,9 @@
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <media/v4l2-subdev.h>
+#include <mach/camera.h>
+
+#define CSID_MAX_CID 4
 
 struct csid_device {
 	struct platform_device *pdev;
@@ -27,6 +30,10 @@ struct csid_device {
 	void __iomem *base;
 	struct mutex mutex;
 	uint32_t hw_version;
+	/* configuration programmed since init, a repeat is skipped */
+	bool cfg_valid;
+	struct msm_camera_csid_params cur_params;
+	struct msm_camera_csid_vc_cfg cur_vc_cfg[CSID_MAX_CID];
 
 	struct clk *csid_clk[5];
 };
@@ -71,6 +71,10 @@ int msm_csiphy_config(struct csiphy_cfg_params *cfg_params)
 			__func__, csiphy_params->lane_cnt);
 		return rc;
 	}
+	if (csiphy_dev->cfg_valid &&
+		csiphy_dev->cur_lane_cnt == csiphy_params->lane_cnt &&
+		csiphy_dev->cur_settle_cnt == csiphy_params->settle_cnt)
+		return rc;
 
 	val = 0x3;
 	msm_io_w((((1 << csiphy_params->lane_cnt) - 1) << 2) | val,
@@ -99,6 +103,9 @@ int msm_csiphy_config(struct csiphy_cfg_params *cfg_params)
 		msm_io_w(0x6F,
 			csiphybase + MIPI_CSIPHY_INTERRUPT_CLEAR0_ADDR + 0x4*i);
 	}
+	csiphy_dev->cur_lane_cnt = csiphy_params->lane_cnt;
+	csiphy_dev->cur_settle_cnt = csiphy_params->settle_cnt;
+	csiphy_dev->cfg_valid = true;
 	return rc;
 }
 
@@ -170,6 +177,7 @@ static int msm_csiphy_init(struct v4l2_subdev *sd)
 		csiphy_dev->base = NULL;
 		return rc;
 	}
+	csiphy_dev->cfg_valid = false;
 
 #if DBG_CSIPHY
 	enable_irq(csiphy_dev->irq->start);
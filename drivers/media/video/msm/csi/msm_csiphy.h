@@ -27,6 +27,10 @@ struct csiphy_device {
 	struct mutex mutex;
 
 	struct clk *csiphy_clk[2];
+	/* configuration programmed since init, a repeat is skipped */
+	bool cfg_valid;
+	uint8_t cur_lane_cnt;
+	uint8_t cur_settle_cnt;
 };
 
 struct csiphy_cfg_params {
@@ -12,6 +12,9 @@
 
 #include "msm_camera_i2c.h"
 
+/* data bytes of one auto-increment write out of a register table */
+#define MSM_CAMERA_I2C_BURST_MAX 64
+
 #ifdef LOG_I2C
 static void log_buf(bool tx, unsigned char *buf, int len)
 {
@@ -295,14 +298,74 @@ int32_t msm_camera_i2c_poll(struct msm_camera_i2c_client *client,
 	return rc;
 }
 
+static enum msm_camera_i2c_data_type msm_camera_i2c_burst_dt(
+	struct msm_camera_i2c_reg_conf *reg_conf,
+	enum msm_camera_i2c_data_type data_type)
+{
+	enum msm_camera_i2c_data_type dt = reg_conf->dt ? reg_conf->dt :
+		data_type;
+
+	if (reg_conf->cmd_type != MSM_CAMERA_I2C_CMD_WRITE ||
+		reg_conf->reg_addr >= 0xFFFE)
+		return 0;
+	if (dt != MSM_CAMERA_I2C_BYTE_DATA && dt != MSM_CAMERA_I2C_WORD_DATA)
+		return 0;
+	return dt;
+}
+
+/*
+ * Sensor tables are mostly runs of writes to consecutive registers: send
+ * such a run as one auto-increment transfer instead of one per register.
+ * The FFFF/FFFE pseudo registers never take part, txdata has to see them.
+ */
+static int msm_camera_i2c_write_burst(struct msm_camera_i2c_client *client,
+	struct msm_camera_i2c_reg_conf *reg_conf_tbl, uint16_t size,
+	enum msm_camera_i2c_data_type data_type, int32_t *rc)
+{
+	uint8_t buf[MSM_CAMERA_I2C_BURST_MAX];
+	enum msm_camera_i2c_data_type dt;
+	uint16_t addr = reg_conf_tbl->reg_addr;
+	int n, len = 0;
+
+	if (client->addr_type != MSM_CAMERA_I2C_WORD_ADDR)
+		return 0;
+	dt = msm_camera_i2c_burst_dt(reg_conf_tbl, data_type);
+	if (!dt)
+		return 0;
+
+	for (n = 0; n < size; n++, reg_conf_tbl++) {
+		if (msm_camera_i2c_burst_dt(reg_conf_tbl, data_type) != dt ||
+			reg_conf_tbl->reg_addr != (uint16_t)(addr + len) ||
+			len + dt > MSM_CAMERA_I2C_BURST_MAX)
+			break;
+		if (dt == MSM_CAMERA_I2C_WORD_DATA)
+			buf[len++] = reg_conf_tbl->reg_data >> BITS_PER_BYTE;
+		buf[len++] = reg_conf_tbl->reg_data;
+	}
+	if (n < 2)
+		return 0;
+
+	*rc = msm_camera_i2c_write_seq(client, addr, buf, len);
+	return n;
+}
+
 int32_t msm_camera_i2c_write_tbl(struct msm_camera_i2c_client *client,
 	struct msm_camera_i2c_reg_conf *reg_conf_tbl, uint16_t size,
 	enum msm_camera_i2c_data_type data_type)
 {
-	int i;
+	int i, n;
 	int32_t rc = -EFAULT;
 	for (i = 0; i < size; i++) {
 		enum msm_camera_i2c_data_type dt;
+		n = msm_camera_i2c_write_burst(client, reg_conf_tbl, size - i,
+			data_type, &rc);
+		if (n) {
+			if (rc < 0)
+				break;
+			i += n - 1;
+			reg_conf_tbl += n;
+			continue;
+		}
 		if (reg_conf_tbl->cmd_type == MSM_CAMERA_I2C_CMD_POLL) {
 			rc = msm_camera_i2c_poll(client, reg_conf_tbl->reg_addr,
 				reg_conf_tbl->reg_data, reg_conf_tbl->dt);
@@ -92,6 +92,7 @@ struct isp_msg_stats {
 	uint32_t    id;
 	uint32_t    buffer;
 	uint32_t    frameCounter;
+	struct timeval sof_ts;
 };
 
 struct msm_free_buf {
@@ -148,7 +149,8 @@ enum msm_buffer_state {
 	MSM_BUFFER_STATE_PREPARED,
 	MSM_BUFFER_STATE_QUEUED,
 	MSM_BUFFER_STATE_RESERVED,
-	MSM_BUFFER_STATE_DEQUEUED
+	MSM_BUFFER_STATE_DEQUEUED,
+	MSM_BUFFER_STATE_HELD
 };
 
 /* buffer for one video frame */
@@ -159,6 +161,8 @@ struct msm_frame_buffer {
 	enum v4l2_mbus_pixelcode  pxlcode;
 	enum msm_buffer_state state;
 	int active;
+	/* ch0 address handed to the vfe when reserved */
+	uint32_t rsv_paddr;
 };
 
 struct msm_isp_color_fmt {
@@ -171,6 +175,8 @@ struct msm_isp_color_fmt {
 };
 
 struct msm_mctl_pp_frame_info {
+	/* link in the queue of the post processing engine */
+	struct list_head list;
 	int user_cmd;
 	struct msm_pp_frame src_frame;
 	struct msm_pp_frame dest_frame;
@@ -284,6 +290,14 @@ struct msm_cam_v4l2_dev_inst {
 	struct vb2_queue vid_bufq;
 	spinlock_t vq_irqlock;
 	struct list_head free_vq;
+	/* reserved buffers in the order they were handed to the vfe */
+	struct msm_frame_buffer *rsv_ring[VIDEO_MAX_FRAME];
+	int rsv_head;
+	int rsv_cnt;
+	/* done frames held back for zero shutter lag, oldest first */
+	struct list_head zsl_vq;
+	int zsl_depth;
+	int zsl_cnt;
 	struct v4l2_format vid_fmt;
 	/* sensor pixel code*/
 	enum v4l2_mbus_pixelcode sensor_pxlcode;
@@ -462,7 +476,7 @@ unsigned long msm_pmem_stats_vtop_lookup(
 				unsigned long buffer,
 				int fd);
 unsigned long msm_pmem_stats_ptov_lookup(struct msm_sync *sync,
-						unsigned long addr, int *fd);
+					unsigned long addr, int *fd, int8_t *idx);
 
 int msm_vfe_subdev_init(struct v4l2_subdev *sd, void *data,
 					struct platform_device *pdev);
@@ -492,6 +506,11 @@ struct msm_frame_buffer *msm_mctl_buf_find(
 	struct msm_cam_v4l2_dev_inst *pcam_inst, int del_buf,
 	int msg_type, struct msm_free_buf *fbuf);
 void msm_mctl_gettimeofday(struct timeval *tv);
+int msm_mctl_zsl_cfg(struct msm_cam_media_controller *pmctl,
+			void __user *arg);
+int msm_mctl_zsl_pick(struct msm_cam_media_controller *pmctl,
+			void __user *arg);
+void msm_mctl_zsl_flush(struct msm_cam_v4l2_dev_inst *pcam_inst);
 struct msm_frame_buffer *msm_mctl_get_free_buf(
 		struct msm_cam_media_controller *pmctl,
 		int msg_type);
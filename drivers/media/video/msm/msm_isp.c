@@ -342,17 +342,23 @@ static int msm_isp_notify_vfe(struct v4l2_subdev *sd,
 
 		isp_event->isp_data.isp_msg.msg_id = MSG_ID_STATS_COMPOSITE;
 		stats->aec.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->aec.buff, &(stats->aec.fd));
+					stats->aec.buff, &(stats->aec.fd),
+					&stats->meta.aec_idx);
 		stats->awb.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->awb.buff, &(stats->awb.fd));
+					stats->awb.buff, &(stats->awb.fd),
+					&stats->meta.awb_idx);
 		stats->af.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->af.buff, &(stats->af.fd));
+					stats->af.buff, &(stats->af.fd),
+					&stats->meta.af_idx);
 		stats->ihist.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->ihist.buff, &(stats->ihist.fd));
+					stats->ihist.buff, &(stats->ihist.fd),
+					&stats->meta.ihist_idx);
 		stats->rs.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->rs.buff, &(stats->rs.fd));
+					stats->rs.buff, &(stats->rs.fd),
+					&stats->meta.rs_idx);
 		stats->cs.buff = msm_pmem_stats_ptov_lookup(&pmctl->sync,
-					stats->cs.buff, &(stats->cs.fd));
+					stats->cs.buff, &(stats->cs.fd),
+					&stats->meta.cs_idx);
 
 		stats_buf = kmalloc(sizeof(struct msm_stats_buf), GFP_ATOMIC);
 		if (!stats_buf) {
@@ -369,37 +375,48 @@ static int msm_isp_notify_vfe(struct v4l2_subdev *sd,
 	case NOTIFY_VFE_MSG_STATS: {
 		struct msm_stats_buf stats;
 		struct isp_msg_stats *isp_stats = (struct isp_msg_stats *)arg;
+		int8_t idx;
 
 		isp_event->isp_data.isp_msg.msg_id = isp_stats->id;
 		isp_event->isp_data.isp_msg.frame_id =
 			isp_stats->frameCounter;
+		memset(&stats, 0, sizeof(stats));
+		memset(&stats.meta, -1, sizeof(stats.meta));
+		stats.frame_id = isp_stats->frameCounter;
+		stats.meta.sof_ts = isp_stats->sof_ts;
 		stats.buffer = msm_pmem_stats_ptov_lookup(&pmctl->sync,
 						isp_stats->buffer,
-						&(stats.fd));
+						&(stats.fd), &idx);
 		switch (isp_stats->id) {
 		case MSG_ID_STATS_AEC:
 			stats.aec.buff = stats.buffer;
 			stats.aec.fd = stats.fd;
+			stats.meta.aec_idx = idx;
 			break;
 		case MSG_ID_STATS_AF:
 			stats.af.buff = stats.buffer;
 			stats.af.fd = stats.fd;
+			stats.meta.af_idx = idx;
 			break;
 		case MSG_ID_STATS_AWB:
 			stats.awb.buff = stats.buffer;
 			stats.awb.fd = stats.fd;
+			stats.meta.awb_idx = idx;
 			break;
 		case MSG_ID_STATS_IHIST:
 			stats.ihist.buff = stats.buffer;
 			stats.ihist.fd = stats.fd;
+			stats.meta.ihist_idx = idx;
 			break;
 		case MSG_ID_STATS_RS:
 			stats.rs.buff = stats.buffer;
 			stats.rs.fd = stats.fd;
+			stats.meta.rs_idx = idx;
 			break;
 		case MSG_ID_STATS_CS:
 			stats.cs.buff = stats.buffer;
 			stats.cs.fd = stats.fd;
+			stats.meta.cs_idx = idx;
 			break;
 		default:
 			pr_err("%s: Invalid msg type", __func__);
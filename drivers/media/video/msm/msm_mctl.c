@@ -433,6 +433,12 @@ static int msm_mctl_cmd(struct msm_cam_media_controller *p_mctl,
 		rc = msm_mctl_pp_mctl_divert_done(p_mctl,
 			(void __user *)arg);
 		break;
+	case MSM_CAM_IOCTL_ZSL_CFG:
+		rc = msm_mctl_zsl_cfg(p_mctl, (void __user *)arg);
+		break;
+	case MSM_CAM_IOCTL_ZSL_PICK:
+		rc = msm_mctl_zsl_pick(p_mctl, (void __user *)arg);
+		break;
 			/* ISFIF config*/
 	default:
 		/* ISP config*/
@@ -1281,6 +1287,7 @@ static int msm_mctl_v4l2_streamoff(struct file *f, void *pctx,
 	/* first turn of HW (VFE/sensor) streaming so that buffers are
 		not in use when we free the buffers */
 	pcam_inst->streamon = 0;
+	msm_mctl_zsl_flush(pcam_inst);
 	/* stop buffer streaming */
 	rc = vb2_streamoff(&pcam_inst->vid_bufq, buf_type);
 	D("%s, videobuf_streamoff returns %d\n", __func__, rc);
@@ -18,6 +18,7 @@
 #include <linux/spinlock.h>
 #include <linux/videodev2.h>
 #include <linux/vmalloc.h>
+#include <linux/uaccess.h>
 
 #include <media/v4l2-dev.h>
 #include <media/v4l2-ioctl.h>
@@ -248,6 +249,11 @@ static void msm_vb2_ops_buf_cleanup(struct vb2_buffer *vb)
 		}
 		spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
 	}
+	/* the ring must not point at buffers that are about to go away */
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	pcam_inst->rsv_head = 0;
+	pcam_inst->rsv_cnt = 0;
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
 	for (i = 0; i < vb->num_planes; i++) {
 		mem = vb2_plane_cookie(vb, i);
 		videobuf2_pmem_contig_user_put(mem, pcam->mctl.client);
@@ -317,6 +323,11 @@ static int msm_vbqueue_init(struct msm_cam_v4l2_dev_inst *pcam_inst,
 
 	spin_lock_init(&pcam_inst->vq_irqlock);
 	INIT_LIST_HEAD(&pcam_inst->free_vq);
+	pcam_inst->rsv_head = 0;
+	pcam_inst->rsv_cnt = 0;
+	INIT_LIST_HEAD(&pcam_inst->zsl_vq);
+	pcam_inst->zsl_depth = 0;
+	pcam_inst->zsl_cnt = 0;
 	videobuf2_queue_pmem_contig_init(q, type,
 					&msm_vb2_ops,
 					sizeof(struct msm_frame_buffer),
@@ -350,6 +361,72 @@ void msm_mctl_gettimeofday(struct timeval *tv)
 	tv->tv_usec = ts.tv_nsec/1000;
 }
 
+/*
+ * The vfe hands buffers back in the order they were reserved for it, so
+ * remembering that order lets the frame done path find its buffer at the
+ * head of the ring instead of walking free_vq. Entries are not removed
+ * when a buffer is put back or freed, they are just skipped once the
+ * buffer is no longer reserved or no longer ours. Called with vq_irqlock
+ * held.
+ */
+static void msm_mctl_rsv_push(struct msm_cam_v4l2_dev_inst *pcam_inst,
+			      struct msm_frame_buffer *buf, uint32_t paddr)
+{
+	int tail;
+
+	buf->rsv_paddr = paddr;
+	if (pcam_inst->rsv_cnt == VIDEO_MAX_FRAME) {
+		/* drop the oldest, the list walk still finds it */
+		pcam_inst->rsv_head = (pcam_inst->rsv_head + 1) %
+			VIDEO_MAX_FRAME;
+		pcam_inst->rsv_cnt--;
+	}
+	tail = (pcam_inst->rsv_head + pcam_inst->rsv_cnt) % VIDEO_MAX_FRAME;
+	pcam_inst->rsv_ring[tail] = buf;
+	pcam_inst->rsv_cnt++;
+}
+
+static int msm_mctl_rsv_valid(struct msm_frame_buffer *buf)
+{
+	return buf->state == MSM_BUFFER_STATE_RESERVED &&
+		!list_empty(&buf->list);
+}
+
+static struct msm_frame_buffer *msm_mctl_rsv_find(
+	struct msm_cam_v4l2_dev_inst *pcam_inst, uint32_t paddr)
+{
+	struct msm_frame_buffer *buf;
+	int i, j, pos;
+
+	/* stale entries at the head go first */
+	while (pcam_inst->rsv_cnt &&
+		!msm_mctl_rsv_valid(pcam_inst->rsv_ring[pcam_inst->rsv_head])) {
+		pcam_inst->rsv_head = (pcam_inst->rsv_head + 1) %
+			VIDEO_MAX_FRAME;
+		pcam_inst->rsv_cnt--;
+	}
+
+	for (i = 0; i < pcam_inst->rsv_cnt; i++) {
+		pos = (pcam_inst->rsv_head + i) % VIDEO_MAX_FRAME;
+		buf = pcam_inst->rsv_ring[pos];
+		if (!msm_mctl_rsv_valid(buf) || buf->rsv_paddr != paddr)
+			continue;
+
+		/* close the gap, nearly always i == 0 */
+		for (j = i; j > 0; j--) {
+			pos = (pcam_inst->rsv_head + j) % VIDEO_MAX_FRAME;
+			pcam_inst->rsv_ring[pos] = pcam_inst->rsv_ring
+				[(pos + VIDEO_MAX_FRAME - 1) % VIDEO_MAX_FRAME];
+		}
+		pcam_inst->rsv_head = (pcam_inst->rsv_head + 1) %
+			VIDEO_MAX_FRAME;
+		pcam_inst->rsv_cnt--;
+		return buf;
+	}
+
+	return NULL;
+}
+
 struct msm_frame_buffer *msm_mctl_buf_find(
 	struct msm_cam_media_controller *pmctl,
 	struct msm_cam_v4l2_dev_inst *pcam_inst, int del_buf,
@@ -361,8 +438,16 @@ struct msm_frame_buffer *msm_mctl_buf_find(
 	uint32_t buf_idx, offset = 0;
 	struct videobuf2_contig_pmem *mem;
 
-	/* we actually need a list, not a queue */
 	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	buf = msm_mctl_rsv_find(pcam_inst, fbuf->ch_paddr[0]);
+	if (buf) {
+		if (del_buf)
+			list_del_init(&buf->list);
+		spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+		return buf;
+	}
+
+	/* not reserved through the ring, we actually need a list */
 	list_for_each_entry_safe(buf, tmp,
 			&pcam_inst->free_vq, list) {
 		buf_idx = buf->vidbuf.v4l2_buf.index;
@@ -391,6 +476,178 @@ struct msm_frame_buffer *msm_mctl_buf_find(
 	return NULL;
 }
 
+/*
+ * Zero shutter lag: while the depth is set, frames the vfe is done with
+ * are kept on zsl_vq instead of going to the user. Once more than depth
+ * frames are held the oldest is put back on free_vq for the vfe to fill
+ * again, so the user's own buffers for the stream form the ring and
+ * nothing is copied. MSM_CAM_IOCTL_ZSL_PICK then hands out the frame
+ * closest to the moment the shutter was pressed.
+ */
+static int msm_mctl_zsl_hold(struct msm_cam_v4l2_dev_inst *pcam_inst,
+			     struct msm_frame_buffer *buf)
+{
+	struct msm_frame_buffer *old;
+	unsigned long flags = 0;
+	int held = 0;
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	if (pcam_inst->zsl_depth) {
+		buf->state = MSM_BUFFER_STATE_HELD;
+		list_add_tail(&buf->list, &pcam_inst->zsl_vq);
+		if (++pcam_inst->zsl_cnt > pcam_inst->zsl_depth) {
+			old = list_first_entry(&pcam_inst->zsl_vq,
+				struct msm_frame_buffer, list);
+			list_move_tail(&old->list, &pcam_inst->free_vq);
+			old->state = MSM_BUFFER_STATE_QUEUED;
+			pcam_inst->zsl_cnt--;
+		}
+		held = 1;
+	}
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+	return held;
+}
+
+/* Give every held frame back to the vfe, called when zsl is turned off */
+void msm_mctl_zsl_flush(struct msm_cam_v4l2_dev_inst *pcam_inst)
+{
+	struct msm_frame_buffer *buf, *tmp;
+	unsigned long flags = 0;
+
+	/* nothing can be held before the format was set */
+	if (!pcam_inst->vbqueue_initialized)
+		return;
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	pcam_inst->zsl_depth = 0;
+	list_for_each_entry_safe(buf, tmp, &pcam_inst->zsl_vq, list) {
+		list_move_tail(&buf->list, &pcam_inst->free_vq);
+		buf->state = MSM_BUFFER_STATE_QUEUED;
+	}
+	pcam_inst->zsl_cnt = 0;
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+}
+
+static struct msm_cam_v4l2_dev_inst *msm_mctl_zsl_inst(
+	struct msm_cam_media_controller *pmctl, uint32_t image_mode)
+{
+	int idx;
+
+	if (image_mode >= MSM_MAX_IMG_MODE)
+		return NULL;
+
+	idx = msm_mctl_img_mode_to_inst_index(pmctl, image_mode, 0);
+	if (idx < 0)
+		return NULL;
+
+	return pmctl->sync.pcam_sync->dev_inst[idx];
+}
+
+int msm_mctl_zsl_cfg(struct msm_cam_media_controller *pmctl,
+		     void __user *arg)
+{
+	struct msm_cam_v4l2_dev_inst *pcam_inst;
+	struct msm_cam_zsl_cfg cfg;
+	unsigned long flags = 0;
+
+	if (copy_from_user(&cfg, arg, sizeof(cfg))) {
+		ERR_COPY_FROM_USER();
+		return -EFAULT;
+	}
+
+	pcam_inst = msm_mctl_zsl_inst(pmctl, cfg.image_mode);
+	if (!pcam_inst) {
+		pr_err("%s Invalid instance for image mode %d\n",
+			__func__, cfg.image_mode);
+		return -EINVAL;
+	}
+
+	/* the vfe needs at least two buffers of its own to ping pong */
+	if (cfg.depth && (cfg.depth > VIDEO_MAX_FRAME ||
+		cfg.depth + 2 > pcam_inst->buf_count)) {
+		pr_err("%s depth %d too deep for %d buffers\n", __func__,
+			cfg.depth, pcam_inst->buf_count);
+		return -EINVAL;
+	}
+
+	if (!cfg.depth) {
+		msm_mctl_zsl_flush(pcam_inst);
+		return 0;
+	}
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	pcam_inst->zsl_depth = cfg.depth;
+	while (pcam_inst->zsl_cnt > pcam_inst->zsl_depth) {
+		struct msm_frame_buffer *old = list_first_entry(
+			&pcam_inst->zsl_vq, struct msm_frame_buffer, list);
+
+		list_move_tail(&old->list, &pcam_inst->free_vq);
+		old->state = MSM_BUFFER_STATE_QUEUED;
+		pcam_inst->zsl_cnt--;
+	}
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+	D("%s inst=%p depth=%d\n", __func__, pcam_inst, cfg.depth);
+	return 0;
+}
+
+static int64_t msm_mctl_zsl_delta(struct timeval *a, struct timeval *b)
+{
+	int64_t delta = ((int64_t)a->tv_sec - b->tv_sec) * USEC_PER_SEC +
+		(a->tv_usec - b->tv_usec);
+
+	return delta < 0 ? -delta : delta;
+}
+
+int msm_mctl_zsl_pick(struct msm_cam_media_controller *pmctl,
+		      void __user *arg)
+{
+	struct msm_cam_v4l2_dev_inst *pcam_inst;
+	struct msm_frame_buffer *buf, *best = NULL;
+	struct msm_cam_zsl_pick pick;
+	int64_t delta, best_delta = 0;
+	unsigned long flags = 0;
+
+	if (copy_from_user(&pick, arg, sizeof(pick))) {
+		ERR_COPY_FROM_USER();
+		return -EFAULT;
+	}
+
+	pcam_inst = msm_mctl_zsl_inst(pmctl, pick.image_mode);
+	if (!pcam_inst) {
+		pr_err("%s Invalid instance for image mode %d\n",
+			__func__, pick.image_mode);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&pcam_inst->vq_irqlock, flags);
+	list_for_each_entry(buf, &pcam_inst->zsl_vq, list) {
+		delta = msm_mctl_zsl_delta(&buf->vidbuf.v4l2_buf.timestamp,
+			&pick.timestamp);
+		if (!best || delta < best_delta) {
+			best = buf;
+			best_delta = delta;
+		}
+	}
+	if (best) {
+		list_del_init(&best->list);
+		pcam_inst->zsl_cnt--;
+		pick.timestamp = best->vidbuf.v4l2_buf.timestamp;
+		pick.frame_id = best->vidbuf.v4l2_buf.sequence;
+	}
+	spin_unlock_irqrestore(&pcam_inst->vq_irqlock, flags);
+
+	if (!best)
+		return -EAGAIN;
+
+	vb2_buffer_done(&best->vidbuf, VB2_BUF_STATE_DONE);
+
+	if (copy_to_user(arg, &pick, sizeof(pick))) {
+		ERR_COPY_TO_USER();
+		return -EFAULT;
+	}
+	return 0;
+}
+
 int msm_mctl_buf_done_proc(
 		struct msm_cam_media_controller *pmctl,
 		struct msm_cam_v4l2_dev_inst *pcam_inst,
@@ -412,6 +669,8 @@ int msm_mctl_buf_done_proc(
 			buf->vidbuf.v4l2_buf.sequence = *frame_id;
 		msm_mctl_gettimeofday(
 			&buf->vidbuf.v4l2_buf.timestamp);
+		if (pcam_inst->zsl_depth && msm_mctl_zsl_hold(pcam_inst, buf))
+			return 0;
 	}
 	vb2_buffer_done(&buf->vidbuf, VB2_BUF_STATE_DONE);
 	return 0;
@@ -583,6 +842,7 @@ int msm_mctl_reserve_free_buf(
 		}
 		free_buf->vb = (uint32_t)buf;
 		buf->state = MSM_BUFFER_STATE_RESERVED;
+		msm_mctl_rsv_push(pcam_inst, buf, free_buf->ch_paddr[0]);
 		D("%s inst=0x%p, idx=%d, paddr=0x%x, "
 			"ch1 addr=0x%x\n", __func__,
 			pcam_inst, buf->vidbuf.v4l2_buf.index,
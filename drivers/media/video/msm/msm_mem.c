@@ -115,6 +115,21 @@ static int check_overlap(struct hlist_head *ptype,
 	return 0;
 }
 
+/* stats buffers are handed to user space by their index */
+static int msm_pmem_next_idx(struct hlist_head *ptype, int type)
+{
+	struct msm_pmem_region *region;
+	struct hlist_node *node;
+	int idx = 0;
+
+	hlist_for_each_entry(region, node, ptype, list) {
+		if (region->info.type == type && region->idx >= idx)
+			idx = region->idx + 1;
+	}
+
+	return idx;
+}
+
 static int msm_pmem_table_add(struct hlist_head *ptype,
 	struct msm_pmem_info *info, struct ion_client *client)
 {
@@ -171,6 +186,7 @@ static int msm_pmem_table_add(struct hlist_head *ptype,
 	INIT_HLIST_NODE(&region->list);
 	region->paddr = paddr;
 	region->len = len;
+	region->idx = msm_pmem_next_idx(ptype, info->type);
 	memcpy(&region->info, info, sizeof(region->info));
 	D("%s Adding region to list with type %d\n", __func__,
 						region->info.type);
@@ -366,16 +382,18 @@ unsigned long msm_pmem_stats_vtop_lookup(
 }
 
 unsigned long msm_pmem_stats_ptov_lookup(struct msm_sync *sync,
-						unsigned long addr, int *fd)
+					unsigned long addr, int *fd, int8_t *idx)
 {
 	struct msm_pmem_region *region;
 	struct hlist_node *node, *n;
 
+	*idx = -1;
 	hlist_for_each_entry_safe(region, node, n, &sync->pmem_stats, list) {
 		if (addr == region->paddr && region->info.active) {
 			/* offset since we could pass vaddr inside a
 			 * registered pmem buffer */
 			*fd = region->info.fd;
+			*idx = region->idx;
 			region->info.active = 0;
 			return (unsigned long)(region->info.vaddr);
 		}
@@ -2741,6 +2741,8 @@ static void vfe32_process_camif_sof_irq(void)
 {
 	struct msm_sync *sync;
 	sync = v4l2_get_subdev_hostdata(&vfe32_ctrl->subdev);
+	/* stats of this frame are tagged with when it started */
+	msm_mctl_gettimeofday(&vfe32_ctrl->sof_ts);
 	/*first zero out focus bit*/
 	vfe32_ctrl->vfeFrameId = vfe32_ctrl->vfeFrameId &
 		CLEAR_FOCUS_BIT;
@@ -3072,6 +3074,7 @@ vfe_send_stats_msg(uint32_t bufAddress, uint32_t statsNum)
 	/* spin_lock_irqsave(&ctrl->state_lock, flags); */
 	struct isp_msg_stats msgStats;
 	msgStats.frameCounter = vfe32_ctrl->vfeFrameId;
+	msgStats.sof_ts = vfe32_ctrl->sof_ts;
 	msgStats.buffer = bufAddress;
 
 	switch (statsNum) {
@@ -3137,6 +3140,7 @@ static void vfe_send_comp_stats_msg(uint32_t status_bits)
 	uint32_t temp;
 
 	msgStats.frame_id = vfe32_ctrl->vfeFrameId;
+	msgStats.meta.sof_ts = vfe32_ctrl->sof_ts;
 	msgStats.status_bits = status_bits;
 
 	msgStats.aec.buff = vfe32_ctrl->aecStatsControl.bufToRender;
@@ -951,6 +951,7 @@ struct vfe32_ctrl_type {
 	uint32_t sync_timer_number;
 
 	uint32_t vfeFrameId;
+	struct timeval sof_ts;
 	uint32_t output1Pattern;
 	uint32_t output1Period;
 	uint32_t output2Pattern;
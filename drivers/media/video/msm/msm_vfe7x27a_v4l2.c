@@ -381,6 +381,8 @@ static void vfe_send_stats_msg(uint32_t buf_addr, uint32_t msg_id)
 	msg_stats.frameCounter = vfe2x_ctrl->vfeFrameId;
 	msg_stats.buffer       = buf_addr;
 	msg_stats.id           = msg_id;
+	/* the adsp doesn't tell us when the frame started */
+	msm_mctl_gettimeofday(&msg_stats.sof_ts);
 
 	v4l2_subdev_notify(&vfe2x_ctrl->subdev,
 				NOTIFY_VFE_MSG_STATS,
@@ -60,9 +60,31 @@ static int vpe_start(void)
 	return 0;
 }
 
+/* Drop the jobs that have not been started yet */
+static void vpe_drop_pending(void)
+{
+	struct msm_mctl_pp_frame_info *pp_frame_info, *tmp;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&vpe_ctrl->lock, flags);
+	list_splice_init(&vpe_ctrl->pending, &list);
+	vpe_ctrl->num_pending = 0;
+	spin_unlock_irqrestore(&vpe_ctrl->lock, flags);
+
+	list_for_each_entry_safe(pp_frame_info, tmp, &list, list) {
+		pr_err("%s: dropping frame idx %d id %d\n", __func__,
+			pp_frame_info->src_frame.buf_idx,
+			pp_frame_info->src_frame.frame_id);
+		list_del(&pp_frame_info->list);
+		kfree(pp_frame_info);
+	}
+}
+
 void vpe_reset_state_variables(void)
 {
 	/* initialize local variables for state control, etc.*/
+	vpe_drop_pending();
 	vpe_ctrl->op_mode = 0;
 	vpe_ctrl->state = VPE_STATE_INIT;
 }
@@ -424,10 +446,22 @@ static int msm_send_frame_to_vpe(void)
 	return rc;
 }
 
+static void vpe_start_job(struct msm_mctl_pp_frame_info *pp_frame_info)
+{
+	vpe_ctrl->pp_frame_info = pp_frame_info;
+	msm_vpe_cfg_update(
+		&vpe_ctrl->pp_frame_info->pp_frame_cmd.crop);
+	CDBG("%s Sending frame idx %d id %d to VPE ", __func__,
+		pp_frame_info->src_frame.buf_idx,
+		pp_frame_info->src_frame.frame_id);
+	msm_send_frame_to_vpe();
+}
+
 static void vpe_send_outmsg(void)
 {
 	unsigned long flags;
 	struct msm_vpe_resp rp;
+	struct msm_mctl_pp_frame_info *next = NULL;
 	memset(&rp, 0, sizeof(rp));
 	spin_lock_irqsave(&vpe_ctrl->lock, flags);
 	if (vpe_ctrl->state == VPE_STATE_IDLE) {
@@ -438,9 +472,21 @@ static void vpe_send_outmsg(void)
 	rp.type = vpe_ctrl->pp_frame_info->pp_frame_cmd.path;
 	rp.extdata = (void *)vpe_ctrl->pp_frame_info;
 	rp.extlen = sizeof(*vpe_ctrl->pp_frame_info);
-	vpe_ctrl->state = VPE_STATE_INIT;   /* put it back to idle. */
 	vpe_ctrl->pp_frame_info = NULL;
+	if (!list_empty(&vpe_ctrl->pending)) {
+		/* stay active, new jobs keep queueing behind this one */
+		next = list_first_entry(&vpe_ctrl->pending,
+			struct msm_mctl_pp_frame_info, list);
+		list_del(&next->list);
+		vpe_ctrl->num_pending--;
+	} else {
+		vpe_ctrl->state = VPE_STATE_INIT;   /* put it back to idle. */
+	}
 	spin_unlock_irqrestore(&vpe_ctrl->lock, flags);
+
+	/* keep the core busy: start the next job before the callback */
+	if (next)
+		vpe_start_job(next);
 	v4l2_subdev_notify(&vpe_ctrl->subdev,
 		NOTIFY_VPE_MSG_EVT, (void *)&rp);
 }
@@ -531,6 +577,7 @@ int vpe_disable(void)
 
 	disable_irq(vpe_ctrl->vpeirq->start);
 	tasklet_kill(&vpe_tasklet);
+	vpe_drop_pending();
 	msm_cam_clk_enable(&vpe_ctrl->pdev->dev, vpe_clk_info,
 			vpe_ctrl->vpe_clk, ARRAY_SIZE(vpe_clk_info), 0);
 
@@ -550,21 +597,28 @@ static int msm_vpe_do_pp(struct msm_mctl_pp_cmd *cmd,
 	unsigned long flags;
 
 	spin_lock_irqsave(&vpe_ctrl->lock, flags);
-	if (vpe_ctrl->state == VPE_STATE_ACTIVE ||
-		 vpe_ctrl->state == VPE_STATE_IDLE) {
+	if (vpe_ctrl->state == VPE_STATE_IDLE) {
 		spin_unlock_irqrestore(&vpe_ctrl->lock, flags);
 		pr_err(" =====VPE in wrong state:%d!!!  Wrong!========\n",
 		vpe_ctrl->state);
 		return -EBUSY;
 	}
+	if (vpe_ctrl->state == VPE_STATE_ACTIVE) {
+		/* run it from the interrupt of the current job */
+		if (vpe_ctrl->num_pending >= VPE_MAX_PENDING_JOBS)
+			rc = -EBUSY;
+		else {
+			list_add_tail(&pp_frame_info->list,
+				&vpe_ctrl->pending);
+			vpe_ctrl->num_pending++;
+		}
+		spin_unlock_irqrestore(&vpe_ctrl->lock, flags);
+		return rc;
+	}
+	/* nobody else starts a job until the state is active again */
+	vpe_ctrl->state = VPE_STATE_ACTIVE;
 	spin_unlock_irqrestore(&vpe_ctrl->lock, flags);
-	vpe_ctrl->pp_frame_info = pp_frame_info;
-	msm_vpe_cfg_update(
-		&vpe_ctrl->pp_frame_info->pp_frame_cmd.crop);
-	CDBG("%s Sending frame idx %d id %d to VPE ", __func__,
-		pp_frame_info->src_frame.buf_idx,
-		pp_frame_info->src_frame.frame_id);
-	rc = msm_send_frame_to_vpe();
+	vpe_start_job(pp_frame_info);
 	return rc;
 }
 
@@ -646,6 +700,8 @@ int msm_vpe_subdev_init(struct v4l2_subdev *sd, void *data,
 	}
 	v4l2_set_subdev_hostdata(sd, data);
 	spin_lock_init(&vpe_ctrl->lock);
+	INIT_LIST_HEAD(&vpe_ctrl->pending);
+	vpe_ctrl->num_pending = 0;
 	CDBG("%s:end", __func__);
 	return rc;
 }
@@ -77,6 +77,8 @@
 #define VPE_CGC_ENABLE_VALUE          0xffff
 #define VPE_DEFAULT_SCALE_CONFIG      0x3c
 
+#define VPE_MAX_PENDING_JOBS         4
+
 #define VPE_NORMAL_MODE_CLOCK_RATE   150000000
 #define VPE_TURBO_MODE_CLOCK_RATE   200000000
 
@@ -118,6 +120,9 @@ struct vpe_ctrl_type {
 	struct regulator *fs_vpe;
 	struct clk	*vpe_clk[2];
 	struct msm_mctl_pp_frame_info *pp_frame_info;
+	/* jobs waiting for the one in pp_frame_info to complete */
+	struct list_head  pending;
+	int               num_pending;
 };
 
 /*
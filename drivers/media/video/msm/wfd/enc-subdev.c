@@ -266,6 +266,19 @@ static void venc_cb(u32 event, u32 status, void *info, u32 size, void *handle,
 	}
 }
 
+/* Let the VCD scheduler run a display session ahead of offline clients */
+static long venc_set_live(struct video_client_ctx *client_ctx)
+{
+	struct vcd_property_hdr vcd_property_hdr;
+	struct vcd_property_live live;
+
+	vcd_property_hdr.prop_id = VCD_I_LIVE;
+	vcd_property_hdr.sz = sizeof(struct vcd_property_live);
+	live.live = 1;
+	return vcd_set_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &live);
+}
+
 static long venc_open(struct v4l2_subdev *sd, void *arg)
 {
 	u32 client_index;
@@ -320,6 +333,11 @@ static long venc_open(struct v4l2_subdev *sd, void *arg)
 				client_ctx->event_status);
 		goto no_free_client;
 	}
+	rc = venc_set_live(client_ctx);
+	if (rc) {
+		WFD_MSG_ERR("Failed to mark session as live\n");
+		rc = 0;
+	}
 	WFD_MSG_ERR("NOTE: client_ctx = %p\n", client_ctx);
 	vmops->cookie = inst;
 	sd->dev_priv = inst;
@@ -1325,6 +1343,140 @@ static long venc_set_max_perf_level(struct video_client_ctx *client_ctx,
 err_set_perf_level:
 	return rc;
 }
+static long venc_set_multi_slice(struct video_client_ctx *client_ctx,
+		__u32 id, __s32 value)
+{
+	struct vcd_property_hdr vcd_property_hdr;
+	struct vcd_property_multi_slice multi_slice;
+	int rc = 0;
+
+	vcd_property_hdr.prop_id = VCD_I_MULTI_SLICE;
+	vcd_property_hdr.sz =
+		sizeof(struct vcd_property_multi_slice);
+	rc = vcd_get_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &multi_slice);
+	if (rc) {
+		WFD_MSG_ERR("Failed to get multi slice settings\n");
+		return rc;
+	}
+
+	switch (id) {
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE:
+		switch (value) {
+		case V4L2_MPEG_VIDEO_MULTI_SLICE_MODE_SINGLE:
+			multi_slice.m_slice_sel = VCD_MSLICE_OFF;
+			break;
+		case V4L2_MPEG_VIDEO_MULTI_SICE_MODE_MAX_MB:
+			multi_slice.m_slice_sel = VCD_MSLICE_BY_MB_COUNT;
+			break;
+		case V4L2_MPEG_VIDEO_MULTI_SICE_MODE_MAX_BYTES:
+			multi_slice.m_slice_sel = VCD_MSLICE_BY_BYTE_COUNT;
+			break;
+		default:
+			WFD_MSG_ERR("Unknown slice mode: %d\n", value);
+			return -EINVAL;
+		}
+		break;
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES:
+		if (value <= 0)
+			return -EINVAL;
+		multi_slice.m_slice_size = value;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	rc = vcd_set_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &multi_slice);
+	if (rc)
+		WFD_MSG_ERR("Failed to set multi slice settings\n");
+	return rc;
+}
+
+static long venc_get_multi_slice(struct video_client_ctx *client_ctx,
+		__u32 id, __s32 *value)
+{
+	struct vcd_property_hdr vcd_property_hdr;
+	struct vcd_property_multi_slice multi_slice;
+	int rc = 0;
+
+	vcd_property_hdr.prop_id = VCD_I_MULTI_SLICE;
+	vcd_property_hdr.sz =
+		sizeof(struct vcd_property_multi_slice);
+	rc = vcd_get_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &multi_slice);
+	if (rc) {
+		WFD_MSG_ERR("Failed to get multi slice settings\n");
+		return rc;
+	}
+
+	switch (id) {
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE:
+		switch (multi_slice.m_slice_sel) {
+		case VCD_MSLICE_BY_MB_COUNT:
+			*value = V4L2_MPEG_VIDEO_MULTI_SICE_MODE_MAX_MB;
+			break;
+		case VCD_MSLICE_BY_BYTE_COUNT:
+			*value = V4L2_MPEG_VIDEO_MULTI_SICE_MODE_MAX_BYTES;
+			break;
+		default:
+			*value = V4L2_MPEG_VIDEO_MULTI_SLICE_MODE_SINGLE;
+			break;
+		}
+		break;
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES:
+		*value = multi_slice.m_slice_size;
+		break;
+	default:
+		return -EINVAL;
+	}
+	return rc;
+}
+
+/*
+ * In slice delivery mode every output buffer carries a single slice and is
+ * returned as soon as it is coded, so the sink can start sending a frame
+ * before the encoder is done with it. The encoder only supports this for
+ * H.264 sliced by macroblock count, and it changes the output buffer
+ * requirements, so it has to be set before the buffers are requested.
+ */
+static long venc_set_slice_delivery(struct video_client_ctx *client_ctx,
+		__s32 value)
+{
+	struct vcd_property_hdr vcd_property_hdr;
+	u32 enable = !!value;
+	int rc = 0;
+
+	vcd_property_hdr.prop_id = VCD_I_SLICE_DELIVERY_MODE;
+	vcd_property_hdr.sz = sizeof(u32);
+	rc = vcd_set_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &enable);
+	if (rc)
+		WFD_MSG_ERR("Failed to set slice delivery mode\n");
+	return rc;
+}
+
+static long venc_get_slice_delivery(struct video_client_ctx *client_ctx,
+		__s32 *value)
+{
+	struct vcd_property_hdr vcd_property_hdr;
+	u32 enable = 0;
+	int rc = 0;
+
+	vcd_property_hdr.prop_id = VCD_I_SLICE_DELIVERY_MODE;
+	vcd_property_hdr.sz = sizeof(u32);
+	rc = vcd_get_property(client_ctx->vcd_handle,
+				&vcd_property_hdr, &enable);
+	if (rc) {
+		WFD_MSG_ERR("Failed to get slice delivery mode\n");
+		return rc;
+	}
+	*value = enable;
+	return rc;
+}
+
 static long venc_set_header_mode(struct video_client_ctx *client_ctx,
 		__s32 mode)
 {
@@ -1817,6 +1969,14 @@ static long venc_set_property(struct v4l2_subdev *sd, void *arg)
 	case V4L2_CID_MPEG_QCOM_SET_PERF_LEVEL:
 		rc = venc_set_max_perf_level(client_ctx, ctrl->value);
 		break;
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES:
+		rc = venc_set_multi_slice(client_ctx, ctrl->id, ctrl->value);
+		break;
+	case V4L2_CID_MPEG_QCOM_SLICE_DELIVERY:
+		rc = venc_set_slice_delivery(client_ctx, ctrl->value);
+		break;
 	default:
 		WFD_MSG_ERR("Set property not suported: %d\n", ctrl->id);
 		rc = -ENOTSUPP;
@@ -1870,6 +2030,14 @@ static long venc_get_property(struct v4l2_subdev *sd, void *arg)
 	case V4L2_CID_MPEG_VIDEO_HEADER_MODE:
 		rc = venc_get_header_mode(client_ctx, &ctrl->value);
 		break;
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB:
+	case V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES:
+		rc = venc_get_multi_slice(client_ctx, ctrl->id, &ctrl->value);
+		break;
+	case V4L2_CID_MPEG_QCOM_SLICE_DELIVERY:
+		rc = venc_get_slice_delivery(client_ctx, &ctrl->value);
+		break;
 	default:
 		WFD_MSG_ERR("Get property not suported: %d\n", ctrl->id);
 		rc = -ENOTSUPP;
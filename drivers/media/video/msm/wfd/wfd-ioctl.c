@@ -272,6 +272,14 @@ int wfd_allocate_input_buffers(struct wfd_device *wfd_dev,
 			goto alloc_fail;
 		}
 
+		/*
+		 * The frames are written by MDP and read by the encoder, the
+		 * CPU never touches them. Drop anything left in the caches
+		 * from the allocation once here instead of on every frame.
+		 */
+		if (enc_mregion->kvaddr)
+			wfd_flush_ion_buffer(wfd_dev->ion_client, enc_mregion);
+
 		WFD_MSG_DBG("NOTE: enc paddr = %p, kvaddr = %p\n",
 				enc_mregion->paddr,
 				enc_mregion->kvaddr);
@@ -1196,7 +1204,6 @@ static int vsg_encode_frame(void *cookie, struct vsg_buf_info *buf)
 		.mregion = buf->mdp_buf_info.cookie
 	};
 
-	wfd_flush_ion_buffer(wfd_dev->ion_client, venc_buf.mregion);
 	rc = v4l2_subdev_call(&wfd_dev->enc_sdev, core, ioctl,
 			ENCODE_FRAME, &venc_buf);
 	return rc;
@@ -88,6 +88,15 @@ static int pm8038_write_buf(const struct device *dev, u16 addr, u8 *buf,
 	return msm_ssbi_write(pmic->dev->parent, addr, buf, cnt);
 }
 
+static int pm8038_transfer(const struct device *dev,
+				struct msm_ssbi_xfer *xfer, int n)
+{
+	const struct pm8xxx_drvdata *pm8038_drvdata = dev_get_drvdata(dev);
+	const struct pm8038 *pmic = pm8038_drvdata->pm_chip_data;
+
+	return msm_ssbi_transfer(pmic->dev->parent, xfer, n);
+}
+
 static int pm8038_read_irq_stat(const struct device *dev, int irq)
 {
 	const struct pm8xxx_drvdata *pm8038_drvdata = dev_get_drvdata(dev);
@@ -121,6 +130,7 @@ static struct pm8xxx_drvdata pm8038_drvdata = {
 	.pmic_writeb		= pm8038_writeb,
 	.pmic_read_buf		= pm8038_read_buf,
 	.pmic_write_buf		= pm8038_write_buf,
+	.pmic_transfer		= pm8038_transfer,
 	.pmic_read_irq_stat	= pm8038_read_irq_stat,
 	.pmic_get_version	= pm8038_get_version,
 	.pmic_get_revision	= pm8038_get_revision,
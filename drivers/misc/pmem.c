@@ -30,6 +30,8 @@
 #include <linux/vmalloc.h>
 #include <linux/io.h>
 #include <linux/mm_types.h>
+#include <linux/idr.h>
+#include <linux/ion.h>
 #include <asm/io.h>
 #include <asm/uaccess.h>
 #include <asm/cacheflush.h>
@@ -135,6 +137,13 @@ struct alloc_list {
 	struct list_head allocs;
 };
 
+struct pmem_ion_alloc {
+	struct ion_handle *handle;
+	unsigned long paddr;
+	unsigned long size;
+	void *vaddr;
+};
+
 struct pmem_info {
 	struct miscdevice dev;
 	/* physical start address of the remaped pmem space */
@@ -205,6 +214,16 @@ struct pmem_info {
 			unsigned long used;      /* Bytes currently allocated */
 			struct list_head alist;  /* List of allocations       */
 		} system_mem;
+
+		struct {
+			/* created on the first allocation, ION may probe
+			 * after us */
+			struct ion_client *client;
+			unsigned int heap_mask;
+			unsigned long used;
+			/* index -> struct pmem_ion_alloc */
+			struct idr allocs;
+		} ion;
 	} allocator;
 
 	int id;
@@ -368,6 +387,8 @@ static ssize_t show_pmem_allocator_type(int id, char *buf)
 		return scnprintf(buf, PAGE_SIZE, "%s\n", "Bitmap");
 	case PMEM_ALLOCATORTYPE_SYSTEM:
 		return scnprintf(buf, PAGE_SIZE, "%s\n", "System heap");
+	case PMEM_ALLOCATORTYPE_ION:
+		return scnprintf(buf, PAGE_SIZE, "%s\n", "ION heaps");
 	default:
 		return scnprintf(buf, PAGE_SIZE,
 			"??? Invalid allocator type (%d) for this region! "
@@ -562,6 +583,11 @@ static int pmem_allocate_from_id(const int id, const unsigned long size,
 						const unsigned int align)
 {
 	int ret;
+
+	/* no region of our own to map, ION maps each buffer */
+	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION)
+		return pmem[id].allocate(id, size, align);
+
 	ret = pmem_get_region(id);
 
 	if (ret)
@@ -577,6 +603,9 @@ static int pmem_allocate_from_id(const int id, const unsigned long size,
 
 static int pmem_free_from_id(const int id, const int index)
 {
+	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION)
+		return pmem[id].free(id, index);
+
 	pmem_put_region(id);
 	return pmem[id].free(id, index);
 }
@@ -907,6 +936,42 @@ static int pmem_free_space_system(int id, struct pmem_freespace *fs)
 	return 0;
 }
 
+static struct pmem_ion_alloc *pmem_ion_lookup(int id, int index)
+{
+	return idr_find(&pmem[id].allocator.ion.allocs, index);
+}
+
+static int pmem_free_ion(int id, int index)
+{
+	/* caller should hold the lock on arena_mutex! */
+	struct ion_client *client = pmem[id].allocator.ion.client;
+	struct pmem_ion_alloc *alloc = pmem_ion_lookup(id, index);
+
+	DLOG("index %d\n", index);
+	if (!alloc) {
+		pr_alert("pmem: %s: Attempt to free unallocated index %d, "
+			"id %d\n", __func__, index, id);
+		return -1;
+	}
+
+	ion_unmap_kernel(client, alloc->handle);
+	ion_free(client, alloc->handle);
+	idr_remove(&pmem[id].allocator.ion.allocs, index);
+	pmem[id].allocator.ion.used -= alloc->size;
+	kfree(alloc);
+
+	return 0;
+}
+
+static int pmem_free_space_ion(int id, struct pmem_freespace *fs)
+{
+	/* the heaps are shared, this is what our quota still allows */
+	fs->total = pmem[id].size - pmem[id].allocator.ion.used;
+	fs->largest = fs->total;
+
+	return 0;
+}
+
 static void pmem_revoke(struct file *file, struct pmem_data *data);
 
 static int pmem_release(struct inode *inode, struct file *file)
@@ -1401,6 +1466,86 @@ static int pmem_allocator_system(const int id,
 	return (int)list;
 }
 
+static int pmem_allocator_ion(const int id,
+		const unsigned long len,
+		const unsigned int align)
+{
+	/* caller should hold the lock on arena_mutex! */
+	unsigned int heap_mask = pmem[id].allocator.ion.heap_mask;
+	unsigned long flags = ION_SET_CACHE(pmem[id].cached ? CACHED :
+		UNCACHED);
+	unsigned long size = PAGE_ALIGN(len);
+	struct ion_client *client;
+	struct pmem_ion_alloc *alloc;
+	ion_phys_addr_t paddr;
+	size_t phys_len;
+	int index, ret;
+
+	DLOG("ion id %d, len %ld, align %u\n", id, len, align);
+
+	if ((pmem[id].allocator.ion.used + size) > pmem[id].size) {
+		DLOG("requested size would be larger than quota\n");
+		return -1;
+	}
+
+	client = pmem[id].allocator.ion.client;
+	if (!client) {
+		client = msm_ion_client_create(heap_mask, pmem[id].name);
+		if (IS_ERR_OR_NULL(client)) {
+			pr_err("pmem: %s: ion client creation failed\n",
+				pmem[id].name);
+			return -1;
+		}
+		pmem[id].allocator.ion.client = client;
+	}
+
+	alloc = kzalloc(sizeof(*alloc), GFP_KERNEL);
+	if (!alloc) {
+		printk(KERN_ERR "pmem: failed to allocate ion metadata\n");
+		return -1;
+	}
+
+	alloc->handle = ion_alloc(client, size, align, heap_mask | flags);
+	if (IS_ERR_OR_NULL(alloc->handle)) {
+		DLOG("ion_alloc of %lu bytes failed\n", size);
+		goto err_free;
+	}
+	/* pmem clients get a physical address, the buffer must be contiguous */
+	if (ion_phys(client, alloc->handle, &paddr, &phys_len)) {
+		pr_err("pmem: %s: ion buffer is not contiguous\n",
+			pmem[id].name);
+		goto err_ion_free;
+	}
+	alloc->vaddr = ion_map_kernel(client, alloc->handle, flags);
+	if (IS_ERR_OR_NULL(alloc->vaddr)) {
+		pr_err("pmem: %s: ion buffer kernel mapping failed\n",
+			pmem[id].name);
+		goto err_ion_free;
+	}
+	alloc->paddr = paddr;
+	alloc->size = size;
+
+	do {
+		if (!idr_pre_get(&pmem[id].allocator.ion.allocs, GFP_KERNEL))
+			goto err_unmap;
+		ret = idr_get_new(&pmem[id].allocator.ion.allocs, alloc,
+			&index);
+	} while (ret == -EAGAIN);
+	if (ret)
+		goto err_unmap;
+
+	pmem[id].allocator.ion.used += size;
+	return index;
+
+err_unmap:
+	ion_unmap_kernel(client, alloc->handle);
+err_ion_free:
+	ion_free(client, alloc->handle);
+err_free:
+	kfree(alloc);
+	return -1;
+}
+
 static pgprot_t pmem_phys_mem_access_prot(struct file *file, pgprot_t vma_prot)
 {
 	int id = get_id(file);
@@ -1438,10 +1583,17 @@ static unsigned long pmem_start_addr_system(int id, struct pmem_data *data)
 	return (unsigned long)(((struct alloc_list *)(data->index))->aaddr);
 }
 
+static unsigned long pmem_start_addr_ion(int id, struct pmem_data *data)
+{
+	return pmem_ion_lookup(id, data->index)->paddr;
+}
+
 static void *pmem_start_vaddr(int id, struct pmem_data *data)
 {
 	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_SYSTEM)
 		return ((struct alloc_list *)(data->index))->vaddr;
+	else if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION)
+		return pmem_ion_lookup(id, data->index)->vaddr;
 	else
 	return pmem[id].start_addr(id, data) - pmem[id].base + pmem[id].vbase;
 }
@@ -1492,6 +1644,17 @@ static unsigned long pmem_len_system(int id, struct pmem_data *data)
 	return ret;
 }
 
+static unsigned long pmem_len_ion(int id, struct pmem_data *data)
+{
+	unsigned long ret;
+
+	mutex_lock(&pmem[id].arena_mutex);
+	ret = pmem_ion_lookup(id, data->index)->size;
+	mutex_unlock(&pmem[id].arena_mutex);
+
+	return ret;
+}
+
 static int pmem_map_garbage(int id, struct vm_area_struct *vma,
 			    struct pmem_data *data, unsigned long offset,
 			    unsigned long len)
@@ -1930,6 +2093,17 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 			((struct alloc_list *)(data->index))->size;
 
 		outer_flush_range(phy_start, phy_end);
+#endif
+		goto end;
+	}
+	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION) {
+		struct pmem_ion_alloc *alloc = pmem_ion_lookup(id,
+							data->index);
+
+		dmac_flush_range(vaddr,
+			(void *)((unsigned long)vaddr + alloc->size));
+#ifdef CONFIG_OUTER_CACHE
+		outer_flush_range(alloc->paddr, alloc->paddr + alloc->size);
 #endif
 		goto end;
 	}
@@ -2770,6 +2944,35 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 			id, pdata->name, pmem[id].size);
 		break;
 
+	case PMEM_ALLOCATORTYPE_ION:
+		if (!pdata->ion_heap_mask) {
+			pr_alert("pmem: %s: no ion heaps for %s\n",
+				__func__, pdata->name);
+			goto err_reset_pmem_info;
+		}
+		pmem[id].allocator.ion.client = NULL;
+		pmem[id].allocator.ion.heap_mask = pdata->ion_heap_mask;
+		pmem[id].allocator.ion.used = 0;
+		idr_init(&pmem[id].allocator.ion.allocs);
+		pmem[id].vbase = NULL;
+
+		if (kobject_init_and_add(&pmem[id].kobj,
+				&pmem_system_ktype, NULL,
+				"%s", pdata->name))
+			goto out_put_kobj;
+
+		pmem[id].allocate = pmem_allocator_ion;
+		pmem[id].free = pmem_free_ion;
+		pmem[id].free_space = pmem_free_space_ion;
+		pmem[id].len = pmem_len_ion;
+		pmem[id].start_addr = pmem_start_addr_ion;
+		pmem[id].num_entries = 0;
+		pmem[id].quantum = PAGE_SIZE;
+
+		DLOG("ion allocator id %d (%s), heaps %#x, quota %lu\n",
+			id, pdata->name, pdata->ion_heap_mask, pmem[id].size);
+		break;
+
 	default:
 		pr_alert("Invalid allocator type (%d) for pmem driver\n",
 			pdata->allocator_type);
@@ -2793,6 +2996,12 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 		goto err_cant_register_device;
 	}
 
+	/* the ION heaps hold the memory, nothing to carve out here */
+	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION) {
+		pmem[id].area = NULL;
+		goto alloc_garbage;
+	}
+
 	pmem[id].base = allocate_contiguous_memory_nomap(pmem[id].size,
 		pmem[id].memory_type, PAGE_SIZE);
 	if (!pmem[id].base) {
@@ -2827,6 +3036,7 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	} else
 		pmem[id].area = NULL;
 
+alloc_garbage:
 	page = alloc_page(GFP_KERNEL);
 	if (!page) {
 		pr_err("pmem: Failed to allocate page for %s\n", pdata->name);
@@ -2849,7 +3059,8 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 cleanup_vm:
 	remove_vm_area(pmem_vma);
 err_free:
-	free_contiguous_memory_by_paddr(pmem[id].base);
+	if (pmem[id].base)
+		free_contiguous_memory_by_paddr(pmem[id].base);
 err_misc_deregister:
 	misc_deregister(&pmem[id].dev);
 err_cant_register_device:
@@ -2895,6 +3106,11 @@ static int pmem_remove(struct platform_device *pdev)
 		free_vm_area(pmem[id].area);
 	if (pmem[id].base)
 		free_contiguous_memory_by_paddr(pmem[id].base);
+	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_ION) {
+		if (pmem[id].allocator.ion.client)
+			ion_client_destroy(pmem[id].allocator.ion.client);
+		idr_destroy(&pmem[id].allocator.ion.allocs);
+	}
 	kobject_put(&pmem[id].kobj);
 	if (pmem[id].allocator_type == PMEM_ALLOCATORTYPE_BUDDYBESTFIT)
 		kfree(pmem[id].allocator.buddy_bestfit.buddy_bitmap);
@@ -178,6 +178,7 @@ struct qseecom_client_handle {
 	s32 sb_phys;
 	uint32_t user_virt_sb_base;
 	size_t sb_length;
+	bool sb_cached;
 	struct ion_handle *ihandle;		/* Retrieve phy addr */
 };
 
@@ -480,6 +481,7 @@ static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 	ion_phys_addr_t pa;
 	int32_t ret;
 	unsigned int flags = 0;
+	unsigned long ion_flags = 0;
 	struct qseecom_set_sb_mem_param_req req;
 	uint32_t len;
 
@@ -502,6 +504,9 @@ static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 	data->client.sb_phys = pa;
 	data->client.sb_length = req.sb_len;
 	data->client.user_virt_sb_base = req.virt_sb_base;
+	if (!ion_handle_get_flags(qseecom.ion_clnt, data->client.ihandle,
+				  &ion_flags))
+		data->client.sb_cached = ION_IS_CACHED(ion_flags);
 	return 0;
 }
 
@@ -540,7 +545,7 @@ static int __qseecom_process_incomplete_cmd(struct qseecom_dev_handle *data,
 		}
 		spin_unlock_irqrestore(&qseecom.registered_listener_list_lock,
 				flags);
-		if (ptr_svc->svc.listener_id != lstnr) {
+		if (&ptr_svc->list == &qseecom.registered_listener_list_head) {
 			pr_warning("Service requested for does on exist\n");
 			return -ERESTARTSYS;
 		}
@@ -830,8 +835,30 @@ static uint32_t __qseecom_uvirt_to_kphys(struct qseecom_dev_handle *data,
 	return data->client.sb_phys + (virt - data->client.user_virt_sb_base);
 }
 
+/*
+ * Userspace fills and reads the shared buffer through its own mapping:
+ * when that is cached, clean only the command out to memory before TZ
+ * reads it, and invalidate only the response TZ wrote.
+ */
+static int __qseecom_sb_cache_op(struct qseecom_dev_handle *data,
+				uint32_t offset, uint32_t len, unsigned int cmd)
+{
+	int ret;
+
+	if (!data->client.sb_cached)
+		return 0;
+
+	ret = msm_ion_do_cache_range_op(qseecom.ion_clnt, data->client.ihandle,
+					data->client.sb_virt + offset,
+					offset, len, cmd);
+	if (ret)
+		pr_err("cache operation on the shared buffer failed: %d\n",
+			ret);
+	return ret;
+}
+
 static int __qseecom_send_cmd_legacy(struct qseecom_dev_handle *data,
-				struct qseecom_send_cmd_req *req)
+				struct qseecom_send_cmd_req *req, bool sb_only)
 {
 	int ret = 0;
 	unsigned long flags;
@@ -861,6 +888,11 @@ static int __qseecom_send_cmd_legacy(struct qseecom_dev_handle *data,
 				reqd_len_sb_in, data->client.sb_length);
 		return -ENOMEM;
 	}
+	ret = __qseecom_sb_cache_op(data, 0, req->cmd_req_len,
+					ION_IOC_CLEAN_CACHES);
+	if (ret)
+		return ret;
+
 	cmd.cmd_type = TZ_SCHED_CMD_NEW;
 	cmd.sb_in_cmd_addr = (u8 *) data->client.sb_phys;
 	cmd.sb_in_cmd_len = req->cmd_req_len;
@@ -869,7 +901,16 @@ static int __qseecom_send_cmd_legacy(struct qseecom_dev_handle *data,
 	resp.sb_in_rsp_addr = (u8 *)data->client.sb_phys + req->cmd_req_len;
 	resp.sb_in_rsp_len = req->resp_len;
 
-	ret = scm_call(SCM_SVC_TZSCHEDULER, 1, (const void *)&cmd,
+	/*
+	 * The shared buffer has had its own maintenance, see above: only
+	 * other buffers passed by physical address need the full flush.
+	 */
+	if (sb_only)
+		ret = scm_call_noflush(SCM_SVC_TZSCHEDULER, 1,
+					(const void *)&cmd, sizeof(cmd),
+					&resp, sizeof(resp));
+	else
+		ret = scm_call(SCM_SVC_TZSCHEDULER, 1, (const void *)&cmd,
 					sizeof(cmd), &resp, sizeof(resp));
 
 	if (ret) {
@@ -919,14 +960,16 @@ static int __qseecom_send_cmd_legacy(struct qseecom_dev_handle *data,
 			return ret;
 		}
 	}
-	return ret;
+	return __qseecom_sb_cache_op(data, req->cmd_req_len, req->resp_len,
+					ION_IOC_INV_CACHES);
 }
 
 static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
-				struct qseecom_send_cmd_req *req)
+				struct qseecom_send_cmd_req *req, bool sb_only)
 {
 	int ret = 0;
 	u32 reqd_len_sb_in = 0;
+	uint32_t cmd_offset, resp_offset;
 	struct qseecom_client_send_data_ireq send_data_req;
 	struct qseecom_command_scm_resp resp;
 
@@ -952,6 +995,21 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 		return -ENOMEM;
 	}
 
+	cmd_offset = (uint32_t)req->cmd_req_buf -
+			data->client.user_virt_sb_base;
+	resp_offset = (uint32_t)req->resp_buf - data->client.user_virt_sb_base;
+	if (cmd_offset > data->client.sb_length - req->cmd_req_len ||
+		resp_offset > data->client.sb_length - req->resp_len) {
+		pr_err("cmd buffer or response buffer "
+				"outside of the shared buffer\n");
+		return -EINVAL;
+	}
+
+	ret = __qseecom_sb_cache_op(data, cmd_offset, req->cmd_req_len,
+					ION_IOC_CLEAN_CACHES);
+	if (ret)
+		return ret;
+
 	send_data_req.qsee_cmd_id = QSEOS_CLIENT_SEND_DATA_COMMAND;
 	send_data_req.app_id = data->client.app_id;
 	send_data_req.req_ptr = (void *)(__qseecom_uvirt_to_kphys(data,
@@ -961,7 +1019,18 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 					(uint32_t)req->resp_buf));
 	send_data_req.rsp_len = req->resp_len;
 
-	ret = scm_call(SCM_SVC_TZSCHEDULER, 1, (const void *) &send_data_req,
+	/*
+	 * The shared buffer has had its own maintenance, see above: only
+	 * other buffers passed by physical address need the full flush.
+	 */
+	if (sb_only)
+		ret = scm_call_noflush(SCM_SVC_TZSCHEDULER, 1,
+					(const void *) &send_data_req,
+					sizeof(send_data_req),
+					&resp, sizeof(resp));
+	else
+		ret = scm_call(SCM_SVC_TZSCHEDULER, 1,
+					(const void *) &send_data_req,
 					sizeof(send_data_req),
 					&resp, sizeof(resp));
 	if (ret) {
@@ -976,7 +1045,8 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 			return ret;
 		}
 	}
-	return ret;
+	return __qseecom_sb_cache_op(data, resp_offset, req->resp_len,
+					ION_IOC_INV_CACHES);
 }
 
 
@@ -991,9 +1061,9 @@ static int qseecom_send_cmd(struct qseecom_dev_handle *data, void __user *argp)
 		return ret;
 	}
 	if (qseecom.qseos_version == QSEOS_VERSION_14)
-		ret = __qseecom_send_cmd(data, &req);
+		ret = __qseecom_send_cmd(data, &req, true);
 	else
-		ret = __qseecom_send_cmd_legacy(data, &req);
+		ret = __qseecom_send_cmd_legacy(data, &req, true);
 	if (ret)
 		return ret;
 
@@ -1080,9 +1150,9 @@ static int qseecom_send_modfd_cmd(struct qseecom_dev_handle *data,
 	if (ret)
 		return ret;
 	if (qseecom.qseos_version == QSEOS_VERSION_14)
-		ret = __qseecom_send_cmd(data, &send_cmd_req);
+		ret = __qseecom_send_cmd(data, &send_cmd_req, false);
 	else
-		ret = __qseecom_send_cmd_legacy(data, &send_cmd_req);
+		ret = __qseecom_send_cmd_legacy(data, &send_cmd_req, false);
 	__qseecom_send_cmd_req_clean_up(&req);
 
 	if (ret)
@@ -32,6 +32,7 @@
 #include <linux/wait.h>				/* wait() macros, sleeping */
 #include <linux/tspp.h>				/* tspp functions */
 #include <linux/bitops.h>        /* BIT() macro */
+#include <linux/mm.h>			/* mmap() file op */
 #include <mach/sps.h>				/* BAM stuff */
 #include <mach/gpio.h>
 #include <mach/dma.h>
@@ -389,6 +390,8 @@ struct tspp_channel {
 	u32 bufsize;	/* size of the sps transfer buffers */
 	int buffer_count; /* how many buffers are actually allocated */
 	int filter_count; /* how many filters have been added to this channel */
+	size_t data_bytes;	/* bytes in buffers in TSPP_BUF_STATE_DATA */
+	size_t notify_bytes;	/* wake up readers from that many data_bytes */
 	enum tspp_source src;
 	enum tspp_mode mode;
 };
@@ -458,6 +461,19 @@ static irqreturn_t tspp_isr(int irq, void *dev_id)
 }
 
 /*** callbacks ***/
+/* Called with the device spinlock held */
+static int tspp_data_ready(struct tspp_channel *channel)
+{
+	struct tspp_mem_buffer *buffer = &channel->buffer[channel->waiting];
+
+	if (channel->data_bytes == 0)
+		return 0;
+	/* all buffers full: there won't be more data until some are read */
+	if (buffer->state == TSPP_BUF_STATE_DATA)
+		return 1;
+	return channel->data_bytes >= channel->notify_bytes;
+}
+
 static void tspp_sps_complete_cb(struct sps_event_notify *notify)
 {
 	struct tspp_channel *channel = notify->user;
@@ -483,7 +499,7 @@ static void tspp_sps_complete_tlet(unsigned long data)
 		buffer = &channel->buffer[channel->waiting];
 
 		/* get completions */
-		if (buffer->state == TSPP_BUF_STATE_WAITING) {
+		while (buffer->state == TSPP_BUF_STATE_WAITING) {
 			if (sps_get_iovec(channel->pipe, &iovec) != 0) {
 				pr_err("tspp: Error in iovec on channel %i",
 					channel->id);
@@ -500,12 +516,14 @@ static void tspp_sps_complete_tlet(unsigned long data)
 			buffer->state = TSPP_BUF_STATE_DATA;
 			buffer->filled = iovec.size;
 			buffer->read_index = 0;
+			channel->data_bytes += iovec.size;
 			channel->waiting++;
 			if (channel->waiting == TSPP_NUM_BUFFERS)
 				channel->waiting = 0;
+			buffer = &channel->buffer[channel->waiting];
 		}
 
-		if (complete) {
+		if (complete && tspp_data_ready(channel)) {
 			/* wake any waiting processes */
 			wake_up_interruptible(&channel->in_queue);
 		}
@@ -1053,6 +1071,9 @@ int tspp_close_channel(struct tspp_channel *channel)
 		channel->buffer[i].state = TSPP_BUF_STATE_EMPTY;
 	}
 	channel->buffer_count = 0;
+	channel->data_bytes = 0;
+	channel->read = 0;
+	channel->waiting = 0;
 
 	wake_unlock(&channel->pdev->wake_lock);
 	return 0;
@@ -1360,7 +1381,8 @@ static unsigned int tspp_poll(struct file *filp, struct poll_table_struct *p)
 	poll_wait(filp, &channel->in_queue, p);
 
 	spin_lock_irqsave(&channel->pdev->spinlock, flags);
-	if (channel->buffer[channel->read].state == TSPP_BUF_STATE_DATA)
+	if (channel->buffer[channel->read].state == TSPP_BUF_STATE_DATA &&
+	    tspp_data_ready(channel))
 		mask = POLLIN | POLLRDNORM;
 
 	spin_unlock_irqrestore(&channel->pdev->spinlock, flags);
@@ -1379,6 +1401,42 @@ static ssize_t tspp_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+/* give a buffer that has been read back to the hardware */
+static void tspp_requeue_buffer(struct tspp_channel *channel,
+	struct tspp_mem_buffer *buffer)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&channel->pdev->spinlock, flags);
+	channel->data_bytes -= buffer->filled;
+	spin_unlock_irqrestore(&channel->pdev->spinlock, flags);
+
+	buffer->state = TSPP_BUF_STATE_WAITING;
+#ifndef TSPP_USE_DMA_ALLOC_COHERENT
+	buffer->mem.phys_base = dma_map_single(NULL,
+		buffer->mem.base,
+		buffer->mem.size,
+		DMA_FROM_DEVICE);
+	if (!dma_mapping_error(NULL,
+	buffer->mem.phys_base)) {
+#endif
+		if (sps_transfer_one(channel->pipe,
+			buffer->mem.phys_base,
+			buffer->mem.size,
+			channel,
+			SPS_IOVEC_FLAG_INT |
+			SPS_IOVEC_FLAG_EOT))
+			pr_err("tspp: can't submit transfer");
+		else {
+			channel->read++;
+			if (channel->read == TSPP_NUM_BUFFERS)
+				channel->read = 0;
+		}
+#ifndef TSPP_USE_DMA_ALLOC_COHERENT
+	}
+#endif
+}
+
 static ssize_t tspp_read(struct file *filp, char __user *buf, size_t count,
 			 loff_t *f_pos)
 {
@@ -1437,35 +1495,122 @@ static ssize_t tspp_read(struct file *filp, char __user *buf, size_t count,
 		/* after reading the end of the buffer, requeue it,
 			and set up for reading the next one */
 		if (buffer->read_index ==
-			channel->buffer[channel->read].filled) {
-			buffer->state = TSPP_BUF_STATE_WAITING;
+			channel->buffer[channel->read].filled)
+			tspp_requeue_buffer(channel, buffer);
+	}
+
+	return transferred;
+}
+
+/*** zero copy access ***/
+/*
+ * The buffers of a channel are mapped one after the other, each starting
+ * on a page: buffer i is at i * tspp_buffer_stride() in the mapping.
+ */
+static size_t tspp_buffer_stride(struct tspp_channel *channel)
+{
+	return PAGE_ALIGN(channel->buffer[0].mem.size);
+}
+
+static int tspp_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	int i;
+	int rc;
+	size_t stride;
+	unsigned long addr;
+	struct tspp_channel *channel = filp->private_data;
+
 #ifndef TSPP_USE_DMA_ALLOC_COHERENT
-			buffer->mem.phys_base = dma_map_single(NULL,
-				buffer->mem.base,
-				buffer->mem.size,
-				DMA_FROM_DEVICE);
-			if (!dma_mapping_error(NULL,
-			buffer->mem.phys_base)) {
+	/* streaming mappings can't be shared with the user */
+	return -ENODEV;
 #endif
-				if (sps_transfer_one(channel->pipe,
-					buffer->mem.phys_base,
-					buffer->mem.size,
-					channel,
-					SPS_IOVEC_FLAG_INT |
-					SPS_IOVEC_FLAG_EOT))
-					pr_err("tspp: can't submit transfer");
-				else {
-					channel->read++;
-					if (channel->read == TSPP_NUM_BUFFERS)
-						channel->read = 0;
-				}
-#ifndef TSPP_USE_DMA_ALLOC_COHERENT
-			}
-#endif
-		}
+	if (channel->buffer_count == 0) {
+		pr_err("tspp: no buffers to map on channel %i", channel->id);
+		return -EINVAL;
 	}
 
-	return transferred;
+	stride = tspp_buffer_stride(channel);
+	if (vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start > channel->buffer_count * stride)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_dmacoherent(vma->vm_page_prot);
+	vma->vm_flags |= VM_IO | VM_RESERVED;
+
+	for (i = 0, addr = vma->vm_start; addr < vma->vm_end;
+	     i++, addr += stride) {
+		rc = remap_pfn_range(vma, addr,
+			__phys_to_pfn(channel->buffer[i].mem.phys_base),
+			min_t(unsigned long, stride, vma->vm_end - addr),
+			vma->vm_page_prot);
+		if (rc)
+			return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Hand the oldest filled buffer to the user instead of copying it. It stays
+ * the oldest one until it is released, read() and a second GET_BUFFER see
+ * the same buffer.
+ */
+static int tspp_get_buffer(struct tspp_channel *channel,
+	struct tspp_data_descriptor __user *arg)
+{
+	struct tspp_data_descriptor desc;
+	struct tspp_mem_buffer *buffer = &channel->buffer[channel->read];
+
+	if (buffer->state != TSPP_BUF_STATE_DATA)
+		return -EAGAIN;
+
+	desc.index = channel->read;
+	desc.offset = channel->read * tspp_buffer_stride(channel) +
+		buffer->read_index;
+	desc.size = buffer->filled - buffer->read_index;
+
+	if (copy_to_user(arg, &desc, sizeof(desc)))
+		return -EFAULT;
+	return 0;
+}
+
+static int tspp_release_buffer(struct tspp_channel *channel,
+	struct tspp_data_descriptor __user *arg)
+{
+	struct tspp_data_descriptor desc;
+	struct tspp_mem_buffer *buffer = &channel->buffer[channel->read];
+
+	if (copy_from_user(&desc, arg, sizeof(desc)))
+		return -EFAULT;
+
+	if (desc.index != channel->read ||
+	    buffer->state != TSPP_BUF_STATE_DATA)
+		return -EINVAL;
+
+	tspp_requeue_buffer(channel, buffer);
+	return 0;
+}
+
+static int tspp_set_notification(struct tspp_channel *channel,
+	struct tspp_notification __user *arg)
+{
+	struct tspp_notification notify;
+	unsigned long flags;
+	size_t packet_length = TSPP_PACKET_LENGTH;
+
+	if (copy_from_user(&notify, arg, sizeof(notify)))
+		return -EFAULT;
+	if (notify.packets < 0)
+		return -EINVAL;
+
+	if (channel->mode == TSPP_MODE_RAW)
+		packet_length += 4;
+
+	spin_lock_irqsave(&channel->pdev->spinlock, flags);
+	channel->notify_bytes = notify.packets * packet_length;
+	spin_unlock_irqrestore(&channel->pdev->spinlock, flags);
+
+	return 0;
 }
 
 static long tspp_ioctl(struct file *filp,
@@ -1478,6 +1623,19 @@ static long tspp_ioctl(struct file *filp,
 	if (!param1)
 		return -EINVAL;
 
+	/* these report their own errors, -EAGAIN in particular */
+	switch (param0) {
+	case TSPP_IOCTL_SET_NOTIFICATION:
+		return tspp_set_notification(channel,
+			(struct tspp_notification __user *)param1);
+	case TSPP_IOCTL_GET_BUFFER:
+		return tspp_get_buffer(channel,
+			(struct tspp_data_descriptor __user *)param1);
+	case TSPP_IOCTL_RELEASE_BUFFER:
+		return tspp_release_buffer(channel,
+			(struct tspp_data_descriptor __user *)param1);
+	}
+
 	switch (param0) {
 	case TSPP_IOCTL_SELECT_SOURCE:
 		rc = tspp_select_source(channel,
@@ -1614,6 +1772,7 @@ static const struct file_operations tspp_fops = {
 	.poll    = tspp_poll,
 	.release = tspp_release,
 	.unlocked_ioctl   = tspp_ioctl,
+	.mmap    = tspp_mmap,
 };
 
 static int tspp_channel_init(struct tspp_channel *channel)
@@ -1627,6 +1786,8 @@ static int tspp_channel_init(struct tspp_channel *channel)
 	init_waitqueue_head(&channel->in_queue);
 	channel->buffer_count = 0;
 	channel->filter_count = 0;
+	channel->data_bytes = 0;
+	channel->notify_bytes = 0;
 
 	if (cdev_add(&channel->cdev, tspp_minor++, 1) != 0) {
 		pr_err("tspp: cdev_add failed");
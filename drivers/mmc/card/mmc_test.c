@@ -14,6 +14,9 @@
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/moduleparam.h>
 
 #include <linux/scatterlist.h>
 #include <linux/swap.h>		/* For nr_free_buffer_pages() */
@@ -37,6 +40,21 @@
  */
 #define TEST_AREA_MAX_SIZE (128 * 1024 * 1024)
 
+/*
+ * Parameters of the mixed workload latency tests.
+ */
+static unsigned int lat_bsize = 4096;
+module_param(lat_bsize, uint, 0644);
+MODULE_PARM_DESC(lat_bsize, "Transfer size of the latency tests, in bytes");
+
+static unsigned int lat_count = 4096;
+module_param(lat_count, uint, 0644);
+MODULE_PARM_DESC(lat_count, "Number of requests of the latency tests");
+
+static unsigned int lat_write_pct = 30;
+module_param(lat_write_pct, uint, 0644);
+MODULE_PARM_DESC(lat_write_pct, "Percentage of writes of the latency tests");
+
 /**
  * struct mmc_test_pages - pages allocated by 'alloc_pages()'.
  * @page: first page in the allocation
@@ -99,6 +117,34 @@ struct mmc_test_transfer_result {
 	unsigned int iops;
 };
 
+/**
+ * struct mmc_test_lat_stat - request latencies of one direction.
+ * @count: number of requests
+ * @p50: median latency (in microseconds)
+ * @p99: 99th percentile latency (in microseconds)
+ * @p999: 99.9th percentile latency (in microseconds)
+ * @max: maximum latency (in microseconds)
+ */
+struct mmc_test_lat_stat {
+	unsigned int count;
+	u32 p50;
+	u32 p99;
+	u32 p999;
+	u32 max;
+};
+
+/**
+ * struct mmc_test_lat_result - results for latency tests.
+ * @sectors: size of each request
+ * @rd: read latencies
+ * @wr: write latencies
+ */
+struct mmc_test_lat_result {
+	unsigned int sectors;
+	struct mmc_test_lat_stat rd;
+	struct mmc_test_lat_stat wr;
+};
+
 /**
  * struct mmc_test_general_result - results for tests.
  * @link: double-linked list
@@ -106,6 +152,7 @@ struct mmc_test_transfer_result {
  * @testcase: number of test case
  * @result: result of test run
  * @tr_lst: transfer measurements if any as mmc_test_transfer_result
+ * @lat: latency measurements if any
  */
 struct mmc_test_general_result {
 	struct list_head link;
@@ -113,6 +160,7 @@ struct mmc_test_general_result {
 	int testcase;
 	int result;
 	struct list_head tr_lst;
+	struct mmc_test_lat_result *lat;
 };
 
 /**
@@ -1954,6 +2002,130 @@ static int mmc_test_large_seq_write_perf(struct mmc_test_card *test)
 	return mmc_test_large_seq_perf(test, 1);
 }
 
+static int mmc_test_lat_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Sort the latencies and pick the percentiles, by nearest rank.
+ */
+static void mmc_test_lat_stat(struct mmc_test_lat_stat *st, u32 *lat,
+			      unsigned int n)
+{
+	st->count = n;
+	if (!n)
+		return;
+
+	sort(lat, n, sizeof(*lat), mmc_test_lat_cmp, NULL);
+	st->p50 = lat[DIV_ROUND_UP(n * 500ULL, 1000) - 1];
+	st->p99 = lat[DIV_ROUND_UP(n * 990ULL, 1000) - 1];
+	st->p999 = lat[DIV_ROUND_UP(n * 999ULL, 1000) - 1];
+	st->max = lat[n - 1];
+}
+
+static void mmc_test_print_lat(struct mmc_test_card *test, const char *dir,
+			       struct mmc_test_lat_stat *st)
+{
+	printk(KERN_INFO "%s: %u %s: p50 %u us, p99 %u us, p99.9 %u us, "
+			 "max %u us\n", mmc_hostname(test->card->host),
+			 st->count, dir, st->p50, st->p99, st->p999, st->max);
+}
+
+/*
+ * Mixed reads and writes of lat_bsize bytes, lat_write_pct percent of them
+ * writes, at random or consecutive addresses in the second quarter of the
+ * card. Each request is timed on its own, including the wait for the card
+ * to leave the busy state after a write.
+ */
+static int mmc_test_mixed_lat(struct mmc_test_card *test, int seq)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_test_lat_result *res;
+	unsigned int base, range, ssz, offs = 0, nr = 0, nw = 0, i;
+	unsigned long sz;
+	u32 *rd_lat, *wr_lat;
+	ktime_t start;
+	int ret;
+
+	sz = clamp_t(unsigned long, lat_bsize & ~511, 512, t->max_tfr);
+	ssz = sz >> 9;
+	base = mmc_test_capacity(test->card) / 4;
+	range = base / ssz;
+	if (!range || !lat_count)
+		return -EINVAL;
+
+	ret = mmc_test_area_map(test, sz, 0);
+	if (ret)
+		return ret;
+
+	rd_lat = vmalloc(lat_count * sizeof(u32));
+	wr_lat = vmalloc(lat_count * sizeof(u32));
+	res = kzalloc(sizeof(*res), GFP_KERNEL);
+	if (!rd_lat || !wr_lat || !res) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < lat_count; i++) {
+		int write = mmc_test_rnd_num(100) < lat_write_pct;
+		unsigned int dev_addr;
+
+		if (seq) {
+			dev_addr = base + offs * ssz;
+			if (++offs == range)
+				offs = 0;
+		} else {
+			dev_addr = (mmc_test_rnd_num(1 << 15) << 15) |
+				   mmc_test_rnd_num(1 << 15);
+			dev_addr = base + (dev_addr % range) * ssz;
+		}
+
+		start = ktime_get();
+		ret = mmc_test_area_transfer(test, dev_addr, write);
+		if (ret)
+			goto out;
+		if (write)
+			wr_lat[nw++] = ktime_us_delta(ktime_get(), start);
+		else
+			rd_lat[nr++] = ktime_us_delta(ktime_get(), start);
+	}
+
+	res->sectors = ssz;
+	mmc_test_lat_stat(&res->rd, rd_lat, nr);
+	mmc_test_lat_stat(&res->wr, wr_lat, nw);
+	mmc_test_print_lat(test, "reads", &res->rd);
+	mmc_test_print_lat(test, "writes", &res->wr);
+
+	if (test->gr) {
+		test->gr->lat = res;
+		res = NULL;
+	}
+out:
+	kfree(res);
+	vfree(wr_lat);
+	vfree(rd_lat);
+	return ret;
+}
+
+/*
+ * Random mixed read/write latency.
+ */
+static int mmc_test_random_mixed_lat(struct mmc_test_card *test)
+{
+	return mmc_test_mixed_lat(test, 0);
+}
+
+/*
+ * Sequential mixed read/write latency.
+ */
+static int mmc_test_seq_mixed_lat(struct mmc_test_card *test)
+{
+	return mmc_test_mixed_lat(test, 1);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -2221,6 +2393,20 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.cleanup = mmc_test_area_cleanup,
 	},
 
+	{
+		.name = "Random mixed read/write latency",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_random_mixed_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Sequential mixed read/write latency",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_seq_mixed_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -2340,6 +2526,7 @@ static void mmc_test_free_result(struct mmc_card *card)
 		}
 
 		list_del(&gr->link);
+		kfree(gr->lat);
 		kfree(gr);
 	}
 
@@ -2445,6 +2632,45 @@ static const struct file_operations mmc_test_fops_test = {
 	.release	= single_release,
 };
 
+static int mtf_latency_show(struct seq_file *sf, void *data)
+{
+	struct mmc_card *card = (struct mmc_card *)sf->private;
+	struct mmc_test_general_result *gr;
+
+	mutex_lock(&mmc_test_lock);
+
+	list_for_each_entry(gr, &mmc_test_result, link) {
+		struct mmc_test_lat_result *lat = gr->lat;
+
+		if (gr->card != card || !lat)
+			continue;
+
+		seq_printf(sf, "Test %d: %d\n", gr->testcase + 1, gr->result);
+		seq_printf(sf, "read %u %u %u %u %u %u\n", lat->sectors,
+			   lat->rd.count, lat->rd.p50, lat->rd.p99,
+			   lat->rd.p999, lat->rd.max);
+		seq_printf(sf, "write %u %u %u %u %u %u\n", lat->sectors,
+			   lat->wr.count, lat->wr.p50, lat->wr.p99,
+			   lat->wr.p999, lat->wr.max);
+	}
+
+	mutex_unlock(&mmc_test_lock);
+
+	return 0;
+}
+
+static int mtf_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mtf_latency_show, inode->i_private);
+}
+
+static const struct file_operations mmc_test_fops_latency = {
+	.open		= mtf_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void mmc_test_free_file_test(struct mmc_card *card)
 {
 	struct mmc_test_dbgfs_file *df, *dfs;
@@ -2462,7 +2688,8 @@ static void mmc_test_free_file_test(struct mmc_card *card)
 	mutex_unlock(&mmc_test_lock);
 }
 
-static int mmc_test_register_file_test(struct mmc_card *card)
+static int __mmc_test_register_dbgfs_file(struct mmc_card *card,
+	const char *name, mode_t mode, const struct file_operations *fops)
 {
 	struct dentry *file = NULL;
 	struct mmc_test_dbgfs_file *df;
@@ -2471,8 +2698,8 @@ static int mmc_test_register_file_test(struct mmc_card *card)
 	mutex_lock(&mmc_test_lock);
 
 	if (card->debugfs_root)
-		file = debugfs_create_file("test", S_IWUSR | S_IRUGO,
-			card->debugfs_root, card, &mmc_test_fops_test);
+		file = debugfs_create_file(name, mode, card->debugfs_root,
+			card, fops);
 
 	if (IS_ERR_OR_NULL(file)) {
 		dev_err(&card->dev,
@@ -2501,6 +2728,23 @@ err:
 	return ret;
 }
 
+static int mmc_test_register_dbgfs_file(struct mmc_card *card)
+{
+	int ret;
+
+	ret = __mmc_test_register_dbgfs_file(card, "test", S_IWUSR | S_IRUGO,
+		&mmc_test_fops_test);
+	if (ret)
+		return ret;
+
+	ret = __mmc_test_register_dbgfs_file(card, "latency", S_IRUGO,
+		&mmc_test_fops_latency);
+	if (ret)
+		mmc_test_free_file_test(card);
+
+	return ret;
+}
+
 static int mmc_test_probe(struct mmc_card *card)
 {
 	int ret;
@@ -2508,7 +2752,7 @@ static int mmc_test_probe(struct mmc_card *card)
 	if (!mmc_card_mmc(card) && !mmc_card_sd(card))
 		return -ENODEV;
 
-	ret = mmc_test_register_file_test(card);
+	ret = mmc_test_register_dbgfs_file(card);
 	if (ret)
 		return ret;
 
@@ -336,6 +336,16 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 
 		card->ext_csd.rel_sectors = ext_csd[EXT_CSD_REL_WR_SEC_C];
 
+		/*
+		 * Super page size, the unit the card prefers to be
+		 * written in: 512 bytes << (ACC_SIZE - 1), 1 to 8 are valid.
+		 */
+		card->ext_csd.raw_acc_size = ext_csd[EXT_CSD_ACC_SIZE];
+		if ((ext_csd[EXT_CSD_ACC_SIZE] & 0xF) &&
+		    (ext_csd[EXT_CSD_ACC_SIZE] & 0xF) <= 8)
+			card->ext_csd.acc_size =
+				1 << ((ext_csd[EXT_CSD_ACC_SIZE] & 0xF) - 1);
+
 		/*
 		 * There are two boot regions of equal size, defined in
 		 * multiples of 128K.
@@ -154,12 +154,21 @@ static inline unsigned short msmsdcc_get_nr_sg(struct msmsdcc_host *host)
 	return ret;
 }
 
-/* Prevent idle power collapse(pc) while operating in peripheral mode */
+/* Data requests this big or this close together keep the PM QoS vote */
+#define MSMSDCC_PM_QOS_BUSY_BYTES	(16 * 1024)
+#define MSMSDCC_PM_QOS_BUSY_GAP_US	5000
+#define MSMSDCC_PM_QOS_MAX_GAP_US	100000
+#define MSMSDCC_PM_QOS_MAX_HOLD_MS	50
+
+/*
+ * Prevent idle power collapse(pc) while operating in peripheral mode.
+ * Must be called with pm_qos.lock held.
+ */
 static void msmsdcc_pm_qos_update_latency(struct msmsdcc_host *host, int vote)
 {
 	u32 swfi_latency = 0;
 
-	if (!host->plat->swfi_latency)
+	if (!host->plat->swfi_latency || host->pm_qos.voted == !!vote)
 		return;
 
 	swfi_latency = host->plat->swfi_latency + 1;
@@ -170,6 +179,95 @@ static void msmsdcc_pm_qos_update_latency(struct msmsdcc_host *host, int vote)
 	else
 		pm_qos_update_request(&host->pm_qos_req_dma,
 					PM_QOS_DEFAULT_VALUE);
+	host->pm_qos.voted = !!vote;
+}
+
+/*
+ * Power collapse only costs much when the host is streaming: the CPU
+ * keeps waking up for completions. Isolated small requests are cheaper
+ * to serve with the exit latency than to block power collapse for.
+ */
+static bool msmsdcc_pm_qos_busy(struct msmsdcc_host *host)
+{
+	return host->pm_qos.avg_bytes >= MSMSDCC_PM_QOS_BUSY_BYTES ||
+		host->pm_qos.avg_gap_us <= MSMSDCC_PM_QOS_BUSY_GAP_US;
+}
+
+/* Learn the request pattern, called as each data request is prepared */
+static void msmsdcc_pm_qos_account(struct msmsdcc_host *host,
+				   struct mmc_data *data)
+{
+	struct msmsdcc_pm_qos *qos = &host->pm_qos;
+	ktime_t now = ktime_get();
+	s64 gap;
+
+	if (!host->plat->swfi_latency)
+		return;
+
+	mutex_lock(&qos->lock);
+	gap = ktime_us_delta(now, qos->last_req);
+	if (gap > MSMSDCC_PM_QOS_MAX_GAP_US)
+		gap = MSMSDCC_PM_QOS_MAX_GAP_US;
+	qos->last_req = now;
+
+	qos->avg_gap_us = (qos->avg_gap_us * 7 + (unsigned int)gap) >> 3;
+	qos->avg_bytes = (qos->avg_bytes * 7 +
+			  data->blksz * data->blocks) >> 3;
+
+	if (qos->active && msmsdcc_pm_qos_busy(host))
+		msmsdcc_pm_qos_update_latency(host, 1);
+	mutex_unlock(&qos->lock);
+}
+
+static void msmsdcc_pm_qos_enable(struct msmsdcc_host *host)
+{
+	struct msmsdcc_pm_qos *qos = &host->pm_qos;
+
+	if (!host->plat->swfi_latency)
+		return;
+
+	cancel_delayed_work(&qos->release_work);
+	mutex_lock(&qos->lock);
+	qos->active = true;
+	if (msmsdcc_pm_qos_busy(host))
+		msmsdcc_pm_qos_update_latency(host, 1);
+	mutex_unlock(&qos->lock);
+}
+
+/*
+ * Keep the vote for a little while after a busy period, another burst
+ * usually follows within a couple of request gaps.
+ */
+static void msmsdcc_pm_qos_disable(struct msmsdcc_host *host)
+{
+	struct msmsdcc_pm_qos *qos = &host->pm_qos;
+	unsigned int hold_ms;
+
+	if (!host->plat->swfi_latency)
+		return;
+
+	mutex_lock(&qos->lock);
+	qos->active = false;
+	if (qos->voted && msmsdcc_pm_qos_busy(host)) {
+		hold_ms = clamp_t(unsigned int, qos->avg_gap_us / 500,
+				  1, MSMSDCC_PM_QOS_MAX_HOLD_MS);
+		queue_delayed_work(system_nrt_wq, &qos->release_work,
+				   msecs_to_jiffies(hold_ms));
+	} else {
+		msmsdcc_pm_qos_update_latency(host, 0);
+	}
+	mutex_unlock(&qos->lock);
+}
+
+static void msmsdcc_pm_qos_release_work(struct work_struct *work)
+{
+	struct msmsdcc_host *host = container_of(work, struct msmsdcc_host,
+					pm_qos.release_work.work);
+
+	mutex_lock(&host->pm_qos.lock);
+	if (!host->pm_qos.active)
+		msmsdcc_pm_qos_update_latency(host, 0);
+	mutex_unlock(&host->pm_qos.lock);
 }
 
 #ifdef CONFIG_MMC_MSM_SPS_SUPPORT
@@ -474,8 +572,10 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 		if (!mrq->data->error)
 			mrq->data->error = -EIO;
 	}
-	dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg, host->dma.num_ents,
-		     host->dma.dir);
+	/* Buffers mapped by pre_req() are unmapped in post_req() */
+	if (!mrq->data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg,
+			     host->dma.num_ents, host->dma.dir);
 
 	if (host->curr.user_pages) {
 		struct scatterlist *sg = host->dma.sg;
@@ -642,8 +742,9 @@ static void msmsdcc_sps_complete_tlet(unsigned long data)
 
 	/* Unmap sg buffers */
 	if (host->sps.sg) {
-		dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg,
-				host->sps.num_ents, host->sps.dir);
+		if (!mrq->data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg,
+					host->sps.num_ents, host->sps.dir);
 		host->sps.sg = NULL;
 	}
 
@@ -714,8 +815,9 @@ static void msmsdcc_sps_exit_curr_xfer(struct msmsdcc_host *host)
 		mrq->data->error = -EIO;
 
 	/* Unmap sg buffers */
-	dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg, host->sps.num_ents,
-			 host->sps.dir);
+	if (!mrq->data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg,
+				host->sps.num_ents, host->sps.dir);
 
 	host->sps.sg = NULL;
 	host->sps.busy = 0;
@@ -763,6 +865,15 @@ static int msmsdcc_check_dma_op_req(struct mmc_data *data)
 		return 0;
 }
 
+static inline enum dma_data_direction msmsdcc_get_dma_dir(
+		struct mmc_data *data)
+{
+	if (data->flags & MMC_DATA_READ)
+		return DMA_FROM_DEVICE;
+	else
+		return DMA_TO_DEVICE;
+}
+
 static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 {
 	struct msmsdcc_nc_dmadata *nc;
@@ -786,13 +897,13 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 
 	nc = host->dma.nc;
 
-	if (data->flags & MMC_DATA_READ)
-		host->dma.dir = DMA_FROM_DEVICE;
-	else
-		host->dma.dir = DMA_TO_DEVICE;
+	host->dma.dir = msmsdcc_get_dma_dir(data);
 
-	n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
-			host->dma.num_ents, host->dma.dir);
+	if (data->host_cookie)
+		n = host->dma.num_ents;
+	else
+		n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
+				host->dma.num_ents, host->dma.dir);
 
 	if (n != host->dma.num_ents) {
 		pr_err("%s: Unable to map in all sg elements\n",
@@ -868,8 +979,9 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 
 unmap:
 	if (err) {
-		dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg,
-				host->dma.num_ents, host->dma.dir);
+		if (!data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg,
+					host->dma.num_ents, host->dma.dir);
 		pr_err("%s: cannot do DMA, fall back to PIO mode err=%d\n",
 				mmc_hostname(host->mmc), err);
 	}
@@ -914,9 +1026,12 @@ static int msmsdcc_sps_start_xfer(struct msmsdcc_host *host,
 		sps_pipe_handle = host->sps.cons.pipe_handle;
 	}
 
-	/* Make sg buffers DMA ready */
-	rc = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
-			host->sps.dir);
+	/* Make sg buffers DMA ready, unless pre_req() already did */
+	if (data->host_cookie)
+		rc = data->sg_len;
+	else
+		rc = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+				host->sps.dir);
 
 	if (rc != data->sg_len) {
 		pr_err("%s: Unable to map in all sg elements, rc=%d\n",
@@ -935,12 +1050,15 @@ static int msmsdcc_sps_start_xfer(struct msmsdcc_host *host,
 	for (i = 0; i < data->sg_len; i++) {
 		/*
 		 * Check if this is the last buffer to transfer?
-		 * If yes then set the INT and EOT flags.
+		 * If yes then set the INT and EOT flags and let the
+		 * BAM know about the whole batch of descriptors with
+		 * a single write offset update. Until then descriptors
+		 * are only written to the FIFO.
 		 */
 		len = sg_dma_len(sg);
 		addr = sg_dma_address(sg);
-		flags = 0;
 		while (len > 0) {
+			flags = SPS_IOVEC_FLAG_NO_SUBMIT;
 			if (len > SPS_MAX_DESC_SIZE) {
 				data_cnt = SPS_MAX_DESC_SIZE;
 			} else {
@@ -956,6 +1074,14 @@ static int msmsdcc_sps_start_xfer(struct msmsdcc_host *host,
 					" pipe=0x%x, sg=0x%x, sg_buf_no=%d\n",
 					mmc_hostname(host->mmc), rc,
 					(u32)sps_pipe_handle, (u32)sg, i);
+				/*
+				 * Drop the descriptors that were queued
+				 * but never submitted, the next doorbell
+				 * would hand them to the BAM otherwise.
+				 */
+				if (host->sps.xfer_req_cnt)
+					msmsdcc_sps_pipes_reset_and_restore(
+						host);
 				goto dma_map_err;
 			}
 			addr += data_cnt;
@@ -968,8 +1094,9 @@ static int msmsdcc_sps_start_xfer(struct msmsdcc_host *host,
 
 dma_map_err:
 	/* unmap sg buffers */
-	dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg, host->sps.num_ents,
-			host->sps.dir);
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), host->sps.sg,
+				host->sps.num_ents, host->sps.dir);
 out:
 	return rc;
 }
@@ -1096,6 +1223,12 @@ msmsdcc_start_data(struct msmsdcc_host *host, struct mmc_data *data,
 
 	/* Is data transfer in PIO mode required? */
 	if (!(datactrl & MCI_DPSM_DMAENABLE)) {
+		/* The CPU is going to touch the buffers, give them back */
+		if (data->host_cookie) {
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len, msmsdcc_get_dma_dir(data));
+			data->host_cookie = 0;
+		}
 		if (data->flags & MMC_DATA_READ) {
 			pio_irqmask = MCI_RXFIFOHALFFULLMASK;
 			if (host->curr.xfer_remain < MCI_FIFOSIZE)
@@ -1817,6 +1950,51 @@ msmsdcc_request_start(struct msmsdcc_host *host, struct mmc_request *mrq)
 	}
 }
 
+/*
+ * Map the buffers of the next request for DMA while the current one is
+ * still being transferred, so that starting it only has to program the
+ * data mover or BAM descriptors.
+ */
+static void
+msmsdcc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+		bool is_first_req)
+{
+	struct msmsdcc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	msmsdcc_pm_qos_account(host, data);
+
+	data->host_cookie = 0;
+	if (!(host->is_dma_mode || host->is_sps_mode) ||
+	    msmsdcc_check_dma_op_req(data))
+		return;
+
+	if (data->sg_len > msmsdcc_get_nr_sg(host))
+		return;
+
+	if (dma_map_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		       msmsdcc_get_dma_dir(data)) != data->sg_len)
+		return;
+
+	data->host_cookie = 1;
+}
+
+static void
+msmsdcc_post_req(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	struct mmc_data *data = mrq->data;
+
+	if (!data || !data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		     msmsdcc_get_dma_dir(data));
+	data->host_cookie = 0;
+}
+
 static void
 msmsdcc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
@@ -2928,7 +3106,7 @@ static int msmsdcc_enable(struct mmc_host *mmc)
 	struct device *dev = mmc->parent;
 	struct msmsdcc_host *host = mmc_priv(mmc);
 
-	msmsdcc_pm_qos_update_latency(host, 1);
+	msmsdcc_pm_qos_enable(host);
 
 	if (mmc->card && mmc_card_sdio(mmc->card) && host->is_resumed)
 		goto out;
@@ -2959,7 +3137,7 @@ static int msmsdcc_disable(struct mmc_host *mmc, int lazy)
 	int rc;
 	struct msmsdcc_host *host = mmc_priv(mmc);
 
-	msmsdcc_pm_qos_update_latency(host, 0);
+	msmsdcc_pm_qos_disable(host);
 
 	if (mmc->card && mmc_card_sdio(mmc->card)) {
 		rc = 0;
@@ -2986,7 +3164,7 @@ static int msmsdcc_enable(struct mmc_host *mmc)
 	struct msmsdcc_host *host = mmc_priv(mmc);
 	unsigned long flags;
 
-	msmsdcc_pm_qos_update_latency(host, 1);
+	msmsdcc_pm_qos_enable(host);
 
 	if (mmc->card && mmc_card_sdio(mmc->card)) {
 		rc = 0;
@@ -3010,7 +3188,7 @@ static int msmsdcc_disable(struct mmc_host *mmc, int lazy)
 	struct msmsdcc_host *host = mmc_priv(mmc);
 	unsigned long flags;
 
-	msmsdcc_pm_qos_update_latency(host, 0);
+	msmsdcc_pm_qos_disable(host);
 
 	if (mmc->card && mmc_card_sdio(mmc->card))
 		goto out;
@@ -3537,6 +3715,8 @@ exit:
 static const struct mmc_host_ops msmsdcc_ops = {
 	.enable		= msmsdcc_enable,
 	.disable	= msmsdcc_disable,
+	.pre_req	= msmsdcc_pre_req,
+	.post_req	= msmsdcc_post_req,
 	.request	= msmsdcc_request,
 	.set_ios	= msmsdcc_set_ios,
 	.get_ro		= msmsdcc_get_ro,
@@ -4664,9 +4844,16 @@ msmsdcc_probe(struct platform_device *pdev)
 	msmsdcc_hard_reset(host);
 
 	/* pm qos request to prevent apps idle power collapse */
-	if (host->plat->swfi_latency)
+	if (host->plat->swfi_latency) {
 		pm_qos_add_request(&host->pm_qos_req_dma,
 			PM_QOS_CPU_DMA_LATENCY, PM_QOS_DEFAULT_VALUE);
+		mutex_init(&host->pm_qos.lock);
+		INIT_DELAYED_WORK(&host->pm_qos.release_work,
+				  msmsdcc_pm_qos_release_work);
+		/* Start out idle, the first burst earns the vote */
+		host->pm_qos.avg_gap_us = MSMSDCC_PM_QOS_MAX_GAP_US;
+		host->pm_qos.last_req = ktime_get();
+	}
 
 	ret = msmsdcc_msm_bus_register(host);
 	if (ret)
@@ -4877,6 +5064,9 @@ msmsdcc_probe(struct platform_device *pdev)
 
 	mmc_add_host(mmc);
 
+	/* Slots don't depend on each other, don't resume them in turn */
+	device_enable_async_suspend(&pdev->dev);
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	host->early_suspend.suspend = msmsdcc_early_suspend;
 	host->early_suspend.resume  = msmsdcc_late_resume;
@@ -4984,8 +5174,10 @@ msmsdcc_probe(struct platform_device *pdev)
 	clk_disable(host->clk);
 	msmsdcc_msm_bus_unregister(host);
  pm_qos_remove:
-	if (host->plat->swfi_latency)
+	if (host->plat->swfi_latency) {
+		cancel_delayed_work_sync(&host->pm_qos.release_work);
 		pm_qos_remove_request(&host->pm_qos_req_dma);
+	}
  clk_put:
 	clk_put(host->clk);
  pclk_disable:
@@ -5061,8 +5253,10 @@ static int msmsdcc_remove(struct platform_device *pdev)
 	if (!IS_ERR_OR_NULL(host->dfab_pclk))
 		clk_put(host->dfab_pclk);
 
-	if (host->plat->swfi_latency)
+	if (host->plat->swfi_latency) {
+		cancel_delayed_work_sync(&host->pm_qos.release_work);
 		pm_qos_remove_request(&host->pm_qos_req_dma);
+	}
 
 	if (host->msm_bus_vote.client_handle) {
 		msmsdcc_msm_bus_cancel_work_and_set_vote(host, NULL);
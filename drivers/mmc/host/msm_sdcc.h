@@ -27,6 +27,8 @@
 #include <linux/wakelock.h>
 #include <linux/earlysuspend.h>
 #include <linux/pm_qos_params.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
 #include <mach/sps.h>
 
 #include <asm/sizes.h>
@@ -331,6 +333,20 @@ struct msmsdcc_msm_bus_vote {
 	struct delayed_work vote_work;
 };
 
+/*
+ * The PM QoS vote is only held while the host is streaming data, see
+ * msmsdcc_pm_qos_busy().
+ */
+struct msmsdcc_pm_qos {
+	struct mutex lock;
+	bool voted;
+	bool active;			/* host enabled */
+	ktime_t last_req;
+	unsigned int avg_gap_us;	/* time between data requests */
+	unsigned int avg_bytes;		/* size of data requests */
+	struct delayed_work release_work;
+};
+
 struct msmsdcc_host {
 	struct resource		*core_irqres;
 	struct resource		*bam_irqres;
@@ -404,6 +420,7 @@ struct msmsdcc_host {
 	bool sdio_gpio_lpm;
 	bool irq_wake_enabled;
 	struct pm_qos_request_list pm_qos_req_dma;
+	struct msmsdcc_pm_qos pm_qos;
 	bool sdcc_suspending;
 	bool sdcc_irq_disabled;
 	bool sdcc_suspended;
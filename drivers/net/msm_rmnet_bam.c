@@ -29,6 +29,9 @@
 #include <linux/if_arp.h>
 #include <linux/msm_rmnet.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+#include <net/sch_generic.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
@@ -64,6 +67,44 @@ module_param_named(debug_enable, msm_rmnet_bam_debug_mask,
 #define DEVICE_INACTIVE      0
 #define DEVICE_ACTIVE        1
 
+/*
+ * Downlink is processed from one NAPI context shared by all devices, since
+ * they are all fed by the same BAM RX pipe.  Set use_napi=0 to receive from
+ * the bam_dmux workqueue with netif_rx() instead.
+ */
+static int use_napi = 1;
+module_param(use_napi, int, S_IRUGO);
+
+#define RMNET_NAPI_WEIGHT 64
+
+/*
+ * Small uplink packets are coalesced by bam_dmux until its aggregation
+ * timer fires.  With tx_flush_idle set the aggregate is sent as soon as the
+ * qdisc has nothing more for us, so only packets of a burst wait for each
+ * other.
+ */
+static int tx_flush_idle = 1;
+module_param(tx_flush_idle, int, S_IRUGO | S_IWUSR);
+
+/*
+ * Set when the modem drops downlink packets with bad checksums, so the
+ * stack can skip verifying them again.
+ */
+static int rx_csum_trusted;
+module_param(rx_csum_trusted, int, S_IRUGO | S_IWUSR);
+
+/*
+ * All channels come in on one RX pipe and so are polled on one CPU.  The
+ * default RPS map of each device spreads its flows over the CPUs in
+ * rps_cpus, 0 leaves RPS to userspace.  CPUs that are offline are skipped
+ * by RPS, so the map can include cores hotplug brings up later.
+ */
+static unsigned int rps_cpus = 0xf;
+module_param(rps_cpus, uint, S_IRUGO);
+
+static struct net_device rmnet_napi_dev;
+static struct napi_struct rmnet_napi;
+
 #define HEADROOM_FOR_BAM   8 /* for mux header */
 #define HEADROOM_FOR_QOS    8
 #define TAILROOM            8 /* for padding by mux layer */
@@ -244,8 +285,8 @@ static int count_this_packet(void *_hdr, int len)
 	return 1;
 }
 
-/* Rx Callback, Called in Work Queue context */
-static void bam_recv_notify(void *dev, struct sk_buff *skb)
+/* Rx Callback, Called in Work Queue or NAPI poll context */
+static void bam_recv_notify(void *dev, struct sk_buff *skb, int napi)
 {
 	struct rmnet_private *p = netdev_priv(dev);
 	unsigned long flags;
@@ -261,10 +302,16 @@ static void bam_recv_notify(void *dev, struct sk_buff *skb)
 		if (RMNET_IS_MODE_IP(opmode)) {
 			/* Driver in IP mode */
 			skb->protocol = rmnet_ip_type_trans(skb, dev);
+			/* GRO derives the MAC length from the mac header */
+			skb_reset_mac_header(skb);
 		} else {
 			/* Driver in Ethernet mode */
 			skb->protocol = eth_type_trans(skb, dev);
 		}
+		/* RPS hashes the flow from the network header */
+		skb_reset_network_header(skb);
+		if (rx_csum_trusted)
+			skb->ip_summed = CHECKSUM_UNNECESSARY;
 		if (RMNET_IS_MODE_IP(opmode) ||
 		    count_this_packet(skb->data, skb->len)) {
 #ifdef CONFIG_MSM_RMNET_DEBUG
@@ -278,7 +325,10 @@ static void bam_recv_notify(void *dev, struct sk_buff *skb)
 			p->stats.rx_packets, skb->len);
 
 		/* Deliver to network stack */
-		netif_rx(skb);
+		if (napi)
+			napi_gro_receive(&rmnet_napi, skb);
+		else
+			netif_rx(skb);
 	} else
 		pr_err("[%s] %s: No skb received",
 			((struct net_device *)dev)->name, __func__);
@@ -355,7 +405,10 @@ static void bam_notify(void *dev, int event, unsigned long data)
 
 	switch (event) {
 	case BAM_DMUX_RECEIVE:
-		bam_recv_notify(dev, (struct sk_buff *)(data));
+		bam_recv_notify(dev, (struct sk_buff *)(data), 0);
+		break;
+	case BAM_DMUX_RECEIVE_POLL:
+		bam_recv_notify(dev, (struct sk_buff *)(data), 1);
 		break;
 	case BAM_DMUX_WRITE_DONE:
 		bam_write_done(dev, (struct sk_buff *)(data));
@@ -385,6 +438,37 @@ static void bam_notify(void *dev, int event, unsigned long data)
 	}
 }
 
+static void rmnet_napi_schedule(void)
+{
+	napi_schedule(&rmnet_napi);
+}
+
+static int rmnet_napi_poll(struct napi_struct *napi, int budget)
+{
+	int work_done;
+
+	work_done = msm_bam_dmux_rx_poll(budget);
+	if (work_done < budget) {
+		napi_complete(napi);
+		msm_bam_dmux_rx_poll_complete();
+	}
+
+	return work_done;
+}
+
+static void rmnet_reg_rx_poll(struct rmnet_private *p)
+{
+	int r;
+
+	if (!use_napi)
+		return;
+
+	r = msm_bam_dmux_reg_rx_poll(p->ch_id, rmnet_napi_schedule);
+	if (r)
+		pr_err("%s: ch=%d NAPI not enabled, rc %d\n",
+			__func__, p->ch_id, r);
+}
+
 static int __rmnet_open(struct net_device *dev)
 {
 	int r;
@@ -400,6 +484,7 @@ static int __rmnet_open(struct net_device *dev)
 					__func__, p->ch_id, r);
 			return -ENODEV;
 		}
+		rmnet_reg_rx_poll(p);
 	}
 
 	p->device_up = DEVICE_ACTIVE;
@@ -521,6 +606,9 @@ static int rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	}
 	spin_unlock_irqrestore(&p->tx_queue_lock, flags);
 
+	if (tx_flush_idle && !qdisc_qlen(netdev_get_tx_queue(dev, 0)->qdisc))
+		msm_bam_dmux_ul_flush();
+
 exit:
 	msm_bam_dmux_ul_power_unvote();
 	return ret;
@@ -691,6 +779,36 @@ static void __init rmnet_setup(struct net_device *dev)
 	dev->watchdog_timeo = 1000; /* 10 seconds? */
 }
 
+#ifdef CONFIG_RPS
+static void __init rmnet_set_rps(struct net_device *dev)
+{
+	struct rps_map *map;
+	int cpu, n = 0;
+
+	for_each_possible_cpu(cpu)
+		if (cpu < 32 && (rps_cpus & (1U << cpu)))
+			n++;
+	if (!n)
+		return;
+
+	map = kzalloc(max_t(unsigned, RPS_MAP_SIZE(n), L1_CACHE_BYTES),
+		      GFP_KERNEL);
+	if (!map)
+		return;
+
+	for_each_possible_cpu(cpu)
+		if (cpu < 32 && (rps_cpus & (1U << cpu)))
+			map->cpus[map->len++] = cpu;
+
+	/* replaced and freed through the rps_cpus sysfs file */
+	rcu_assign_pointer(dev->_rx[0].rps_map, map);
+}
+#else
+static inline void rmnet_set_rps(struct net_device *dev)
+{
+}
+#endif
+
 static struct net_device *netdevs[RMNET_DEVICE_COUNT];
 static struct platform_driver bam_rmnet_drivers[RMNET_DEVICE_COUNT];
 
@@ -709,7 +827,8 @@ static int bam_rmnet_probe(struct platform_device *pdev)
 	p = netdev_priv(netdevs[i]);
 	if (p->in_reset) {
 		p->in_reset = 0;
-		msm_bam_dmux_open(p->ch_id, netdevs[i], bam_notify);
+		if (!msm_bam_dmux_open(p->ch_id, netdevs[i], bam_notify))
+			rmnet_reg_rx_poll(p);
 		netif_carrier_on(netdevs[i]);
 		netif_start_queue(netdevs[i]);
 	}
@@ -759,6 +878,13 @@ static int __init rmnet_init(void)
 #endif
 #endif
 
+	if (use_napi) {
+		init_dummy_netdev(&rmnet_napi_dev);
+		netif_napi_add(&rmnet_napi_dev, &rmnet_napi, rmnet_napi_poll,
+			       RMNET_NAPI_WEIGHT);
+		napi_enable(&rmnet_napi);
+	}
+
 	for (n = 0; n < RMNET_DEVICE_COUNT; n++) {
 		dev = alloc_netdev(sizeof(struct rmnet_private),
 				   "rmnet%d", rmnet_setup);
@@ -790,6 +916,7 @@ static int __init rmnet_init(void)
 			free_netdev(dev);
 			return ret;
 		}
+		rmnet_set_rps(dev);
 
 #ifdef CONFIG_MSM_RMNET_DEBUG
 		if (device_create_file(d, &dev_attr_timeout))
@@ -55,6 +55,7 @@
 struct task_struct;
 struct sched_param;
 int setScheduler(struct task_struct *p, int policy, struct sched_param *param);
+int setCpuAffinity(struct task_struct *p, int cpu);
 
 #define ALL_INTERFACES	0xff
 
@@ -247,6 +247,11 @@ typedef struct dhd_info {
 #endif /* DHDTHREAD */
 	tsk_ctl_t	thr_sysioc_ctl;
 
+	/* Rx frames waiting for the NAPI poll, with dhd_rx_napi */
+	struct sk_buff_head rx_napi_q;
+	struct napi_struct rx_napi;
+	struct net_device rx_napi_dev;
+
 	/* Wakelocks */
 #if defined(CONFIG_HAS_WAKELOCK) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27))
 	struct wake_lock wl_wifi;   /* Wifi wakelock */
@@ -347,6 +352,10 @@ module_param(dhd_watchdog_prio, int, 0);
 int dhd_dpc_prio = 98;
 module_param(dhd_dpc_prio, int, 0);
 
+/* CPU the DPC thread is bound to, -1 to let the scheduler place it */
+int dhd_dpc_cpu = -1;
+module_param(dhd_dpc_cpu, int, 0);
+
 /* DPC thread priority, -1 to use tasklet */
 extern int dhd_dongle_memsize;
 module_param(dhd_dongle_memsize, int, 0);
@@ -357,6 +366,12 @@ uint dhd_roam_disable = 0;
 /* Control radio state */
 uint dhd_radio_up = 1;
 
+/* Deliver rx frames from a NAPI context, so GRO can merge them */
+uint dhd_rx_napi = FALSE;
+module_param(dhd_rx_napi, uint, 0);
+
+#define DHD_RX_NAPI_WEIGHT	64
+
 /* Network inteface name */
 char iface_name[IFNAMSIZ] = {'\0'};
 module_param_string(iface_name, iface_name, IFNAMSIZ, 0);
@@ -1406,6 +1421,7 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 	wl_event_msg_t event;
 	int tout_rx = 0;
 	int tout_ctrl = 0;
+	bool napi_rx = FALSE;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -1528,7 +1544,10 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
-		if (in_interrupt()) {
+		if (dhd_rx_napi) {
+			skb_queue_tail(&dhd->rx_napi_q, skb);
+			napi_rx = TRUE;
+		} else if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
 			/* If the receive is not processed inside an ISR,
@@ -1548,10 +1567,38 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt, uint8 chan)
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 		}
 	}
+
+	/* Outside of softirq context the poll runs from local_bh_enable() */
+	if (napi_rx) {
+		local_bh_disable();
+		napi_schedule(&dhd->rx_napi);
+		local_bh_enable();
+	}
 	DHD_OS_WAKE_LOCK_RX_TIMEOUT_ENABLE(dhdp, tout_rx);
 	DHD_OS_WAKE_LOCK_CTRL_TIMEOUT_ENABLE(dhdp, tout_ctrl);
 }
 
+static int
+dhd_rx_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, rx_napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while (work < budget && (skb = skb_dequeue(&dhd->rx_napi_q)) != NULL) {
+		napi_gro_receive(napi, skb);
+		work++;
+	}
+
+	if (work < budget) {
+		napi_complete(napi);
+		/* Frames queued after the queue was found empty */
+		if (!skb_queue_empty(&dhd->rx_napi_q))
+			napi_schedule(napi);
+	}
+	return work;
+}
+
 void
 dhd_event(struct dhd_info *dhd, char *evpkt, int evlen, int ifidx)
 {
@@ -1740,6 +1787,13 @@ dhd_dpc_thread(void *data)
 	DAEMONIZE("dhd_dpc");
 	/* DHD_OS_WAKE_LOCK is called in dhd_sched_dpc[dhd_linux.c] down below  */
 
+	/* Keep the DPC off the cores the UI runs on, if asked to */
+	if (dhd_dpc_cpu >= 0 && dhd_dpc_cpu < nr_cpu_ids) {
+		if (setCpuAffinity(current, dhd_dpc_cpu))
+			DHD_ERROR(("%s: can't bind dpc to cpu %d\n",
+			           __FUNCTION__, dhd_dpc_cpu));
+	}
+
 	/*  signal: thread has started */
 	complete(&tsk->completed);
 
@@ -2740,6 +2794,14 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 	} else {
 		dhd->thr_sysioc_ctl.thr_pid = -1;
 	}
+
+	skb_queue_head_init(&dhd->rx_napi_q);
+	if (dhd_rx_napi) {
+		init_dummy_netdev(&dhd->rx_napi_dev);
+		netif_napi_add(&dhd->rx_napi_dev, &dhd->rx_napi, dhd_rx_napi_poll,
+		               DHD_RX_NAPI_WEIGHT);
+		napi_enable(&dhd->rx_napi);
+	}
 	dhd_state |= DHD_ATTACH_STATE_THREADS_CREATED;
 
 	/*
@@ -3661,6 +3723,12 @@ void dhd_detach(dhd_pub_t *dhdp)
 		else
 #endif /* DHDTHREAD */
 		tasklet_kill(&dhd->tasklet);
+
+		if (dhd_rx_napi) {
+			napi_disable(&dhd->rx_napi);
+			netif_napi_del(&dhd->rx_napi);
+		}
+		skb_queue_purge(&dhd->rx_napi_q);
 	}
 	if (dhd->dhd_state & DHD_ATTACH_STATE_PROT_ATTACH) {
 		dhd_bus_detach(dhdp);
@@ -37,3 +37,12 @@ int setScheduler(struct task_struct *p, int policy, struct sched_param *param)
 #endif /* LinuxVer */
 	return rc;
 }
+
+int setCpuAffinity(struct task_struct *p, int cpu)
+{
+	int rc = 0;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 28))
+	rc = set_cpus_allowed_ptr(p, cpumask_of(cpu));
+#endif /* LinuxVer */
+	return rc;
+}
@@ -83,6 +83,8 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define DHD_TXMINMAX_SCALE	16	/* Extra tx frame per this many queued */
+
 #define MEMBLOCK	2048		/* Block size used for downloading of dongle image */
 #define MAX_NVRAMBUF_SIZE	4096	/* max nvram buf size */
 #define MAX_DATA_BUF	(32 * 1024)	/* Must be large enough to hold biggest possible glom */
@@ -1235,6 +1237,20 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	return ret;
 }
 
+/*
+ * Tx frames to send while rx may still be pending. A fixed dhd_txminmax
+ * starves the tx queue (and the acks of a download) under heavy rx, so a
+ * deeper backlog goes out in bigger batches, at most dhd_txbound a pass.
+ */
+static uint
+dhdsdio_txminmax(dhd_bus_t *bus)
+{
+	if (!dhd_txminmax)
+		return 0;
+
+	return dhd_txminmax + pktq_mlen(&bus->txq, ~bus->flowcontrol) / DHD_TXMINMAX_SCALE;
+}
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -4636,7 +4652,7 @@ clkwait:
 	/* Send queued frames (limit 1 if rx may still be pending) */
 	else if ((bus->clkstate == CLK_AVAIL) && !bus->fcstate &&
 	    pktq_mlen(&bus->txq, ~bus->flowcontrol) && txlimit && DATAOK(bus)) {
-		framecnt = rxdone ? txlimit : MIN(txlimit, dhd_txminmax);
+		framecnt = rxdone ? txlimit : MIN(txlimit, dhdsdio_txminmax(bus));
 		framecnt = dhdsdio_sendfromq(bus, framecnt);
 		txlimit -= framecnt;
 	}
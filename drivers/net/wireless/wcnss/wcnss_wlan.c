@@ -387,6 +387,9 @@ wcnss_wlan_probe(struct platform_device *pdev)
 	}
 	penv->pdev = pdev;
 
+	/* The WLAN driver talks to Riva over SMD, wait on nothing else */
+	device_enable_async_suspend(&pdev->dev);
+
 #ifdef MODULE
 
 	/*
@@ -295,6 +295,59 @@ int msm_ssbi_write(struct device *dev, u16 addr, u8 *buf, int len)
 }
 EXPORT_SYMBOL(msm_ssbi_write);
 
+static int msm_ssbi_xfer_one(struct msm_ssbi *ssbi, struct msm_ssbi_xfer *xfer)
+{
+	u8 reg = xfer->val;
+	int ret;
+
+	if (xfer->flags & (MSM_SSBI_XFER_READ | MSM_SSBI_XFER_MASKED)) {
+		ret = ssbi->read(ssbi, xfer->addr, &reg, 1);
+		if (ret)
+			return ret;
+		if (!(xfer->flags & MSM_SSBI_XFER_MASKED)) {
+			xfer->val = reg;
+			return 0;
+		}
+		reg = (reg & ~xfer->mask) | (xfer->val & xfer->mask);
+	}
+
+	return ssbi->write(ssbi, xfer->addr, &reg, 1);
+}
+
+/*
+ * Run a batch of accesses in order, under a single acquisition of the bus
+ * lock: the remote spinlock is taken once instead of once per access, and
+ * a masked write can't race with another master's access to the same
+ * register. The batch runs with interrupts off, keep it short.
+ * Stops at the first failing access.
+ */
+int msm_ssbi_transfer(struct device *dev, struct msm_ssbi_xfer *xfer, int n)
+{
+	struct msm_ssbi *ssbi = to_msm_ssbi(dev);
+	unsigned long flags;
+	int ret = 0;
+	int i;
+
+	if (ssbi->dev != dev)
+		return -ENXIO;
+
+	if (ssbi->use_rlock)
+		remote_spin_lock_irqsave(&ssbi->rspin_lock, flags);
+	else
+		spin_lock_irqsave(&ssbi->lock, flags);
+
+	for (i = 0; i < n && !ret; i++)
+		ret = msm_ssbi_xfer_one(ssbi, &xfer[i]);
+
+	if (ssbi->use_rlock)
+		remote_spin_unlock_irqrestore(&ssbi->rspin_lock, flags);
+	else
+		spin_unlock_irqrestore(&ssbi->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(msm_ssbi_transfer);
+
 static int __devinit msm_ssbi_add_slave(struct msm_ssbi *ssbi,
 				const struct msm_ssbi_slave_info *slave)
 {
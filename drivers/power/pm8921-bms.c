@@ -80,6 +80,8 @@ struct pm8921_rbatt_params {
  * @bms_output_lock:	lock to prevent concurrent bms reads
  * @bms_100_lock:	lock to prevent concurrent updates to values that force
  *			100% charge
+ * @soc_lock:		lock to serialize state of charge updates and the
+ *			cached value
  *
  */
 struct pm8921_bms_chip {
@@ -120,6 +122,12 @@ struct pm8921_bms_chip {
 	int			batt_temp_suspend;
 	int			amux_2_trim_delta;
 	uint16_t		prev_last_good_ocv_raw;
+
+	struct mutex		soc_lock;
+	struct work_struct	soc_update_work;
+	int			soc_cache_valid;
+	int			soc_cache;
+	unsigned long		soc_cache_jiffies;
 #ifdef CONFIG_PM8921_TEST_OVERRIDE
 	int			user_override;
 	int			user_override_is_chg;
@@ -207,6 +215,16 @@ module_param_cb(bms_meter_offset, &bms_ro_param_ops, &bms_meter_offset, 0644);
 static int bms_aged_capacity = 0;
 module_param(bms_aged_capacity, int, 0644);
 
+/*
+ * The state of charge is polled by the charger and through the battery
+ * power supply: one computed within the last soc_cache_ms is returned
+ * without reading the ADCs and the coulomb counter again. The cache is
+ * refreshed early on coulomb counter and good ocv interrupts. 0 disables
+ * it.
+ */
+static int soc_cache_ms = 5000;
+module_param(soc_cache_ms, int, 0644);
+
 static int timestamp;
 
 module_param(timestamp, int, 0644);
@@ -326,18 +344,16 @@ static int pm_bms_masked_write(struct pm8921_bms_chip *chip, u16 addr,
 							u8 mask, u8 val)
 {
 	int rc;
-	u8 reg;
-
-	rc = pm8xxx_readb(chip->dev->parent, addr, &reg);
-	if (rc) {
-		pr_err("read failed addr = %03X, rc = %d\n", addr, rc);
-		return rc;
-	}
-	reg &= ~mask;
-	reg |= val & mask;
-	rc = pm8xxx_writeb(chip->dev->parent, addr, reg);
+	struct msm_ssbi_xfer xfer = {
+		.addr	= addr,
+		.val	= val,
+		.mask	= mask,
+		.flags	= MSM_SSBI_XFER_MASKED,
+	};
+
+	rc = pm8xxx_transfer(chip->dev->parent, &xfer, 1);
 	if (rc) {
-		pr_err("write failed addr = %03X, rc = %d\n", addr, rc);
+		pr_err("masked write failed addr = %03X, rc = %d\n", addr, rc);
 		return rc;
 	}
 	return 0;
@@ -384,7 +400,17 @@ static int pm_bms_read_output_data(struct pm8921_bms_chip *chip, int type,
 						int16_t *result)
 {
 	int rc;
-	u8 reg;
+	/* select the output, then read both bytes of it in one batch */
+	struct msm_ssbi_xfer xfer[] = {
+		{
+			.addr	= BMS_CONTROL,
+			.val	= type << SELECT_OUTPUT_TYPE_SHIFT,
+			.mask	= SELECT_OUTPUT_DATA,
+			.flags	= MSM_SSBI_XFER_MASKED,
+		},
+		{ .addr = BMS_OUTPUT0, .flags = MSM_SSBI_XFER_READ, },
+		{ .addr = BMS_OUTPUT1, .flags = MSM_SSBI_XFER_READ, },
+	};
 
 	if (!result) {
 		pr_err("result pointer null\n");
@@ -396,28 +422,12 @@ static int pm_bms_read_output_data(struct pm8921_bms_chip *chip, int type,
 		return -EINVAL;
 	}
 
-	rc = pm_bms_masked_write(chip, BMS_CONTROL, SELECT_OUTPUT_DATA,
-					type << SELECT_OUTPUT_TYPE_SHIFT);
+	rc = pm8xxx_transfer(chip->dev->parent, xfer, ARRAY_SIZE(xfer));
 	if (rc) {
-		pr_err("fail to select %d type in BMS_CONTROL rc = %d\n",
-						type, rc);
+		pr_err("fail to read output type %d rc = %d\n", type, rc);
 		return rc;
 	}
-
-	rc = pm8xxx_readb(chip->dev->parent, BMS_OUTPUT0, &reg);
-	if (rc) {
-		pr_err("fail to read BMS_OUTPUT0 for type %d rc = %d\n",
-			type, rc);
-		return rc;
-	}
-	*result = reg;
-	rc = pm8xxx_readb(chip->dev->parent, BMS_OUTPUT1, &reg);
-	if (rc) {
-		pr_err("fail to read BMS_OUTPUT1 for type %d rc = %d\n",
-			type, rc);
-		return rc;
-	}
-	*result |= reg << 8;
+	*result = xfer[1].val | xfer[2].val << 8;
 	pr_debug("type %d result %x", type, *result);
 	return 0;
 }
@@ -1426,31 +1436,70 @@ int pm8921_bms_get_battery_current(int *result_ua)
 }
 EXPORT_SYMBOL(pm8921_bms_get_battery_current);
 
-int pm8921_bms_get_percent_charge(void)
+/* must be called with soc_lock held */
+static int update_state_of_charge(struct pm8921_bms_chip *chip)
 {
-	int batt_temp, rc;
+	int batt_temp, rc, soc;
 	struct pm8xxx_adc_chan_result result;
 	struct pm8921_soc_params raw;
 
-	if (!the_chip) {
-		pr_err("called before initialization\n");
-		return -EINVAL;
-	}
-
-	rc = pm8xxx_adc_read(the_chip->batt_temp_channel, &result);
+	rc = pm8xxx_adc_read(chip->batt_temp_channel, &result);
 	if (rc) {
 		pr_err("error reading adc channel = %d, rc = %d\n",
-					the_chip->batt_temp_channel, rc);
+					chip->batt_temp_channel, rc);
 		return rc;
 	}
 	pr_debug("batt_temp phy = %lld meas = 0x%llx", result.physical,
 						result.measurement);
 	batt_temp = (int)result.physical;
 
-	read_soc_params_raw(the_chip, &raw);
+	read_soc_params_raw(chip, &raw);
 
-	return calculate_state_of_charge(the_chip, &raw,
+	soc = calculate_state_of_charge(chip, &raw,
 					batt_temp, last_chargecycles);
+
+	chip->soc_cache = soc;
+	chip->soc_cache_jiffies = jiffies;
+	chip->soc_cache_valid = 1;
+	return soc;
+}
+
+static void invalidate_state_of_charge(struct pm8921_bms_chip *chip)
+{
+	mutex_lock(&chip->soc_lock);
+	chip->soc_cache_valid = 0;
+	mutex_unlock(&chip->soc_lock);
+}
+
+static void soc_update_work(struct work_struct *work)
+{
+	struct pm8921_bms_chip *chip = container_of(work,
+				struct pm8921_bms_chip, soc_update_work);
+
+	mutex_lock(&chip->soc_lock);
+	update_state_of_charge(chip);
+	mutex_unlock(&chip->soc_lock);
+}
+
+int pm8921_bms_get_percent_charge(void)
+{
+	int soc;
+
+	if (!the_chip) {
+		pr_err("called before initialization\n");
+		return -EINVAL;
+	}
+
+	mutex_lock(&the_chip->soc_lock);
+	if (the_chip->soc_cache_valid && soc_cache_ms > 0
+		&& time_before(jiffies, the_chip->soc_cache_jiffies
+					+ msecs_to_jiffies(soc_cache_ms)))
+		soc = the_chip->soc_cache;
+	else
+		soc = update_state_of_charge(the_chip);
+	mutex_unlock(&the_chip->soc_lock);
+
+	return soc;
 }
 EXPORT_SYMBOL_GPL(pm8921_bms_get_percent_charge);
 
@@ -1533,6 +1582,7 @@ void pm8921_bms_charging_began(void)
 
 	the_chip->start_percent = calculate_state_of_charge(the_chip, &raw,
 					batt_temp, last_chargecycles);
+	invalidate_state_of_charge(the_chip);
 	bms_start_percent = the_chip->start_percent;
 #ifdef CONFIG_PM8921_EXTENDED_INFO
 	bms_meter_offset = (int) the_chip->meter_offset;
@@ -1608,6 +1658,7 @@ void pm8921_bms_charging_end(int is_battery_full)
 
 	the_chip->end_percent = calculate_state_of_charge(the_chip, &raw,
 					batt_temp, last_chargecycles);
+	invalidate_state_of_charge(the_chip);
 
 	bms_end_percent = the_chip->end_percent;
 	bms_end_ocv_uv = raw.last_good_ocv_uv;
@@ -1674,7 +1725,10 @@ static irqreturn_t pm8921_bms_sbi_write_ok_handler(int irq, void *data)
 
 static irqreturn_t pm8921_bms_cc_thr_handler(int irq, void *data)
 {
+	struct pm8921_bms_chip *chip = data;
+
 	pr_debug("irq = %d triggered", irq);
+	schedule_work(&chip->soc_update_work);
 	return IRQ_HANDLED;
 }
 
@@ -1705,6 +1759,8 @@ static irqreturn_t pm8921_bms_good_ocv_handler(int irq, void *data)
 
 	pr_debug("irq = %d triggered", irq);
 	schedule_work(&chip->calib_hkadc_work);
+	/* a new ocv changes the base of the state of charge */
+	schedule_work(&chip->soc_update_work);
 	return IRQ_HANDLED;
 }
 
@@ -1818,6 +1874,8 @@ static int pm8921_bms_resume(struct device *dev)
 	if (rbatt > 0) /* TODO Check for rbatt values bound based on cycles */
 		last_rbatt = rbatt;
 	chip->batt_temp_suspend = -EINVAL;
+	/* jiffies stood still while suspended, the cached soc can't be aged */
+	invalidate_state_of_charge(chip);
 	return 0;
 }
 
@@ -2373,6 +2431,8 @@ static int __devinit pm8921_bms_probe(struct platform_device *pdev)
 	chip->batt_id_channel = pdata->bms_cdata.batt_id_channel;
 	chip->revision = pm8xxx_get_revision(chip->dev->parent);
 	INIT_WORK(&chip->calib_hkadc_work, calibrate_hkadc_work);
+	mutex_init(&chip->soc_lock);
+	INIT_WORK(&chip->soc_update_work, soc_update_work);
 
 	rc = request_irqs(chip, pdev);
 	if (rc) {
@@ -2442,6 +2502,7 @@ static int __devexit pm8921_bms_remove(struct platform_device *pdev)
 	sysfs_remove_bin_file(&chip->dev->kobj, &pm8921_override_attr);
 #endif
 	free_irqs(chip);
+	cancel_work_sync(&chip->soc_update_work);
 	kfree(chip->adjusted_fcc_temp_lut);
 	platform_set_drvdata(pdev, NULL);
 	the_chip = NULL;
@@ -336,18 +336,16 @@ static int pm_chg_masked_write(struct pm8921_chg_chip *chip, u16 addr,
 							u8 mask, u8 val)
 {
 	int rc;
-	u8 reg;
+	struct msm_ssbi_xfer xfer = {
+		.addr	= addr,
+		.val	= val,
+		.mask	= mask,
+		.flags	= MSM_SSBI_XFER_MASKED,
+	};
 
-	rc = pm8xxx_readb(chip->dev->parent, addr, &reg);
-	if (rc) {
-		pr_err("pm8xxx_readb failed: addr=%03X, rc=%d\n", addr, rc);
-		return rc;
-	}
-	reg &= ~mask;
-	reg |= val & mask;
-	rc = pm8xxx_writeb(chip->dev->parent, addr, reg);
+	rc = pm8xxx_transfer(chip->dev->parent, &xfer, 1);
 	if (rc) {
-		pr_err("pm8xxx_writeb failed: addr=%03X, rc=%d\n", addr, rc);
+		pr_err("pm8xxx_transfer failed: addr=%03X, rc=%d\n", addr, rc);
 		return rc;
 	}
 	return 0;
@@ -21,7 +21,9 @@
 #include <linux/fdtable.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
 #include <linux/module.h>
@@ -35,9 +37,21 @@
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
+#define CREATE_TRACE_POINTS
+#include <trace/events/binder.h>
 
 #include "binder.h"
 
+/*
+ * Lock order:
+ *   binder_lock
+ *     binder_deferred_lock
+ *     mm->mmap_sem of a target process
+ *
+ * binder_lock protects all procs, threads, nodes, refs and transactions.
+ * binder_transaction() drops it while copying the transaction data into
+ * the target's buffer, see binder_proc.tmp_ref.
+ */
 static DEFINE_MUTEX(binder_lock);
 static DEFINE_MUTEX(binder_deferred_lock);
 
@@ -45,6 +59,15 @@ static HLIST_HEAD(binder_procs);
 static HLIST_HEAD(binder_deferred_list);
 static HLIST_HEAD(binder_dead_nodes);
 
+/*
+ * Buffer pages nobody uses any more stay mapped on binder_lru, oldest
+ * last, so the next transaction can reuse them without allocating and
+ * mapping again. The shrinker gives them back under memory pressure.
+ * Protected by binder_lock.
+ */
+static LIST_HEAD(binder_lru);
+static unsigned long binder_lru_pages;
+
 static struct dentry *binder_debugfs_dir_entry_root;
 static struct dentry *binder_debugfs_dir_entry_proc;
 static struct binder_node *binder_context_mgr_node;
@@ -200,6 +223,38 @@ static struct binder_transaction_log_entry *binder_transaction_log_add(
 	return e;
 }
 
+/*
+ * Latency of transactions handled by a node or proc. wakeup is queueing
+ * to the target thread reading the transaction, reply is queueing to the
+ * reply being sent.
+ */
+struct binder_latency_stats {
+	unsigned long calls;
+	u64 wakeup_us;
+	u64 max_wakeup_us;
+	unsigned long replies;
+	u64 reply_us;
+	u64 max_reply_us;
+};
+
+static void binder_latency_add_wakeup(struct binder_latency_stats *stats,
+				      u64 us)
+{
+	stats->calls++;
+	stats->wakeup_us += us;
+	if (us > stats->max_wakeup_us)
+		stats->max_wakeup_us = us;
+}
+
+static void binder_latency_add_reply(struct binder_latency_stats *stats,
+				     u64 us)
+{
+	stats->replies++;
+	stats->reply_us += us;
+	if (us > stats->max_reply_us)
+		stats->max_reply_us = us;
+}
+
 struct binder_work {
 	struct list_head entry;
 	enum {
@@ -234,6 +289,7 @@ struct binder_node {
 	unsigned accept_fds:1;
 	unsigned min_priority:8;
 	struct list_head async_todo;
+	struct binder_latency_stats latency;
 };
 
 struct binder_ref_death {
@@ -275,6 +331,12 @@ struct binder_buffer {
 	uint8_t data[0];
 };
 
+struct binder_lru_page {
+	struct list_head lru;	/* on binder_lru while mapped but unused */
+	struct page *page_ptr;
+	struct binder_proc *proc;
+};
+
 enum binder_deferred_state {
 	BINDER_DEFERRED_PUT_FILES    = 0x01,
 	BINDER_DEFERRED_FLUSH        = 0x02,
@@ -301,7 +363,7 @@ struct binder_proc {
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 
-	struct page **pages;
+	struct binder_lru_page *pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
@@ -312,8 +374,16 @@ struct binder_proc {
 	int requested_threads;
 	int requested_threads_started;
 	int ready_threads;
+	struct list_head waiting_threads;
 	long default_priority;
+	struct binder_latency_stats latency;
 	struct dentry *debugfs_entry;
+	/*
+	 * Transactions copying into our buffer without binder_lock. A
+	 * release while any are in flight is left to the last of them.
+	 */
+	int tmp_ref;
+	int release_pending;
 };
 
 enum {
@@ -338,6 +408,12 @@ struct binder_thread {
 		/* we are also waiting on */
 	wait_queue_head_t wait;
 	struct binder_stats stats;
+	/*
+	 * On proc->waiting_threads while asleep waiting for proc work, task
+	 * is only looked at then.
+	 */
+	struct list_head waiting_thread_node;
+	struct task_struct *task;
 };
 
 struct binder_transaction {
@@ -356,6 +432,13 @@ struct binder_transaction {
 	unsigned int	flags;
 	long	priority;
 	long	saved_priority;
+	int	sched_policy;	/* real-time policy inherited from the caller */
+	int	rt_priority;
+	int	saved_sched_policy;
+	int	saved_rt_priority;
+	int	to_node_debug_id;
+	ktime_t	queued_time;
+	ktime_t	read_time;
 	uid_t	sender_euid;
 };
 
@@ -536,6 +619,41 @@ static void binder_set_nice(long nice)
 	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
 }
 
+static void binder_set_rt_priority(int policy, int rt_priority)
+{
+	struct sched_param param = { .sched_priority = rt_priority };
+
+	if (current->policy == policy && current->rt_priority == rt_priority)
+		return;
+	if (sched_setscheduler_nocheck(current, policy, &param))
+		binder_debug(BINDER_DEBUG_PRIORITY_CAP,
+			     "binder: %d: failed to set policy %d prio %d\n",
+			     current->pid, policy, rt_priority);
+}
+
+static int binder_is_rt_policy(int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+/*
+ * Prefer an idle looper that last ran on this cpu, the caller is about to
+ * sleep waiting for the reply so the target can have it with a warm cache.
+ */
+static struct binder_thread *binder_select_idle_thread(struct binder_proc *proc)
+{
+	struct binder_thread *thread;
+	int cpu = raw_smp_processor_id();
+
+	list_for_each_entry(thread, &proc->waiting_threads, waiting_thread_node) {
+		if (task_cpu(thread->task) == cpu) {
+			list_del_init(&thread->waiting_thread_node);
+			return thread;
+		}
+	}
+	return NULL;
+}
+
 static size_t binder_buffer_size(struct binder_proc *proc,
 				 struct binder_buffer *buffer)
 {
@@ -635,8 +753,10 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	void *page_addr;
 	unsigned long user_page_addr;
 	struct vm_struct tmp_area;
+	struct binder_lru_page *lru_page;
 	struct page **page;
 	struct mm_struct *mm;
+	int need_map = 0;
 
 	binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "binder: %d: %s pages %p-%p\n", proc->pid,
@@ -645,6 +765,22 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	if (end <= start)
 		return 0;
 
+	if (allocate == 0)
+		goto free_range;
+
+	/* Pages still mapped from an earlier buffer only leave the lru */
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		lru_page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (lru_page->page_ptr) {
+			BUG_ON(list_empty(&lru_page->lru));
+			list_del_init(&lru_page->lru);
+			binder_lru_pages--;
+		} else
+			need_map = 1;
+	}
+	if (!need_map)
+		return 0;
+
 	if (vma)
 		mm = NULL;
 	else
@@ -655,9 +791,6 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		vma = proc->vma;
 	}
 
-	if (allocate == 0)
-		goto free_range;
-
 	if (vma == NULL) {
 		binder_debug(BINDER_DEBUG_TOP_ERRORS,
 		       "binder: %d: binder_alloc_buf failed to "
@@ -668,9 +801,11 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		int ret;
 		struct page **page_array_ptr;
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		page = &proc->pages[(page_addr - proc->buffer) /
+				    PAGE_SIZE].page_ptr;
 
-		BUG_ON(*page);
+		if (*page)
+			continue;
 		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
 		if (*page == NULL) {
 			binder_debug(BINDER_DEBUG_TOP_ERRORS,
@@ -710,7 +845,17 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 free_range:
 	for (page_addr = end - PAGE_SIZE; page_addr >= start;
 	     page_addr -= PAGE_SIZE) {
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		lru_page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		BUG_ON(!lru_page->page_ptr || !list_empty(&lru_page->lru));
+		list_add(&lru_page->lru, &binder_lru);
+		binder_lru_pages++;
+	}
+	return 0;
+
+	/* Unwind from the page that failed, older ones are freed outright */
+	for (; page_addr >= start; page_addr -= PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) /
+				    PAGE_SIZE].page_ptr;
 		if (vma)
 			zap_page_range(vma, (uintptr_t)page_addr +
 				proc->user_buffer_offset, PAGE_SIZE, NULL);
@@ -730,6 +875,65 @@ err_no_vma:
 	return -ENOMEM;
 }
 
+/* Called with binder_lock held, returns 0 if the page could be freed */
+static int binder_free_lru_page(struct binder_lru_page *lru_page)
+{
+	struct binder_proc *proc = lru_page->proc;
+	void *page_addr = proc->buffer +
+		(lru_page - proc->pages) * PAGE_SIZE;
+	struct mm_struct *mm;
+
+	mm = get_task_mm(proc->tsk);
+	if (mm && !down_write_trylock(&mm->mmap_sem)) {
+		mmput(mm);
+		return -EBUSY;
+	}
+
+	list_del_init(&lru_page->lru);
+	binder_lru_pages--;
+	if (mm && proc->vma)
+		zap_page_range(proc->vma, (uintptr_t)page_addr +
+			       proc->user_buffer_offset, PAGE_SIZE, NULL);
+	unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+	__free_page(lru_page->page_ptr);
+	lru_page->page_ptr = NULL;
+
+	if (mm) {
+		up_write(&mm->mmap_sem);
+		mmput(mm);
+	}
+	return 0;
+}
+
+static int binder_shrink(struct shrinker *s, struct shrink_control *sc)
+{
+	struct binder_lru_page *lru_page;
+	unsigned long nr = sc->nr_to_scan;
+
+	if (!nr)
+		return binder_lru_pages;
+
+	/* binder allocates under binder_lock, don't wait for ourselves */
+	if (!mutex_trylock(&binder_lock))
+		return -1;
+
+	while (nr-- && !list_empty(&binder_lru)) {
+		lru_page = list_entry(binder_lru.prev, struct binder_lru_page,
+				      lru);
+		if (binder_free_lru_page(lru_page))
+			list_move(&lru_page->lru, &binder_lru);
+	}
+	nr = binder_lru_pages;
+	mutex_unlock(&binder_lock);
+
+	return nr;
+}
+
+static struct shrinker binder_shrinker = {
+	.shrink = binder_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static struct binder_buffer *binder_alloc_buf(struct binder_proc *proc,
 					      size_t data_size,
 					      size_t offsets_size, int is_async)
@@ -1427,9 +1631,11 @@ static void binder_transaction(struct binder_proc *proc,
 	struct binder_node *target_node = NULL;
 	struct list_head *target_list;
 	wait_queue_head_t *target_wait;
+	struct binder_thread *idle_thread = NULL;
 	struct binder_transaction *in_reply_to = NULL;
 	struct binder_transaction_log_entry *e;
 	uint32_t return_error;
+	int copy_failed;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->call_type = reply ? 2 : !!(tr->flags & TF_ONE_WAY);
@@ -1449,6 +1655,8 @@ static void binder_transaction(struct binder_proc *proc,
 			goto err_empty_call_stack;
 		}
 		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_rt_priority(in_reply_to->saved_sched_policy,
+				       in_reply_to->saved_rt_priority);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1583,6 +1791,12 @@ static void binder_transaction(struct binder_proc *proc,
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->priority = task_nice(current);
+	if (!reply && !(t->flags & TF_ONE_WAY) &&
+	    binder_is_rt_policy(current->policy)) {
+		t->sched_policy = current->policy;
+		t->rt_priority = current->rt_priority;
+	} else
+		t->sched_policy = SCHED_NORMAL;
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
@@ -1598,15 +1812,46 @@ static void binder_transaction(struct binder_proc *proc,
 
 	offp = (size_t *)(t->buffer->data + ALIGN(tr->data_size, sizeof(void *)));
 
-	if (copy_from_user(t->buffer->data, tr->data.ptr.buffer, tr->data_size)) {
-		binder_user_error("binder: %d:%d got transaction with invalid "
-			"data ptr\n", proc->pid, thread->pid);
-		return_error = BR_FAILED_REPLY;
-		goto err_copy_data_failed;
+	/*
+	 * The copy may fault and sleep, don't hold up every other binder
+	 * user meanwhile. The buffer can't be freed by the target since
+	 * allow_user_free is clear, and tmp_ref holds off its release.
+	 * Threads may exit though, so look the target thread up again.
+	 */
+	target_proc->tmp_ref++;
+	mutex_unlock(&binder_lock);
+	copy_failed = copy_from_user(t->buffer->data, tr->data.ptr.buffer,
+				     tr->data_size) ||
+		copy_from_user(offp, tr->data.ptr.offsets, tr->offsets_size);
+	mutex_lock(&binder_lock);
+	target_proc->tmp_ref--;
+
+	if (reply) {
+		if (in_reply_to->from == NULL) {
+			return_error = BR_DEAD_REPLY;
+			goto err_dead_target_thread;
+		}
+	} else if (target_thread) {
+		struct binder_transaction *tmp;
+
+		target_thread = NULL;
+		for (tmp = thread->transaction_stack; tmp;
+		     tmp = tmp->from_parent)
+			if (tmp->from && tmp->from->proc == target_proc)
+				target_thread = tmp->from;
+		t->to_thread = target_thread;
+		if (target_thread) {
+			target_list = &target_thread->todo;
+			target_wait = &target_thread->wait;
+		} else {
+			target_list = &target_proc->todo;
+			target_wait = &target_proc->wait;
+		}
 	}
-	if (copy_from_user(offp, tr->data.ptr.offsets, tr->offsets_size)) {
+
+	if (copy_failed) {
 		binder_user_error("binder: %d:%d got transaction with invalid "
-			"offsets ptr\n", proc->pid, thread->pid);
+			"data or offsets ptr\n", proc->pid, thread->pid);
 		return_error = BR_FAILED_REPLY;
 		goto err_copy_data_failed;
 	}
@@ -1778,6 +2023,17 @@ static void binder_transaction(struct binder_proc *proc,
 		}
 	}
 	if (reply) {
+		ktime_t now = ktime_get();
+		u64 reply_us = ktime_us_delta(now, in_reply_to->queued_time);
+
+		trace_binder_transaction_reply(in_reply_to->debug_id,
+			in_reply_to->to_node_debug_id, reply_us,
+			ktime_us_delta(now, in_reply_to->read_time));
+		binder_latency_add_reply(&proc->latency, reply_us);
+		if (in_reply_to->buffer && in_reply_to->buffer->target_node)
+			binder_latency_add_reply(
+				&in_reply_to->buffer->target_node->latency,
+				reply_us);
 		BUG_ON(t->buffer->async_transaction != 0);
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
@@ -1794,12 +2050,31 @@ static void binder_transaction(struct binder_proc *proc,
 		} else
 			target_node->has_async_transaction = 1;
 	}
+	if (!reply && !(t->flags & TF_ONE_WAY) &&
+	    target_wait == &target_proc->wait) {
+		idle_thread = binder_select_idle_thread(target_proc);
+		if (idle_thread) {
+			target_list = &idle_thread->todo;
+			target_wait = NULL;
+		}
+	}
+	if (target_node)
+		t->to_node_debug_id = target_node->debug_id;
+	trace_binder_transaction(t->debug_id, reply, t->flags,
+		target_proc->pid, idle_thread ? idle_thread->pid :
+		(target_thread ? target_thread->pid : 0),
+		t->to_node_debug_id, t->code);
+	t->queued_time = ktime_get();
 	t->work.type = BINDER_WORK_TRANSACTION;
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
-	if (target_wait)
+	if (idle_thread)
+		wake_up_process(idle_thread->task);
+	else if (target_wait)
 		wake_up_interruptible(target_wait);
+	if (!target_proc->tmp_ref && target_proc->release_pending)
+		binder_defer_work(target_proc, BINDER_DEFERRED_RELEASE);
 	return;
 
 err_get_unused_fd_failed:
@@ -1811,9 +2086,12 @@ err_binder_new_node_failed:
 err_bad_object_type:
 err_bad_offset:
 err_copy_data_failed:
+err_dead_target_thread:
 	binder_transaction_buffer_release(target_proc, t->buffer, offp);
 	t->buffer->transaction = NULL;
 	binder_free_buf(target_proc, t->buffer);
+	if (!target_proc->tmp_ref && target_proc->release_pending)
+		binder_defer_work(target_proc, BINDER_DEFERRED_RELEASE);
 err_binder_alloc_buf_failed:
 	kfree(tcomplete);
 	binder_stats_deleted(BINDER_STAT_TRANSACTION_COMPLETE);
@@ -2256,7 +2534,7 @@ void binder_stat_br(struct binder_proc *proc, struct binder_thread *thread,
 static int binder_has_proc_work(struct binder_proc *proc,
 				struct binder_thread *thread)
 {
-	return !list_empty(&proc->todo) ||
+	return !list_empty(&proc->todo) || !list_empty(&thread->todo) ||
 		(thread->looper & BINDER_LOOPER_STATE_NEED_RETURN);
 }
 
@@ -2305,8 +2583,12 @@ retry:
 
 
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
-	if (wait_for_proc_work)
+	if (wait_for_proc_work) {
 		proc->ready_threads++;
+		if (!non_block)
+			list_add(&thread->waiting_thread_node,
+				 &proc->waiting_threads);
+	}
 	mutex_unlock(&binder_lock);
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
@@ -2334,6 +2616,7 @@ retry:
 	mutex_lock(&binder_lock);
 	if (wait_for_proc_work)
 		proc->ready_threads--;
+	list_del_init(&thread->waiting_thread_node);
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
 
 	if (ret)
@@ -2477,11 +2760,28 @@ retry:
 			continue;
 
 		BUG_ON(t->buffer == NULL);
+		t->read_time = ktime_get();
+		trace_binder_transaction_received(t->debug_id,
+			t->to_node_debug_id,
+			ktime_us_delta(t->read_time, t->queued_time));
 		if (t->buffer->target_node) {
 			struct binder_node *target_node = t->buffer->target_node;
+			u64 wakeup_us = ktime_us_delta(t->read_time,
+						       t->queued_time);
+
+			binder_latency_add_wakeup(&proc->latency, wakeup_us);
+			binder_latency_add_wakeup(&target_node->latency,
+						  wakeup_us);
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
 			t->saved_priority = task_nice(current);
+			t->saved_sched_policy = current->policy;
+			t->saved_rt_priority = current->rt_priority;
+			if (binder_is_rt_policy(t->sched_policy) &&
+			    (!binder_is_rt_policy(current->policy) ||
+			     current->rt_priority < t->rt_priority))
+				binder_set_rt_priority(t->sched_policy,
+						       t->rt_priority);
 			if (t->priority < target_node->min_priority &&
 			    !(t->flags & TF_ONE_WAY))
 				binder_set_nice(t->priority);
@@ -2616,6 +2916,8 @@ static struct binder_thread *binder_get_thread(struct binder_proc *proc)
 		thread->pid = current->pid;
 		init_waitqueue_head(&thread->wait);
 		INIT_LIST_HEAD(&thread->todo);
+		INIT_LIST_HEAD(&thread->waiting_thread_node);
+		thread->task = current;
 		rb_link_node(&thread->rb_node, parent, p);
 		rb_insert_color(&thread->rb_node, &proc->threads);
 		thread->looper |= BINDER_LOOPER_STATE_NEED_RETURN;
@@ -2864,6 +3166,7 @@ static struct vm_operations_struct binder_vm_ops = {
 static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	int ret;
+	int i;
 	struct vm_struct *area;
 	struct binder_proc *proc = filp->private_data;
 	const char *failure_string;
@@ -2917,6 +3220,10 @@ static int binder_mmap(struct file *filp, struct vm_area_struct *vma)
 		goto err_alloc_pages_failed;
 	}
 	proc->buffer_size = vma->vm_end - vma->vm_start;
+	for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
+		INIT_LIST_HEAD(&proc->pages[i].lru);
+		proc->pages[i].proc = proc;
+	}
 
 	vma->vm_ops = &binder_vm_ops;
 	vma->vm_private_data = proc;
@@ -2970,6 +3277,7 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
+	INIT_LIST_HEAD(&proc->waiting_threads);
 	proc->default_priority = task_nice(current);
 	mutex_lock(&binder_lock);
 	binder_stats_created(BINDER_STAT_PROC);
@@ -3036,6 +3344,12 @@ static void binder_deferred_release(struct binder_proc *proc)
 	BUG_ON(proc->vma);
 	BUG_ON(proc->files);
 
+	if (proc->tmp_ref) {
+		/* binder_transaction() queues the release again when done */
+		proc->release_pending = 1;
+		return;
+	}
+
 	hlist_del(&proc->proc_node);
 	if (binder_context_mgr_node && binder_context_mgr_node->proc == proc) {
 		binder_debug(BINDER_DEBUG_DEAD_BINDER,
@@ -3122,7 +3436,14 @@ static void binder_deferred_release(struct binder_proc *proc)
 	if (proc->pages) {
 		int i;
 		for (i = 0; i < proc->buffer_size / PAGE_SIZE; i++) {
-			if (proc->pages[i]) {
+			if (!list_empty(&proc->pages[i].lru)) {
+				/* freed by binder_free_buf() above */
+				list_del(&proc->pages[i].lru);
+				binder_lru_pages--;
+				unmap_kernel_range((unsigned long)proc->buffer +
+					i * PAGE_SIZE, PAGE_SIZE);
+				__free_page(proc->pages[i].page_ptr);
+			} else if (proc->pages[i].page_ptr) {
 				void *page_addr = proc->buffer + i * PAGE_SIZE;
 				binder_debug(BINDER_DEBUG_BUFFER_ALLOC,
 					     "binder_release: %d: "
@@ -3131,7 +3452,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 					     page_addr);
 				unmap_kernel_range((unsigned long)page_addr,
 					PAGE_SIZE);
-				__free_page(proc->pages[i]);
+				__free_page(proc->pages[i].page_ptr);
 				page_count++;
 			}
 		}
@@ -3805,6 +4126,50 @@ static int binder_proc_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void print_binder_latency_stats(struct seq_file *m,
+				       struct binder_latency_stats *stats)
+{
+	seq_printf(m, "calls %lu wakeup avg %llu max %llu us, "
+		   "replies %lu avg %llu max %llu us\n",
+		   stats->calls,
+		   stats->calls ? div_u64(stats->wakeup_us, stats->calls) : 0,
+		   stats->max_wakeup_us,
+		   stats->replies,
+		   stats->replies ? div_u64(stats->reply_us, stats->replies) : 0,
+		   stats->max_reply_us);
+}
+
+static int binder_latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct binder_node *node;
+	struct hlist_node *pos;
+	struct rb_node *n;
+	int do_lock = !binder_debug_no_lock;
+
+	if (do_lock)
+		mutex_lock(&binder_lock);
+
+	seq_puts(m, "binder latency:\n");
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node) {
+		if (!proc->latency.calls)
+			continue;
+		seq_printf(m, "proc %d: ", proc->pid);
+		print_binder_latency_stats(m, &proc->latency);
+		for (n = rb_first(&proc->nodes); n; n = rb_next(n)) {
+			node = rb_entry(n, struct binder_node, rb_node);
+			if (!node->latency.calls)
+				continue;
+			seq_printf(m, "  node %d u%p c%p: ", node->debug_id,
+				   node->ptr, node->cookie);
+			print_binder_latency_stats(m, &node->latency);
+		}
+	}
+	if (do_lock)
+		mutex_unlock(&binder_lock);
+	return 0;
+}
+
 static void print_binder_transaction_log_entry(struct seq_file *m,
 					struct binder_transaction_log_entry *e)
 {
@@ -3848,6 +4213,7 @@ static struct miscdevice binder_miscdev = {
 
 BINDER_DEBUG_ENTRY(transactions);
 BINDER_DEBUG_ENTRY(transaction_log);
+BINDER_DEBUG_ENTRY(latency);
 
 static const struct seq_operations binder_stats_seq_ops = {
 	.start = binder_stats_seq_start,
@@ -3947,6 +4313,8 @@ static int __init binder_init(void)
 	if (!binder_deferred_workqueue)
 		return -ENOMEM;
 
+	register_shrinker(&binder_shrinker);
+
 	binder_debugfs_dir_entry_root = debugfs_create_dir("binder", NULL);
 	if (binder_debugfs_dir_entry_root)
 		binder_debugfs_dir_entry_proc = debugfs_create_dir("proc",
@@ -3978,6 +4346,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    &binder_transaction_log_failed,
 				    &binder_transaction_log_fops);
+		debugfs_create_file("latency",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_latency_fops);
 	}
 	return ret;
 }
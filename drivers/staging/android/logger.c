@@ -25,6 +25,8 @@
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/percpu.h>
+#include <linux/mm.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -45,6 +47,7 @@ struct logger_log {
 	size_t			w_off;	/* current write head offset */
 	size_t			head;	/* new readers start here */
 	size_t			size;	/* size of the log */
+	__u64			w_seq;	/* bytes ever written, see logger_position */
 };
 
 /*
@@ -57,8 +60,24 @@ struct logger_reader {
 	struct logger_log	*log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
 	size_t			r_off;	/* current read head offset */
+	int			batch;	/* read returns as many entries as fit */
 };
 
+/*
+ * struct logger_staging - a per-cpu buffer writers build their entry in
+ *
+ * Copying from user-space may fault and sleep, so writers assemble the whole
+ * entry here first and only take log->mutex to memcpy it into the ring.
+ * Writers only contend on the staging mutex with writers that started on
+ * the same cpu.
+ */
+struct logger_staging {
+	struct mutex		mutex;	/* mutex protecting buf */
+	unsigned char		buf[LOGGER_ENTRY_MAX_LEN];
+};
+
+static DEFINE_PER_CPU(struct logger_staging, logger_staging);
+
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
@@ -149,7 +168,8 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
  *
  * 	- O_NONBLOCK works
  * 	- If there are no log entries to read, blocks until log is written to
- * 	- Atomically reads exactly one log entry
+ * 	- Atomically reads exactly one log entry, or in batch mode as many whole
+ * 	  entries as fit in the buffer
  *
  * Optimal read size is LOGGER_ENTRY_MAX_LEN. Will set errno to EINVAL if read
  * buffer is insufficient to hold next entry.
@@ -207,6 +227,18 @@ start:
 	/* get exactly one entry from the log */
 	ret = do_read_log_to_user(log, reader, buf, ret);
 
+	/* and in batch mode any more that fit */
+	while (reader->batch && ret > 0 && log->w_off != reader->r_off) {
+		ssize_t len = get_entry_len(log, reader->r_off);
+
+		if (count - ret < len)
+			break;
+		len = do_read_log_to_user(log, reader, buf + ret, len);
+		if (len < 0)
+			break;
+		ret += len;
+	}
+
 out:
 	mutex_unlock(&log->mutex);
 
@@ -287,33 +319,7 @@ static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 		memcpy(log->buffer, buf + len, count - len);
 
 	log->w_off = logger_offset(log->w_off + count);
-
-}
-
-/*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
- *
- * The caller needs to hold log->mutex.
- *
- * Returns 'count' on success, negative error code on failure.
- */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
-{
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
-			return -EFAULT;
-
-	log->w_off = logger_offset(log->w_off + count);
-
-	return count;
+	log->w_seq += count;
 }
 
 /*
@@ -325,8 +331,9 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
+	struct logger_staging *staging;
 	struct logger_entry header;
+	unsigned char *payload;
 	struct timespec now;
 	ssize_t ret = 0;
 
@@ -342,38 +349,47 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
 	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
+	 * We may be migrated once preemption is back on, that's fine, the
+	 * staging mutex keeps the buffer ours.
 	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
+	staging = &get_cpu_var(logger_staging);
+	put_cpu_var(logger_staging);
+	mutex_lock(&staging->mutex);
 
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	memcpy(staging->buf, &header, sizeof(struct logger_entry));
+	payload = staging->buf + sizeof(struct logger_entry);
 
 	while (nr_segs-- > 0) {
 		size_t len;
-		ssize_t nr;
 
 		/* figure out how much of this vector we can keep */
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
-		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+		/* stage this segment's payload */
+		if (unlikely(len && copy_from_user(payload + ret,
+						   iov->iov_base, len))) {
+			mutex_unlock(&staging->mutex);
+			return -EFAULT;
 		}
 
 		iov++;
-		ret += nr;
+		ret += len;
 	}
 
+	mutex_lock(&log->mutex);
+
+	/*
+	 * Fix up any readers, pulling them forward to the first readable
+	 * entry after (what will be) the new write offset.
+	 */
+	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
+
+	do_write_log(log, staging->buf,
+		     sizeof(struct logger_entry) + header.len);
+
 	mutex_unlock(&log->mutex);
+	mutex_unlock(&staging->mutex);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
@@ -409,6 +425,7 @@ static int logger_open(struct inode *inode, struct file *file)
 			return -ENOMEM;
 
 		reader->log = log;
+		reader->batch = 0;
 		INIT_LIST_HEAD(&reader->list);
 
 		mutex_lock(&log->mutex);
@@ -473,10 +490,39 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 	return ret;
 }
 
+/*
+ * logger_mmap - the log's mmap file operation
+ *
+ * Maps the ring read-only, for readers that parse entries in place. See
+ * struct logger_position for finding them.
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_log *log = file_get_log(file);
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+	if ((vma->vm_flags & VM_WRITE) || vma->vm_pgoff || size > log->size)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(log->buffer) >> PAGE_SHIFT,
+			       size, vma->vm_page_prot);
+}
+
+/* logger_seq - the sequence number of the byte at 'off', behind w_off */
+static __u64 logger_seq(struct logger_log *log, size_t off)
+{
+	return log->w_seq - logger_offset(log->w_off - off);
+}
+
 static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct logger_log *log = file_get_log(file);
 	struct logger_reader *reader;
+	struct logger_position pos;
 	long ret = -ENOTTY;
 
 	mutex_lock(&log->mutex);
@@ -517,6 +563,33 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		log->head = log->w_off;
 		ret = 0;
 		break;
+	case LOGGER_SET_BATCH_READ:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		reader->batch = !!arg;
+		ret = 0;
+		break;
+	case LOGGER_GET_POSITION:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		/*
+		 * The caller reads the entries out of the mapping, move the
+		 * read head up so poll() waits for new ones.
+		 */
+		reader = file->private_data;
+		pos.w_seq = log->w_seq;
+		pos.head_seq = logger_seq(log, log->head);
+		pos.r_seq = logger_seq(log, reader->r_off);
+		reader->r_off = log->w_off;
+		ret = 0;
+		if (copy_to_user((void __user *)arg, &pos, sizeof(pos)))
+			ret = -EFAULT;
+		break;
 	}
 
 	mutex_unlock(&log->mutex);
@@ -531,6 +604,7 @@ static const struct file_operations logger_fops = {
 	.poll = logger_poll,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
+	.mmap = logger_mmap,
 	.open = logger_open,
 	.release = logger_release,
 };
@@ -538,10 +612,11 @@ static const struct file_operations logger_fops = {
 /*
  * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
  * must be a power of two, greater than LOGGER_ENTRY_MAX_LEN, and less than
- * LONG_MAX minus LOGGER_ENTRY_MAX_LEN.
+ * LONG_MAX minus LOGGER_ENTRY_MAX_LEN. The buffer is page aligned so it can
+ * be mmap()ed.
  */
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
+static unsigned char _buf_ ## VAR[SIZE] __aligned(PAGE_SIZE); \
 static struct logger_log VAR = { \
 	.buffer = _buf_ ## VAR, \
 	.misc = { \
@@ -556,6 +631,7 @@ static struct logger_log VAR = { \
 	.w_off = 0, \
 	.head = 0, \
 	.size = SIZE, \
+	.w_seq = 0, \
 };
 
 DEFINE_LOGGER_DEVICE(log_main, LOGGER_LOG_MAIN, 1024*1024)
@@ -596,6 +672,10 @@ static int __init init_log(struct logger_log *log)
 static int __init logger_init(void)
 {
 	int ret;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu(logger_staging, cpu).mutex);
 
 	ret = init_log(&log_main);
 	if (unlikely(ret))
@@ -39,11 +39,30 @@ struct logger_entry {
 #define LOGGER_ENTRY_MAX_PAYLOAD	\
 	(LOGGER_ENTRY_MAX_LEN - sizeof(struct logger_entry))
 
+/*
+ * struct logger_position - where a log stands, for readers of the mmap()ed
+ * ring
+ *
+ * Positions are sequence numbers counting every byte ever written to the
+ * log, the offset into the ring is the sequence number modulo the log size.
+ * Entries from head_seq up to w_seq are readable. Compare against head_seq
+ * again after parsing entries out of the mapping: any below it may have been
+ * overwritten meanwhile.
+ */
+struct logger_position {
+	__u64		w_seq;	/* end of the last complete entry */
+	__u64		head_seq; /* oldest entry still in the log */
+	__u64		r_seq;	/* this reader's read head */
+};
+
 #define __LOGGERIO	0xAE
 
 #define LOGGER_GET_LOG_BUF_SIZE		_IO(__LOGGERIO, 1) /* size of log */
 #define LOGGER_GET_LOG_LEN		_IO(__LOGGERIO, 2) /* used log len */
 #define LOGGER_GET_NEXT_ENTRY_LEN	_IO(__LOGGERIO, 3) /* next entry len */
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
+#define LOGGER_SET_BATCH_READ		_IO(__LOGGERIO, 5) /* read many entries */
+#define LOGGER_GET_POSITION		_IOR(__LOGGERIO, 6, \
+					     struct logger_position)
 
 #endif /* _LINUX_LOGGER_H */
@@ -15,6 +15,9 @@
  * The driver considers memory used for caches to be free, but if a large
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
+ * To catch that case the driver also watches how many of the pages reclaim
+ * scans it manages to free. Once that drops below 100 - pressure_critical
+ * percent in any zone, cached memory is no longer counted as free.
  *
  * Copyright (C) 2007-2008 Google, Inc.
  *
@@ -38,6 +41,11 @@
 #include <linux/memory.h>
 #include <linux/memory_hotplug.h>
 #include <linux/swap.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <linux/vmstat.h>
+#include <linux/delay.h>
+#include <linux/workqueue.h>
 
 static uint32_t lowmem_debug_level = 2;
 static int lowmem_adj[6] = {
@@ -63,6 +71,8 @@ static size_t lowmem_swapfree[6] = {
 	10 * 1024,	/* 40MB */
 };
 static int lowmem_swapfree_size = 6;
+static int lowmem_pressure_critical = 95;
+static int lowmem_reap = 1;
 
 static unsigned int offlining;
 static struct task_struct *lowmem_deathpending;
@@ -92,6 +102,292 @@ task_notify_func(struct notifier_block *self, unsigned long val, void *data)
 	return NOTIFY_OK;
 }
 
+/*
+ * Processes are kept in a tree sorted by oom_adj, so the shrinker only has
+ * to look at the ones it may kill instead of walking every task. The tree
+ * holds thread group leaders; fork, exit, exec and the /proc oom_adj and
+ * oom_score_adj writers keep it up to date.
+ *
+ * lowmem_tree_lock nests inside write_lock_irq(&tasklist_lock). Nothing
+ * else may be taken while holding it.
+ */
+static DEFINE_SPINLOCK(lowmem_tree_lock);
+static struct rb_root lowmem_tree = RB_ROOT;
+
+#define LOWMEM_CANDIDATES	8
+
+static void __lowmem_tree_insert(struct task_struct *p)
+{
+	struct rb_node **link = &lowmem_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct task_struct *entry;
+
+	p->lowmem_adj = p->signal->oom_adj;
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct task_struct, lowmem_node);
+		if (p->lowmem_adj < entry->lowmem_adj)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&p->lowmem_node, parent, link);
+	rb_insert_color(&p->lowmem_node, &lowmem_tree);
+}
+
+/* Called from copy_process() with tasklist_lock held for writing */
+void lowmem_task_add(struct task_struct *p)
+{
+	RB_CLEAR_NODE(&p->lowmem_node);
+	if (!thread_group_leader(p) || (p->flags & PF_KTHREAD))
+		return;
+
+	spin_lock(&lowmem_tree_lock);
+	__lowmem_tree_insert(p);
+	spin_unlock(&lowmem_tree_lock);
+}
+
+/* Called from __unhash_process() with tasklist_lock held for writing */
+void lowmem_task_del(struct task_struct *p)
+{
+	spin_lock(&lowmem_tree_lock);
+	if (!RB_EMPTY_NODE(&p->lowmem_node)) {
+		rb_erase(&p->lowmem_node, &lowmem_tree);
+		RB_CLEAR_NODE(&p->lowmem_node);
+	}
+	spin_unlock(&lowmem_tree_lock);
+}
+
+/* Called from de_thread() when @new takes over as group leader from @old */
+void lowmem_task_replace(struct task_struct *old, struct task_struct *new)
+{
+	spin_lock(&lowmem_tree_lock);
+	if (!RB_EMPTY_NODE(&old->lowmem_node)) {
+		new->lowmem_adj = old->lowmem_adj;
+		rb_replace_node(&old->lowmem_node, &new->lowmem_node,
+				&lowmem_tree);
+		RB_CLEAR_NODE(&old->lowmem_node);
+	}
+	spin_unlock(&lowmem_tree_lock);
+}
+
+/* Called after the oom_adj of @task's thread group has changed */
+void lowmem_task_adj_changed(struct task_struct *task)
+{
+	struct task_struct *p;
+
+	rcu_read_lock();
+	p = task->group_leader;
+	spin_lock(&lowmem_tree_lock);
+	if (!RB_EMPTY_NODE(&p->lowmem_node)) {
+		rb_erase(&p->lowmem_node, &lowmem_tree);
+		__lowmem_tree_insert(p);
+	}
+	spin_unlock(&lowmem_tree_lock);
+	rcu_read_unlock();
+}
+
+/*
+ * Take a reference on up to LOWMEM_CANDIDATES of the processes with the
+ * highest oom_adj, as long as that is at least min_adj.
+ */
+static int lowmem_get_candidates(struct task_struct **cand, int min_adj)
+{
+	struct rb_node *n;
+	struct task_struct *p;
+	int nr = 0;
+
+	spin_lock(&lowmem_tree_lock);
+	for (n = rb_last(&lowmem_tree); n && nr < LOWMEM_CANDIDATES;
+	     n = rb_prev(n)) {
+		p = rb_entry(n, struct task_struct, lowmem_node);
+		if (p->lowmem_adj < min_adj)
+			break;
+		get_task_struct(p);
+		cand[nr++] = p;
+	}
+	spin_unlock(&lowmem_tree_lock);
+
+	return nr;
+}
+
+#ifdef CONFIG_VM_EVENT_COUNTERS
+/*
+ * Reclaim efficiency is measured per zone over windows of at least
+ * LOWMEM_PRESSURE_WINDOW scanned pages; the pressure is the percentage of
+ * scanned pages that could not be reclaimed, in the worst zone. A result
+ * older than a second is considered stale.
+ */
+#define LOWMEM_PRESSURE_WINDOW	(SWAP_CLUSTER_MAX * 16)
+
+static DEFINE_SPINLOCK(lowmem_pressure_lock);
+static unsigned long lowmem_scanned_base[MAX_NR_ZONES];
+static unsigned long lowmem_stolen_base[MAX_NR_ZONES];
+static int lowmem_zone_pressure[MAX_NR_ZONES];
+static unsigned long lowmem_pressure_stamp[MAX_NR_ZONES];
+
+static unsigned long lowmem_zone_events(enum vm_event_item normal, int idx)
+{
+	enum vm_event_item item = normal - ZONE_NORMAL + idx;
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu(vm_event_states, cpu).event[item];
+
+	return sum;
+}
+
+static int lowmem_pressure(void)
+{
+	unsigned long scanned, stolen;
+	int idx, pressure = 0;
+
+	/* Shrinkers run concurrently, one of them updating is enough */
+	if (!spin_trylock(&lowmem_pressure_lock))
+		return 0;
+
+	for (idx = 0; idx < MAX_NR_ZONES; idx++) {
+		scanned = lowmem_zone_events(PGSCAN_KSWAPD_NORMAL, idx) +
+			lowmem_zone_events(PGSCAN_DIRECT_NORMAL, idx);
+		stolen = lowmem_zone_events(PGSTEAL_NORMAL, idx);
+
+		if (scanned < lowmem_scanned_base[idx] ||
+		    stolen < lowmem_stolen_base[idx]) {
+			/* counters of an offlined cpu were folded away */
+			lowmem_scanned_base[idx] = scanned;
+			lowmem_stolen_base[idx] = stolen;
+			continue;
+		}
+
+		scanned -= lowmem_scanned_base[idx];
+		stolen -= lowmem_stolen_base[idx];
+		if (scanned >= LOWMEM_PRESSURE_WINDOW) {
+			lowmem_zone_pressure[idx] = 100 -
+				min(stolen * 100 / scanned, 100UL);
+			lowmem_pressure_stamp[idx] = jiffies;
+			lowmem_scanned_base[idx] += scanned;
+			lowmem_stolen_base[idx] += stolen;
+		}
+
+		if (time_before(jiffies, lowmem_pressure_stamp[idx] + HZ) &&
+		    lowmem_zone_pressure[idx] > pressure)
+			pressure = lowmem_zone_pressure[idx];
+	}
+
+	spin_unlock(&lowmem_pressure_lock);
+
+	return pressure;
+}
+#else
+static inline int lowmem_pressure(void)
+{
+	return 0;
+}
+#endif
+
+/*
+ * A killed process only frees its memory once it gets to run and exit,
+ * which can take a while if it is frozen or starved of cpu. The reaper
+ * unmaps its private memory right after the kill instead, like
+ * MADV_DONTNEED would. The process can't return to user space any more,
+ * so it will never notice.
+ */
+#define LOWMEM_REAP_RETRIES	10
+
+static struct workqueue_struct *lowmem_reap_wq;
+static struct task_struct *lowmem_reap_task;
+
+/* The memory may only go away if no other process uses the mm */
+static bool lowmem_mm_shared(struct mm_struct *mm, struct task_struct *victim)
+{
+	struct task_struct *g, *t;
+	bool shared = false;
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, t) {
+		if (t->mm == mm && !same_thread_group(t, victim)) {
+			shared = true;
+			goto out;
+		}
+	} while_each_thread(g, t);
+out:
+	read_unlock(&tasklist_lock);
+
+	return shared;
+}
+
+static void lowmem_reap_mm(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		/* shared pages are still reachable through other mappings */
+		if (vma->vm_flags & (VM_SHARED | VM_LOCKED | VM_PFNMAP |
+				     VM_IO | VM_HUGETLB | VM_NONLINEAR))
+			continue;
+		zap_page_range(vma, vma->vm_start,
+			       vma->vm_end - vma->vm_start, NULL);
+	}
+}
+
+static void lowmem_reap_func(struct work_struct *work)
+{
+	struct task_struct *p = lowmem_reap_task;
+	struct mm_struct *mm;
+	unsigned long rss;
+	int attempts;
+
+	mm = get_task_mm(p);
+	if (!mm)
+		goto out;
+	if (lowmem_mm_shared(mm, p))
+		goto out_mm;
+
+	/* The victim may hold mmap_sem for writing, give it a moment */
+	for (attempts = 0; !down_read_trylock(&mm->mmap_sem); attempts++) {
+		if (attempts == LOWMEM_REAP_RETRIES) {
+			lowmem_print(2, "reap of %d (%s) failed\n",
+				     p->pid, p->comm);
+			goto out_mm;
+		}
+		msleep(100);
+	}
+
+	rss = get_mm_rss(mm);
+	lowmem_reap_mm(mm);
+	lowmem_print(1, "reaped %d (%s), %lu of %lu pages\n", p->pid, p->comm,
+		     rss - get_mm_rss(mm), rss);
+	up_read(&mm->mmap_sem);
+
+	/* What is left is small, don't hold back the next kill for it */
+	if (lowmem_deathpending == p)
+		lowmem_deathpending = NULL;
+out_mm:
+	mmput(mm);
+out:
+	put_task_struct(p);
+	smp_wmb();
+	lowmem_reap_task = NULL;
+}
+
+static DECLARE_WORK(lowmem_reap_work, lowmem_reap_func);
+
+/* Called with tasklist_lock held right after p has been sent SIGKILL */
+static void lowmem_queue_reap(struct task_struct *p)
+{
+	if (!lowmem_reap || !lowmem_reap_wq)
+		return;
+
+	get_task_struct(p);
+	if (cmpxchg(&lowmem_reap_task, NULL, p) != NULL) {
+		/* still busy with the previous victim */
+		put_task_struct(p);
+		return;
+	}
+	queue_work(lowmem_reap_wq, &lowmem_reap_work);
+}
+
 #ifdef CONFIG_MEMORY_HOTPLUG
 static int lmk_hotplug_callback(struct notifier_block *self,
 				unsigned long cmd, void *data)
@@ -116,14 +412,57 @@ static int lmk_hotplug_callback(struct notifier_block *self,
 }
 #endif
 
+/*
+ * Select p for killing if it is a better choice than the current one.
+ * Called with tasklist_lock held for reading.
+ */
+static void lowmem_consider(struct task_struct *p, int min_adj,
+			    struct task_struct **selected,
+			    int *selected_tasksize, int *selected_oom_adj)
+{
+	struct mm_struct *mm;
+	struct signal_struct *sig;
+	int oom_adj;
+	int tasksize;
 
+	task_lock(p);
+	mm = p->mm;
+	sig = p->signal;
+	if (!mm || !sig) {
+		task_unlock(p);
+		return;
+	}
+	oom_adj = sig->oom_adj;
+	if (oom_adj < min_adj) {
+		task_unlock(p);
+		return;
+	}
+	/* memory drivers hold for the process goes away with it, too */
+	tasksize = get_mm_rss(mm) + get_mm_counter(mm, MM_UNRECLAIMABLE);
+	task_unlock(p);
+	if (tasksize <= 0)
+		return;
+	if (*selected) {
+		if (oom_adj < *selected_oom_adj)
+			return;
+		if (oom_adj == *selected_oom_adj &&
+		    tasksize <= *selected_tasksize)
+			return;
+	}
+	*selected = p;
+	*selected_tasksize = tasksize;
+	*selected_oom_adj = oom_adj;
+	lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
+		     p->pid, p->comm, oom_adj, tasksize);
+}
 
 static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
 	struct task_struct *p;
 	struct task_struct *selected = NULL;
+	struct task_struct *cand[LOWMEM_CANDIDATES];
+	int nr_cand = 0;
 	int rem = 0;
-	int tasksize;
 	int i;
 	int min_adj = OOM_ADJUST_MAX + 1;
 	int selected_tasksize = 0;
@@ -132,6 +471,7 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	int other_free = global_page_state(NR_FREE_PAGES);
 	int other_file = global_page_state(NR_FILE_PAGES) -
 						global_page_state(NR_SHMEM);
+	int pressure = 0;
 	struct zone *zone;
 
 	if (offlining) {
@@ -157,6 +497,17 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	    time_before_eq(jiffies, lowmem_deathpending_timeout))
 		return 0;
 
+	/*
+	 * When reclaim can hardly free any of the pages it scans, the page
+	 * cache isn't really free memory. Don't wait until direct reclaim
+	 * has ground through it.
+	 */
+	if (sc->nr_to_scan > 0) {
+		pressure = lowmem_pressure();
+		if (pressure >= lowmem_pressure_critical)
+			other_file = 0;
+	}
+
 	if (lowmem_adj_size < array_size)
 		array_size = lowmem_adj_size;
 	if (lowmem_minfree_size < array_size)
@@ -170,9 +521,10 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		}
 	}
 	if (sc->nr_to_scan > 0)
-		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %d\n",
+		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, "
+			     "pressure %d, ma %d\n",
 			     sc->nr_to_scan, sc->gfp_mask, other_free, other_file,
-			     min_adj);
+			     pressure, min_adj);
 	rem = global_page_state(NR_ACTIVE_ANON) +
 		global_page_state(NR_ACTIVE_FILE) +
 		global_page_state(NR_INACTIVE_ANON) +
@@ -184,40 +536,25 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	}
 	selected_oom_adj = min_adj;
 
+	nr_cand = lowmem_get_candidates(cand, min_adj);
+	if (!nr_cand) {
+		lowmem_print(4, "lowmem_shrink no process with adj >= %d\n",
+			     min_adj);
+		return rem;
+	}
+
 	read_lock(&tasklist_lock);
-	for_each_process(p) {
-		struct mm_struct *mm;
-		struct signal_struct *sig;
-		int oom_adj;
-
-		task_lock(p);
-		mm = p->mm;
-		sig = p->signal;
-		if (!mm || !sig) {
-			task_unlock(p);
-			continue;
-		}
-		oom_adj = sig->oom_adj;
-		if (oom_adj < min_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_adj < selected_oom_adj)
-				continue;
-			if (oom_adj == selected_oom_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_adj = oom_adj;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-			     p->pid, p->comm, oom_adj, tasksize);
+	for (i = 0; i < nr_cand; i++) {
+		/* skip a process that has been released meanwhile */
+		if (pid_alive(cand[i]))
+			lowmem_consider(cand[i], min_adj, &selected,
+					&selected_tasksize, &selected_oom_adj);
+	}
+	/* Only zombies near the top of the tree, fall back to a full scan */
+	if (!selected) {
+		for_each_process(p)
+			lowmem_consider(p, min_adj, &selected,
+					&selected_tasksize, &selected_oom_adj);
 	}
 	if (selected) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
@@ -226,11 +563,14 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		lowmem_deathpending = selected;
 		lowmem_deathpending_timeout = jiffies + HZ;
 		force_sig(SIGKILL, selected);
+		lowmem_queue_reap(selected);
 		rem -= selected_tasksize;
 	}
 	lowmem_print(4, "lowmem_shrink %lu, %x, return %d\n",
 		     sc->nr_to_scan, sc->gfp_mask, rem);
 	read_unlock(&tasklist_lock);
+	for (i = 0; i < nr_cand; i++)
+		put_task_struct(cand[i]);
 	return rem;
 }
 
@@ -241,6 +581,8 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	/* reaping is what frees memory, it must not wait for a worker */
+	lowmem_reap_wq = alloc_workqueue("lowmem_reap", WQ_MEM_RECLAIM, 1);
 	task_free_register(&task_nb);
 	register_shrinker(&lowmem_shrinker);
 #ifdef CONFIG_MEMORY_HOTPLUG
@@ -253,6 +595,8 @@ static void __exit lowmem_exit(void)
 {
 	unregister_shrinker(&lowmem_shrinker);
 	task_free_unregister(&task_nb);
+	if (lowmem_reap_wq)
+		destroy_workqueue(lowmem_reap_wq);
 }
 
 module_param_named(cost, lowmem_shrinker.seeks, int, S_IRUGO | S_IWUSR);
@@ -262,6 +606,9 @@ module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_array_named(swapfree, lowmem_swapfree, uint, &lowmem_swapfree_size,
 			 S_IRUGO | S_IWUSR);
+module_param_named(pressure_critical, lowmem_pressure_critical, int,
+		   S_IRUGO | S_IWUSR);
+module_param_named(reap, lowmem_reap, int, S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
 
 module_init(lowmem_init);
@@ -253,6 +253,7 @@ wpt_status WLANDXE_Start
       pVoid            pDXEContext : DXE Control Block
       wpt_packet       pPacket : transmit packet structure
       WDTS_ChannelType channel : TX channel
+      wpt_boolean      more : more frames follow in this TX series
 
   @  Return
       wpt_status
@@ -261,7 +262,8 @@ wpt_status WLANDXE_TxFrame
 (
    void                 *pDXEContext,
    wpt_packet           *pPacket,
-   WDTS_ChannelType      channel
+   WDTS_ChannelType      channel,
+   wpt_boolean           more
 );
 
 
@@ -171,8 +171,9 @@ static wpt_status dxeChannelMonitor
             "headCB Order %d, tailCB Order %d",
             channelEntry->headCtrlBlk->ctrlBlkOrder, channelEntry->tailCtrlBlk->ctrlBlkOrder);
    HDXE_MSG(eWLAN_MODULE_DAL_DATA, eWLAN_PAL_TRACE_LEVEL_FATAL,
-            "numFragmentCurrentChain %d, numTotalFrame %d ===",
-            channelEntry->numFragmentCurrentChain,    channelEntry->numTotalFrame);
+            "numFragmentCurrentChain %d, numTotalFrame %d, numTotalIntFrame %d ===",
+            channelEntry->numFragmentCurrentChain,    channelEntry->numTotalFrame,
+            channelEntry->numTotalIntFrame);
 
    return status;
 }
@@ -2344,6 +2345,8 @@ static void dxeRXISR
                                Channel specific control block
       wpt_packet              *palPacket
                                Packet pointer ready to transfer
+      wpt_boolean              more
+                               More frames follow in this TX series
 
   @  Return
       PAL_STATUS_T
@@ -2351,7 +2354,8 @@ static void dxeRXISR
 static wpt_status dxeTXPushFrame
 (
    WLANDXE_ChannelCBType   *channelEntry,
-   wpt_packet              *palPacket
+   wpt_packet              *palPacket,
+   wpt_boolean              more
 )
 {
    wpt_status                  status = eWLAN_PAL_STATUS_SUCCESS;
@@ -2507,7 +2511,23 @@ static wpt_status dxeTXPushFrame
                "dxeTXPushFrame NULL Last Descriptor, broken chain");
       return eWLAN_PAL_STATUS_E_FAULT;
    }
-   LastDesc->descCtrl.ctrl  = channelEntry->extraConfig.cw_ctrl_write_eop_int;
+   /* TX complete interrupt is coalesced over a series of frames:
+    * only every txInterruptEnableFrameCount-th frame, the last frame
+    * of the series and a frame leaving the ring at low resource raise it.
+    * Frames before it are reclaimed together with it */
+   if((eWLAN_PAL_TRUE == more) &&
+      (WLANDXE_TX_COMP_INT_PER_K_FRAMES == tempDxeCtrlBlk->txCompInt.txIntEnable) &&
+      (channelEntry->numFrameBeforeInt < tempDxeCtrlBlk->txCompInt.txInterruptEnableFrameCount) &&
+      (channelEntry->numFreeDesc > tempDxeCtrlBlk->txCompInt.txLowResourceThreshold))
+   {
+      LastDesc->descCtrl.ctrl  = channelEntry->extraConfig.cw_ctrl_write_eop;
+   }
+   else
+   {
+      LastDesc->descCtrl.ctrl  = channelEntry->extraConfig.cw_ctrl_write_eop_int;
+      channelEntry->numFrameBeforeInt = 0;
+      channelEntry->numTotalIntFrame++;
+   }
    /* Now First one also Valid ????
     * this procedure will prevent over handle descriptor from previous
     * TX trigger */
@@ -3812,6 +3832,7 @@ wpt_status WLANDXE_Start
       pVoid            pDXEContext : DXE Control Block
       wpt_packet       pPacket : transmit packet structure
       WDTS_ChannelType channel : TX channel
+      wpt_boolean      more : more frames follow in this TX series
 
   @  Return
       wpt_status
@@ -3820,7 +3841,8 @@ wpt_status WLANDXE_TxFrame
 (
    void                *pDXEContext,
    wpt_packet          *pPacket,
-   WDTS_ChannelType     channel
+   WDTS_ChannelType     channel,
+   wpt_boolean          more
 )
 {
    wpt_status                 status         = eWLAN_PAL_STATUS_SUCCESS;
@@ -3890,7 +3912,7 @@ wpt_status WLANDXE_TxFrame
 
    /* Update DXE descriptor, this is frame based
     * if a frame consist of N fragments, N Descriptor will be programed */
-   status = dxeTXPushFrame(currentChannel, pPacket);
+   status = dxeTXPushFrame(currentChannel, pPacket, more);
    if(eWLAN_PAL_STATUS_SUCCESS != status)
    {
       wpalMutexRelease(&currentChannel->dxeChannelLock);
@@ -558,8 +558,8 @@ wpt_status dxeChannelDefaultConfig
    dxeControlWrite |= WLANDXE_DESC_CTRL_BDT_SWAP;
    /* Host Little Endian */
    dxeControlWrite |= WLANDXE_DESC_CTRL_ENDIANNESS;
-   /* Interrupt Enable */
-   dxeControlWrite |= WLANDXE_DESC_CTRL_INT;
+   /* Interrupt is only raised by the EOP INT control word below,
+    * fragments and coalesced frames complete along with it */
 
    dxeControlWriteValid  = dxeControlWrite | WLANDXE_DESC_CTRL_VALID;
    dxeControlWriteEop    = dxeControlWriteValid | WLANDXE_DESC_CTRL_EOP;
@@ -54,6 +54,10 @@
 #include "vos_memory.h"
 #include "vos_trace.h"
 
+#ifdef CONFIG_WCNSS_MEM_PRE_ALLOC
+#include <linux/wcnss_wlan.h>
+#endif
+
 #ifdef MEMORY_DEBUG
 #include "wlan_hdd_dp_utils.h"
 
@@ -230,6 +234,16 @@ v_VOID_t * vos_mem_malloc( v_SIZE_t size )
       VOS_TRACE(VOS_MODULE_ID_VOSS, VOS_TRACE_LEVEL_ERROR, "%s cannot be called from interrupt context!!!", __FUNCTION__);
       return NULL;
    }
+#ifdef CONFIG_WCNSS_MEM_PRE_ALLOC
+   /* Large buffers come from the pool set aside at boot, so loading the
+      driver doesn't depend on high order pages after long uptime */
+   if (size > WCNSS_PRE_ALLOC_GET_THRESHOLD)
+   {
+      v_VOID_t *pmem = wcnss_prealloc_get(size);
+      if (NULL != pmem)
+         return pmem;
+   }
+#endif
    return kmalloc(size, GFP_KERNEL);
 }   
 
@@ -237,6 +251,10 @@ v_VOID_t vos_mem_free( v_VOID_t *ptr )
 {
     if (ptr == NULL)
       return;
+#ifdef CONFIG_WCNSS_MEM_PRE_ALLOC
+    if (wcnss_prealloc_put(ptr))
+      return;
+#endif
     kfree(ptr);
 }
 #endif
@@ -1402,9 +1402,10 @@ WDA_DS_TxFrames
        vosStatus = VOS_STATUS_SUCCESS;
     }
 
+    /* The last frame of the chain raises the TX complete interrupt */
     wdiStatus = WDI_DS_TxPacket( wdaContext->pWdiContext, 
                                  (wpt_packet*)pTxPacket, 
-                                 0 /* more */ );
+                                 (NULL != pTxDataChain) /* more */ );
     if ( WDI_STATUS_SUCCESS != wdiStatus )
     {
       VOS_TRACE( VOS_MODULE_ID_TL, VOS_TRACE_LEVEL_ERROR,
@@ -189,7 +189,7 @@ WDI_Status WDI_DS_TxPacket(void *pContext,
     return WDI_STATUS_E_FAILURE;
   }
   // Send packet to transport layer.
-  if(eWLAN_PAL_STATUS_SUCCESS !=WDTS_TxPacket(pContext, pFrame)){
+  if(eWLAN_PAL_STATUS_SUCCESS !=WDTS_TxPacket(pContext, pFrame, more)){
     WDI_DS_MemPoolFree(pMemPool, pvBDHeader, physBDHeader);
     return WDI_STATUS_E_FAILURE;
   }  
@@ -100,7 +100,8 @@ typedef struct {
   wpt_status (*start) (void *pContext);
   wpt_status (*register_client)(void *pContext, WDTS_RxFrameReadyCbType, 
       WDTS_TxCompleteCbType, WDTS_LowResourceCbType, void *clientData);
-  wpt_status (*xmit) (void *pContext, wpt_packet *packet, WDTS_ChannelType channel);
+  wpt_status (*xmit) (void *pContext, wpt_packet *packet, WDTS_ChannelType channel,
+      wpt_boolean more);
   wpt_status (*txComplete) (void *pContext);
   wpt_status (*setPowerState) (void *pContext, WDTS_PowerStateType   powerState, 
                                WDTS_SetPSCbType cBack);
@@ -148,11 +149,12 @@ wpt_status WDTS_startTransport( void *pContext);
  * Parameters:
  * pContext:Cookie that should be passed back to the caller along with the callback.
  * pFrame:Refernce to PAL frame.
+ * more: Does the invokee have more than one packet pending?
  * Return Value: SUCCESS  Completed successfully.
  *     FAILURE_XXX  Request was rejected due XXX Reason.
  *
  */
-wpt_status WDTS_TxPacket(void *pContext, wpt_packet *pFrame);
+wpt_status WDTS_TxPacket(void *pContext, wpt_packet *pFrame, wpt_boolean more);
 
 /* DTS Tx Complete function. 
  * This function should be invoked by the DAL Dataservice to notify tx completion to DXE/SDIO.
@@ -447,11 +447,12 @@ wpt_status WDTS_startTransport( void *pContext)
  * Parameters:
  * pContext:Cookie that should be passed back to the caller along with the callback.
  * pFrame:Refernce to PAL frame.
+ * more: Does the invokee have more than one packet pending?
  * Return Value: SUCCESS  Completed successfully.
  *     FAILURE_XXX  Request was rejected due XXX Reason.
  *
  */
-wpt_status WDTS_TxPacket(void *pContext, wpt_packet *pFrame)
+wpt_status WDTS_TxPacket(void *pContext, wpt_packet *pFrame, wpt_boolean more)
 {
   void *pDTDriverContext = WDT_GetTransportDriverContext(pContext);
   WDI_DS_TxMetaInfoType     *pTxMetadata;
@@ -466,7 +467,7 @@ wpt_status WDTS_TxPacket(void *pContext, wpt_packet *pFrame)
       WDTS_CHANNEL_TX_LOW_PRI : WDTS_CHANNEL_TX_HIGH_PRI;
   
   // Send packet to  Transport Driver. 
-  status =  gTransportDriver.xmit(pDTDriverContext, pFrame, channel);
+  status =  gTransportDriver.xmit(pDTDriverContext, pFrame, channel, more);
   return status;
 }
 
@@ -70,6 +70,27 @@ struct zcache_client {
 static struct zcache_client zcache_host;
 static struct zcache_client zcache_clients[MAX_CLIENTS];
 
+/*
+ * zcache's view of a tmem pool.  The counters are updated without locking,
+ * like the global ones, so they are only approximate.
+ */
+struct zcache_pool {
+	struct tmem_pool tmem_pool;
+	unsigned long puts;		/* pages stored */
+	unsigned long hits;		/* gets that found the page */
+	unsigned long misses;
+	unsigned long evicts;		/* pages dropped by the shrinker */
+	unsigned long rejects;		/* puts refused by admission policy */
+	/* ephemeral admission state, see zcache_eph_admit() */
+	unsigned long window_puts;
+	unsigned long window_hits;
+	unsigned int hit_percent;
+	unsigned int mean_zsize;
+	unsigned int skipped;
+};
+
+#define to_zcache_pool(_pool) container_of(_pool, struct zcache_pool, tmem_pool)
+
 static inline uint16_t get_client_id_from_client(struct zcache_client *cli)
 {
 	BUG_ON(cli == NULL);
@@ -510,7 +531,8 @@ static void zbud_evict_zbpg(struct zbud_page *zbpg)
 	for (i = 0; i < j; i++) {
 		pool = zcache_get_pool_by_id(client_id[i], pool_id[i]);
 		if (pool != NULL) {
-			tmem_flush_page(pool, &oid[i], index[i]);
+			if (tmem_flush_page(pool, &oid[i], index[i]) >= 0)
+				to_zcache_pool(pool)->evicts++;
 			zcache_put_pool(pool);
 		}
 	}
@@ -1169,6 +1191,48 @@ static unsigned long zcache_curr_pers_pampd_count_max;
 /* forward reference */
 static int zcache_compress(struct page *from, void **out_va, size_t *out_len);
 
+/*
+ * Ephemeral (cleancache) pages are only worth compressing if they are found
+ * again before they are evicted, and if they compress well enough to save
+ * memory.  Each pool keeps a running mean of its compressed page size and
+ * its hit rate over roughly the last ZCACHE_ADMIT_WINDOW puts.  While either
+ * is poor only one put in ZCACHE_ADMIT_SAMPLE is compressed, so the pool
+ * notices when its workload changes.
+ */
+#define ZCACHE_ADMIT_WINDOW	1024
+#define ZCACHE_ADMIT_SAMPLE	16
+
+static unsigned int zbud_max_mean_zsize = (PAGE_SIZE / 8) * 5;
+static unsigned int zcache_eph_min_hit_percent = 5;
+
+static bool zcache_eph_admit(struct zcache_pool *zpool)
+{
+	if (zpool->hit_percent >= zcache_eph_min_hit_percent &&
+	    zpool->mean_zsize <= zbud_max_mean_zsize)
+		return true;
+	if (++zpool->skipped < ZCACHE_ADMIT_SAMPLE)
+		return false;
+	zpool->skipped = 0;
+	return true;
+}
+
+static void zcache_eph_account(struct zcache_pool *zpool, size_t clen)
+{
+	unsigned long pct;
+
+	if (clen == 0 || clen > PAGE_SIZE)
+		clen = PAGE_SIZE;
+	zpool->mean_zsize = (zpool->mean_zsize * 7 + clen) / 8;
+
+	if (++zpool->window_puts < ZCACHE_ADMIT_WINDOW)
+		return;
+	pct = (zpool->window_hits * 100) / zpool->window_puts;
+	zpool->hit_percent = min(pct, 100UL);
+	/* decay rather than reset, so one window doesn't flip the policy */
+	zpool->window_puts /= 2;
+	zpool->window_hits /= 2;
+}
+
 static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 				struct tmem_pool *pool, struct tmem_oid *oid,
 				 uint32_t index)
@@ -1179,17 +1243,24 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 	unsigned long count;
 	struct page *page = (struct page *)(data);
 	struct zcache_client *cli = pool->client;
+	struct zcache_pool *zpool = to_zcache_pool(pool);
 	uint16_t client_id = get_client_id_from_client(cli);
 	unsigned long zv_mean_zsize;
 	unsigned long curr_pers_pampd_count;
 	u64 total_zsize;
 
 	if (eph) {
+		if (!zcache_eph_admit(zpool)) {
+			zpool->rejects++;
+			goto out;
+		}
 		ret = zcache_compress(page, &cdata, &clen);
 		if (ret == 0)
 			goto out;
+		zcache_eph_account(zpool, clen);
 		if (clen == 0 || clen > zbud_max_buddy_size()) {
 			zcache_compress_poor++;
+			zpool->rejects++;
 			goto out;
 		}
 		pampd = (void *)zbud_create(client_id, pool->pool_id, oid,
@@ -1203,14 +1274,17 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 		curr_pers_pampd_count =
 			atomic_read(&zcache_curr_pers_pampd_count);
 		if (curr_pers_pampd_count >
-		    (zv_page_count_policy_percent * totalram_pages) / 100)
+		    (zv_page_count_policy_percent * totalram_pages) / 100) {
+			zpool->rejects++;
 			goto out;
+		}
 		ret = zcache_compress(page, &cdata, &clen);
 		if (ret == 0)
 			goto out;
 		/* reject if compression is too poor */
 		if (clen > zv_max_zsize) {
 			zcache_compress_poor++;
+			zpool->rejects++;
 			goto out;
 		}
 		/* reject if mean compression is too poor */
@@ -1220,6 +1294,7 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 						curr_pers_pampd_count);
 			if (zv_mean_zsize > zv_max_mean_zsize) {
 				zcache_mean_compress_poor++;
+				zpool->rejects++;
 				goto out;
 			}
 		}
@@ -1231,6 +1306,8 @@ static void *zcache_pampd_create(char *data, size_t size, bool raw, int eph,
 		if (count > zcache_curr_pers_pampd_count_max)
 			zcache_curr_pers_pampd_count_max = count;
 	}
+	if (pampd != NULL)
+		zpool->puts++;
 out:
 	return pampd;
 }
@@ -1447,6 +1524,97 @@ static struct notifier_block zcache_cpu_notifier_block = {
 		.show = zcache_##_name##_show, \
 	}
 
+/* one line per local pool, the columns are named in the first line */
+static int zcache_pool_stats_show(char *buf)
+{
+	struct tmem_pool *pool;
+	struct zcache_pool *zpool;
+	char *p = buf;
+	int i;
+
+	p += sprintf(p, "id type puts hits misses evicts rejects "
+			"hit_percent mean_zsize\n");
+	for (i = 0; i < MAX_POOLS_PER_CLIENT; i++) {
+		pool = zcache_get_pool_by_id(LOCAL_CLIENT, i);
+		if (pool == NULL)
+			continue;
+		zpool = to_zcache_pool(pool);
+		p += sprintf(p, "%d %s %lu %lu %lu %lu %lu %u %u\n", i,
+			     is_ephemeral(pool) ? "eph" : "pers",
+			     zpool->puts, zpool->hits, zpool->misses,
+			     zpool->evicts, zpool->rejects,
+			     zpool->hit_percent, zpool->mean_zsize);
+		zcache_put_pool(pool);
+	}
+	return p - buf;
+}
+
+/*
+ * Ephemeral pools whose pages compress worse than zbud_max_mean_zsize on
+ * average, or whose hit rate is below eph_min_hit_percent, only compress
+ * a sample of their puts.  Setting eph_min_hit_percent to 0 and
+ * zbud_max_mean_zsize to PAGE_SIZE admits everything.
+ */
+static ssize_t zbud_max_mean_zsize_show(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    char *buf)
+{
+	return sprintf(buf, "%u\n", zbud_max_mean_zsize);
+}
+
+static ssize_t zbud_max_mean_zsize_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	err = kstrtoul(buf, 10, &val);
+	if (err || (val == 0) || (val > PAGE_SIZE))
+		return -EINVAL;
+	zbud_max_mean_zsize = val;
+	return count;
+}
+
+static ssize_t eph_min_hit_percent_show(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    char *buf)
+{
+	return sprintf(buf, "%u\n", zcache_eph_min_hit_percent);
+}
+
+static ssize_t eph_min_hit_percent_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long val;
+	int err;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	err = kstrtoul(buf, 10, &val);
+	if (err || (val > 100))
+		return -EINVAL;
+	zcache_eph_min_hit_percent = val;
+	return count;
+}
+
+static struct kobj_attribute zcache_zbud_max_mean_zsize_attr = {
+		.attr = { .name = "zbud_max_mean_zsize", .mode = 0644 },
+		.show = zbud_max_mean_zsize_show,
+		.store = zbud_max_mean_zsize_store,
+};
+
+static struct kobj_attribute zcache_eph_min_hit_percent_attr = {
+		.attr = { .name = "eph_min_hit_percent", .mode = 0644 },
+		.show = eph_min_hit_percent_show,
+		.store = eph_min_hit_percent_store,
+};
+
 ZCACHE_SYSFS_RO(curr_obj_count_max);
 ZCACHE_SYSFS_RO(curr_objnode_count_max);
 ZCACHE_SYSFS_RO(flush_total);
@@ -1480,6 +1648,7 @@ ZCACHE_SYSFS_RO_CUSTOM(zv_curr_dist_counts,
 			zv_curr_dist_counts_show);
 ZCACHE_SYSFS_RO_CUSTOM(zv_cumul_dist_counts,
 			zv_cumul_dist_counts_show);
+ZCACHE_SYSFS_RO_CUSTOM(pool_stats, zcache_pool_stats_show);
 
 static struct attribute *zcache_attrs[] = {
 	&zcache_curr_obj_count_attr.attr,
@@ -1514,6 +1683,9 @@ static struct attribute *zcache_attrs[] = {
 	&zcache_zv_max_zsize_attr.attr,
 	&zcache_zv_max_mean_zsize_attr.attr,
 	&zcache_zv_page_count_policy_percent_attr.attr,
+	&zcache_pool_stats_attr.attr,
+	&zcache_zbud_max_mean_zsize_attr.attr,
+	&zcache_eph_min_hit_percent_attr.attr,
 	NULL,
 };
 
@@ -1606,9 +1778,17 @@ static int zcache_get_page(int cli_id, int pool_id, struct tmem_oid *oidp,
 	local_irq_save(flags);
 	pool = zcache_get_pool_by_id(cli_id, pool_id);
 	if (likely(pool != NULL)) {
+		struct zcache_pool *zpool = to_zcache_pool(pool);
+
 		if (atomic_read(&pool->obj_count) > 0)
 			ret = tmem_get(pool, oidp, index, (char *)(page),
 					&size, 0, is_ephemeral(pool));
+		if (ret >= 0) {
+			zpool->hits++;
+			if (is_ephemeral(pool))
+				zpool->window_hits++;
+		} else
+			zpool->misses++;
 		zcache_put_pool(pool);
 	}
 	local_irq_restore(flags);
@@ -1683,7 +1863,7 @@ static int zcache_destroy_pool(int cli_id, int pool_id)
 	local_bh_disable();
 	ret = tmem_destroy_pool(pool);
 	local_bh_enable();
-	kfree(pool);
+	kfree(to_zcache_pool(pool));
 	pr_info("zcache: destroyed pool id=%d, cli_id=%d\n",
 			pool_id, cli_id);
 out:
@@ -1693,6 +1873,7 @@ out:
 static int zcache_new_pool(uint16_t cli_id, uint32_t flags)
 {
 	int poolid = -1;
+	struct zcache_pool *zpool;
 	struct tmem_pool *pool;
 	struct zcache_client *cli = NULL;
 
@@ -1703,18 +1884,20 @@ static int zcache_new_pool(uint16_t cli_id, uint32_t flags)
 	if (cli == NULL)
 		goto out;
 	atomic_inc(&cli->refcount);
-	pool = kmalloc(sizeof(struct tmem_pool), GFP_ATOMIC);
-	if (pool == NULL) {
+	zpool = kzalloc(sizeof(struct zcache_pool), GFP_ATOMIC);
+	if (zpool == NULL) {
 		pr_info("zcache: pool creation failed: out of memory\n");
 		goto out;
 	}
+	zpool->hit_percent = 100;
+	pool = &zpool->tmem_pool;
 
 	for (poolid = 0; poolid < MAX_POOLS_PER_CLIENT; poolid++)
 		if (cli->tmem_pools[poolid] == NULL)
 			break;
 	if (poolid >= MAX_POOLS_PER_CLIENT) {
 		pr_info("zcache: pool creation failed: max exceeded\n");
-		kfree(pool);
+		kfree(zpool);
 		poolid = -1;
 		goto out;
 	}
@@ -30,8 +30,12 @@
 #include <linux/highmem.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/percpu.h>
+#include <linux/jhash.h>
+#include <linux/rbtree.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -89,18 +93,20 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
-static int page_zero_filled(void *ptr)
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
+
 	return 1;
 }
 
@@ -133,44 +139,125 @@ static void zram_set_disksize(struct zram *zram, size_t totalram_bytes)
 	zram->disksize &= PAGE_MASK;
 }
 
+/*
+ * Compressed objects are shared between all the pages that compress to
+ * the same data. They are kept in an rbtree sorted by checksum, a page
+ * whose checksum collides with a different object is just stored again.
+ */
+static struct zram_obj *zram_obj_find(struct zram *zram, void *src,
+				      size_t clen, u32 checksum)
+{
+	struct rb_node *node = zram->obj_tree.rb_node;
+	struct zram_obj *obj;
+	unsigned char *cmem;
+	int match;
+
+	while (node) {
+		obj = rb_entry(node, struct zram_obj, node);
+		if (checksum < obj->checksum) {
+			node = node->rb_left;
+		} else if (checksum > obj->checksum) {
+			node = node->rb_right;
+		} else {
+			if (obj->clen != clen)
+				return NULL;
+
+			cmem = zs_map_object(zram->mem_pool, obj->handle,
+					     ZS_MM_RO);
+			match = !memcmp(cmem + sizeof(struct zobj_header),
+					src, clen);
+			zs_unmap_object(zram->mem_pool, obj->handle);
+
+			return match ? obj : NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static void zram_obj_insert(struct zram *zram, struct zram_obj *obj)
+{
+	struct rb_node **p = &zram->obj_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct zram_obj *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct zram_obj, node);
+		if (obj->checksum < entry->checksum)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	rb_link_node(&obj->node, parent, p);
+	rb_insert_color(&obj->node, &zram->obj_tree);
+}
+
+static void zram_obj_put(struct zram *zram, struct zram_obj *obj)
+{
+	if (--obj->refcount) {
+		zram_stat_dec(&zram->stats.pages_dup);
+		return;
+	}
+
+	rb_erase(&obj->node, &zram->obj_tree);
+	zs_free(zram->mem_pool, obj->handle);
+	zram_stat64_sub(zram, &zram->stats.compr_size, obj->clen);
+	kfree(obj);
+}
+
 static void zram_free_page(struct zram *zram, size_t index)
 {
-	u32 clen;
-	void *obj;
+	struct zram_obj *obj;
 
-	struct page *page = zram->table[index].page;
-	u32 offset = zram->table[index].offset;
+	/* A writeback in progress drops its copy when it sees this */
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 
-	if (unlikely(!page)) {
-		/*
-		 * No memory is allocated for zero filled pages.
-		 * Simply clear zero page flag.
-		 */
-		if (zram_test_flag(zram, index, ZRAM_ZERO)) {
-			zram_clear_flag(zram, index, ZRAM_ZERO);
-			zram_stat_dec(&zram->stats.pages_zero);
-		}
+#ifdef CONFIG_ZRAM_WRITEBACK
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		zram_clear_flag(zram, index, ZRAM_WB);
+		clear_bit(zram->table[index].element, zram->wb_map);
+		zram->table[index].element = 0;
+		zram_stat_dec(&zram->stats.pages_wb);
+		return;
+	}
+#endif
+
+	/*
+	 * No memory is allocated for zero filled pages or pages
+	 * filled with a single repeating word. Simply clear the flag.
+	 */
+	if (zram_test_flag(zram, index, ZRAM_ZERO)) {
+		zram_clear_flag(zram, index, ZRAM_ZERO);
+		zram_stat_dec(&zram->stats.pages_zero);
 		return;
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		zram_clear_flag(zram, index, ZRAM_SAME);
+		zram_stat_dec(&zram->stats.pages_same);
+		zram->table[index].element = 0;
+		return;
+	}
+
+	if (unlikely(!zram->table[index].page))
+		return;
+
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
-		clen = PAGE_SIZE;
-		__free_page(page);
+		__free_page(zram->table[index].page);
 		zram_clear_flag(zram, index, ZRAM_UNCOMPRESSED);
 		zram_stat_dec(&zram->stats.pages_expand);
+		zram_stat64_sub(zram, &zram->stats.compr_size, PAGE_SIZE);
 		goto out;
 	}
 
-	obj = kmap_atomic(page, KM_USER0) + offset;
-	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
-	kunmap_atomic(obj, KM_USER0);
-
-	xv_free(zram->mem_pool, page, offset);
-	if (clen <= PAGE_SIZE / 2)
+	obj = zram->table[index].obj;
+	if (obj->clen <= PAGE_SIZE / 2)
 		zram_stat_dec(&zram->stats.good_compress);
+	zram_obj_put(zram, obj);
 
 out:
-	zram_stat64_sub(zram, &zram->stats.compr_size, clen);
 	zram_stat_dec(&zram->stats.pages_stored);
 
 	zram->table[index].page = NULL;
@@ -188,6 +275,19 @@ static void handle_zero_page(struct page *page)
 	flush_dcache_page(page);
 }
 
+static void handle_same_page(struct page *page, unsigned long element)
+{
+	unsigned int pos;
+	unsigned long *user_mem;
+
+	user_mem = kmap_atomic(page, KM_USER0);
+	for (pos = 0; pos != PAGE_SIZE / sizeof(*user_mem); pos++)
+		user_mem[pos] = element;
+	kunmap_atomic(user_mem, KM_USER0);
+
+	flush_dcache_page(page);
+}
+
 static void handle_uncompressed_page(struct zram *zram,
 				struct page *page, u32 index)
 {
@@ -210,6 +310,7 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	int ret;
 	size_t clen;
 	struct page *page;
+	struct zram_obj *obj;
 	struct zobj_header *zheader;
 	unsigned char *user_mem, *cmem;
 
@@ -220,6 +321,11 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		return 0;
 	}
 
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		handle_same_page(page, zram->table[index].element);
+		return 0;
+	}
+
 	/* Requested page is not present in compressed area */
 	if (unlikely(!zram->table[index].page)) {
 		pr_debug("Read before write: sector=%lu, size=%u",
@@ -234,18 +340,17 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		return 0;
 	}
 
+	obj = zram->table[index].obj;
 	user_mem = kmap_atomic(page, KM_USER0);
 	clen = PAGE_SIZE;
 
-	cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-		zram->table[index].offset;
+	cmem = zs_map_object(zram->mem_pool, obj->handle, ZS_MM_RO);
 
-	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader),
-				    xv_get_object_size(cmem) - sizeof(*zheader),
+	ret = lzo1x_decompress_safe(cmem + sizeof(*zheader), obj->clen,
 				    user_mem, &clen);
 
+	zs_unmap_object(zram->mem_pool, obj->handle);
 	kunmap_atomic(user_mem, KM_USER0);
-	kunmap_atomic(cmem, KM_USER1);
 
 	/* Should NEVER happen. Return bio error if it does. */
 	if (unlikely(ret != LZO_E_OK)) {
@@ -259,40 +364,70 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	return 0;
 }
 
+static struct zram_stream *zram_stream_get(struct zram *zram)
+{
+	struct zram_stream *zs;
+
+	zs = per_cpu_ptr(zram->streams, raw_smp_processor_id());
+	mutex_lock(&zs->lock);
+
+	return zs;
+}
+
+static void zram_stream_put(struct zram_stream *zs)
+{
+	mutex_unlock(&zs->lock);
+}
+
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index)
 {
 	int ret;
-	u32 offset;
+	u32 checksum;
 	size_t clen;
+	unsigned long element;
 	struct zobj_header *zheader;
-	struct page *page, *page_store;
+	struct zram_stream *zs;
+	struct zram_obj *obj = NULL;
+	struct page *page, *page_store = NULL;
 	unsigned char *user_mem, *cmem, *src;
 
 	page = bvec->bv_page;
-	src = zram->compress_buffer;
-
-	/*
-	 * System overwrites unused sectors. Free memory associated
-	 * with this sector now.
-	 */
-	if (zram->table[index].page ||
-	    zram_test_flag(zram, index, ZRAM_ZERO))
-		zram_free_page(zram, index);
 
 	user_mem = kmap_atomic(page, KM_USER0);
-	if (page_zero_filled(user_mem)) {
+	if (page_same_filled(user_mem, &element)) {
 		kunmap_atomic(user_mem, KM_USER0);
-		zram_stat_inc(&zram->stats.pages_zero);
-		zram_set_flag(zram, index, ZRAM_ZERO);
+		write_lock(&zram->table_lock);
+		/*
+		 * System overwrites unused sectors. Free memory associated
+		 * with this sector now.
+		 */
+		zram_free_page(zram, index);
+		if (element) {
+			zram->table[index].element = element;
+			zram_stat_inc(&zram->stats.pages_same);
+			zram_set_flag(zram, index, ZRAM_SAME);
+		} else {
+			zram_stat_inc(&zram->stats.pages_zero);
+			zram_set_flag(zram, index, ZRAM_ZERO);
+		}
+		write_unlock(&zram->table_lock);
 		return 0;
 	}
+	kunmap_atomic(user_mem, KM_USER0);
 
-	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
-			       zram->compress_workmem);
+	/*
+	 * Compress and store the page without holding the table lock,
+	 * the new object only replaces the old one once it is complete.
+	 */
+	zs = zram_stream_get(zram);
+	src = zs->buffer;
 
+	user_mem = kmap_atomic(page, KM_USER0);
+	ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen, zs->workmem);
 	kunmap_atomic(user_mem, KM_USER0);
 
 	if (unlikely(ret != LZO_E_OK)) {
+		zram_stream_put(zs);
 		pr_err("Compression failed! err=%d\n", ret);
 		zram_stat64_inc(zram, &zram->stats.failed_writes);
 		return ret;
@@ -304,77 +439,385 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index)
 	 * errors which has side effect of hanging the system.
 	 */
 	if (unlikely(clen > max_zpage_size)) {
+		zram_stream_put(zs);
 		clen = PAGE_SIZE;
 		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
 		if (unlikely(!page_store)) {
 			pr_info("Error allocating memory for "
 				"incompressible page: %u\n", index);
 			zram_stat64_inc(zram, &zram->stats.failed_writes);
-				return -ENOMEM;
-			}
+			return -ENOMEM;
+		}
 
-		offset = 0;
-		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
-		zram_stat_inc(&zram->stats.pages_expand);
-		zram->table[index].page = page_store;
-		src = kmap_atomic(page, KM_USER0);
+		user_mem = kmap_atomic(page, KM_USER0);
+		cmem = kmap_atomic(page_store, KM_USER1);
+		memcpy(cmem, user_mem, PAGE_SIZE);
+		kunmap_atomic(cmem, KM_USER1);
+		kunmap_atomic(user_mem, KM_USER0);
 		goto memstore;
 	}
 
-	if (xv_malloc(zram->mem_pool, clen + sizeof(*zheader),
-		      &zram->table[index].page, &offset,
-		      GFP_NOIO | __GFP_HIGHMEM)) {
+	/* Share the object of an identical page if there is one */
+	checksum = jhash(src, clen, 0);
+	write_lock(&zram->table_lock);
+	obj = zram_obj_find(zram, src, clen, checksum);
+	if (obj) {
+		obj->refcount++;
+		zram_stat_inc(&zram->stats.pages_dup);
+		zram_free_page(zram, index);
+		zram_stream_put(zs);
+		goto store;
+	}
+	write_unlock(&zram->table_lock);
+
+	obj = kmalloc(sizeof(*obj), GFP_NOIO);
+	if (likely(obj))
+		obj->handle = zs_malloc(zram->mem_pool,
+					clen + sizeof(*zheader),
+					GFP_NOIO | __GFP_HIGHMEM);
+	if (unlikely(!obj || !obj->handle)) {
+		zram_stream_put(zs);
+		kfree(obj);
 		pr_info("Error allocating memory for compressed "
 			"page: %u, size=%zu\n", index, clen);
 		zram_stat64_inc(zram, &zram->stats.failed_writes);
 		return -ENOMEM;
 	}
 
-memstore:
-	zram->table[index].offset = offset;
+	obj->clen = clen;
+	obj->checksum = checksum;
+	obj->refcount = 1;
 
-	cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-		zram->table[index].offset;
+	cmem = zs_map_object(zram->mem_pool, obj->handle, ZS_MM_WO);
 
 #if 0
 	/* Back-reference needed for memory defragmentation */
-	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
-		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
-	}
+	zheader = (struct zobj_header *)cmem;
+	zheader->table_idx = index;
+	cmem += sizeof(*zheader);
 #endif
 
 	memcpy(cmem, src, clen);
 
-	kunmap_atomic(cmem, KM_USER1);
-	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
-		kunmap_atomic(src, KM_USER0);
+	zs_unmap_object(zram->mem_pool, obj->handle);
+	zram_stream_put(zs);
+
+memstore:
+	write_lock(&zram->table_lock);
+
+	/*
+	 * System overwrites unused sectors. Free memory associated
+	 * with this sector now.
+	 */
+	zram_free_page(zram, index);
 
-	/* Update stats */
+	/* Update stats, only the new object adds to the compressed size */
 	zram_stat64_add(zram, &zram->stats.compr_size, clen);
+	if (unlikely(page_store)) {
+		zram->table[index].page = page_store;
+		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
+		zram_stat_inc(&zram->stats.pages_expand);
+	} else {
+		zram_obj_insert(zram, obj);
+	}
+
+store:
+	if (obj) {
+		zram->table[index].obj = obj;
+		zram->table[index].offset = 0;
+	}
 	zram_stat_inc(&zram->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
 		zram_stat_inc(&zram->stats.good_compress);
 
+	write_unlock(&zram->table_lock);
+
+	return 0;
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+static void zram_bdev_end_io(struct bio *bio, int err)
+{
+	complete(bio->bi_private);
+}
+
+/* Synchronously read or write one page of the backing device */
+static int zram_bdev_rw(struct zram *zram, struct page *page,
+			unsigned long blk, int rw)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = (sector_t)blk << SECTORS_PER_PAGE_SHIFT;
+	bio->bi_bdev = zram->bdev;
+	bio->bi_end_io = zram_bdev_end_io;
+	bio->bi_private = &done;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	submit_bio(rw | REQ_SYNC, bio);
+	wait_for_completion(&done);
+
+	ret = test_bit(BIO_UPTODATE, &bio->bi_flags) ? 0 : -EIO;
+	bio_put(bio);
+
+	return ret;
+}
+
+struct zram_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct page *page;
+	unsigned long blk;
+	int ret;
+};
+
+static void zram_sync_read(struct work_struct *work)
+{
+	struct zram_work *zw = container_of(work, struct zram_work, work);
+
+	zw->ret = zram_bdev_rw(zw->zram, zw->page, zw->blk, READ);
+}
+
+/*
+ * Bios submitted from our make_request function are only issued once it
+ * returns, so waiting for one here would deadlock. Do the read from a
+ * worker instead.
+ */
+static int zram_read_from_bdev(struct zram *zram, struct bio_vec *bvec,
+			       u32 index)
+{
+	struct zram_work zw;
+
+	/* Hold off reuse of the block until it has been read */
+	down_read(&zram->wb_sem);
+	read_lock(&zram->table_lock);
+	if (!zram_test_flag(zram, index, ZRAM_WB)) {
+		read_unlock(&zram->table_lock);
+		up_read(&zram->wb_sem);
+		return -EAGAIN;
+	}
+	zw.blk = zram->table[index].element;
+	read_unlock(&zram->table_lock);
+
+	zw.zram = zram;
+	zw.page = bvec->bv_page;
+	INIT_WORK_ONSTACK(&zw.work, zram_sync_read);
+	queue_work(system_unbound_wq, &zw.work);
+	flush_work(&zw.work);
+	destroy_work_on_stack(&zw.work);
+	up_read(&zram->wb_sem);
+
+	if (zw.ret) {
+		pr_err("Backing device read failed! err=%d, page=%u\n",
+			zw.ret, index);
+		zram_stat64_inc(zram, &zram->stats.failed_reads);
+		return zw.ret;
+	}
+
+	flush_dcache_page(bvec->bv_page);
+
 	return 0;
 }
 
+static long zram_alloc_block(struct zram *zram)
+{
+	unsigned long blk;
+
+	down_write(&zram->wb_sem);
+	blk = find_first_zero_bit(zram->wb_map, zram->nr_wb_blocks);
+	if (blk < zram->nr_wb_blocks)
+		set_bit(blk, zram->wb_map);
+	up_write(&zram->wb_sem);
+
+	return blk < zram->nr_wb_blocks ? blk : -ENOSPC;
+}
+
+/* Should this slot be written back? Called with table_lock held */
+static int zram_wb_candidate(struct zram *zram, u32 index, int huge)
+{
+	if (!zram->table[index].page ||
+	    zram_test_flag(zram, index, ZRAM_ZERO) ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_WB) ||
+	    zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		return 0;
+
+	if (huge)
+		return zram_test_flag(zram, index, ZRAM_UNCOMPRESSED);
+
+	return test_bit(index, zram->idle_map);
+}
+
+/**
+ * zram_writeback - Move pages out to the backing device
+ * @zram: device to write back from
+ * @huge: write back incompressible pages if set, idle ones otherwise
+ *
+ * Called with init_lock held for reading. A slot that is written or freed
+ * while its page is on the way out loses its ZRAM_UNDER_WB flag, and the
+ * copy on the backing device is dropped again.
+ */
+int zram_writeback(struct zram *zram, int huge)
+{
+	struct bio_vec bvec;
+	struct page *page;
+	size_t index, nr_pages = zram->disksize >> PAGE_SHIFT;
+	long blk;
+	int ret = 0;
+
+	if (!zram->bdev)
+		return -ENODEV;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	bvec.bv_page = page;
+	bvec.bv_len = PAGE_SIZE;
+	bvec.bv_offset = 0;
+
+	for (index = 0; index < nr_pages; index++) {
+		write_lock(&zram->table_lock);
+		if (!zram_wb_candidate(zram, index, huge)) {
+			write_unlock(&zram->table_lock);
+			continue;
+		}
+		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		write_unlock(&zram->table_lock);
+
+		read_lock(&zram->table_lock);
+		/* Rewritten meanwhile, possibly to a page we can't read here */
+		if (!zram_test_flag(zram, index, ZRAM_UNDER_WB)) {
+			read_unlock(&zram->table_lock);
+			continue;
+		}
+		ret = zram_bvec_read(zram, &bvec, index, NULL);
+		read_unlock(&zram->table_lock);
+
+		blk = ret ? ret : zram_alloc_block(zram);
+		if (blk >= 0)
+			ret = zram_bdev_rw(zram, page, blk, WRITE);
+		else
+			ret = blk;
+
+		write_lock(&zram->table_lock);
+		if (ret || !zram_test_flag(zram, index, ZRAM_UNDER_WB)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			write_unlock(&zram->table_lock);
+			if (blk >= 0)
+				clear_bit(blk, zram->wb_map);
+			if (ret)
+				break;
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram->table[index].element = blk;
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_stat_inc(&zram->stats.pages_wb);
+		write_unlock(&zram->table_lock);
+
+		cond_resched();
+	}
+
+	__free_page(page);
+
+	return ret;
+}
+
+/* Mark every slot idle, the next access to it clears the mark again */
+void zram_mark_idle(struct zram *zram)
+{
+	size_t index, nr_pages = zram->disksize >> PAGE_SHIFT;
+
+	for (index = 0; index < nr_pages; index++)
+		set_bit(index, zram->idle_map);
+}
+
+static void zram_reset_bdev(struct zram *zram)
+{
+	if (!zram->bdev)
+		return;
+
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	zram->bdev = NULL;
+	vfree(zram->wb_map);
+	zram->wb_map = NULL;
+	zram->nr_wb_blocks = 0;
+}
+
+/* Called with init_lock held for writing, before the device is set up */
+int zram_set_backing_dev(struct zram *zram, const char *path)
+{
+	struct block_device *bdev;
+	unsigned long nr_blocks;
+	unsigned long *wb_map;
+	int ret;
+
+	bdev = blkdev_get_by_path(path, FMODE_READ | FMODE_WRITE | FMODE_EXCL,
+				  zram);
+	if (IS_ERR(bdev))
+		return PTR_ERR(bdev);
+
+	nr_blocks = i_size_read(bdev->bd_inode) >> PAGE_SHIFT;
+	wb_map = vzalloc(BITS_TO_LONGS(nr_blocks) * sizeof(long));
+	if (!nr_blocks || !wb_map) {
+		ret = nr_blocks ? -ENOMEM : -EINVAL;
+		goto fail;
+	}
+
+	ret = set_blocksize(bdev, PAGE_SIZE);
+	if (ret)
+		goto fail;
+
+	zram_reset_bdev(zram);
+	zram->bdev = bdev;
+	zram->wb_map = wb_map;
+	zram->nr_wb_blocks = nr_blocks;
+
+	return 0;
+
+fail:
+	vfree(wb_map);
+	blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	return ret;
+}
+#endif
+
 static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 			struct bio *bio, int rw)
 {
 	int ret;
 
 	if (rw == READ) {
-		down_read(&zram->lock);
+		read_lock(&zram->table_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+		while (zram_test_flag(zram, index, ZRAM_WB)) {
+			read_unlock(&zram->table_lock);
+			ret = zram_read_from_bdev(zram, bvec, index);
+			if (ret != -EAGAIN)
+				goto out;
+			read_lock(&zram->table_lock);
+		}
+#endif
 		ret = zram_bvec_read(zram, bvec, index, bio);
-		up_read(&zram->lock);
+		read_unlock(&zram->table_lock);
 	} else {
-		down_write(&zram->lock);
 		ret = zram_bvec_write(zram, bvec, index);
-		up_write(&zram->lock);
 	}
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+out:
+	clear_bit(index, zram->idle_map);
+#endif
 	return ret;
 }
 
@@ -457,6 +900,46 @@ error:
 	return 0;
 }
 
+static void zram_free_streams(struct zram *zram)
+{
+	int cpu;
+
+	if (!zram->streams)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_stream *zs = per_cpu_ptr(zram->streams, cpu);
+
+		kfree(zs->workmem);
+		free_pages((unsigned long)zs->buffer, 1);
+	}
+
+	free_percpu(zram->streams);
+	zram->streams = NULL;
+}
+
+static int zram_alloc_streams(struct zram *zram)
+{
+	int cpu;
+
+	zram->streams = alloc_percpu(struct zram_stream);
+	if (!zram->streams)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_stream *zs = per_cpu_ptr(zram->streams, cpu);
+
+		mutex_init(&zs->lock);
+		zs->workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+		zs->buffer = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO,
+						      1);
+		if (!zs->workmem || !zs->buffer)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
 void __zram_reset_device(struct zram *zram)
 {
 	size_t index;
@@ -464,35 +947,39 @@ void __zram_reset_device(struct zram *zram)
 	zram->init_done = 0;
 
 	/* Free various per-device buffers */
-	kfree(zram->compress_workmem);
-	free_pages((unsigned long)zram->compress_buffer, 1);
-
-	zram->compress_workmem = NULL;
-	zram->compress_buffer = NULL;
+	zram_free_streams(zram);
 
 	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
 		struct page *page;
-		u16 offset;
 
-		page = zram->table[index].page;
-		offset = zram->table[index].offset;
+		if (zram_test_flag(zram, index, ZRAM_ZERO) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_WB))
+			continue;
 
+		page = zram->table[index].page;
 		if (!page)
 			continue;
 
 		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
 			__free_page(page);
 		else
-			xv_free(zram->mem_pool, page, offset);
+			zram_obj_put(zram, zram->table[index].obj);
 	}
 
 	vfree(zram->table);
 	zram->table = NULL;
 
-	xv_destroy_pool(zram->mem_pool);
+	zs_destroy_pool(zram->mem_pool);
 	zram->mem_pool = NULL;
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+	vfree(zram->idle_map);
+	zram->idle_map = NULL;
+	zram_reset_bdev(zram);
+#endif
+
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
 
@@ -519,18 +1006,11 @@ int zram_init_device(struct zram *zram)
 	}
 
 	zram_set_disksize(zram, totalram_pages << PAGE_SHIFT);
+	zram->obj_tree = RB_ROOT;
 
-	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!zram->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
-		ret = -ENOMEM;
-		goto fail;
-	}
-
-	zram->compress_buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
-	if (!zram->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		ret = -ENOMEM;
+	ret = zram_alloc_streams(zram);
+	if (ret) {
+		pr_err("Error allocating compression streams\n");
 		goto fail;
 	}
 
@@ -544,12 +1024,21 @@ int zram_init_device(struct zram *zram)
 		goto fail;
 	}
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+	zram->idle_map = vzalloc(BITS_TO_LONGS(num_pages) * sizeof(long));
+	if (!zram->idle_map) {
+		pr_err("Error allocating idle page map\n");
+		ret = -ENOMEM;
+		goto fail;
+	}
+#endif
+
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
 
 	/* zram devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
-	zram->mem_pool = xv_create_pool();
+	zram->mem_pool = zs_create_pool();
 	if (!zram->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
@@ -574,7 +1063,9 @@ void zram_slot_free_notify(struct block_device *bdev, unsigned long index)
 	struct zram *zram;
 
 	zram = bdev->bd_disk->private_data;
+	write_lock(&zram->table_lock);
 	zram_free_page(zram, index);
+	write_unlock(&zram->table_lock);
 	zram_stat64_inc(zram, &zram->stats.notify_free);
 }
 
@@ -587,8 +1078,11 @@ static int create_device(struct zram *zram, int device_id)
 {
 	int ret = 0;
 
-	init_rwsem(&zram->lock);
+	rwlock_init(&zram->table_lock);
 	init_rwsem(&zram->init_lock);
+#ifdef CONFIG_ZRAM_WRITEBACK
+	init_rwsem(&zram->wb_sem);
+#endif
 	spin_lock_init(&zram->stat64_lock);
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
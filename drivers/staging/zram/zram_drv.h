@@ -17,8 +17,9 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
 
-#include "xvmalloc.h"
+#include "zsmalloc.h"
 
 /*
  * Some arbitrary value. This is just to catch
@@ -51,8 +52,8 @@ static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*
  * NOTE: max_zpage_size must be less than or equal to:
- *   XV_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
- * otherwise, xv_malloc() would always return failure.
+ *   ZS_MAX_ALLOC_SIZE - ZS_HANDLE_SIZE - sizeof(struct zobj_header)
+ * otherwise, zs_malloc() would always return failure.
  */
 
 /*-- End of configurable params */
@@ -71,14 +72,36 @@ enum zram_pageflags {
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO,
 
+	/* Page is filled with one repeating word, kept in table.element */
+	ZRAM_SAME,
+
+	/* Page lives on the backing device, table.element is its block */
+	ZRAM_WB,
+
+	/* Page is being written back, cleared if the slot changes meanwhile */
+	ZRAM_UNDER_WB,
+
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 /*-- Data structures */
 
+/* A compressed object, shared by every disk page with the same contents */
+struct zram_obj {
+	struct rb_node node;	/* in zram->obj_tree, sorted by checksum */
+	unsigned long handle;	/* zsmalloc handle */
+	u16 clen;		/* compressed size, without the header */
+	u32 checksum;		/* jhash of the compressed data */
+	u32 refcount;		/* no. of table entries using it */
+};
+
 /* Allocated for each disk page */
 struct table {
-	struct page *page;
+	union {
+		struct page *page;	/* ZRAM_UNCOMPRESSED */
+		struct zram_obj *obj;	/* compressed */
+		unsigned long element;	/* ZRAM_SAME, ZRAM_WB */
+	};
 	u16 offset;
 	u8 count;	/* object ref count (not yet used) */
 	u8 flags;
@@ -93,19 +116,28 @@ struct zram_stats {
 	u64 invalid_io;		/* non-page-aligned I/O requests */
 	u64 notify_free;	/* no. of swap slot free notifications */
 	u32 pages_zero;		/* no. of zero filled pages */
+	u32 pages_same;		/* no. of pages filled with a repeating word */
+	u32 pages_dup;		/* no. of pages sharing another's object */
 	u32 pages_stored;	/* no. of pages currently stored */
+	u32 pages_wb;		/* no. of pages on the backing device */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
 };
 
+/* Per-CPU compression state, so writes on different CPUs don't serialize */
+struct zram_stream {
+	void *workmem;
+	void *buffer;
+	struct mutex lock;	/* a task may sleep or migrate while using it */
+};
+
 struct zram {
-	struct xv_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	struct zs_pool *mem_pool;
+	struct zram_stream __percpu *streams;
 	struct table *table;
+	struct rb_root obj_tree;	/* compressed objects, for dedup */
 	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct rw_semaphore lock;	/* protect compression buffers against
-					 * concurrent writes */
+	rwlock_t table_lock;	/* protect table, obj_tree and 32-bit stats */
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -118,6 +150,13 @@ struct zram {
 	u64 disksize;	/* bytes */
 
 	struct zram_stats stats;
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct block_device *bdev;	/* backing device, set before init */
+	unsigned long *wb_map;		/* blocks in use on bdev */
+	unsigned long nr_wb_blocks;
+	struct rw_semaphore wb_sem;	/* protect wb_map against block reuse */
+	unsigned long *idle_map;	/* slots not accessed since marked idle */
+#endif
 };
 
 extern struct zram *devices;
@@ -128,5 +167,10 @@ extern struct attribute_group zram_disk_attr_group;
 
 extern int zram_init_device(struct zram *zram);
 extern void __zram_reset_device(struct zram *zram);
+#ifdef CONFIG_ZRAM_WRITEBACK
+extern int zram_set_backing_dev(struct zram *zram, const char *path);
+extern int zram_writeback(struct zram *zram, int huge);
+extern void zram_mark_idle(struct zram *zram);
+#endif
 
 #endif
@@ -0,0 +1,604 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+/*
+ * Objects are handed out from size classes ZS_SIZE_CLASS_DELTA bytes
+ * apart. Each class carves its objects out of zspages, small groups of
+ * order-0 pages sized so that little space is left over at the end. The
+ * caller only ever sees a handle, which points to a small descriptor
+ * holding the object's current location. That indirection lets
+ * zs_compact() move objects out of sparsely used zspages into fuller
+ * ones of the same class and give the emptied pages back, so the pool
+ * does not keep growing from fragmentation over long uptimes.
+ */
+
+#ifdef CONFIG_ZRAM_DEBUG
+#define DEBUG
+#endif
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+static struct kmem_cache *zs_handle_cachep;
+static DEFINE_PER_CPU(struct zs_map_area, zs_map_area);
+static DEFINE_MUTEX(zs_init_lock);
+static unsigned int zs_nr_pools;
+
+static unsigned int get_size_class_index(unsigned int size)
+{
+	if (size <= ZS_MIN_ALLOC_SIZE)
+		return 0;
+
+	return DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE, ZS_SIZE_CLASS_DELTA);
+}
+
+/* Pick the zspage size that wastes the smallest share of its pages */
+static unsigned int get_pages_per_zspage(unsigned int size)
+{
+	unsigned int i, best = 1, best_used = 0;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		unsigned int bytes = i * PAGE_SIZE;
+		unsigned int used = (bytes / size) * size * 100 / bytes;
+
+		if (used > best_used) {
+			best_used = used;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static unsigned long obj_offset(struct size_class *class, u16 idx)
+{
+	return (unsigned long)idx * class->size;
+}
+
+static unsigned long *obj_head_map(struct size_class *class,
+				struct zspage *zspage, u16 idx)
+{
+	unsigned long off = obj_offset(class, idx);
+
+	return kmap_atomic(zspage->pages[off >> PAGE_SHIFT], KM_USER0) +
+		(off & ~PAGE_MASK);
+}
+
+static void obj_head_unmap(unsigned long *head)
+{
+	kunmap_atomic(head, KM_USER0);
+}
+
+/* Copy a whole object, handle word included, to or from @buf */
+static void obj_copy(struct size_class *class, struct zspage *zspage,
+			u16 idx, char *buf, int to_obj)
+{
+	unsigned long off = obj_offset(class, idx);
+	unsigned int done = 0;
+
+	while (done < class->size) {
+		unsigned long pos = off + done;
+		unsigned int poff = pos & ~PAGE_MASK;
+		unsigned int len = min_t(unsigned int, class->size - done,
+					PAGE_SIZE - poff);
+		char *addr;
+
+		addr = kmap_atomic(zspage->pages[pos >> PAGE_SHIFT], KM_USER1);
+		if (to_obj)
+			memcpy(addr + poff, buf + done, len);
+		else
+			memcpy(buf + done, addr + poff, len);
+		kunmap_atomic(addr, KM_USER1);
+
+		done += len;
+	}
+}
+
+static void free_zspage(struct size_class *class, struct zspage *zspage)
+{
+	unsigned int i;
+
+	for (i = 0; i < class->pages_per_zspage; i++)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+}
+
+static struct zspage *alloc_zspage(struct size_class *class, gfp_t flags)
+{
+	struct zspage *zspage;
+	unsigned long *head;
+	unsigned int i;
+
+	zspage = kzalloc(sizeof(*zspage), flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		zspage->pages[i] = alloc_page(flags);
+		if (!zspage->pages[i]) {
+			while (i--)
+				__free_page(zspage->pages[i]);
+			kfree(zspage);
+			return NULL;
+		}
+	}
+
+	/* Chain all objects on the free list */
+	for (i = 0; i < class->objs_per_zspage; i++) {
+		head = obj_head_map(class, zspage, i);
+		if (i + 1 < class->objs_per_zspage)
+			*head = (unsigned long)(i + 1) << 1;
+		else
+			*head = (unsigned long)ZS_OBJ_END << 1;
+		obj_head_unmap(head);
+	}
+
+	INIT_LIST_HEAD(&zspage->list);
+	zspage->freelist = 0;
+
+	return zspage;
+}
+
+/* Called with class->lock held, @zspage must have a free object */
+static void obj_alloc(struct size_class *class, struct zspage *zspage,
+			struct zs_handle *zh)
+{
+	unsigned long *head;
+	u16 idx = zspage->freelist;
+
+	head = obj_head_map(class, zspage, idx);
+	zspage->freelist = *head >> 1;
+	*head = (unsigned long)zh | ZS_OBJ_ALLOCATED;
+	obj_head_unmap(head);
+
+	zh->zspage = zspage;
+	zh->idx = idx;
+
+	zspage->inuse++;
+	class->objs_inuse++;
+	if (zspage->inuse == class->objs_per_zspage)
+		list_move(&zspage->list, &class->full);
+}
+
+/* Called with class->lock held, returns the zspage if it became empty */
+static struct zspage *obj_free(struct size_class *class,
+				struct zspage *zspage, u16 idx)
+{
+	unsigned long *head;
+
+	head = obj_head_map(class, zspage, idx);
+	*head = (unsigned long)zspage->freelist << 1;
+	obj_head_unmap(head);
+	zspage->freelist = idx;
+
+	if (zspage->inuse == class->objs_per_zspage)
+		list_move(&zspage->list, &class->partial);
+	zspage->inuse--;
+	class->objs_inuse--;
+
+	if (zspage->inuse)
+		return NULL;
+
+	list_del(&zspage->list);
+	class->nr_zspages--;
+
+	return zspage;
+}
+
+/**
+ * zs_malloc - Allocate an object from the pool
+ * @pool: pool to allocate from
+ * @size: size of the object, at most ZS_MAX_ALLOC_SIZE - ZS_HANDLE_SIZE
+ * @flags: flags for the backing pages, may include __GFP_HIGHMEM
+ *
+ * Returns a handle to the new object, or 0 on failure. Use
+ * zs_map_object() to get at its contents.
+ */
+unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t flags)
+{
+	struct size_class *class;
+	struct zspage *zspage;
+	struct zs_handle *zh;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE - ZS_HANDLE_SIZE))
+		return 0;
+
+	class = &pool->classes[get_size_class_index(size + ZS_HANDLE_SIZE)];
+
+	zh = kmem_cache_alloc(zs_handle_cachep, flags & ~__GFP_HIGHMEM);
+	if (!zh)
+		return 0;
+	zh->class_idx = class->index;
+
+	spin_lock(&class->lock);
+	if (list_empty(&class->partial)) {
+		spin_unlock(&class->lock);
+
+		zspage = alloc_zspage(class, flags);
+		if (!zspage) {
+			kmem_cache_free(zs_handle_cachep, zh);
+			return 0;
+		}
+
+		spin_lock(&class->lock);
+		list_add(&zspage->list, &class->partial);
+		class->nr_zspages++;
+	}
+
+	zspage = list_first_entry(&class->partial, struct zspage, list);
+	obj_alloc(class, zspage, zh);
+	spin_unlock(&class->lock);
+
+	return (unsigned long)zh;
+}
+EXPORT_SYMBOL_GPL(zs_malloc);
+
+void zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	struct zs_handle *zh = (struct zs_handle *)handle;
+	struct size_class *class = &pool->classes[zh->class_idx];
+	struct zspage *empty;
+
+	spin_lock(&class->lock);
+	empty = obj_free(class, zh->zspage, zh->idx);
+	spin_unlock(&class->lock);
+
+	if (empty)
+		free_zspage(class, empty);
+	kmem_cache_free(zs_handle_cachep, zh);
+}
+EXPORT_SYMBOL_GPL(zs_free);
+
+/**
+ * zs_map_object - Get a pointer to an object's contents
+ * @pool: pool the object belongs to
+ * @handle: handle returned by zs_malloc()
+ * @mm: how the mapping is going to be used
+ *
+ * The object can't move until zs_unmap_object() is called, and the caller
+ * must not sleep in between. Objects straddling two pages are copied to a
+ * per-CPU buffer, and copied back on unmap unless mapped ZS_MM_RO.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long handle,
+			enum zs_mapmode mm)
+{
+	struct zs_handle *zh = (struct zs_handle *)handle;
+	struct size_class *class = &pool->classes[zh->class_idx];
+	struct zs_map_area *area;
+	unsigned long off;
+
+	spin_lock(&class->lock);
+
+	area = &__get_cpu_var(zs_map_area);
+	area->mm = mm;
+
+	off = obj_offset(class, zh->idx);
+	if ((off & ~PAGE_MASK) + class->size <= PAGE_SIZE) {
+		area->vaddr = kmap_atomic(zh->zspage->pages[off >> PAGE_SHIFT],
+					KM_USER1) + (off & ~PAGE_MASK);
+		return area->vaddr + ZS_HANDLE_SIZE;
+	}
+
+	/*
+	 * The handle word shares the buffer and is written back on unmap,
+	 * so even a write-only mapping has to read the object in.
+	 */
+	area->vaddr = NULL;
+	obj_copy(class, zh->zspage, zh->idx, area->buf, 0);
+
+	return area->buf + ZS_HANDLE_SIZE;
+}
+EXPORT_SYMBOL_GPL(zs_map_object);
+
+void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
+{
+	struct zs_handle *zh = (struct zs_handle *)handle;
+	struct size_class *class = &pool->classes[zh->class_idx];
+	struct zs_map_area *area;
+
+	area = &__get_cpu_var(zs_map_area);
+	if (area->vaddr)
+		kunmap_atomic(area->vaddr, KM_USER1);
+	else if (area->mm != ZS_MM_RO)
+		obj_copy(class, zh->zspage, zh->idx, area->buf, 1);
+
+	spin_unlock(&class->lock);
+}
+EXPORT_SYMBOL_GPL(zs_unmap_object);
+
+/*
+ * The partial zspage with the fewest objects is worth emptying if the
+ * other partial zspages have room for all of them.
+ */
+static struct zspage *find_compact_source(struct size_class *class)
+{
+	struct zspage *zspage, *src = NULL;
+	unsigned long nr_free = 0;
+
+	list_for_each_entry(zspage, &class->partial, list) {
+		nr_free += class->objs_per_zspage - zspage->inuse;
+		if (!src || zspage->inuse < src->inuse)
+			src = zspage;
+	}
+
+	if (!src || nr_free - (class->objs_per_zspage - src->inuse) <
+			src->inuse)
+		return NULL;
+
+	return src;
+}
+
+/* Fill up the fullest zspages first, so they drop off the partial list */
+static struct zspage *find_compact_dest(struct size_class *class,
+					struct zspage *src)
+{
+	struct zspage *zspage, *dst = NULL;
+
+	list_for_each_entry(zspage, &class->partial, list) {
+		if (zspage != src && (!dst || zspage->inuse > dst->inuse))
+			dst = zspage;
+	}
+
+	return dst;
+}
+
+static unsigned long compact_class(struct size_class *class)
+{
+	struct zs_map_area *area;
+	struct zspage *src, *dst;
+	struct zs_handle *zh;
+	unsigned long *head, val;
+	unsigned long freed = 0;
+	u16 idx;
+
+	spin_lock(&class->lock);
+	while ((src = find_compact_source(class)) != NULL) {
+		area = &__get_cpu_var(zs_map_area);
+		dst = NULL;
+
+		for (idx = 0; src->inuse; idx++) {
+			head = obj_head_map(class, src, idx);
+			val = *head;
+			obj_head_unmap(head);
+			if (!(val & ZS_OBJ_ALLOCATED))
+				continue;
+
+			if (!dst || dst->inuse == class->objs_per_zspage)
+				dst = find_compact_dest(class, src);
+
+			/* Move the object, then point its handle at it */
+			zh = (struct zs_handle *)(val & ~ZS_OBJ_ALLOCATED);
+			obj_copy(class, src, idx, area->buf, 0);
+			obj_alloc(class, dst, zh);
+			obj_copy(class, dst, zh->idx, area->buf, 1);
+
+			if (obj_free(class, src, idx))
+				break;
+		}
+
+		spin_unlock(&class->lock);
+		free_zspage(class, src);
+		freed += class->pages_per_zspage;
+		cond_resched();
+		spin_lock(&class->lock);
+	}
+	spin_unlock(&class->lock);
+
+	return freed;
+}
+
+/**
+ * zs_compact - Migrate objects to release sparsely used zspages
+ * @pool: pool to compact
+ *
+ * Returns the number of pages given back to the system.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	unsigned long freed = 0;
+	int i;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++)
+		freed += compact_class(&pool->classes[i]);
+
+	return freed;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+/* Pages compaction could give back, from the free objects of each class */
+static unsigned long zs_compactable_pages(struct zs_pool *pool)
+{
+	unsigned long pages = 0;
+	int i;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+		unsigned long nr_free;
+
+		nr_free = class->nr_zspages * class->objs_per_zspage -
+			class->objs_inuse;
+		pages += nr_free / class->objs_per_zspage *
+			class->pages_per_zspage;
+	}
+
+	return pages;
+}
+
+/* Compaction needs no memory, so it's safe to do it from reclaim */
+static int zs_shrink(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
+					shrinker);
+
+	if (sc->nr_to_scan)
+		zs_compact(pool);
+
+	return min_t(unsigned long, zs_compactable_pages(pool), INT_MAX);
+}
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	u64 pages = 0;
+	int i;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		pages += (u64)class->nr_zspages * class->pages_per_zspage;
+	}
+
+	return pages << PAGE_SHIFT;
+}
+EXPORT_SYMBOL_GPL(zs_get_total_size_bytes);
+
+u64 zs_get_used_size_bytes(struct zs_pool *pool)
+{
+	u64 bytes = 0;
+	int i;
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		bytes += (u64)class->objs_inuse * class->size;
+	}
+
+	return bytes;
+}
+EXPORT_SYMBOL_GPL(zs_get_used_size_bytes);
+
+static void zs_put_globals(void)
+{
+	int cpu;
+
+	if (--zs_nr_pools)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zs_map_area *area = &per_cpu(zs_map_area, cpu);
+
+		free_page((unsigned long)area->buf);
+		area->buf = NULL;
+	}
+
+	kmem_cache_destroy(zs_handle_cachep);
+	zs_handle_cachep = NULL;
+}
+
+static int zs_get_globals(void)
+{
+	int cpu;
+
+	if (zs_nr_pools++)
+		return 0;
+
+	zs_handle_cachep = kmem_cache_create("zs_handle",
+				sizeof(struct zs_handle), 0, 0, NULL);
+	if (!zs_handle_cachep)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		struct zs_map_area *area = &per_cpu(zs_map_area, cpu);
+
+		area->buf = (char *)__get_free_page(GFP_KERNEL);
+		if (!area->buf)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	zs_put_globals();
+	return -ENOMEM;
+}
+
+/*
+ * Create a memory pool. Sets up the size classes, the memory for the
+ * objects is only allocated as they are.
+ */
+struct zs_pool *zs_create_pool(void)
+{
+	struct zs_pool *pool;
+	int i, ret;
+
+	mutex_lock(&zs_init_lock);
+	ret = zs_get_globals();
+	mutex_unlock(&zs_init_lock);
+	if (ret)
+		return NULL;
+
+	pool = vzalloc(sizeof(*pool));
+	if (!pool) {
+		mutex_lock(&zs_init_lock);
+		zs_put_globals();
+		mutex_unlock(&zs_init_lock);
+		return NULL;
+	}
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		spin_lock_init(&class->lock);
+		INIT_LIST_HEAD(&class->partial);
+		INIT_LIST_HEAD(&class->full);
+		class->index = i;
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+					class->size;
+	}
+
+	pool->shrinker.shrink = zs_shrink;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&pool->shrinker);
+
+	return pool;
+}
+EXPORT_SYMBOL_GPL(zs_create_pool);
+
+/* All objects must have been freed already */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	struct zspage *zspage, *tmp;
+	int i;
+
+	unregister_shrinker(&pool->shrinker);
+
+	for (i = 0; i < ZS_NR_CLASSES; i++) {
+		struct size_class *class = &pool->classes[i];
+
+		if (class->objs_inuse)
+			pr_warning("zsmalloc: %lu objects of size %u leaked\n",
+				class->objs_inuse, class->size);
+
+		list_for_each_entry_safe(zspage, tmp, &class->partial, list)
+			free_zspage(class, zspage);
+		list_for_each_entry_safe(zspage, tmp, &class->full, list)
+			free_zspage(class, zspage);
+	}
+
+	vfree(pool);
+
+	mutex_lock(&zs_init_lock);
+	zs_put_globals();
+	mutex_unlock(&zs_init_lock);
+}
+EXPORT_SYMBOL_GPL(zs_destroy_pool);
@@ -0,0 +1,91 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/mm.h>
+
+/* User configurable params */
+
+/*
+ * Every object starts with a word holding its handle, so the compaction
+ * code can find the handle to update when it moves the object.
+ */
+#define ZS_HANDLE_SIZE		sizeof(unsigned long)
+
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+
+/*
+ * Size classes are ZS_SIZE_CLASS_DELTA bytes apart. Objects are always
+ * a multiple of it, so the handle word never straddles a page.
+ */
+#define ZS_SIZE_CLASS_DELTA	16
+#define ZS_NR_CLASSES		((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) \
+					/ ZS_SIZE_CLASS_DELTA + 1)
+
+/*
+ * A zspage is a group of order-0 pages objects of one class are carved
+ * from. Objects may straddle two of its pages, so sizes that don't divide
+ * PAGE_SIZE don't waste the tail of every page.
+ */
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+/* End of user params */
+
+/* Set in the head word of allocated objects, free ones hold an index */
+#define ZS_OBJ_ALLOCATED	1UL
+#define ZS_OBJ_END		((u16)~0)
+
+struct zspage {
+	struct list_head list;		/* in class partial or full list */
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	u16 inuse;			/* no. of allocated objects */
+	u16 freelist;			/* index of first free object */
+};
+
+struct zs_handle {
+	struct zspage *zspage;
+	u16 idx;			/* object index within zspage */
+	u16 class_idx;
+};
+
+struct size_class {
+	spinlock_t lock;		/* protects everything below */
+	unsigned int index;
+	unsigned int size;		/* object size, including handle */
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+
+	struct list_head partial;	/* zspages with free objects */
+	struct list_head full;
+
+	unsigned long nr_zspages;
+	unsigned long objs_inuse;
+};
+
+/* Bounce buffer for mapping objects that straddle two pages */
+struct zs_map_area {
+	char *buf;
+	void *vaddr;			/* set if the object was kmapped */
+	enum zs_mapmode mm;
+};
+
+struct zs_pool {
+	struct size_class classes[ZS_NR_CLASSES];
+	struct shrinker shrinker;
+};
+
+#endif
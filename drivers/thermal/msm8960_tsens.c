@@ -21,6 +21,7 @@
 #include <linux/interrupt.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/msm_tsens.h>
 #include <linux/io.h>
 
@@ -134,6 +135,11 @@ struct tsens_tm_device {
 
 struct tsens_tm_device *tmdev;
 
+/* In-kernel client armed with tsens_set_threshold_notify() */
+static DEFINE_SPINLOCK(tsens_notify_lock);
+static void (*tsens_notify)(void *data);
+static void *tsens_notify_data;
+
 /* Temperature on y axis and ADC-code on x-axis */
 static int tsens_tz_code_to_degC(int adc_code, int sensor_num)
 {
@@ -207,6 +213,46 @@ int tsens_get_temp(struct tsens_device *device, unsigned long *temp)
 }
 EXPORT_SYMBOL(tsens_get_temp);
 
+int tsens_set_threshold_notify(struct tsens_device *device, long degC,
+			       void (*notify)(void *data), void *data)
+{
+	unsigned int reg_th, reg_cntl;
+	unsigned long flags;
+	int code;
+
+	if (!tmdev)
+		return -ENODEV;
+
+	if (device->sensor_num >= tmdev->tsens_num_sensor)
+		return -EINVAL;
+
+	spin_lock_irqsave(&tsens_notify_lock, flags);
+	tsens_notify = notify;
+	tsens_notify_data = data;
+
+	reg_cntl = readl_relaxed(TSENS_CNTL_ADDR);
+	if (!notify) {
+		writel_relaxed(reg_cntl | TSENS_UPPER_STATUS_CLR,
+				TSENS_CNTL_ADDR);
+		goto out;
+	}
+
+	code = tsens_tz_degC_to_code(degC, device->sensor_num);
+	reg_th = readl_relaxed(TSENS_THRESHOLD_ADDR);
+	reg_th &= ~TSENS_THRESHOLD_UPPER_LIMIT_MASK;
+	writel_relaxed(reg_th | (code << TSENS_THRESHOLD_UPPER_LIMIT_SHIFT),
+			TSENS_THRESHOLD_ADDR);
+
+	/* Unmask the upper interrupt, the ISR masks it again on a crossing */
+	writel_relaxed(reg_cntl & ~TSENS_UPPER_STATUS_CLR, TSENS_CNTL_ADDR);
+out:
+	mb();
+	spin_unlock_irqrestore(&tsens_notify_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(tsens_set_threshold_notify);
+
 static int tsens_tz_get_mode(struct thermal_zone_device *thermal,
 			      enum thermal_device_mode *mode)
 {
@@ -553,7 +599,7 @@ static irqreturn_t tsens_isr(int irq, void *data)
 {
 	struct tsens_tm_device *tm = data;
 	unsigned int threshold, threshold_low, i, code, reg, sensor, mask;
-	bool upper_th_x, lower_th_x;
+	bool upper_th_x, lower_th_x, tripped = false;
 	int adc_code;
 
 	reg = readl_relaxed(TSENS_CNTL_ADDR);
@@ -578,6 +624,8 @@ static irqreturn_t tsens_isr(int irq, void *data)
 				mask |= TSENS_UPPER_STATUS_CLR;
 			if (lower_th_x)
 				mask |= TSENS_LOWER_STATUS_CLR;
+			if (upper_th_x)
+				tripped = true;
 			if (upper_th_x || lower_th_x) {
 				/* Notify user space */
 				schedule_work(&tm->sensor[i].work);
@@ -593,6 +641,12 @@ static irqreturn_t tsens_isr(int irq, void *data)
 	}
 	writel_relaxed(reg & mask, TSENS_CNTL_ADDR);
 	mb();
+
+	spin_lock(&tsens_notify_lock);
+	if (tripped && tsens_notify)
+		tsens_notify(tsens_notify_data);
+	spin_unlock(&tsens_notify_lock);
+
 	return IRQ_HANDLED;
 }
 
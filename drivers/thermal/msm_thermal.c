@@ -19,42 +19,198 @@
 #include <linux/msm_tsens.h>
 #include <linux/workqueue.h>
 #include <linux/cpu.h>
+#include <linux/rq_stats.h>
 
 #define DEF_TEMP_SENSOR      0
 #define DEF_THERMAL_CHECK_MS 1000
 #define DEF_ALLOWED_MAX_HIGH 60
 #define DEF_ALLOWED_MAX_FREQ 918000
 
+/* Controller gains, in kHz of cap per degree C */
+#define DEF_PID_KP           50000
+#define DEF_PID_KI           10000
+#define DEF_PID_KD           20000
+#define PID_INTEGRAL_MAX     50
+
 static int enabled;
 static int allowed_max_high = DEF_ALLOWED_MAX_HIGH;
 static int allowed_max_low = (DEF_ALLOWED_MAX_HIGH - 10);
 static int allowed_max_freq = DEF_ALLOWED_MAX_FREQ;
 static int check_interval_ms = DEF_THERMAL_CHECK_MS;
+static int pid_kp = DEF_PID_KP;
+static int pid_ki = DEF_PID_KI;
+static int pid_kd = DEF_PID_KD;
+static int core_control = 1;
 
 module_param(allowed_max_high, int, 0);
 module_param(allowed_max_freq, int, 0);
 module_param(check_interval_ms, int, 0);
+module_param(pid_kp, int, 0644);
+module_param(pid_ki, int, 0644);
+module_param(pid_kd, int, 0644);
+module_param(core_control, int, 0644);
 
-static struct delayed_work check_temp_work;
+static void check_temp(struct work_struct *work);
+static DECLARE_DELAYED_WORK(check_temp_work, check_temp);
+static DEFINE_MUTEX(msm_thermal_mutex);
 
-static int update_cpu_max_freq(struct cpufreq_policy *cpu_policy,
-			       int cpu, int max_freq)
+/*
+ * Mitigation starts when the sensor reaches allowed_max_high, signalled by
+ * the TSENS upper threshold interrupt (or polling every check_interval_ms
+ * if that isn't available). While mitigating, a PID controller running
+ * every check_interval_ms moves the frequency cap of all cores between
+ * cpuinfo.max_freq and allowed_max_freq so that the temperature settles
+ * at allowed_max_high, instead of jumping between the two. If the run
+ * queue shows that a core is not needed, that core is taken offline
+ * before the cap is lowered. Mitigation ends once the cap is lifted, all
+ * cores are back and the temperature is below allowed_max_low.
+ *
+ * The work always runs on CPU0 so it can take any other core offline.
+ */
+static bool mitigating;
+static bool use_irq = true;
+static int pid_integral;
+static int pid_prev_err;
+static unsigned int cpu_max_freq;
+static unsigned int limited_max_freq = UINT_MAX;
+static struct cpumask thermal_offlined;
+
+static int msm_thermal_cpufreq_callback(struct notifier_block *nfb,
+					unsigned long event, void *data)
 {
-	int ret = 0;
+	struct cpufreq_policy *policy = data;
 
-	if (!cpu_policy)
-		return -EINVAL;
+	if (event == CPUFREQ_INCOMPATIBLE)
+		cpufreq_verify_within_limits(policy, 0, limited_max_freq);
 
-	cpufreq_verify_within_limits(cpu_policy,
-				cpu_policy->min, max_freq);
-	cpu_policy->user_policy.max = max_freq;
+	return NOTIFY_OK;
+}
 
-	ret = cpufreq_update_policy(cpu);
-	if (!ret)
-		pr_info("msm_thermal: Limiting core%d max frequency to %d\n",
-			cpu, max_freq);
+static struct notifier_block msm_thermal_cpufreq_notifier = {
+	.notifier_call = msm_thermal_cpufreq_callback,
+};
 
-	return ret;
+/* Don't let anyone else bring back a core taken offline for mitigation */
+static int __cpuinit msm_thermal_cpu_callback(struct notifier_block *nfb,
+					      unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+
+	if ((action == CPU_UP_PREPARE || action == CPU_UP_PREPARE_FROZEN) &&
+	    cpumask_test_cpu(cpu, &thermal_offlined))
+		return NOTIFY_BAD;
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __refdata msm_thermal_cpu_notifier = {
+	.notifier_call = msm_thermal_cpu_callback,
+};
+
+static void update_cpu_max_freq(unsigned int max_freq)
+{
+	int cpu;
+
+	if (max_freq == limited_max_freq)
+		return;
+
+	limited_max_freq = max_freq;
+	if (max_freq != UINT_MAX)
+		pr_info("msm_thermal: Limiting max frequency to %u\n",
+			max_freq);
+	else
+		pr_info("msm_thermal: Max frequency reset\n");
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		cpufreq_update_policy(cpu);
+	put_online_cpus();
+}
+
+/* Take the highest core offline if the run queue doesn't need it */
+static bool msm_thermal_offline_core(void)
+{
+	unsigned int online = num_online_cpus();
+	unsigned int avg, cpu, last = 0;
+
+	if (!core_control || online <= 1 || rq_stats_get_ewma(&avg))
+		return false;
+
+	/* avg is in tenths of a runnable task */
+	if (avg >= (online - 1) * 10)
+		return false;
+
+	for_each_online_cpu(cpu)
+		last = cpu;
+	if (!last)
+		return false;
+
+	cpumask_set_cpu(last, &thermal_offlined);
+	if (cpu_down(last)) {
+		cpumask_clear_cpu(last, &thermal_offlined);
+		return false;
+	}
+
+	pr_info("msm_thermal: Offlined core%d\n", last);
+	return true;
+}
+
+static bool msm_thermal_online_core(void)
+{
+	unsigned int cpu = cpumask_first(&thermal_offlined);
+
+	if (cpu >= nr_cpu_ids)
+		return false;
+
+	cpumask_clear_cpu(cpu, &thermal_offlined);
+	if (cpu_up(cpu))
+		pr_err("msm_thermal: Unable to online core%d\n", cpu);
+	else
+		pr_info("msm_thermal: Onlined core%d\n", cpu);
+
+	return true;
+}
+
+static void msm_thermal_pid(unsigned long temp)
+{
+	unsigned int max_freq = limited_max_freq;
+	int err = (int)temp - allowed_max_high;
+	int cut;
+
+	pid_integral = clamp(pid_integral + err, 0, PID_INTEGRAL_MAX);
+	cut = pid_kp * err + pid_ki * pid_integral +
+		pid_kd * (err - pid_prev_err);
+	pid_prev_err = err;
+
+	if (cut > 0)
+		max_freq = max_t(int, cpu_max_freq - cut, allowed_max_freq);
+	else
+		max_freq = UINT_MAX;
+
+	if (max_freq < limited_max_freq) {
+		/* Shed a core first, the next sample decides on the cap */
+		if (err > 0 && msm_thermal_offline_core())
+			return;
+		update_cpu_max_freq(max_freq);
+		return;
+	}
+
+	update_cpu_max_freq(max_freq);
+	if (max_freq != UINT_MAX || temp >= allowed_max_low)
+		return;
+
+	/* Bring cores back one per sample, then stop mitigating */
+	if (msm_thermal_online_core())
+		return;
+
+	mitigating = false;
+	pid_integral = 0;
+	pid_prev_err = 0;
+}
+
+static void msm_thermal_notify(void *data)
+{
+	schedule_delayed_work_on(0, &check_temp_work, 0);
 }
 
 static void check_temp(struct work_struct *work)
@@ -62,11 +218,22 @@ static void check_temp(struct work_struct *work)
 	struct cpufreq_policy *cpu_policy = NULL;
 	struct tsens_device tsens_dev;
 	unsigned long temp = 0;
-	unsigned int max_freq = 0;
-	int update_policy = 0;
-	int cpu = 0;
 	int ret = 0;
 
+	mutex_lock(&msm_thermal_mutex);
+	if (!enabled)
+		goto out;
+
+	if (!cpu_max_freq) {
+		cpu_policy = cpufreq_cpu_get(0);
+		if (!cpu_policy) {
+			pr_debug("msm_thermal: NULL policy on cpu 0\n");
+			goto reschedule;
+		}
+		cpu_max_freq = cpu_policy->cpuinfo.max_freq;
+		cpufreq_cpu_put(cpu_policy);
+	}
+
 	tsens_dev.sensor_num = DEF_TEMP_SENSOR;
 	ret = tsens_get_temp(&tsens_dev, &temp);
 	if (ret) {
@@ -75,58 +242,46 @@ static void check_temp(struct work_struct *work)
 		goto reschedule;
 	}
 
-	for_each_possible_cpu(cpu) {
-		update_policy = 0;
-		cpu_policy = cpufreq_cpu_get(cpu);
-		if (!cpu_policy) {
-			pr_debug("msm_thermal: NULL policy on cpu %d\n", cpu);
-			continue;
-		}
-		if (temp >= allowed_max_high) {
-			if (cpu_policy->max > allowed_max_freq) {
-				update_policy = 1;
-				max_freq = allowed_max_freq;
-			} else {
-				pr_debug("msm_thermal: policy max for cpu %d "
-					 "already < allowed_max_freq\n", cpu);
-			}
-		} else if (temp < allowed_max_low) {
-			if (cpu_policy->max < cpu_policy->cpuinfo.max_freq) {
-				max_freq = cpu_policy->cpuinfo.max_freq;
-				update_policy = 1;
-			} else {
-				pr_debug("msm_thermal: policy max for cpu %d "
-					 "already at max allowed\n", cpu);
-			}
-		}
+	if (!mitigating && temp >= allowed_max_high)
+		mitigating = true;
 
-		if (update_policy)
-			update_cpu_max_freq(cpu_policy, cpu, max_freq);
+	if (mitigating)
+		msm_thermal_pid(temp);
 
-		cpufreq_cpu_put(cpu_policy);
+	if (!mitigating && use_irq) {
+		ret = tsens_set_threshold_notify(&tsens_dev, allowed_max_high,
+						msm_thermal_notify, NULL);
+		if (!ret)
+			goto out;
+		pr_info("msm_thermal: TSENS interrupt unavailable, polling\n");
+		use_irq = false;
 	}
 
 reschedule:
-	if (enabled)
-		schedule_delayed_work(&check_temp_work,
-				msecs_to_jiffies(check_interval_ms));
+	schedule_delayed_work_on(0, &check_temp_work,
+			msecs_to_jiffies(check_interval_ms));
+out:
+	mutex_unlock(&msm_thermal_mutex);
 }
 
 static void disable_msm_thermal(void)
 {
-	int cpu = 0;
-	struct cpufreq_policy *cpu_policy = NULL;
+	struct tsens_device tsens_dev;
 
-	for_each_possible_cpu(cpu) {
-		cpu_policy = cpufreq_cpu_get(cpu);
-		if (cpu_policy) {
-			if (cpu_policy->max < cpu_policy->cpuinfo.max_freq)
-				update_cpu_max_freq(cpu_policy, cpu,
-						    cpu_policy->
-						    cpuinfo.max_freq);
-			cpufreq_cpu_put(cpu_policy);
-		}
+	cancel_delayed_work_sync(&check_temp_work);
+
+	mutex_lock(&msm_thermal_mutex);
+	if (use_irq) {
+		tsens_dev.sensor_num = DEF_TEMP_SENSOR;
+		tsens_set_threshold_notify(&tsens_dev, 0, NULL, NULL);
 	}
+	update_cpu_max_freq(UINT_MAX);
+	while (msm_thermal_online_core())
+		;
+	mitigating = false;
+	pid_integral = 0;
+	pid_prev_err = 0;
+	mutex_unlock(&msm_thermal_mutex);
 }
 
 static int set_enabled(const char *val, const struct kernel_param *kp)
@@ -137,7 +292,7 @@ static int set_enabled(const char *val, const struct kernel_param *kp)
 	if (!enabled)
 		disable_msm_thermal();
 	else
-		pr_info("msm_thermal: no action for enabled = %d\n", enabled);
+		schedule_delayed_work_on(0, &check_temp_work, 0);
 
 	pr_info("msm_thermal: enabled = %d\n", enabled);
 
@@ -157,11 +312,13 @@ static int __init msm_thermal_init(void)
 	int ret = 0;
 
 	enabled = 1;
-	INIT_DELAYED_WORK(&check_temp_work, check_temp);
 
-	schedule_delayed_work(&check_temp_work, 0);
+	cpufreq_register_notifier(&msm_thermal_cpufreq_notifier,
+			CPUFREQ_POLICY_NOTIFIER);
+	register_hotcpu_notifier(&msm_thermal_cpu_notifier);
+
+	schedule_delayed_work_on(0, &check_temp_work, 0);
 
 	return ret;
 }
 fs_initcall(msm_thermal_init);
-
@@ -49,9 +49,13 @@
 #define STATE_CANCELED              3   /* transaction canceled by host */
 #define STATE_ERROR                 4   /* error from completion routine */
 
-/* number of tx and rx requests to allocate */
-#define TX_REQ_MAX 4
-#define RX_REQ_MAX 2
+/* number of tx and rx requests to allocate
+ *
+ * The UDC takes at most 16K per request, so file transfers keep the link
+ * busy by having several requests queued while the file is read or written.
+ */
+#define TX_REQ_MAX 8
+#define RX_REQ_MAX 8
 #define INTR_REQ_MAX 5
 
 /* ID for Microsoft MTP OS String */
@@ -93,6 +97,8 @@ struct mtp_dev {
 	wait_queue_head_t intr_wq;
 	struct usb_request *rx_req[RX_REQ_MAX];
 	int rx_done;
+	/* rx requests completed, they complete in the order queued */
+	atomic_t rx_completed;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
@@ -362,7 +368,9 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 	struct mtp_dev *dev = _mtp_dev;
 
 	dev->rx_done = 1;
-	if (req->status != 0)
+	atomic_inc(&dev->rx_completed);
+	/* requests dequeued by receive_file_work are not an error */
+	if (req->status != 0 && req->status != -ECONNRESET)
 		dev->state = STATE_ERROR;
 
 	wake_up(&dev->read_wq);
@@ -728,16 +736,32 @@ static void send_file_work(struct work_struct *data) {
 	smp_wmb();
 }
 
-/* read from USB and write to a local file */
+/* dequeue the rx requests still queued by receive_file_work */
+static void mtp_dequeue_rx(struct mtp_dev *dev, int tail, int inflight)
+{
+	while (inflight--) {
+		usb_ep_dequeue(dev->ep_out, dev->rx_req[tail]);
+		tail = (tail + 1) % RX_REQ_MAX;
+	}
+}
+
+/* read from USB and write to a local file
+ *
+ * When the length is known up to RX_REQ_MAX requests are kept queued, the
+ * data of each is written out as it completes while the rest are filled.
+ * A length of 0xFFFFFFFF means reading until a short packet, nothing can
+ * be queued past it then, so only one request is queued at a time.
+ */
 static void receive_file_work(struct work_struct *data)
 {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, receive_file_work);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *req;
 	struct file *filp;
 	loff_t offset;
 	int64_t count;
-	int ret, cur_buf = 0;
+	int ret, head = 0, tail = 0, inflight = 0, completed = 0;
+	int depth;
 	int r = 0;
 
 	/* read our parameters */
@@ -748,62 +772,68 @@ static void receive_file_work(struct work_struct *data)
 
 	DBG(cdev, "receive_file_work(%lld)\n", count);
 
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
+	depth = (count == 0xFFFFFFFF) ? 1 : RX_REQ_MAX;
+	atomic_set(&dev->rx_completed, 0);
 
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
+	while (count > 0 || inflight) {
+		/* keep the queue full */
+		while (count > 0 && inflight < depth) {
+			req = dev->rx_req[head];
+			req->length = (count > MTP_BULK_BUFFER_SIZE
 					? MTP_BULK_BUFFER_SIZE : count);
 			dev->rx_done = 0;
-			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
+			ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				dev->state = STATE_ERROR;
-				break;
+				mtp_dequeue_rx(dev, tail, inflight);
+				goto out;
 			}
+			head = (head + 1) % RX_REQ_MAX;
+			inflight++;
+			if (count != 0xFFFFFFFF)
+				count -= req->length;
 		}
 
-		if (write_req) {
-			DBG(cdev, "rx %p %d\n", write_req, write_req->actual);
-			ret = vfs_write(filp, write_req->buf, write_req->actual,
-				&offset);
-			DBG(cdev, "vfs_write %d\n", ret);
-			if (ret != write_req->actual) {
-				r = -EIO;
-				dev->state = STATE_ERROR;
-				break;
-			}
-			write_req = NULL;
+		/* wait for the oldest read to complete */
+		ret = wait_event_interruptible(dev->read_wq,
+			atomic_read(&dev->rx_completed) != completed ||
+			dev->state != STATE_BUSY);
+		if (dev->state == STATE_CANCELED) {
+			r = -ECANCELED;
+			mtp_dequeue_rx(dev, tail, inflight);
+			break;
+		}
+		if (atomic_read(&dev->rx_completed) == completed) {
+			r = ret ? ret : -EIO;
+			mtp_dequeue_rx(dev, tail, inflight);
+			break;
 		}
+		req = dev->rx_req[tail];
+		tail = (tail + 1) % RX_REQ_MAX;
+		inflight--;
+		completed++;
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED) {
-				r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
-			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/* short packet is used to signal EOF for sizes > 4 gig */
-				DBG(cdev, "got short packet\n");
-				count = 0;
-			}
+		DBG(cdev, "rx %p %d\n", req, req->actual);
+		ret = vfs_write(filp, req->buf, req->actual, &offset);
+		DBG(cdev, "vfs_write %d\n", ret);
+		if (ret != req->actual) {
+			r = -EIO;
+			dev->state = STATE_ERROR;
+			mtp_dequeue_rx(dev, tail, inflight);
+			break;
+		}
 
-			write_req = read_req;
-			read_req = NULL;
+		if (req->actual < req->length) {
+			/* short packet is used to signal EOF for sizes > 4 gig */
+			DBG(cdev, "got short packet\n");
+			count = 0;
+			mtp_dequeue_rx(dev, tail, inflight);
+			inflight = 0;
 		}
 	}
 
+out:
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
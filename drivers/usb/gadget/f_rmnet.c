@@ -334,10 +334,9 @@ static int gport_rmnet_connect(struct f_rmnet *dev)
 	switch (dxport) {
 	case USB_GADGET_XPORT_BAM:
 	case USB_GADGET_XPORT_BAM2BAM:
-		/* currently only one connection (idx 0)
-		   is supported */
+		/* bam2bam port N uses usb_bam connection N */
 		ret = gbam_connect(&dev->port, port_num,
-						   dxport, 0);
+						   dxport, port_num);
 		if (ret) {
 			pr_err("%s: gbam_connect failed: err:%d\n",
 					__func__, ret);
@@ -105,6 +105,12 @@ static inline struct f_rndis *func_to_rndis(struct usb_function *f)
 	return container_of(f, struct f_rndis, port.func);
 }
 
+/* packets the host may send per transfer, told in RNDIS_INITIALIZE_CMPLT */
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+	"Maximum packets per host to device transfer");
+
 /* peak (theoretical) bulk transfer rate in bits-per-second */
 static unsigned int bitrate(struct usb_gadget *g)
 {
@@ -401,6 +407,9 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 	if (status < 0)
 		ERROR(cdev, "RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
+	/* REMOTE_NDIS_INITIALIZE_MSG says how much the host takes */
+	rndis->port.host_max_xfer_size =
+		rndis_get_host_max_xfer_size(rndis->config);
 //	spin_unlock(&dev->lock);
 }
 
@@ -558,6 +567,7 @@ static void rndis_disable(struct usb_function *f)
 
 	rndis_uninit(rndis->config);
 	gether_disconnect(&rndis->port);
+	rndis->port.host_max_xfer_size = 0;
 
 	usb_ep_disable(rndis->notify);
 	rndis->notify->driver_data = NULL;
@@ -710,6 +720,7 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
+	rndis_set_max_pkt_xfer(rndis->config, rndis->port.ul_max_pkts_per_xfer);
 
 	if (rndis_set_param_vendor(rndis->config, rndis->vendorID,
 				   rndis->manufacturer))
@@ -846,6 +857,9 @@ rndis_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN],
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.multi_pkt_xfer = true;
+	rndis->port.ul_max_pkts_per_xfer =
+		clamp_t(unsigned, rndis_ul_max_pkt_per_xfer, 1, 10);
 
 	rndis->port.func.name = "rndis";
 	rndis->port.func.strings = rndis_strings;
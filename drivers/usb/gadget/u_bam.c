@@ -77,6 +77,13 @@ module_param(bam_mux_rx_req_size, uint, S_IRUGO | S_IWUSR);
 unsigned int dl_intr_threshold = DL_INTR_THRESHOLD;
 module_param(dl_intr_threshold, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * When the hardware pipes of a bam2bam port can't be connected, carry its
+ * data through bam_dmux on the Apps processor instead.
+ */
+unsigned int bam2bam_fallback = 1;
+module_param(bam2bam_fallback, uint, S_IRUGO | S_IWUSR);
+
 #define BAM_CH_OPENED	BIT(0)
 #define BAM_CH_READY	BIT(1)
 #define SPS_PARAMS_PIPE_ID_MASK		(0x1F)
@@ -113,6 +120,12 @@ struct bam_ch_info {
 	unsigned int		rx_len;
 	unsigned long		to_modem;
 	unsigned long		to_host;
+	u64			to_modem_bytes;
+	u64			to_host_bytes;
+
+	/* bam2bam only */
+	unsigned int		b2b_connect_cnt;
+	unsigned int		b2b_fallback_cnt;
 };
 
 struct gbam_port {
@@ -127,6 +140,9 @@ struct gbam_port {
 
 	struct work_struct	connect_w;
 	struct work_struct	disconnect_w;
+
+	/* software port a bam2bam port fell back to, if any */
+	struct gbam_port	*sw_port;
 };
 
 static struct bam_portmaster {
@@ -226,6 +242,7 @@ static void gbam_write_data_tohost(struct gbam_port *port)
 			break;
 		}
 		d->to_host++;
+		d->to_host_bytes += req->length;
 	}
 	spin_unlock_irqrestore(&port->port_lock_dl, flags);
 }
@@ -325,6 +342,7 @@ static void gbam_data_write_tobam(struct work_struct *w)
 
 		d->pending_with_bam++;
 		d->to_modem++;
+		d->to_modem_bytes += skb->len;
 
 		pr_debug("%s: port:%p d:%p tom:%lu pbam:%u pno:%d\n", __func__,
 				port, d, d->to_modem, d->pending_with_bam,
@@ -337,6 +355,7 @@ static void gbam_data_write_tobam(struct work_struct *w)
 			pr_debug("%s: write error:%d\n", __func__, ret);
 			d->pending_with_bam--;
 			d->to_modem--;
+			d->to_modem_bytes -= skb->len;
 			d->tomodem_drp_cnt++;
 			dev_kfree_skb_any(skb);
 			break;
@@ -647,8 +666,28 @@ static void gbam2bam_disconnect_work(struct work_struct *w)
 {
 	struct gbam_port *port =
 			container_of(w, struct gbam_port, disconnect_w);
+	struct gbam_port	*sw;
 	unsigned long		flags;
 
+	/* runs after the connect work, so a fallback is already set up */
+	sw = port->sw_port;
+	if (sw) {
+		port->sw_port = NULL;
+		gbam_free_buffers(sw);
+
+		spin_lock_irqsave(&sw->port_lock_ul, flags);
+		spin_lock(&sw->port_lock_dl);
+		sw->port_usb = 0;
+		n_tx_req_queued = 0;
+		spin_unlock(&sw->port_lock_dl);
+		spin_unlock_irqrestore(&sw->port_lock_ul, flags);
+
+		usb_ep_disable(port->gr->out);
+		usb_ep_disable(port->gr->in);
+		gbam_disconnect_work(&sw->disconnect_w);
+		return;
+	}
+
 	spin_lock_irqsave(&port->port_lock_ul, flags);
 	spin_lock(&port->port_lock_dl);
 	port->port_usb = 0;
@@ -694,6 +733,58 @@ static void gbam_connect_work(struct work_struct *w)
 	pr_debug("%s: done\n", __func__);
 }
 
+/*
+ * The hardware pipes could not be connected: hand the endpoints to the
+ * software port of the same number, if it exists and is not in use.
+ */
+static void gbam2bam_fallback(struct gbam_port *port)
+{
+	struct grmnet		*gr = port->gr;
+	struct gbam_port	*sw;
+	struct bam_ch_info	*d;
+	unsigned long		flags;
+
+	if (!bam2bam_fallback || port->port_num >= n_bam_ports)
+		return;
+	sw = bam_ports[port->port_num].port;
+	d = &sw->data_ch;
+
+	spin_lock_irqsave(&sw->port_lock_ul, flags);
+	spin_lock(&sw->port_lock_dl);
+	if (sw->port_usb) {
+		spin_unlock(&sw->port_lock_dl);
+		spin_unlock_irqrestore(&sw->port_lock_ul, flags);
+		pr_err("%s: software port#%d busy, no fallback\n",
+				__func__, port->port_num);
+		return;
+	}
+	sw->port_usb = gr;
+	d->to_host = 0;
+	d->to_modem = 0;
+	d->to_host_bytes = 0;
+	d->to_modem_bytes = 0;
+	d->pending_with_bam = 0;
+	d->tohost_drp_cnt = 0;
+	d->tomodem_drp_cnt = 0;
+	spin_unlock(&sw->port_lock_dl);
+	spin_unlock_irqrestore(&sw->port_lock_ul, flags);
+
+	spin_lock_irqsave(&port->port_lock_ul, flags);
+	spin_lock(&port->port_lock_dl);
+	port->port_usb = 0;
+	port->sw_port = sw;
+	spin_unlock(&port->port_lock_dl);
+	spin_unlock_irqrestore(&port->port_lock_ul, flags);
+
+	gr->in->driver_data = sw;
+	gr->out->driver_data = sw;
+	port->data_ch.b2b_fallback_cnt++;
+
+	pr_info("%s: port#%d falls back to the software data path\n",
+			__func__, port->port_num);
+	gbam_connect_work(&sw->connect_w);
+}
+
 static void gbam2bam_connect_work(struct work_struct *w)
 {
 	struct gbam_port *port = container_of(w, struct gbam_port, connect_w);
@@ -729,8 +820,10 @@ static void gbam2bam_connect_work(struct work_struct *w)
 	if (ret) {
 		pr_err("%s: usb_bam_connect failed: err:%d\n",
 			__func__, ret);
+		gbam2bam_fallback(port);
 		return;
 	}
+	d->b2b_connect_cnt++;
 
 	d->rx_req = usb_ep_alloc_request(port->port_usb->out, GFP_KERNEL);
 	if (!d->rx_req)
@@ -959,6 +1052,8 @@ static ssize_t gbam_read_stats(struct file *file, char __user *ubuf,
 				"#PORT:%d port:%p data_ch:%p#\n"
 				"dpkts_to_usbhost: %lu\n"
 				"dpkts_to_modem:  %lu\n"
+				"dbytes_to_usbhost: %llu\n"
+				"dbytes_to_modem:  %llu\n"
 				"dpkts_pwith_bam: %u\n"
 				"to_usbhost_dcnt:  %u\n"
 				"tomodem__dcnt:  %u\n"
@@ -968,6 +1063,7 @@ static ssize_t gbam_read_stats(struct file *file, char __user *ubuf,
 				"data_ch_ready:  %d\n",
 				i, port, &port->data_ch,
 				d->to_host, d->to_modem,
+				d->to_host_bytes, d->to_modem_bytes,
 				d->pending_with_bam,
 				d->tohost_drp_cnt, d->tomodem_drp_cnt,
 				d->tx_skb_q.qlen, d->rx_skb_q.qlen,
@@ -978,6 +1074,34 @@ static ssize_t gbam_read_stats(struct file *file, char __user *ubuf,
 		spin_unlock_irqrestore(&port->port_lock_ul, flags);
 	}
 
+	/* the data itself never reaches software, only the setup shows */
+	for (i = 0; i < n_bam2bam_ports; i++) {
+		port = bam2bam_ports[i];
+		if (!port)
+			continue;
+		spin_lock_irqsave(&port->port_lock_ul, flags);
+		spin_lock(&port->port_lock_dl);
+
+		d = &port->data_ch;
+
+		temp += scnprintf(buf + temp, DEBUG_BUF_SIZE - temp,
+				"#BAM2BAM PORT:%d port:%p#\n"
+				"connection_idx: %u\n"
+				"src_pipe_idx:   %u\n"
+				"dst_pipe_idx:   %u\n"
+				"connected:      %d\n"
+				"fallback:       %d\n"
+				"connect_cnt:    %u\n"
+				"fallback_cnt:   %u\n",
+				i, port, d->connection_idx,
+				d->src_pipe_idx, d->dst_pipe_idx,
+				port->port_usb != NULL, port->sw_port != NULL,
+				d->b2b_connect_cnt, d->b2b_fallback_cnt);
+
+		spin_unlock(&port->port_lock_dl);
+		spin_unlock_irqrestore(&port->port_lock_ul, flags);
+	}
+
 	ret = simple_read_from_buffer(ubuf, count, ppos, buf, temp);
 
 	kfree(buf);
@@ -1005,6 +1129,8 @@ static ssize_t gbam_reset_stats(struct file *file, const char __user *buf,
 
 		d->to_host = 0;
 		d->to_modem = 0;
+		d->to_host_bytes = 0;
+		d->to_modem_bytes = 0;
 		d->pending_with_bam = 0;
 		d->tohost_drp_cnt = 0;
 		d->tomodem_drp_cnt = 0;
@@ -1012,6 +1138,15 @@ static ssize_t gbam_reset_stats(struct file *file, const char __user *buf,
 		spin_unlock(&port->port_lock_dl);
 		spin_unlock_irqrestore(&port->port_lock_ul, flags);
 	}
+
+	for (i = 0; i < n_bam2bam_ports; i++) {
+		port = bam2bam_ports[i];
+		if (!port)
+			continue;
+		d = &port->data_ch;
+		d->b2b_connect_cnt = 0;
+		d->b2b_fallback_cnt = 0;
+	}
 	return count;
 }
 
@@ -1146,6 +1281,8 @@ int gbam_connect(struct grmnet *gr, u8 port_num,
 
 		d->to_host = 0;
 		d->to_modem = 0;
+		d->to_host_bytes = 0;
+		d->to_modem_bytes = 0;
 		d->pending_with_bam = 0;
 		d->tohost_drp_cnt = 0;
 		d->tomodem_drp_cnt = 0;
@@ -1178,6 +1315,12 @@ int gbam_setup(unsigned int no_bam_port, unsigned int no_bam2bam_port)
 		return -EINVAL;
 	}
 
+	/* software ports for bam2bam ports to fall back to */
+	if (bam2bam_fallback)
+		no_bam_port = max(no_bam_port,
+				  min_t(unsigned int, no_bam2bam_port,
+					BAM_N_PORTS));
+
 	gbam_wq = alloc_workqueue("k_gbam", WQ_UNBOUND | WQ_MEM_RECLAIM, 1);
 	if (!gbam_wq) {
 		pr_err("%s: Unable to create workqueue gbam_wq\n",
@@ -73,6 +73,14 @@ static unsigned int ghsic_data_pend_limit_with_bridge =
 		GHSIC_DATA_PENDLIMIT_WITH_BRIDGE;
 module_param(ghsic_data_pend_limit_with_bridge, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * The serial (DUN) channel is a byte stream, so packets queued behind each
+ * other can be merged into one transfer. rmnet keeps packet boundaries and
+ * is never aggregated.
+ */
+static unsigned int ghsic_data_serial_aggr = 1;
+module_param(ghsic_data_serial_aggr, uint, S_IRUGO | S_IWUSR);
+
 #define CH_OPENED 0
 #define CH_READY 1
 
@@ -118,6 +126,7 @@ struct gdata_port {
 	unsigned int		tx_unthrottled_cnt;
 	unsigned int		tomodem_drp_cnt;
 	unsigned int		unthrottled_pnd_skbs;
+	unsigned long		aggr_cnt;
 };
 
 static struct {
@@ -180,6 +189,23 @@ static void ghsic_data_unthrottle_tx(void *ctx)
 	spin_unlock_irqrestore(&port->port_lock, flags);
 }
 
+/* Append the skbs queued behind skb to it, as far as its tailroom goes */
+static void ghsic_data_aggregate(struct gdata_port *port,
+		struct sk_buff_head *q, struct sk_buff *skb)
+{
+	struct sk_buff		*next;
+
+	if (port->gtype != USB_GADGET_SERIAL || !ghsic_data_serial_aggr)
+		return;
+
+	while ((next = skb_peek(q)) && next->len <= skb_tailroom(skb)) {
+		__skb_unlink(next, q);
+		memcpy(skb_put(skb, next->len), next->data, next->len);
+		dev_kfree_skb_any(next);
+		port->aggr_cnt++;
+	}
+}
+
 static void ghsic_data_write_tohost(struct work_struct *w)
 {
 	unsigned long		flags;
@@ -203,6 +229,7 @@ static void ghsic_data_write_tohost(struct work_struct *w)
 		skb = __skb_dequeue(&port->tx_skb_q);
 		if (!skb)
 			break;
+		ghsic_data_aggregate(port, &port->tx_skb_q, skb);
 
 		req = list_first_entry(&port->tx_idle, struct usb_request,
 				list);
@@ -298,6 +325,7 @@ static void ghsic_data_write_tomdm(struct work_struct *w)
 	}
 
 	while ((skb = __skb_dequeue(&port->rx_skb_q))) {
+		ghsic_data_aggregate(port, &port->rx_skb_q, skb);
 		pr_debug("%s: port:%p tom:%lu pno:%d\n", __func__,
 				port, port->to_modem, port->port_num);
 
@@ -819,6 +847,7 @@ static ssize_t ghsic_data_read_stats(struct file *file,
 				"tx thld cnt       %u\n"
 				"tx unthld cnt     %u\n"
 				"uthld pnd skbs    %u\n"
+				"aggregated skbs   %lu\n"
 				"RX_THROTTLED      %d\n"
 				"TX_THROTTLED      %d\n"
 				"data_ch_open:     %d\n"
@@ -834,6 +863,7 @@ static ssize_t ghsic_data_read_stats(struct file *file,
 				port->tx_throttled_cnt,
 				port->tx_unthrottled_cnt,
 				port->unthrottled_pnd_skbs,
+				port->aggr_cnt,
 				test_bit(RX_THROTTLED, &port->brdg.flags),
 				test_bit(TX_THROTTLED, &port->brdg.flags),
 				test_bit(CH_OPENED, &port->bridge_sts),
@@ -870,6 +900,7 @@ static ssize_t ghsic_data_reset_stats(struct file *file,
 		port->tx_throttled_cnt = 0;
 		port->tx_unthrottled_cnt = 0;
 		port->unthrottled_pnd_skbs = 0;
+		port->aggr_cnt = 0;
 		spin_unlock_irqrestore(&port->port_lock, flags);
 	}
 	return count;
@@ -69,6 +69,13 @@ struct eth_dev {
 	struct list_head	tx_reqs, rx_reqs;
 	unsigned		tx_qlen;
 
+	/* tx aggregation, see eth_xmit_multi(); also under req_lock */
+	bool			multi_pkt_xfer;
+	unsigned		tx_buf_size;
+	struct usb_request	*tx_req_fill;	/* taken, not yet queued */
+	unsigned		tx_fill_pkts;
+	unsigned		tx_inflight;
+
 	struct sk_buff_head	rx_frames;
 
 	unsigned		header_len;
@@ -103,6 +110,19 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high speed");
 #define qmult		1
 #endif
 
+/*
+ * Functions with multi_pkt_xfer (RNDIS) copy frames into requests of up to
+ * dl_max_xfer_size bytes, 0 sends one frame per transfer as before.  The
+ * UDC takes at most 16K per request.
+ */
+static unsigned dl_max_xfer_size = 8192;
+module_param(dl_max_xfer_size, uint, S_IRUGO);
+MODULE_PARM_DESC(dl_max_xfer_size, "max bytes per device to host transfer");
+
+static unsigned dl_max_pkts_per_xfer = 10;
+module_param(dl_max_pkts_per_xfer, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dl_max_pkts_per_xfer, "max frames per transfer to the host");
+
 /* for dual-speed hardware, use deeper queues at highspeed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -237,6 +257,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->multi_pkt_xfer)
+		size *= dev->port_usb->ul_max_pkts_per_xfer;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -425,6 +447,50 @@ done:
 	return status;
 }
 
+/* Requests used by eth_xmit_multi() carry their own buffers */
+static void free_tx_bufs(struct eth_dev *dev)
+{
+	struct usb_request	*req;
+
+	list_for_each_entry(req, &dev->tx_reqs, list) {
+		kfree(req->buf);
+		req->buf = NULL;
+	}
+	dev->multi_pkt_xfer = false;
+}
+
+static void alloc_tx_bufs(struct eth_dev *dev, struct gether *link)
+{
+	struct usb_request	*req;
+
+	dev->tx_req_fill = NULL;
+	dev->tx_fill_pkts = 0;
+	dev->tx_inflight = 0;
+
+	if (!link->multi_pkt_xfer || !dl_max_xfer_size)
+		return;
+
+	dev->tx_buf_size = min(dl_max_xfer_size, 16384U - 1);
+	dev->tx_buf_size = max(dev->tx_buf_size,
+		(unsigned)(ETH_FRAME_LEN + link->header_len));
+
+	spin_lock(&dev->req_lock);
+	list_for_each_entry(req, &dev->tx_reqs, list) {
+		/* one more byte for zlp framing */
+		req->buf = kmalloc(dev->tx_buf_size + 1, GFP_ATOMIC);
+		if (!req->buf) {
+			DBG(dev, "no tx buffers, one frame per transfer\n");
+			free_tx_bufs(dev);
+			goto out;
+		}
+		req->complete = tx_complete_multi;
+		req->context = NULL;
+	}
+	dev->multi_pkt_xfer = true;
+out:
+	spin_unlock(&dev->req_lock);
+}
+
 static void rx_fill(struct eth_dev *dev, gfp_t gfp_flags)
 {
 	struct usb_request	*req;
@@ -461,6 +527,35 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static int tx_queue_multi(struct eth_dev *dev, struct usb_ep *in);
+
+static void tx_complete_multi(struct usb_ep *ep, struct usb_request *req)
+{
+	struct eth_dev	*dev = ep->driver_data;
+
+	switch (req->status) {
+	default:
+		dev->net->stats.tx_errors++;
+		VDBG(dev, "tx err %d\n", req->status);
+		/* FALLTHROUGH */
+	case -ECONNRESET:		/* unlink */
+	case -ESHUTDOWN:		/* disconnect etc */
+	case 0:
+		break;
+	}
+
+	spin_lock(&dev->req_lock);
+	list_add(&req->list, &dev->tx_reqs);
+	dev->tx_inflight--;
+	/* send what was gathered while this transfer was on the bus */
+	if (dev->tx_req_fill && req->status != -ESHUTDOWN)
+		tx_queue_multi(dev, ep);
+	spin_unlock(&dev->req_lock);
+
+	if (netif_carrier_ok(dev->net))
+		netif_wake_queue(dev->net);
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
@@ -493,6 +588,117 @@ static inline int is_promisc(u16 cdc_filter)
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
 }
 
+/* Caller holds req_lock */
+static int tx_queue_multi(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct usb_request	*req = dev->tx_req_fill;
+	int			retval;
+
+	dev->tx_req_fill = NULL;
+
+	/* same zlp framing as eth_start_xmit(), the buffer has room */
+	req->zero = 1;
+	if (!dev->zlp && (req->length % in->maxpacket) == 0)
+		req->length++;
+	req->no_interrupt = 0;
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	if (retval) {
+		DBG(dev, "tx queue err %d\n", retval);
+		dev->net->stats.tx_dropped += dev->tx_fill_pkts;
+		list_add(&req->list, &dev->tx_reqs);
+	} else {
+		dev->net->trans_start = jiffies;
+		dev->tx_inflight++;
+	}
+	dev->tx_fill_pkts = 0;
+	return retval;
+}
+
+/*
+ * RNDIS takes several messages back to back in one transfer.  While earlier
+ * transfers are on the bus, frames are copied into a request that is queued
+ * once it is full or a transfer completes, so under load one transfer (and
+ * one interrupt on each side) carries many frames while a lone frame still
+ * leaves right away.
+ */
+static netdev_tx_t eth_xmit_multi(struct eth_dev *dev, struct usb_ep *in,
+					struct sk_buff *skb)
+{
+	struct net_device	*net = dev->net;
+	struct usb_request	*req;
+	unsigned long		flags;
+	unsigned		limit;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs)) {
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+		return NETDEV_TX_BUSY;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		skb = dev->wrap(dev->port_usb, skb);
+		/* 0 until the host said how much it takes; leave zlp room */
+		limit = min(dev->tx_buf_size,
+			    dev->port_usb->host_max_xfer_size);
+		if (limit)
+			limit--;
+	} else {
+		limit = 0;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+	if (!skb) {
+		net->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+	if (skb->len > dev->tx_buf_size) {
+		dev_kfree_skb_any(skb);
+		net->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_req_fill;
+	if (req && req->length + skb->len > limit) {
+		tx_queue_multi(dev, in);
+		req = NULL;
+	}
+	if (!req) {
+		if (list_empty(&dev->tx_reqs)) {
+			/* disconnected since the check above */
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev_kfree_skb_any(skb);
+			net->stats.tx_dropped++;
+			return NETDEV_TX_OK;
+		}
+		req = container_of(dev->tx_reqs.next,
+				struct usb_request, list);
+		list_del(&req->list);
+		req->length = 0;
+		dev->tx_req_fill = req;
+
+		/* temporarily stop TX queue when the freelist empties */
+		if (list_empty(&dev->tx_reqs))
+			netif_stop_queue(net);
+	}
+
+	memcpy(req->buf + req->length, skb->data, skb->len);
+	req->length += skb->len;
+	dev->tx_fill_pkts++;
+	net->stats.tx_packets++;
+	net->stats.tx_bytes += skb->len;
+	dev_kfree_skb_any(skb);
+
+	if (!dev->tx_inflight || dev->tx_fill_pkts >= dl_max_pkts_per_xfer ||
+	    req->length >= limit)
+		tx_queue_multi(dev, in);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	return NETDEV_TX_OK;
+}
+
 static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
@@ -541,6 +747,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	if (dev->multi_pkt_xfer)
+		return eth_xmit_multi(dev, in, skb);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -916,6 +1125,7 @@ struct net_device *gether_connect(struct gether *link)
 		result = alloc_requests(dev, link, qlen(dev->gadget));
 
 	if (result == 0) {
+		alloc_tx_bufs(dev, link);
 		dev->zlp = link->is_zlp_ok;
 		DBG(dev, "qlen %d\n", qlen(dev->gadget));
 
@@ -983,6 +1193,13 @@ void gether_disconnect(struct gether *link)
 	 */
 	usb_ep_disable(link->in_ep);
 	spin_lock(&dev->req_lock);
+	if (dev->tx_req_fill) {
+		dev->net->stats.tx_dropped += dev->tx_fill_pkts;
+		list_add(&dev->tx_req_fill->list, &dev->tx_reqs);
+		dev->tx_req_fill = NULL;
+	}
+	if (dev->multi_pkt_xfer)
+		free_tx_bufs(dev);
 	while (!list_empty(&dev->tx_reqs)) {
 		req = container_of(dev->tx_reqs.next,
 					struct usb_request, list);
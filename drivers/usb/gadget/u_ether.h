@@ -66,6 +66,14 @@ struct gether {
 	bool				is_fixed;
 	u32				fixed_out_len;
 	u32				fixed_in_len;
+	/*
+	 * RNDIS can carry several wrapped frames per transfer: the host
+	 * may send up to ul_max_pkts_per_xfer, and accepts transfers up
+	 * to host_max_xfer_size (0 while it is unknown) from us.
+	 */
+	bool				multi_pkt_xfer;
+	u32				ul_max_pkts_per_xfer;
+	u32				host_max_xfer_size;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
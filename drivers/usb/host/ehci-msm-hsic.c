@@ -814,6 +814,8 @@ static int __devinit ehci_hsic_msm_probe(struct platform_device *pdev)
 	}
 
 	device_init_wakeup(&pdev->dev, 1);
+	/* The HSIC PHY is its own, nothing else waits for it to resume */
+	device_enable_async_suspend(&pdev->dev);
 	wake_lock_init(&mehci->wlock, WAKE_LOCK_SUSPEND, dev_name(&pdev->dev));
 	wake_lock(&mehci->wlock);
 
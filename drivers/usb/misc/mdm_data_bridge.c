@@ -17,6 +17,7 @@
 #include <linux/module.h>
 #include <linux/debugfs.h>
 #include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
 #include <linux/uaccess.h>
 #include <linux/ratelimit.h>
 #include <mach/usb_bridge.h>
@@ -51,6 +52,17 @@ module_param(max_rx_urbs, uint, S_IRUGO | S_IWUSR);
 unsigned int	stop_submit_urb_limit = STOP_SUBMIT_URB_LIMIT;
 module_param(stop_submit_urb_limit, uint, S_IRUGO | S_IWUSR);
 
+/*
+ * Size of the rx URBs. The modem ends each transfer with a short packet,
+ * so bigger URBs are always safe and let it complete more data per URB.
+ */
+static unsigned int	rx_urb_size = RMNET_RX_BUFSIZE;
+module_param(rx_urb_size, uint, S_IRUGO | S_IWUSR);
+
+/* autosuspend delay of the modem device, 0 keeps the usbcore default */
+static unsigned int	autosuspend_delay_ms;
+module_param(autosuspend_delay_ms, uint, S_IRUGO);
+
 #define TX_HALT   BIT(0)
 #define RX_HALT   BIT(1)
 #define SUSPENDED BIT(2)
@@ -183,6 +195,9 @@ static void data_bridge_read_cb(struct urb *urb)
 
 	brdg = dev->brdg;
 
+	/* keep the link up while data is coming in, not only going out */
+	usb_mark_last_busy(dev->udev);
+
 	skb_put(skb, urb->actual_length);
 
 	switch (urb->status) {
@@ -228,16 +243,18 @@ static int submit_rx_urb(struct data_bridge *dev, struct urb *rx_urb,
 	gfp_t flags)
 {
 	struct sk_buff	*skb;
+	unsigned int	size = max_t(unsigned int, rx_urb_size,
+				     RMNET_RX_BUFSIZE);
 	int		retval = -EINVAL;
 
-	skb = alloc_skb(RMNET_RX_BUFSIZE, flags);
+	skb = alloc_skb(size, flags);
 	if (!skb)
 		return -ENOMEM;
 
 	*((struct data_bridge **)skb->cb) = dev;
 
 	usb_fill_bulk_urb(rx_urb, dev->udev, dev->bulk_in,
-			  skb->data, RMNET_RX_BUFSIZE,
+			  skb->data, size,
 			  data_bridge_read_cb, skb);
 
 	if (test_bit(SUSPENDED, &dev->flags))
@@ -631,6 +648,10 @@ static int data_bridge_probe(struct usb_interface *iface,
 
 	usb_set_intfdata(iface, dev);
 
+	if (autosuspend_delay_ms)
+		pm_runtime_set_autosuspend_delay(&dev->udev->dev,
+						 autosuspend_delay_ms);
+
 	INIT_WORK(&dev->kevent, defer_kevent);
 	INIT_WORK(&dev->process_rx_w, data_bridge_process_rx);
 
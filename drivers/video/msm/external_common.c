@@ -1485,6 +1485,63 @@ static boolean check_edid_header(const uint8 *edid_buf)
 		&& (edid_buf[6] == 0xff) && (edid_buf[7] == 0x00);
 }
 
+/*
+ * What was parsed out of the EDID of the last sink.  Replugging the same
+ * sink, or resuming with it, only costs the read of block 0: it carries
+ * the manufacturer, product and serial number (and a checksum over all
+ * of it), so an identical block 0 stands for the same sink.
+ */
+static struct {
+	boolean valid;
+	uint8 blk0[0x80];
+	boolean hdmi_sink;
+	boolean present_3d;
+	struct hdmi_disp_mode_list_type disp_mode_list;
+	uint8 speaker_allocation_block;
+	uint16 video_latency, audio_latency;
+	uint8 audio_data_block_cnt;
+	uint32 audio_data_blocks[16];
+} hdmi_edid_cache;
+
+static void hdmi_edid_cache_save(const uint8 *blk0)
+{
+	memcpy(hdmi_edid_cache.blk0, blk0, sizeof(hdmi_edid_cache.blk0));
+	hdmi_edid_cache.hdmi_sink = external_common_state->hdmi_sink;
+	hdmi_edid_cache.present_3d = external_common_state->present_3d;
+	hdmi_edid_cache.disp_mode_list = external_common_state->disp_mode_list;
+	hdmi_edid_cache.speaker_allocation_block =
+		external_common_state->speaker_allocation_block;
+	hdmi_edid_cache.video_latency = external_common_state->video_latency;
+	hdmi_edid_cache.audio_latency = external_common_state->audio_latency;
+	hdmi_edid_cache.audio_data_block_cnt =
+		external_common_state->audio_data_block_cnt;
+	memcpy(hdmi_edid_cache.audio_data_blocks,
+		external_common_state->audio_data_blocks,
+		sizeof(hdmi_edid_cache.audio_data_blocks));
+	hdmi_edid_cache.valid = TRUE;
+}
+
+static boolean hdmi_edid_cache_restore(const uint8 *blk0)
+{
+	if (!hdmi_edid_cache.valid ||
+		memcmp(hdmi_edid_cache.blk0, blk0, sizeof(hdmi_edid_cache.blk0)))
+		return FALSE;
+
+	external_common_state->hdmi_sink = hdmi_edid_cache.hdmi_sink;
+	external_common_state->present_3d = hdmi_edid_cache.present_3d;
+	external_common_state->disp_mode_list = hdmi_edid_cache.disp_mode_list;
+	external_common_state->speaker_allocation_block =
+		hdmi_edid_cache.speaker_allocation_block;
+	external_common_state->video_latency = hdmi_edid_cache.video_latency;
+	external_common_state->audio_latency = hdmi_edid_cache.audio_latency;
+	external_common_state->audio_data_block_cnt =
+		hdmi_edid_cache.audio_data_block_cnt;
+	memcpy(external_common_state->audio_data_blocks,
+		hdmi_edid_cache.audio_data_blocks,
+		sizeof(hdmi_edid_cache.audio_data_blocks));
+	return TRUE;
+}
+
 int hdmi_common_read_edid(void)
 {
 	int status = 0;
@@ -1495,6 +1552,7 @@ int hdmi_common_read_edid(void)
 	char vendor_id[5];
 	/* EDID_BLOCK_SIZE[0x80] Each page size in the EDID ROM */
 	uint8 edid_buf[0x80 * 4];
+	uint8 blk0[0x80];
 
 	external_common_state->present_3d = 0;
 	memset(&external_common_state->disp_mode_list, 0,
@@ -1512,6 +1570,12 @@ int hdmi_common_read_edid(void)
 			edid_buf[4], edid_buf[5], edid_buf[6], edid_buf[7]);
 		goto error;
 	}
+	if (hdmi_edid_cache_restore(edid_buf)) {
+		DEV_INFO("EDID: same sink, using cached modes\n");
+		return 0;
+	}
+	/* Even extension blocks get read over block 0 below */
+	memcpy(blk0, edid_buf, sizeof(blk0));
 	hdmi_edid_extract_vendor_id(edid_buf, vendor_id);
 
 	/* EDID_CEA_EXTENSION_FLAG[0x7E] - CEC extension byte */
@@ -1601,6 +1665,7 @@ int hdmi_common_read_edid(void)
 #ifdef SUPPORT_RAW_EDID_READS
 	memcpy(sysfs_edid, edid_buf, (0x80 * 4));
 #endif
+	hdmi_edid_cache_save(blk0);
 
 	return 0;
 
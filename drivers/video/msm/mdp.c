@@ -35,6 +35,7 @@
 #include <asm/mach-types.h>
 #include <linux/semaphore.h>
 #include <linux/uaccess.h>
+#include <linux/slab.h>
 #include <mach/clk.h>
 #include "mdp.h"
 #include "msm_fb.h"
@@ -2189,8 +2190,94 @@ void mdp_hw_version(void)
 
 #ifdef CONFIG_MSM_BUS_SCALING
 static uint32_t mdp_bus_scale_handle;
+
+/*
+ * The bus driver only takes usecase indices, so the board table is
+ * registered with two extra usecases appended whose vectors are rewritten
+ * for every exact bandwidth vote. The two are used in turn: the bus driver
+ * ignores a request for the usecase it is already on and reads the old
+ * usecase back to work out what it has to take off.
+ */
+#define MDP_BUS_SCALE_DYN_USECASES	2
+
+static DEFINE_MUTEX(mdp_bus_scale_lock);
+static struct msm_bus_scale_pdata *mdp_bus_scale_dyn_table;
+static int mdp_bus_scale_dyn_base;
+static int mdp_bus_scale_curr = -1;
+
+static struct msm_bus_scale_pdata *mdp_bus_scale_table_init(
+	struct msm_bus_scale_pdata *pdata)
+{
+	struct msm_bus_scale_pdata *table;
+	struct msm_bus_paths *usecase;
+	struct msm_bus_vectors *vectors;
+	int num_paths, i;
+
+	if (pdata->num_usecases < 1)
+		return pdata;
+
+	num_paths = pdata->usecase[pdata->num_usecases - 1].num_paths;
+	if (num_paths < 1)
+		return pdata;
+
+	table = kzalloc(sizeof(*table), GFP_KERNEL);
+	usecase = kcalloc(pdata->num_usecases + MDP_BUS_SCALE_DYN_USECASES,
+		sizeof(*usecase), GFP_KERNEL);
+	vectors = kcalloc(num_paths * MDP_BUS_SCALE_DYN_USECASES,
+		sizeof(*vectors), GFP_KERNEL);
+	if (!table || !usecase || !vectors) {
+		kfree(table);
+		kfree(usecase);
+		kfree(vectors);
+		return pdata;
+	}
+
+	*table = *pdata;
+	memcpy(usecase, pdata->usecase,
+		pdata->num_usecases * sizeof(*usecase));
+
+	/* Same ports as the highest board usecase */
+	for (i = 0; i < MDP_BUS_SCALE_DYN_USECASES; i++) {
+		usecase[pdata->num_usecases + i].num_paths = num_paths;
+		usecase[pdata->num_usecases + i].vectors =
+			&vectors[i * num_paths];
+		memcpy(&vectors[i * num_paths],
+			pdata->usecase[pdata->num_usecases - 1].vectors,
+			num_paths * sizeof(*vectors));
+	}
+
+	table->usecase = usecase;
+	table->num_usecases =
+		pdata->num_usecases + MDP_BUS_SCALE_DYN_USECASES;
+
+	mdp_bus_scale_dyn_table = table;
+	mdp_bus_scale_dyn_base = pdata->num_usecases;
+
+	return table;
+}
+
+static void mdp_bus_scale_unregister(void)
+{
+	if (mdp_pdata && mdp_pdata->mdp_bus_scale_table &&
+		mdp_bus_scale_handle > 0)
+		msm_bus_scale_unregister_client(mdp_bus_scale_handle);
+
+	if (mdp_bus_scale_dyn_table) {
+		kfree(mdp_bus_scale_dyn_table->usecase
+			[mdp_bus_scale_dyn_base].vectors);
+		kfree(mdp_bus_scale_dyn_table->usecase);
+		kfree(mdp_bus_scale_dyn_table);
+		mdp_bus_scale_dyn_table = NULL;
+		mdp_bus_scale_dyn_base = 0;
+	}
+	mdp_bus_scale_handle = 0;
+	mdp_bus_scale_curr = -1;
+}
+
 int mdp_bus_scale_update_request(uint32_t index)
 {
+	int ret;
+
 	if (!mdp_pdata && (!mdp_pdata->mdp_bus_scale_table
 	     || index > (mdp_pdata->mdp_bus_scale_table->num_usecases - 1))) {
 		printk(KERN_ERR "%s invalid table or index\n", __func__);
@@ -2200,8 +2287,73 @@ int mdp_bus_scale_update_request(uint32_t index)
 		printk(KERN_ERR "%s invalid bus handle\n", __func__);
 		return -EINVAL;
 	}
-	return msm_bus_scale_client_update_request(mdp_bus_scale_handle,
+
+	mutex_lock(&mdp_bus_scale_lock);
+	ret = msm_bus_scale_client_update_request(mdp_bus_scale_handle,
 							index);
+	if (!ret)
+		mdp_bus_scale_curr = index;
+	mutex_unlock(&mdp_bus_scale_lock);
+
+	return ret;
+}
+
+/*
+ * mdp_bus_scale_update_bw - vote @ab/@ib bytes per second for the mdp
+ * ports, split evenly over the paths of the board's highest usecase.
+ * With @raise set the vote only ever goes up from the current exact
+ * vote, so it can be made before a heavier configuration is committed
+ * and dropped once the lighter one is on the screen.
+ * Returns -ENODEV if there is no table to vote from.
+ */
+int mdp_bus_scale_update_bw(u64 ab, u64 ib, int raise)
+{
+	struct msm_bus_paths *usecase, *curr = NULL;
+	int index, i, ret = 0;
+
+	if (!mdp_bus_scale_dyn_table || mdp_bus_scale_handle < 1)
+		return -ENODEV;
+
+	mutex_lock(&mdp_bus_scale_lock);
+
+	if (mdp_bus_scale_curr >= mdp_bus_scale_dyn_base) {
+		curr = &mdp_bus_scale_dyn_table->usecase[mdp_bus_scale_curr];
+		index = mdp_bus_scale_curr == mdp_bus_scale_dyn_base ?
+			mdp_bus_scale_dyn_base + 1 : mdp_bus_scale_dyn_base;
+	} else {
+		index = mdp_bus_scale_dyn_base;
+	}
+
+	usecase = &mdp_bus_scale_dyn_table->usecase[index];
+	do_div(ab, usecase->num_paths);
+	do_div(ib, usecase->num_paths);
+	ab = min_t(u64, ab, UINT_MAX);
+	ib = min_t(u64, ib, UINT_MAX);
+
+	if (curr) {
+		if (raise) {
+			ab = max_t(u64, ab, curr->vectors[0].ab);
+			ib = max_t(u64, ib, curr->vectors[0].ib);
+		}
+		if (ab == curr->vectors[0].ab && ib == curr->vectors[0].ib)
+			goto out;
+	}
+
+	for (i = 0; i < usecase->num_paths; i++) {
+		usecase->vectors[i].ab = ab;
+		usecase->vectors[i].ib = ib;
+	}
+
+	ret = msm_bus_scale_client_update_request(mdp_bus_scale_handle,
+							index);
+	if (!ret)
+		mdp_bus_scale_curr = index;
+
+	pr_debug("%s: usecase %d ab %llu ib %llu ret %d\n", __func__,
+		index, ab, ib, ret);
+out:
+	mutex_unlock(&mdp_bus_scale_lock);
+	return ret;
 }
 #endif
 DEFINE_MUTEX(mdp_clk_lock);
@@ -2746,7 +2898,8 @@ static int mdp_probe(struct platform_device *pdev)
 		mdp_pdata->mdp_bus_scale_table) {
 		mdp_bus_scale_handle =
 			msm_bus_scale_register_client(
-					mdp_pdata->mdp_bus_scale_table);
+				mdp_bus_scale_table_init(
+					mdp_pdata->mdp_bus_scale_table));
 		if (!mdp_bus_scale_handle) {
 			printk(KERN_ERR "%s not able to get bus scale\n",
 				__func__);
@@ -2794,15 +2947,16 @@ static int mdp_probe(struct platform_device *pdev)
 			pr_debug("%s: kobject_uevent(KOBJ_ADD)\n", __func__);
 			mfd->vsync_sysfs_created = 1;
 		}
+
+		/* sysfs vsync_event keeps working without it */
+		mdp_vsync_ring_register(mfd);
 	}
 	return 0;
 
       mdp_probe_err:
 	platform_device_put(msm_fb_dev);
 #ifdef CONFIG_MSM_BUS_SCALING
-	if (mdp_pdata && mdp_pdata->mdp_bus_scale_table &&
-		mdp_bus_scale_handle > 0)
-		msm_bus_scale_unregister_client(mdp_bus_scale_handle);
+	mdp_bus_scale_unregister();
 #endif
 	return rc;
 }
@@ -2915,9 +3069,7 @@ static int mdp_remove(struct platform_device *pdev)
 	iounmap(msm_mdp_base);
 	pm_runtime_disable(&pdev->dev);
 #ifdef CONFIG_MSM_BUS_SCALING
-	if (mdp_pdata && mdp_pdata->mdp_bus_scale_table &&
-		mdp_bus_scale_handle > 0)
-		msm_bus_scale_unregister_client(mdp_bus_scale_handle);
+	mdp_bus_scale_unregister();
 #endif
 	return 0;
 }
@@ -2926,6 +3078,7 @@ static int mdp_register_driver(void)
 {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB - 1;
+	early_suspend.resume_async = 1;
 	early_suspend.suspend = mdp_early_suspend;
 	early_suspend.resume = mdp_early_resume;
 	register_early_suspend(&early_suspend);
@@ -735,6 +735,8 @@ int mdp_ppp_blit(struct fb_info *info, struct mdp_blit_req *req);
 void mdp_lcd_update_workqueue_handler(struct work_struct *work);
 void mdp_vsync_resync_workqueue_handler(struct work_struct *work);
 void mdp_dma2_update(struct msm_fb_data_type *mfd);
+void mdp_vsync_ring_push(struct msm_fb_data_type *mfd, ktime_t vsync_time);
+int mdp_vsync_ring_register(struct msm_fb_data_type *mfd);
 void mdp_vsync_cfg_regs(struct msm_fb_data_type *mfd,
 	boolean first_time);
 void mdp_config_vsync(struct platform_device *pdev,
@@ -841,11 +843,16 @@ unsigned long mdp_perf_level2clk_rate(uint32 perf_level);
 
 #ifdef CONFIG_MSM_BUS_SCALING
 int mdp_bus_scale_update_request(uint32_t index);
+int mdp_bus_scale_update_bw(u64 ab, u64 ib, int raise);
 #else
 static inline int mdp_bus_scale_update_request(uint32_t index)
 {
 	return 0;
 }
+static inline int mdp_bus_scale_update_bw(u64 ab, u64 ib, int raise)
+{
+	return 0;
+}
 #endif
 void mdp_dma_vsync_ctrl(int enable);
 void mdp_dma_video_vsync_ctrl(int enable);
@@ -1000,4 +1000,9 @@ int mdp4_overlay_mdp_pipe_req(struct mdp4_overlay_pipe *pipe,
 int mdp4_overlay_mdp_perf_req(struct msm_fb_data_type *mfd,
 			      struct mdp4_overlay_pipe *plist);
 void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd, int flag);
+int mdp4_overlay_static_blt_ok(int mixer);
+void mdp4_overlay_static_blt_set(int mixer);
+void mdp4_overlay_calc_bw(struct msm_fb_data_type *mfd,
+			  struct mdp4_overlay_pipe *plist, int use_blt,
+			  u64 *ab, u64 *ib);
 #endif /* MDP_H */
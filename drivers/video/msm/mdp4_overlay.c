@@ -109,6 +109,8 @@ struct mdp4_overlay_perf {
 	u32 use_ov0_blt;
 	u32 use_ov1_blt;
 	u32 mdp_bw;
+	u64 mdp_ab;
+	u64 mdp_ib;
 };
 
 struct mdp4_overlay_perf perf_request = {
@@ -2764,12 +2766,19 @@ int mdp4_overlay_mdp_perf_req(struct msm_fb_data_type *mfd,
 	if (cnt >= 3)
 		perf_req->mdp_bw = OVERLAY_PERF_LEVEL1;
 
+	mdp4_overlay_calc_bw(mfd, plist,
+		mfd->panel_info.pdest == DISPLAY_1 ?
+		perf_req->use_ov0_blt : perf_req->use_ov1_blt,
+		&perf_req->mdp_ab, &perf_req->mdp_ib);
+
 	pr_debug("%s %d pid %d cnt %d clk %d ov0_blt %d, ov1_blt %d bw %d\n",
 		 __func__, __LINE__, current->pid, cnt,
 		 perf_req->mdp_clk_rate,
 		 perf_req->use_ov0_blt,
 		 perf_req->use_ov1_blt,
 		 perf_req->mdp_bw);
+	pr_debug("%s %d pid %d ab %llu ib %llu\n", __func__, __LINE__,
+		 current->pid, perf_req->mdp_ab, perf_req->mdp_ib);
 
 	return 0;
 }
@@ -2818,7 +2827,10 @@ void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd,
 			perf_cur->mdp_clk_rate =
 				perf_req->mdp_clk_rate;
 		}
-		if (perf_req->mdp_bw < perf_cur->mdp_bw) {
+		/* exact vote if the table allows it, else the board levels */
+		if (mdp_bus_scale_update_bw(perf_req->mdp_ab,
+					    perf_req->mdp_ib, 1) &&
+		    perf_req->mdp_bw < perf_cur->mdp_bw) {
 			mdp_bus_scale_update_request
 				(OVERLAY_BUS_SCALE_TABLE_BASE -
 				 perf_req->mdp_bw);
@@ -2858,7 +2870,9 @@ void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd,
 			perf_cur->mdp_clk_rate =
 				perf_req->mdp_clk_rate;
 		}
-		if (perf_req->mdp_bw > perf_cur->mdp_bw) {
+		if (mdp_bus_scale_update_bw(perf_req->mdp_ab,
+					    perf_req->mdp_ib, 0) &&
+		    perf_req->mdp_bw > perf_cur->mdp_bw) {
 			pr_info("%s mdp bw is changed [%d] from %d to %d\n",
 				__func__,
 				flag,
@@ -2891,6 +2905,42 @@ void mdp4_overlay_mdp_perf_upd(struct msm_fb_data_type *mfd,
 	return;
 }
 
+/*
+ * mdp4_overlay_static_blt_ok - worth composing @mixer into the writeback
+ * buffer for a static screen: more than one layer is staged, and none of
+ * them is secure since the writeback buffer is not.
+ */
+int mdp4_overlay_static_blt_ok(int mixer)
+{
+	struct mdp4_overlay_pipe *pipe = ctrl->plist;
+	int i, cnt = 0;
+
+	if (mixer != MDP4_MIXER0)
+		return 0;
+
+	for (i = 0; i < OVERLAY_PIPE_MAX; i++, pipe++) {
+		if (!pipe->pipe_used || pipe->mixer_num != mixer ||
+		    pipe->pipe_type == OVERLAY_TYPE_BF)
+			continue;
+		if (pipe->flags & MDP_SECURE_OVERLAY_SESSION)
+			return 0;
+		cnt++;
+	}
+
+	return cnt > 1;
+}
+
+/*
+ * mdp4_overlay_static_blt_set - an interface moved @mixer to blt for a
+ * static screen. The requested perf still has blt off, so the next
+ * mdp4_overlay_mdp_perf_upd() after a commit stops it again.
+ */
+void mdp4_overlay_static_blt_set(int mixer)
+{
+	if (mixer == MDP4_MIXER0)
+		perf_current.use_ov0_blt = 1;
+}
+
 static int get_img(struct msmfb_data *img, struct fb_info *info,
 	struct mdp4_overlay_pipe *pipe, unsigned int plane,
 	unsigned long *start, unsigned long *len, struct file **srcp_file,
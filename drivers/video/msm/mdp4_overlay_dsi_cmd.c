@@ -22,6 +22,8 @@
 #include <linux/semaphore.h>
 #include <linux/spinlock.h>
 #include <linux/fb.h>
+#include <linux/frame_trace.h>
+#include <trace/events/frame.h>
 #include <asm/system.h>
 #include <asm/mach-types.h>
 #include <mach/hardware.h>
@@ -51,6 +53,7 @@ static struct vsycn_ctrl {
 	u32 ov_done;
 	u32 dmap_koff;
 	u32 dmap_done;
+	u32 frame_id;		/* frame_trace id of the last kickoff */
 	uint32 rdptr_intr_tot;
 	uint32 rdptr_sirq_tot;
 	atomic_t suspend;
@@ -74,6 +77,9 @@ static struct vsycn_ctrl {
 	int new_update;
 	ktime_t vsync_time;
 	struct work_struct clk_work;
+	int roi_valid[2];	/* vlist[] is a partial update of roi[] */
+	struct mdp_dirty_region roi[2];
+	struct mdp_dirty_region panel_roi;	/* window the panel is set to */
 } vsync_ctrl_db[MAX_CONTROLLER];
 
 static bool dsi_panel_on;
@@ -245,11 +251,96 @@ void mdp4_dsi_cmd_pipe_queue(int cndx, struct mdp4_overlay_pipe *pipe)
 
 	*pp = *pipe;	/* clone it */
 	vp->update_cnt++;
+	vctrl->roi_valid[undx] = 0;	/* whole frame unless told otherwise */
 
 	mutex_unlock(&vctrl->update_lock);
 	mdp4_stat.overlay_play[pipe->mixer_num]++;
 }
 
+/*
+ * mdp4_dsi_cmd_pipe_queue_roi:
+ * turn the base layer just queued into a partial update of the dirty
+ * region. Only its clone is cropped, the base pipe keeps describing
+ * the whole frame. Nothing but the base layer may be staged, the other
+ * layers would have to be cropped as well.
+ */
+static void mdp4_dsi_cmd_pipe_queue_roi(struct msm_fb_data_type *mfd,
+				struct mdp4_overlay_pipe *pipe)
+{
+	struct vsycn_ctrl *vctrl = &vsync_ctrl_db[0];
+	MDPIBUF *iBuf = &mfd->ibuf;
+	struct mdp_dirty_region roi;
+	struct mdp4_overlay_pipe *pp;
+	int i, undx;
+	u32 xres = pipe->src_width;
+	u32 yres = pipe->src_height;
+
+	if (!mfd->panel_info.mipi.partial_update || pipe->ov_blt_addr ||
+	    pipe->is_3d)
+		return;
+
+	for (i = MDP4_MIXER_STAGE0; i < MDP4_MIXER_STAGE_MAX; i++)
+		if (mdp4_overlay_stage_pipe(pipe->mixer_num, i))
+			return;
+
+	/* panels take the window in pixel pairs */
+	roi.xoffset = iBuf->dma_x & ~1;
+	roi.yoffset = iBuf->dma_y & ~1;
+	roi.width = ALIGN(iBuf->dma_x + iBuf->dma_w, 2) - roi.xoffset;
+	roi.height = ALIGN(iBuf->dma_y + iBuf->dma_h, 2) - roi.yoffset;
+	if (roi.xoffset + roi.width > xres)
+		roi.width = xres - roi.xoffset;
+	if (roi.yoffset + roi.height > yres)
+		roi.height = yres - roi.yoffset;
+
+	if (roi.width == xres && roi.height == yres)
+		return;
+
+	mutex_lock(&vctrl->update_lock);
+	undx = vctrl->update_ndx;
+	pp = &vctrl->vlist[undx].plist[pipe->pipe_ndx - 1];
+	if (!pp->pipe_used) {
+		mutex_unlock(&vctrl->update_lock);
+		return;
+	}
+
+	pp->srcp0_addr += roi.yoffset * pp->srcp0_ystride +
+				roi.xoffset * pp->bpp;
+	pp->src_width = pp->src_w = pp->dst_w = roi.width;
+	pp->src_height = pp->src_h = pp->dst_h = roi.height;
+
+	vctrl->roi[undx] = roi;
+	vctrl->roi_valid[undx] = 1;
+	mutex_unlock(&vctrl->update_lock);
+}
+
+/*
+ * mdp4_dsi_cmd_roi_commit:
+ * size overlay0, dma_p and the dsi stream for the frame about to go
+ * out and move the panel window there, if it changed since the last
+ * frame. Called with dma_p idle.
+ */
+static void mdp4_dsi_cmd_roi_commit(struct vsycn_ctrl *vctrl,
+				struct mdp_dirty_region *roi)
+{
+	struct msm_fb_data_type *mfd = vctrl->mfd;
+	struct mdp_dirty_region *cur = &vctrl->panel_roi;
+	u32 data;
+
+	if (roi->xoffset == cur->xoffset && roi->yoffset == cur->yoffset &&
+	    roi->width == cur->width && roi->height == cur->height)
+		return;
+
+	data = (roi->height << 16) | roi->width;
+	/* overlay0 ROI and dma_p source size */
+	MDP_OUTP(MDP_BASE + MDP4_OVERLAYPROC0_BASE + 0x0008, data);
+	MDP_OUTP(MDP_BASE + 0x90004, data);
+
+	mipi_dsi_cmd_mdp_window(&mfd->panel_info.mipi, roi->xoffset,
+				roi->yoffset, roi->width, roi->height);
+	*cur = *roi;
+}
+
 static void mdp4_dsi_cmd_blt_ov_update(struct mdp4_overlay_pipe *pipe);
 
 int mdp4_dsi_cmd_pipe_commit(int cndx, int wait)
@@ -264,6 +355,8 @@ int mdp4_dsi_cmd_pipe_commit(int cndx, int wait)
 	int need_dmap_wait = 0;
 	int need_ov_wait = 0;
 	int cnt = 0;
+	int base_queued, base_partial;
+	struct mdp_dirty_region roi;
 
 	vctrl = &vsync_ctrl_db[0];
 
@@ -278,6 +371,17 @@ int mdp4_dsi_cmd_pipe_commit(int cndx, int wait)
 		return cnt;
 	}
 
+	if (vctrl->roi_valid[undx]) {
+		roi = vctrl->roi[undx];
+		vctrl->roi_valid[undx] = 0;
+	} else {
+		roi.xoffset = 0;
+		roi.yoffset = 0;
+		roi.width = pipe->src_width;
+		roi.height = pipe->src_height;
+	}
+	base_queued = vp->plist[pipe->pipe_ndx - 1].pipe_used;
+
 	vctrl->update_ndx++;
 	vctrl->update_ndx &= 0x01;
 	vp->update_cnt = 0;     /* reset */
@@ -336,6 +440,18 @@ int mdp4_dsi_cmd_pipe_commit(int cndx, int wait)
 		vctrl->blt_change = 0;
 	}
 
+	/*
+	 * going back to a full frame, the base layer is still cropped to
+	 * the last partial update if it is not part of this one
+	 */
+	base_partial = vctrl->panel_roi.width != pipe->src_width ||
+			vctrl->panel_roi.height != pipe->src_height;
+	if (base_partial && !base_queued &&
+	    roi.width == pipe->src_width && roi.height == pipe->src_height &&
+	    pipe->mixer_stage == MDP4_MIXER_STAGE_BASE)
+		mdp4_overlay_vsync_commit(pipe);
+	mdp4_dsi_cmd_roi_commit(vctrl, &roi);
+
 	pipe = vp->plist;
 	for (i = 0; i < OVERLAY_PIPE_MAX; i++, pipe++) {
 		if (pipe->pipe_used) {
@@ -373,6 +489,8 @@ int mdp4_dsi_cmd_pipe_commit(int cndx, int wait)
 	pr_debug("%s: kickoff\n", __func__);
 	/* kickoff overlay engine */
 	mdp4_stat.kickoff_ov0++;
+	vctrl->frame_id = frame_trace_display();
+	trace_frame_kickoff(vctrl->frame_id, mdp4_stat.kickoff_ov0);
 	outpdw(MDP_BASE + 0x0004, 0);
 	mb();
 	spin_unlock_irqrestore(&vctrl->spin_lock, flags);
@@ -526,6 +644,7 @@ static void primary_rdptr_isr(int cndx)
 
 	spin_lock(&vctrl->spin_lock);
 	vctrl->vsync_time = ktime_get();
+	mdp_vsync_ring_push(vctrl->mfd, vctrl->vsync_time);
 
 	complete_all(&vctrl->vsync_comp);
 	vctrl->wait_vsync_cnt = 0;
@@ -551,6 +670,7 @@ void mdp4_dmap_done_dsi_cmd(int cndx)
 	spin_lock(&vctrl->spin_lock);
 	vsync_irq_disable(INTR_DMA_P_DONE, MDP_DMAP_TERM);
 	vctrl->dmap_done++;
+	trace_frame_scanout(vctrl->frame_id, vctrl->dmap_done);
 	diff = vctrl->ov_done - vctrl->dmap_done;
 	pr_debug("%s: ov_koff=%d ov_done=%d dmap_koff=%d dmap_done=%d cpu=%d\n",
 		__func__, vctrl->ov_koff, vctrl->ov_done, vctrl->dmap_koff,
@@ -876,6 +996,12 @@ static void mdp4_overlay_update_dsi_cmd(struct msm_fb_data_type *mfd)
 
 	mdp4_overlay_setup_pipe_addr(mfd, pipe);
 
+	/* the panel comes out of reset with the whole frame as window */
+	vctrl->panel_roi.xoffset = 0;
+	vctrl->panel_roi.yoffset = 0;
+	vctrl->panel_roi.width = pipe->src_width;
+	vctrl->panel_roi.height = pipe->src_height;
+
 	mdp4_overlay_rgb_setup(pipe);
 
 	mdp4_overlay_reg_flush(pipe, 1);
@@ -1154,6 +1280,7 @@ void mdp4_dsi_cmd_overlay(struct msm_fb_data_type *mfd)
 		mdp4_mipi_vsync_enable(mfd, pipe, 0);
 		mdp4_overlay_setup_pipe_addr(mfd, pipe);
 		mdp4_dsi_cmd_pipe_queue(0, pipe);
+		mdp4_dsi_cmd_pipe_queue_roi(mfd, pipe);
 	}
 
 	mdp4_overlay_mdp_perf_upd(mfd, 1);
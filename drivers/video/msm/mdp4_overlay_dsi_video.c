@@ -45,6 +45,9 @@ static int dsi_video_enabled;
 
 #define MAX_CONTROLLER	1
 
+/* idle time after the last commit before a static screen goes to blt */
+#define STATIC_SCREEN_DELAY	msecs_to_jiffies(500)
+
 static struct vsycn_ctrl {
 	struct device *dev;
 	int inited;
@@ -67,6 +70,8 @@ static struct vsycn_ctrl {
 	struct vsync_update vlist[2];
 	int vsync_irq_enabled;
 	ktime_t vsync_time;
+	unsigned long commit_jiffies;
+	struct delayed_work static_work;
 } vsync_ctrl_db[MAX_CONTROLLER];
 
 static void vsync_irq_enable(int intr, int term)
@@ -251,6 +256,11 @@ int mdp4_dsi_video_pipe_commit(int cndx, int wait)
 
 	mdp4_stat.overlay_commit[pipe->mixer_num]++;
 
+	vctrl->commit_jiffies = jiffies;
+	if (!delayed_work_pending(&vctrl->static_work))
+		schedule_delayed_work(&vctrl->static_work,
+					STATIC_SCREEN_DELAY);
+
 	if (wait) {
 		if (pipe->ov_blt_addr)
 			mdp4_dsi_video_wait4ov(0);
@@ -419,6 +429,60 @@ ssize_t mdp4_dsi_video_show_event(struct device *dev,
 	return ret;
 }
 
+static void mdp4_dsi_video_do_blt(struct msm_fb_data_type *mfd, int enable);
+
+/*
+ * Nothing was committed for STATIC_SCREEN_DELAY: compose the staged
+ * layers once into the ov0 writeback buffer and let dma_p scan out only
+ * that buffer, so each refresh fetches one frame instead of every layer.
+ * The next commit drops back to direct out through
+ * mdp4_overlay_mdp_perf_upd().
+ */
+static void mdp4_dsi_video_static_work(struct work_struct *work)
+{
+	struct vsycn_ctrl *vctrl;
+	struct msm_fb_data_type *mfd;
+	struct mdp4_overlay_pipe *pipe;
+	unsigned long timeout;
+
+	vctrl = container_of(to_delayed_work(work), struct vsycn_ctrl,
+				static_work);
+	mfd = vctrl->mfd;
+	if (!mfd)
+		return;
+
+	mutex_lock(&mfd->dma->ov_mutex);
+
+	pipe = vctrl->base_pipe;
+	if (!pipe || !mfd->panel_power_on || atomic_read(&vctrl->suspend))
+		goto out;
+
+	timeout = vctrl->commit_jiffies + STATIC_SCREEN_DELAY;
+	if (time_before(jiffies, timeout)) {
+		schedule_delayed_work(&vctrl->static_work, timeout - jiffies);
+		goto out;
+	}
+
+	/* leave frames queued by the user alone */
+	if (vctrl->vlist[vctrl->update_ndx].update_cnt)
+		goto out;
+
+	if (pipe->ov_blt_addr || !mdp4_overlay_static_blt_ok(pipe->mixer_num))
+		goto out;
+
+	mdp4_dsi_video_do_blt(mfd, 1);
+	if (!pipe->ov_blt_addr)
+		goto out;
+	mdp4_overlay_static_blt_set(pipe->mixer_num);
+
+	/* the base layer commit switches over and composes the frame */
+	mdp4_dsi_video_pipe_queue(0, pipe);
+	mdp4_dsi_video_pipe_commit(0, 1);
+	pr_debug("%s: static screen, blt on\n", __func__);
+out:
+	mutex_unlock(&mfd->dma->ov_mutex);
+}
+
 extern int mipi_panel_power_en(int on);
 void mdp4_dsi_vsync_init(int cndx)
 {
@@ -444,6 +508,7 @@ void mdp4_dsi_vsync_init(int cndx)
 	atomic_set(&vctrl->suspend, 1);
 	atomic_set(&vctrl->vsync_resume, 1);
 	spin_lock_init(&vctrl->spin_lock);
+	INIT_DELAYED_WORK(&vctrl->static_work, mdp4_dsi_video_static_work);
 }
 void mdp4_dsi_video_base_swap(int cndx, struct mdp4_overlay_pipe *pipe)
 {
@@ -688,6 +753,8 @@ int mdp4_dsi_video_off(struct platform_device *pdev)
 	atomic_set(&vctrl->suspend, 1);
 	atomic_set(&vctrl->vsync_resume, 0);
 
+	cancel_delayed_work_sync(&vctrl->static_work);
+
 	msleep(20);	/* >= 17 ms */
 
 	complete_all(&vctrl->vsync_comp);
@@ -916,6 +983,7 @@ void mdp4_primary_vsync_dsi_video(void)
 
 	spin_lock(&vctrl->spin_lock);
 	vctrl->vsync_time = ktime_get();
+	mdp_vsync_ring_push(vctrl->mfd, vctrl->vsync_time);
 
 	if (vctrl->wait_vsync_cnt) {
 		complete_all(&vctrl->vsync_comp);
@@ -507,6 +507,7 @@ static void primary_rdptr_isr(int cndx)
 	pr_debug("%s: ISR, cpu=%d\n", __func__, smp_processor_id());
 	vctrl->rdptr_intr_tot++;
 	vctrl->vsync_time = ktime_get();
+	mdp_vsync_ring_push(vctrl->mfd, vctrl->vsync_time);
 
 	spin_lock(&vctrl->spin_lock);
 	if (vctrl->uevent)
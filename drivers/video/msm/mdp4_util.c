@@ -24,6 +24,7 @@
 #include <linux/debugfs.h>
 #include <linux/semaphore.h>
 #include <linux/uaccess.h>
+#include <linux/math64.h>
 #include <linux/msm_mdp.h>
 #include <asm/system.h>
 #include <asm/mach-types.h>
@@ -241,6 +242,97 @@ void mdp4_fetch_cfg(uint32 core_clk)
 	mdp_pipe_ctrl(MDP_CMD_BLOCK, MDP_BLOCK_POWER_OFF, FALSE);
 }
 
+#define MDP4_BW_DEFAULT_FPS	60
+/* headroom on top of the computed fetch, in percent */
+#define MDP4_BW_AB_MARGIN	20
+#define MDP4_BW_IB_MARGIN	25
+
+static u32 mdp4_overlay_panel_fps(struct msm_fb_data_type *mfd)
+{
+	u32 fps = 0;
+
+	if (mfd->panel_info.type == MIPI_VIDEO_PANEL ||
+	    mfd->panel_info.type == MIPI_CMD_PANEL)
+		fps = mfd->panel_info.mipi.frame_rate;
+	if (!fps)
+		fps = mfd->panel_info.frame_rate;
+
+	return fps ? fps : MDP4_BW_DEFAULT_FPS;
+}
+
+/*
+ * Bytes per second a pipe fetches. The chroma planes of the yuv formats
+ * are counted at their subsampled size, and a vertical downscale makes the
+ * pipe fetch several source lines in the time of one output line, which
+ * is what the instantaneous vote has to cover.
+ */
+static void mdp4_overlay_pipe_bw(struct mdp4_overlay_pipe *pipe, u32 fps,
+				 u64 *ab, u64 *ib)
+{
+	u64 bw;
+	u32 bpp2;	/* bytes per pixel, times 2 */
+
+	if (pipe->fetch_plane == OVERLAY_PLANE_INTERLEAVED)
+		bpp2 = pipe->bpp * 2;
+	else if (pipe->chroma_sample == MDP4_CHROMA_420)
+		bpp2 = 3;
+	else if (pipe->chroma_sample == MDP4_CHROMA_RGB)
+		bpp2 = 6;
+	else
+		bpp2 = 4;
+
+	bw = (u64)pipe->src_w * pipe->src_h * bpp2 * fps;
+	bw >>= 1;
+	*ab = bw;
+
+	if (pipe->dst_h && pipe->src_h > pipe->dst_h)
+		bw = div_u64(bw * pipe->src_h, pipe->dst_h);
+	*ib = bw;
+}
+
+/*
+ * mdp4_overlay_calc_bw - bus bandwidth needed by the pipes in use
+ *
+ * All pipes fetch at the same time, so both votes are the sum over the
+ * pipes. The blt writeback of @mfd's mixer adds a write and a read back
+ * of the full frame by dma.
+ */
+void mdp4_overlay_calc_bw(struct msm_fb_data_type *mfd,
+			  struct mdp4_overlay_pipe *plist, int use_blt,
+			  u64 *ab, u64 *ib)
+{
+	struct mdp4_overlay_pipe *pipe = plist;
+	u64 pipe_ab, pipe_ib, sum_ab = 0, sum_ib = 0;
+	u32 fps, mfd_fps;
+	int i, mixer;
+
+	mfd_fps = mdp4_overlay_panel_fps(mfd);
+	mixer = mfd->panel_info.pdest == DISPLAY_2 ? MDP4_MIXER1 : MDP4_MIXER0;
+
+	for (i = 0; i < OVERLAY_PIPE_MAX; i++, pipe++) {
+		if (!pipe->pipe_used || pipe->pipe_type == OVERLAY_TYPE_BF)
+			continue;
+
+		fps = pipe->mixer_num == mixer ? mfd_fps : MDP4_BW_DEFAULT_FPS;
+		mdp4_overlay_pipe_bw(pipe, fps, &pipe_ab, &pipe_ib);
+		sum_ab += pipe_ab;
+		sum_ib += pipe_ib;
+	}
+
+	if (use_blt) {
+		/* rgb888 writeback */
+		pipe_ab = (u64)mfd->panel_info.xres * mfd->panel_info.yres *
+			3 * mfd_fps * 2;
+		sum_ab += pipe_ab;
+		sum_ib += pipe_ab;
+	}
+
+	*ab = sum_ab + div_u64(sum_ab * MDP4_BW_AB_MARGIN, 100);
+	*ib = sum_ib + div_u64(sum_ib * MDP4_BW_IB_MARGIN, 100);
+	if (*ib < *ab)
+		*ib = *ab;
+}
+
 void mdp4_hw_init(void)
 {
 	ulong bits;
@@ -29,6 +29,10 @@
 #include <asm/mach-types.h>
 #include <linux/semaphore.h>
 #include <linux/uaccess.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
 #include <mach/gpio.h>
 
 #include "mdp.h"
@@ -502,3 +506,183 @@ uint32 mdp_get_lcd_line_counter(struct msm_fb_data_type *mfd)
 
 	return lcd_line;
 }
+
+/*
+ * Ring of hardware vsync timestamps behind /dev/msm_fbN_vsync. The vsync
+ * isrs push into it directly, so readers see the time the interrupt came
+ * in rather than when a sysfs reader got scheduled, and a reader that only
+ * wants to refine its prediction can pick up the history with a non
+ * blocking read instead of waking up for every frame.
+ */
+struct mdp_vsync_ring {
+	spinlock_t lock;
+	wait_queue_head_t wq;
+	u64 count;	/* vsyncs pushed so far */
+	ktime_t ts[MDP_VSYNC_RING_SIZE];
+	struct miscdevice mdev;
+	char name[20];
+};
+
+struct mdp_vsync_reader {
+	struct mdp_vsync_ring *ring;
+	u64 count;	/* vsyncs already read */
+};
+
+/* called from the vsync isrs */
+void mdp_vsync_ring_push(struct msm_fb_data_type *mfd, ktime_t vsync_time)
+{
+	struct mdp_vsync_ring *ring;
+	unsigned long flags;
+
+	if (!mfd || !mfd->vsync_ring)
+		return;
+
+	ring = mfd->vsync_ring;
+	spin_lock_irqsave(&ring->lock, flags);
+	ring->ts[ring->count & (MDP_VSYNC_RING_SIZE - 1)] = vsync_time;
+	ring->count++;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	wake_up_interruptible(&ring->wq);
+}
+
+static int mdp_vsync_ring_avail(struct mdp_vsync_reader *reader)
+{
+	struct mdp_vsync_ring *ring = reader->ring;
+	unsigned long flags;
+	int avail;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	avail = ring->count != reader->count;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	return avail;
+}
+
+static int mdp_vsync_ring_open(struct inode *inode, struct file *file)
+{
+	struct miscdevice *mdev = file->private_data;
+	struct mdp_vsync_reader *reader;
+	struct mdp_vsync_ring *ring;
+	unsigned long flags;
+
+	ring = container_of(mdev, struct mdp_vsync_ring, mdev);
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	/* hand out the history on the first read */
+	reader->ring = ring;
+	spin_lock_irqsave(&ring->lock, flags);
+	if (ring->count > MDP_VSYNC_RING_SIZE)
+		reader->count = ring->count - MDP_VSYNC_RING_SIZE;
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	file->private_data = reader;
+
+	return nonseekable_open(inode, file);
+}
+
+static int mdp_vsync_ring_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static ssize_t mdp_vsync_ring_read(struct file *file, char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct mdp_vsync_reader *reader = file->private_data;
+	struct mdp_vsync_ring *ring = reader->ring;
+	struct mdp_vsync_timestamp ts[MDP_VSYNC_RING_SIZE];
+	unsigned long flags;
+	size_t i, n;
+	int ret;
+
+	n = min_t(size_t, count / sizeof(ts[0]), MDP_VSYNC_RING_SIZE);
+	if (n == 0)
+		return -EINVAL;
+
+	if (file->f_flags & O_NONBLOCK) {
+		if (!mdp_vsync_ring_avail(reader))
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(ring->wq,
+					mdp_vsync_ring_avail(reader));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock_irqsave(&ring->lock, flags);
+	/* a reader that fell behind loses the oldest stamps */
+	if (ring->count - reader->count > MDP_VSYNC_RING_SIZE)
+		reader->count = ring->count - MDP_VSYNC_RING_SIZE;
+	for (i = 0; i < n && reader->count != ring->count; i++) {
+		ts[i].timestamp = ktime_to_ns(ring->ts[reader->count &
+					(MDP_VSYNC_RING_SIZE - 1)]);
+		reader->count++;
+		ts[i].count = reader->count;
+	}
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	if (copy_to_user(buf, ts, i * sizeof(ts[0])))
+		return -EFAULT;
+
+	return i * sizeof(ts[0]);
+}
+
+static unsigned int mdp_vsync_ring_poll(struct file *file,
+					struct poll_table_struct *wait)
+{
+	struct mdp_vsync_reader *reader = file->private_data;
+
+	poll_wait(file, &reader->ring->wq, wait);
+
+	if (mdp_vsync_ring_avail(reader))
+		return POLLIN | POLLRDNORM;
+
+	return 0;
+}
+
+static const struct file_operations mdp_vsync_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = mdp_vsync_ring_open,
+	.release = mdp_vsync_ring_release,
+	.read = mdp_vsync_ring_read,
+	.poll = mdp_vsync_ring_poll,
+	.llseek = no_llseek,
+};
+
+int mdp_vsync_ring_register(struct msm_fb_data_type *mfd)
+{
+	struct mdp_vsync_ring *ring;
+	int ret;
+
+	if (mfd->vsync_ring)
+		return 0;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	spin_lock_init(&ring->lock);
+	init_waitqueue_head(&ring->wq);
+	snprintf(ring->name, sizeof(ring->name), "msm_fb%d_vsync",
+		 mfd->index);
+	ring->mdev.minor = MISC_DYNAMIC_MINOR;
+	ring->mdev.name = ring->name;
+	ring->mdev.fops = &mdp_vsync_ring_fops;
+
+	ret = misc_register(&ring->mdev);
+	if (ret) {
+		pr_err("%s: %s register failed, ret=%d\n", __func__,
+			ring->name, ret);
+		kfree(ring);
+		return ret;
+	}
+
+	mfd->vsync_ring = ring;
+
+	return 0;
+}
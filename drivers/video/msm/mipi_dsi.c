@@ -159,7 +159,6 @@ static int mipi_dsi_on(struct platform_device *pdev)
 	struct msm_panel_info *pinfo;
 	struct mipi_panel_info *mipi;
 	u32 hbp, hfp, vbp, vfp, hspw, vspw, width, height;
-	u32 ystride, bpp, data;
 	u32 dummy_xres, dummy_yres;
 	int target_type = 0;
 	int old_nice;
@@ -254,26 +253,7 @@ static int mipi_dsi_on(struct platform_device *pdev)
 		MIPI_OUTP(MIPI_DSI_BASE + 0x34, (vspw << 16));
 
 	} else {		/* command mode */
-		if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB888)
-			bpp = 3;
-		else if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB666)
-			bpp = 3;
-		else if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB565)
-			bpp = 2;
-		else
-			bpp = 3;	/* Default format set to RGB888 */
-
-		ystride = width * bpp + 1;
-
-		/* DSI_COMMAND_MODE_MDP_STREAM_CTRL */
-		data = (ystride << 16) | (mipi->vc << 8) | DTYPE_DCS_LWRITE;
-		MIPI_OUTP(MIPI_DSI_BASE + 0x5c, data);
-		MIPI_OUTP(MIPI_DSI_BASE + 0x54, data);
-
-		/* DSI_COMMAND_MODE_MDP_STREAM_TOTAL */
-		data = height << 16 | width;
-		MIPI_OUTP(MIPI_DSI_BASE + 0x60, data);
-		MIPI_OUTP(MIPI_DSI_BASE + 0x58, data);
+		mipi_dsi_cmd_mdp_stream_size(mipi, width, height);
 	}
 
 	mipi_dsi_host_init(mipi);
@@ -359,6 +359,10 @@ int mipi_dsi_cmdlist_put(struct dcs_cmd_req *cmdreq);
 struct dcs_cmd_req *mipi_dsi_cmdlist_get(void);
 void mipi_dsi_cmdlist_commit(int from_mdp);
 void mipi_dsi_cmd_mdp_busy(void);
+void mipi_dsi_cmd_mdp_stream_size(struct mipi_panel_info *mipi,
+					u32 width, u32 height);
+void mipi_dsi_cmd_mdp_window(struct mipi_panel_info *mipi,
+				u32 x, u32 y, u32 width, u32 height);
 
 #ifdef CONFIG_FB_MSM_MDP303
 void update_lane_config(struct msm_panel_info *pinfo);
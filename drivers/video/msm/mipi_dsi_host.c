@@ -1661,6 +1661,82 @@ int mipi_dsi_cmdlist_put(struct dcs_cmd_req *cmdreq)
 	return ret;
 }
 
+/*
+ * mipi_dsi_cmd_mdp_stream_size:
+ * size of the frame mdp streams to a command mode panel,
+ * the whole panel unless a partial update is in progress
+ */
+void mipi_dsi_cmd_mdp_stream_size(struct mipi_panel_info *mipi,
+					u32 width, u32 height)
+{
+	u32 ystride, bpp, data;
+
+	if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB888)
+		bpp = 3;
+	else if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB666)
+		bpp = 3;
+	else if (mipi->dst_format == DSI_CMD_DST_FORMAT_RGB565)
+		bpp = 2;
+	else
+		bpp = 3;	/* Default format set to RGB888 */
+
+	ystride = width * bpp + 1;
+
+	/* DSI_COMMAND_MODE_MDP_STREAM_CTRL */
+	data = (ystride << 16) | (mipi->vc << 8) | DTYPE_DCS_LWRITE;
+	MIPI_OUTP(MIPI_DSI_BASE + 0x5c, data);
+	MIPI_OUTP(MIPI_DSI_BASE + 0x54, data);
+
+	/* DSI_COMMAND_MODE_MDP_STREAM_TOTAL */
+	data = height << 16 | width;
+	MIPI_OUTP(MIPI_DSI_BASE + 0x60, data);
+	MIPI_OUTP(MIPI_DSI_BASE + 0x58, data);
+}
+
+static char set_col_addr[5] = {0x2a, 0x00, 0x00, 0x00, 0x00};
+static char set_page_addr[5] = {0x2b, 0x00, 0x00, 0x00, 0x00};
+
+static struct dsi_cmd_desc set_window_cmds[] = {
+	{DTYPE_DCS_LWRITE, 1, 0, 0, 0, sizeof(set_col_addr), set_col_addr},
+	{DTYPE_DCS_LWRITE, 1, 0, 0, 0, sizeof(set_page_addr), set_page_addr},
+};
+
+/*
+ * mipi_dsi_cmd_mdp_window:
+ * point the frame memory window of a command mode panel at the
+ * region mdp is about to stream and resize the stream to match.
+ * called from mdp commit before kickoff
+ */
+void mipi_dsi_cmd_mdp_window(struct mipi_panel_info *mipi,
+				u32 x, u32 y, u32 width, u32 height)
+{
+	u32 x2 = x + width - 1;
+	u32 y2 = y + height - 1;
+
+	set_col_addr[1] = (x >> 8) & 0xff;
+	set_col_addr[2] = x & 0xff;
+	set_col_addr[3] = (x2 >> 8) & 0xff;
+	set_col_addr[4] = x2 & 0xff;
+
+	set_page_addr[1] = (y >> 8) & 0xff;
+	set_page_addr[2] = y & 0xff;
+	set_page_addr[3] = (y2 >> 8) & 0xff;
+	set_page_addr[4] = y2 & 0xff;
+
+	mutex_lock(&cmd_mutex);
+	/* make sure dsi_cmd_mdp is idle */
+	mipi_dsi_cmd_mdp_busy();
+
+	mipi_dsi_buf_init(&dsi_tx_buf);
+	mipi_dsi_cmds_tx(&dsi_tx_buf, set_window_cmds,
+			ARRAY_SIZE(set_window_cmds));
+
+	mipi_dsi_cmd_mdp_stream_size(mipi, width, height);
+	mutex_unlock(&cmd_mutex);
+
+	pr_debug("%s: x=%d y=%d w=%d h=%d\n", __func__, x, y, width, height);
+}
+
 void mipi_dsi_irq_set(uint32 mask, uint32 irq)
 {
 	uint32 data;
@@ -285,6 +285,7 @@ out:
 	pinfo->mipi.insert_dcs_cmd = TRUE;
 	pinfo->mipi.wr_mem_continue = 0x3c;
 	pinfo->mipi.wr_mem_start = 0x2c;
+	pinfo->mipi.partial_update = TRUE;
 	pinfo->mipi.dsi_phy_db = &dsi_cmd_mode_phy_db;
 	pinfo->mipi.tx_eot_append = 0x01;
 	pinfo->mipi.rx_eot_ignore = 0;
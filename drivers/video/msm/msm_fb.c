@@ -120,6 +120,10 @@ static int mdp_bl_scale_config(struct msm_fb_data_type *mfd,
 static void msm_fb_scale_bl(__u32 *bl_lvl);
 static void msm_fb_commit_wq_handler(struct work_struct *work);
 static int msm_fb_pan_idle(struct msm_fb_data_type *mfd);
+static int msmfb_handle_buf_sync_ioctl(struct msm_fb_data_type *mfd,
+						struct mdp_buf_sync *buf_sync);
+static void msmfb_async_blit_work(struct work_struct *work);
+static void msmfb_async_blit_idle(struct msm_fb_data_type *mfd);
 
 #ifdef MSM_FB_ENABLE_DBGFS
 
@@ -1459,7 +1463,12 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 	init_completion(&mfd->msmfb_no_update_notify);
 	init_completion(&mfd->commit_comp);
 	mutex_init(&mfd->sync_mutex);
+	mfd->commit_ov_mixer = -1;
 	INIT_WORK(&mfd->commit_work, msm_fb_commit_wq_handler);
+	INIT_LIST_HEAD(&mfd->blit_queue);
+	mutex_init(&mfd->blit_mutex);
+	init_waitqueue_head(&mfd->blit_wait);
+	INIT_WORK(&mfd->blit_work, msmfb_async_blit_work);
 	mfd->msm_fb_backup = kzalloc(sizeof(struct msm_fb_backup_type),
 		GFP_KERNEL);
 	if (mfd->msm_fb_backup == 0) {
@@ -1561,6 +1570,8 @@ static int msm_fb_register(struct msm_fb_data_type *mfd)
 		mfd->early_suspend.suspend = msmfb_early_suspend;
 		mfd->early_suspend.resume = msmfb_early_resume;
 		mfd->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB - 2;
+		/* Panel on first, in parallel with the other handlers */
+		mfd->early_suspend.resume_async = 1;
 		register_early_suspend(&mfd->early_suspend);
 	}
 #endif
@@ -1758,6 +1769,8 @@ static int msm_fb_release(struct fb_info *info, int user)
 		return -EINVAL;
 	}
 	msm_fb_pan_idle(mfd);
+	if (mfd->ref_cnt == 1)
+		msmfb_async_blit_idle(mfd);
 	mfd->ref_cnt--;
 
 	if ((!mfd->ref_cnt) && (mfd->op_enable)) {
@@ -2021,11 +2034,21 @@ static void msm_fb_commit_wq_handler(struct work_struct *work)
 	struct msm_fb_backup_type *fb_backup;
 
 	mfd = container_of(work, struct msm_fb_data_type, commit_work);
+#ifdef CONFIG_FB_MSM_OVERLAY
+	if (mfd->commit_ov_mixer >= 0) {
+		mdp4_overlay_commit(mfd->fbi, mfd->commit_ov_mixer);
+		goto done;
+	}
+#endif
 	fb_backup = (struct msm_fb_backup_type *)mfd->msm_fb_backup;
 	var = &fb_backup->var;
 	info = &fb_backup->info;
 	msm_fb_pan_display_sub(var, info);
+#ifdef CONFIG_FB_MSM_OVERLAY
+done:
+#endif
 	mutex_lock(&mfd->sync_mutex);
+	mfd->commit_ov_mixer = -1;
 	mfd->is_committing = 0;
 	complete_all(&mfd->commit_comp);
 	mutex_unlock(&mfd->sync_mutex);
@@ -2967,6 +2990,49 @@ static void msm_fb_ensure_memory_coherency_after_dma(struct fb_info *info,
  * those areas. Hence it would be enough to perform barrier/cache operations
  * only on the START and END operations.
  */
+static int msmfb_blit_list(struct fb_info *info, struct mdp_blit_req *req_list,
+			   int req_list_count)
+{
+	int i;
+
+	/*
+	 * Ensure that any data CPU may have previously written to
+	 * internal state (but not yet committed to memory) is
+	 * guaranteed to be committed to memory now.
+	 */
+	msm_fb_ensure_memory_coherency_before_dma(info,
+			req_list, req_list_count);
+
+	/*
+	 * Do the blit DMA, if required -- returning early only if
+	 * there is a failure.
+	 */
+	for (i = 0; i < req_list_count; i++) {
+		if (!(req_list[i].flags & MDP_NO_BLIT)) {
+			/* Do the actual blit. */
+			int ret = mdp_blit(info, &(req_list[i]));
+
+			/*
+			 * Note that early returns don't guarantee
+			 * memory coherency.
+			 */
+			if (ret)
+				return ret;
+		}
+	}
+
+	/*
+	 * Ensure that CPU cache and other internal CPU state is
+	 * updated to reflect any change in memory modified by MDP blit
+	 * DMA.
+	 */
+	msm_fb_ensure_memory_coherency_after_dma(info,
+			req_list,
+			req_list_count);
+
+	return 0;
+}
+
 static int msmfb_blit(struct fb_info *info, void __user *p)
 {
 	/*
@@ -2979,7 +3045,7 @@ static int msmfb_blit(struct fb_info *info, void __user *p)
 	struct mdp_blit_req req_list[MAX_LIST_WINDOW];
 	struct mdp_blit_req_list req_list_header;
 
-	int count, i, req_list_count;
+	int count, req_list_count, ret;
 	if (bf_supported &&
 		(info->node == 1 || info->node == 2)) {
 		pr_err("%s: no pan display for fb%d.",
@@ -3009,40 +3075,9 @@ static int msmfb_blit(struct fb_info *info, void __user *p)
 				sizeof(struct mdp_blit_req)*req_list_count))
 			return -EFAULT;
 
-		/*
-		 * Ensure that any data CPU may have previously written to
-		 * internal state (but not yet committed to memory) is
-		 * guaranteed to be committed to memory now.
-		 */
-		msm_fb_ensure_memory_coherency_before_dma(info,
-				req_list, req_list_count);
-
-		/*
-		 * Do the blit DMA, if required -- returning early only if
-		 * there is a failure.
-		 */
-		for (i = 0; i < req_list_count; i++) {
-			if (!(req_list[i].flags & MDP_NO_BLIT)) {
-				/* Do the actual blit. */
-				int ret = mdp_blit(info, &(req_list[i]));
-
-				/*
-				 * Note that early returns don't guarantee
-				 * memory coherency.
-				 */
-				if (ret)
-					return ret;
-			}
-		}
-
-		/*
-		 * Ensure that CPU cache and other internal CPU state is
-		 * updated to reflect any change in memory modified by MDP blit
-		 * DMA.
-		 */
-		msm_fb_ensure_memory_coherency_after_dma(info,
-				req_list,
-				req_list_count);
+		ret = msmfb_blit_list(info, req_list, req_list_count);
+		if (ret)
+			return ret;
 
 		/* Go to next window of requests. */
 		count -= req_list_count;
@@ -3184,22 +3219,10 @@ static int msmfb_overlay_commit(struct fb_info *info, unsigned long *argp)
 	return mdp4_overlay_commit(info, ndx);
 }
 
-static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+static int msmfb_overlay_play_start(struct fb_info *info)
 {
-	int	ret;
-	struct msmfb_overlay_data req;
 	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 
-	if (mfd->overlay_play_enable == 0)	/* nothing to do */
-		return 0;
-
-	ret = copy_from_user(&req, argp, sizeof(req));
-	if (ret) {
-		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
-			__func__);
-		return ret;
-	}
-
 	complete(&mfd->msmfb_update_notify);
 	mutex_lock(&msm_fb_notify_update_sem);
 	if (mfd->msmfb_no_update_notify_timer.function)
@@ -3217,15 +3240,165 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 		}
 	}
 
-	ret = mdp4_overlay_play(info, &req);
+	return 0;
+}
+
+static void msmfb_overlay_play_end(struct fb_info *info)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
 
 	if (unset_bl_level && !bl_updated)
 		schedule_delayed_work(&mfd->backlight_worker,
 				backlight_duration);
+}
+
+static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
+{
+	int	ret;
+	struct msmfb_overlay_data req;
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+
+	if (mfd->overlay_play_enable == 0)	/* nothing to do */
+		return 0;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		printk(KERN_ERR "%s:msmfb_overlay_play ioctl failed \n",
+			__func__);
+		return ret;
+	}
+
+	ret = msmfb_overlay_play_start(info);
+	if (ret)
+		return ret;
+
+	ret = mdp4_overlay_play(info, &req);
+
+	msmfb_overlay_play_end(info);
 
 	return ret;
 }
 
+/*
+ * Hand the commit of an overlay frame to the commit worker, the same way
+ * pan display does. The acquire fences are waited for and the timeline is
+ * signalled from there, and every ioctl waits in msm_fb_pan_idle() for the
+ * frame to go out before touching the pipes again, so there is never more
+ * than one frame in flight.
+ */
+static void msmfb_overlay_commit_async(struct msm_fb_data_type *mfd,
+						int mixer)
+{
+	mutex_lock(&mfd->sync_mutex);
+	mfd->commit_ov_mixer = mixer;
+	mfd->is_committing = 1;
+	INIT_COMPLETION(mfd->commit_comp);
+	schedule_work(&mfd->commit_work);
+	mutex_unlock(&mfd->sync_mutex);
+}
+
+/*
+ * Set up and queue all the pipes of a frame in one go, the frame is then
+ * committed once instead of userspace doing a set/play round trip per
+ * layer followed by a separate commit.
+ */
+static int msmfb_overlay_set_list(struct fb_info *info, void __user *argp)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp_overlay_list list;
+	struct mdp_overlay *ov = NULL;
+	struct msmfb_overlay_data *data = NULL;
+	int i, ret = 0, started = 0;
+
+	if (copy_from_user(&list, argp, sizeof(list)))
+		return -EFAULT;
+
+	if (list.num_overlays == 0 ||
+	    list.num_overlays > MDP_OVERLAY_LIST_MAX)
+		return -EINVAL;
+
+	if (list.overlay_list) {
+		ov = kcalloc(list.num_overlays, sizeof(*ov), GFP_KERNEL);
+		if (ov == NULL)
+			return -ENOMEM;
+		if (copy_from_user(ov, list.overlay_list,
+				list.num_overlays * sizeof(*ov))) {
+			ret = -EFAULT;
+			goto done;
+		}
+	}
+
+	if (list.data_list) {
+		data = kcalloc(list.num_overlays, sizeof(*data), GFP_KERNEL);
+		if (data == NULL) {
+			ret = -ENOMEM;
+			goto done;
+		}
+		if (copy_from_user(data, list.data_list,
+				list.num_overlays * sizeof(*data))) {
+			ret = -EFAULT;
+			goto done;
+		}
+	}
+
+	list.processed_overlays = 0;
+	for (i = 0; i < list.num_overlays; i++) {
+		if (ov) {
+			ret = mdp4_overlay_set(info, &ov[i]);
+			if (ret) {
+				pr_err("%s: set %d failed, rc=%d\n",
+					__func__, i, ret);
+				break;
+			}
+		}
+
+		if (data && mfd->overlay_play_enable) {
+			if (ov)
+				data[i].id = ov[i].id;
+
+			if (!started) {
+				ret = msmfb_overlay_play_start(info);
+				if (ret)
+					break;
+				started = 1;
+			}
+
+			ret = mdp4_overlay_play(info, &data[i]);
+			if (ret) {
+				pr_err("%s: play %d failed, rc=%d\n",
+					__func__, i, ret);
+				break;
+			}
+		}
+		list.processed_overlays++;
+	}
+
+	if (started)
+		msmfb_overlay_play_end(info);
+
+	if (!ret && list.buf_sync.rel_fen_fd)
+		ret = msmfb_handle_buf_sync_ioctl(mfd, &list.buf_sync);
+
+	if (!ret && (list.flags & MDP_OVERLAY_LIST_COMMIT_ASYNC))
+		msmfb_overlay_commit_async(mfd, mfd->panel_info.pdest);
+	else if (!ret && (list.flags & MDP_OVERLAY_LIST_COMMIT))
+		ret = mdp4_overlay_commit(info, mfd->panel_info.pdest);
+
+	/* hand the pipe ids back for the entries that were set */
+	if (ov && list.processed_overlays &&
+	    copy_to_user(list.overlay_list, ov,
+			list.processed_overlays * sizeof(*ov)))
+		ret = -EFAULT;
+
+	if (copy_to_user(argp, &list, sizeof(list)))
+		ret = -EFAULT;
+
+done:
+	kfree(data);
+	kfree(ov);
+	return ret;
+}
+
 static int msmfb_overlay_play_enable(struct fb_info *info, unsigned long *argp)
 {
 	int	ret, enable;
@@ -3420,6 +3593,194 @@ static int msmfb_mixer_info(struct fb_info *info, unsigned long *argp)
 DEFINE_SEMAPHORE(msm_fb_ioctl_ppp_sem);
 DEFINE_MUTEX(msm_fb_ioctl_lut_sem);
 
+/* Queued blit lists per fb, beyond this MSMFB_ASYNC_BLIT blocks */
+#define MSMFB_BLIT_QUEUE_MAX	8
+
+struct msmfb_blit_job {
+	struct list_head list;
+	struct fb_info *info;
+	int acq_fen_cnt;
+	struct sync_fence *acq_fen[MDP_MAX_FENCE_FD];
+	int count;
+	struct mdp_blit_req req[];
+};
+
+/*
+ * Runs the queued lists back to back, each one once its acquire fences
+ * have signaled, and moves the blit timeline on as each list finishes.
+ * A failed list still signals its fence so nobody waits forever on it.
+ */
+static void msmfb_async_blit_work(struct work_struct *work)
+{
+	struct msm_fb_data_type *mfd;
+	struct msmfb_blit_job *job;
+	int i, ret;
+
+	mfd = container_of(work, struct msm_fb_data_type, blit_work);
+
+	for (;;) {
+		mutex_lock(&mfd->blit_mutex);
+		if (list_empty(&mfd->blit_queue)) {
+			mutex_unlock(&mfd->blit_mutex);
+			break;
+		}
+		job = list_first_entry(&mfd->blit_queue, struct msmfb_blit_job,
+					list);
+		list_del(&job->list);
+		mutex_unlock(&mfd->blit_mutex);
+
+		ret = 0;
+		for (i = 0; i < job->acq_fen_cnt; i++) {
+			if (!ret)
+				ret = sync_fence_wait(job->acq_fen[i],
+						WAIT_FENCE_TIMEOUT);
+			sync_fence_put(job->acq_fen[i]);
+		}
+
+		if (ret) {
+			pr_err("%s: wait for fence failed, ret=%d\n",
+				__func__, ret);
+		} else {
+			down(&msm_fb_ioctl_ppp_sem);
+			ret = msmfb_blit_list(job->info, job->req, job->count);
+			up(&msm_fb_ioctl_ppp_sem);
+			if (ret)
+				pr_err("%s: blit failed, ret=%d\n",
+					__func__, ret);
+		}
+
+		mutex_lock(&mfd->blit_mutex);
+		sw_sync_timeline_inc(mfd->blit_timeline, 1);
+		mfd->blit_queued--;
+		mutex_unlock(&mfd->blit_mutex);
+		wake_up(&mfd->blit_wait);
+
+		kfree(job);
+	}
+}
+
+static void msmfb_async_blit_idle(struct msm_fb_data_type *mfd)
+{
+	wait_event(mfd->blit_wait, mfd->blit_queued == 0);
+}
+
+static int msmfb_async_blit(struct fb_info *info, void __user *p)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct mdp_async_blit_req_list req_list;
+	struct msmfb_blit_job *job;
+	struct sync_pt *rel_sync_pt;
+	struct sync_fence *rel_fence;
+	int acq_fen_fd[MDP_MAX_FENCE_FD];
+	int rel_fen_fd, i, ret;
+
+	if (bf_supported &&
+		(info->node == 1 || info->node == 2)) {
+		pr_err("%s: no pan display for fb%d.",
+		       __func__, info->node);
+		return -EPERM;
+	}
+
+	if (copy_from_user(&req_list, p, sizeof(req_list)))
+		return -EFAULT;
+
+	if (req_list.count == 0 || req_list.count >= MAX_BLIT_REQ ||
+		req_list.sync.acq_fen_fd_cnt > MDP_MAX_FENCE_FD)
+		return -EINVAL;
+
+	if (req_list.sync.acq_fen_fd_cnt &&
+		copy_from_user(acq_fen_fd, req_list.sync.acq_fen_fd,
+			req_list.sync.acq_fen_fd_cnt * sizeof(int)))
+		return -EFAULT;
+
+	job = kzalloc(sizeof(*job) + req_list.count * sizeof(job->req[0]),
+			GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	job->info = info;
+	job->count = req_list.count;
+	if (copy_from_user(job->req, p + sizeof(req_list),
+			req_list.count * sizeof(job->req[0]))) {
+		ret = -EFAULT;
+		goto err_free;
+	}
+
+	for (i = 0; i < req_list.sync.acq_fen_fd_cnt; i++) {
+		job->acq_fen[i] = sync_fence_fdget(acq_fen_fd[i]);
+		if (job->acq_fen[i] == NULL) {
+			pr_err("%s: null fence! i=%d fd=%d\n", __func__, i,
+				acq_fen_fd[i]);
+			ret = -EINVAL;
+			goto err_put;
+		}
+		job->acq_fen_cnt++;
+	}
+
+	ret = wait_event_interruptible(mfd->blit_wait,
+			mfd->blit_queued < MSMFB_BLIT_QUEUE_MAX);
+	if (ret)
+		goto err_put;
+
+	mutex_lock(&mfd->blit_mutex);
+	if (mfd->blit_timeline == NULL) {
+		mfd->blit_timeline = sw_sync_timeline_create("mdp-blit");
+		if (mfd->blit_timeline == NULL) {
+			pr_err("%s: cannot create time line", __func__);
+			ret = -ENOMEM;
+			goto err_unlock;
+		}
+		mfd->blit_timeline_value = 0;
+	}
+
+	rel_sync_pt = sw_sync_pt_create(mfd->blit_timeline,
+			mfd->blit_timeline_value + 1);
+	if (rel_sync_pt == NULL) {
+		pr_err("%s: cannot create sync point", __func__);
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+	rel_fence = sync_fence_create("mdp-blit-fence", rel_sync_pt);
+	if (rel_fence == NULL) {
+		sync_pt_free(rel_sync_pt);
+		pr_err("%s: cannot create fence", __func__);
+		ret = -ENOMEM;
+		goto err_unlock;
+	}
+	rel_fen_fd = get_unused_fd_flags(0);
+	if (rel_fen_fd < 0) {
+		ret = rel_fen_fd;
+		goto err_fence;
+	}
+	if (copy_to_user(req_list.sync.rel_fen_fd, &rel_fen_fd,
+			sizeof(int))) {
+		put_unused_fd(rel_fen_fd);
+		ret = -EFAULT;
+		goto err_fence;
+	}
+	sync_fence_install(rel_fence, rel_fen_fd);
+
+	mfd->blit_timeline_value++;
+	list_add_tail(&job->list, &mfd->blit_queue);
+	mfd->blit_queued++;
+	mutex_unlock(&mfd->blit_mutex);
+
+	schedule_work(&mfd->blit_work);
+
+	return 0;
+
+err_fence:
+	sync_fence_put(rel_fence);
+err_unlock:
+	mutex_unlock(&mfd->blit_mutex);
+err_put:
+	for (i = 0; i < job->acq_fen_cnt; i++)
+		sync_fence_put(job->acq_fen[i]);
+err_free:
+	kfree(job);
+	return ret;
+}
+
 /* Set color conversion matrix from user space */
 
 #ifndef CONFIG_FB_MSM_MDP40
@@ -3759,6 +4120,11 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 	case MSMFB_OVERLAY_PLAY:
 		ret = msmfb_overlay_play(info, argp);
 		break;
+	case MSMFB_OVERLAY_SET_LIST:
+		down(&msm_fb_ioctl_ppp_sem);
+		ret = msmfb_overlay_set_list(info, argp);
+		up(&msm_fb_ioctl_ppp_sem);
+		break;
 	case MSMFB_OVERLAY_PLAY_ENABLE:
 		ret = msmfb_overlay_play_enable(info, argp);
 		break;
@@ -3807,11 +4173,16 @@ static int msm_fb_ioctl(struct fb_info *info, unsigned int cmd,
 		up(&msm_fb_ioctl_ppp_sem);
 		break;
 	case MSMFB_BLIT:
+		/* keep the order with blits still in the queue */
+		msmfb_async_blit_idle(mfd);
 		down(&msm_fb_ioctl_ppp_sem);
 		ret = msmfb_blit(info, argp);
 		up(&msm_fb_ioctl_ppp_sem);
 
 		break;
+	case MSMFB_ASYNC_BLIT:
+		ret = msmfb_async_blit(info, argp);
+		break;
 
 	/* Ioctl for setting ccs matrix from user space */
 	case MSMFB_SET_CCS_MATRIX:
@@ -70,6 +70,8 @@ struct msmfb_writeback_data_list {
 };
 
 
+struct mdp_vsync_ring;
+
 struct msm_fb_data_type {
 	__u32 key;
 	__u32 index;
@@ -216,10 +218,19 @@ struct msm_fb_data_type {
 	struct mutex sync_mutex;
 	struct completion commit_comp;
 	u32 is_committing;
+	int commit_ov_mixer;
 	struct work_struct commit_work;
+	struct sw_sync_timeline *blit_timeline;
+	int blit_timeline_value;
+	struct list_head blit_queue;
+	int blit_queued;
+	struct mutex blit_mutex;
+	wait_queue_head_t blit_wait;
+	struct work_struct blit_work;
 	void *msm_fb_backup;
 	boolean panel_driver_on;
 	int vsync_sysfs_created;
+	struct mdp_vsync_ring *vsync_ring;
 };
 struct msm_fb_backup_type {
 	struct fb_info info;
@@ -135,6 +135,8 @@ struct mipi_panel_info {
 	char no_max_pkt_size;
 	/* Clock required during LP commands */
 	char force_clk_lane_hs;
+	/* Panel takes column/page address windows for partial updates */
+	char partial_update;
 #ifdef CONFIG_FB_MSM_MIPI_DSI_MOT
 	struct mutex panel_mutex;
 #endif
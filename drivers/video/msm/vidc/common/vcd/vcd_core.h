@@ -37,6 +37,9 @@
 
 #define VCD_TIMESTAMP_RESOLUTION             1000000
 #define VCD_DEC_INITIAL_FRAME_RATE           30
+#define VCD_DEC_MAX_FRAME_RATE               240
+#define VCD_DEC_FPS_WINDOW                   32
+#define VCD_DEC_FPS_HYSTERESIS               10
 
 #define VCD_FIRST_IP_RCVD                    0x00000004
 #define VCD_FIRST_OP_RCVD                    0x00000008
@@ -158,6 +161,9 @@ struct vcd_clnt_status {
 	s64 first_ts;
 	s64 prev_ts;
 	u64 time_elapsed;
+	u32 fps_frm_cnt;
+	s64 fps_min_ts;
+	s64 fps_max_ts;
 	struct vcd_frame_data eos_trig_ip_frm;
 	struct ddl_frame_data_tag eos_prev_op_frm;
 	u32 eos_prev_op_frm_status;
@@ -171,8 +177,8 @@ struct vcd_sched_clnt_ctx {
 	u32 clnt_active;
 	void *clnt_data;
 	u32 tkns;
-	u32 round_perfrm;
-	u32 rounds;
+	u32 frm_period;
+	u64 deadline;
 	struct list_head ip_frm_list;
 };
 
@@ -11,6 +11,7 @@
  *
  */
 
+#include <linux/math64.h>
 #include <media/msm/vidc_type.h>
 #include "vcd_power_sm.h"
 #include "vcd_core.h"
@@ -304,8 +305,8 @@ u32 vcd_update_clnt_perf_lvl(
 	u32 rc = VCD_S_SUCCESS;
 	struct vcd_dev_ctxt *dev_ctxt = cctxt->dev_ctxt;
 	u32 new_perf_lvl;
-	new_perf_lvl = frm_p_units *\
-		(fps->fps_numerator / fps->fps_denominator);
+	new_perf_lvl = (u32)div_u64((u64)frm_p_units * fps->fps_numerator,
+		fps->fps_denominator);
 	if (cctxt->status.req_perf_lvl) {
 		dev_ctxt->reqd_perf_lvl =
 		    dev_ctxt->reqd_perf_lvl - cctxt->reqd_perf_lvl +
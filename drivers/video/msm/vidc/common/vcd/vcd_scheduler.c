@@ -11,19 +11,28 @@
  *
  */
 
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <media/msm/vidc_type.h>
 #include "vcd.h"
 
-#define NORMALIZATION_FACTOR 3600
-#define ADJUST_CLIENT_ROUNDS(client, round_adjustment) \
-do {\
-	if ((client)->rounds < round_adjustment) {\
-		(client)->rounds = 0;\
-		VCD_MSG_HIGH("%s(): WARNING: Scheduler list unsorted",\
-			__func__);\
-	} else\
-		(client)->rounds -= round_adjustment;\
-} while (0)
+/*
+ * Clients are served earliest deadline first. Every client owes the core
+ * one frame per frame period, the deadline of its next frame moves on by
+ * one period each time a frame is handed to the core. A client that sat
+ * idle for more than a period starts over one period from now rather
+ * than claiming the frames it never sent. Live sessions (camera encode,
+ * WFD, video calls) go ahead of everyone else, they can't buffer their
+ * way out of a late frame.
+ */
+#define VCD_SCHED_FRM_PERIOD(frm_rate) \
+	(u32)div_u64((u64)USEC_PER_SEC * (frm_rate).fps_denominator, \
+		(frm_rate).fps_numerator)
+
+static u64 vcd_sched_now(void)
+{
+	return ktime_to_us(ktime_get());
+}
 
 u32 vcd_sched_create(struct list_head *sched_list)
 {
@@ -50,17 +59,8 @@ void vcd_sched_destroy(struct list_head *sched_clnt_list)
 void insert_client_in_list(struct list_head *sched_clnt_list,
 	struct vcd_sched_clnt_ctx *sched_new_clnt, bool tail)
 {
-	struct vcd_sched_clnt_ctx *sched_clnt;
-	if (!list_empty(sched_clnt_list)) {
-		if (tail)
-			sched_clnt = list_entry(sched_clnt_list->prev,
-				struct vcd_sched_clnt_ctx, list);
-		else
-			sched_clnt = list_first_entry(sched_clnt_list,
-				struct vcd_sched_clnt_ctx, list);
-		sched_new_clnt->rounds = sched_clnt->rounds;
-	} else
-		sched_new_clnt->rounds = 0;
+	/* the deadline is set once the client has something to run */
+	sched_new_clnt->deadline = 0;
 	if (tail)
 		list_add_tail(&sched_new_clnt->list, sched_clnt_list);
 	else
@@ -111,9 +111,8 @@ u32 vcd_sched_add_client(struct vcd_clnt_ctxt *cctxt)
 			memset(sched_cctxt, 0,
 				sizeof(struct vcd_sched_clnt_ctx));
 			sched_cctxt->tkns = 0;
-			sched_cctxt->round_perfrm = NORMALIZATION_FACTOR *
-				cctxt->frm_rate.fps_denominator /
-				cctxt->frm_rate.fps_numerator;
+			sched_cctxt->frm_period =
+				VCD_SCHED_FRM_PERIOD(cctxt->frm_rate);
 			sched_cctxt->clnt_active = true;
 			sched_cctxt->clnt_data = cctxt;
 			INIT_LIST_HEAD(&sched_cctxt->ip_frm_list);
@@ -153,16 +152,9 @@ u32 vcd_sched_update_config(struct vcd_clnt_ctxt *cctxt)
 	if (!cctxt || !cctxt->sched_clnt_hdl) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
-	} else {
-		cctxt->sched_clnt_hdl->rounds /=
-			cctxt->sched_clnt_hdl->round_perfrm;
-		cctxt->sched_clnt_hdl->round_perfrm =
-			NORMALIZATION_FACTOR *
-			cctxt->frm_rate.fps_denominator /
-			cctxt->frm_rate.fps_numerator;
-		cctxt->sched_clnt_hdl->rounds *=
-			cctxt->sched_clnt_hdl->round_perfrm;
-	}
+	} else
+		cctxt->sched_clnt_hdl->frm_period =
+			VCD_SCHED_FRM_PERIOD(cctxt->frm_rate);
 	return rc;
 }
 
@@ -242,44 +234,49 @@ u32 vcd_sched_suspend_resume_clnt(
 	return rc;
 }
 
+/* Returns true if a should run before b */
+static bool vcd_sched_before(struct vcd_sched_clnt_ctx *a,
+	struct vcd_sched_clnt_ctx *b)
+{
+	u32 a_live = ((struct vcd_clnt_ctxt *)a->clnt_data)->live;
+	u32 b_live = ((struct vcd_clnt_ctxt *)b->clnt_data)->live;
+
+	if (a_live != b_live)
+		return a_live;
+	return a->deadline < b->deadline;
+}
+
 u32 vcd_sched_get_client_frame(struct list_head *sched_clnt_list,
 	struct vcd_clnt_ctxt **cctxt,
 	struct vcd_buffer_entry **buffer)
 {
-	u32 rc = VCD_ERR_QEMPTY, round_adjustment = 0;
-	struct vcd_sched_clnt_ctx *sched_clnt, *clnt_nxt;
+	u32 rc = VCD_ERR_QEMPTY;
+	struct vcd_sched_clnt_ctx *sched_clnt, *best = NULL;
+	u64 now;
 	if (!sched_clnt_list || !cctxt || !buffer) {
 		VCD_MSG_ERROR("%s(): Invalid parameter", __func__);
 		rc = VCD_ERR_ILLEGAL_PARM;
 	} else if (!list_empty(sched_clnt_list)) {
 		*cctxt = NULL;
 		*buffer = NULL;
-		list_for_each_entry_safe(sched_clnt,
-			clnt_nxt, sched_clnt_list, list) {
-			if (&sched_clnt->list == sched_clnt_list->next)
-				round_adjustment = sched_clnt->rounds;
-			if (*cctxt) {
-				if ((*cctxt)->sched_clnt_hdl->rounds >=
-					sched_clnt->rounds)
-					list_move(&(*cctxt)->sched_clnt_hdl\
-						->list, &sched_clnt->list);
-				ADJUST_CLIENT_ROUNDS(sched_clnt,
-					round_adjustment);
-			} else if (sched_clnt->tkns &&
-				!list_empty(&sched_clnt->ip_frm_list)) {
-				*cctxt = sched_clnt->clnt_data;
-				sched_clnt->rounds += sched_clnt->round_perfrm;
-			} else
-				ADJUST_CLIENT_ROUNDS(sched_clnt,
-						round_adjustment);
+		now = vcd_sched_now();
+		list_for_each_entry(sched_clnt, sched_clnt_list, list) {
+			if (!sched_clnt->tkns ||
+				list_empty(&sched_clnt->ip_frm_list))
+				continue;
+			if (!sched_clnt->deadline || sched_clnt->deadline +
+				sched_clnt->frm_period < now)
+				sched_clnt->deadline = now +
+					sched_clnt->frm_period;
+			if (!best || vcd_sched_before(sched_clnt, best))
+				best = sched_clnt;
 		}
-		if (*cctxt) {
-			rc = vcd_sched_dequeue_buffer(
-				(*cctxt)->sched_clnt_hdl, buffer);
+		if (best) {
+			rc = vcd_sched_dequeue_buffer(best, buffer);
 			if (rc == VCD_S_SUCCESS) {
-				(*cctxt)->sched_clnt_hdl->tkns--;
-				ADJUST_CLIENT_ROUNDS((*cctxt)->\
-					sched_clnt_hdl, round_adjustment);
+				*cctxt = best->clnt_data;
+				best->tkns--;
+				best->deadline += best->frm_period;
 			}
 		}
 	}
@@ -12,6 +12,7 @@
  */
 #include <linux/memory_alloc.h>
 #include <mach/msm_subsystem_map.h>
+#include <linux/math64.h>
 #include <asm/div64.h>
 #include <media/msm/vidc_type.h>
 #include "vcd.h"
@@ -1078,6 +1079,9 @@ u32 vcd_flush_buffers(struct vcd_clnt_ctxt *cctxt, u32 mode)
 	}
 
 	VCD_MSG_MED("Flush mode %d requested", mode);
+	/* a seek makes the time stamps jump, start a new window */
+	if (mode & VCD_FLUSH_INPUT)
+		cctxt->status.fps_frm_cnt = 0;
 	if ((mode & VCD_FLUSH_INPUT) &&
 		cctxt->sched_clnt_hdl) {
 
@@ -1528,6 +1532,65 @@ void vcd_try_submit_frame(struct vcd_dev_ctxt *dev_ctxt)
 	}
 }
 
+/*
+ * Decoders start out assuming VCD_DEC_INITIAL_FRAME_RATE. Work out the
+ * real rate from the time stamps of each window of input frames so the
+ * clock and bus votes follow the macroblocks per second the stream
+ * actually needs. Input comes in decode order, so the window is measured
+ * from its smallest to its largest time stamp. Small changes are ignored
+ * to keep the clock from bouncing between levels.
+ */
+static void vcd_dec_update_frame_rate(struct vcd_clnt_ctxt *cctxt,
+	struct vcd_frame_data *frame)
+{
+	struct vcd_clnt_status *status = &cctxt->status;
+	struct vcd_property_frame_rate fps;
+	u32 new_perf_lvl, delta;
+	s64 span;
+
+	if (cctxt->perf_set_by_client || !frame->data_len ||
+		(frame->flags & VCD_FRAME_FLAG_CODECCONFIG))
+		return;
+
+	if (!status->fps_frm_cnt++) {
+		status->fps_min_ts = frame->time_stamp;
+		status->fps_max_ts = frame->time_stamp;
+		return;
+	}
+	if (frame->time_stamp < status->fps_min_ts)
+		status->fps_min_ts = frame->time_stamp;
+	if (frame->time_stamp > status->fps_max_ts)
+		status->fps_max_ts = frame->time_stamp;
+	if (status->fps_frm_cnt < VCD_DEC_FPS_WINDOW)
+		return;
+
+	span = status->fps_max_ts - status->fps_min_ts;
+	status->fps_frm_cnt = 0;
+
+	/* in milli frames per second against a millisecond span */
+	fps.fps_numerator = (VCD_DEC_FPS_WINDOW - 1) * 1000;
+	fps.fps_denominator = (u32)div_u64((u64)span, VCD_TIMESTAMP_RESOLUTION /
+		1000);
+	if (!fps.fps_denominator || fps.fps_numerator / fps.fps_denominator
+		>= VCD_DEC_MAX_FRAME_RATE) {
+		VCD_MSG_LOW("%s(): No usable time stamps", __func__);
+		return;
+	}
+
+	new_perf_lvl = (u32)div_u64((u64)cctxt->frm_p_units *
+		fps.fps_numerator, fps.fps_denominator);
+	delta = new_perf_lvl > cctxt->reqd_perf_lvl ?
+		new_perf_lvl - cctxt->reqd_perf_lvl :
+		cctxt->reqd_perf_lvl - new_perf_lvl;
+	if (delta * 100 <= cctxt->reqd_perf_lvl * VCD_DEC_FPS_HYSTERESIS)
+		return;
+
+	VCD_MSG_MED("%s(): Frame rate %u/%u, perf level %u -> %u",
+		__func__, fps.fps_numerator, fps.fps_denominator,
+		cctxt->reqd_perf_lvl, new_perf_lvl);
+	(void)vcd_set_frame_rate(cctxt, &fps);
+}
+
 u32 vcd_submit_frame(struct vcd_dev_ctxt *dev_ctxt,
 					 struct vcd_transc *transc)
 {
@@ -1552,6 +1615,7 @@ u32 vcd_submit_frame(struct vcd_dev_ctxt *dev_ctxt,
 	memset(&ddl_ip_frm, 0, sizeof(ddl_ip_frm));
 	if (cctxt->decoding) {
 		evcode = CLIENT_STATE_EVENT_NUMBER(decode_frame);
+		vcd_dec_update_frame_rate(cctxt, ip_frm_entry);
 		ddl_ip_frm.vcd_frm = *ip_frm_entry;
 		rc = ddl_decode_frame(cctxt->ddl_handle, &ddl_ip_frm,
 							(void *) transc);
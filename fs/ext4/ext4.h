@@ -917,6 +917,9 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DISCARD		0x40000000 /* Issue DISCARD requests */
 #define EXT4_MOUNT_INIT_INODE_TABLE	0x80000000 /* Initialize uninitialized itables */
 
+#define EXT4_MOUNT2_DATA_FSYNC		0x00000001 /* fsync only waits for
+						     * block and size changes */
+
 #define clear_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt &= \
 						~EXT4_MOUNT_##opt
 #define set_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt |= \
@@ -1215,6 +1218,12 @@ struct ext4_sb_info {
 
 	/* Kernel thread for multiple mount protection */
 	struct task_struct *s_mmp_tsk;
+
+	/* Flash profile: erase unit and periodic FITRIM of free space */
+	struct super_block *s_sb;
+	unsigned int s_flash_au_kb;
+	unsigned int s_bg_trim_interval;	/* seconds, 0 is off */
+	struct delayed_work s_bg_trim_work;
 };
 
 static inline struct ext4_sb_info *EXT4_SB(struct super_block *sb)
@@ -1613,6 +1622,15 @@ void ext4_get_group_no_and_offset(struct super_block *sb, ext4_fsblk_t blocknr,
  */
 #define EXT4_DEF_LI_WAIT_MULT			10
 #define EXT4_DEF_LI_MAX_START_DELAY		5
+
+/*
+ * Defaults of the flash mount option: fewer, larger journal commits,
+ * allocations aligned to a 4MB eMMC allocation unit, and free space
+ * discarded once an hour instead of on every block free.
+ */
+#define EXT4_FLASH_COMMIT_INTERVAL		30
+#define EXT4_FLASH_DEF_AU_KB			4096
+#define EXT4_FLASH_DEF_BG_TRIM			3600
 #define EXT4_LAZYINIT_QUIT			0x0001
 #define EXT4_LAZYINIT_RUNNING			0x0002
 
@@ -211,7 +211,15 @@ int ext4_sync_file(struct file *file, int datasync)
 		goto out;
 	}
 
-	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
+	/*
+	 * With data_fsync, fsync() is fdatasync(): a transaction carrying
+	 * nothing but timestamp updates is not waited for, so rewriting
+	 * allocated blocks costs a data write and a cache flush.
+	 */
+	if (datasync || test_opt2(inode->i_sb, DATA_FSYNC))
+		commit_tid = ei->i_datasync_tid;
+	else
+		commit_tid = ei->i_sync_tid;
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
 		needs_barrier = true;
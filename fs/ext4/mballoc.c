@@ -2472,6 +2472,10 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	/* Keep locality group preallocations a whole number of stripes */
+	if (sbi->s_stripe > 1)
+		sbi->s_mb_group_prealloc = roundup(sbi->s_mb_group_prealloc,
+						   sbi->s_stripe);
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
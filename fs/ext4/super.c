@@ -756,6 +756,7 @@ static void ext4_put_super(struct super_block *sb)
 	int i, err;
 
 	ext4_unregister_li_request(sb);
+	cancel_delayed_work_sync(&sbi->s_bg_trim_work);
 	dquot_disable(sb, -1, DQUOT_USAGE_ENABLED | DQUOT_LIMITS_ENABLED);
 
 	flush_workqueue(sbi->dio_unwritten_wq);
@@ -1119,6 +1120,13 @@ static int ext4_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_printf(seq, ",init_itable=%u",
 			   (unsigned) sbi->s_li_wait_mult);
 
+	if (sbi->s_flash_au_kb)
+		seq_printf(seq, ",flash_au=%u", sbi->s_flash_au_kb);
+	if (sbi->s_bg_trim_interval)
+		seq_printf(seq, ",bg_trim=%u", sbi->s_bg_trim_interval);
+	if (test_opt2(sb, DATA_FSYNC))
+		seq_puts(seq, ",data_fsync");
+
 	ext4_show_quota_options(seq, sb);
 
 	return 0;
@@ -1293,6 +1301,7 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_flash, Opt_flash_au, Opt_bg_trim, Opt_data_fsync, Opt_nodata_fsync,
 };
 
 static const match_table_t tokens = {
@@ -1368,6 +1377,11 @@ static const match_table_t tokens = {
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
+	{Opt_flash, "flash"},
+	{Opt_flash_au, "flash_au=%u"},
+	{Opt_bg_trim, "bg_trim=%u"},
+	{Opt_data_fsync, "data_fsync"},
+	{Opt_nodata_fsync, "nodata_fsync"},
 	{Opt_err, NULL},
 };
 
@@ -1858,6 +1872,33 @@ set_qf_format:
 		case Opt_noinit_itable:
 			clear_opt(sb, INIT_INODE_TABLE);
 			break;
+		case Opt_flash:
+			/* Options following it override the profile */
+			sbi->s_commit_interval = HZ * EXT4_FLASH_COMMIT_INTERVAL;
+			clear_opt(sb, DISCARD);
+			sbi->s_flash_au_kb = EXT4_FLASH_DEF_AU_KB;
+			sbi->s_bg_trim_interval = EXT4_FLASH_DEF_BG_TRIM;
+			break;
+		case Opt_flash_au:
+			if (match_int(&args[0], &option))
+				return 0;
+			if (option < 0)
+				return 0;
+			sbi->s_flash_au_kb = option;
+			break;
+		case Opt_bg_trim:
+			if (match_int(&args[0], &option))
+				return 0;
+			if (option < 0)
+				return 0;
+			sbi->s_bg_trim_interval = option;
+			break;
+		case Opt_data_fsync:
+			set_opt2(sb, DATA_FSYNC);
+			break;
+		case Opt_nodata_fsync:
+			clear_opt2(sb, DATA_FSYNC);
+			break;
 		default:
 			ext4_msg(sb, KERN_ERR,
 			       "Unrecognized mount option \"%s\" "
@@ -2700,6 +2741,58 @@ static void print_daily_error_info(unsigned long arg)
 	mod_timer(&sbi->s_err_report, jiffies + 24*60*60*HZ);  /* Once a day */
 }
 
+/*
+ * Discard the free space of the filesystem in one batch, the way FITRIM
+ * does, instead of discarding each extent as it is freed: online discard
+ * is synchronous on eMMC and stalls the writes queued behind it.
+ */
+static void ext4_bg_trim_work(struct work_struct *work)
+{
+	struct ext4_sb_info *sbi = container_of(to_delayed_work(work),
+						struct ext4_sb_info,
+						s_bg_trim_work);
+	struct super_block *sb = sbi->s_sb;
+	struct request_queue *q = bdev_get_queue(sb->s_bdev);
+	struct fstrim_range range;
+	int ret;
+
+	if (!sbi->s_bg_trim_interval || (sb->s_flags & MS_RDONLY))
+		return;
+
+	if (sb->s_frozen == SB_UNFROZEN) {
+		range.start = 0;
+		range.len = ULLONG_MAX;
+		range.minlen = max_t(u64, q->limits.discard_granularity,
+				     sb->s_blocksize);
+		ret = ext4_trim_fs(sb, &range);
+		if (ret < 0)
+			ext4_msg(sb, KERN_WARNING,
+				 "background trim failed: %d", ret);
+		else
+			ext4_debug("trimmed %llu bytes\n", range.len);
+	}
+	queue_delayed_work(system_long_wq, &sbi->s_bg_trim_work,
+			   sbi->s_bg_trim_interval * HZ);
+}
+
+static void ext4_bg_trim_schedule(struct super_block *sb)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct request_queue *q = bdev_get_queue(sb->s_bdev);
+
+	cancel_delayed_work(&sbi->s_bg_trim_work);
+	if (!sbi->s_bg_trim_interval || (sb->s_flags & MS_RDONLY))
+		return;
+	if (!blk_queue_discard(q)) {
+		ext4_msg(sb, KERN_WARNING,
+			 "bg_trim disabled, device does not support discard");
+		sbi->s_bg_trim_interval = 0;
+		return;
+	}
+	queue_delayed_work(system_long_wq, &sbi->s_bg_trim_work,
+			   sbi->s_bg_trim_interval * HZ);
+}
+
 /* Find next suitable group and run ext4_init_inode_table */
 static int ext4_run_li_request(struct ext4_li_request *elr)
 {
@@ -3075,6 +3168,8 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		goto out_free_orig;
 	}
 	sb->s_fs_info = sbi;
+	sbi->s_sb = sb;
+	INIT_DELAYED_WORK(&sbi->s_bg_trim_work, ext4_bg_trim_work);
 	sbi->s_mount_opt = 0;
 	sbi->s_resuid = EXT4_DEF_RESUID;
 	sbi->s_resgid = EXT4_DEF_RESGID;
@@ -3469,6 +3564,13 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	}
 
 	sbi->s_stripe = ext4_get_stripe_size(sbi);
+	if (!sbi->s_stripe && sbi->s_flash_au_kb) {
+		unsigned long au = (sbi->s_flash_au_kb << 10) >>
+				   sb->s_blocksize_bits;
+
+		if (au > 1 && au <= sbi->s_blocks_per_group)
+			sbi->s_stripe = au;
+	}
 	sbi->s_max_writeback_mb_bump = 128;
 
 	/*
@@ -3718,6 +3820,8 @@ no_journal:
 	if (es->s_error_count)
 		mod_timer(&sbi->s_err_report, jiffies + 300*HZ); /* 5 minutes */
 
+	ext4_bg_trim_schedule(sb);
+
 	kfree(orig_data);
 	return 0;
 
@@ -4435,6 +4539,8 @@ static int ext4_remount(struct super_block *sb, int *flags, char *data)
 		ext4_register_li_request(sb, first_not_zeroed);
 	}
 
+	ext4_bg_trim_schedule(sb);
+
 	ext4_setup_system_zone(sb);
 	if (sbi->s_journal == NULL)
 		ext4_commit_super(sb, 1);
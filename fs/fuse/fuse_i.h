@@ -23,8 +23,13 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-/** Max number of pages that can be used in a single read request */
-#define FUSE_MAX_PAGES_PER_REQ 32
+/**
+ * Max number of pages that can be used in a single request.  Reads and
+ * writes are further limited by the max_read and max_write the
+ * filesystem negotiated, so daemons that limit them to 128K are not
+ * handed larger requests.
+ */
+#define FUSE_MAX_PAGES_PER_REQ 128
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
@@ -465,6 +465,8 @@ static void evict(struct inode *inode)
 	inode_wb_list_del(inode);
 	inode_sb_list_del(inode);
 
+	readahead_record_forget(&inode->i_data);
+
 	if (op->evict_inode) {
 		op->evict_inode(inode);
 	} else {
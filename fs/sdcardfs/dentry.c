@@ -0,0 +1,59 @@
+/*
+ * sdcardfs dentry operations
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/slab.h>
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_dentry_cachep;
+
+/*
+ * The lower directory can still be changed directly, bypassing us: drop
+ * our dentry when the lower one went away or became positive or negative
+ * behind our back.
+ */
+static int sdcardfs_d_revalidate(struct dentry *dentry, struct nameidata *nd)
+{
+	struct dentry *lower_dentry;
+
+	if (nd && nd->flags & LOOKUP_RCU)
+		return -ECHILD;
+
+	lower_dentry = sdcardfs_lower_dentry(dentry);
+	if (d_unhashed(lower_dentry))
+		return 0;
+	if (!dentry->d_inode != !lower_dentry->d_inode)
+		return 0;
+	if (dentry->d_inode &&
+	    sdcardfs_lower_inode(dentry->d_inode) != lower_dentry->d_inode)
+		return 0;
+	if (lower_dentry->d_op && lower_dentry->d_op->d_revalidate)
+		return lower_dentry->d_op->d_revalidate(lower_dentry, NULL);
+	return 1;
+}
+
+static void sdcardfs_d_release(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *info = SDCARDFS_D(dentry);
+
+	if (!info)
+		return;
+	path_put(&info->lower_path);
+	kmem_cache_free(sdcardfs_dentry_cachep, info);
+}
+
+const struct dentry_operations sdcardfs_dops = {
+	.d_revalidate	= sdcardfs_d_revalidate,
+	.d_release	= sdcardfs_d_release,
+};
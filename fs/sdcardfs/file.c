@@ -0,0 +1,169 @@
+/*
+ * sdcardfs file operations
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/file.h>
+#include <linux/mm.h>
+#include "sdcardfs.h"
+
+/*
+ * Every open file has an open file of the lower filesystem behind it, and
+ * I/O goes straight to it: the data is only cached once, in the lower
+ * page cache.
+ */
+static int sdcardfs_open(struct inode *inode, struct file *file)
+{
+	const struct cred *cred = SDCARDFS_SB(inode->i_sb)->lower_cred;
+	struct file *lower_file;
+	struct path lower_path;
+
+	sdcardfs_get_lower_path(file->f_path.dentry, &lower_path);
+	/* dentry_open() drops the references when it fails */
+	lower_file = dentry_open(lower_path.dentry, lower_path.mnt,
+				 file->f_flags & ~(O_CREAT | O_EXCL | O_TRUNC),
+				 cred);
+	if (IS_ERR(lower_file))
+		return PTR_ERR(lower_file);
+
+	file->private_data = lower_file;
+	return 0;
+}
+
+static int sdcardfs_release(struct inode *inode, struct file *file)
+{
+	fput(sdcardfs_lower_file(file));
+	return 0;
+}
+
+static int sdcardfs_flush(struct file *file, fl_owner_t id)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (lower_file->f_op && lower_file->f_op->flush)
+		return lower_file->f_op->flush(lower_file, id);
+	return 0;
+}
+
+static ssize_t sdcardfs_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	ssize_t ret;
+
+	ret = vfs_read(lower_file, buf, count, ppos);
+	if (ret >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return ret;
+}
+
+static ssize_t sdcardfs_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	ssize_t ret;
+
+	ret = vfs_write(lower_file, buf, count, ppos);
+	if (ret >= 0) {
+		struct inode *lower_inode = lower_file->f_path.dentry->d_inode;
+
+		fsstack_copy_inode_size(inode, lower_inode);
+		fsstack_copy_attr_times(inode, lower_inode);
+	}
+	return ret;
+}
+
+static loff_t sdcardfs_llseek(struct file *file, loff_t offset, int origin)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+
+	/* SEEK_END is relative to the size the lower file has now */
+	fsstack_copy_inode_size(inode, sdcardfs_lower_inode(inode));
+	return generic_file_llseek(file, offset, origin);
+}
+
+static int sdcardfs_readdir(struct file *file, void *dirent, filldir_t filldir)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	int err;
+
+	lower_file->f_pos = file->f_pos;
+	err = vfs_readdir(lower_file, filldir, dirent);
+	file->f_pos = lower_file->f_pos;
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static long sdcardfs_unlocked_ioctl(struct file *file, unsigned int cmd,
+				    unsigned long arg)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (!lower_file->f_op || !lower_file->f_op->unlocked_ioctl)
+		return -ENOTTY;
+	return lower_file->f_op->unlocked_ioctl(lower_file, cmd, arg);
+}
+
+/*
+ * The mapping is handed to the lower file, so faults and writeback work on
+ * the lower page cache and stay coherent with read() and write().
+ */
+static int sdcardfs_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	int err;
+
+	if (!lower_file->f_op || !lower_file->f_op->mmap)
+		return -ENODEV;
+
+	err = lower_file->f_op->mmap(lower_file, vma);
+	if (err)
+		return err;
+
+	/* mmap_region() took a reference on file for the vma */
+	get_file(lower_file);
+	vma->vm_file = lower_file;
+	fput(file);
+	return 0;
+}
+
+static int sdcardfs_fsync(struct file *file, int datasync)
+{
+	return vfs_fsync(sdcardfs_lower_file(file), datasync);
+}
+
+const struct file_operations sdcardfs_main_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= sdcardfs_read,
+	.write		= sdcardfs_write,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+	.mmap		= sdcardfs_mmap,
+	.open		= sdcardfs_open,
+	.flush		= sdcardfs_flush,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+};
+
+const struct file_operations sdcardfs_dir_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= generic_read_dir,
+	.readdir	= sdcardfs_readdir,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+	.open		= sdcardfs_open,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+};
@@ -0,0 +1,381 @@
+/*
+ * sdcardfs inode and directory operations
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/slab.h>
+#include <linux/dcache.h>
+#include "sdcardfs.h"
+
+static struct dentry *lock_parent(struct dentry *dentry)
+{
+	struct dentry *dir;
+
+	dir = dget_parent(dentry);
+	mutex_lock_nested(&(dir->d_inode->i_mutex), I_MUTEX_PARENT);
+	return dir;
+}
+
+static void unlock_dir(struct dentry *dir)
+{
+	mutex_unlock(&dir->d_inode->i_mutex);
+	dput(dir);
+}
+
+/*
+ * The lower attributes except for ownership and permissions, which are
+ * derived from the mount options: the storage has no notion of owners.
+ */
+void sdcardfs_copy_attrs(struct inode *inode, const struct inode *lower_inode)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(inode->i_sb);
+	umode_t perm = S_ISDIR(lower_inode->i_mode) ? 0777 : 0666;
+
+	fsstack_copy_attr_all(inode, lower_inode);
+	inode->i_uid = sbi->uid;
+	inode->i_gid = sbi->gid;
+	inode->i_mode = (lower_inode->i_mode & S_IFMT) | (perm & ~sbi->mask);
+}
+
+static int sdcardfs_inode_test(struct inode *inode, void *lower_inode)
+{
+	return sdcardfs_lower_inode(inode) == lower_inode;
+}
+
+static int sdcardfs_inode_set(struct inode *inode, void *lower_inode)
+{
+	SDCARDFS_I(inode)->lower_inode = lower_inode;
+	return 0;
+}
+
+struct inode *sdcardfs_iget(struct super_block *sb, struct inode *lower_inode)
+{
+	struct inode *inode;
+
+	if (lower_inode->i_sb != SDCARDFS_SB(sb)->lower_sb)
+		return ERR_PTR(-EXDEV);
+	if (!igrab(lower_inode))
+		return ERR_PTR(-ESTALE);
+
+	inode = iget5_locked(sb, (unsigned long)lower_inode,
+			     sdcardfs_inode_test, sdcardfs_inode_set,
+			     lower_inode);
+	if (!inode) {
+		iput(lower_inode);
+		return ERR_PTR(-ENOMEM);
+	}
+	if (!(inode->i_state & I_NEW)) {
+		iput(lower_inode);
+		return inode;
+	}
+
+	inode->i_ino = lower_inode->i_ino;
+	inode->i_version++;
+	sdcardfs_copy_attrs(inode, lower_inode);
+	fsstack_copy_inode_size(inode, lower_inode);
+
+	if (S_ISDIR(inode->i_mode)) {
+		inode->i_op = &sdcardfs_dir_iops;
+		inode->i_fop = &sdcardfs_dir_fops;
+	} else if (S_ISREG(inode->i_mode)) {
+		inode->i_op = &sdcardfs_main_iops;
+		inode->i_fop = &sdcardfs_main_fops;
+	} else {
+		/* FAT has no such files, they are only shown */
+		inode->i_op = &sdcardfs_main_iops;
+		init_special_inode(inode, inode->i_mode, inode->i_rdev);
+	}
+
+	unlock_new_inode(inode);
+	return inode;
+}
+
+static int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
+			      struct path *lower_path)
+{
+	struct sdcardfs_dentry_info *info;
+	struct inode *inode = NULL;
+
+	if (lower_path->dentry->d_inode) {
+		inode = sdcardfs_iget(sb, lower_path->dentry->d_inode);
+		if (IS_ERR(inode))
+			return PTR_ERR(inode);
+	}
+
+	info = kmem_cache_alloc(sdcardfs_dentry_cachep, GFP_KERNEL);
+	if (!info) {
+		iput(inode);
+		return -ENOMEM;
+	}
+	info->lower_path = *lower_path;
+	dentry->d_fsdata = info;
+	d_add(dentry, inode);
+	return 0;
+}
+
+static struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
+				      struct nameidata *nd)
+{
+	const struct cred *old_cred;
+	struct path lower_parent, lower_path;
+	struct dentry *lower_dentry;
+	int err;
+
+	sdcardfs_get_lower_path(dentry->d_parent, &lower_parent);
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+
+	mutex_lock(&lower_parent.dentry->d_inode->i_mutex);
+	lower_dentry = lookup_one_len(dentry->d_name.name, lower_parent.dentry,
+				      dentry->d_name.len);
+	mutex_unlock(&lower_parent.dentry->d_inode->i_mutex);
+	if (IS_ERR(lower_dentry)) {
+		err = PTR_ERR(lower_dentry);
+		goto out;
+	}
+
+	lower_path.dentry = lower_dentry;
+	lower_path.mnt = mntget(lower_parent.mnt);
+	err = sdcardfs_interpose(dentry, dir->i_sb, &lower_path);
+	if (err)
+		path_put(&lower_path);
+	else
+		fsstack_copy_attr_atime(dir, lower_parent.dentry->d_inode);
+out:
+	revert_creds(old_cred);
+	path_put(&lower_parent);
+	return ERR_PTR(err);
+}
+
+/* Makes the new lower entry of @dentry visible */
+static int sdcardfs_instantiate(struct dentry *dentry, struct inode *dir,
+				struct dentry *lower_dir_dentry)
+{
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct inode *inode;
+
+	inode = sdcardfs_iget(dir->i_sb, lower_dentry->d_inode);
+	if (IS_ERR(inode))
+		return PTR_ERR(inode);
+	d_instantiate(dentry, inode);
+	fsstack_copy_attr_times(dir, lower_dir_dentry->d_inode);
+	fsstack_copy_inode_size(dir, lower_dir_dentry->d_inode);
+	dir->i_nlink = lower_dir_dentry->d_inode->i_nlink;
+	return 0;
+}
+
+static int sdcardfs_create(struct inode *dir, struct dentry *dentry, int mode,
+			   struct nameidata *nd)
+{
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct dentry *lower_dir_dentry;
+	const struct cred *old_cred;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir_dentry = lock_parent(lower_dentry);
+	err = vfs_create(lower_dir_dentry->d_inode, lower_dentry,
+			 S_IFREG | SDCARDFS_LOWER_FILE_MODE, NULL);
+	if (!err)
+		err = sdcardfs_instantiate(dentry, dir, lower_dir_dentry);
+	unlock_dir(lower_dir_dentry);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_mkdir(struct inode *dir, struct dentry *dentry, int mode)
+{
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct dentry *lower_dir_dentry;
+	const struct cred *old_cred;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	lower_dir_dentry = lock_parent(lower_dentry);
+	err = vfs_mkdir(lower_dir_dentry->d_inode, lower_dentry,
+			SDCARDFS_LOWER_DIR_MODE);
+	if (!err)
+		err = sdcardfs_instantiate(dentry, dir, lower_dir_dentry);
+	unlock_dir(lower_dir_dentry);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_unlink(struct inode *dir, struct dentry *dentry)
+{
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct dentry *lower_dir_dentry;
+	const struct cred *old_cred;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	dget(lower_dentry);
+	lower_dir_dentry = lock_parent(lower_dentry);
+	err = vfs_unlink(lower_dir_dentry->d_inode, lower_dentry);
+	if (!err) {
+		fsstack_copy_attr_times(dir, lower_dir_dentry->d_inode);
+		dentry->d_inode->i_nlink =
+			sdcardfs_lower_inode(dentry->d_inode)->i_nlink;
+		dentry->d_inode->i_ctime = dir->i_ctime;
+		d_drop(dentry);
+	}
+	unlock_dir(lower_dir_dentry);
+	dput(lower_dentry);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_rmdir(struct inode *dir, struct dentry *dentry)
+{
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct dentry *lower_dir_dentry;
+	const struct cred *old_cred;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	dget(lower_dentry);
+	lower_dir_dentry = lock_parent(lower_dentry);
+	err = vfs_rmdir(lower_dir_dentry->d_inode, lower_dentry);
+	if (!err) {
+		clear_nlink(dentry->d_inode);
+		d_drop(dentry);
+	}
+	fsstack_copy_attr_times(dir, lower_dir_dentry->d_inode);
+	dir->i_nlink = lower_dir_dentry->d_inode->i_nlink;
+	unlock_dir(lower_dir_dentry);
+	dput(lower_dentry);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_rename(struct inode *old_dir, struct dentry *old_dentry,
+			   struct inode *new_dir, struct dentry *new_dentry)
+{
+	struct dentry *lower_old_dentry = sdcardfs_lower_dentry(old_dentry);
+	struct dentry *lower_new_dentry = sdcardfs_lower_dentry(new_dentry);
+	struct dentry *lower_old_dir_dentry, *lower_new_dir_dentry;
+	const struct cred *old_cred;
+	struct dentry *trap;
+	int err;
+
+	old_cred = sdcardfs_override_creds(old_dir->i_sb);
+	dget(lower_old_dentry);
+	dget(lower_new_dentry);
+	lower_old_dir_dentry = dget_parent(lower_old_dentry);
+	lower_new_dir_dentry = dget_parent(lower_new_dentry);
+
+	trap = lock_rename(lower_old_dir_dentry, lower_new_dir_dentry);
+	/* source should not be ancestor of target */
+	if (trap == lower_old_dentry) {
+		err = -EINVAL;
+		goto out;
+	}
+	/* target should not be ancestor of source */
+	if (trap == lower_new_dentry) {
+		err = -ENOTEMPTY;
+		goto out;
+	}
+	err = vfs_rename(lower_old_dir_dentry->d_inode, lower_old_dentry,
+			 lower_new_dir_dentry->d_inode, lower_new_dentry);
+	if (err)
+		goto out;
+
+	sdcardfs_copy_attrs(new_dir, lower_new_dir_dentry->d_inode);
+	fsstack_copy_inode_size(new_dir, lower_new_dir_dentry->d_inode);
+	if (new_dir != old_dir) {
+		sdcardfs_copy_attrs(old_dir, lower_old_dir_dentry->d_inode);
+		fsstack_copy_inode_size(old_dir,
+					lower_old_dir_dentry->d_inode);
+	}
+out:
+	unlock_rename(lower_old_dir_dentry, lower_new_dir_dentry);
+	dput(lower_new_dir_dentry);
+	dput(lower_old_dir_dentry);
+	dput(lower_new_dentry);
+	dput(lower_old_dentry);
+	revert_creds(old_cred);
+	return err;
+}
+
+/* The presented attributes are all there is to check, and are RCU safe */
+static int sdcardfs_permission(struct inode *inode, int mask,
+			       unsigned int flags)
+{
+	return generic_permission(inode, mask, flags, NULL);
+}
+
+/*
+ * Ownership and permissions can't be changed, as on a FAT card; such
+ * requests are ignored like the sdcard daemon did.  Sizes and times go
+ * to the lower inode.
+ */
+static int sdcardfs_setattr(struct dentry *dentry, struct iattr *ia)
+{
+	struct inode *inode = dentry->d_inode;
+	struct dentry *lower_dentry = sdcardfs_lower_dentry(dentry);
+	struct inode *lower_inode = sdcardfs_lower_inode(inode);
+	const struct cred *old_cred;
+	struct iattr lower_ia;
+	int err;
+
+	ia->ia_valid &= ~(ATTR_MODE | ATTR_UID | ATTR_GID | ATTR_KILL_SUID |
+			  ATTR_KILL_SGID | ATTR_KILL_PRIV);
+	err = inode_change_ok(inode, ia);
+	if (err)
+		return err;
+	if (!(ia->ia_valid & ~ATTR_FILE))
+		return 0;
+
+	lower_ia = *ia;
+	if (ia->ia_valid & ATTR_FILE)
+		lower_ia.ia_file = sdcardfs_lower_file(ia->ia_file);
+
+	old_cred = sdcardfs_override_creds(inode->i_sb);
+	mutex_lock(&lower_inode->i_mutex);
+	err = notify_change(lower_dentry, &lower_ia);
+	mutex_unlock(&lower_inode->i_mutex);
+	revert_creds(old_cred);
+
+	sdcardfs_copy_attrs(inode, lower_inode);
+	fsstack_copy_inode_size(inode, lower_inode);
+	return err;
+}
+
+static int sdcardfs_getattr(struct vfsmount *mnt, struct dentry *dentry,
+			    struct kstat *stat)
+{
+	struct inode *inode = dentry->d_inode;
+	struct inode *lower_inode = sdcardfs_lower_inode(inode);
+
+	sdcardfs_copy_attrs(inode, lower_inode);
+	fsstack_copy_inode_size(inode, lower_inode);
+	generic_fillattr(inode, stat);
+	return 0;
+}
+
+const struct inode_operations sdcardfs_dir_iops = {
+	.create		= sdcardfs_create,
+	.lookup		= sdcardfs_lookup,
+	.mkdir		= sdcardfs_mkdir,
+	.unlink		= sdcardfs_unlink,
+	.rmdir		= sdcardfs_rmdir,
+	.rename		= sdcardfs_rename,
+	.permission	= sdcardfs_permission,
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
+
+const struct inode_operations sdcardfs_main_iops = {
+	.permission	= sdcardfs_permission,
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
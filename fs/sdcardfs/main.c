@@ -0,0 +1,241 @@
+/*
+ * sdcardfs: emulated external storage stacked on a directory of the
+ * internal filesystem, in place of the FUSE based sdcard daemon.
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/parser.h>
+#include "sdcardfs.h"
+
+enum {
+	Opt_uid, Opt_gid, Opt_mask, Opt_err,
+};
+
+static const match_table_t sdcardfs_tokens = {
+	{Opt_uid, "uid=%u"},
+	{Opt_gid, "gid=%u"},
+	{Opt_mask, "mask=%o"},
+	{Opt_err, NULL},
+};
+
+static int sdcardfs_parse_options(struct sdcardfs_sb_info *sbi, char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	sbi->uid = SDCARDFS_DEF_UID;
+	sbi->gid = SDCARDFS_DEF_GID;
+	sbi->mask = SDCARDFS_DEF_MASK;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		int token;
+
+		if (!*p)
+			continue;
+		token = match_token(p, sdcardfs_tokens, args);
+		switch (token) {
+		case Opt_uid:
+			if (match_int(&args[0], &option) || option < 0)
+				return -EINVAL;
+			sbi->uid = option;
+			break;
+		case Opt_gid:
+			if (match_int(&args[0], &option) || option < 0)
+				return -EINVAL;
+			sbi->gid = option;
+			break;
+		case Opt_mask:
+			if (match_octal(&args[0], &option))
+				return -EINVAL;
+			sbi->mask = option & S_IRWXUGO;
+			break;
+		default:
+			printk(KERN_ERR "sdcardfs: unrecognized option %s\n", p);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static struct file_system_type sdcardfs_fs_type;
+
+static struct dentry *sdcardfs_mount(struct file_system_type *fs_type,
+				     int flags, const char *dev_name,
+				     void *raw_data)
+{
+	struct sdcardfs_sb_info *sbi;
+	struct sdcardfs_dentry_info *root_info;
+	struct super_block *s;
+	struct inode *inode;
+	struct cred *cred;
+	struct path path;
+	int err;
+
+	sbi = kzalloc(sizeof(*sbi), GFP_KERNEL);
+	if (!sbi)
+		return ERR_PTR(-ENOMEM);
+
+	err = sdcardfs_parse_options(sbi, raw_data);
+	if (err)
+		goto out_free;
+
+	err = kern_path(dev_name, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &path);
+	if (err) {
+		printk(KERN_ERR "sdcardfs: can't find %s: %d\n",
+		       dev_name, err);
+		goto out_free;
+	}
+	if (path.dentry->d_sb->s_type == &sdcardfs_fs_type) {
+		err = -EINVAL;
+		goto out_path;
+	}
+
+	cred = prepare_creds();
+	if (!cred) {
+		err = -ENOMEM;
+		goto out_path;
+	}
+	cred->fsuid = path.dentry->d_inode->i_uid;
+	cred->fsgid = path.dentry->d_inode->i_gid;
+	sbi->lower_cred = cred;
+	sbi->lower_sb = path.dentry->d_sb;
+
+	s = sget(fs_type, NULL, set_anon_super, NULL);
+	if (IS_ERR(s)) {
+		err = PTR_ERR(s);
+		put_cred(sbi->lower_cred);
+		goto out_path;
+	}
+
+	/* ->kill_sb() will take care of sbi after that point */
+	s->s_fs_info = sbi;
+	s->s_flags = flags;
+	s->s_op = &sdcardfs_sops;
+	s->s_d_op = &sdcardfs_dops;
+	s->s_magic = SDCARDFS_SUPER_MAGIC;
+	s->s_maxbytes = sbi->lower_sb->s_maxbytes;
+	s->s_blocksize = sbi->lower_sb->s_blocksize;
+	s->s_blocksize_bits = sbi->lower_sb->s_blocksize_bits;
+	s->s_time_gran = sbi->lower_sb->s_time_gran;
+
+	inode = sdcardfs_iget(s, path.dentry->d_inode);
+	if (IS_ERR(inode)) {
+		err = PTR_ERR(inode);
+		goto out_sb;
+	}
+	s->s_root = d_alloc_root(inode);
+	if (!s->s_root) {
+		iput(inode);
+		err = -ENOMEM;
+		goto out_sb;
+	}
+
+	root_info = kmem_cache_alloc(sdcardfs_dentry_cachep, GFP_KERNEL);
+	if (!root_info) {
+		err = -ENOMEM;
+		goto out_sb;
+	}
+	/* The root dentry owns the reference on the lower directory now */
+	root_info->lower_path = path;
+	s->s_root->d_fsdata = root_info;
+
+	s->s_flags |= MS_ACTIVE;
+	return dget(s->s_root);
+
+out_sb:
+	path_put(&path);
+	deactivate_locked_super(s);
+	return ERR_PTR(err);
+out_path:
+	path_put(&path);
+out_free:
+	kfree(sbi);
+	return ERR_PTR(err);
+}
+
+static void sdcardfs_kill_sb(struct super_block *sb)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(sb);
+
+	kill_anon_super(sb);
+	if (!sbi)
+		return;
+	put_cred(sbi->lower_cred);
+	kfree(sbi);
+}
+
+static struct file_system_type sdcardfs_fs_type = {
+	.owner		= THIS_MODULE,
+	.name		= SDCARDFS_NAME,
+	.mount		= sdcardfs_mount,
+	.kill_sb	= sdcardfs_kill_sb,
+};
+
+static void sdcardfs_inode_init_once(void *obj)
+{
+	struct sdcardfs_inode_info *info = obj;
+
+	inode_init_once(&info->vfs_inode);
+}
+
+static int __init init_sdcardfs_fs(void)
+{
+	int err;
+
+	sdcardfs_inode_cachep = kmem_cache_create("sdcardfs_inode_cache",
+					sizeof(struct sdcardfs_inode_info), 0,
+					SLAB_RECLAIM_ACCOUNT | SLAB_MEM_SPREAD,
+					sdcardfs_inode_init_once);
+	if (!sdcardfs_inode_cachep)
+		return -ENOMEM;
+
+	sdcardfs_dentry_cachep = kmem_cache_create("sdcardfs_dentry_cache",
+					sizeof(struct sdcardfs_dentry_info), 0,
+					SLAB_RECLAIM_ACCOUNT, NULL);
+	if (!sdcardfs_dentry_cachep) {
+		err = -ENOMEM;
+		goto out_inode;
+	}
+
+	err = register_filesystem(&sdcardfs_fs_type);
+	if (err)
+		goto out_dentry;
+	return 0;
+
+out_dentry:
+	kmem_cache_destroy(sdcardfs_dentry_cachep);
+out_inode:
+	kmem_cache_destroy(sdcardfs_inode_cachep);
+	return err;
+}
+
+static void __exit exit_sdcardfs_fs(void)
+{
+	unregister_filesystem(&sdcardfs_fs_type);
+	/* Wait for the inodes freed through RCU */
+	rcu_barrier();
+	kmem_cache_destroy(sdcardfs_dentry_cachep);
+	kmem_cache_destroy(sdcardfs_inode_cachep);
+}
+
+MODULE_DESCRIPTION("Emulated external storage filesystem");
+MODULE_LICENSE("GPL v2");
+
+module_init(init_sdcardfs_fs);
+module_exit(exit_sdcardfs_fs);
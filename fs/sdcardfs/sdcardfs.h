@@ -0,0 +1,119 @@
+/*
+ * sdcardfs: emulated external storage stacked on a directory of the
+ * internal filesystem.
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _SDCARDFS_H_
+#define _SDCARDFS_H_
+
+#include <linux/fs.h>
+#include <linux/mount.h>
+#include <linux/namei.h>
+#include <linux/cred.h>
+#include <linux/fs_stack.h>
+
+#define SDCARDFS_NAME		"sdcardfs"
+#define SDCARDFS_SUPER_MAGIC	0xb550ca10
+
+/* Defaults matching the sdcard daemon: AID_SDCARD_RW, group writable */
+#define SDCARDFS_DEF_UID	0
+#define SDCARDFS_DEF_GID	1015
+#define SDCARDFS_DEF_MASK	0002
+
+/* Modes of the files and directories created in the lower filesystem */
+#define SDCARDFS_LOWER_FILE_MODE	0664
+#define SDCARDFS_LOWER_DIR_MODE		0775
+
+struct sdcardfs_sb_info {
+	struct super_block *lower_sb;
+	/* Owner of the lower root; the lower filesystem is accessed as it */
+	const struct cred *lower_cred;
+	/* What every file is presented with */
+	uid_t uid;
+	gid_t gid;
+	umode_t mask;
+};
+
+struct sdcardfs_inode_info {
+	struct inode *lower_inode;
+	struct inode vfs_inode;
+};
+
+struct sdcardfs_dentry_info {
+	struct path lower_path;
+};
+
+extern const struct file_operations sdcardfs_main_fops;
+extern const struct file_operations sdcardfs_dir_fops;
+extern const struct inode_operations sdcardfs_main_iops;
+extern const struct inode_operations sdcardfs_dir_iops;
+extern const struct super_operations sdcardfs_sops;
+extern const struct dentry_operations sdcardfs_dops;
+
+extern struct kmem_cache *sdcardfs_inode_cachep;
+extern struct kmem_cache *sdcardfs_dentry_cachep;
+
+extern struct inode *sdcardfs_iget(struct super_block *sb,
+				   struct inode *lower_inode);
+extern void sdcardfs_copy_attrs(struct inode *inode,
+				const struct inode *lower_inode);
+
+static inline struct sdcardfs_sb_info *SDCARDFS_SB(struct super_block *sb)
+{
+	return sb->s_fs_info;
+}
+
+static inline struct sdcardfs_inode_info *SDCARDFS_I(struct inode *inode)
+{
+	return container_of(inode, struct sdcardfs_inode_info, vfs_inode);
+}
+
+static inline struct inode *sdcardfs_lower_inode(const struct inode *inode)
+{
+	return SDCARDFS_I((struct inode *)inode)->lower_inode;
+}
+
+static inline struct sdcardfs_dentry_info *SDCARDFS_D(struct dentry *dentry)
+{
+	return dentry->d_fsdata;
+}
+
+static inline struct dentry *sdcardfs_lower_dentry(struct dentry *dentry)
+{
+	return SDCARDFS_D(dentry)->lower_path.dentry;
+}
+
+static inline void sdcardfs_get_lower_path(struct dentry *dentry,
+					   struct path *path)
+{
+	*path = SDCARDFS_D(dentry)->lower_path;
+	path_get(path);
+}
+
+static inline struct file *sdcardfs_lower_file(struct file *file)
+{
+	return file->private_data;
+}
+
+/*
+ * Everything done on the lower filesystem runs with the credentials of
+ * its owner, the way the sdcard daemon did; callers were already checked
+ * against the attributes this filesystem presents.
+ */
+static inline const struct cred *sdcardfs_override_creds(struct super_block *sb)
+{
+	return override_creds(SDCARDFS_SB(sb)->lower_cred);
+}
+
+#endif /* _SDCARDFS_H_ */
@@ -0,0 +1,82 @@
+/*
+ * sdcardfs super block operations
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+#include <linux/statfs.h>
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_inode_cachep;
+
+static struct inode *sdcardfs_alloc_inode(struct super_block *sb)
+{
+	struct sdcardfs_inode_info *info;
+
+	info = kmem_cache_alloc(sdcardfs_inode_cachep, GFP_KERNEL);
+	if (!info)
+		return NULL;
+	info->lower_inode = NULL;
+	return &info->vfs_inode;
+}
+
+static void sdcardfs_i_callback(struct rcu_head *head)
+{
+	struct inode *inode = container_of(head, struct inode, i_rcu);
+
+	INIT_LIST_HEAD(&inode->i_dentry);
+	kmem_cache_free(sdcardfs_inode_cachep, SDCARDFS_I(inode));
+}
+
+static void sdcardfs_destroy_inode(struct inode *inode)
+{
+	call_rcu(&inode->i_rcu, sdcardfs_i_callback);
+}
+
+static void sdcardfs_evict_inode(struct inode *inode)
+{
+	truncate_inode_pages(&inode->i_data, 0);
+	end_writeback(inode);
+	iput(sdcardfs_lower_inode(inode));
+}
+
+static int sdcardfs_statfs(struct dentry *dentry, struct kstatfs *buf)
+{
+	struct path lower_path;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	err = vfs_statfs(&lower_path, buf);
+	path_put(&lower_path);
+	buf->f_type = SDCARDFS_SUPER_MAGIC;
+	return err;
+}
+
+static int sdcardfs_show_options(struct seq_file *m, struct vfsmount *mnt)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(mnt->mnt_sb);
+
+	seq_printf(m, ",uid=%u,gid=%u,mask=%04o",
+		   sbi->uid, sbi->gid, sbi->mask);
+	return 0;
+}
+
+const struct super_operations sdcardfs_sops = {
+	.alloc_inode	= sdcardfs_alloc_inode,
+	.destroy_inode	= sdcardfs_destroy_inode,
+	.drop_inode	= generic_delete_inode,
+	.evict_inode	= sdcardfs_evict_inode,
+	.statfs		= sdcardfs_statfs,
+	.show_options	= sdcardfs_show_options,
+};
@@ -25,6 +25,8 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/cpumask.h>
+#include <linux/wait.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -36,6 +38,26 @@
  * Squashfs, allowing multiple decompressors to be easily supported
  */
 
+/*
+ * Blocks are decompressed in parallel, each reader taking an idle
+ * decompressor stream.  Streams are created on demand, up to one per
+ * possible CPU, after which readers wait for one to be released.
+ */
+struct squashfs_decomp_stream {
+	void			*stream;
+	struct list_head	list;
+};
+
+struct squashfs_stream {
+	spinlock_t		lock;
+	struct list_head	idle;
+	int			count;
+	wait_queue_head_t	wait;
+	/* compressor options the streams are initialised with */
+	void			*comp_opts;
+	int			comp_opts_len;
+};
+
 static const struct squashfs_decompressor squashfs_lzma_unsupported_comp_ops = {
 	NULL, NULL, NULL, LZMA_COMPRESSION, "lzma", 0
 };
@@ -77,11 +99,106 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
-void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
+static struct squashfs_decomp_stream *squashfs_decomp_stream_alloc(
+	struct squashfs_sb_info *msblk, struct squashfs_stream *stream)
+{
+	struct squashfs_decomp_stream *decomp;
+
+	decomp = kmalloc(sizeof(*decomp), GFP_KERNEL);
+	if (decomp == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	decomp->stream = msblk->decompressor->init(msblk, stream->comp_opts,
+		stream->comp_opts_len);
+	if (IS_ERR(decomp->stream)) {
+		void *err = decomp->stream;
+
+		kfree(decomp);
+		return err;
+	}
+
+	return decomp;
+}
+
+
+static struct squashfs_decomp_stream *squashfs_get_decomp_stream(
+	struct squashfs_sb_info *msblk)
+{
+	struct squashfs_stream *stream = msblk->stream;
+	struct squashfs_decomp_stream *decomp;
+
+	while (1) {
+		spin_lock(&stream->lock);
+		if (!list_empty(&stream->idle)) {
+			decomp = list_entry(stream->idle.next,
+				struct squashfs_decomp_stream, list);
+			list_del(&decomp->list);
+			spin_unlock(&stream->lock);
+			return decomp;
+		}
+
+		if (stream->count < num_possible_cpus()) {
+			stream->count++;
+			spin_unlock(&stream->lock);
+
+			decomp = squashfs_decomp_stream_alloc(msblk, stream);
+			if (!IS_ERR(decomp))
+				return decomp;
+
+			/* Make do with the streams there are */
+			spin_lock(&stream->lock);
+			stream->count--;
+			spin_unlock(&stream->lock);
+		} else
+			spin_unlock(&stream->lock);
+
+		wait_event(stream->wait, !list_empty(&stream->idle));
+	}
+}
+
+
+static void squashfs_put_decomp_stream(struct squashfs_sb_info *msblk,
+	struct squashfs_decomp_stream *decomp)
+{
+	struct squashfs_stream *stream = msblk->stream;
+
+	spin_lock(&stream->lock);
+	list_add(&decomp->list, &stream->idle);
+	spin_unlock(&stream->lock);
+	wake_up(&stream->wait);
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	struct squashfs_decomp_stream *decomp;
+	int res;
+
+	if (msblk->stream == NULL) {
+		for (; b > 0; b--)
+			put_bh(bh[b - 1]);
+		return -EIO;
+	}
+
+	decomp = squashfs_get_decomp_stream(msblk);
+	res = msblk->decompressor->decompress(msblk, decomp->stream, buffer,
+		bh, b, offset, length, srclength, pages);
+	squashfs_put_decomp_stream(msblk, decomp);
+
+	return res;
+}
+
+
+struct squashfs_stream *squashfs_decompressor_init(struct super_block *sb,
+	unsigned short flags)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
-	void *strm, *buffer = NULL;
-	int length = 0;
+	struct squashfs_stream *stream;
+	struct squashfs_decomp_stream *decomp = NULL;
+	void *buffer = NULL;
+	int length = 0, err;
 
 	/*
 	 * Read decompressor specific options from file system if present
@@ -96,15 +213,52 @@ void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 			PAGE_CACHE_SIZE, 1);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
-			goto finished;
+			err = length;
+			goto failed;
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (stream == NULL) {
+		err = -ENOMEM;
+		goto failed;
+	}
+	spin_lock_init(&stream->lock);
+	INIT_LIST_HEAD(&stream->idle);
+	init_waitqueue_head(&stream->wait);
+	stream->comp_opts = buffer;
+	stream->comp_opts_len = length;
+
+	/* Fail the mount now if the decompressor can't be initialised */
+	decomp = squashfs_decomp_stream_alloc(msblk, stream);
+	if (IS_ERR(decomp)) {
+		err = PTR_ERR(decomp);
+		kfree(stream);
+		goto failed;
+	}
+	list_add(&decomp->list, &stream->idle);
+	stream->count = 1;
+
+	return stream;
 
-finished:
+failed:
 	kfree(buffer);
+	return ERR_PTR(err);
+}
+
+
+void squashfs_decompressor_free(struct squashfs_sb_info *msblk,
+	struct squashfs_stream *stream)
+{
+	struct squashfs_decomp_stream *decomp, *next;
+
+	if (stream == NULL)
+		return;
 
-	return strm;
+	list_for_each_entry_safe(decomp, next, &stream->idle, list) {
+		msblk->decompressor->free(decomp->stream);
+		kfree(decomp);
+	}
+	kfree(stream->comp_opts);
+	kfree(stream);
 }
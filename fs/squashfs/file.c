@@ -47,6 +47,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/highmem.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -371,6 +372,98 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * rather than into the read_page cache and copying from there.  This is
+ * only possible if all those pages could be grabbed, -EAGAIN is returned
+ * otherwise and the caller falls back to the read_page cache.
+ */
+static int squashfs_readpage_block(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = min(start_index | mask, file_end);
+	int pages = end_index - start_index + 1;
+	struct page **page;
+	void **pageaddr;
+	int i, grabbed, res, bytes;
+
+	page = kmalloc(pages * sizeof(*page), GFP_KERNEL);
+	pageaddr = kmalloc(pages * sizeof(*pageaddr), GFP_KERNEL);
+	if (page == NULL || pageaddr == NULL) {
+		res = -EAGAIN;
+		goto out;
+	}
+
+	for (grabbed = 0; grabbed < pages; grabbed++) {
+		int n = start_index + grabbed;
+		struct page *push_page = (n == target_page->index) ?
+			target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (push_page == NULL)
+			break;
+		if (PageUptodate(push_page)) {
+			unlock_page(push_page);
+			page_cache_release(push_page);
+			break;
+		}
+		page[grabbed] = push_page;
+	}
+
+	if (grabbed < pages) {
+		/* Somebody else has, or is reading, part of the block */
+		res = -EAGAIN;
+		goto release;
+	}
+
+	/* Bounds the highmem mappings held, see squashfs_fill_super() */
+	down(&msblk->direct_read_sem);
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		msblk->block_size, pages);
+
+	for (i = 0, bytes = res; i < pages; i++, bytes -= PAGE_CACHE_SIZE) {
+		int avail = res < 0 ? 0 : clamp_t(int, bytes, 0,
+				PAGE_CACHE_SIZE);
+
+		if (avail < PAGE_CACHE_SIZE)
+			memset(pageaddr[i] + avail, 0, PAGE_CACHE_SIZE - avail);
+		kunmap(page[i]);
+		flush_dcache_page(page[i]);
+		if (res >= 0)
+			SetPageUptodate(page[i]);
+	}
+	up(&msblk->direct_read_sem);
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		res = -EIO;
+	} else
+		res = 0;
+
+release:
+	/* The target page is left to the caller */
+	for (i = 0; i < grabbed; i++) {
+		if (page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+out:
+	kfree(pageaddr);
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -410,8 +503,17 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			sparse = 1;
 		} else {
 			/*
-			 * Read and decompress datablock.
+			 * Read and decompress datablock, straight into the
+			 * page cache if possible.
 			 */
+			int res = squashfs_readpage_block(page, block, bsize);
+
+			if (res == 0) {
+				unlock_page(page);
+				return 0;
+			} else if (res != -EAGAIN)
+				goto error_out;
+
 			buffer = squashfs_get_datablock(inode->i_sb,
 								block, bsize);
 			if (buffer->error) {
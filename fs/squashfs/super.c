@@ -98,8 +98,13 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->devblksize = sb_min_blocksize(sb, BLOCK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
+	/*
+	 * Readers decompressing straight into the page cache hold a block
+	 * worth of page mappings; there is no point in more of them than
+	 * there can be decompressor streams.
+	 */
+	sema_init(&msblk->direct_read_sem, num_possible_cpus());
 
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
@@ -104,6 +104,8 @@ enum pmem_allocator_type {
 
 	PMEM_ALLOCATORTYPE_ALLORNOTHING,
 	PMEM_ALLOCATORTYPE_BUDDYBESTFIT,
+	/* allocations come from the ION heaps in ion_heap_mask */
+	PMEM_ALLOCATORTYPE_ION,
 
 	PMEM_ALLOCATORTYPE_MAX,
 };
@@ -175,6 +177,12 @@ struct android_pmem_platform_data
 	 * indicates this pmem may be reused via fmem
 	 */
 	int reusable;
+	/*
+	 * ION heaps backing a PMEM_ALLOCATORTYPE_ION device; size is then
+	 * a quota on them and no memory is reserved for the device itself.
+	 * The heaps must be physically contiguous ones.
+	 */
+	unsigned int ion_heap_mask;
 };
 
 int pmem_setup(struct android_pmem_platform_data *pdata,
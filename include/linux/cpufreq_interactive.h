@@ -0,0 +1,31 @@
+/*
+ * include/linux/cpufreq_interactive.h
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _LINUX_CPUFREQ_INTERACTIVE_H
+#define _LINUX_CPUFREQ_INTERACTIVE_H
+
+/*
+ * Called by touch drivers from their hard irq handler, before any bus
+ * traffic, so the CPUs are already speeding up while the touch report is
+ * being read. Safe to call from any context.
+ */
+#ifdef CONFIG_CPU_FREQ_GOV_INTERACTIVE
+void cpufreq_interactive_touch_boost(void);
+#else
+static inline void cpufreq_interactive_touch_boost(void)
+{
+}
+#endif
+
+#endif /* _LINUX_CPUFREQ_INTERACTIVE_H */
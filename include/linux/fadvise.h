@@ -18,4 +18,8 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/* Linux specific: record page cache misses, then read them back in bulk */
+#define POSIX_FADV_RECORD	8 /* Note the pages missed from now on.  */
+#define POSIX_FADV_REPLAY	9 /* Read back the pages noted before.  */
+
 #endif	/* FADVISE_H_INCLUDED */
@@ -0,0 +1,55 @@
+/*
+ * Frame ids shared by the input, GPU and display tracepoints.
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_FRAME_TRACE_H
+#define _LINUX_FRAME_TRACE_H
+
+#include <linux/types.h>
+#include <asm/atomic.h>
+
+/*
+ * Every input report starts a new frame id. A GPU submission carries the
+ * id of the latest input it can have seen, and a display update the id of
+ * the latest GPU submission, so each stage reports the newest input that
+ * can be reflected in its output.
+ */
+#ifdef CONFIG_TRACEPOINTS
+extern atomic_t frame_trace_input_id;
+extern atomic_t frame_trace_gpu_id;
+
+static inline u32 frame_trace_input(void)
+{
+	return atomic_inc_return(&frame_trace_input_id);
+}
+
+static inline u32 frame_trace_gpu(void)
+{
+	u32 id = atomic_read(&frame_trace_input_id);
+
+	atomic_set(&frame_trace_gpu_id, id);
+	return id;
+}
+
+static inline u32 frame_trace_display(void)
+{
+	return atomic_read(&frame_trace_gpu_id);
+}
+#else
+static inline u32 frame_trace_input(void) { return 0; }
+static inline u32 frame_trace_gpu(void) { return 0; }
+static inline u32 frame_trace_display(void) { return 0; }
+#endif
+
+#endif
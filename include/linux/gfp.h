@@ -367,6 +367,13 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp);
 void drain_all_pages(void);
 void drain_local_pages(void *dummy);
 
+#ifdef CONFIG_CMA
+/* Movable memory reserved for a driver, see init_cma_reserved_pageblock() */
+extern void init_cma_reserved_pageblock(struct page *page);
+extern int alloc_contig_range(unsigned long start, unsigned long end);
+extern void free_contig_range(unsigned long pfn, unsigned long nr_pages);
+#endif
+
 extern gfp_t gfp_allowed_mask;
 
 extern void pm_restrict_gfp_mask(void);
@@ -211,6 +211,9 @@ struct ion_cp_heap_pdata {
  * @mem_is_fmem		Flag indicating whether this memory is coming from fmem
  *			or not.
  * @fixed_position	If nonzero, position in the fixed area.
+ * @movable:		Flag indicating the memory is lent to the page allocator
+ *			for movable allocations while no buffer uses it. Needs
+ *			CONFIG_CMA and a pageblock aligned region in highmem.
  * @request_region:	function to be called when the number of allocations
  *			goes from 0 -> 1
  * @release_region:	function to be called when the number of allocations
@@ -223,6 +226,7 @@ struct ion_co_heap_pdata {
 	unsigned int align;
 	int mem_is_fmem;
 	enum ion_fixed_position fixed_position;
+	int movable;
 	int (*request_region)(void *);
 	int (*release_region)(void *);
 	void *(*setup_region)(void);
@@ -536,6 +540,23 @@ int msm_ion_unsecure_heap(int heap_id);
 int msm_ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 			void *vaddr, unsigned long len, unsigned int cmd);
 
+/**
+ * msm_ion_do_cache_range_op - do cache operations on part of a buffer.
+ *
+ * @client - pointer to ION client.
+ * @handle - pointer to buffer handle.
+ * @vaddr -  virtual address of the range to operate on.
+ * @offset - offset of the range in the buffer.
+ * @len - Length of the range.
+ * @cmd - Cache operation to perform, as for msm_ion_do_cache_op.
+ *
+ * Returns 0 on success
+ */
+int msm_ion_do_cache_range_op(struct ion_client *client,
+			struct ion_handle *handle, void *vaddr,
+			unsigned long offset, unsigned long len,
+			unsigned int cmd);
+
 #else
 static inline struct ion_client *ion_client_create(struct ion_device *dev,
 				     unsigned int heap_mask, const char *name)
@@ -656,6 +677,14 @@ static inline int msm_ion_do_cache_op(struct ion_client *client,
 	return -ENODEV;
 }
 
+static inline int msm_ion_do_cache_range_op(struct ion_client *client,
+			struct ion_handle *handle, void *vaddr,
+			unsigned long offset, unsigned long len,
+			unsigned int cmd)
+{
+	return -ENODEV;
+}
+
 #endif /* CONFIG_ION */
 #endif /* __KERNEL__ */
 
@@ -19,6 +19,7 @@
 #define __MFD_PM8XXX_CORE_H
 
 #include <linux/mfd/core.h>
+#include <linux/msm_ssbi.h>
 
 enum pm8xxx_version {
 	PM8XXX_VERSION_8058,
@@ -77,6 +78,9 @@ struct pm8xxx_drvdata {
 						u16 addr, u8 *buf, int n);
 	int			(*pmic_write_buf) (const struct device *dev,
 						u16 addr, u8 *buf, int n);
+	int			(*pmic_transfer) (const struct device *dev,
+						struct msm_ssbi_xfer *xfer,
+						int n);
 	int			(*pmic_read_irq_stat) (const struct device *dev,
 						int irq);
 	enum pm8xxx_version	(*pmic_get_version) (const struct device *dev);
@@ -122,6 +126,42 @@ static inline int pm8xxx_write_buf(const struct device *dev, u16 addr, u8 *buf,
 	return dd->pmic_write_buf(dev, addr, buf, n);
 }
 
+/*
+ * Run a batch of register accesses, atomically with respect to other
+ * masters of the bus when the core driver supports it.
+ */
+static inline int pm8xxx_transfer(const struct device *dev,
+				struct msm_ssbi_xfer *xfer, int n)
+{
+	struct pm8xxx_drvdata *dd = dev_get_drvdata(dev);
+	int i, rc = 0;
+	u8 reg;
+
+	if (!dd)
+		return -EINVAL;
+	if (dd->pmic_transfer)
+		return dd->pmic_transfer(dev, xfer, n);
+
+	for (i = 0; i < n && !rc; i++) {
+		if (!(xfer[i].flags &
+			(MSM_SSBI_XFER_READ | MSM_SSBI_XFER_MASKED))) {
+			rc = dd->pmic_writeb(dev, xfer[i].addr, xfer[i].val);
+			continue;
+		}
+		rc = dd->pmic_readb(dev, xfer[i].addr, &reg);
+		if (rc)
+			break;
+		if (xfer[i].flags & MSM_SSBI_XFER_MASKED) {
+			reg &= ~xfer[i].mask;
+			reg |= xfer[i].val & xfer[i].mask;
+			rc = dd->pmic_writeb(dev, xfer[i].addr, reg);
+		} else {
+			xfer[i].val = reg;
+		}
+	}
+	return rc;
+}
+
 static inline int pm8xxx_read_irq_stat(const struct device *dev, int irq)
 {
 	struct pm8xxx_drvdata *dd = dev_get_drvdata(dev);
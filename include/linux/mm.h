@@ -1496,6 +1496,12 @@ unsigned long ra_submit(struct file_ra_state *ra,
 			struct address_space *mapping,
 			struct file *filp);
 
+int readahead_record(struct address_space *mapping);
+int readahead_replay(struct address_space *mapping, struct file *filp);
+void __readahead_record_miss(struct address_space *mapping,
+			     pgoff_t offset, unsigned long nr);
+void __readahead_record_forget(struct address_space *mapping);
+
 /* Generic expand stack which grows the stack according to GROWS{UP,DOWN} */
 extern int expand_stack(struct vm_area_struct *vma, unsigned long address);
 
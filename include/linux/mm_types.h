@@ -215,6 +215,7 @@ enum {
 	MM_FILEPAGES,
 	MM_ANONPAGES,
 	MM_SWAPENTS,
+	MM_UNRECLAIMABLE,	/* pinned by drivers on behalf of the mm */
 	NR_MM_COUNTERS
 };
 
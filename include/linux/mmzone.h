@@ -40,8 +40,21 @@
 #define MIGRATE_MOVABLE       2
 #define MIGRATE_PCPTYPES      3 /* the number of types on the pcp lists */
 #define MIGRATE_RESERVE       3
+#ifdef CONFIG_CMA
+/*
+ * Pageblocks of a contiguous memory reserve. Only movable allocations
+ * fall back to them and they are never stolen for another type, so the
+ * owner can always migrate everything out when it needs the range.
+ */
+#define MIGRATE_CMA           4
+#define MIGRATE_ISOLATE       5 /* can't allocate from here */
+#define MIGRATE_TYPES         6
+#define is_migrate_cma(migratetype) unlikely((migratetype) == MIGRATE_CMA)
+#else
 #define MIGRATE_ISOLATE       4 /* can't allocate from here */
 #define MIGRATE_TYPES         5
+#define is_migrate_cma(migratetype) false
+#endif
 
 #define for_each_migratetype_order(order, type) \
 	for (order = 0; order < MAX_ORDER; order++) \
@@ -165,9 +178,12 @@ enum zone_watermarks {
 	NR_WMARK
 };
 
+/* A temporary boost raises the low and high watermarks, not min */
+#define wmark_pages(z, i) ((z)->watermark[i] + \
+			   ((i) == WMARK_MIN ? 0 : (z)->watermark_boost))
 #define min_wmark_pages(z) (z->watermark[WMARK_MIN])
-#define low_wmark_pages(z) (z->watermark[WMARK_LOW])
-#define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
+#define low_wmark_pages(z) (z->watermark[WMARK_LOW] + z->watermark_boost)
+#define high_wmark_pages(z) (z->watermark[WMARK_HIGH] + z->watermark_boost)
 
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
@@ -281,6 +297,13 @@ struct zone {
 	/* zone watermarks, access with *_wmark_pages(zone) macros */
 	unsigned long watermark[NR_WMARK];
 
+	/*
+	 * Pages added to the low and high watermarks until
+	 * watermark_boost_expires, so kswapd starts early in a burst.
+	 */
+	unsigned long watermark_boost;
+	unsigned long watermark_boost_expires;
+
 	/*
 	 * When free pages are below this point, additional steps are taken
 	 * when reading the number of free pages to avoid per-cpu counter
@@ -774,6 +797,10 @@ static inline int is_dma(struct zone *zone)
 struct ctl_table;
 int min_free_kbytes_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
+extern int sysctl_watermark_boost_factor;
+extern int sysctl_watermark_boost_ms;
+int watermark_boost_sysctl_handler(struct ctl_table *, int,
+					void __user *, size_t *, loff_t *);
 extern int sysctl_lowmem_reserve_ratio[MAX_NR_ZONES-1];
 int lowmem_reserve_ratio_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
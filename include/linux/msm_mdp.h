@@ -77,6 +77,10 @@
 #define MSMFB_OVERLAY_COMMIT      _IOW(MSMFB_IOCTL_MAGIC, 163, unsigned int)
 #define MSMFB_DISPLAY_COMMIT      _IOW(MSMFB_IOCTL_MAGIC, 164, \
 						struct mdp_display_commit)
+#define MSMFB_OVERLAY_SET_LIST    _IOWR(MSMFB_IOCTL_MAGIC, 166, \
+						struct mdp_overlay_list)
+#define MSMFB_ASYNC_BLIT          _IOW(MSMFB_IOCTL_MAGIC, 167, \
+						struct mdp_async_blit_req_list)
 
 #define FB_TYPE_3D_PANEL 0x10101010
 #define MDP_IMGTYPE2_START 0x10000
@@ -501,6 +505,29 @@ struct mdp_buf_sync {
 	int *rel_fen_fd;
 };
 
+/*
+ * Read from /dev/msm_fbN_vsync, oldest first. The device keeps the last
+ * MDP_VSYNC_RING_SIZE hardware vsyncs and polls readable when a new one
+ * came in since the last read.
+ */
+#define MDP_VSYNC_RING_SIZE	16
+
+struct mdp_vsync_timestamp {
+	uint64_t count;		/* vsyncs seen since the display came up */
+	int64_t timestamp;	/* CLOCK_MONOTONIC, in ns */
+};
+
+/*
+ * Queued blit: the requests run back to back in the kernel once the
+ * acquire fences in sync have signaled, and the fence returned through
+ * sync.rel_fen_fd signals when all of them are done.
+ */
+struct mdp_async_blit_req_list {
+	struct mdp_buf_sync sync;
+	uint32_t count;
+	struct mdp_blit_req req[];
+};
+
 struct mdp_buf_fence {
 	uint32_t flags;
 	uint32_t acq_fen_fd_cnt;
@@ -515,6 +542,31 @@ struct mdp_display_commit {
 	struct mdp_buf_fence buf_fence;
 };
 
+#define MDP_OVERLAY_LIST_MAX		8
+#define MDP_OVERLAY_LIST_COMMIT		0x00000001
+#define MDP_OVERLAY_LIST_COMMIT_ASYNC	0x00000002
+
+/*
+ * Stage several pipes of one display with a single ioctl. Entry i of
+ * overlay_list (if not NULL) is set up first and its id is used for entry i
+ * of data_list (if not NULL), which is then queued for the next frame. With
+ * MDP_OVERLAY_LIST_COMMIT the frame is committed once all entries are in.
+ * MDP_OVERLAY_LIST_COMMIT_ASYNC returns as soon as the commit is scheduled,
+ * the next ioctl on the device waits for it to finish. If buf_sync.rel_fen_fd
+ * is set, buf_sync is handled as by MSMFB_BUFFER_SYNC before the commit,
+ * returning a fence that signals once the buffers of this frame are no
+ * longer scanned out. processed_overlays returns how many entries went
+ * through.
+ */
+struct mdp_overlay_list {
+	uint32_t num_overlays;
+	uint32_t flags;
+	struct mdp_overlay *overlay_list;
+	struct msmfb_overlay_data *data_list;
+	struct mdp_buf_sync buf_sync;
+	uint32_t processed_overlays;
+};
+
 struct mdp_page_protection {
 	uint32_t page_protection;
 };
@@ -13,6 +13,7 @@
 #ifndef __LINUX_MSM_SMD_PKT_H
 #define __LINUX_MSM_SMD_PKT_H
 
+#include <linux/types.h>
 #include <linux/ioctl.h>
 
 #define SMD_PKT_IOCTL_MAGIC (0xC2)
@@ -20,4 +21,36 @@
 #define SMD_PKT_IOCTL_BLOCKING_WRITE \
 	_IOR(SMD_PKT_IOCTL_MAGIC, 0, unsigned int)
 
+/*
+ * Zero-copy receive.  The receive fifo of the channel can be mapped
+ * read-only with mmap() at offset 0.  The fifo starts at fifo_offset
+ * within the mapping and is a ring of fifo_size bytes.
+ */
+struct smd_pkt_rx_fifo_info {
+	__u32 map_size;
+	__u32 fifo_offset;
+	__u32 fifo_size;
+};
+
+/*
+ * State of the packet at the head of the receive fifo.  tail is the fifo
+ * index of the next unread byte, pkt_size the number of bytes left in the
+ * current packet (0 if none) and avail how many of those are present.
+ */
+struct smd_pkt_rx_state {
+	__u32 tail;
+	__u32 pkt_size;
+	__u32 avail;
+};
+
+#define SMD_PKT_IOCTL_RX_FIFO_INFO \
+	_IOR(SMD_PKT_IOCTL_MAGIC, 1, struct smd_pkt_rx_fifo_info)
+
+#define SMD_PKT_IOCTL_RX_STATE \
+	_IOR(SMD_PKT_IOCTL_MAGIC, 2, struct smd_pkt_rx_state)
+
+/* releases the given number of bytes of the current packet to the fifo */
+#define SMD_PKT_IOCTL_RX_CONSUME \
+	_IOW(SMD_PKT_IOCTL_MAGIC, 3, unsigned int)
+
 #endif /* __LINUX_MSM_SMD_PKT_H */
@@ -35,9 +35,26 @@ struct msm_ssbi_platform_data {
 	enum msm_ssbi_controller_type controller_type;
 };
 
+/* read addr into val */
+#define MSM_SSBI_XFER_READ	(1 << 0)
+/* read addr, replace the bits in mask with the ones of val, write it back */
+#define MSM_SSBI_XFER_MASKED	(1 << 1)
+
+/*
+ * One access of a msm_ssbi_transfer() batch, a plain write of val to addr
+ * unless flags say otherwise.
+ */
+struct msm_ssbi_xfer {
+	u16		addr;
+	u8		val;
+	u8		mask;
+	unsigned int	flags;
+};
+
 #ifdef CONFIG_MSM_SSBI
 int msm_ssbi_write(struct device *dev, u16 addr, u8 *buf, int len);
 int msm_ssbi_read(struct device *dev, u16 addr, u8 *buf, int len);
+int msm_ssbi_transfer(struct device *dev, struct msm_ssbi_xfer *xfer, int n);
 #else
 static inline int msm_ssbi_write(struct device *dev, u16 addr, u8 *buf, int len)
 {
@@ -47,5 +64,10 @@ static inline int msm_ssbi_read(struct device *dev, u16 addr, u8 *buf, int len)
 {
 	return -ENXIO;
 }
+static inline int msm_ssbi_transfer(struct device *dev,
+				struct msm_ssbi_xfer *xfer, int n)
+{
+	return -ENXIO;
+}
 #endif
 #endif
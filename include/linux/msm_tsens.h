@@ -41,4 +41,17 @@ struct tsens_device {
 int32_t tsens_get_temp(struct tsens_device *dev, unsigned long *temp);
 int msm_tsens_early_init(struct tsens_platform_data *pdata);
 
+/**
+ * tsens_set_threshold_notify() - arm the TSENS upper threshold interrupt
+ * @dev: sensor whose calibration is used to convert @degC
+ * @degC: notify once the temperature rises to this
+ * @notify: callback, run from the TSENS interrupt handler; NULL disarms
+ * @data: passed back to @notify
+ *
+ * A crossing masks the interrupt again, call this to re-arm it. This
+ * moves the upper trip point shared with the thermal zone.
+ */
+int tsens_set_threshold_notify(struct tsens_device *dev, long degC,
+			       void (*notify)(void *data), void *data);
+
 #endif /*MSM_TSENS_H */
@@ -24,6 +24,7 @@ enum mapping_flags {
 	AS_ENOSPC	= __GFP_BITS_SHIFT + 1,	/* ENOSPC on async write */
 	AS_MM_ALL_LOCKS	= __GFP_BITS_SHIFT + 2,	/* under mm_take_all_locks() */
 	AS_UNEVICTABLE	= __GFP_BITS_SHIFT + 3,	/* e.g., ramdisk, SHM_LOCK */
+	AS_RA_RECORD	= __GFP_BITS_SHIFT + 4,	/* has a readahead record */
 };
 
 static inline void mapping_set_error(struct address_space *mapping, int error)
@@ -53,6 +54,19 @@ static inline int mapping_unevictable(struct address_space *mapping)
 	return !!mapping;
 }
 
+static inline void readahead_record_miss(struct address_space *mapping,
+					 pgoff_t offset, unsigned long nr)
+{
+	if (unlikely(test_bit(AS_RA_RECORD, &mapping->flags)))
+		__readahead_record_miss(mapping, offset, nr);
+}
+
+static inline void readahead_record_forget(struct address_space *mapping)
+{
+	if (unlikely(test_bit(AS_RA_RECORD, &mapping->flags)))
+		__readahead_record_forget(mapping);
+}
+
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
 	return (__force gfp_t)mapping->flags & __GFP_BITS_MASK;
@@ -14,6 +14,7 @@
 
 #define QCEDEV_USE_PMEM		1
 #define QCEDEV_NO_PMEM		0
+#define QCEDEV_USE_ION		2
 
 #define QCEDEV_AES_KEY_128	16
 #define QCEDEV_AES_KEY_192	24
@@ -131,8 +132,8 @@ struct	qcedev_pmem_info {
 
 /**
 * struct qcedev_cipher_op_req - Holds the ciphering request information
-* @use_pmem (IN):	Flag to indicate if buffer source is PMEM
-*			QCEDEV_USE_PMEM/QCEDEV_NO_PMEM
+* @use_pmem (IN):	Flag to indicate if buffer source is PMEM or ION
+*			QCEDEV_USE_PMEM/QCEDEV_USE_ION/QCEDEV_NO_PMEM
 * @pmem (IN):		Stores PMEM buffer information.
 *			Refer struct qcedev_pmem_info
 * @vbuf (IN/OUT):	Stores Source and destination Buffer information
@@ -171,6 +172,11 @@ struct	qcedev_pmem_info {
 * The final input/src and output/dst buffer pointer will be determined
 * by adding the offsets to the kernel virtual addr.
 *
+* If use_pmem is set to 2 (QCEDEV_USE_ION), fd_src and fd_dst are ION buffer
+* fds and are otherwise handled the same way as PMEM, the data is processed
+* in place without being copied. The buffers must come from a physically
+* contiguous ION heap.
+*
 * If use of hardware key is supported in the target, user can configure the
 * key paramters (encklen, enckey) to use the hardware key.
 * In order to use the hardware key, set encklen to 0 and set the enckey
@@ -13,6 +13,7 @@
 
 struct rq_data {
 	unsigned int rq_avg;
+	unsigned int rq_ewma;
 	unsigned long rq_poll_jiffies;
 	unsigned long def_timer_jiffies;
 	unsigned long rq_poll_last_jiffy;
@@ -29,3 +30,5 @@ struct rq_data {
 extern spinlock_t rq_lock;
 extern struct rq_data rq_info;
 extern struct workqueue_struct *rq_wq;
+
+int rq_stats_get_ewma(unsigned int *avg);
@@ -274,6 +274,7 @@ extern cpumask_var_t nohz_cpu_mask;
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ)
 extern void select_nohz_load_balancer(int stop_tick);
 extern int get_nohz_timer_target(void);
+extern int sysctl_timer_housekeeping_cpu;
 #else
 static inline void select_nohz_load_balancer(int stop_tick) { }
 #endif
@@ -1179,6 +1180,19 @@ struct sched_statistics {
 };
 #endif
 
+#ifdef CONFIG_SMP
+/*
+ * Decayed sums of the time, in ~1us units, a task was runnable and of all
+ * the time elapsed, see update_task_load().
+ */
+struct sched_avg {
+	u64			last_update;
+	u32			runnable_sum;
+	u32			period_sum;
+	u32			period_contrib;
+};
+#endif
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1189,9 +1203,14 @@ struct sched_entity {
 	u64			sum_exec_runtime;
 	u64			vruntime;
 	u64			prev_sum_exec_runtime;
+	u64			avg_burst;	/* run time between sleeps */
 
 	u64			nr_migrations;
 
+#ifdef CONFIG_SMP
+	struct sched_avg	avg;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1293,6 +1312,10 @@ struct task_struct {
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 #endif
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+	struct rb_node lowmem_node;	/* in the lowmemorykiller's tree */
+	int lowmem_adj;			/* oom_adj it is sorted by */
+#endif
 
 	struct mm_struct *mm, *active_mm;
 #ifdef CONFIG_COMPAT_BRK
@@ -1980,6 +2003,37 @@ extern unsigned int sysctl_sched_latency;
 extern unsigned int sysctl_sched_min_granularity;
 extern unsigned int sysctl_sched_wakeup_granularity;
 extern unsigned int sysctl_sched_child_runs_first;
+extern unsigned int sysctl_sched_small_task;
+
+/* Passed to task migration notifiers when a wakeup moves a task */
+struct migration_notify_data {
+	int src_cpu;
+	int dest_cpu;
+	unsigned int load;	/* task_load() of the task */
+};
+
+struct notifier_block;
+
+#ifdef CONFIG_SMP
+extern void sched_set_deep_idle(int deep);
+extern int sched_isolate_cpu(int cpu);
+extern int sched_unisolate_cpu(int cpu);
+extern int sched_cpu_isolated(int cpu);
+extern int register_task_migration_notifier(struct notifier_block *nb);
+extern int unregister_task_migration_notifier(struct notifier_block *nb);
+extern unsigned int task_load(struct task_struct *p);
+#else
+static inline void sched_set_deep_idle(int deep) { }
+static inline int register_task_migration_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int
+unregister_task_migration_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+#endif
 
 enum sched_tunable_scaling {
 	SCHED_TUNABLESCALING_NONE,
@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/errno.h>
 
 #if defined(CONFIG_PM_SLEEP) && defined(CONFIG_VT) && defined(CONFIG_VT_CONSOLE)
@@ -322,4 +323,12 @@ static inline void unlock_system_sleep(void)
 }
 #endif
 
+struct device;
+#ifdef CONFIG_SUSPEND_TIME
+extern void suspend_time_device_resumed(struct device *dev, ktime_t start);
+#else
+static inline void
+suspend_time_device_resumed(struct device *dev, ktime_t start) {}
+#endif
+
 #endif /* _LINUX_SUSPEND_H */
@@ -59,6 +59,24 @@ struct tspp_buffer {
 	int size;
 };
 
+/*
+ * Wake up poll()ers once at least this many packets are waiting, or once
+ * all the buffers are full. 0 wakes them up for every buffer.
+ */
+struct tspp_notification {
+	int packets;
+};
+
+/*
+ * A filled buffer of the channel, to be accessed through mmap() at offset
+ * in the device mapping, then handed back with TSPP_IOCTL_RELEASE_BUFFER.
+ */
+struct tspp_data_descriptor {
+	int index;
+	int offset;
+	int size;
+};
+
 /* defines for IOCTL functions */
 /* read Documentation/ioctl-number.txt */
 /* some random number to avoid coinciding with other ioctl numbers */
@@ -77,6 +95,12 @@ struct tspp_buffer {
 	_IOW(TSPP_IOCTL_BASE, 5, struct tspp_system_keys)
 #define TSPP_IOCTL_BUFFER_SIZE		\
 	_IOW(TSPP_IOCTL_BASE, 6, struct tspp_buffer)
+#define TSPP_IOCTL_SET_NOTIFICATION	\
+	_IOW(TSPP_IOCTL_BASE, 7, struct tspp_notification)
+#define TSPP_IOCTL_GET_BUFFER		\
+	_IOR(TSPP_IOCTL_BASE, 8, struct tspp_data_descriptor)
+#define TSPP_IOCTL_RELEASE_BUFFER	\
+	_IOW(TSPP_IOCTL_BASE, 9, struct tspp_data_descriptor)
 #define TSPP_IOCTL_LOOPBACK			\
 	_IOW(TSPP_IOCTL_BASE, 0xFF, int)
 
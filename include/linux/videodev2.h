@@ -1525,6 +1525,8 @@ enum v3l2_mpeg_qcom_perf_level {
 	V4L2_CID_MPEG_QCOM_PERF_LEVEL_TURBO			= 1,
 };
 
+#define V4L2_CID_MPEG_QCOM_SLICE_DELIVERY (V4L2_CID_MPEG_QCOM_BASE + 1)
+
 #define V4L2_CID_MPEG_MFC51_VIDEO_DECODER_H264_DISPLAY_DELAY		(V4L2_CID_MPEG_MFC51_BASE+0)
 #define V4L2_CID_MPEG_MFC51_VIDEO_DECODER_H264_DISPLAY_DELAY_ENABLE	(V4L2_CID_MPEG_MFC51_BASE+1)
 #define V4L2_CID_MPEG_MFC51_VIDEO_FRAME_SKIP_MODE			(V4L2_CID_MPEG_MFC51_BASE+2)
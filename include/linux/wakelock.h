@@ -48,6 +48,9 @@ struct wake_lock {
 		ktime_t         last_time;
 		ktime_t         last_unlock_time;
 		ktime_t         background_locked_time;
+		ktime_t         wakeup_awake_time;
+		u64             cpu_time;
+		u64             cpu_time_start;
 	} stat;
 #endif
 };
@@ -46,6 +46,9 @@ unsigned int wcnss_get_serial_number(void);
 void *wcnss_prealloc_get(unsigned int size);
 int wcnss_prealloc_put(void *ptr);
 
+/* Smaller allocations are left to kmalloc, they don't need high order */
+#define WCNSS_PRE_ALLOC_GET_THRESHOLD (4*1024)
+
 #define wcnss_wlan_get_drvdata(dev) dev_get_drvdata(dev)
 #define wcnss_wlan_set_drvdata(dev, data) dev_set_drvdata((dev), (data))
 
@@ -218,6 +218,28 @@
 #define MCTL_CAM_IOCTL_SET_FOCUS \
 	_IOW(MSM_CAM_IOCTL_MAGIC, 53, uint32_t)
 
+#define MSM_CAM_IOCTL_ZSL_CFG \
+	_IOW(MSM_CAM_IOCTL_MAGIC, 54, struct msm_cam_zsl_cfg *)
+
+#define MSM_CAM_IOCTL_ZSL_PICK \
+	_IOWR(MSM_CAM_IOCTL_MAGIC, 55, struct msm_cam_zsl_pick *)
+
+/* Number of done frames to hold back for image_mode, 0 turns it off */
+struct msm_cam_zsl_cfg {
+	uint32_t image_mode;
+	uint32_t depth;
+};
+
+/*
+ * Hand the held frame closest to timestamp to the user, timestamp and
+ * frame_id are updated with the ones of the frame picked.
+ */
+struct msm_cam_zsl_pick {
+	uint32_t image_mode;
+	struct timeval timestamp;
+	uint32_t frame_id;
+};
+
 struct msm_mctl_pp_cmd {
 	int32_t  id;
 	uint16_t length;
@@ -660,6 +682,23 @@ struct stats_buff {
 	int fd;
 };
 
+/*
+ * Per frame data that comes with every stats message. The stats
+ * themselves stay in the registered buffers, each buffer is named by its
+ * index among the buffers registered for its type so 3A can use its own
+ * mapping without looking the address up. An index of -1 means the
+ * message carries no buffer of that type.
+ */
+struct msm_stats_meta {
+	struct timeval sof_ts;
+	int8_t aec_idx;
+	int8_t awb_idx;
+	int8_t af_idx;
+	int8_t ihist_idx;
+	int8_t rs_idx;
+	int8_t cs_idx;
+};
+
 struct msm_stats_buf {
 	uint8_t awb_ymin;
 	struct stats_buff aec;
@@ -676,6 +715,7 @@ struct msm_stats_buf {
 	int length;
 	struct ion_handle *handle;
 	uint32_t frame_id;
+	struct msm_stats_meta meta;
 };
 #define MSM_V4L2_EXT_CAPTURE_MODE_DEFAULT 0
 /* video capture mode in VIDIOC_S_PARM */
@@ -951,6 +951,7 @@ extern void tcp_select_initial_window(int __space, __u32 mss,
 				      __u32 *rcv_wnd, __u32 *window_clamp,
 				      int wscale_ok, __u8 *rcv_wscale,
 				      __u32 init_rcv_wnd);
+extern u32 tcp_init_rcv_wnd(const struct dst_entry *dst);
 
 static inline int tcp_win_from_space(int space)
 {
@@ -65,6 +65,9 @@
 #define ASYNC_IO_MODE	0x0002
 #define SYNC_IO_MODE	0x0001
 #define NO_TIMESTAMP    0xFF00
+
+/* Set in the token of commands sent by the _nowait calls */
+#define ASM_NOWAIT_TOKEN	0x10000
 #define SET_TIMESTAMP   0x0000
 
 #define SOFT_PAUSE_ENABLE	1
@@ -222,6 +225,9 @@ int q6asm_enc_cfg_blk_aac(struct audio_client *ac,
 int q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
 			uint32_t rate, uint32_t channels);
 
+int q6asm_enc_cfg_blk_pcm_nowait(struct audio_client *ac,
+			uint32_t rate, uint32_t channels);
+
 int q6asm_enable_sbrps(struct audio_client *ac,
 			uint32_t sbr_ps);
 
@@ -248,6 +254,9 @@ int q6asm_enc_cfg_blk_amrwb(struct audio_client *ac, uint32_t frames_per_buf,
 int q6asm_media_format_block_pcm(struct audio_client *ac,
 			uint32_t rate, uint32_t channels);
 
+int q6asm_media_format_block_pcm_nowait(struct audio_client *ac,
+			uint32_t rate, uint32_t channels);
+
 int q6asm_media_format_block_multi_ch_pcm(struct audio_client *ac,
 				uint32_t rate, uint32_t channels);
 
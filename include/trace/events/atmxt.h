@@ -0,0 +1,56 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM atmxt
+
+#if !defined(_TRACE_ATMXT_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ATMXT_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(atmxt_msg_read,
+
+	TP_PROTO(unsigned int msgs, unsigned int xfers, u64 delta_us),
+
+	TP_ARGS(msgs, xfers, delta_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	msgs		)
+		__field(	unsigned int,	xfers		)
+		__field(	u64,		delta_us	)
+	),
+
+	TP_fast_assign(
+		__entry->msgs = msgs;
+		__entry->xfers = xfers;
+		__entry->delta_us = delta_us;
+	),
+
+	/* delta_us is the time since the touch IC raised its interrupt */
+	TP_printk("msgs=%u xfers=%u delta_us=%llu",
+		  __entry->msgs, __entry->xfers,
+		  (unsigned long long)__entry->delta_us)
+);
+
+TRACE_EVENT(atmxt_input_sync,
+
+	TP_PROTO(unsigned int touches, u64 delta_us),
+
+	TP_ARGS(touches, delta_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	touches		)
+		__field(	u64,		delta_us	)
+	),
+
+	TP_fast_assign(
+		__entry->touches = touches;
+		__entry->delta_us = delta_us;
+	),
+
+	TP_printk("touches=%u delta_us=%llu",
+		  __entry->touches, (unsigned long long)__entry->delta_us)
+);
+
+#endif /* _TRACE_ATMXT_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
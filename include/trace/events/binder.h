@@ -0,0 +1,100 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM binder
+
+#if !defined(_TRACE_BINDER_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_BINDER_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(binder_transaction,
+
+	TP_PROTO(int debug_id, int reply, unsigned int flags, int to_proc,
+		 int to_thread, int to_node, unsigned int code),
+
+	TP_ARGS(debug_id, reply, flags, to_proc, to_thread, to_node, code),
+
+	TP_STRUCT__entry(
+		__field(	int,		debug_id	)
+		__field(	int,		reply		)
+		__field(	unsigned int,	flags		)
+		__field(	int,		to_proc		)
+		__field(	int,		to_thread	)
+		__field(	int,		to_node		)
+		__field(	unsigned int,	code		)
+	),
+
+	TP_fast_assign(
+		__entry->debug_id = debug_id;
+		__entry->reply = reply;
+		__entry->flags = flags;
+		__entry->to_proc = to_proc;
+		__entry->to_thread = to_thread;
+		__entry->to_node = to_node;
+		__entry->code = code;
+	),
+
+	TP_printk("transaction=%d dest_node=%d dest_proc=%d dest_thread=%d "
+		  "reply=%d flags=0x%x code=0x%x",
+		  __entry->debug_id, __entry->to_node, __entry->to_proc,
+		  __entry->to_thread, __entry->reply, __entry->flags,
+		  __entry->code)
+);
+
+/* wakeup_us is the time from queueing to the target thread reading it */
+TRACE_EVENT(binder_transaction_received,
+
+	TP_PROTO(int debug_id, int to_node, u64 wakeup_us),
+
+	TP_ARGS(debug_id, to_node, wakeup_us),
+
+	TP_STRUCT__entry(
+		__field(	int,		debug_id	)
+		__field(	int,		to_node		)
+		__field(	u64,		wakeup_us	)
+	),
+
+	TP_fast_assign(
+		__entry->debug_id = debug_id;
+		__entry->to_node = to_node;
+		__entry->wakeup_us = wakeup_us;
+	),
+
+	TP_printk("transaction=%d dest_node=%d wakeup_us=%llu",
+		  __entry->debug_id, __entry->to_node,
+		  (unsigned long long)__entry->wakeup_us)
+);
+
+/*
+ * reply_us is the time the caller has been waiting, service_us the part
+ * of it the target spent after reading the transaction.
+ */
+TRACE_EVENT(binder_transaction_reply,
+
+	TP_PROTO(int debug_id, int to_node, u64 reply_us, u64 service_us),
+
+	TP_ARGS(debug_id, to_node, reply_us, service_us),
+
+	TP_STRUCT__entry(
+		__field(	int,		debug_id	)
+		__field(	int,		to_node		)
+		__field(	u64,		reply_us	)
+		__field(	u64,		service_us	)
+	),
+
+	TP_fast_assign(
+		__entry->debug_id = debug_id;
+		__entry->to_node = to_node;
+		__entry->reply_us = reply_us;
+		__entry->service_us = service_us;
+	),
+
+	TP_printk("transaction=%d dest_node=%d reply_us=%llu service_us=%llu",
+		  __entry->debug_id, __entry->to_node,
+		  (unsigned long long)__entry->reply_us,
+		  (unsigned long long)__entry->service_us)
+);
+
+#endif /* _TRACE_BINDER_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
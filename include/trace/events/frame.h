@@ -0,0 +1,93 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM frame
+
+#if !defined(_TRACE_FRAME_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FRAME_H
+
+#include <linux/tracepoint.h>
+
+/*
+ * One frame id follows an input event through the GPU to the display, see
+ * linux/frame_trace.h. Touch to photon latency of frame N is the time from
+ * frame_input id=N to the first frame_scanout id=N.
+ */
+TRACE_EVENT(frame_input,
+
+	TP_PROTO(u32 id, unsigned int touches),
+
+	TP_ARGS(id, touches),
+
+	TP_STRUCT__entry(
+		__field(	u32,		id		)
+		__field(	unsigned int,	touches		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->touches = touches;
+	),
+
+	TP_printk("id=%u touches=%u", __entry->id, __entry->touches)
+);
+
+TRACE_EVENT(frame_gpu_submit,
+
+	TP_PROTO(u32 id, unsigned int context, unsigned int timestamp),
+
+	TP_ARGS(id, context, timestamp),
+
+	TP_STRUCT__entry(
+		__field(	u32,		id		)
+		__field(	unsigned int,	context		)
+		__field(	unsigned int,	timestamp	)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->context = context;
+		__entry->timestamp = timestamp;
+	),
+
+	TP_printk("id=%u ctx=%u ts=%u",
+		  __entry->id, __entry->context, __entry->timestamp)
+);
+
+DECLARE_EVENT_CLASS(frame_display,
+
+	TP_PROTO(u32 id, unsigned int count),
+
+	TP_ARGS(id, count),
+
+	TP_STRUCT__entry(
+		__field(	u32,		id		)
+		__field(	unsigned int,	count		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->count = count;
+	),
+
+	TP_printk("id=%u count=%u", __entry->id, __entry->count)
+);
+
+/* the display engine starts fetching the frame */
+DEFINE_EVENT(frame_display, frame_kickoff,
+
+	TP_PROTO(u32 id, unsigned int count),
+
+	TP_ARGS(id, count)
+);
+
+/* the frame has been sent to the panel */
+DEFINE_EVENT(frame_display, frame_scanout,
+
+	TP_PROTO(u32 id, unsigned int count),
+
+	TP_ARGS(id, count)
+);
+
+#endif /* _TRACE_FRAME_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,107 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ion
+
+#if !defined(_TRACE_ION_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ION_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(ion_alloc,
+
+	TP_PROTO(const char *client, const char *heap, size_t len,
+		 size_t align, unsigned int flags, int ret, u64 delta_us),
+
+	TP_ARGS(client, heap, len, align, flags, ret, delta_us),
+
+	TP_STRUCT__entry(
+		__string(	client,		client	)
+		__string(	heap,		heap	)
+		__field(	size_t,		len	)
+		__field(	size_t,		align	)
+		__field(	unsigned int,	flags	)
+		__field(	int,		ret	)
+		__field(	u64,		delta_us)
+	),
+
+	TP_fast_assign(
+		__assign_str(client, client);
+		__assign_str(heap, heap);
+		__entry->len = len;
+		__entry->align = align;
+		__entry->flags = flags;
+		__entry->ret = ret;
+		__entry->delta_us = delta_us;
+	),
+
+	TP_printk("client=%s heap=%s len=%zu align=%zu flags=%x ret=%d "
+		  "delta_us=%llu",
+		  __get_str(client), __get_str(heap), __entry->len,
+		  __entry->align, __entry->flags, __entry->ret,
+		  (unsigned long long)__entry->delta_us)
+);
+
+TRACE_EVENT(ion_free,
+
+	TP_PROTO(const char *client, const char *heap, size_t len),
+
+	TP_ARGS(client, heap, len),
+
+	TP_STRUCT__entry(
+		__string(	client,		client	)
+		__string(	heap,		heap	)
+		__field(	size_t,		len	)
+	),
+
+	TP_fast_assign(
+		__assign_str(client, client);
+		__assign_str(heap, heap);
+		__entry->len = len;
+	),
+
+	TP_printk("client=%s heap=%s len=%zu",
+		  __get_str(client), __get_str(heap), __entry->len)
+);
+
+TRACE_EVENT(ion_map_iommu,
+
+	TP_PROTO(const char *client, const char *heap, int domain,
+		 int partition, unsigned long iova_length, int mapped,
+		 int ret, u64 delta_us),
+
+	TP_ARGS(client, heap, domain, partition, iova_length, mapped, ret,
+		delta_us),
+
+	TP_STRUCT__entry(
+		__string(	client,		client		)
+		__string(	heap,		heap		)
+		__field(	int,		domain		)
+		__field(	int,		partition	)
+		__field(	unsigned long,	iova_length	)
+		__field(	int,		mapped		)
+		__field(	int,		ret		)
+		__field(	u64,		delta_us	)
+	),
+
+	TP_fast_assign(
+		__assign_str(client, client);
+		__assign_str(heap, heap);
+		__entry->domain = domain;
+		__entry->partition = partition;
+		__entry->iova_length = iova_length;
+		__entry->mapped = mapped;
+		__entry->ret = ret;
+		__entry->delta_us = delta_us;
+	),
+
+	/* mapped is 1 when an existing mapping of the buffer was reused */
+	TP_printk("client=%s heap=%s domain=%d partition=%d len=%lx "
+		  "mapped=%d ret=%d delta_us=%llu",
+		  __get_str(client), __get_str(heap), __entry->domain,
+		  __entry->partition, __entry->iova_length, __entry->mapped,
+		  __entry->ret, (unsigned long long)__entry->delta_us)
+);
+
+#endif /* _TRACE_ION_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,108 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM smd
+
+#if !defined(_TRACE_SMD_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SMD_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(smd_xfer,
+
+	TP_PROTO(const char *name, unsigned type, int len, unsigned fifo),
+
+	TP_ARGS(name, type, len, fifo),
+
+	TP_STRUCT__entry(
+		__string(	name,	name	)
+		__field(	unsigned,	type	)
+		__field(	int,		len	)
+		__field(	unsigned,	fifo	)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->type = type;
+		__entry->len = len;
+		__entry->fifo = fifo;
+	),
+
+	TP_printk("ch=%s edge=%u len=%d fifo=%u",
+		  __get_str(name), __entry->type, __entry->len, __entry->fifo)
+);
+
+DEFINE_EVENT(smd_xfer, smd_write,
+
+	TP_PROTO(const char *name, unsigned type, int len, unsigned fifo),
+
+	TP_ARGS(name, type, len, fifo)
+);
+
+DEFINE_EVENT(smd_xfer, smd_read,
+
+	TP_PROTO(const char *name, unsigned type, int len, unsigned fifo),
+
+	TP_ARGS(name, type, len, fifo)
+);
+
+DECLARE_EVENT_CLASS(smd_latency,
+
+	TP_PROTO(const char *name, unsigned type, u64 delta_ns),
+
+	TP_ARGS(name, type, delta_ns),
+
+	TP_STRUCT__entry(
+		__string(	name,	name	)
+		__field(	unsigned,	type	)
+		__field(	u64,		delta_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->type = type;
+		__entry->delta_ns = delta_ns;
+	),
+
+	TP_printk("ch=%s edge=%u delta_ns=%llu",
+		  __get_str(name), __entry->type,
+		  (unsigned long long)__entry->delta_ns)
+);
+
+/* time from a local write until the remote processor reported a read */
+DEFINE_EVENT(smd_latency, smd_remote_read,
+
+	TP_PROTO(const char *name, unsigned type, u64 delta_ns),
+
+	TP_ARGS(name, type, delta_ns)
+);
+
+/* time from the SMD interrupt until the client was notified */
+DEFINE_EVENT(smd_latency, smd_rx_notify,
+
+	TP_PROTO(const char *name, unsigned type, u64 delta_ns),
+
+	TP_ARGS(name, type, delta_ns)
+);
+
+TRACE_EVENT(smd_read_intr_blocked,
+
+	TP_PROTO(const char *name, unsigned type),
+
+	TP_ARGS(name, type),
+
+	TP_STRUCT__entry(
+		__string(	name,	name	)
+		__field(	unsigned,	type	)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->type = type;
+	),
+
+	TP_printk("ch=%s edge=%u", __get_str(name), __entry->type)
+);
+
+#endif /* _TRACE_SMD_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -1373,6 +1373,7 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 			list_add_tail_rcu(&p->tasks, &init_task.tasks);
 			__this_cpu_inc(process_counts);
 		}
+		lowmem_task_add(p);
 		attach_pid(p, PIDTYPE_PID, pid);
 		nr_threads++;
 	}
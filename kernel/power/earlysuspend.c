@@ -36,6 +36,9 @@ static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
 static DECLARE_WORK(late_resume_work, late_resume);
+static void late_resume_async(struct work_struct *work);
+static DECLARE_WORK(late_resume_async_work, late_resume_async);
+static struct workqueue_struct *late_resume_async_wq;
 static DEFINE_SPINLOCK(state_lock);
 enum {
 	SUSPEND_REQUESTED = 0x1,
@@ -120,11 +123,30 @@ abort:
 	spin_unlock_irqrestore(&state_lock, irqflags);
 }
 
+/*
+ * Runs the resume_async handlers while late_resume() goes on with the
+ * others. late_resume() holds early_suspend_lock until this is done.
+ */
+static void late_resume_async(struct work_struct *work)
+{
+	struct early_suspend *pos;
+
+	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
+		if (pos->resume_async && pos->resume != NULL) {
+			if (debug_mask & DEBUG_VERBOSE)
+				pr_info("late_resume: calling %pf async\n",
+					pos->resume);
+			pos->resume(pos);
+		}
+	}
+}
+
 static void late_resume(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int async_level = INT_MIN;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -141,7 +163,27 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
+
+	/* Get the display going first, the list is sorted by level */
+	if (late_resume_async_wq) {
+		list_for_each_entry(pos, &early_suspend_handlers, link) {
+			if (pos->resume_async && pos->resume != NULL) {
+				async_level = pos->level;
+				break;
+			}
+		}
+		if (async_level != INT_MIN)
+			queue_work(late_resume_async_wq,
+				   &late_resume_async_work);
+	}
+
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
+		if (async_level != INT_MIN && pos->level < async_level) {
+			flush_work(&late_resume_async_work);
+			async_level = INT_MIN;
+		}
+		if (pos->resume_async && late_resume_async_wq)
+			continue;
 		if (pos->resume != NULL) {
 			if (debug_mask & DEBUG_VERBOSE)
 				pr_info("late_resume: calling %pf\n", pos->resume);
@@ -149,6 +191,8 @@ static void late_resume(struct work_struct *work)
 			pos->resume(pos);
 		}
 	}
+	if (async_level != INT_MIN)
+		flush_work(&late_resume_async_work);
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
@@ -195,6 +239,15 @@ suspend_state_t get_suspend_state(void)
 	return requested_suspend_state;
 }
 
+static int __init early_suspend_init(void)
+{
+	/* Without it the resume_async handlers just run in order */
+	late_resume_async_wq = alloc_workqueue("late_resume_async",
+					       WQ_HIGHPRI | WQ_UNBOUND, 1);
+	return 0;
+}
+core_initcall(early_suspend_init);
+
 #ifdef CONFIG_PM_DEBUG
 /**
  *      stuck_wakelock_timeout - stuck wakelocks dump watchdog
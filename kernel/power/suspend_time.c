@@ -15,16 +15,52 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/suspend.h>
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+/* The devices slowest to resume last time, slowest first */
+#define SLOW_RESUME_DEVICES	8
+
+struct slow_resume_device {
+	char name[32];
+	s64 usecs;
+};
+
+static struct slow_resume_device slow_resume_devices[SLOW_RESUME_DEVICES];
+static DEFINE_SPINLOCK(slow_resume_lock);
+
+/* Called from device_resume(), possibly from several async threads */
+void suspend_time_device_resumed(struct device *dev, ktime_t start)
+{
+	s64 usecs = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&slow_resume_lock, flags);
+	for (i = 0; i < SLOW_RESUME_DEVICES; i++)
+		if (usecs > slow_resume_devices[i].usecs)
+			break;
+	if (i < SLOW_RESUME_DEVICES) {
+		memmove(&slow_resume_devices[i + 1], &slow_resume_devices[i],
+			(SLOW_RESUME_DEVICES - i - 1) *
+			sizeof(slow_resume_devices[0]));
+		strlcpy(slow_resume_devices[i].name, dev_name(dev),
+			sizeof(slow_resume_devices[i].name));
+		slow_resume_devices[i].usecs = usecs;
+	}
+	spin_unlock_irqrestore(&slow_resume_lock, flags);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -38,6 +74,17 @@ static int suspend_time_debug_show(struct seq_file *s, void *data)
 			bin ? 1 << (bin - 1) : 0, 1 << bin,
 				time_in_suspend_bins[bin]);
 	}
+
+	seq_printf(s, "\nslowest device resumes (usecs)\n");
+	seq_printf(s, "------------------------------\n");
+	spin_lock_irq(&slow_resume_lock);
+	for (bin = 0; bin < SLOW_RESUME_DEVICES; bin++) {
+		if (!slow_resume_devices[bin].usecs)
+			break;
+		seq_printf(s, "%-32s %8lld\n", slow_resume_devices[bin].name,
+			   slow_resume_devices[bin].usecs);
+	}
+	spin_unlock_irq(&slow_resume_lock);
 	return 0;
 }
 
@@ -74,6 +121,9 @@ static int suspend_time_syscore_suspend(void)
 {
 	read_persistent_clock(&suspend_time_before);
 
+	/* Devices are all suspended, start over for this resume */
+	memset(slow_resume_devices, 0, sizeof(slow_resume_devices));
+
 	return 0;
 }
 
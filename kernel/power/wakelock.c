@@ -22,6 +22,7 @@
 #ifdef CONFIG_WAKELOCK_STAT
 #include <linux/proc_fs.h>
 #include <linux/earlysuspend.h>
+#include <linux/kernel_stat.h>
 #endif
 #include "power.h"
 
@@ -70,6 +71,41 @@ static int early_suspend_called;
 static ktime_t early_suspend_time;
 static ktime_t wakeup_time;
 
+/*
+ * The lock that woke the system from suspend is charged with the time the
+ * system then stays awake, until it suspends again or the screen turns on.
+ */
+static struct wake_lock *wakeup_lock;
+static ktime_t wakeup_lock_time;
+
+static void charge_wakeup_lock_locked(void)
+{
+	if (!wakeup_lock)
+		return;
+	wakeup_lock->stat.wakeup_awake_time = ktime_add(
+		wakeup_lock->stat.wakeup_awake_time,
+		ktime_sub(ktime_get(), wakeup_lock_time));
+	wakeup_lock = NULL;
+}
+
+/* Cpu time, in ns, used by the whole system so far */
+static u64 system_cpu_time(void)
+{
+	cputime64_t busy = cputime64_zero;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_usage_stat *cs = &kstat_cpu(cpu).cpustat;
+
+		busy = cputime64_add(busy, cs->user);
+		busy = cputime64_add(busy, cs->nice);
+		busy = cputime64_add(busy, cs->system);
+		busy = cputime64_add(busy, cs->irq);
+		busy = cputime64_add(busy, cs->softirq);
+	}
+	return cputime64_to_jiffies64(busy) * TICK_NSEC;
+}
+
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 {
 	struct timespec ts;
@@ -100,6 +136,7 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 	ktime_t active_time = ktime_set(0, 0);
 	ktime_t total_time = lock->stat.total_time;
 	ktime_t max_time = lock->stat.max_time;
+	u64 cpu_time = lock->stat.cpu_time;
 
 	ktime_t prevent_suspend_time = lock->stat.prevent_suspend_time;
 	if (lock->flags & WAKE_LOCK_ACTIVE) {
@@ -119,21 +156,31 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 					ktime_sub(now, last_sleep_time_update));
 		if (add_time.tv64 > max_time.tv64)
 			max_time = add_time;
+		if (!expired)
+			cpu_time += system_cpu_time() -
+				    lock->stat.cpu_time_start;
 	}
 
 	return seq_printf(m,
-		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld"
+		     "\t%lld\t%llu\n",
 		     lock->name, lock_count, expire_count,
 		     lock->stat.wakeup_count, ktime_to_ns(active_time),
 		     ktime_to_ns(total_time),
 		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
-		     ktime_to_ns(lock->stat.last_time));
+		     ktime_to_ns(lock->stat.last_time),
+		     ktime_to_ns(lock->stat.wakeup_awake_time), cpu_time);
 }
 
+/*
+ * wake_time is how long the system stayed up after the wakeups the lock
+ * caused, cpu_time the cpu time the whole system used while it was held.
+ */
 static int wakelock_stat_headers(struct seq_file *m)
 {
 	seq_printf(m, "name\tcount\texpire_count\twake_count\tactive_since"
-			"\ttotal_time\tsleep_time\tmax_time\tlast_change\n");
+			"\ttotal_time\tsleep_time\tmax_time\tlast_change"
+			"\twake_time\tcpu_time\n");
 	return 0;
 }
 
@@ -205,6 +252,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	lock->stat.count++;
 	if (expired)
 		lock->stat.expire_count++;
+	lock->stat.cpu_time += system_cpu_time() - lock->stat.cpu_time_start;
 	if (early_suspend_called) {
 		if (ktime_to_ns(lock->stat.last_unlock_time)
 				< ktime_to_ns(early_suspend_time))
@@ -501,6 +549,13 @@ static int power_suspend_late(struct device *dev)
 {
 	int ret = has_wake_lock(WAKE_LOCK_SUSPEND) ? -EAGAIN : 0;
 #ifdef CONFIG_WAKELOCK_STAT
+	unsigned long irqflags;
+
+	if (!ret) {
+		spin_lock_irqsave(&list_lock, irqflags);
+		charge_wakeup_lock_locked();
+		spin_unlock_irqrestore(&list_lock, irqflags);
+	}
 	wait_for_wakeup = !ret;
 	if (longest_background_lock && longest_background_lock->flags
 			& WAKE_LOCK_INITIALIZED) {
@@ -528,9 +583,21 @@ static void power_early_suspend(struct early_suspend *h)
 	longest = 0;
 	longest_background_lock = NULL;
 }
+
+static void power_late_resume(struct early_suspend *h)
+{
+	unsigned long irqflags;
+
+	/* The user is up, the time awake is no longer the wakeup's */
+	spin_lock_irqsave(&list_lock, irqflags);
+	charge_wakeup_lock_locked();
+	spin_unlock_irqrestore(&list_lock, irqflags);
+}
+
 static struct early_suspend power_early_suspend_desc = {
 	.level = EARLY_SUSPEND_LEVEL_STOP_DRAWING,
 	.suspend = power_early_suspend,
+	.resume = power_late_resume,
 };
 #endif
 
@@ -566,6 +633,8 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.last_time = ktime_set(0, 0);
 	lock->stat.last_unlock_time = ktime_set(0, 0);
 	lock->stat.background_locked_time = ktime_set(0, 0);
+	lock->stat.wakeup_awake_time = ktime_set(0, 0);
+	lock->stat.cpu_time = 0;
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
@@ -596,7 +665,16 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		deleted_wake_locks.stat.cpu_time += lock->stat.cpu_time;
 	}
+	if (wakeup_lock == lock)
+		charge_wakeup_lock_locked();
+	deleted_wake_locks.stat.wakeup_count += lock->stat.wakeup_count;
+	deleted_wake_locks.stat.wakeup_awake_time =
+		ktime_add(deleted_wake_locks.stat.wakeup_awake_time,
+			  lock->stat.wakeup_awake_time);
+	if (longest_background_lock == lock)
+		longest_background_lock = NULL;
 #endif
 	list_del(&lock->link);
 	spin_unlock_irqrestore(&list_lock, irqflags);
@@ -620,11 +698,14 @@ static void wake_lock_internal(
 			pr_info("wakeup wake lock: %s\n", lock->name);
 		wait_for_wakeup = 0;
 		lock->stat.wakeup_count++;
+		wakeup_lock = lock;
+		wakeup_lock_time = ktime_get();
 	}
 	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
 	    (long)(lock->expires - jiffies) <= 0) {
 		wake_unlock_stat_locked(lock, 0);
 		lock->stat.last_time = ktime_get();
+		lock->stat.cpu_time_start = system_cpu_time();
 	}
 	wakeup_time = ktime_get();
 #endif
@@ -632,6 +713,7 @@ static void wake_lock_internal(
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
 		lock->stat.last_time = ktime_get();
+		lock->stat.cpu_time_start = system_cpu_time();
 #endif
 	}
 	list_del(&lock->link);
@@ -72,6 +72,7 @@
 #include <linux/ftrace.h>
 #include <linux/slab.h>
 #include <linux/cpuacct.h>
+#include <linux/cpufreq.h>
 
 #include <asm/tlb.h>
 #include <asm/irq_regs.h>
@@ -1198,6 +1199,13 @@ static void resched_cpu(int cpu)
 }
 
 #ifdef CONFIG_NO_HZ
+/*
+ * Cpu taking the timers migrated away from idle cpus, and all the
+ * deferrable ones, so the other cores can stay in power collapse.
+ * -1 picks the nearest busy cpu instead.
+ */
+int sysctl_timer_housekeeping_cpu = -1;
+
 /*
  * In the semi idle case, use the nearest busy cpu for migrating timers
  * from an idle cpu.  This is good for power-savings.
@@ -1209,9 +1217,13 @@ static void resched_cpu(int cpu)
 int get_nohz_timer_target(void)
 {
 	int cpu = smp_processor_id();
+	int hk_cpu = ACCESS_ONCE(sysctl_timer_housekeeping_cpu);
 	int i;
 	struct sched_domain *sd;
 
+	if (hk_cpu >= 0 && hk_cpu < nr_cpu_ids && cpu_online(hk_cpu))
+		return hk_cpu;
+
 	rcu_read_lock();
 	for_each_domain(cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
@@ -2039,6 +2051,31 @@ static void update_rq_clock_task(struct rq *rq, s64 delta)
 
 #endif /* CONFIG_IRQ_TIME_ACCOUNTING */
 
+#ifdef CONFIG_SMP
+/*
+ * Cpus taken out of scheduling while staying online, see
+ * sched_isolate_cpu().
+ */
+static struct cpumask sched_isolated_cpus;
+
+static inline int cpu_isolated(int cpu)
+{
+	return cpumask_test_cpu(cpu, &sched_isolated_cpus);
+}
+
+/* An allowed cpu for @p that is not isolated, nr_cpu_ids if none */
+static int isolation_dest_cpu(struct task_struct *p)
+{
+	int cpu;
+
+	for_each_cpu_and(cpu, tsk_cpus_allowed(p), cpu_active_mask) {
+		if (!cpu_isolated(cpu))
+			return cpu;
+	}
+	return nr_cpu_ids;
+}
+#endif
+
 #include "sched_idletask.c"
 #include "sched_fair.c"
 #include "sched_rt.c"
@@ -2466,6 +2503,14 @@ int select_task_rq(struct task_struct *p, int sd_flags, int wake_flags)
 		     !cpu_online(cpu)))
 		cpu = select_fallback_rq(task_cpu(p), p);
 
+	/* Tasks bound to an isolated cpu alone still go there */
+	if (unlikely(cpu_isolated(cpu))) {
+		int dest_cpu = isolation_dest_cpu(p);
+
+		if (dest_cpu < nr_cpu_ids)
+			cpu = dest_cpu;
+	}
+
 	return cpu;
 }
 
@@ -2704,6 +2749,37 @@ static void ttwu_queue(struct task_struct *p, int cpu)
 	raw_spin_unlock(&rq->lock);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Tells cpufreq governors when a wakeup places a task on another cpu, so
+ * the destination can be sped up before its idle based load catches up.
+ */
+static ATOMIC_NOTIFIER_HEAD(task_migration_notifier);
+
+int register_task_migration_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&task_migration_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(register_task_migration_notifier);
+
+int unregister_task_migration_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_unregister(&task_migration_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(unregister_task_migration_notifier);
+
+static void task_migration_notify(struct task_struct *p, int src_cpu,
+				  int dest_cpu)
+{
+	struct migration_notify_data mnd;
+
+	mnd.src_cpu = src_cpu;
+	mnd.dest_cpu = dest_cpu;
+	mnd.load = task_load(p);
+	atomic_notifier_call_chain(&task_migration_notifier, 0, &mnd);
+}
+#endif
+
 /**
  * try_to_wake_up - wake up a thread
  * @p: the thread to be awakened
@@ -2724,6 +2800,9 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 {
 	unsigned long flags;
 	int cpu, success = 0;
+#ifdef CONFIG_SMP
+	int src_cpu = -1;
+#endif
 
 	smp_wmb();
 	raw_spin_lock_irqsave(&p->pi_lock, flags);
@@ -2769,6 +2848,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 
 	cpu = select_task_rq(p, SD_BALANCE_WAKE, wake_flags);
 	if (task_cpu(p) != cpu) {
+		src_cpu = task_cpu(p);
 		wake_flags |= WF_MIGRATED;
 		set_task_cpu(p, cpu);
 	}
@@ -2780,6 +2860,12 @@ stat:
 out:
 	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
 
+#ifdef CONFIG_SMP
+	/* Outside pi_lock, notifiers may wake up their own threads */
+	if (src_cpu >= 0)
+		task_migration_notify(p, src_cpu, cpu);
+#endif
+
 	return success;
 }
 
@@ -2856,6 +2942,9 @@ static void __sched_fork(struct task_struct *p)
 	p->se.nr_migrations		= 0;
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
+#ifdef CONFIG_SMP
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+#endif
 
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
@@ -3785,6 +3874,7 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 		cpustat->user = cputime64_add(cpustat->user, tmp);
 
 	cpuacct_update_stats(p, CPUACCT_STAT_USER, cputime);
+	cpufreq_stats_account_uid(p, cputime);
 	/* Account for user time used */
 	acct_update_integrals(p);
 }
@@ -3840,6 +3930,7 @@ void __account_system_time(struct task_struct *p, cputime_t cputime,
 	/* Add system time to cpustat. */
 	*target_cputime64 = cputime64_add(*target_cputime64, tmp);
 	cpuacct_update_stats(p, CPUACCT_STAT_SYSTEM, cputime);
+	cpufreq_stats_account_uid(p, cputime);
 
 	/* Account for system time used */
 	acct_update_integrals(p);
@@ -6189,6 +6280,106 @@ static int migration_cpu_stop(void *data)
 	return 0;
 }
 
+/*
+ * Isolating a cpu keeps it online but out of scheduling: the tasks that
+ * can run elsewhere are moved off, and wakeups and load balancing stay away
+ * from it, so it idles into its deepest idle state. Neither stop_machine
+ * nor the hotplug notifiers are involved, and sched_unisolate_cpu() only
+ * clears a bit and kicks the cpu to pull work. Tasks bound to the cpu
+ * alone keep running there.
+ */
+static DEFINE_MUTEX(sched_isolation_mutex);
+
+int sched_isolate_cpu(int cpu)
+{
+	struct task_struct *g, *p;
+	struct migration_arg arg;
+	int dest_cpu, i;
+	int ret = 0;
+
+	if (cpu < 0 || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	mutex_lock(&sched_isolation_mutex);
+
+	if (!cpu_online(cpu)) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if (cpu_isolated(cpu))
+		goto out;
+
+	/* Leave somewhere for everybody else to run */
+	for_each_online_cpu(i)
+		if (i != cpu && !cpu_isolated(i))
+			break;
+	if (i >= nr_cpu_ids) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	cpumask_set_cpu(cpu, &sched_isolated_cpus);
+
+	/* Wakeups placing tasks from now on see the bit */
+	synchronize_sched();
+
+	read_lock(&tasklist_lock);
+	do_each_thread(g, p) {
+		if (task_cpu(p) != cpu || !p->on_rq || p == cpu_curr(cpu))
+			continue;
+		dest_cpu = isolation_dest_cpu(p);
+		if (dest_cpu >= nr_cpu_ids)
+			continue;
+		local_irq_disable();
+		__migrate_task(p, cpu, dest_cpu);
+		local_irq_enable();
+	} while_each_thread(g, p);
+	read_unlock(&tasklist_lock);
+
+	/* The running task is moved off by the cpu's stopper */
+	rcu_read_lock();
+	p = cpu_curr(cpu);
+	dest_cpu = p == idle_task(cpu) ? nr_cpu_ids : isolation_dest_cpu(p);
+	if (dest_cpu < nr_cpu_ids)
+		get_task_struct(p);
+	rcu_read_unlock();
+
+	if (dest_cpu < nr_cpu_ids) {
+		arg.task = p;
+		arg.dest_cpu = dest_cpu;
+		stop_one_cpu(cpu, migration_cpu_stop, &arg);
+		put_task_struct(p);
+	}
+
+	/* Idle again, without nohz balancing duty */
+	resched_cpu(cpu);
+out:
+	mutex_unlock(&sched_isolation_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sched_isolate_cpu);
+
+int sched_unisolate_cpu(int cpu)
+{
+	if (cpu < 0 || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	mutex_lock(&sched_isolation_mutex);
+	if (cpumask_test_and_clear_cpu(cpu, &sched_isolated_cpus) &&
+	    cpu_online(cpu))
+		resched_cpu(cpu);	/* idle_balance() pulls work over */
+	mutex_unlock(&sched_isolation_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sched_unisolate_cpu);
+
+int sched_cpu_isolated(int cpu)
+{
+	return cpu_isolated(cpu);
+}
+EXPORT_SYMBOL_GPL(sched_cpu_isolated);
+
 #ifdef CONFIG_HOTPLUG_CPU
 
 /*
@@ -6517,6 +6708,7 @@ migration_call(struct notifier_block *nfb, unsigned long action, void *hcpu)
 		migrate_tasks(cpu);
 		BUG_ON(rq->nr_running != 1); /* the migration thread */
 		raw_spin_unlock_irqrestore(&rq->lock, flags);
+		cpumask_clear_cpu(cpu, &sched_isolated_cpus);
 
 		migrate_nr_uninterruptible(rq);
 		calc_global_load_remove(rq);
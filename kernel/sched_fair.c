@@ -80,6 +80,14 @@ unsigned int sysctl_sched_child_runs_first __read_mostly;
 unsigned int sysctl_sched_wakeup_granularity = 1000000UL;
 unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
+/*
+ * Power aware placement: tasks running less than this between sleeps on
+ * average are kept on cpus already running rather than waking cpus out of
+ * a deep idle state. 0 disables it.
+ * (default: 0, units: nanoseconds)
+ */
+unsigned int sysctl_sched_small_task = 0UL;
+
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
 /*
@@ -1316,6 +1324,100 @@ static inline void hrtick_update(struct rq *rq)
 }
 #endif
 
+#ifdef CONFIG_SMP
+/*
+ * Per task load tracking. Time is cut in periods of 1024 units of 1024ns
+ * and the time a task was runnable, running or waiting, is summed with
+ * each period weighing y times the one after it, y^32 = 1/2. The same
+ * sum over all elapsed time gives the ratio reported by task_load(), which
+ * reacts within some tens of ms to a task changing behaviour yet does not
+ * forget a heavy task over a short sleep.
+ */
+#define LOAD_AVG_PERIOD		1024
+#define LOAD_AVG_HALFLIFE	32
+#define LOAD_AVG_MAX		47662	/* sum of 1024 * y^n, n = 0.. */
+
+static u32 decay_load(u64 val, u64 n)
+{
+	if (n / LOAD_AVG_HALFLIFE >= 32)
+		return 0;
+
+	val >>= n / LOAD_AVG_HALFLIFE;
+	n %= LOAD_AVG_HALFLIFE;
+	while (n--)
+		val = (val * 1002) >> 10;	/* y ~= 1002 / 1024 */
+
+	return val;
+}
+
+static void update_task_load(struct sched_entity *se, u64 now, int runnable)
+{
+	struct sched_avg *sa = &se->avg;
+	u64 delta = now - sa->last_update;
+	u64 periods;
+	u32 contrib;
+
+	/* rq clocks are per cpu, a migrated task may see time go back */
+	if ((s64)delta < 0) {
+		sa->last_update = now;
+		return;
+	}
+
+	delta >>= 10;
+	if (!delta)
+		return;
+	sa->last_update += delta << 10;
+
+	if (sa->period_contrib + delta >= LOAD_AVG_PERIOD) {
+		/* Complete the current period, then decay it with the rest */
+		contrib = LOAD_AVG_PERIOD - sa->period_contrib;
+		if (runnable)
+			sa->runnable_sum += contrib;
+		sa->period_sum += contrib;
+		delta -= contrib;
+
+		periods = div_u64_rem(delta, LOAD_AVG_PERIOD, &contrib);
+		delta = contrib;
+		sa->runnable_sum = decay_load(sa->runnable_sum, periods + 1);
+		sa->period_sum = decay_load(sa->period_sum, periods + 1);
+
+		/* The whole periods in between */
+		contrib = decay_load(LOAD_AVG_MAX -
+				     decay_load(LOAD_AVG_MAX, periods), 1);
+		if (runnable)
+			sa->runnable_sum += contrib;
+		sa->period_sum += contrib;
+		sa->period_contrib = 0;
+	}
+
+	sa->period_contrib += delta;
+	if (runnable)
+		sa->runnable_sum += delta;
+	sa->period_sum += delta;
+}
+
+/*
+ * Percentage of its recent time @p has been runnable, comparable to the
+ * cpu load the cpufreq governors compute from idle time.
+ */
+unsigned int task_load(struct task_struct *p)
+{
+	struct sched_avg *sa = &p->se.avg;
+	u32 period_sum = ACCESS_ONCE(sa->period_sum);
+
+	if (!period_sum)
+		return 0;
+
+	return min_t(u32, ACCESS_ONCE(sa->runnable_sum) * 100 / period_sum,
+		     100);
+}
+#else
+static inline void
+update_task_load(struct sched_entity *se, u64 now, int runnable)
+{
+}
+#endif
+
 /*
  * The enqueue_task method is called before nr_running is
  * increased. Here we update the fair scheduling stats and
@@ -1327,6 +1429,8 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
 
+	update_task_load(se, rq->clock_task, 0);
+
 	for_each_sched_entity(se) {
 		if (se->on_rq)
 			break;
@@ -1358,6 +1462,8 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct sched_entity *se = &p->se;
 	int task_sleep = flags & DEQUEUE_SLEEP;
 
+	update_task_load(se, rq->clock_task, 1);
+
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, flags);
@@ -1382,11 +1488,40 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		update_cfs_shares(cfs_rq);
 	}
 
+	if (task_sleep) {
+		s64 diff = p->se.sum_exec_runtime - p->se.prev_sum_exec_runtime -
+			   p->se.avg_burst;
+
+		p->se.avg_burst += diff >> 3;
+	}
+
 	hrtick_update(rq);
 }
 
 #ifdef CONFIG_SMP
 
+/*
+ * Set by the platform idle code while a cpu is in a state that is slow and
+ * costly to leave, such as power collapse.
+ */
+static DEFINE_PER_CPU(int, cpu_deep_idle);
+
+void sched_set_deep_idle(int deep)
+{
+	__this_cpu_write(cpu_deep_idle, deep);
+}
+
+static inline int cpu_in_deep_idle(int cpu)
+{
+	return per_cpu(cpu_deep_idle, cpu);
+}
+
+static inline int task_is_small(struct task_struct *p)
+{
+	return sysctl_sched_small_task &&
+	       p->se.avg_burst < sysctl_sched_small_task;
+}
+
 static void task_waking_fair(struct task_struct *p)
 {
 	struct sched_entity *se = &p->se;
@@ -1631,6 +1766,7 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	int cpu = smp_processor_id();
 	int prev_cpu = task_cpu(p);
 	struct sched_domain *sd;
+	int pack = task_is_small(p);
 	int i;
 
 	/*
@@ -1644,9 +1780,18 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	 * If the task is going to be woken-up on the cpu where it previously
 	 * ran and if it is currently idle, then it the right target.
 	 */
-	if (target == prev_cpu && idle_cpu(prev_cpu))
+	if (target == prev_cpu && idle_cpu(prev_cpu) &&
+	    !(pack && cpu_in_deep_idle(prev_cpu)))
 		return prev_cpu;
 
+	/*
+	 * A small task is not worth bringing a cpu out of power collapse,
+	 * this cpu is running anyway.
+	 */
+	if (pack && cpu_in_deep_idle(target) &&
+	    cpumask_test_cpu(cpu, &p->cpus_allowed))
+		target = cpu;
+
 	/*
 	 * Otherwise, iterate the domains and find an elegible idle cpu.
 	 */
@@ -1656,7 +1801,7 @@ static int select_idle_sibling(struct task_struct *p, int target)
 			break;
 
 		for_each_cpu_and(i, sched_domain_span(sd), &p->cpus_allowed) {
-			if (idle_cpu(i)) {
+			if (idle_cpu(i) && !(pack && cpu_in_deep_idle(i))) {
 				target = i;
 				break;
 			}
@@ -3498,6 +3643,9 @@ static void idle_balance(int this_cpu, struct rq *this_rq)
 	if (this_rq->avg_idle < sysctl_sched_migration_cost)
 		return;
 
+	if (cpu_isolated(this_cpu))
+		return;
+
 	/*
 	 * Drop the rq->lock, but keep IRQ/preempt disabled.
 	 */
@@ -3797,7 +3945,8 @@ void select_nohz_load_balancer(int stop_tick)
 	int cpu = smp_processor_id();
 
 	if (stop_tick) {
-		if (!cpu_active(cpu)) {
+		/* Isolated cpus don't take part in idle balancing either */
+		if (!cpu_active(cpu) || cpu_isolated(cpu)) {
 			if (atomic_read(&nohz.load_balancer) != cpu)
 				return;
 
@@ -3884,6 +4033,9 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 	int update_next_balance = 0;
 	int need_serialize;
 
+	if (cpu_isolated(cpu))
+		return;
+
 	update_shares(cpu);
 
 	rcu_read_lock();
@@ -3998,6 +4150,25 @@ static void nohz_idle_balance(int this_cpu, enum cpu_idle_type idle)
  *   physical CPUs). So, second_pick_cpu is the second of the busy CPUs
  *   which will kick idle load balancer as soon as it has any load.
  */
+/*
+ * When small tasks are packed, a cpu left with more than one task only has
+ * power collapsed cpus woken to take some once its load has stayed above a
+ * task's worth for a while, not at the first tick that sees two tasks.
+ */
+static inline int nohz_kick_deferred(struct rq *rq)
+{
+	int cpu;
+
+	if (!sysctl_sched_small_task)
+		return 0;
+	if (rq->cpu_load[3] > NICE_0_LOAD + NICE_0_LOAD / 2)
+		return 0;
+	for_each_cpu(cpu, nohz.idle_cpus_mask)
+		if (!cpu_in_deep_idle(cpu))
+			return 0;
+	return 1;
+}
+
 static inline int nohz_kick_needed(struct rq *rq, int cpu)
 {
 	unsigned long now = jiffies;
@@ -4020,7 +4191,7 @@ static inline int nohz_kick_needed(struct rq *rq, int cpu)
 	ret = atomic_cmpxchg(&nohz.first_pick_cpu, nr_cpu_ids, cpu);
 	if (ret == nr_cpu_ids || ret == cpu) {
 		atomic_cmpxchg(&nohz.second_pick_cpu, cpu, nr_cpu_ids);
-		if (rq->nr_running > 1)
+		if (rq->nr_running > 1 && !nohz_kick_deferred(rq))
 			return 1;
 	} else {
 		ret = atomic_cmpxchg(&nohz.second_pick_cpu, nr_cpu_ids, cpu);
@@ -4105,6 +4276,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &curr->se;
 
+	update_task_load(se, rq->clock_task, 1);
+
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
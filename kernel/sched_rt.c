@@ -1249,6 +1249,10 @@ static int find_lowest_rq(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return -1; /* No targets found */
 
+	cpumask_andnot(lowest_mask, lowest_mask, &sched_isolated_cpus);
+	if (cpumask_empty(lowest_mask))
+		return -1;
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
@@ -113,8 +113,8 @@ extern int blk_iopoll_enabled;
 /* Constants used for minimum and  maximum */
 #ifdef CONFIG_LOCKUP_DETECTOR
 static int sixty = 60;
-static int neg_one = -1;
 #endif
+static int __maybe_unused neg_one = -1;
 
 static int zero;
 static int __maybe_unused one = 1;
@@ -280,6 +280,23 @@ static struct ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "sched_small_task_ns",
+		.data		= &sysctl_sched_small_task,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec,
+	},
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ)
+	{
+		.procname	= "timer_housekeeping_cpu",
+		.data		= &sysctl_timer_housekeeping_cpu,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &neg_one,
+	},
+#endif
 #ifdef CONFIG_SCHED_DEBUG
 	{
 		.procname	= "sched_min_granularity_ns",
@@ -1192,6 +1209,22 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &min_extfrag_threshold,
 		.extra2		= &max_extfrag_threshold,
 	},
+	{
+		.procname	= "compact_order4_target",
+		.data		= &sysctl_compact_order4_target,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_compact_target_handler,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "compact_order8_target",
+		.data		= &sysctl_compact_order8_target,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_compact_target_handler,
+		.extra1		= &zero,
+	},
 
 #endif /* CONFIG_COMPACTION */
 	{
@@ -1202,6 +1235,22 @@ static struct ctl_table vm_table[] = {
 		.proc_handler	= min_free_kbytes_sysctl_handler,
 		.extra1		= &zero,
 	},
+	{
+		.procname	= "watermark_boost_factor",
+		.data		= &sysctl_watermark_boost_factor,
+		.maxlen		= sizeof(sysctl_watermark_boost_factor),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "watermark_boost_ms",
+		.data		= &sysctl_watermark_boost_ms,
+		.maxlen		= sizeof(sysctl_watermark_boost_ms),
+		.mode		= 0644,
+		.proc_handler	= watermark_boost_sysctl_handler,
+		.extra1		= &zero,
+	},
 	{
 		.procname	= "min_free_order_shift",
 		.data		= &min_free_order_shift,
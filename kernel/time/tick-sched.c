@@ -31,6 +31,29 @@ struct rq_data rq_info;
 struct workqueue_struct *rq_wq;
 spinlock_t rq_lock;
 
+/* Weight of the old value in the decaying run queue average */
+#define RQ_EWMA_WEIGHT	4
+
+/*
+ * Return the decaying run queue average, in tenths of a task. Unlike
+ * rq_avg it is not reset when read, so kernel users can sample it
+ * without disturbing the userspace reader.
+ */
+int rq_stats_get_ewma(unsigned int *avg)
+{
+	unsigned long flags;
+
+	if (rq_info.init != 1)
+		return -ENODEV;
+
+	spin_lock_irqsave(&rq_lock, flags);
+	*avg = (rq_info.rq_ewma + 50) / 100;
+	spin_unlock_irqrestore(&rq_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rq_stats_get_ewma);
+
 /*
  * Per cpu nohz control structure
  */
@@ -719,6 +742,7 @@ static void update_rq_stats(void)
 {
 	unsigned long jiffy_gap = 0;
 	unsigned int rq_avg = 0;
+	unsigned int rq_now = 0;
 	unsigned long flags = 0;
 
 	jiffy_gap = jiffies - rq_info.rq_poll_last_jiffy;
@@ -730,7 +754,8 @@ static void update_rq_stats(void)
 		if (!rq_info.rq_avg)
 			rq_info.rq_poll_total_jiffies = 0;
 
-		rq_avg = nr_running() * 10;
+		rq_now = nr_running() * 10;
+		rq_avg = rq_now;
 
 		if (rq_info.rq_poll_total_jiffies) {
 			rq_avg = (rq_avg * jiffy_gap) +
@@ -741,6 +766,9 @@ static void update_rq_stats(void)
 		}
 
 		rq_info.rq_avg =  rq_avg;
+		/* Kept in thousandths so the division does not bias it */
+		rq_info.rq_ewma = (rq_info.rq_ewma * (RQ_EWMA_WEIGHT - 1) +
+				   rq_now * 100) / RQ_EWMA_WEIGHT;
 		rq_info.rq_poll_total_jiffies += jiffy_gap;
 		rq_info.rq_poll_last_jiffy = jiffies;
 
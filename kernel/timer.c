@@ -653,6 +653,19 @@ static struct tvec_base *lock_timer_base(struct timer_list *timer,
 	}
 }
 
+#if defined(CONFIG_NO_HZ) && defined(CONFIG_SMP)
+/*
+ * A deferrable timer never wakes a cpu for itself, with a housekeeping cpu
+ * set all of them go there and expire batched with its ticks instead of
+ * running, and queueing work, whenever another core happens to be up.
+ */
+static inline int timer_to_housekeeping(struct timer_list *timer)
+{
+	return ACCESS_ONCE(sysctl_timer_housekeeping_cpu) >= 0 &&
+	       tbase_get_deferrable(timer->base);
+}
+#endif
+
 static inline int
 __mod_timer(struct timer_list *timer, unsigned long expires,
 						bool pending_only, int pinned)
@@ -682,7 +695,8 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	cpu = smp_processor_id();
 
 #if defined(CONFIG_NO_HZ) && defined(CONFIG_SMP)
-	if (!pinned && get_sysctl_timer_migration() && idle_cpu(cpu))
+	if (!pinned && get_sysctl_timer_migration() &&
+	    (idle_cpu(cpu) || timer_to_housekeeping(timer)))
 		cpu = get_nohz_timer_target();
 #endif
 	new_base = per_cpu(tvec_bases, cpu);
@@ -0,0 +1,30 @@
+/*
+ * Frame latency trace points
+ *
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/frame_trace.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/frame.h>
+
+atomic_t frame_trace_input_id = ATOMIC_INIT(0);
+EXPORT_SYMBOL_GPL(frame_trace_input_id);
+atomic_t frame_trace_gpu_id = ATOMIC_INIT(0);
+EXPORT_SYMBOL_GPL(frame_trace_gpu_id);
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_input);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_gpu_submit);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_kickoff);
+EXPORT_TRACEPOINT_SYMBOL_GPL(frame_scanout);
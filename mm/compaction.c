@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -41,6 +43,7 @@ struct compact_control {
 
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
+	unsigned long nr_target;	/* kcompactd: free blocks of order */
 	struct zone *zone;
 };
 
@@ -451,6 +454,18 @@ static void update_nr_listpages(struct compact_control *cc)
 	cc->nr_freepages = nr_freepages;
 }
 
+/* Number of free blocks of 'order' a zone could hand out, counting larger */
+static unsigned long zone_free_blocks(struct zone *zone, unsigned int order)
+{
+	unsigned long nr = 0;
+	unsigned int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		nr += zone->free_area[o].nr_free << (o - order);
+
+	return nr;
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -471,6 +486,13 @@ static int compact_finished(struct zone *zone,
 	if (cc->order == -1)
 		return COMPACT_CONTINUE;
 
+	/* kcompactd: done once enough blocks are free */
+	if (cc->nr_target) {
+		if (zone_free_blocks(zone, cc->order) >= cc->nr_target)
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	/* Compaction run is not finished if the watermark is not met */
 	watermark = low_wmark_pages(zone);
 	watermark += (1 << cc->order);
@@ -547,6 +569,9 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	int ret;
 
 	ret = compaction_suitable(zone, cc->order);
+	/* kcompactd wants more than the one block an allocation would */
+	if (ret == COMPACT_PARTIAL && cc->nr_target)
+		ret = COMPACT_CONTINUE;
 	switch (ret) {
 	case COMPACT_PARTIAL:
 	case COMPACT_SKIPPED:
@@ -746,6 +771,148 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd - compacts in the background to keep a number of free order-4
+ * and order-8 blocks in each zone, so that multimedia buffer allocations,
+ * ION and KGSL, don't have to stall in direct compaction. Zero targets,
+ * the default, leave it idle.
+ */
+int sysctl_compact_order4_target;
+int sysctl_compact_order8_target;
+
+/* Recheck every second while it keeps up, back off to a minute if not */
+#define KCOMPACTD_INTERVAL	HZ
+#define KCOMPACTD_MAX_INTERVAL	(60 * HZ)
+
+static struct task_struct *kcompactd;
+static DECLARE_WAIT_QUEUE_HEAD(kcompactd_wait);
+static bool kcompactd_kicked;
+
+static bool kcompactd_enabled(void)
+{
+	return sysctl_compact_order4_target || sysctl_compact_order8_target;
+}
+
+/* Returns true if 'zone' has 'nr_target' free blocks of 'order' after */
+static bool kcompactd_zone(struct zone *zone, unsigned int order,
+			   unsigned long nr_target)
+{
+	struct compact_control cc = {
+		.nr_freepages = 0,
+		.nr_migratepages = 0,
+		.order = order,
+		.migratetype = MIGRATE_MOVABLE,
+		.nr_target = nr_target,
+		.zone = zone,
+		.sync = false,
+	};
+
+	if (!nr_target || order >= MAX_ORDER)
+		return true;
+	if (zone_free_blocks(zone, order) >= nr_target)
+		return true;
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+
+	compact_zone(zone, &cc);
+
+	VM_BUG_ON(!list_empty(&cc.freepages));
+	VM_BUG_ON(!list_empty(&cc.migratepages));
+
+	return zone_free_blocks(zone, order) >= nr_target;
+}
+
+/* Returns true if all targets are met */
+static bool kcompactd_run(void)
+{
+	struct zone *zone;
+	bool met = true;
+	bool drained = false;
+
+	for_each_populated_zone(zone) {
+		if (zone_free_blocks(zone, 8) >= sysctl_compact_order8_target &&
+		    zone_free_blocks(zone, 4) >= sysctl_compact_order4_target)
+			continue;
+		if (!drained) {
+			lru_add_drain_all();
+			drained = true;
+		}
+		/* The larger blocks first, they're the hard ones */
+		if (!kcompactd_zone(zone, 8, sysctl_compact_order8_target))
+			met = false;
+		if (!kcompactd_zone(zone, 4, sysctl_compact_order4_target))
+			met = false;
+	}
+
+	return met;
+}
+
+static int kcompactd_fn(void *unused)
+{
+	long timeout = KCOMPACTD_INTERVAL;
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable_timeout(kcompactd_wait,
+			kcompactd_kicked || kthread_should_stop(),
+			kcompactd_enabled() ? timeout : MAX_SCHEDULE_TIMEOUT);
+		kcompactd_kicked = false;
+
+		if (!kcompactd_enabled() || kthread_should_stop())
+			continue;
+
+		if (kcompactd_run())
+			timeout = KCOMPACTD_INTERVAL;
+		else
+			timeout = min_t(long, timeout * 2,
+					KCOMPACTD_MAX_INTERVAL);
+	}
+
+	return 0;
+}
+
+/*
+ * Called from the allocator slow path, a high-order allocation got there
+ * so the free blocks are probably running short.
+ */
+void wakeup_kcompactd(int order)
+{
+	if (!order || !kcompactd || !kcompactd_enabled())
+		return;
+	if (!waitqueue_active(&kcompactd_wait))
+		return;
+	kcompactd_kicked = true;
+	wake_up_interruptible(&kcompactd_wait);
+}
+
+int sysctl_compact_target_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (!ret && write && kcompactd) {
+		kcompactd_kicked = true;
+		wake_up_interruptible(&kcompactd_wait);
+	}
+
+	return ret;
+}
+
+static int __init kcompactd_init(void)
+{
+	kcompactd = kthread_run(kcompactd_fn, NULL, "kcompactd");
+	if (IS_ERR(kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd\n");
+		kcompactd = NULL;
+	}
+
+	return 0;
+}
+module_init(kcompactd_init)
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
@@ -57,6 +57,8 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 		case POSIX_FADV_WILLNEED:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
+		case POSIX_FADV_RECORD:
+		case POSIX_FADV_REPLAY:
 			/* no bad return value, but ignore advice */
 			break;
 		default:
@@ -115,6 +117,12 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 		break;
 	case POSIX_FADV_NOREUSE:
 		break;
+	case POSIX_FADV_RECORD:
+		ret = readahead_record(mapping);
+		break;
+	case POSIX_FADV_REPLAY:
+		ret = readahead_replay(mapping, file);
+		break;
 	case POSIX_FADV_DONTNEED:
 		if (!bdi_write_congested(mapping->backing_dev_info))
 			filemap_flush(mapping);
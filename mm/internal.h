@@ -12,6 +12,7 @@
 #define __MM_INTERNAL_H
 
 #include <linux/mm.h>
+#include <linux/jiffies.h>
 
 void free_pgtables(struct mmu_gather *tlb, struct vm_area_struct *start_vma,
 		unsigned long floor, unsigned long ceiling);
@@ -89,6 +90,13 @@ extern unsigned long highest_memmap_pfn;
  * in mm/vmscan.c:
  */
 extern int isolate_lru_page(struct page *page);
+
+static inline void zone_expire_watermark_boost(struct zone *zone)
+{
+	if (zone->watermark_boost &&
+	    time_after(jiffies, zone->watermark_boost_expires))
+		zone->watermark_boost = 0;
+}
 extern void putback_lru_page(struct page *page);
 
 /*
@@ -135,6 +135,7 @@ struct mem_cgroup_per_zone {
 	struct rb_node		tree_node;	/* RB tree node */
 	unsigned long long	usage_in_excess;/* Set to the value by which */
 						/* the soft limit is exceeded*/
+	unsigned int		reclaim_priority;/* of mem when put on tree */
 	bool			on_tree;
 	struct mem_cgroup	*mem;		/* Back pointer, we cannot */
 						/* use container_of	   */
@@ -250,6 +251,11 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	unsigned int	swappiness;
+	/*
+	 * Soft limit reclaim takes from the groups with the highest
+	 * reclaim_priority first, then from the largest excess.
+	 */
+	unsigned int	reclaim_priority;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -329,6 +335,7 @@ static bool move_file(void)
  */
 #define	MEM_CGROUP_MAX_RECLAIM_LOOPS		(100)
 #define	MEM_CGROUP_MAX_SOFT_LIMIT_RECLAIM_LOOPS	(2)
+#define	MEM_CGROUP_MAX_RECLAIM_PRIORITY		(100)
 
 enum charge_type {
 	MEM_CGROUP_CHARGE_TYPE_CACHE = 0,
@@ -416,11 +423,17 @@ __mem_cgroup_insert_exceeded(struct mem_cgroup *mem,
 	mz->usage_in_excess = new_usage_in_excess;
 	if (!mz->usage_in_excess)
 		return;
+	mz->reclaim_priority = mem->reclaim_priority;
 	while (*p) {
 		parent = *p;
 		mz_node = rb_entry(parent, struct mem_cgroup_per_zone,
 					tree_node);
-		if (mz->usage_in_excess < mz_node->usage_in_excess)
+		if (mz->reclaim_priority != mz_node->reclaim_priority) {
+			if (mz->reclaim_priority < mz_node->reclaim_priority)
+				p = &(*p)->rb_left;
+			else
+				p = &(*p)->rb_right;
+		} else if (mz->usage_in_excess < mz_node->usage_in_excess)
 			p = &(*p)->rb_left;
 		/*
 		 * We can't avoid mem cgroups that are over their soft
@@ -4328,6 +4341,42 @@ static int mem_control_stat_show(struct cgroup *cont, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_reclaim_priority_read(struct cgroup *cgrp,
+					    struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->reclaim_priority;
+}
+
+static int mem_cgroup_reclaim_priority_write(struct cgroup *cgrp,
+					     struct cftype *cft, u64 val)
+{
+	struct mem_cgroup *mem = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_tree_per_zone *mctz;
+	struct mem_cgroup_per_zone *mz;
+	int node, zone;
+
+	if (val > MEM_CGROUP_MAX_RECLAIM_PRIORITY)
+		return -EINVAL;
+
+	mem->reclaim_priority = val;
+
+	/* The soft limit trees are sorted by it, requeue where queued */
+	for_each_node_state(node, N_POSSIBLE) {
+		for (zone = 0; zone < MAX_NR_ZONES; zone++) {
+			mz = mem_cgroup_zoneinfo(mem, node, zone);
+			mctz = soft_limit_tree_node_zone(node, zone);
+			spin_lock(&mctz->lock);
+			if (mz->on_tree) {
+				__mem_cgroup_remove_exceeded(mem, mz, mctz);
+				__mem_cgroup_insert_exceeded(mem, mz, mctz,
+							mz->usage_in_excess);
+			}
+			spin_unlock(&mctz->lock);
+		}
+	}
+	return 0;
+}
+
 static u64 mem_cgroup_swappiness_read(struct cgroup *cgrp, struct cftype *cft)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
@@ -4765,6 +4814,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "reclaim_priority",
+		.read_u64 = mem_cgroup_reclaim_priority_read,
+		.write_u64 = mem_cgroup_reclaim_priority_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -57,6 +57,8 @@
 #include <linux/ftrace_event.h>
 #include <linux/memcontrol.h>
 #include <linux/prefetch.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -196,6 +198,13 @@ static char * const zone_names[MAX_NR_ZONES] = {
 };
 
 int min_free_kbytes = 1024;
+
+/* Watermark boost, in 1/10000ths of the high watermark; 0 disables it */
+int sysctl_watermark_boost_factor = 15000;
+/* Written by userspace about to need memory fast, e.g. at app launch */
+int sysctl_watermark_boost_ms;
+/* How long a boost triggered by direct reclaim lasts */
+#define WATERMARK_BOOST_TIME	HZ
 int min_free_order_shift = 1;
 
 static unsigned long __meminitdata nr_kernel_pages;
@@ -848,11 +857,16 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
  * This array describes the order lists are fallen back to when
  * the free lists for the desirable migrate type are depleted
  */
-static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
-	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
-	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE,     MIGRATE_RESERVE,   MIGRATE_RESERVE }, /* Never used */
+static int fallbacks[MIGRATE_TYPES][4] = {
+	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+#ifdef CONFIG_CMA
+	[MIGRATE_MOVABLE]     = { MIGRATE_CMA,         MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+	[MIGRATE_CMA]         = { MIGRATE_RESERVE }, /* Never used */
+#else
+	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE,   MIGRATE_RESERVE },
+#endif
+	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE }, /* Never used */
 };
 
 /*
@@ -947,12 +961,12 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 	/* Find the largest possible block of pages in the other list */
 	for (current_order = MAX_ORDER-1; current_order >= order;
 						--current_order) {
-		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+		for (i = 0;; i++) {
 			migratetype = fallbacks[start_migratetype][i];
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -966,11 +980,13 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
 			 * back for a reclaimable kernel allocation, be more
-			 * aggressive about taking ownership of free pages
+			 * aggressive about taking ownership of free pages.
+			 * CMA pageblocks are never taken over.
 			 */
-			if (unlikely(current_order >= (pageblock_order >> 1)) ||
+			if (!is_migrate_cma(migratetype) &&
+			    (unlikely(current_order >= (pageblock_order >> 1)) ||
 					start_migratetype == MIGRATE_RECLAIMABLE ||
-					page_group_by_mobility_disabled) {
+					page_group_by_mobility_disabled)) {
 				unsigned long pages;
 				pages = move_freepages_block(zone, page,
 								start_migratetype);
@@ -989,7 +1005,8 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			rmv_page_order(page);
 
 			/* Take ownership for orders >= pageblock_order */
-			if (current_order >= pageblock_order)
+			if (current_order >= pageblock_order &&
+			    !is_migrate_cma(migratetype))
 				change_pageblock_range(page, current_order,
 							start_migratetype);
 
@@ -1065,7 +1082,13 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			list_add(&page->lru, list);
 		else
 			list_add_tail(&page->lru, list);
-		set_page_private(page, migratetype);
+#ifdef CONFIG_CMA
+		/* Pages from a CMA pageblock have to go back to it when freed */
+		if (is_migrate_cma(get_pageblock_migratetype(page)))
+			set_page_private(page, MIGRATE_CMA);
+		else
+#endif
+			set_page_private(page, migratetype);
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -1257,6 +1280,7 @@ void split_page(struct page *page, unsigned int order)
 	for (i = 1; i < (1 << order); i++)
 		set_page_refcounted(page + i);
 }
+EXPORT_SYMBOL_GPL(split_page);
 
 /*
  * Similar to split_page except the page is already free. As this is only
@@ -1712,7 +1736,8 @@ zonelist_scan:
 			unsigned long mark;
 			int ret;
 
-			mark = zone->watermark[alloc_flags & ALLOC_WMARK_MASK];
+			mark = wmark_pages(zone,
+					   alloc_flags & ALLOC_WMARK_MASK);
 			if (zone_watermark_ok(zone, order, mark,
 				    classzone_idx, alloc_flags))
 				goto try_this_zone;
@@ -2052,6 +2077,41 @@ __alloc_pages_high_priority(gfp_t gfp_mask, unsigned int order,
 }
 
 static inline
+/*
+ * Raises the low and high watermarks of @zone by watermark_boost_factor
+ * (in 1/10000ths of the high watermark) for @duration jiffies.
+ */
+static void zone_boost_watermark(struct zone *zone, unsigned long duration)
+{
+	unsigned long boost, expires;
+
+	if (!sysctl_watermark_boost_factor)
+		return;
+
+	boost = div_u64((u64)zone->watermark[WMARK_HIGH] *
+			sysctl_watermark_boost_factor, 10000);
+	expires = jiffies + duration;
+	if (!zone->watermark_boost ||
+	    time_after(expires, zone->watermark_boost_expires))
+		zone->watermark_boost_expires = expires;
+	zone->watermark_boost = max(zone->watermark_boost, boost);
+}
+
+/*
+ * An allocation had to reclaim directly: kswapd did not keep up with a
+ * burst. Keep it reclaiming from higher up while the burst lasts.
+ */
+static void boost_watermarks(struct zonelist *zonelist,
+			     enum zone_type high_zoneidx, nodemask_t *nodemask)
+{
+	struct zoneref *z;
+	struct zone *zone;
+
+	for_each_zone_zonelist_nodemask(zone, z, zonelist, high_zoneidx,
+					nodemask)
+		zone_boost_watermark(zone, WATERMARK_BOOST_TIME);
+}
+
 void wake_all_kswapd(unsigned int order, struct zonelist *zonelist,
 						enum zone_type high_zoneidx,
 						enum zone_type classzone_idx)
@@ -2144,6 +2204,7 @@ restart:
 	if (!(gfp_mask & __GFP_NO_KSWAPD))
 		wake_all_kswapd(order, zonelist, high_zoneidx,
 						zone_idx(preferred_zone));
+	wakeup_kcompactd(order);
 
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
@@ -2204,6 +2265,7 @@ rebalance:
 	sync_migration = true;
 
 	/* Try direct reclaim and then allocating */
+	boost_watermarks(zonelist, high_zoneidx, nodemask);
 	page = __alloc_pages_direct_reclaim(gfp_mask, order,
 					zonelist, high_zoneidx,
 					nodemask,
@@ -5278,6 +5340,28 @@ int min_free_kbytes_sysctl_handler(ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * watermark_boost_sysctl_handler - writing a duration in milliseconds boosts
+ *	the watermarks of every zone for that long and wakes kswapd.
+ */
+int watermark_boost_sysctl_handler(ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	struct zone *zone;
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write || !sysctl_watermark_boost_ms)
+		return ret;
+
+	for_each_populated_zone(zone) {
+		zone_boost_watermark(zone,
+				msecs_to_jiffies(sysctl_watermark_boost_ms));
+		wakeup_kswapd(zone, 0, zone_idx(zone));
+	}
+	return 0;
+}
+
 #ifdef CONFIG_NUMA
 int sysctl_min_unmapped_ratio_sysctl_handler(ctl_table *table, int write,
 	void __user *buffer, size_t *length, loff_t *ppos)
@@ -5558,7 +5642,8 @@ __count_immobile_pages(struct zone *zone, struct page *page, int count)
 	if (zone_idx(zone) == ZONE_MOVABLE)
 		return true;
 
-	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE)
+	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE ||
+	    is_migrate_cma(get_pageblock_migratetype(page)))
 		return true;
 
 	pfn = page_to_pfn(page);
@@ -5668,7 +5753,7 @@ out:
 	return ret;
 }
 
-void unset_migratetype_isolate(struct page *page)
+void unset_migratetype_isolate(struct page *page, int migratetype)
 {
 	struct zone *zone;
 	unsigned long flags;
@@ -5676,12 +5761,203 @@ void unset_migratetype_isolate(struct page *page)
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) != MIGRATE_ISOLATE)
 		goto out;
-	set_pageblock_migratetype(page, MIGRATE_MOVABLE);
-	move_freepages_block(zone, page, MIGRATE_MOVABLE);
+	set_pageblock_migratetype(page, migratetype);
+	move_freepages_block(zone, page, migratetype);
 out:
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
+#ifdef CONFIG_CMA
+/*
+ * init_cma_reserved_pageblock - hands a pageblock of memory reserved at boot
+ * to the page allocator as MIGRATE_CMA. Movable allocations can use it until
+ * its owner takes it back with alloc_contig_range().
+ */
+void init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+#ifdef CONFIG_HIGHMEM
+	if (PageHighMem(page))
+		totalhigh_pages += pageblock_nr_pages;
+#endif
+}
+
+static struct page *
+cma_migrate_alloc(struct page *page, unsigned long private, int **x)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE | __GFP_NORETRY | __GFP_NOWARN);
+}
+
+/* Migrates everything in use in [start, end) elsewhere */
+static int __alloc_contig_migrate_range(unsigned long start, unsigned long end)
+{
+	unsigned long pfn;
+	int tries = 0;
+	int ret = 0;
+
+	while (tries++ < 5) {
+		LIST_HEAD(source);
+		int nr = 0;
+
+		for (pfn = start; pfn < end; pfn++) {
+			struct page *page;
+
+			if (!pfn_valid_within(pfn))
+				continue;
+			page = pfn_to_page(pfn);
+			if (PageBuddy(page)) {
+				pfn += (1UL << page_order(page)) - 1;
+				continue;
+			}
+			if (!PageLRU(page))
+				continue;
+			if (!isolate_lru_page(page)) {
+				list_add_tail(&page->lru, &source);
+				inc_zone_page_state(page, NR_ISOLATED_ANON +
+						    page_is_file_cache(page));
+				nr++;
+			}
+		}
+
+		if (!nr)
+			break;
+
+		ret = migrate_pages(&source, cma_migrate_alloc, 0, true, true);
+		if (ret)
+			putback_lru_pages(&source);
+		/* Pages that went through a pagevec meanwhile */
+		lru_add_drain_all();
+	}
+
+	return ret > 0 ? -EBUSY : ret;
+}
+
+/* Takes the free pages in [start, end) out of the buddy lists, as order-0 */
+static unsigned long __isolate_free_range(struct zone *zone,
+					  unsigned long start,
+					  unsigned long end)
+{
+	unsigned long pfn = start;
+	unsigned long flags;
+
+	spin_lock_irqsave(&zone->lock, flags);
+	while (pfn < end) {
+		struct page *page = pfn_to_page(pfn);
+		int order, i;
+
+		if (!PageBuddy(page)) {
+			/* Freed into the isolated block from a pcp list */
+			BUG_ON(page_count(page));
+			set_page_refcounted(page);
+			pfn++;
+			continue;
+		}
+
+		order = page_order(page);
+		list_del(&page->lru);
+		rmv_page_order(page);
+		zone->free_area[order].nr_free--;
+		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+		for (i = 0; i < (1 << order); i++)
+			set_page_refcounted(page + i);
+		pfn += 1UL << order;
+	}
+	spin_unlock_irqrestore(&zone->lock, flags);
+
+	return pfn;
+}
+
+/**
+ * alloc_contig_range - takes [start, end) away from the page allocator
+ * @start:	first pfn
+ * @end:	one past the last pfn
+ *
+ * The range must be within one zone and in MIGRATE_CMA pageblocks. Pages in
+ * use are migrated away. On success every page in the range has a reference
+ * count of one and belongs to the caller, give them back with
+ * free_contig_range().
+ *
+ * Returns 0 or a negative code if some page could not be moved.
+ */
+int alloc_contig_range(unsigned long start, unsigned long end)
+{
+	unsigned long outer_start, outer_end;
+	struct zone *zone = page_zone(pfn_to_page(start));
+	unsigned int order;
+	int ret;
+
+	/*
+	 * Whole MAX_ORDER blocks are isolated, no free page the range is
+	 * part of can be merged with pages outside and allocated meanwhile.
+	 */
+	ret = start_isolate_page_range(start & ~(MAX_ORDER_NR_PAGES - 1),
+				       ALIGN(end, MAX_ORDER_NR_PAGES),
+				       MIGRATE_CMA);
+	if (ret)
+		return ret;
+
+	lru_add_drain_all();
+	drain_all_pages();
+
+	ret = __alloc_contig_migrate_range(start, end);
+	if (ret)
+		goto done;
+
+	drain_all_pages();
+
+	/* The free page holding 'start' may begin before it */
+	order = 0;
+	outer_start = start;
+	while (!PageBuddy(pfn_to_page(outer_start))) {
+		if (++order >= MAX_ORDER) {
+			outer_start = start;
+			break;
+		}
+		outer_start &= ~0UL << order;
+	}
+	if (outer_start != start &&
+	    outer_start + (1UL << page_order(pfn_to_page(outer_start))) <= start)
+		outer_start = start;
+
+	if (test_pages_isolated(outer_start, end)) {
+		pr_warn("alloc_contig_range: [%lx, %lx) PFNs busy\n",
+			outer_start, end);
+		ret = -EBUSY;
+		goto done;
+	}
+
+	outer_end = __isolate_free_range(zone, outer_start, end);
+
+	/* Give back what we took beyond the range */
+	if (start != outer_start)
+		free_contig_range(outer_start, start - outer_start);
+	if (end != outer_end)
+		free_contig_range(end, outer_end - end);
+
+done:
+	undo_isolate_page_range(start & ~(MAX_ORDER_NR_PAGES - 1),
+				ALIGN(end, MAX_ORDER_NR_PAGES), MIGRATE_CMA);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+#endif /* CONFIG_CMA */
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
  * All pages in the range must be isolated before calling this.
@@ -17,6 +17,10 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/jiffies.h>
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -504,6 +508,8 @@ void page_cache_sync_readahead(struct address_space *mapping,
 			       struct file_ra_state *ra, struct file *filp,
 			       pgoff_t offset, unsigned long req_size)
 {
+	readahead_record_miss(mapping, offset, req_size);
+
 	/* no read-ahead */
 	if (!ra->ra_pages)
 		return;
@@ -562,3 +568,194 @@ page_cache_async_readahead(struct address_space *mapping,
 	ondemand_readahead(mapping, ra, filp, true, offset, req_size);
 }
 EXPORT_SYMBOL_GPL(page_cache_async_readahead);
+
+/*
+ * Launch-time access records.
+ *
+ * An app launching from flash faults its APK and dex files in with many
+ * small random reads, each one waited for before the next is issued.
+ * POSIX_FADV_RECORD notes the page cache misses taken on a file during the
+ * next RA_RECORD_TIME, POSIX_FADV_REPLAY reads the noted windows back in one
+ * plugged, sorted batch on the following launch. A record belongs to the
+ * inode until it is evicted or RA_RECORD_FILES newer records push it out.
+ */
+#define RA_RECORD_FILES		64
+#define RA_RECORD_HASH_BITS	6
+#define RA_RECORD_WINDOWS	128
+#define RA_RECORD_GAP		8	/* pages worth reading to join windows */
+#define RA_RECORD_TIME		(10 * HZ)
+
+struct ra_window {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_record {
+	struct hlist_node hash;
+	struct list_head lru;
+	struct address_space *mapping;
+	unsigned long deadline;		/* end of the recording, in jiffies */
+	unsigned int nr_windows;
+	struct ra_window windows[RA_RECORD_WINDOWS];
+};
+
+static DEFINE_SPINLOCK(ra_record_lock);
+static struct hlist_head ra_record_hash[1 << RA_RECORD_HASH_BITS];
+static LIST_HEAD(ra_record_lru);
+static unsigned int ra_record_count;
+
+static struct hlist_head *ra_record_head(struct address_space *mapping)
+{
+	return &ra_record_hash[hash_ptr(mapping, RA_RECORD_HASH_BITS)];
+}
+
+/* Caller must hold ra_record_lock */
+static struct ra_record *ra_record_lookup(struct address_space *mapping)
+{
+	struct ra_record *record;
+	struct hlist_node *node;
+
+	hlist_for_each_entry(record, node, ra_record_head(mapping), hash)
+		if (record->mapping == mapping)
+			return record;
+	return NULL;
+}
+
+/* Caller must hold ra_record_lock */
+static void ra_record_unlink(struct ra_record *record)
+{
+	clear_bit(AS_RA_RECORD, &record->mapping->flags);
+	hlist_del(&record->hash);
+	list_del(&record->lru);
+	ra_record_count--;
+}
+
+/*
+ * Starts noting the misses on @mapping. Windows recorded before are kept,
+ * a launch replaying them and recording again only adds what it missed.
+ */
+int readahead_record(struct address_space *mapping)
+{
+	struct ra_record *record, *new, *old = NULL;
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	spin_lock(&ra_record_lock);
+	record = ra_record_lookup(mapping);
+	if (!record) {
+		if (ra_record_count >= RA_RECORD_FILES) {
+			old = list_entry(ra_record_lru.prev,
+					 struct ra_record, lru);
+			ra_record_unlink(old);
+		}
+		record = new;
+		new = NULL;
+		record->mapping = mapping;
+		hlist_add_head(&record->hash, ra_record_head(mapping));
+		list_add(&record->lru, &ra_record_lru);
+		ra_record_count++;
+		set_bit(AS_RA_RECORD, &mapping->flags);
+	} else {
+		list_move(&record->lru, &ra_record_lru);
+	}
+	record->deadline = jiffies + RA_RECORD_TIME;
+	spin_unlock(&ra_record_lock);
+
+	kfree(old);
+	kfree(new);
+	return 0;
+}
+
+void __readahead_record_miss(struct address_space *mapping,
+			     pgoff_t offset, unsigned long nr)
+{
+	struct ra_record *record;
+	struct ra_window *w;
+	unsigned int i;
+
+	spin_lock(&ra_record_lock);
+	record = ra_record_lookup(mapping);
+	if (!record || time_after(jiffies, record->deadline))
+		goto out;
+
+	for (i = 0; i < record->nr_windows; i++) {
+		w = &record->windows[i];
+		if (offset + nr + RA_RECORD_GAP >= w->start &&
+		    offset <= w->start + w->nr + RA_RECORD_GAP) {
+			pgoff_t end = max(offset + nr, w->start + w->nr);
+
+			w->start = min(offset, w->start);
+			w->nr = end - w->start;
+			goto out;
+		}
+	}
+	if (record->nr_windows < RA_RECORD_WINDOWS) {
+		w = &record->windows[record->nr_windows++];
+		w->start = offset;
+		w->nr = nr;
+	}
+out:
+	spin_unlock(&ra_record_lock);
+}
+
+void __readahead_record_forget(struct address_space *mapping)
+{
+	struct ra_record *record;
+
+	spin_lock(&ra_record_lock);
+	record = ra_record_lookup(mapping);
+	if (record)
+		ra_record_unlink(record);
+	spin_unlock(&ra_record_lock);
+	kfree(record);
+}
+
+static int ra_window_cmp(const void *a, const void *b)
+{
+	const struct ra_window *wa = a, *wb = b;
+
+	if (wa->start == wb->start)
+		return 0;
+	return wa->start < wb->start ? -1 : 1;
+}
+
+/*
+ * Reads the windows recorded for @mapping. The reads are only submitted,
+ * not waited for, and pages already cached are skipped.
+ */
+int readahead_replay(struct address_space *mapping, struct file *filp)
+{
+	struct ra_window *windows;
+	struct ra_record *record;
+	struct blk_plug plug;
+	unsigned int i, nr = 0;
+
+	if (unlikely(!mapping->a_ops->readpage && !mapping->a_ops->readpages))
+		return -EINVAL;
+
+	windows = kmalloc(sizeof(*windows) * RA_RECORD_WINDOWS, GFP_KERNEL);
+	if (!windows)
+		return -ENOMEM;
+
+	spin_lock(&ra_record_lock);
+	record = ra_record_lookup(mapping);
+	if (record) {
+		nr = record->nr_windows;
+		memcpy(windows, record->windows, nr * sizeof(*windows));
+		list_move(&record->lru, &ra_record_lru);
+	}
+	spin_unlock(&ra_record_lock);
+
+	sort(windows, nr, sizeof(*windows), ra_window_cmp, NULL);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++)
+		force_page_cache_readahead(mapping, filp, windows[i].start,
+					   windows[i].nr);
+	blk_finish_plug(&plug);
+
+	kfree(windows);
+	return 0;
+}
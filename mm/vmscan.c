@@ -2452,6 +2452,9 @@ loop_again:
 	sc.may_writepage = !laptop_mode;
 	count_vm_event(PAGEOUTRUN);
 
+	for (i = 0; i < pgdat->nr_zones; i++)
+		zone_expire_watermark_boost(pgdat->node_zones + i);
+
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
 		unsigned long lru_pages = 0;
 		int has_under_min_watermark_zone = 0;
@@ -2841,6 +2844,7 @@ void wakeup_kswapd(struct zone *zone, int order, enum zone_type classzone_idx)
 
 	if (!cpuset_zone_allowed_hardwall(zone, GFP_KERNEL))
 		return;
+	zone_expire_watermark_boost(zone);
 	pgdat = zone->zone_pgdat;
 	if (pgdat->kswapd_max_order < order) {
 		pgdat->kswapd_max_order = order;
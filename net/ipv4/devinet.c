@@ -89,6 +89,13 @@ static struct ipv4_devconf ipv4_devconf_dflt = {
 #define IPV4_DEVCONF_DFLT(net, attr) \
 	IPV4_DEVCONF((*net->ipv4.devconf_dflt), attr)
 
+/*
+ * Initial TCP receive window, in segments, of raw IP (cellular) links
+ * when none was configured: with their long RTTs, letting the sender
+ * start faster than the wired default buys several round trips.
+ */
+#define RAWIP_TCP_INITRWND	20
+
 static const struct nla_policy ifa_ipv4_policy[IFA_MAX+1] = {
 	[IFA_LOCAL]     	= { .type = NLA_U32 },
 	[IFA_ADDRESS]   	= { .type = NLA_U32 },
@@ -243,6 +250,10 @@ static struct in_device *inetdev_init(struct net_device *dev)
 			sizeof(in_dev->cnf));
 	in_dev->cnf.sysctl = NULL;
 	in_dev->dev = dev;
+	if (dev->type == ARPHRD_RAWIP &&
+	    !IPV4_DEVCONF(in_dev->cnf, TCP_INITRWND))
+		ipv4_devconf_set(in_dev, IPV4_DEVCONF_TCP_INITRWND,
+				 RAWIP_TCP_INITRWND);
 	in_dev->arp_parms = neigh_parms_alloc(dev, &arp_tbl);
 	if (!in_dev->arp_parms)
 		goto out_kfree;
@@ -1620,6 +1631,8 @@ static struct devinet_sysctl_table {
 		DEVINET_SYSCTL_RW_ENTRY(ARP_ACCEPT, "arp_accept"),
 		DEVINET_SYSCTL_RW_ENTRY(ARP_NOTIFY, "arp_notify"),
 		DEVINET_SYSCTL_RW_ENTRY(PROXY_ARP_PVLAN, "proxy_arp_pvlan"),
+		DEVINET_SYSCTL_RW_ENTRY(TCP_RMEM_MAX, "tcp_rmem_max"),
+		DEVINET_SYSCTL_RW_ENTRY(TCP_INITRWND, "tcp_initrwnd"),
 
 		DEVINET_SYSCTL_FLUSHING_ENTRY(NOXFRM, "disable_xfrm"),
 		DEVINET_SYSCTL_FLUSHING_ENTRY(NOPOLICY, "disable_policy"),
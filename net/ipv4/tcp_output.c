@@ -39,6 +39,7 @@
 #include <linux/compiler.h>
 #include <linux/gfp.h>
 #include <linux/module.h>
+#include <linux/inetdevice.h>
 
 /* People can turn this off for buggy TCP's found in printers etc. */
 int sysctl_tcp_retrans_collapse __read_mostly = 1;
@@ -251,6 +252,26 @@ void tcp_select_initial_window(int __space, __u32 mss,
 }
 EXPORT_SYMBOL(tcp_select_initial_window);
 
+/* Initial receive window, in segments, to offer on a route: the initrwnd
+ * metric of the route, else the tcp_initrwnd of its interface.
+ */
+u32 tcp_init_rcv_wnd(const struct dst_entry *dst)
+{
+	struct in_device *in_dev;
+	u32 init_rcv_wnd = dst_metric(dst, RTAX_INITRWND);
+
+	if (init_rcv_wnd || !dst->dev)
+		return init_rcv_wnd;
+
+	rcu_read_lock();
+	in_dev = __in_dev_get_rcu(dst->dev);
+	if (in_dev)
+		init_rcv_wnd = max(IN_DEV_CONF_GET(in_dev, TCP_INITRWND), 0);
+	rcu_read_unlock();
+	return init_rcv_wnd;
+}
+EXPORT_SYMBOL(tcp_init_rcv_wnd);
+
 /* Chose a new window to advertise, update state in tcp_sock for the
  * socket, and return result with RFC1323 scaling applied.  The return
  * value can be stuffed directly into th->window for an outgoing
@@ -2451,7 +2472,7 @@ struct sk_buff *tcp_make_synack(struct sock *sk, struct dst_entry *dst,
 			&req->window_clamp,
 			ireq->wscale_ok,
 			&rcv_wscale,
-			dst_metric(dst, RTAX_INITRWND));
+			tcp_init_rcv_wnd(dst));
 		ireq->rcv_wscale = rcv_wscale;
 	}
 
@@ -2581,7 +2602,7 @@ static void tcp_connect_init(struct sock *sk)
 				  &tp->window_clamp,
 				  sysctl_tcp_window_scaling,
 				  &rcv_wscale,
-				  dst_metric(dst, RTAX_INITRWND));
+				  tcp_init_rcv_wnd(dst));
 
 	tp->rx_opt.rcv_wscale = rcv_wscale;
 	tp->rcv_ssthresh = tp->rcv_wnd;
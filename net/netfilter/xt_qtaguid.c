@@ -19,6 +19,7 @@
 #include <linux/module.h>
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter/xt_qtaguid.h>
+#include <linux/rculist.h>
 #include <linux/skbuff.h>
 #include <linux/workqueue.h>
 #include <net/addrconf.h>
@@ -118,6 +119,12 @@ static const char *iface_stat_all_procfilename = "iface_stat_all";
 static struct proc_dir_entry *iface_stat_all_procfile;
 
 /*
+ * sock_tag_list_lock and tag_counter_set_list_lock are rwlocks: the packet
+ * path only reads them, so it can run on all cpus at once. Everybody else
+ * takes them for writing.
+ * iface_stat_list is walked under RCU by the packet path, see
+ * get_iface_entry().
+ *
  * Ordering of locks:
  *  outer locks:
  *    iface_stat_list_lock
@@ -182,15 +189,15 @@ static struct proc_dir_entry *iface_stat_all_procfile;
  * qtaguid_mt()
  *   account_for_uid()
  *     if_tag_stat_update()
- *       get_sock_stat()
- *         sock_tag_list_lock
+ *       get_sock_stat_tag()
+ *         sock_tag_list_lock (read)
  *       struct iface_stat->tag_stat_list_lock
  *         tag_stat_update()
  *           get_active_counter_set()
- *             tag_counter_set_list_lock
+ *             tag_counter_set_list_lock (read)
  *         tag_stat_update()
  *           get_active_counter_set()
- *             tag_counter_set_list_lock
+ *             tag_counter_set_list_lock (read)
  *
  *
  * qtaguid_ctrl_parse()
@@ -219,10 +226,10 @@ static LIST_HEAD(iface_stat_list);
 static DEFINE_SPINLOCK(iface_stat_list_lock);
 
 static struct rb_root sock_tag_tree = RB_ROOT;
-static DEFINE_SPINLOCK(sock_tag_list_lock);
+static DEFINE_RWLOCK(sock_tag_list_lock);
 
 static struct rb_root tag_counter_set_tree = RB_ROOT;
-static DEFINE_SPINLOCK(tag_counter_set_list_lock);
+static DEFINE_RWLOCK(tag_counter_set_list_lock);
 
 static struct rb_root uid_tag_data_tree = RB_ROOT;
 static DEFINE_SPINLOCK(uid_tag_data_tree_lock);
@@ -749,17 +756,19 @@ static int get_active_counter_set(tag_t tag)
 		 tag, get_uid_from_tag(tag));
 	/* For now we only handle UID tags for active sets */
 	tag = get_utag_from_tag(tag);
-	spin_lock_bh(&tag_counter_set_list_lock);
+	read_lock_bh(&tag_counter_set_list_lock);
 	tcs = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
 	if (tcs)
 		active_set = tcs->active_set;
-	spin_unlock_bh(&tag_counter_set_list_lock);
+	read_unlock_bh(&tag_counter_set_list_lock);
 	return active_set;
 }
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or be in an RCU read side section:
+ * entries are published with list_add_rcu() and never removed, so the
+ * packet path can walk the list without taking the lock.
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -772,7 +781,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -945,7 +954,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1135,16 +1144,22 @@ static struct sock_tag *get_sock_stat_nl(const struct sock *sk)
 	return sock_tag_tree_search(&sock_tag_tree, sk);
 }
 
-static struct sock_tag *get_sock_stat(const struct sock *sk)
+/*
+ * Look up the tag of a socket. The tag is copied out under the lock, the
+ * entry itself can be freed by an untag as soon as it is dropped.
+ */
+static bool get_sock_stat_tag(const struct sock *sk, tag_t *tag)
 {
 	struct sock_tag *sock_tag_entry;
-	MT_DEBUG("qtaguid: get_sock_stat(sk=%p)\n", sk);
+	MT_DEBUG("qtaguid: get_sock_stat_tag(sk=%p)\n", sk);
 	if (!sk)
-		return NULL;
-	spin_lock_bh(&sock_tag_list_lock);
+		return false;
+	read_lock_bh(&sock_tag_list_lock);
 	sock_tag_entry = get_sock_stat_nl(sk);
-	spin_unlock_bh(&sock_tag_list_lock);
-	return sock_tag_entry;
+	if (sock_tag_entry)
+		*tag = sock_tag_entry->tag;
+	read_unlock_bh(&sock_tag_list_lock);
+	return sock_tag_entry != NULL;
 }
 
 static void
@@ -1267,7 +1282,6 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	tag_t tag, acct_tag;
 	tag_t uid_tag;
 	struct data_counters *uid_tag_counters;
-	struct sock_tag *sock_tag_entry;
 	struct iface_stat *iface_entry;
 	struct tag_stat *new_tag_stat = NULL;
 	MT_DEBUG("qtaguid: if_tag_stat_update(ifname=%s "
@@ -1275,7 +1289,10 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 ifname, uid, sk, direction, proto, bytes);
 
 
+	/* iface entries are never freed, it can be used after the unlock */
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
+	rcu_read_unlock();
 	if (!iface_entry) {
 		pr_err("qtaguid: iface_stat: stat_update() %s not found\n",
 		       ifname);
@@ -1290,9 +1307,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	 * Look for a tagged sock.
 	 * It will have an acct_uid.
 	 */
-	sock_tag_entry = get_sock_stat(sk);
-	if (sock_tag_entry) {
-		tag = sock_tag_entry->tag;
+	if (get_sock_stat_tag(sk, &tag)) {
 		acct_tag = get_atag_from_tag(tag);
 		uid_tag = get_utag_from_tag(tag);
 	} else {
@@ -1760,16 +1775,16 @@ static void prdebug_full_state(int indent_level, const char *fmt, ...)
 	kfree(buff);
 	va_end(args);
 
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	prdebug_sock_tag_tree(indent_level, &sock_tag_tree);
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	spin_lock_bh(&uid_tag_data_tree_lock);
 	prdebug_uid_tag_data_tree(indent_level, &uid_tag_data_tree);
 	prdebug_proc_qtu_data_tree(indent_level, &proc_qtu_data_tree);
 	spin_unlock_bh(&uid_tag_data_tree_lock);
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 
 	spin_lock_bh(&iface_stat_list_lock);
 	prdebug_iface_stat_list(indent_level, &iface_stat_list);
@@ -1809,7 +1824,7 @@ static int qtaguid_ctrl_proc_read(char *page, char **num_items_returned,
 	CT_DEBUG("qtaguid: proc ctrl page=%p off=%ld char_count=%d *eof=%d\n",
 		page, items_to_skip, char_count, *eof);
 
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	for (node = rb_first(&sock_tag_tree);
 	     node;
 	     node = rb_next(node)) {
@@ -1833,7 +1848,7 @@ static int qtaguid_ctrl_proc_read(char *page, char **num_items_returned,
 			       sock_tag_entry->tag, uid,
 			       sock_tag_entry->pid, f_count);
 		if (len >= char_count) {
-			spin_unlock_bh(&sock_tag_list_lock);
+			write_unlock_bh(&sock_tag_list_lock);
 			*outp = '\0';
 			return outp - page;
 		}
@@ -1841,7 +1856,7 @@ static int qtaguid_ctrl_proc_read(char *page, char **num_items_returned,
 		char_count -= len;
 		(*num_items_returned)++;
 	}
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 
 	if (item_index++ >= items_to_skip) {
 		len = snprintf(outp, char_count,
@@ -1936,7 +1951,7 @@ static int ctrl_cmd_delete(const char *input)
 		 input, tag, uid);
 
 	/* Delete socket tags */
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	node = rb_first(&sock_tag_tree);
 	while (node) {
 		st_entry = rb_entry(node, struct sock_tag, sock_node);
@@ -1966,12 +1981,12 @@ static int ctrl_cmd_delete(const char *input)
 				list_del(&st_entry->list);
 		}
 	}
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 
 	sock_tag_tree_erase(&st_to_free_tree);
 
 	/* Delete tag counter-sets */
-	spin_lock_bh(&tag_counter_set_list_lock);
+	write_lock_bh(&tag_counter_set_list_lock);
 	/* Counter sets are only on the uid tag, not full tag */
 	tcs_entry = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
 	if (tcs_entry) {
@@ -1984,7 +1999,7 @@ static int ctrl_cmd_delete(const char *input)
 		rb_erase(&tcs_entry->tn.node, &tag_counter_set_tree);
 		kfree(tcs_entry);
 	}
-	spin_unlock_bh(&tag_counter_set_list_lock);
+	write_unlock_bh(&tag_counter_set_list_lock);
 
 	/*
 	 * If acct_tag is 0, then all entries belonging to uid are
@@ -2082,12 +2097,12 @@ static int ctrl_cmd_counter_set(const char *input)
 	}
 
 	tag = make_tag_from_uid(uid);
-	spin_lock_bh(&tag_counter_set_list_lock);
+	write_lock_bh(&tag_counter_set_list_lock);
 	tcs = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
 	if (!tcs) {
 		tcs = kzalloc(sizeof(*tcs), GFP_ATOMIC);
 		if (!tcs) {
-			spin_unlock_bh(&tag_counter_set_list_lock);
+			write_unlock_bh(&tag_counter_set_list_lock);
 			pr_err("qtaguid: ctrl_counterset(%s): "
 			       "failed to alloc counter set\n",
 			       input);
@@ -2101,7 +2116,7 @@ static int ctrl_cmd_counter_set(const char *input)
 			 input, tag, get_uid_from_tag(tag), counter_set);
 	}
 	tcs->active_set = counter_set;
-	spin_unlock_bh(&tag_counter_set_list_lock);
+	write_unlock_bh(&tag_counter_set_list_lock);
 	atomic64_inc(&qtu_events.counter_set_changes);
 	res = 0;
 
@@ -2166,12 +2181,12 @@ static int ctrl_cmd_tag(const char *input)
 	}
 	full_tag = combine_atag_with_uid(acct_tag, uid);
 
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	sock_tag_entry = get_sock_stat_nl(el_socket->sk);
 	tag_ref_entry = get_tag_ref(full_tag, &uid_tag_data_entry);
 	if (IS_ERR(tag_ref_entry)) {
 		res = PTR_ERR(tag_ref_entry);
-		spin_unlock_bh(&sock_tag_list_lock);
+		write_unlock_bh(&sock_tag_list_lock);
 		goto err_put;
 	}
 	tag_ref_entry->num_sock_tags++;
@@ -2204,7 +2219,7 @@ static int ctrl_cmd_tag(const char *input)
 			pr_err("qtaguid: ctrl_tag(%s): "
 			       "socket tag alloc failed\n",
 			       input);
-			spin_unlock_bh(&sock_tag_list_lock);
+			write_unlock_bh(&sock_tag_list_lock);
 			res = -ENOMEM;
 			goto err_tag_unref_put;
 		}
@@ -2236,7 +2251,7 @@ static int ctrl_cmd_tag(const char *input)
 		sock_tag_tree_insert(sock_tag_entry, &sock_tag_tree);
 		atomic64_inc(&qtu_events.sockets_tagged);
 	}
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 	/* We keep the ref to the socket (file) until it is untagged */
 	CT_DEBUG("qtaguid: ctrl_tag(%s): done st@%p ...->f_count=%ld\n",
 		 input, sock_tag_entry,
@@ -2286,10 +2301,10 @@ static int ctrl_cmd_untag(const char *input)
 	CT_DEBUG("qtaguid: ctrl_untag(%s): socket->...->f_count=%ld ->sk=%p\n",
 		 input, atomic_long_read(&el_socket->file->f_count),
 		 el_socket->sk);
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	sock_tag_entry = get_sock_stat_nl(el_socket->sk);
 	if (!sock_tag_entry) {
-		spin_unlock_bh(&sock_tag_list_lock);
+		write_unlock_bh(&sock_tag_list_lock);
 		res = -EINVAL;
 		goto err_put;
 	}
@@ -2323,7 +2338,7 @@ static int ctrl_cmd_untag(const char *input)
 	 * only during a cmd_delete().
 	 */
 	tag_ref_entry->num_sock_tags--;
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 	/*
 	 * Release the sock_fd that was grabbed at tag time,
 	 * and once more for the sockfd_lookup() here.
@@ -2666,7 +2681,7 @@ static int qtudev_release(struct inode *inode, struct file *file)
 		 pqd_entry, pqd_entry->pid, utd_entry,
 		 utd_entry->num_active_tags);
 
-	spin_lock_bh(&sock_tag_list_lock);
+	write_lock_bh(&sock_tag_list_lock);
 	spin_lock_bh(&uid_tag_data_tree_lock);
 
 	list_for_each_safe(entry, next, &pqd_entry->sock_tag_list) {
@@ -2713,7 +2728,7 @@ static int qtudev_release(struct inode *inode, struct file *file)
 	file->private_data = NULL;
 
 	spin_unlock_bh(&uid_tag_data_tree_lock);
-	spin_unlock_bh(&sock_tag_list_lock);
+	write_unlock_bh(&sock_tag_list_lock);
 
 
 	sock_tag_tree_erase(&st_to_free_tree);
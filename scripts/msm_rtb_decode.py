@@ -0,0 +1,123 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 and
+# only version 2 as published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# Decode a dump of the msm_rtb buffer (arch/arm/mach-msm/msm_rtb.c).
+#
+# The dump is the raw uncached region, as saved from a ramdump. Entries are
+# printed oldest first, per cpu when the kernel had
+# CONFIG_MSM_RTB_SEPARATE_CPUS, in which case --cpus must give the number of
+# possible cpus of that kernel. With --map, callers are resolved against
+# the System.map of the kernel.
+
+import bisect
+import optparse
+import struct
+import sys
+
+ENTRY_SIZE = 16
+SENTINEL = (0xFF, 0xAA, 0xFF)
+
+# enum logk_event_type in mach/msm_rtb.h
+LOG_TYPES = {
+    0: "NONE",
+    1: "READL",
+    2: "WRITEL",
+    3: "LOGBUF",
+    4: "HOTPLUG",
+    5: "CTXID",
+    6: "PM",
+    31: "OTHER",
+}
+
+class SymbolMap(object):
+    def __init__(self, path):
+        syms = []
+        for line in open(path):
+            fields = line.split()
+            if len(fields) != 3 or fields[1] not in "tTwW":
+                continue
+            syms.append((int(fields[0], 16), fields[2]))
+        syms.sort()
+        self.addrs = [s[0] for s in syms]
+        self.names = [s[1] for s in syms]
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%08x" % addr
+        return "%s+0x%x" % (self.names[i], addr - self.addrs[i])
+
+def read_entries(data, first, count):
+    """Return the valid entries of [first, first + count), oldest first"""
+    entries = []
+    for n in range(first, first + count):
+        raw = data[n * ENTRY_SIZE:(n + 1) * ENTRY_SIZE]
+        if len(raw) < ENTRY_SIZE:
+            break
+        s1, s2, s3, log_type, caller, idx, extra = \
+            struct.unpack("<BBBBIII", raw)
+        if (s1, s2, s3) != SENTINEL:
+            continue
+        entries.append((idx, log_type, caller, extra))
+    entries.sort()
+    return entries
+
+def pow2_floor(n):
+    p = 1
+    while p * 2 <= n:
+        p *= 2
+    return p
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] rtb.bin")
+    parser.add_option("-c", "--cpus", type="int", default=0,
+            help="possible cpus, for CONFIG_MSM_RTB_SEPARATE_CPUS kernels")
+    parser.add_option("-m", "--map", help="System.map of the kernel")
+    parser.add_option("-t", "--type", action="append", default=[],
+            help="only print entries of this type (may be repeated)")
+    (options, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.error("need exactly one dump file")
+
+    data = open(args[0], "rb").read()
+    symbols = None
+    if options.map:
+        symbols = SymbolMap(options.map)
+    wanted = set(t.upper() for t in options.type)
+
+    nentries = len(data) // ENTRY_SIZE
+    if options.cpus:
+        segments = options.cpus
+        seg_entries = pow2_floor(nentries // segments)
+    else:
+        segments = 1
+        seg_entries = pow2_floor(nentries)
+
+    out = sys.stdout
+    for cpu in range(segments):
+        if options.cpus:
+            out.write("cpu %d:\n" % cpu)
+        for idx, log_type, caller, extra in \
+                read_entries(data, cpu * seg_entries, seg_entries):
+            name = LOG_TYPES.get(log_type, "%d" % log_type)
+            if wanted and name not in wanted:
+                continue
+            if symbols:
+                where = symbols.lookup(caller)
+            else:
+                where = "0x%08x" % caller
+            out.write("%10d %-8s 0x%08x %s\n" % (idx, name, extra, where))
+
+if __name__ == '__main__':
+    main()
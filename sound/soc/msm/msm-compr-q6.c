@@ -174,6 +174,89 @@ static void compr_event_handler(uint32_t opcode,
 	}
 }
 
+/* WAVEFORMATEX tags of the two WMA decoders of the DSP */
+#define WMA_V9_FORMAT_TAG	0x161
+#define WMA_V10PRO_FORMAT_TAG	0x162
+
+static int msm_compr_send_aac_format(struct compr_audio *compr,
+		struct snd_pcm_runtime *runtime)
+{
+	struct snd_codec *codec = &compr->info.codec_param.codec;
+	struct asm_aac_cfg aac_cfg;
+
+	memset(&aac_cfg, 0, sizeof(aac_cfg));
+	if (codec->ch_mode & SND_AUDIOMODE_AAC_HE_PS)
+		aac_cfg.aot = AAC_ENC_MODE_EAAC_P;
+	else if (codec->ch_mode & SND_AUDIOMODE_AAC_HE)
+		aac_cfg.aot = AAC_ENC_MODE_AAC_P;
+	else
+		aac_cfg.aot = AAC_ENC_MODE_AAC_LC;
+
+	switch (codec->format) {
+	case SND_AUDIOSTREAMFORMAT_MP2ADTS:
+	case SND_AUDIOSTREAMFORMAT_MP4ADTS:
+		aac_cfg.format = 0x00;
+		break;
+	case SND_AUDIOSTREAMFORMAT_MP4LOAS:
+		aac_cfg.format = 0x01;
+		break;
+	case SND_AUDIOSTREAMFORMAT_ADIF:
+		aac_cfg.format = 0x02;
+		break;
+	default:
+	case SND_AUDIOSTREAMFORMAT_RAW:
+		aac_cfg.format = 0x03;
+		break;
+	}
+	aac_cfg.ch_cfg = runtime->channels;
+	aac_cfg.sample_rate = runtime->rate;
+
+	return q6asm_media_format_block_aac(compr->prtd.audio_client,
+			&aac_cfg);
+}
+
+static int msm_compr_send_wma_format(struct compr_audio *compr,
+		struct snd_pcm_runtime *runtime)
+{
+	struct snd_codec *codec = &compr->info.codec_param.codec;
+	struct asm_wmapro_cfg wma_cfg;
+
+	/* asm_wma_cfg is laid out the same, the v9 call ignores the rest */
+	memset(&wma_cfg, 0, sizeof(wma_cfg));
+	wma_cfg.ch_cfg = runtime->channels;
+	wma_cfg.sample_rate = runtime->rate;
+	wma_cfg.avg_bytes_per_sec = codec->bit_rate / 8;
+	wma_cfg.block_align = codec->align;
+	wma_cfg.valid_bits_per_sample = 16;
+	/* Speaker positions: front left and right, or front center */
+	wma_cfg.ch_mask = runtime->channels == 1 ? 0x4 : 0x3;
+	wma_cfg.encode_opt = codec->options.wma.super_block_align;
+
+	if (compr->codec == FORMAT_WMA_V10PRO) {
+		wma_cfg.format_tag = WMA_V10PRO_FORMAT_TAG;
+		return q6asm_media_format_block_wmapro(
+				compr->prtd.audio_client, &wma_cfg);
+	}
+	wma_cfg.format_tag = WMA_V9_FORMAT_TAG;
+	return q6asm_media_format_block_wma(compr->prtd.audio_client,
+			&wma_cfg);
+}
+
+static int msm_compr_send_media_format(struct compr_audio *compr,
+		struct snd_pcm_runtime *runtime)
+{
+	switch (compr->codec) {
+	case FORMAT_MPEG4_AAC:
+		return msm_compr_send_aac_format(compr, runtime);
+	case FORMAT_WMA_V9:
+	case FORMAT_WMA_V10PRO:
+		return msm_compr_send_wma_format(compr, runtime);
+	default:
+		return q6asm_media_format_block(compr->prtd.audio_client,
+				compr->codec);
+	}
+}
+
 static int msm_compr_playback_prepare(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -192,7 +275,7 @@ static int msm_compr_playback_prepare(struct snd_pcm_substream *substream)
 	if (prtd->enabled)
 		return 0;
 
-	ret = q6asm_media_format_block(prtd->audio_client, compr->codec);
+	ret = msm_compr_send_media_format(compr, runtime);
 	if (ret < 0)
 		pr_info("%s: CMD Format block failed\n", __func__);
 
@@ -243,13 +326,14 @@ static void populate_codec_list(struct compr_audio *compr,
 		struct snd_pcm_runtime *runtime)
 {
 	pr_debug("%s\n", __func__);
-	/* MP3 Block */
-	compr->info.compr_cap.num_codecs = 1;
+	compr->info.compr_cap.num_codecs = 3;
 	compr->info.compr_cap.min_fragment_size = runtime->hw.period_bytes_min;
 	compr->info.compr_cap.max_fragment_size = runtime->hw.period_bytes_max;
 	compr->info.compr_cap.min_fragments = runtime->hw.periods_min;
 	compr->info.compr_cap.max_fragments = runtime->hw.periods_max;
 	compr->info.compr_cap.codecs[0] = SND_AUDIOCODEC_MP3;
+	compr->info.compr_cap.codecs[1] = SND_AUDIOCODEC_AAC;
+	compr->info.compr_cap.codecs[2] = SND_AUDIOCODEC_WMA;
 	/* Add new codecs here */
 }
 
@@ -504,6 +588,19 @@ static int msm_compr_ioctl(struct snd_pcm_substream *substream,
 			pr_debug("SND_AUDIOCODEC_MP3\n");
 			compr->codec = FORMAT_MP3;
 			break;
+		case SND_AUDIOCODEC_AAC:
+			/* HE-AAC v1 and v2 are told apart by ch_mode */
+			pr_debug("SND_AUDIOCODEC_AAC\n");
+			compr->codec = FORMAT_MPEG4_AAC;
+			break;
+		case SND_AUDIOCODEC_WMA:
+			pr_debug("SND_AUDIOCODEC_WMA\n");
+			if (compr->info.codec_param.codec.profile ==
+					SND_AUDIOPROFILE_WMA10)
+				compr->codec = FORMAT_WMA_V10PRO;
+			else
+				compr->codec = FORMAT_WMA_V9;
+			break;
 		default:
 			pr_debug("FORMAT_LINEAR_PCM\n");
 			compr->codec = FORMAT_LINEAR_PCM;
@@ -18,6 +18,8 @@
 #include <linux/platform_device.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -46,6 +48,19 @@ struct msm_pcm_routing_bdai_data {
 
 static struct mutex routing_lock;
 
+/*
+ * Matrix maps following mixer changes are held back this long, so that a
+ * device switch flipping several mixers sends one map per session. Zero
+ * sends them right away.
+ */
+static unsigned int matrix_batch_ms = 10;
+module_param(matrix_batch_ms, uint, S_IRUGO | S_IWUSR);
+
+/* Front-ends with a matrix map pending, per session type */
+static unsigned long matrix_pending[2];
+static void msm_pcm_routing_matrix_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(matrix_work, msm_pcm_routing_matrix_work);
+
 static int fm_switch_enable;
 #define INT_RX_VOL_MAX_STEPS 0x2000
 #define INT_RX_VOL_GAIN 0x2000
@@ -156,6 +171,44 @@ static void msm_pcm_routing_build_matrix(int fedai_id, int dspst_id,
 			payload.num_copps, payload.copp_ids, 0);
 }
 
+/* Called with routing_lock held */
+static void msm_pcm_routing_queue_matrix(int fedai_id, int session_type)
+{
+	int path_type = (session_type == SESSION_TYPE_RX ?
+		ADM_PATH_PLAYBACK : ADM_PATH_LIVE_REC);
+
+	if (!matrix_batch_ms) {
+		msm_pcm_routing_build_matrix(fedai_id,
+			fe_dai_map[fedai_id][session_type], path_type);
+		return;
+	}
+	set_bit(fedai_id, &matrix_pending[session_type]);
+	schedule_delayed_work(&matrix_work,
+		msecs_to_jiffies(matrix_batch_ms));
+}
+
+static void msm_pcm_routing_matrix_work(struct work_struct *work)
+{
+	int i, session_type, path_type;
+
+	mutex_lock(&routing_lock);
+	for (session_type = SESSION_TYPE_RX; session_type <= SESSION_TYPE_TX;
+		session_type++) {
+		path_type = (session_type == SESSION_TYPE_RX ?
+			ADM_PATH_PLAYBACK : ADM_PATH_LIVE_REC);
+		for_each_set_bit(i, &matrix_pending[session_type],
+			MSM_FRONTEND_DAI_MM_SIZE) {
+			clear_bit(i, &matrix_pending[session_type]);
+			/* The stream may be gone by now */
+			if (fe_dai_map[i][session_type] != INVALID_SESSION)
+				msm_pcm_routing_build_matrix(i,
+					fe_dai_map[i][session_type],
+					path_type);
+		}
+	}
+	mutex_unlock(&routing_lock);
+}
+
 void msm_pcm_routing_reg_phy_stream(int fedai_id, int dspst_id, int stream_type)
 {
 	int i, session_type, path_type, port_type;
@@ -182,6 +235,8 @@ void msm_pcm_routing_reg_phy_stream(int fedai_id, int dspst_id, int stream_type)
 
 	payload.num_copps = 0; /* only RX needs to use payload */
 	fe_dai_map[fedai_id][session_type] = dspst_id;
+	/* The map sent below covers any change still pending */
+	clear_bit(fedai_id, &matrix_pending[session_type]);
 	/* re-enable EQ if active */
 	if (eq_data[fedai_id].enable)
 		msm_send_eq_values(fedai_id);
@@ -314,8 +369,7 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 				msm_bedais[reg].sample_rate, channels,
 				DEFAULT_COPP_TOPOLOGY);
 
-			msm_pcm_routing_build_matrix(val,
-				fe_dai_map[val][session_type], path_type);
+			msm_pcm_routing_queue_matrix(val, session_type);
 		}
 	} else {
 		if (test_bit(val, &msm_bedais[reg].fe_sessions) &&
@@ -325,8 +379,7 @@ static void msm_pcm_routing_process_audio(u16 reg, u16 val, int set)
 		if (msm_bedais[reg].active && fe_dai_map[val][session_type] !=
 			INVALID_SESSION) {
 			adm_close(msm_bedais[reg].port_id);
-			msm_pcm_routing_build_matrix(val,
-				fe_dai_map[val][session_type], path_type);
+			msm_pcm_routing_queue_matrix(val, session_type);
 		}
 	}
 	if ((msm_bedais[reg].port_id == VOICE_RECORD_RX)
@@ -18,6 +18,9 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
 #include <sound/core.h>
 #include <sound/soc.h>
 #include <sound/soc-dapm.h>
@@ -82,6 +85,23 @@ struct voip_frame {
 struct voip_buf_node {
 	struct list_head list;
 	struct voip_frame frame;
+	ktime_t ts;	/* when the packet entered the queue */
+};
+
+/*
+ * Time packets spend queued in the driver: uplink from the DSP encoder
+ * callback to the read by userspace, downlink from the write to the pull
+ * by the DSP decoder. Buckets are VOIP_LAT_BUCKET_MS wide, the last one
+ * takes everything above.
+ */
+#define VOIP_LAT_BUCKET_MS	5
+#define VOIP_LAT_BUCKETS	41
+
+struct voip_latency {
+	unsigned int hist[VOIP_LAT_BUCKETS];
+	unsigned int count;
+	s64 max_us;
+	s64 total_us;
 };
 
 struct voip_drv_info {
@@ -128,6 +148,9 @@ struct voip_drv_info {
 	unsigned int pcm_capture_count;
 	unsigned int pcm_capture_irq_pos;       /* IRQ position */
 	unsigned int pcm_capture_buf_pos;       /* position in buffer */
+
+	struct voip_latency ul_latency;
+	struct voip_latency dl_latency;
 };
 
 static int voip_get_media_type(uint32_t mode,
@@ -250,6 +273,20 @@ static int msm_pcm_voip_probe(struct snd_soc_platform *platform)
 static unsigned int supported_sample_rates[] = {8000, 16000};
 
 /* capture path */
+static void voip_latency_add(struct voip_latency *lat, ktime_t since)
+{
+	s64 us = ktime_us_delta(ktime_get(), since);
+	unsigned int idx = div_s64(us, VOIP_LAT_BUCKET_MS * USEC_PER_MSEC);
+
+	if (idx >= VOIP_LAT_BUCKETS)
+		idx = VOIP_LAT_BUCKETS - 1;
+	lat->hist[idx]++;
+	lat->count++;
+	lat->total_us += us;
+	if (us > lat->max_us)
+		lat->max_us = us;
+}
+
 static void voip_process_ul_pkt(uint8_t *voc_pkt,
 					uint32_t pkt_len,
 					void *private_data)
@@ -293,6 +330,7 @@ static void voip_process_ul_pkt(uint8_t *voc_pkt,
 			list_add_tail(&buf_node->list, &prtd->out_queue);
 		}
 		}
+		buf_node->ts = ktime_get();
 		pr_debug("ul_pkt: pkt_len =%d, frame.len=%d\n", pkt_len,
 			buf_node->frame.len);
 		prtd->pcm_capture_irq_pos += prtd->pcm_capture_count;
@@ -352,6 +390,7 @@ static void voip_process_dl_pkt(uint8_t *voc_pkt,
 			list_add_tail(&buf_node->list, &prtd->free_in_queue);
 		}
 		}
+		voip_latency_add(&prtd->dl_latency, buf_node->ts);
 		pr_debug("dl_pkt: pkt_len=%d, frame_len=%d\n", *pkt_len,
 			buf_node->frame.len);
 		prtd->pcm_playback_irq_pos += prtd->pcm_count;
@@ -496,6 +535,7 @@ static int msm_pcm_playback_copy(struct snd_pcm_substream *substream, int a,
 			} else
 				ret = copy_from_user(&buf_node->frame,
 							buf, count);
+			buf_node->ts = ktime_get();
 			list_add_tail(&buf_node->list, &prtd->in_queue);
 		} else {
 			pr_err("%s: Write cnt %d is > VOIP_MAX_VOC_PKT_SIZE\n",
@@ -522,6 +562,7 @@ static int msm_pcm_capture_copy(struct snd_pcm_substream *substream,
 	struct voip_buf_node *buf_node = NULL;
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct voip_drv_info *prtd = runtime->private_data;
+	unsigned long dsp_flags;
 
 	count = frames_to_bytes(runtime, frames);
 
@@ -551,6 +592,12 @@ static int msm_pcm_capture_copy(struct snd_pcm_substream *substream,
 				pr_err("%s: Copy to user retuned %d\n",
 					__func__, ret);
 				ret = -EFAULT;
+			} else {
+				spin_lock_irqsave(&prtd->dsp_lock, dsp_flags);
+				voip_latency_add(&prtd->ul_latency,
+						 buf_node->ts);
+				spin_unlock_irqrestore(&prtd->dsp_lock,
+						       dsp_flags);
 			}
 			list_add_tail(&buf_node->list,
 						&prtd->free_out_queue);
@@ -1066,6 +1113,70 @@ static struct platform_driver msm_pcm_driver = {
 	.remove = __devexit_p(msm_pcm_remove),
 };
 
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *voip_latency_dentry;
+
+static int voip_latency_show(char *buf, int size, const char *name,
+			     struct voip_latency *lat)
+{
+	int i, n;
+
+	n = scnprintf(buf, size, "%s: packets %u avg_us %lld max_us %lld\n",
+		name, lat->count,
+		lat->count ? div_s64(lat->total_us, lat->count) : 0,
+		lat->max_us);
+	for (i = 0; i < VOIP_LAT_BUCKETS; i++) {
+		if (!lat->hist[i])
+			continue;
+		if (i == VOIP_LAT_BUCKETS - 1)
+			n += scnprintf(buf + n, size - n, "  >=%3d ms: %u\n",
+				i * VOIP_LAT_BUCKET_MS, lat->hist[i]);
+		else
+			n += scnprintf(buf + n, size - n, "  %3d-%3d ms: %u\n",
+				i * VOIP_LAT_BUCKET_MS,
+				(i + 1) * VOIP_LAT_BUCKET_MS, lat->hist[i]);
+	}
+	return n;
+}
+
+static ssize_t voip_latency_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	const int size = 4096;
+	char *buf;
+	int n;
+	ssize_t ret;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	n = voip_latency_show(buf, size, "uplink", &voip_info.ul_latency);
+	n += voip_latency_show(buf + n, size - n, "downlink",
+			       &voip_info.dl_latency);
+	ret = simple_read_from_buffer(ubuf, count, ppos, buf, n);
+	kfree(buf);
+	return ret;
+}
+
+/* Any write clears the histograms */
+static ssize_t voip_latency_write(struct file *file, const char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	unsigned long dsp_flags;
+
+	spin_lock_irqsave(&voip_info.dsp_lock, dsp_flags);
+	memset(&voip_info.ul_latency, 0, sizeof(voip_info.ul_latency));
+	memset(&voip_info.dl_latency, 0, sizeof(voip_info.dl_latency));
+	spin_unlock_irqrestore(&voip_info.dsp_lock, dsp_flags);
+	return count;
+}
+
+static const struct file_operations voip_latency_fops = {
+	.read = voip_latency_read,
+	.write = voip_latency_write,
+};
+#endif
+
 static int __init msm_soc_platform_init(void)
 {
 	memset(&voip_info, 0, sizeof(voip_info));
@@ -1084,12 +1195,20 @@ static int __init msm_soc_platform_init(void)
 	INIT_LIST_HEAD(&voip_info.out_queue);
 	INIT_LIST_HEAD(&voip_info.free_out_queue);
 
+#ifdef CONFIG_DEBUG_FS
+	voip_latency_dentry = debugfs_create_file("msm_voip_latency",
+				S_IFREG | S_IRUGO | S_IWUSR, NULL, NULL,
+				&voip_latency_fops);
+#endif
 	return platform_driver_register(&msm_pcm_driver);
 }
 module_init(msm_soc_platform_init);
 
 static void __exit msm_soc_platform_exit(void)
 {
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove(voip_latency_dentry);
+#endif
 	platform_driver_unregister(&msm_pcm_driver);
 }
 module_exit(msm_soc_platform_exit);
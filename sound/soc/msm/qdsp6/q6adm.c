@@ -16,6 +16,7 @@
 #include <linux/jiffies.h>
 #include <linux/uaccess.h>
 #include <linux/atomic.h>
+#include <linux/mutex.h>
 
 #include <mach/qdsp6v2/audio_dev_ctl.h>
 #include <mach/qdsp6v2/audio_acdb.h>
@@ -40,8 +41,22 @@ struct adm_ctl {
 	wait_queue_head_t wait;
 };
 
-static struct acdb_cal_block mem_addr_audproc[MAX_AUDPROC_TYPES];
-static struct acdb_cal_block mem_addr_audvol[MAX_AUDPROC_TYPES];
+/*
+ * Calibration regions kept mapped to the ADM. A device switch usually goes
+ * back to blocks that were sent before, so they are only unmapped when a
+ * slot is needed for another region.
+ */
+#define ADM_CAL_CACHE_SIZE 8
+
+struct adm_cal_region {
+	uint32_t	paddr;
+	uint32_t	size;
+	unsigned long	last_use;
+};
+
+static struct adm_cal_region adm_cal_cache[ADM_CAL_CACHE_SIZE];
+static unsigned long adm_cal_use_cnt;
+static DEFINE_MUTEX(adm_cal_lock);
 
 static struct adm_ctl			this_adm;
 
@@ -64,6 +79,8 @@ static int32_t adm_callback(struct apr_client_data *data, void *priv)
 				atomic_set(&this_adm.copp_stat[i], 0);
 			}
 			this_adm.apr = NULL;
+			/* The DSP dropped its mappings too */
+			memset(adm_cal_cache, 0, sizeof(adm_cal_cache));
 		}
 		return 0;
 	}
@@ -199,9 +216,50 @@ done:
 	return result;
 }
 
+/* Make sure the ADM has the calibration block mapped */
+static int adm_cal_map(struct acdb_cal_block *aud_cal)
+{
+	struct adm_cal_region *region, *victim = NULL;
+	int i, result = 0;
+
+	if (aud_cal->cal_size == 0)
+		return 0;
+
+	mutex_lock(&adm_cal_lock);
+	for (i = 0; i < ADM_CAL_CACHE_SIZE; i++) {
+		region = &adm_cal_cache[i];
+		if (region->size &&
+			aud_cal->cal_paddr >= region->paddr &&
+			aud_cal->cal_paddr + aud_cal->cal_size <=
+				region->paddr + region->size) {
+			region->last_use = ++adm_cal_use_cnt;
+			goto done;
+		}
+		if (!victim || !region->size ||
+			(victim->size && region->last_use < victim->last_use))
+			victim = region;
+	}
+
+	if (victim->size) {
+		pr_debug("%s: evicting 0x%x size %d\n", __func__,
+			victim->paddr, victim->size);
+		adm_memory_unmap_regions(&victim->paddr, &victim->size, 1);
+		victim->size = 0;
+	}
+	result = adm_memory_map_regions(&aud_cal->cal_paddr, 0,
+				&aud_cal->cal_size, 1);
+	if (result < 0)
+		goto done;
+	victim->paddr = aud_cal->cal_paddr;
+	victim->size = aud_cal->cal_size;
+	victim->last_use = ++adm_cal_use_cnt;
+done:
+	mutex_unlock(&adm_cal_lock);
+	return result;
+}
+
 static void send_adm_cal(int port_id, int path)
 {
-	int			result = 0;
 	s32			acdb_path;
 	struct acdb_cal_block	aud_cal;
 
@@ -213,25 +271,10 @@ static void send_adm_cal(int port_id, int path)
 	pr_debug("%s: Sending audproc cal\n", __func__);
 	get_audproc_cal(acdb_path, &aud_cal);
 
-	/* map & cache buffers used */
-	if (((mem_addr_audproc[acdb_path].cal_paddr != aud_cal.cal_paddr)  &&
-		(aud_cal.cal_size > 0)) ||
-		(aud_cal.cal_size > mem_addr_audproc[acdb_path].cal_size)) {
-
-		if (mem_addr_audproc[acdb_path].cal_paddr != 0)
-			adm_memory_unmap_regions(
-				&mem_addr_audproc[acdb_path].cal_paddr,
-				&mem_addr_audproc[acdb_path].cal_size, 1);
-
-		result = adm_memory_map_regions(&aud_cal.cal_paddr, 0,
-					&aud_cal.cal_size, 1);
-		if (result < 0)
-			pr_err("ADM audproc mmap did not work! path = %d, "
-				"addr = 0x%x, size = %d\n", acdb_path,
-				aud_cal.cal_paddr, aud_cal.cal_size);
-		else
-			mem_addr_audproc[acdb_path] = aud_cal;
-	}
+	if (adm_cal_map(&aud_cal) < 0)
+		pr_err("ADM audproc mmap did not work! path = %d, "
+			"addr = 0x%x, size = %d\n", acdb_path,
+			aud_cal.cal_paddr, aud_cal.cal_size);
 
 	if (!send_adm_cal_block(port_id, &aud_cal))
 		pr_debug("%s: Audproc cal sent for port id: %d, path %d\n",
@@ -243,24 +286,10 @@ static void send_adm_cal(int port_id, int path)
 	pr_debug("%s: Sending audvol cal\n", __func__);
 	get_audvol_cal(acdb_path, &aud_cal);
 
-	/* map & cache buffers used */
-	if (((mem_addr_audvol[acdb_path].cal_paddr != aud_cal.cal_paddr)  &&
-		(aud_cal.cal_size > 0))  ||
-		(aud_cal.cal_size > mem_addr_audvol[acdb_path].cal_size)) {
-		if (mem_addr_audvol[acdb_path].cal_paddr != 0)
-			adm_memory_unmap_regions(
-				&mem_addr_audvol[acdb_path].cal_paddr,
-				&mem_addr_audvol[acdb_path].cal_size, 1);
-
-		result = adm_memory_map_regions(&aud_cal.cal_paddr, 0,
-					&aud_cal.cal_size, 1);
-		if (result < 0)
-			pr_err("ADM audvol mmap did not work! path = %d, "
-				"addr = 0x%x, size = %d\n", acdb_path,
-				aud_cal.cal_paddr, aud_cal.cal_size);
-		else
-			mem_addr_audvol[acdb_path] = aud_cal;
-	}
+	if (adm_cal_map(&aud_cal) < 0)
+		pr_err("ADM audvol mmap did not work! path = %d, "
+			"addr = 0x%x, size = %d\n", acdb_path,
+			aud_cal.cal_paddr, aud_cal.cal_size);
 
 	if (!send_adm_cal_block(port_id, &aud_cal))
 		pr_debug("%s: Audvol cal sent for port id: %d, path %d\n",
@@ -69,6 +69,8 @@ static void q6asm_add_hdr(struct audio_client *ac, struct apr_hdr *hdr,
 			uint32_t pkt_size, uint32_t cmd_flg);
 static void q6asm_add_hdr_async(struct audio_client *ac, struct apr_hdr *hdr,
 			uint32_t pkt_size, uint32_t cmd_flg);
+static void q6asm_add_hdr_nowait(struct audio_client *ac, struct apr_hdr *hdr,
+			uint32_t pkt_size);
 static int q6asm_memory_map_regions(struct audio_client *ac, int dir,
 				uint32_t bufsz, uint32_t bufcnt);
 static int q6asm_memory_unmap_regions(struct audio_client *ac, int dir,
@@ -740,7 +742,9 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 		data->dest_port);
 
 	if (data->opcode == APR_BASIC_RSP_RESULT) {
-		token = data->token;
+		int nowait = data->token & ASM_NOWAIT_TOKEN;
+
+		token = data->token & ~ASM_NOWAIT_TOKEN;
 		switch (payload[0]) {
 		case ASM_STREAM_CMD_SET_PP_PARAMS:
 			if (rtac_make_asm_callback(ac->session, payload,
@@ -764,7 +768,13 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 		case ASM_STREAM_CMD_OPEN_READWRITE:
 		case ASM_DATA_CMD_MEDIA_FORMAT_UPDATE:
 		case ASM_STREAM_CMD_SET_ENCDEC_PARAM:
-			if (atomic_read(&ac->cmd_state)) {
+			/* Nobody waits for nowait commands, only report errors */
+			if (nowait) {
+				if (payload[1])
+					pr_err("%s: cmd[0x%x] failed[0x%x]\n",
+						__func__, payload[0],
+						payload[1]);
+			} else if (atomic_read(&ac->cmd_state)) {
 				atomic_set(&ac->cmd_state, 0);
 				wake_up(&ac->cmd_wait);
 			}
@@ -1396,7 +1406,7 @@ int q6asm_run_nowait(struct audio_client *ac, uint32_t flags,
 		return -EINVAL;
 	}
 	pr_debug("session[%d]", ac->session);
-	q6asm_add_hdr_async(ac, &run.hdr, sizeof(run), TRUE);
+	q6asm_add_hdr_nowait(ac, &run.hdr, sizeof(run));
 
 	run.hdr.opcode = ASM_SESSION_CMD_RUN;
 	run.flags    = flags;
@@ -1455,8 +1465,8 @@ fail_cmd:
 	return -EINVAL;
 }
 
-int q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
-			uint32_t rate, uint32_t channels)
+static int __q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
+			uint32_t rate, uint32_t channels, int nowait)
 {
 	struct asm_stream_cmd_encdec_cfg_blk  enc_cfg;
 
@@ -1465,7 +1475,10 @@ int q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
 	pr_debug("%s: Session %d, rate = %d, channels = %d\n", __func__,
 			 ac->session, rate, channels);
 
-	q6asm_add_hdr(ac, &enc_cfg.hdr, sizeof(enc_cfg), TRUE);
+	if (nowait)
+		q6asm_add_hdr_nowait(ac, &enc_cfg.hdr, sizeof(enc_cfg));
+	else
+		q6asm_add_hdr(ac, &enc_cfg.hdr, sizeof(enc_cfg), TRUE);
 
 	enc_cfg.hdr.opcode = ASM_STREAM_CMD_SET_ENCDEC_PARAM;
 	enc_cfg.param_id = ASM_ENCDEC_CFG_BLK_ID;
@@ -1485,6 +1498,8 @@ int q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
 		rc = -EINVAL;
 		goto fail_cmd;
 	}
+	if (nowait)
+		return 0;
 	rc = wait_event_timeout(ac->cmd_wait,
 			(atomic_read(&ac->cmd_state) == 0), 5*HZ);
 	if (!rc) {
@@ -1496,6 +1511,18 @@ fail_cmd:
 	return -EINVAL;
 }
 
+int q6asm_enc_cfg_blk_pcm(struct audio_client *ac,
+			uint32_t rate, uint32_t channels)
+{
+	return __q6asm_enc_cfg_blk_pcm(ac, rate, channels, 0);
+}
+
+int q6asm_enc_cfg_blk_pcm_nowait(struct audio_client *ac,
+			uint32_t rate, uint32_t channels)
+{
+	return __q6asm_enc_cfg_blk_pcm(ac, rate, channels, 1);
+}
+
 int q6asm_enable_sbrps(struct audio_client *ac,
 			uint32_t sbr_ps_enable)
 {
@@ -1791,8 +1818,8 @@ fail_cmd:
 	return -EINVAL;
 }
 
-int q6asm_media_format_block_pcm(struct audio_client *ac,
-				uint32_t rate, uint32_t channels)
+static int __q6asm_media_format_block_pcm(struct audio_client *ac,
+				uint32_t rate, uint32_t channels, int nowait)
 {
 	struct asm_stream_media_format_update fmt;
 	int rc = 0;
@@ -1800,7 +1827,10 @@ int q6asm_media_format_block_pcm(struct audio_client *ac,
 	pr_debug("%s:session[%d]rate[%d]ch[%d]\n", __func__, ac->session, rate,
 		channels);
 
-	q6asm_add_hdr(ac, &fmt.hdr, sizeof(fmt), TRUE);
+	if (nowait)
+		q6asm_add_hdr_nowait(ac, &fmt.hdr, sizeof(fmt));
+	else
+		q6asm_add_hdr(ac, &fmt.hdr, sizeof(fmt), TRUE);
 
 	fmt.hdr.opcode = ASM_DATA_CMD_MEDIA_FORMAT_UPDATE;
 
@@ -1817,6 +1847,8 @@ int q6asm_media_format_block_pcm(struct audio_client *ac,
 		pr_err("%s:Comamnd open failed\n", __func__);
 		goto fail_cmd;
 	}
+	if (nowait)
+		return 0;
 	rc = wait_event_timeout(ac->cmd_wait,
 			(atomic_read(&ac->cmd_state) == 0), 5*HZ);
 	if (!rc) {
@@ -1828,6 +1860,18 @@ fail_cmd:
 	return -EINVAL;
 }
 
+int q6asm_media_format_block_pcm(struct audio_client *ac,
+				uint32_t rate, uint32_t channels)
+{
+	return __q6asm_media_format_block_pcm(ac, rate, channels, 0);
+}
+
+int q6asm_media_format_block_pcm_nowait(struct audio_client *ac,
+				uint32_t rate, uint32_t channels)
+{
+	return __q6asm_media_format_block_pcm(ac, rate, channels, 1);
+}
+
 int q6asm_media_format_block_multi_ch_pcm(struct audio_client *ac,
 				uint32_t rate, uint32_t channels)
 {
@@ -2845,6 +2889,18 @@ static void q6asm_add_hdr_async(struct audio_client *ac, struct apr_hdr *hdr,
 	return;
 }
 
+/*
+ * Header of a command whose ack nobody waits for. The ack is told apart by
+ * its token and leaves cmd_state alone, so commands can be queued to the
+ * DSP back to back without waking up the waiter of another one.
+ */
+static void q6asm_add_hdr_nowait(struct audio_client *ac, struct apr_hdr *hdr,
+			uint32_t pkt_size)
+{
+	q6asm_add_hdr_async(ac, hdr, pkt_size, FALSE);
+	hdr->token = ac->session | ASM_NOWAIT_TOKEN;
+}
+
 int q6asm_async_write(struct audio_client *ac,
 					  struct audio_aio_write_param *param)
 {
@@ -3185,7 +3241,7 @@ int q6asm_cmd_nowait(struct audio_client *ac, int cmd)
 		pr_err("%s:APR handle NULL\n", __func__);
 		return -EINVAL;
 	}
-	q6asm_add_hdr_async(ac, &hdr, sizeof(hdr), TRUE);
+	q6asm_add_hdr_nowait(ac, &hdr, sizeof(hdr));
 	switch (cmd) {
 	case CMD_PAUSE:
 		pr_debug("%s:CMD_PAUSE\n", __func__);